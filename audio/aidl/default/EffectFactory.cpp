@@ -24,6 +24,7 @@
 #define LOG_TAG "AHAL_EffectFactory"
 
 #include <android-base/logging.h>
+#include <android-base/properties.h>
 #include <android/binder_ibinder_platform.h>
 #include <system/audio_aidl_utils.h>
 #include <system/audio_effects/effect_uuid.h>
@@ -36,8 +37,15 @@ using aidl::android::media::audio::common::AudioUuid;
 
 namespace aidl::android::hardware::audio::effect {
 
+// Number of threads processing the effects, 0 gives every effect instance a thread of its own.
+static const char* kWorkerPoolSizeProperty = "ro.vendor.audio.effect.worker_pool_size";
+
 Factory::Factory(const std::string& file) : mConfig(EffectConfig(file)) {
     LOG(DEBUG) << __func__ << " with config file: " << file;
+    if (const int workerCount = ::android::base::GetIntProperty(kWorkerPoolSizeProperty, 0);
+        workerCount > 0) {
+        mWorkerPool = EffectWorkerPool::create(workerCount);
+    }
     loadEffectLibs();
 }
 
@@ -142,6 +150,11 @@ ndk::ScopedAStatus Factory::createEffect(const AudioUuid& in_impl_uuid,
             LOG(WARNING) << __func__ << ": library created null instance without return error!";
             return ndk::ScopedAStatus::fromExceptionCode(EX_TRANSACTION_FAILED);
         }
+        if (mWorkerPool && libInterface->setSchedulerFunc) {
+            if (auto ret = libInterface->setSchedulerFunc(effectSp, mWorkerPool); ret != EX_NONE) {
+                LOG(WARNING) << __func__ << ": failed to set scheduler, error " << ret;
+            }
+        }
         *_aidl_return = effectSp;
         ndk::SpAIBinder effectBinder = effectSp->asBinder();
         AIBinder_setMinSchedulerPolicy(effectBinder.get(), SCHED_NORMAL, ANDROID_PRIORITY_AUDIO);
@@ -199,6 +212,15 @@ ndk::ScopedAStatus Factory::destroyEffect(const std::shared_ptr<IEffect>& in_han
     return status;
 }
 
+binder_status_t Factory::dump(int fd, const char** /*args*/, uint32_t /*numArgs*/) {
+    if (mWorkerPool) {
+        mWorkerPool->dump(fd);
+    } else {
+        dprintf(fd, "EffectWorkerPool: disabled, set %s to enable\n", kWorkerPoolSizeProperty);
+    }
+    return STATUS_OK;
+}
+
 bool Factory::openEffectLibrary(const AudioUuid& impl,
                                 const std::string& path) NO_THREAD_SAFETY_ANALYSIS {
     std::function<void(void*)> dlClose = [](void* handle) -> void {
@@ -216,7 +238,7 @@ bool Factory::openEffectLibrary(const AudioUuid& impl,
 
     LOG(DEBUG) << __func__ << " dlopen lib: " << path
                << "\nimpl:" << ::android::audio::utils::toString(impl) << "\nhandle:" << libHandle;
-    auto interface = new effect_dl_interface_s{nullptr, nullptr, nullptr};
+    auto interface = new effect_dl_interface_s{nullptr, nullptr, nullptr, nullptr};
     mEffectLibMap.insert(
             {impl,
              std::make_tuple(std::move(libHandle),
@@ -285,6 +307,10 @@ void Factory::getDlSyms_l(DlEntry& entry) {
         dlInterface->destroyEffectFunc =
                 (EffectDestroyFunctor)dlsym(dlHandle.get(), "destroyEffect");
     }
+    if (!dlInterface->setSchedulerFunc) {
+        dlInterface->setSchedulerFunc =
+                (EffectSetSchedulerFunctor)dlsym(dlHandle.get(), "setEffectScheduler");
+    }
 
     if (!dlInterface->createEffectFunc || !dlInterface->destroyEffectFunc ||
         !dlInterface->queryEffectFunc) {
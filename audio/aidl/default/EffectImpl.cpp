@@ -22,6 +22,8 @@
 #include "effect-impl/EffectTypes.h"
 #include "include/effect-impl/EffectTypes.h"
 
+using aidl::android::hardware::audio::effect::EffectImpl;
+using aidl::android::hardware::audio::effect::EffectScheduler;
 using aidl::android::hardware::audio::effect::IEffect;
 using aidl::android::hardware::audio::effect::kEventFlagDataMqNotEmpty;
 using aidl::android::hardware::audio::effect::kEventFlagNotEmpty;
@@ -41,6 +43,18 @@ extern "C" binder_exception_t destroyEffect(const std::shared_ptr<IEffect>& inst
     return EX_NONE;
 }
 
+extern "C" binder_exception_t setEffectScheduler(
+        const std::shared_ptr<IEffect>& instanceSp,
+        const std::shared_ptr<EffectScheduler>& scheduler) {
+    if (!instanceSp) {
+        LOG(ERROR) << __func__ << " invalid input parameter!";
+        return EX_ILLEGAL_ARGUMENT;
+    }
+    // Every instance created by a library built with the effect common files is an EffectImpl.
+    static_cast<EffectImpl*>(instanceSp.get())->setScheduler(scheduler);
+    return EX_NONE;
+}
+
 namespace aidl::android::hardware::audio::effect {
 
 ndk::ScopedAStatus EffectImpl::open(const Parameter::Common& common,
@@ -60,6 +74,8 @@ ndk::ScopedAStatus EffectImpl::open(const Parameter::Common& common,
               "FailedToGetInterfaceVersion");
     mImplContext->setVersion(mVersion);
     mEventFlag = mImplContext->getStatusEventFlag();
+    mEventFlagWord = mImplContext->getStatusFmq()->getEventFlagWord();
+    mSessionId = mImplContext->getSessionId();
     mDataMqNotEmptyEf =
             mVersion >= kReopenSupportedVersion ? kEventFlagDataMqNotEmpty : kEventFlagNotEmpty;
 
@@ -31,14 +31,26 @@ EffectThread::~EffectThread() {
     destroyThread();
 }
 
+void EffectThread::setScheduler(std::shared_ptr<EffectScheduler> scheduler) {
+    mScheduler = std::move(scheduler);
+}
+
 RetCode EffectThread::createThread(const std::string& name, int priority) {
-    if (mThread.joinable()) {
+    if (mThread.joinable() || mScheduled) {
         LOG(WARNING) << mName << __func__ << " thread already created, no-op";
         return RetCode::SUCCESS;
     }
 
     mName = name;
     mPriority = priority;
+    if (mScheduler) {
+        if (mScheduler->addTask(this)) {
+            mScheduled = true;
+            LOG(VERBOSE) << mName << __func__ << " on shared workers";
+            return RetCode::SUCCESS;
+        }
+        LOG(WARNING) << mName << __func__ << " scheduler full, creating own thread";
+    }
     {
         std::lock_guard lg(mThreadMutex);
         mStop = true;
@@ -51,6 +63,13 @@ RetCode EffectThread::createThread(const std::string& name, int priority) {
 }
 
 RetCode EffectThread::destroyThread() {
+    if (mScheduled) {
+        mScheduler->removeTask(this);
+        mScheduled = false;
+        LOG(VERBOSE) << mName << __func__;
+        return RetCode::SUCCESS;
+    }
+
     {
         std::lock_guard lg(mThreadMutex);
         mStop = mExit = true;
@@ -66,6 +85,12 @@ RetCode EffectThread::destroyThread() {
 }
 
 RetCode EffectThread::startThread() {
+    if (mScheduled) {
+        mScheduler->startTask(this);
+        LOG(VERBOSE) << mName << __func__;
+        return RetCode::SUCCESS;
+    }
+
     {
         std::lock_guard lg(mThreadMutex);
         mStop = false;
@@ -77,6 +102,12 @@ RetCode EffectThread::startThread() {
 }
 
 RetCode EffectThread::stopThread() {
+    if (mScheduled) {
+        mScheduler->stopTask(this);
+        LOG(VERBOSE) << mName << __func__;
+        return RetCode::SUCCESS;
+    }
+
     {
         std::lock_guard lg(mThreadMutex);
         mStop = true;
@@ -0,0 +1,358 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#define LOG_TAG "AHAL_EffectWorkerPool"
+#include <android-base/logging.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "effectFactory-impl/EffectWorkerPool.h"
+
+namespace aidl::android::hardware::audio::effect {
+
+namespace {
+
+// One waiter of each worker is its own control word.
+constexpr size_t kMaxTasksPerWorker = FUTEX_WAITV_MAX - 1;
+constexpr int kMaxTaskNameLen = 15;
+
+futex_waitv makeWaiter(std::atomic<uint32_t>* word, uint32_t expected, uint32_t flags) {
+    return {.val = expected,
+            .uaddr = reinterpret_cast<uintptr_t>(word),
+            .flags = FUTEX_32 | flags,
+            .__reserved = 0};
+}
+
+// Returns the index of the woken waiter, or -1 with errno set.
+long futexWaitv(std::vector<futex_waitv>& waiters) {
+    return syscall(__NR_futex_waitv, waiters.data(), waiters.size(), 0 /* flags */,
+                   nullptr /* no timeout */, CLOCK_MONOTONIC);
+}
+
+}  // namespace
+
+class EffectWorkerPool::Worker {
+  public:
+    Worker(const std::string& name, int priority) : mName(name), mPriority(priority) {
+        mThread = std::thread(&Worker::threadLoop, this);
+    }
+
+    ~Worker() {
+        {
+            std::lock_guard lg(mMutex);
+            mExit = true;
+        }
+        notify();
+        mThread.join();
+    }
+
+    size_t getTaskCount() {
+        std::lock_guard lg(mMutex);
+        return mEntries.size();
+    }
+
+    bool hasGroup(int groupId) {
+        std::lock_guard lg(mMutex);
+        return std::any_of(mEntries.begin(), mEntries.end(),
+                           [groupId](const auto& entry) { return entry->groupId == groupId; });
+    }
+
+    bool add(Task* task) {
+        auto entry = std::make_shared<Entry>();
+        entry->task = task;
+        entry->name = task->getTaskName();
+        entry->groupId = task->getGroupId();
+        entry->word = task->getWakeWord();
+        entry->mask = task->getWakeMask();
+        if (!entry->word) {
+            LOG(ERROR) << __func__ << ": " << entry->name << " has no wake word";
+            return false;
+        }
+        {
+            std::lock_guard lg(mMutex);
+            if (mEntries.size() >= kMaxTasksPerWorker) {
+                return false;
+            }
+            mEntries.push_back(std::move(entry));
+            mGeneration++;
+        }
+        notify();
+        return true;
+    }
+
+    // Blocks until the worker has dropped its reference to the task.
+    void remove(Task* task) {
+        std::shared_ptr<Entry> removed;
+        {
+            std::unique_lock l(mMutex);
+            auto it = std::find_if(mEntries.begin(), mEntries.end(),
+                                   [task](const auto& entry) { return entry->task == task; });
+            if (it == mEntries.end()) {
+                return;
+            }
+            removed = *it;
+            mEntries.erase(it);
+            const uint64_t generation = ++mGeneration;
+            notify();
+            ::android::base::ScopedLockAssertion lock_assertion(mMutex);
+            mCv.wait(l, [&]() REQUIRES(mMutex) {
+                return mExit || mAckedGeneration >= generation;
+            });
+        }
+        LOG(DEBUG) << __func__ << ": " << removed->name << " " << removed->toString();
+    }
+
+    void setStarted(Task* task, bool started) {
+        {
+            std::lock_guard lg(mMutex);
+            for (auto& entry : mEntries) {
+                if (entry->task == task) {
+                    entry->started = started;
+                }
+            }
+        }
+        notify();
+    }
+
+    std::string dump() {
+        std::lock_guard lg(mMutex);
+        std::string result = mName + ": " + std::to_string(mEntries.size()) + " effects\n";
+        for (const auto& entry : mEntries) {
+            result.append("  ")
+                    .append(entry->name)
+                    .append(" session ")
+                    .append(std::to_string(entry->groupId))
+                    .append(entry->started ? " started " : " stopped ")
+                    .append(entry->toString())
+                    .append("\n");
+        }
+        return result;
+    }
+
+  private:
+    struct Entry {
+        Task* task = nullptr;
+        std::string name;
+        int groupId = 0;
+        std::atomic<uint32_t>* word = nullptr;
+        uint32_t mask = 0;
+        std::atomic<bool> started = false;
+        // Written by the worker only, read by dump().
+        std::atomic<uint64_t> processCount = 0;
+        std::atomic<uint64_t> totalNs = 0;
+        std::atomic<uint64_t> maxNs = 0;
+
+        std::string toString() const {
+            const uint64_t count = processCount.load(std::memory_order_relaxed);
+            const uint64_t total = totalNs.load(std::memory_order_relaxed);
+            return "processed " + std::to_string(count) + " times, average " +
+                   std::to_string(count ? total / count / 1000 : 0) + " us, max " +
+                   std::to_string(maxNs.load(std::memory_order_relaxed) / 1000) + " us";
+        }
+    };
+
+    const std::string mName;
+    const int mPriority;
+
+    std::mutex mMutex;
+    std::condition_variable mCv;
+    std::vector<std::shared_ptr<Entry>> mEntries GUARDED_BY(mMutex);
+    // Bumped on every change of mEntries, the worker acknowledges once it has taken the change.
+    uint64_t mGeneration GUARDED_BY(mMutex) = 0;
+    uint64_t mAckedGeneration GUARDED_BY(mMutex) = 0;
+    bool mExit GUARDED_BY(mMutex) = false;
+
+    // Changed to interrupt the wait of the worker, only waited on in this process.
+    std::atomic<uint32_t> mControlWord = 0;
+    std::thread mThread;
+
+    void notify() {
+        mControlWord.fetch_add(1);
+        syscall(__NR_futex, &mControlWord, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+    }
+
+    void run(Entry& entry) {
+        const auto start = std::chrono::steady_clock::now();
+        entry.task->process();
+        const uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                    std::chrono::steady_clock::now() - start)
+                                    .count();
+        entry.processCount.fetch_add(1, std::memory_order_relaxed);
+        entry.totalNs.fetch_add(ns, std::memory_order_relaxed);
+        if (ns > entry.maxNs.load(std::memory_order_relaxed)) {
+            entry.maxNs.store(ns, std::memory_order_relaxed);
+        }
+    }
+
+    void threadLoop() {
+        pthread_setname_np(pthread_self(), mName.substr(0, kMaxTaskNameLen - 1).c_str());
+        setpriority(PRIO_PROCESS, 0, mPriority);
+        std::vector<std::shared_ptr<Entry>> entries;
+        std::vector<futex_waitv> waiters;
+        waiters.reserve(FUTEX_WAITV_MAX);
+        while (true) {
+            // Read before the entries: a change made after this fails the wait below right away.
+            const uint32_t control = mControlWord.load();
+            {
+                std::lock_guard lg(mMutex);
+                if (mExit) {
+                    LOG(VERBOSE) << mName << " threadLoop EXIT!";
+                    mCv.notify_all();
+                    return;
+                }
+                if (mAckedGeneration != mGeneration) {
+                    entries = mEntries;
+                    mAckedGeneration = mGeneration;
+                    mCv.notify_all();
+                }
+            }
+
+            waiters.clear();
+            waiters.push_back(makeWaiter(&mControlWord, control, FUTEX_PRIVATE_FLAG));
+            bool processed = false;
+            for (const auto& entry : entries) {
+                if (!entry->started) {
+                    continue;
+                }
+                // The word is in memory shared with the client, so the wait is not private.
+                if (const uint32_t word = entry->word->load(); word & entry->mask) {
+                    run(*entry);
+                    processed = true;
+                } else {
+                    waiters.push_back(makeWaiter(entry->word, word, 0 /* flags */));
+                }
+            }
+            // Input may have arrived for the effects checked before the processing, scan again.
+            if (processed) {
+                continue;
+            }
+            if (futexWaitv(waiters) < 0 && errno != EAGAIN && errno != EINTR) {
+                PLOG(ERROR) << mName << " futex_waitv failed";
+            }
+        }
+    }
+};
+
+std::shared_ptr<EffectWorkerPool> EffectWorkerPool::create(size_t workerCount, int priority) {
+    // An empty waiter list fails with EINVAL where futex_waitv is supported.
+    std::vector<futex_waitv> noWaiters;
+    if (futexWaitv(noWaiters) < 0 && errno == ENOSYS) {
+        LOG(WARNING) << __func__ << ": futex_waitv not supported";
+        return nullptr;
+    }
+    if (workerCount == 0) {
+        return nullptr;
+    }
+    LOG(INFO) << __func__ << ": " << workerCount << " workers";
+    return std::shared_ptr<EffectWorkerPool>(new EffectWorkerPool(workerCount, priority));
+}
+
+EffectWorkerPool::EffectWorkerPool(size_t workerCount, int priority) {
+    for (size_t i = 0; i < workerCount; i++) {
+        mWorkers.push_back(std::make_unique<Worker>("EffectWorker" + std::to_string(i), priority));
+    }
+}
+
+EffectWorkerPool::~EffectWorkerPool() {
+    std::lock_guard lg(mMutex);
+    if (auto count = mTaskWorkers.size()) {
+        LOG(WARNING) << __func__ << " remaining " << count << " effects not removed";
+    }
+}
+
+bool EffectWorkerPool::addTask(Task* task) {
+    std::lock_guard lg(mMutex);
+    if (mTaskWorkers.count(task)) {
+        return true;
+    }
+    // Keep a session on one worker, otherwise balance the number of effects.
+    const int groupId = task->getGroupId();
+    Worker* selected = nullptr;
+    size_t selectedCount = kMaxTasksPerWorker;
+    for (auto& worker : mWorkers) {
+        const size_t count = worker->getTaskCount();
+        if (count >= kMaxTasksPerWorker) {
+            continue;
+        }
+        if (worker->hasGroup(groupId)) {
+            selected = worker.get();
+            break;
+        }
+        if (count < selectedCount) {
+            selected = worker.get();
+            selectedCount = count;
+        }
+    }
+    if (!selected || !selected->add(task)) {
+        return false;
+    }
+    mTaskWorkers[task] = selected;
+    return true;
+}
+
+void EffectWorkerPool::removeTask(Task* task) {
+    Worker* worker = nullptr;
+    {
+        std::lock_guard lg(mMutex);
+        if (auto it = mTaskWorkers.find(task); it != mTaskWorkers.end()) {
+            worker = it->second;
+            mTaskWorkers.erase(it);
+        }
+    }
+    // Outside of mMutex, so that other effects can be added while the worker finishes a pass.
+    if (worker) {
+        worker->remove(task);
+    }
+}
+
+void EffectWorkerPool::startTask(Task* task) {
+    if (Worker* worker = getWorker(task)) {
+        worker->setStarted(task, true);
+    }
+}
+
+void EffectWorkerPool::stopTask(Task* task) {
+    if (Worker* worker = getWorker(task)) {
+        worker->setStarted(task, false);
+    }
+}
+
+void EffectWorkerPool::dump(int fd) {
+    std::string result = "EffectWorkerPool:\n";
+    for (auto& worker : mWorkers) {
+        result.append(worker->dump());
+    }
+    dprintf(fd, "%s", result.c_str());
+}
+
+EffectWorkerPool::Worker* EffectWorkerPool::getWorker(Task* task) {
+    std::lock_guard lg(mMutex);
+    auto it = mTaskWorkers.find(task);
+    return it != mTaskWorkers.end() ? it->second : nullptr;
+}
+
+}  // namespace aidl::android::hardware::audio::effect
@@ -21,6 +21,7 @@
 #include <aidl/android/media/audio/common/AudioInputFlags.h>
 #include <aidl/android/media/audio/common/AudioOutputFlags.h>
 #include <android-base/logging.h>
+#include <android-base/properties.h>
 #include <android/binder_ibinder_platform.h>
 #include <error/expected_utils.h>
 
@@ -178,7 +179,7 @@ ndk::ScopedAStatus Module::createStreamContext(
         return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
     }
     auto& configs = getConfig().portConfigs;
-    auto portConfigIt = findById<AudioPortConfig>(configs, in_portConfigId);
+    auto portConfigIt = mTopology.portConfigs.find(configs, in_portConfigId);
     const int32_t nominalLatencyMs = getNominalLatencyMs(*portConfigIt);
     // Since this is a private method, it is assumed that
     // validity of the portConfigId has already been checked.
@@ -243,7 +244,7 @@ std::vector<AudioDevice> Module::findConnectedDevices(int32_t portConfigId) {
     auto& ports = getConfig().ports;
     auto portIds = portIdsFromPortConfigIds(findConnectedPortConfigIds(portConfigId));
     for (auto it = portIds.begin(); it != portIds.end(); ++it) {
-        auto portIt = findById<AudioPort>(ports, *it);
+        auto portIt = mTopology.ports.find(ports, *it);
         if (portIt != ports.end() && portIt->ext.getTag() == AudioPortExt::Tag::device) {
             result.push_back(portIt->ext.template get<AudioPortExt::Tag::device>().device);
         }
@@ -256,7 +257,7 @@ std::set<int32_t> Module::findConnectedPortConfigIds(int32_t portConfigId) {
     auto patchIdsRange = mPatches.equal_range(portConfigId);
     auto& patches = getConfig().patches;
     for (auto it = patchIdsRange.first; it != patchIdsRange.second; ++it) {
-        auto patchIt = findById<AudioPatch>(patches, it->second);
+        auto patchIt = mTopology.patches.find(patches, it->second);
         if (patchIt == patches.end()) {
             LOG(FATAL) << __func__ << ": " << mType << ": patch with id " << it->second
                        << " taken from mPatches "
@@ -274,7 +275,7 @@ std::set<int32_t> Module::findConnectedPortConfigIds(int32_t portConfigId) {
 
 ndk::ScopedAStatus Module::findPortIdForNewStream(int32_t in_portConfigId, AudioPort** port) {
     auto& configs = getConfig().portConfigs;
-    auto portConfigIt = findById<AudioPortConfig>(configs, in_portConfigId);
+    auto portConfigIt = mTopology.portConfigs.find(configs, in_portConfigId);
     if (portConfigIt == configs.end()) {
         LOG(ERROR) << __func__ << ": " << mType << ": existing port config id " << in_portConfigId
                    << " not found";
@@ -284,7 +285,7 @@ ndk::ScopedAStatus Module::findPortIdForNewStream(int32_t in_portConfigId, Audio
     // In our implementation, configs of mix ports always have unique IDs.
     CHECK(portId != in_portConfigId);
     auto& ports = getConfig().ports;
-    auto portIt = findById<AudioPort>(ports, portId);
+    auto portIt = mTopology.ports.find(ports, portId);
     if (portIt == ports.end()) {
         LOG(ERROR) << __func__ << ": " << mType << ": port id " << portId
                    << " used by port config id " << in_portConfigId << " not found";
@@ -355,7 +356,7 @@ std::set<int32_t> Module::portIdsFromPortConfigIds(C portConfigIds) {
     std::set<int32_t> result;
     auto& portConfigs = getConfig().portConfigs;
     for (auto it = portConfigIds.begin(); it != portConfigIds.end(); ++it) {
-        auto portConfigIt = findById<AudioPortConfig>(portConfigs, *it);
+        auto portConfigIt = mTopology.portConfigs.find(portConfigs, *it);
         if (portConfigIt != portConfigs.end()) {
             result.insert(portConfigIt->portId);
         }
@@ -374,15 +375,7 @@ int32_t Module::getNominalLatencyMs(const AudioPortConfig&) {
 }
 
 std::vector<AudioRoute*> Module::getAudioRoutesForAudioPortImpl(int32_t portId) {
-    std::vector<AudioRoute*> result;
-    auto& routes = getConfig().routes;
-    for (auto& r : routes) {
-        const auto& srcs = r.sourcePortIds;
-        if (r.sinkPortId == portId || std::find(srcs.begin(), srcs.end(), portId) != srcs.end()) {
-            result.push_back(&r);
-        }
-    }
-    return result;
+    return mTopology.routes.getRoutes(getConfig().routes, portId);
 }
 
 Module::Configuration& Module::getConfig() {
@@ -414,7 +407,7 @@ void Module::registerPatch(const AudioPatch& patch) {
     auto& configs = getConfig().portConfigs;
     auto do_insert = [&](const std::vector<int32_t>& portConfigIds) {
         for (auto portConfigId : portConfigIds) {
-            auto configIt = findById<AudioPortConfig>(configs, portConfigId);
+            auto configIt = mTopology.portConfigs.find(configs, portConfigId);
             if (configIt != configs.end()) {
                 mPatches.insert(std::pair{portConfigId, patch.id});
                 if (configIt->portId != portConfigId) {
@@ -427,6 +420,30 @@ void Module::registerPatch(const AudioPatch& patch) {
     do_insert(patch.sinkPortConfigIds);
 }
 
+std::vector<AudioPortConfig*> Module::selectPortConfigsByIds(const std::vector<int32_t>& ids,
+                                                            std::vector<int32_t>* missingIds) {
+    // Same result as 'selectByIds': the configs are in the order of the configuration.
+    auto& configs = getConfig().portConfigs;
+    std::vector<size_t> positions;
+    std::vector<int32_t> missing;
+    for (int32_t id : std::set<int32_t>(ids.begin(), ids.end())) {
+        if (auto configIt = mTopology.portConfigs.find(configs, id); configIt != configs.end()) {
+            positions.push_back(configIt - configs.begin());
+        } else {
+            missing.push_back(id);
+        }
+    }
+    std::sort(positions.begin(), positions.end());
+    std::vector<AudioPortConfig*> result;
+    for (size_t position : positions) {
+        result.push_back(&configs[position]);
+    }
+    if (missingIds) {
+        *missingIds = std::move(missing);
+    }
+    return result;
+}
+
 ndk::ScopedAStatus Module::updateStreamsConnectedState(const AudioPatch& oldPatch,
                                                        const AudioPatch& newPatch) {
     // Notify streams about the new set of devices they are connected to.
@@ -561,7 +578,7 @@ ndk::ScopedAStatus Module::connectExternalDevice(const AudioPort& in_templateIdA
     auto& ports = getConfig().ports;
     AudioPort connectedPort;
     {  // Scope the template port so that we don't accidentally modify it.
-        auto templateIt = findById<AudioPort>(ports, templateId);
+        auto templateIt = mTopology.ports.find(ports, templateId);
         if (templateIt == ports.end()) {
             LOG(ERROR) << __func__ << ": " << mType << ": port id " << templateId << " not found";
             return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
@@ -594,7 +611,7 @@ ndk::ScopedAStatus Module::connectExternalDevice(const AudioPort& in_templateIdA
         // Check if there is already a connected port with for the same external device.
 
         for (auto connectedPortPair : mConnectedDevicePorts) {
-            auto connectedPortIt = findById<AudioPort>(ports, connectedPortPair.first);
+            auto connectedPortIt = mTopology.ports.find(ports, connectedPortPair.first);
             if (connectedPortIt->ext.get<AudioPortExt::Tag::device>().device ==
                 connectedDevicePort.device) {
                 LOG(ERROR) << __func__ << ": " << mType << ": device "
@@ -644,12 +661,15 @@ ndk::ScopedAStatus Module::connectExternalDevice(const AudioPort& in_templateIdA
     }
     if (hasDynamicProfilesOnly(connectedPort.profiles)) {
         // Possible case 2. Check if all routable mix ports have static profiles.
-        if (auto dynamicMixPortIt = std::find_if(ports.begin(), ports.end(),
-                                                 [&routableMixPortIds](const auto& p) {
-                                                     return routableMixPortIds.count(p.id) > 0 &&
-                                                            hasDynamicProfilesOnly(p.profiles);
-                                                 });
-            dynamicMixPortIt != ports.end()) {
+        // Report the first such port in the order of the configuration.
+        auto dynamicMixPortIt = ports.end();
+        for (int32_t mixPortId : routableMixPortIds) {
+            if (auto portIt = mTopology.ports.find(ports, mixPortId);
+                portIt < dynamicMixPortIt && hasDynamicProfilesOnly(portIt->profiles)) {
+                dynamicMixPortIt = portIt;
+            }
+        }
+        if (dynamicMixPortIt != ports.end()) {
             LOG(ERROR) << __func__ << ": " << mType
                        << ": connected port only has dynamic profiles after connecting "
                        << "external device " << connectedPort.toString() << ", and there exist "
@@ -666,10 +686,12 @@ ndk::ScopedAStatus Module::connectExternalDevice(const AudioPort& in_templateIdA
                << " external device connected, "
                << "connected port ID " << connectedPort.id;
     ports.push_back(connectedPort);
+    mTopology.ports.onAppended(ports);
     onExternalDeviceConnectionChanged(connectedPort, true /*connected*/);
 
     // For routes where the template port is a source, add the connected port to sources,
     // otherwise, create a new route by copying from the route for the template port.
+    auto& routes = getConfig().routes;
     std::vector<AudioRoute> newRoutes;
     for (AudioRoute* r : routesToMixPorts) {
         if (r->sinkPortId == templateId) {
@@ -678,17 +700,22 @@ ndk::ScopedAStatus Module::connectExternalDevice(const AudioPort& in_templateIdA
                                            .isExclusive = r->isExclusive});
         } else {
             r->sourcePortIds.push_back(connectedPort.id);
+            mTopology.routes.onSourceAppended(routes, r - routes.data(), connectedPort.id);
         }
     }
-    auto& routes = getConfig().routes;
-    routes.insert(routes.end(), newRoutes.begin(), newRoutes.end());
+    for (auto& newRoute : newRoutes) {
+        routes.push_back(std::move(newRoute));
+        mTopology.routes.onAppended(routes);
+    }
 
     if (!hasDynamicProfilesOnly(connectedPort.profiles) && !routableMixPortIds.empty()) {
         // Note: this is a simplistic approach assuming that a mix port can only be populated
         // from a single device port. Implementing support for stuffing dynamic profiles with
         // a superset of all profiles from all routable dynamic device ports would be more involved.
-        for (auto& port : ports) {
-            if (routableMixPortIds.count(port.id) == 0) continue;
+        for (int32_t mixPortId : routableMixPortIds) {
+            auto portIt = mTopology.ports.find(ports, mixPortId);
+            if (portIt == ports.end()) continue;
+            auto& port = *portIt;
             if (hasDynamicProfilesOnly(port.profiles)) {
                 port.profiles = connectedPort.profiles;
                 connectedPortsIt->second.insert(port.id);
@@ -711,7 +738,7 @@ ndk::ScopedAStatus Module::connectExternalDevice(const AudioPort& in_templateIdA
 
 ndk::ScopedAStatus Module::disconnectExternalDevice(int32_t in_portId) {
     auto& ports = getConfig().ports;
-    auto portIt = findById<AudioPort>(ports, in_portId);
+    auto portIt = mTopology.ports.find(ports, in_portId);
     if (portIt == ports.end()) {
         LOG(ERROR) << __func__ << ": " << mType << ": port id " << in_portId << " not found";
         return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
@@ -732,7 +759,7 @@ ndk::ScopedAStatus Module::disconnectExternalDevice(int32_t in_portId) {
     auto configIt = std::find_if(configs.begin(), configs.end(), [&](const auto& config) {
         if (config.portId == in_portId) {
             // Check if the configuration was provided by the client.
-            const auto& initialIt = findById<AudioPortConfig>(initials, config.id);
+            const auto& initialIt = mTopology.initialConfigs.find(initials, config.id);
             return initialIt == initials.end() || config != *initialIt;
         }
         return false;
@@ -744,6 +771,7 @@ ndk::ScopedAStatus Module::disconnectExternalDevice(int32_t in_portId) {
     }
     onExternalDeviceConnectionChanged(*portIt, false /*connected*/);
     ports.erase(portIt);
+    mTopology.ports.invalidate();
     LOG(DEBUG) << __func__ << ": " << mType << ": connected device port " << in_portId
                << " released";
 
@@ -758,6 +786,7 @@ ndk::ScopedAStatus Module::disconnectExternalDevice(int32_t in_portId) {
             ++routesIt;
         }
     }
+    mTopology.routes.invalidate();
 
     // Clear profiles for mix ports that are not connected to any other ports.
     std::set<int32_t> mixPortsToClear = std::move(connectedPortsIt->second);
@@ -768,7 +797,7 @@ ndk::ScopedAStatus Module::disconnectExternalDevice(int32_t in_portId) {
         }
     }
     for (int32_t mixPortId : mixPortsToClear) {
-        auto mixPortIt = findById<AudioPort>(ports, mixPortId);
+        auto mixPortIt = mTopology.ports.find(ports, mixPortId);
         if (mixPortIt != ports.end()) {
             mixPortIt->profiles = {};
         }
@@ -779,7 +808,7 @@ ndk::ScopedAStatus Module::disconnectExternalDevice(int32_t in_portId) {
 
 ndk::ScopedAStatus Module::prepareToDisconnectExternalDevice(int32_t in_portId) {
     auto& ports = getConfig().ports;
-    auto portIt = findById<AudioPort>(ports, in_portId);
+    auto portIt = mTopology.ports.find(ports, in_portId);
     if (portIt == ports.end()) {
         LOG(ERROR) << __func__ << ": " << mType << ": port id " << in_portId << " not found";
         return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
@@ -809,7 +838,7 @@ ndk::ScopedAStatus Module::getAudioPatches(std::vector<AudioPatch>* _aidl_return
 
 ndk::ScopedAStatus Module::getAudioPort(int32_t in_portId, AudioPort* _aidl_return) {
     auto& ports = getConfig().ports;
-    auto portIt = findById<AudioPort>(ports, in_portId);
+    auto portIt = mTopology.ports.find(ports, in_portId);
     if (portIt != ports.end()) {
         *_aidl_return = *portIt;
         LOG(DEBUG) << __func__ << ": " << mType << ": returning port by id " << in_portId;
@@ -841,7 +870,7 @@ ndk::ScopedAStatus Module::getAudioRoutes(std::vector<AudioRoute>* _aidl_return)
 ndk::ScopedAStatus Module::getAudioRoutesForAudioPort(int32_t in_portId,
                                                       std::vector<AudioRoute>* _aidl_return) {
     auto& ports = getConfig().ports;
-    if (auto portIt = findById<AudioPort>(ports, in_portId); portIt == ports.end()) {
+    if (auto portIt = mTopology.ports.find(ports, in_portId); portIt == ports.end()) {
         LOG(ERROR) << __func__ << ": " << mType << ": port id " << in_portId << " not found";
         return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
     }
@@ -957,16 +986,14 @@ ndk::ScopedAStatus Module::setAudioPatch(const AudioPatch& in_requested, AudioPa
         return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
     }
 
-    auto& configs = getConfig().portConfigs;
     std::vector<int32_t> missingIds;
-    auto sources =
-            selectByIds<AudioPortConfig>(configs, in_requested.sourcePortConfigIds, &missingIds);
+    auto sources = selectPortConfigsByIds(in_requested.sourcePortConfigIds, &missingIds);
     if (!missingIds.empty()) {
         LOG(ERROR) << __func__ << ": " << mType << ": following source port config ids not found: "
                    << ::android::internal::ToString(missingIds);
         return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
     }
-    auto sinks = selectByIds<AudioPortConfig>(configs, in_requested.sinkPortConfigIds, &missingIds);
+    auto sinks = selectPortConfigsByIds(in_requested.sinkPortConfigIds, &missingIds);
     if (!missingIds.empty()) {
         LOG(ERROR) << __func__ << ": " << mType << ": following sink port config ids not found: "
                    << ::android::internal::ToString(missingIds);
@@ -978,12 +1005,10 @@ ndk::ScopedAStatus Module::setAudioPatch(const AudioPatch& in_requested, AudioPa
     std::map<int32_t, bool> allowedSinkPorts;
     auto& routes = getConfig().routes;
     for (auto src : sources) {
-        for (const auto& r : routes) {
-            const auto& srcs = r.sourcePortIds;
-            if (std::find(srcs.begin(), srcs.end(), src->portId) != srcs.end()) {
-                if (!allowedSinkPorts[r.sinkPortId]) {  // prefer non-exclusive
-                    allowedSinkPorts[r.sinkPortId] = !r.isExclusive;
-                }
+        for (size_t routeIndex : mTopology.routes.getRoutesFromSource(routes, src->portId)) {
+            const auto& r = routes[routeIndex];
+            if (!allowedSinkPorts[r.sinkPortId]) {  // prefer non-exclusive
+                allowedSinkPorts[r.sinkPortId] = !r.isExclusive;
             }
         }
     }
@@ -1000,7 +1025,7 @@ ndk::ScopedAStatus Module::setAudioPatch(const AudioPatch& in_requested, AudioPa
     auto existing = patches.end();
     std::optional<decltype(mPatches)> patchesBackup;
     if (in_requested.id != 0) {
-        existing = findById<AudioPatch>(patches, in_requested.id);
+        existing = mTopology.patches.find(patches, in_requested.id);
         if (existing != patches.end()) {
             patchesBackup = mPatches;
             cleanUpPatch(existing->id);
@@ -1040,6 +1065,7 @@ ndk::ScopedAStatus Module::setAudioPatch(const AudioPatch& in_requested, AudioPa
     if (existing == patches.end()) {
         _aidl_return->id = getConfig().nextPatchId++;
         patches.push_back(*_aidl_return);
+        mTopology.patches.onAppended(patches);
     } else {
         oldPatch = *existing;
         *existing = *_aidl_return;
@@ -1050,6 +1076,7 @@ ndk::ScopedAStatus Module::setAudioPatch(const AudioPatch& in_requested, AudioPa
         mPatches = std::move(*patchesBackup);
         if (existing == patches.end()) {
             patches.pop_back();
+            mTopology.patches.invalidate();
         } else {
             *existing = oldPatch;
         }
@@ -1079,7 +1106,7 @@ ndk::ScopedAStatus Module::setAudioPortConfigImpl(
     auto& configs = getConfig().portConfigs;
     auto existing = configs.end();
     if (in_requested.id != 0) {
-        if (existing = findById<AudioPortConfig>(configs, in_requested.id);
+        if (existing = mTopology.portConfigs.find(configs, in_requested.id);
             existing == configs.end()) {
             LOG(ERROR) << __func__ << ": " << mType << ": existing port config id "
                        << in_requested.id << " not found";
@@ -1094,7 +1121,7 @@ ndk::ScopedAStatus Module::setAudioPortConfigImpl(
         return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
     }
     auto& ports = getConfig().ports;
-    auto portIt = findById<AudioPort>(ports, portId);
+    auto portIt = mTopology.ports.find(ports, portId);
     if (portIt == ports.end()) {
         LOG(ERROR) << __func__ << ": " << mType
                    << ": requested port config points to non-existent portId " << portId;
@@ -1215,6 +1242,7 @@ ndk::ScopedAStatus Module::setAudioPortConfigImpl(
     if (existing == configs.end() && requestedIsValid && requestedIsFullySpecified) {
         out_suggested->id = getConfig().nextPortId++;
         configs.push_back(*out_suggested);
+        mTopology.portConfigs.onAppended(configs);
         *applied = true;
         LOG(DEBUG) << __func__ << ": " << mType << ": created new port config "
                    << out_suggested->toString();
@@ -1234,7 +1262,7 @@ ndk::ScopedAStatus Module::setAudioPortConfigImpl(
 
 ndk::ScopedAStatus Module::resetAudioPatch(int32_t in_patchId) {
     auto& patches = getConfig().patches;
-    auto patchIt = findById<AudioPatch>(patches, in_patchId);
+    auto patchIt = mTopology.patches.find(patches, in_patchId);
     if (patchIt != patches.end()) {
         auto patchesBackup = mPatches;
         cleanUpPatch(patchIt->id);
@@ -1243,6 +1271,7 @@ ndk::ScopedAStatus Module::resetAudioPatch(int32_t in_patchId) {
             return status;
         }
         patches.erase(patchIt);
+        mTopology.patches.invalidate();
         LOG(DEBUG) << __func__ << ": " << mType << ": erased patch " << in_patchId;
         return ndk::ScopedAStatus::ok();
     }
@@ -1252,7 +1281,7 @@ ndk::ScopedAStatus Module::resetAudioPatch(int32_t in_patchId) {
 
 ndk::ScopedAStatus Module::resetAudioPortConfig(int32_t in_portConfigId) {
     auto& configs = getConfig().portConfigs;
-    auto configIt = findById<AudioPortConfig>(configs, in_portConfigId);
+    auto configIt = mTopology.portConfigs.find(configs, in_portConfigId);
     if (configIt != configs.end()) {
         if (mStreams.count(in_portConfigId) != 0) {
             LOG(ERROR) << __func__ << ": " << mType << ": port config id " << in_portConfigId
@@ -1266,9 +1295,10 @@ ndk::ScopedAStatus Module::resetAudioPortConfig(int32_t in_portConfigId) {
             return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_STATE);
         }
         auto& initials = getConfig().initialConfigs;
-        auto initialIt = findById<AudioPortConfig>(initials, in_portConfigId);
+        auto initialIt = mTopology.initialConfigs.find(initials, in_portConfigId);
         if (initialIt == initials.end()) {
             configs.erase(configIt);
+            mTopology.portConfigs.invalidate();
             LOG(DEBUG) << __func__ << ": " << mType << ": erased port config " << in_portConfigId;
         } else if (*configIt != *initialIt) {
             *configIt = *initialIt;
@@ -1368,7 +1398,10 @@ ndk::ScopedAStatus Module::updateScreenState(bool in_isTurnedOn) {
 
 ndk::ScopedAStatus Module::getSoundDose(std::shared_ptr<ISoundDose>* _aidl_return) {
     if (!mSoundDose) {
-        mSoundDose = ndk::SharedRefBase::make<sounddose::SoundDose>();
+        // Moves the MEL computation off the stream writer threads.
+        static const bool kDeferredProcessing = ::android::base::GetBoolProperty(
+                "ro.vendor.audio.sounddose.deferred_processing", false);
+        mSoundDose = ndk::SharedRefBase::make<sounddose::SoundDose>(kDeferredProcessing);
     }
     *_aidl_return = mSoundDose.getInstance();
     LOG(DEBUG) << __func__ << ": " << mType
@@ -1501,7 +1534,7 @@ ndk::ScopedAStatus Module::getMmapPolicyInfos(AudioMMapPolicyType mmapPolicyType
         if (mmapSinks.count(route.sinkPortId) != 0) {
             // The sink is a mix port, add the sources if they are device ports.
             for (int sourcePortId : route.sourcePortIds) {
-                auto sourcePortIt = findById<AudioPort>(ports, sourcePortId);
+                auto sourcePortIt = mTopology.ports.find(ports, sourcePortId);
                 if (sourcePortIt == ports.end()) {
                     // This must not happen
                     LOG(ERROR) << __func__ << ": " << mType << ": port id " << sourcePortId
@@ -1520,7 +1553,7 @@ ndk::ScopedAStatus Module::getMmapPolicyInfos(AudioMMapPolicyType mmapPolicyType
                 _aidl_return->push_back(policyInfo);
             }
         } else {
-            auto sinkPortIt = findById<AudioPort>(ports, route.sinkPortId);
+            auto sinkPortIt = mTopology.ports.find(ports, route.sinkPortId);
             if (sinkPortIt == ports.end()) {
                 // This must not happen
                 LOG(ERROR) << __func__ << ": " << mType << ": port id " << route.sinkPortId
@@ -18,9 +18,15 @@
 
 #include "core-impl/SoundDose.h"
 
+#include <pthread.h>
+#include <sys/resource.h>
+
 #include <aidl/android/hardware/audio/core/sounddose/ISoundDose.h>
 #include <android-base/logging.h>
+#include <android-base/thread_annotations.h>
 #include <media/AidlConversionCppNdk.h>
+#include <system/audio.h>
+#include <system/thread_defs.h>
 #include <utils/Timers.h>
 
 using aidl::android::hardware::audio::core::sounddose::ISoundDose;
@@ -30,6 +36,17 @@ using aidl::android::media::audio::common::AudioFormatDescription;
 
 namespace aidl::android::hardware::audio::core::sounddose {
 
+SoundDose::~SoundDose() {
+    if (mWorker.joinable()) {
+        {
+            std::lock_guard lg(mWorkerMutex);
+            mWorkerExit = true;
+        }
+        mWorkerCv.notify_one();
+        mWorker.join();
+    }
+}
+
 ndk::ScopedAStatus SoundDose::setOutputRs2UpperBound(float in_rs2ValueDbA) {
     if (in_rs2ValueDbA < MIN_RS2 || in_rs2ValueDbA > DEFAULT_MAX_RS2) {
         LOG(ERROR) << __func__ << ": RS2 value is invalid: " << in_rs2ValueDbA;
@@ -81,6 +98,12 @@ void SoundDose::startDataProcessor(uint32_t sampleRate, uint32_t channelCount,
     const auto result = aidl2legacy_AudioFormatDescription_audio_format_t(aidlFormat);
     const audio_format_t format = result.value_or(AUDIO_FORMAT_INVALID);
 
+    if (mDeferredProcessing) {
+        // Keep the writers out while the data in the previous format is processed and the ring
+        // is resized. The worker is kept out by mMutex.
+        lockProducer();
+        if (mMelProcessor != nullptr) processRingLocked();
+    }
     if (mMelProcessor == nullptr) {
         // we don't have the deviceId concept on the vendor side so just pass 0
         mMelProcessor = ::android::sp<::android::audio_utils::MelProcessor>::make(
@@ -88,18 +111,127 @@ void SoundDose::startDataProcessor(uint32_t sampleRate, uint32_t channelCount,
     } else {
         mMelProcessor->updateAudioFormat(sampleRate, channelCount, format);
     }
+    if (mDeferredProcessing) {
+        mFrameSize = channelCount * audio_bytes_per_sample(format);
+        const size_t ringSize =
+                static_cast<size_t>(sampleRate) * mFrameSize * kRingDurationMs / 1000;
+        if (ringSize > mRing.capacity()) {
+            mRing.reset(ringSize);
+            mProcessBuffer.resize(mRing.capacity());
+        }
+        unlockProducer();
+        if (!mWorker.joinable()) {
+            mWorker = std::thread(&SoundDose::workerLoop, this);
+        }
+    }
 }
 
 void SoundDose::process(const void* buffer, size_t bytes) {
+    if (mDeferredProcessing) {
+        // Called on the stream writer thread, must not block.
+        if (mProducerBusy.test_and_set(std::memory_order_acquire)) {
+            mDroppedBytes.fetch_add(bytes, std::memory_order_relaxed);
+            return;
+        }
+        if (mRing.capacity() > 0 && !mRing.write(buffer, bytes)) {
+            mDroppedBytes.fetch_add(bytes, std::memory_order_relaxed);
+        }
+        unlockProducer();
+        return;
+    }
     ::android::audio_utils::lock_guard l(mMutex);
     if (mMelProcessor != nullptr) {
         mMelProcessor->process(buffer, bytes);
     }
 }
 
+void SoundDose::lockProducer() {
+    while (mProducerBusy.test_and_set(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+}
+
+void SoundDose::processRingLocked() {
+    // The writes are whole frames, so are the reads of a multiple of the frame size.
+    const size_t maxBytes = mFrameSize > 0 ? mProcessBuffer.size() / mFrameSize * mFrameSize : 0;
+    while (maxBytes > 0) {
+        const size_t bytes = mRing.read(mProcessBuffer.data(), maxBytes);
+        if (bytes == 0) break;
+        mMelProcessor->process(mProcessBuffer.data(), bytes);
+    }
+    if (const uint64_t dropped = mDroppedBytes.load(std::memory_order_relaxed);
+        dropped != mReportedDroppedBytes) {
+        LOG(WARNING) << __func__ << ": " << dropped - mReportedDroppedBytes
+                     << " bytes of audio data were not processed";
+        mReportedDroppedBytes = dropped;
+    }
+}
+
+void SoundDose::workerLoop() {
+    pthread_setname_np(pthread_self(), "SoundDoseWorker");
+    setpriority(PRIO_PROCESS, 0, ANDROID_PRIORITY_BACKGROUND);
+    while (true) {
+        {
+            std::unique_lock l(mWorkerMutex);
+            ::android::base::ScopedLockAssertion lock_assertion(mWorkerMutex);
+            if (mWorkerCv.wait_for(l, kWorkerPeriod,
+                                   [&]() REQUIRES(mWorkerMutex) { return mWorkerExit; })) {
+                break;
+            }
+        }
+        {
+            ::android::audio_utils::lock_guard l(mMutex);
+            processRingLocked();
+        }
+        ::android::audio_utils::lock_guard l(mCbMutex);
+        if (!mMelBatch.melValues.empty() &&
+            nanoseconds_to_seconds(systemTime()) - mMelBatch.timestamp >= kMaxMelBatchDelaySec) {
+            flushMelBatchLocked();
+        }
+    }
+    ::android::audio_utils::lock_guard l(mCbMutex);
+    flushMelBatchLocked();
+}
+
+bool SoundDose::canSendCallbackLocked(const char* caller) const {
+    if (!mAudioDevice.has_value()) {
+        LOG(WARNING) << caller << ": without a registered device";
+        return false;
+    }
+    if (mCallback == nullptr) {
+        LOG(ERROR) << caller << ": without a registered callback";
+        return false;
+    }
+    return true;
+}
+
+void SoundDose::flushMelBatchLocked() const {
+    if (mMelBatch.melValues.empty()) return;
+    if (canSendCallbackLocked(__func__)) {
+        mCallback->onNewMelValues(mMelBatch, mAudioDevice.value());
+    }
+    mMelBatch.melValues.clear();
+}
+
 void SoundDose::onNewMelValues(const std::vector<float>& mels, size_t offset, size_t length,
                                audio_port_handle_t deviceId __attribute__((__unused__))) const {
     ::android::audio_utils::lock_guard l(mCbMutex);
+    if (mDeferredProcessing) {
+        // The values of a record are for consecutive seconds starting at the timestamp, so
+        // a gap in the values starts a new record.
+        const int64_t now = nanoseconds_to_seconds(systemTime());
+        if (!mMelBatch.melValues.empty() &&
+            now - mMelBatch.timestamp - static_cast<int64_t>(mMelBatch.melValues.size()) > 1) {
+            flushMelBatchLocked();
+        }
+        mMelBatch.melValues.reserve(kMaxMelBatchSize);
+        for (size_t i = offset; i < offset + length; ++i) {
+            if (mMelBatch.melValues.empty()) mMelBatch.timestamp = now;
+            mMelBatch.melValues.push_back(mels[i]);
+            if (mMelBatch.melValues.size() >= kMaxMelBatchSize) flushMelBatchLocked();
+        }
+        return;
+    }
     if (!mAudioDevice.has_value()) {
         LOG(WARNING) << __func__ << ": New mel values without a registered device";
         return;
@@ -46,6 +46,22 @@ using aidl::android::media::audio::common::MicrophoneInfo;
 
 namespace aidl::android::hardware::audio::core {
 
+namespace {
+// Calls 'func' for each contiguous part of the first 'byteCount' bytes of the MQ transaction.
+// The iteration stops when 'func' returns false.
+template <typename Func>
+void forEachRegion(const StreamContext::DataMQ::MemTransaction& transaction, size_t byteCount,
+                   Func func) {
+    for (const auto* region : {&transaction.getFirstRegion(), &transaction.getSecondRegion()}) {
+        if (byteCount == 0) return;
+        const size_t regionByteCount = std::min(byteCount, region->getLengthInBytes());
+        if (regionByteCount == 0) continue;
+        if (!func(region->getAddress(), regionByteCount)) return;
+        byteCount -= regionByteCount;
+    }
+}
+}  // namespace
+
 void StreamContext::fillDescriptor(StreamDescriptor* desc) {
     if (mCommandMQ) {
         desc->command = mCommandMQ->dupeDesc();
@@ -131,9 +147,36 @@ std::string StreamWorkerCommonLogic::init() {
     if (::android::status_t status = mDriver->init(); status != STATUS_OK) {
         return "Failed to initialize the driver: " + std::to_string(status);
     }
+    mIsInPlaceTransferSupported = mDriver->isInPlaceTransferSupported();
     return "";
 }
 
+bool StreamWorkerCommonLogic::canTransferInPlace(
+        const StreamContext::DataMQ::MemTransaction& transaction, size_t byteCount) const {
+    if (!mIsInPlaceTransferSupported) return false;
+    // If the data wraps around, the first region must end on a frame boundary.
+    const size_t firstRegionByteCount = transaction.getFirstRegion().getLengthInBytes();
+    return byteCount <= firstRegionByteCount ||
+           firstRegionByteCount % mContext->getFrameSize() == 0;
+}
+
+::android::status_t StreamWorkerCommonLogic::transferInPlace(
+        const StreamContext::DataMQ::MemTransaction& transaction, size_t frameCount,
+        size_t* actualFrameCount, int32_t* latencyMs) {
+    const size_t frameSize = mContext->getFrameSize();
+    ::android::status_t status = ::android::OK;
+    *actualFrameCount = 0;
+    forEachRegion(transaction, frameCount * frameSize, [&](int8_t* buffer, size_t byteCount) {
+        const size_t regionFrameCount = byteCount / frameSize;
+        size_t regionActualFrameCount = 0;
+        status = mDriver->transfer(buffer, regionFrameCount, &regionActualFrameCount, latencyMs);
+        *actualFrameCount += regionActualFrameCount;
+        // After a short transfer the second region would not be contiguous with the data.
+        return status == ::android::OK && regionActualFrameCount == regionFrameCount;
+    });
+    return status;
+}
+
 void StreamWorkerCommonLogic::populateReply(StreamDescriptor::Reply* reply,
                                             bool isConnected) const {
     reply->status = STATUS_OK;
@@ -327,21 +370,41 @@ bool StreamInWorkerLogic::read(size_t clientSize, StreamDescriptor::Reply* reply
     size_t actualFrameCount = 0;
     bool fatal = false;
     int32_t latency = mContext->getNominalLatencyMs();
+    // When possible, the driver writes directly into the MQ, otherwise into 'mDataBuffer'
+    // which is then copied into the MQ.
+    StreamContext::DataMQ::MemTransaction transaction;
+    const bool inPlace = mIsInPlaceTransferSupported && byteCount > 0 &&
+                         dataMQ->beginWrite(byteCount, &transaction) &&
+                         canTransferInPlace(transaction, byteCount);
     if (isConnected) {
-        if (::android::status_t status = mDriver->transfer(mDataBuffer.get(), byteCount / frameSize,
-                                                           &actualFrameCount, &latency);
+        if (::android::status_t status =
+                    inPlace ? transferInPlace(transaction, byteCount / frameSize,
+                                              &actualFrameCount, &latency)
+                            : mDriver->transfer(mDataBuffer.get(), byteCount / frameSize,
+                                                &actualFrameCount, &latency);
             status != ::android::OK) {
             fatal = true;
             LOG(ERROR) << __func__ << ": read failed: " << status;
         }
     } else {
         usleep(3000);  // Simulate blocking transfer delay.
-        for (size_t i = 0; i < byteCount; ++i) mDataBuffer[i] = 0;
+        if (inPlace) {
+            forEachRegion(transaction, byteCount, [](int8_t* buffer, size_t regionByteCount) {
+                memset(buffer, 0, regionByteCount);
+                return true;
+            });
+        } else {
+            for (size_t i = 0; i < byteCount; ++i) mDataBuffer[i] = 0;
+        }
         actualFrameCount = byteCount / frameSize;
     }
     const size_t actualByteCount = actualFrameCount * frameSize;
-    if (bool success = actualByteCount > 0 ? dataMQ->write(&mDataBuffer[0], actualByteCount) : true;
-        success) {
+    bool success = true;
+    if (actualByteCount > 0) {
+        success = inPlace ? dataMQ->commitWrite(actualByteCount)
+                          : dataMQ->write(&mDataBuffer[0], actualByteCount);
+    }
+    if (success) {
         LOG(VERBOSE) << __func__ << ": writing of " << actualByteCount << " bytes into data MQ"
                      << " succeeded; connected? " << isConnected;
         // Frames are provided and counted regardless of connection status.
@@ -602,7 +665,13 @@ bool StreamOutWorkerLogic::write(size_t clientSize, StreamDescriptor::Reply* rep
     const size_t frameSize = mContext->getFrameSize();
     bool fatal = false;
     int32_t latency = mContext->getNominalLatencyMs();
-    if (readByteCount > 0 ? dataMQ->read(&mDataBuffer[0], readByteCount) : true) {
+    // When possible, the driver reads directly from the MQ, and the data is only consumed after
+    // the transfer. Otherwise, the data is copied into 'mDataBuffer' first.
+    StreamContext::DataMQ::MemTransaction transaction;
+    const bool inPlace = mIsInPlaceTransferSupported && readByteCount > 0 &&
+                         dataMQ->beginRead(readByteCount, &transaction) &&
+                         canTransferInPlace(transaction, readByteCount);
+    if (inPlace || (readByteCount > 0 ? dataMQ->read(&mDataBuffer[0], readByteCount) : true)) {
         const bool isConnected = mIsConnected;
         LOG(VERBOSE) << __func__ << ": reading of " << readByteCount << " bytes from data MQ"
                      << " succeeded; connected? " << isConnected;
@@ -615,15 +684,26 @@ bool StreamOutWorkerLogic::write(size_t clientSize, StreamDescriptor::Reply* rep
         }
         size_t actualFrameCount = 0;
         if (isConnected) {
-            if (::android::status_t status = mDriver->transfer(
-                        mDataBuffer.get(), byteCount / frameSize, &actualFrameCount, &latency);
+            if (::android::status_t status =
+                        inPlace ? transferInPlace(transaction, byteCount / frameSize,
+                                                  &actualFrameCount, &latency)
+                                : mDriver->transfer(mDataBuffer.get(), byteCount / frameSize,
+                                                    &actualFrameCount, &latency);
                 status != ::android::OK) {
                 fatal = true;
                 LOG(ERROR) << __func__ << ": write failed: " << status;
             }
             auto streamDataProcessor = mContext->getStreamDataProcessor().lock();
             if (streamDataProcessor != nullptr) {
-                streamDataProcessor->process(mDataBuffer.get(), actualFrameCount * frameSize);
+                if (inPlace) {
+                    forEachRegion(transaction, actualFrameCount * frameSize,
+                                  [&](int8_t* buffer, size_t regionByteCount) {
+                                      streamDataProcessor->process(buffer, regionByteCount);
+                                      return true;
+                                  });
+                } else {
+                    streamDataProcessor->process(mDataBuffer.get(), actualFrameCount * frameSize);
+                }
             }
         } else {
             if (mContext->getAsyncCallback() == nullptr) {
@@ -631,6 +711,12 @@ bool StreamOutWorkerLogic::write(size_t clientSize, StreamDescriptor::Reply* rep
             }
             actualFrameCount = byteCount / frameSize;
         }
+        // Same as with copying, all the data available in the MQ is consumed.
+        if (inPlace && !dataMQ->commitRead(readByteCount)) {
+            LOG(ERROR) << __func__ << ": committing the read of " << readByteCount
+                       << " bytes from data MQ failed";
+            fatal = true;
+        }
         const size_t actualByteCount = actualFrameCount * frameSize;
         // Frames are consumed and counted regardless of the connection status.
         reply->fmqByteCount += actualByteCount;
@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "core-impl/Module.h"
+
+using aidl::android::hardware::audio::core::AudioPatch;
+using aidl::android::hardware::audio::core::AudioRoute;
+using aidl::android::hardware::audio::core::IModule;
+using aidl::android::hardware::audio::core::Module;
+using aidl::android::hardware::audio::core::ModuleDebug;
+using aidl::android::media::audio::common::AudioChannelLayout;
+using aidl::android::media::audio::common::AudioDeviceDescription;
+using aidl::android::media::audio::common::AudioDeviceType;
+using aidl::android::media::audio::common::AudioFormatDescription;
+using aidl::android::media::audio::common::AudioFormatType;
+using aidl::android::media::audio::common::AudioIoFlags;
+using aidl::android::media::audio::common::AudioPort;
+using aidl::android::media::audio::common::AudioPortConfig;
+using aidl::android::media::audio::common::AudioPortDeviceExt;
+using aidl::android::media::audio::common::AudioPortExt;
+using aidl::android::media::audio::common::AudioPortMixExt;
+using aidl::android::media::audio::common::AudioProfile;
+using aidl::android::media::audio::common::Int;
+using aidl::android::media::audio::common::PcmType;
+
+namespace {
+
+// 200 ports: for each direction, 50 mix ports, 25 attached device ports and 25 templates of
+// external device ports. Every mix port is routable to every device port of the same direction.
+constexpr int kPortsPerKind = 25;
+constexpr int kMixPortsPerDirection = 2 * kPortsPerKind;
+constexpr int32_t kSampleRate = 48000;
+
+AudioProfile createProfile() {
+    AudioProfile profile;
+    profile.format = AudioFormatDescription{.type = AudioFormatType::PCM,
+                                            .pcm = PcmType::INT_16_BIT};
+    profile.channelMasks.push_back(AudioChannelLayout::make<AudioChannelLayout::layoutMask>(
+            AudioChannelLayout::LAYOUT_STEREO));
+    profile.sampleRates.push_back(kSampleRate);
+    return profile;
+}
+
+AudioIoFlags createFlags(bool isInput) {
+    return isInput ? AudioIoFlags::make<AudioIoFlags::Tag::input>(0)
+                   : AudioIoFlags::make<AudioIoFlags::Tag::output>(0);
+}
+
+AudioPort createPort(int32_t id, const std::string& name, bool isInput, const AudioPortExt& ext) {
+    AudioPort port;
+    port.id = id;
+    port.name = name;
+    port.profiles.push_back(createProfile());
+    port.flags = createFlags(isInput);
+    port.ext = ext;
+    return port;
+}
+
+AudioPortExt createDeviceExt(bool isInput, const std::string& connection) {
+    AudioPortDeviceExt deviceExt;
+    deviceExt.device.type.type = isInput ? AudioDeviceType::IN_DEVICE : AudioDeviceType::OUT_DEVICE;
+    deviceExt.device.type.connection = connection;
+    return AudioPortExt::make<AudioPortExt::Tag::device>(deviceExt);
+}
+
+AudioPortConfig createPortConfig(int32_t id, const AudioPort& port) {
+    AudioPortConfig config;
+    config.id = id;
+    config.portId = port.id;
+    config.format = port.profiles[0].format;
+    config.channelMask = port.profiles[0].channelMasks[0];
+    config.sampleRate = Int{.value = kSampleRate};
+    config.flags = port.flags;
+    config.ext = port.ext;
+    return config;
+}
+
+struct Topology {
+    std::vector<int32_t> externalDevicePortIds;
+    std::vector<int32_t> mixPortIds;
+    // Mix port configs of the output direction and attached output device port configs.
+    std::vector<int32_t> sourceConfigIds;
+    std::vector<int32_t> sinkConfigIds;
+};
+
+std::unique_ptr<Module::Configuration> createConfiguration(Topology* topology) {
+    auto c = std::make_unique<Module::Configuration>();
+    for (bool isInput : {false, true}) {
+        const std::string direction = isInput ? "in " : "out ";
+        std::vector<int32_t> mixPortIds, devicePortIds;
+        for (int i = 0; i < kMixPortsPerDirection; ++i) {
+            AudioPortMixExt mixExt;
+            mixExt.handle = c->nextPortId;
+            c->ports.push_back(createPort(c->nextPortId++, "mix " + direction + std::to_string(i),
+                                          isInput,
+                                          AudioPortExt::make<AudioPortExt::Tag::mix>(mixExt)));
+            mixPortIds.push_back(c->ports.back().id);
+            if (!isInput) {
+                c->portConfigs.push_back(createPortConfig(c->nextPortId++, c->ports.back()));
+                topology->sourceConfigIds.push_back(c->portConfigs.back().id);
+            }
+        }
+        for (int i = 0; i < kPortsPerKind; ++i) {
+            c->ports.push_back(createPort(c->nextPortId++,
+                                          "attached " + direction + std::to_string(i), isInput,
+                                          createDeviceExt(isInput, "")));
+            devicePortIds.push_back(c->ports.back().id);
+            c->initialConfigs.push_back(createPortConfig(c->nextPortId++, c->ports.back()));
+            if (!isInput) {
+                topology->sinkConfigIds.push_back(c->initialConfigs.back().id);
+            }
+        }
+        for (int i = 0; i < kPortsPerKind; ++i) {
+            c->ports.push_back(createPort(
+                    c->nextPortId++, "external " + direction + std::to_string(i), isInput,
+                    createDeviceExt(isInput, AudioDeviceDescription::CONNECTION_USB)));
+            devicePortIds.push_back(c->ports.back().id);
+            topology->externalDevicePortIds.push_back(c->ports.back().id);
+        }
+        for (int32_t sinkId : isInput ? mixPortIds : devicePortIds) {
+            c->routes.push_back(
+                    AudioRoute{.sourcePortIds = isInput ? devicePortIds : mixPortIds,
+                               .sinkPortId = sinkId});
+        }
+        topology->mixPortIds.insert(topology->mixPortIds.end(), mixPortIds.begin(),
+                                    mixPortIds.end());
+    }
+    c->portConfigs.insert(c->portConfigs.end(), c->initialConfigs.begin(),
+                          c->initialConfigs.end());
+    return c;
+}
+
+std::shared_ptr<IModule> createModule(Topology* topology) {
+    std::shared_ptr<IModule> module =
+            Module::createInstance(Module::Type::STUB, createConfiguration(topology));
+    ModuleDebug debug{.simulateDeviceConnections = true};
+    module->setModuleDebug(debug);
+    return module;
+}
+
+AudioPort createConnectionRequest(int32_t templateId, int index) {
+    AudioPort request;
+    request.id = templateId;
+    AudioPortDeviceExt deviceExt;
+    deviceExt.device.address = "card=1;device=" + std::to_string(index);
+    request.ext = AudioPortExt::make<AudioPortExt::Tag::device>(deviceExt);
+    return request;
+}
+
+}  // namespace
+
+static void BM_GetAudioRoutesForAudioPort(benchmark::State& state) {
+    Topology topology;
+    auto module = createModule(&topology);
+    size_t i = 0;
+    for (auto _ : state) {
+        std::vector<AudioRoute> routes;
+        module->getAudioRoutesForAudioPort(topology.mixPortIds[i++ % topology.mixPortIds.size()],
+                                           &routes);
+        benchmark::DoNotOptimize(routes.data());
+    }
+}
+BENCHMARK(BM_GetAudioRoutesForAudioPort);
+
+static void BM_ConnectDisconnectExternalDevice(benchmark::State& state) {
+    Topology topology;
+    auto module = createModule(&topology);
+    // Keep some devices connected, as it happens with USB and Bluetooth.
+    const int connectedCount = state.range(0);
+    for (int i = 0; i < connectedCount; ++i) {
+        AudioPort connected;
+        module->connectExternalDevice(
+                createConnectionRequest(topology.externalDevicePortIds[i], i), &connected);
+    }
+    size_t i = connectedCount;
+    for (auto _ : state) {
+        const int32_t templateId =
+                topology.externalDevicePortIds[i++ % topology.externalDevicePortIds.size()];
+        AudioPort connected;
+        if (!module->connectExternalDevice(createConnectionRequest(templateId, -1), &connected)
+                     .isOk()) {
+            state.SkipWithError("connectExternalDevice failed");
+            break;
+        }
+        module->disconnectExternalDevice(connected.id);
+    }
+}
+BENCHMARK(BM_ConnectDisconnectExternalDevice)->Arg(0)->Arg(20);
+
+static void BM_SetResetAudioPatch(benchmark::State& state) {
+    Topology topology;
+    auto module = createModule(&topology);
+    size_t i = 0;
+    for (auto _ : state) {
+        AudioPatch requested, patch;
+        requested.sourcePortConfigIds.push_back(
+                topology.sourceConfigIds[i % topology.sourceConfigIds.size()]);
+        requested.sinkPortConfigIds.push_back(
+                topology.sinkConfigIds[i % topology.sinkConfigIds.size()]);
+        ++i;
+        if (!module->setAudioPatch(requested, &patch).isOk()) {
+            state.SkipWithError("setAudioPatch failed");
+            break;
+        }
+        module->resetAudioPatch(patch.id);
+    }
+}
+BENCHMARK(BM_SetResetAudioPatch);
+
+BENCHMARK_MAIN();
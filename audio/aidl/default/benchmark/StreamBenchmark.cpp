@@ -0,0 +1,265 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "core-impl/Module.h"
+#include "core-impl/Stream.h"
+
+using aidl::android::hardware::audio::core::AudioPatch;
+using aidl::android::hardware::audio::core::AudioRoute;
+using aidl::android::hardware::audio::core::IModule;
+using aidl::android::hardware::audio::core::IStreamCommon;
+using aidl::android::hardware::audio::core::Module;
+using aidl::android::hardware::audio::core::StreamContext;
+using aidl::android::hardware::audio::core::StreamDescriptor;
+using aidl::android::media::audio::common::AudioChannelLayout;
+using aidl::android::media::audio::common::AudioDeviceType;
+using aidl::android::media::audio::common::AudioFormatDescription;
+using aidl::android::media::audio::common::AudioFormatType;
+using aidl::android::media::audio::common::AudioIoFlags;
+using aidl::android::media::audio::common::AudioPort;
+using aidl::android::media::audio::common::AudioPortConfig;
+using aidl::android::media::audio::common::AudioPortDeviceExt;
+using aidl::android::media::audio::common::AudioPortExt;
+using aidl::android::media::audio::common::AudioPortMixExt;
+using aidl::android::media::audio::common::AudioProfile;
+using aidl::android::media::audio::common::Int;
+using aidl::android::media::audio::common::PcmType;
+
+namespace {
+
+constexpr int32_t kSampleRate = 48000;
+
+AudioProfile createProfile() {
+    AudioProfile profile;
+    profile.format = AudioFormatDescription{.type = AudioFormatType::PCM,
+                                            .pcm = PcmType::INT_16_BIT};
+    profile.channelMasks.push_back(AudioChannelLayout::make<AudioChannelLayout::layoutMask>(
+            AudioChannelLayout::LAYOUT_STEREO));
+    profile.sampleRates.push_back(kSampleRate);
+    return profile;
+}
+
+AudioPort createPort(int32_t id, const std::string& name, bool isInput, const AudioPortExt& ext) {
+    AudioPort port;
+    port.id = id;
+    port.name = name;
+    port.profiles.push_back(createProfile());
+    port.flags = isInput ? AudioIoFlags::make<AudioIoFlags::Tag::input>(0)
+                         : AudioIoFlags::make<AudioIoFlags::Tag::output>(0);
+    port.ext = ext;
+    return port;
+}
+
+AudioPortConfig createPortConfig(int32_t id, const AudioPort& port) {
+    AudioPortConfig config;
+    config.id = id;
+    config.portId = port.id;
+    config.format = port.profiles[0].format;
+    config.channelMask = port.profiles[0].channelMasks[0];
+    config.sampleRate = Int{.value = kSampleRate};
+    config.flags = port.flags;
+    config.ext = port.ext;
+    return config;
+}
+
+// The port configs of a mix port and of the attached device port it is patched to.
+struct StreamPorts {
+    int32_t mixPortConfigId;
+    int32_t devicePortConfigId;
+};
+
+// For each direction, one mix port routed to one attached device port.
+std::unique_ptr<Module::Configuration> createConfiguration(StreamPorts* outPorts,
+                                                           StreamPorts* inPorts) {
+    auto c = std::make_unique<Module::Configuration>();
+    for (bool isInput : {false, true}) {
+        StreamPorts* ports = isInput ? inPorts : outPorts;
+        AudioPortMixExt mixExt;
+        mixExt.handle = c->nextPortId;
+        const AudioPort mixPort = createPort(c->nextPortId++, isInput ? "mix in" : "mix out",
+                                             isInput,
+                                             AudioPortExt::make<AudioPortExt::Tag::mix>(mixExt));
+        c->ports.push_back(mixPort);
+        c->portConfigs.push_back(createPortConfig(c->nextPortId++, mixPort));
+        ports->mixPortConfigId = c->portConfigs.back().id;
+
+        AudioPortDeviceExt deviceExt;
+        deviceExt.device.type.type = isInput ? AudioDeviceType::IN_MICROPHONE
+                                             : AudioDeviceType::OUT_SPEAKER;
+        const AudioPort devicePort =
+                createPort(c->nextPortId++, isInput ? "mic" : "speaker", isInput,
+                           AudioPortExt::make<AudioPortExt::Tag::device>(deviceExt));
+        c->ports.push_back(devicePort);
+        c->initialConfigs.push_back(createPortConfig(c->nextPortId++, devicePort));
+        ports->devicePortConfigId = c->initialConfigs.back().id;
+
+        c->routes.push_back(isInput ? AudioRoute{.sourcePortIds = {devicePort.id},
+                                                 .sinkPortId = mixPort.id}
+                                    : AudioRoute{.sourcePortIds = {mixPort.id},
+                                                 .sinkPortId = devicePort.id});
+    }
+    c->portConfigs.insert(c->portConfigs.end(), c->initialConfigs.begin(),
+                          c->initialConfigs.end());
+    return c;
+}
+
+// The client side of an open stream. The MQs are mapped from the stream descriptor, as the
+// framework does, so that the benchmark goes through the same shared memory and event flags.
+struct StreamClient {
+    std::shared_ptr<ndk::ICInterface> stream;
+    std::shared_ptr<IStreamCommon> common;
+    std::unique_ptr<StreamContext::CommandMQ> commandMQ;
+    std::unique_ptr<StreamContext::ReplyMQ> replyMQ;
+    std::unique_ptr<StreamContext::DataMQ> dataMQ;
+    size_t bufferSizeBytes = 0;
+
+    ~StreamClient() {
+        if (common != nullptr) common->close();
+    }
+};
+
+// Patches the mix port to its device, so that the stream is connected and the worker calls
+// the driver, then opens the stream.
+bool openStream(IModule* module, bool isInput, const StreamPorts& ports,
+                int64_t bufferSizeFrames, StreamClient* client) {
+    AudioPatch requested, patch;
+    requested.sourcePortConfigIds.push_back(isInput ? ports.devicePortConfigId
+                                                    : ports.mixPortConfigId);
+    requested.sinkPortConfigIds.push_back(isInput ? ports.mixPortConfigId
+                                                  : ports.devicePortConfigId);
+    if (!module->setAudioPatch(requested, &patch).isOk()) return false;
+
+    StreamDescriptor desc;
+    if (isInput) {
+        IModule::OpenInputStreamArguments args;
+        args.portConfigId = ports.mixPortConfigId;
+        args.bufferSizeFrames = bufferSizeFrames;
+        IModule::OpenInputStreamReturn ret;
+        if (!module->openInputStream(args, &ret).isOk() ||
+            !ret.stream->getStreamCommon(&client->common).isOk()) {
+            return false;
+        }
+        client->stream = std::move(ret.stream);
+        desc = std::move(ret.desc);
+    } else {
+        IModule::OpenOutputStreamArguments args;
+        args.portConfigId = ports.mixPortConfigId;
+        args.bufferSizeFrames = bufferSizeFrames;
+        IModule::OpenOutputStreamReturn ret;
+        if (!module->openOutputStream(args, &ret).isOk() ||
+            !ret.stream->getStreamCommon(&client->common).isOk()) {
+            return false;
+        }
+        client->stream = std::move(ret.stream);
+        desc = std::move(ret.desc);
+    }
+    client->commandMQ = std::make_unique<StreamContext::CommandMQ>(desc.command);
+    client->replyMQ = std::make_unique<StreamContext::ReplyMQ>(desc.reply);
+    client->dataMQ = std::make_unique<StreamContext::DataMQ>(
+            desc.audio.get<StreamDescriptor::AudioBuffer::Tag::fmq>());
+    client->bufferSizeBytes = desc.frameSizeBytes * desc.bufferSizeFrames;
+    return client->commandMQ->isValid() && client->replyMQ->isValid() &&
+           client->dataMQ->isValid();
+}
+
+// One round trip of the stream protocol with a full buffer: the data into the data MQ for
+// output, the "burst" command into the command MQ, the reply from the reply MQ, and the data
+// from the data MQ for input.
+bool burst(StreamClient* client, bool isInput, std::vector<int8_t>* buffer) {
+    if (!isInput && !client->dataMQ->write(buffer->data(), buffer->size())) return false;
+    const auto command =
+            StreamDescriptor::Command::make<StreamDescriptor::Command::Tag::burst>(
+                    static_cast<int32_t>(buffer->size()));
+    if (!client->commandMQ->writeBlocking(&command, 1)) return false;
+    StreamDescriptor::Reply reply;
+    if (!client->replyMQ->readBlocking(&reply, 1) || reply.status != STATUS_OK) return false;
+    if (isInput) {
+        const size_t byteCount = std::min(buffer->size(), static_cast<size_t>(reply.fmqByteCount));
+        return client->dataMQ->read(buffer->data(), byteCount);
+    }
+    return true;
+}
+
+double percentile(const std::vector<double>& sorted, double fraction) {
+    return sorted[std::min(sorted.size() - 1, static_cast<size_t>(fraction * sorted.size()))];
+}
+
+}  // namespace
+
+// Round trips of 'range(0)' frame bursts, each filling the whole data MQ, through a stub stream
+// of a stub module. The driver of the stub stream sleeps for 80% of the burst duration, so the
+// latency percentiles are only comparable at equal burst sizes. The CPU time is that of the whole
+// process, client and worker thread, per burst.
+static void BM_StreamBurst(benchmark::State& state, bool isInput) {
+    StreamPorts outPorts, inPorts;
+    std::shared_ptr<IModule> module =
+            Module::createInstance(Module::Type::STUB, createConfiguration(&outPorts, &inPorts));
+    StreamClient client;
+    if (!openStream(module.get(), isInput, isInput ? inPorts : outPorts, state.range(0),
+                    &client)) {
+        state.SkipWithError("openStream failed");
+        return;
+    }
+    std::vector<int8_t> buffer(client.bufferSizeBytes);
+    // The first burst moves the stream out of standby and starts the driver.
+    if (!burst(&client, isInput, &buffer)) {
+        state.SkipWithError("first burst failed");
+        return;
+    }
+
+    std::vector<double> latenciesUs;
+    latenciesUs.reserve(state.max_iterations);
+    for (auto _ : state) {
+        const auto start = std::chrono::steady_clock::now();
+        if (!burst(&client, isInput, &buffer)) {
+            state.SkipWithError("burst failed");
+            break;
+        }
+        latenciesUs.push_back(
+                std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start)
+                        .count());
+    }
+    if (latenciesUs.empty()) return;
+    std::sort(latenciesUs.begin(), latenciesUs.end());
+    state.counters["p50_us"] = percentile(latenciesUs, 0.5);
+    state.counters["p90_us"] = percentile(latenciesUs, 0.9);
+    state.counters["p99_us"] = percentile(latenciesUs, 0.99);
+    state.counters["max_us"] = latenciesUs.back();
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+// The smallest size is the minimum buffer of the stub module, 5 ms at 48 kHz.
+BENCHMARK_CAPTURE(BM_StreamBurst, Out, false)
+        ->RangeMultiplier(2)
+        ->Range(240, 1920)
+        ->MeasureProcessCPUTime()
+        ->UseRealTime()
+        ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_StreamBurst, In, true)
+        ->RangeMultiplier(2)
+        ->Range(240, 1920)
+        ->MeasureProcessCPUTime()
+        ->UseRealTime()
+        ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -30,6 +30,7 @@ using aidl::android::hardware::audio::effect::getEffectImplUuidDownmixSw;
 using aidl::android::hardware::audio::effect::getEffectTypeUuidDownmix;
 using aidl::android::hardware::audio::effect::IEffect;
 using aidl::android::hardware::audio::effect::State;
+using aidl::android::media::audio::common::AudioChannelLayout;
 using aidl::android::media::audio::common::AudioUuid;
 
 extern "C" binder_exception_t createEffect(const AudioUuid* in_impl_uuid,
@@ -153,12 +154,71 @@ RetCode DownmixSw::releaseContext() {
 
 // Processing method running in EffectWorker thread.
 IEffect::Status DownmixSw::effectProcessImpl(float* in, float* out, int samples) {
-    // TODO: get data buffer and process.
-    LOG(DEBUG) << __func__ << " in " << in << " out " << out << " samples " << samples;
-    for (int i = 0; i < samples; i++) {
-        *out++ = *in++;
+    RETURN_VALUE_IF(!mContext, (IEffect::Status{EX_NULL_POINTER, 0, 0}), "nullContext");
+    return mContext->process(in, out, samples);
+}
+
+namespace {
+
+std::optional<dsp::StereoDownmixer::Layout> getFoldLayout(const AudioChannelLayout& layout) {
+    if (layout.getTag() != AudioChannelLayout::layoutMask) {
+        return std::nullopt;
+    }
+    switch (layout.get<AudioChannelLayout::layoutMask>()) {
+        case AudioChannelLayout::LAYOUT_5POINT1:
+            return dsp::StereoDownmixer::Layout::k5Point1;
+        case AudioChannelLayout::LAYOUT_7POINT1:
+            return dsp::StereoDownmixer::Layout::k7Point1;
+        case AudioChannelLayout::LAYOUT_7POINT1POINT4:
+            return dsp::StereoDownmixer::Layout::k7Point1Point4;
+        case AudioChannelLayout::LAYOUT_9POINT1POINT6:
+            return dsp::StereoDownmixer::Layout::k9Point1Point6;
+        default:
+            return std::nullopt;
+    }
+}
+
+}  // namespace
+
+RetCode DownmixSwContext::setCommon(const Parameter::Common& common) {
+    if (auto ret = EffectContext::setCommon(common); ret != RetCode::SUCCESS) {
+        return ret;
+    }
+    configureDownmixer();
+    return RetCode::SUCCESS;
+}
+
+void DownmixSwContext::configureDownmixer() {
+    mDownmixEnabled = mInputChannelCount >= 2 && mOutputChannelCount == 2;
+    if (!mDownmixEnabled) {
+        LOG(WARNING) << __func__ << " unsupported IO, bypass: in channels " << mInputChannelCount
+                     << " out channels " << mOutputChannelCount;
+        return;
+    }
+    const auto layout = getFoldLayout(mCommon.input.base.channelMask);
+    mFoldSupported = layout.has_value();
+    if (mFoldSupported) {
+        mDownmixer.configure(*layout);
+    } else {
+        LOG(DEBUG) << __func__ << " no fold matrix for "
+                   << mCommon.input.base.channelMask.toString() << ", FOLD strips";
+    }
+}
+
+IEffect::Status DownmixSwContext::process(float* in, float* out, int samples) {
+    if (!mDownmixEnabled) {
+        std::copy(in, in + samples, out);
+        return {STATUS_OK, samples, samples};
+    }
+    const size_t frameCount = samples / mInputChannelCount;
+    if (mType == Downmix::Type::FOLD && mFoldSupported) {
+        mDownmixer.process(in, out, frameCount);
+    } else {
+        dsp::stripToStereo(in, out, mInputChannelCount, frameCount);
     }
-    return {STATUS_OK, samples, samples};
+    // A trailing partial frame is dropped.
+    return {STATUS_OK, static_cast<int32_t>(frameCount * mInputChannelCount),
+            static_cast<int32_t>(frameCount * 2)};
 }
 
 }  // namespace aidl::android::hardware::audio::effect
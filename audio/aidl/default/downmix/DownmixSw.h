@@ -20,7 +20,9 @@
 #include <fmq/AidlMessageQueue.h>
 #include <cstdlib>
 #include <memory>
+#include <optional>
 
+#include "dsp/Downmix.h"
 #include "effect-impl/EffectImpl.h"
 
 namespace aidl::android::hardware::audio::effect {
@@ -30,17 +32,28 @@ class DownmixSwContext final : public EffectContext {
     DownmixSwContext(int statusDepth, const Parameter::Common& common)
         : EffectContext(statusDepth, common) {
         LOG(DEBUG) << __func__;
+        configureDownmixer();
     }
 
+    RetCode setCommon(const Parameter::Common& common) override;
+
     RetCode setDmType(Downmix::Type type) {
-        // TODO : Add implementation to apply new type
         mType = type;
         return RetCode::SUCCESS;
     }
     Downmix::Type getDmType() const { return mType; }
 
+    IEffect::Status process(float* in, float* out, int samples);
+
   private:
     Downmix::Type mType = Downmix::Type::STRIP;
+
+    dsp::StereoDownmixer mDownmixer;
+    // Set when the input is a layout with a fold matrix, FOLD strips any other input.
+    bool mFoldSupported = false;
+    bool mDownmixEnabled = false;
+
+    void configureDownmixer();
 };
 
 class DownmixSw final : public EffectImpl {
@@ -0,0 +1,319 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstring>
+#include <type_traits>
+
+#include "dsp/Biquad.h"
+
+namespace aidl::android::hardware::audio::effect::dsp {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+// Keep the designed frequencies strictly between 0 and Nyquist, where the formulas degenerate.
+constexpr double kMinNormalizedFrequency = 1e-4;
+constexpr double kMaxNormalizedFrequency = 0.499;
+// Filter state decaying below this is flushed to zero to avoid denormal arithmetic on silence.
+constexpr float kDenormalThreshold = 1e-20f;
+
+struct Design {
+    double cosW0;
+    double alpha;
+};
+
+Design design(float sampleRate, float frequency, float q) {
+    const double normalized =
+            std::clamp(static_cast<double>(frequency) / sampleRate, kMinNormalizedFrequency,
+                       kMaxNormalizedFrequency);
+    const double w0 = 2 * kPi * normalized;
+    return {.cosW0 = std::cos(w0), .alpha = std::sin(w0) / (2 * std::max(q, 1e-3f))};
+}
+
+BiquadCoefficients normalize(double b0, double b1, double b2, double a0, double a1, double a2) {
+    return {.b0 = static_cast<float>(b0 / a0),
+            .b1 = static_cast<float>(b1 / a0),
+            .b2 = static_cast<float>(b2 / a0),
+            .a1 = static_cast<float>(a1 / a0),
+            .a2 = static_cast<float>(a2 / a0)};
+}
+
+void flushDenormals(float4* state) {
+    for (size_t lane = 0; lane < kFloat4Lanes; lane++) {
+        if (std::fabs((*state)[lane]) < kDenormalThreshold) {
+            (*state)[lane] = 0.f;
+        }
+    }
+}
+
+}  // namespace
+
+BiquadCoefficients BiquadCoefficients::peaking(float sampleRate, float frequency, float q,
+                                               float gainDb) {
+    const auto [cosW0, alpha] = design(sampleRate, frequency, q);
+    const double a = std::pow(10.0, gainDb / 40.0);
+    return normalize(1 + alpha * a, -2 * cosW0, 1 - alpha * a, 1 + alpha / a, -2 * cosW0,
+                     1 - alpha / a);
+}
+
+BiquadCoefficients BiquadCoefficients::lowShelf(float sampleRate, float frequency, float q,
+                                                float gainDb) {
+    const auto [cosW0, alpha] = design(sampleRate, frequency, q);
+    const double a = std::pow(10.0, gainDb / 40.0);
+    const double k = 2 * std::sqrt(a) * alpha;
+    return normalize(a * ((a + 1) - (a - 1) * cosW0 + k), 2 * a * ((a - 1) - (a + 1) * cosW0),
+                     a * ((a + 1) - (a - 1) * cosW0 - k), (a + 1) + (a - 1) * cosW0 + k,
+                     -2 * ((a - 1) + (a + 1) * cosW0), (a + 1) + (a - 1) * cosW0 - k);
+}
+
+BiquadCoefficients BiquadCoefficients::highShelf(float sampleRate, float frequency, float q,
+                                                 float gainDb) {
+    const auto [cosW0, alpha] = design(sampleRate, frequency, q);
+    const double a = std::pow(10.0, gainDb / 40.0);
+    const double k = 2 * std::sqrt(a) * alpha;
+    return normalize(a * ((a + 1) + (a - 1) * cosW0 + k), -2 * a * ((a - 1) + (a + 1) * cosW0),
+                     a * ((a + 1) + (a - 1) * cosW0 - k), (a + 1) - (a - 1) * cosW0 + k,
+                     2 * ((a - 1) - (a + 1) * cosW0), (a + 1) - (a - 1) * cosW0 - k);
+}
+
+BiquadCoefficients BiquadCoefficients::lowPass(float sampleRate, float frequency, float q) {
+    const auto [cosW0, alpha] = design(sampleRate, frequency, q);
+    return normalize((1 - cosW0) / 2, 1 - cosW0, (1 - cosW0) / 2, 1 + alpha, -2 * cosW0,
+                     1 - alpha);
+}
+
+BiquadCoefficients BiquadCoefficients::highPass(float sampleRate, float frequency, float q) {
+    const auto [cosW0, alpha] = design(sampleRate, frequency, q);
+    return normalize((1 + cosW0) / 2, -(1 + cosW0), (1 + cosW0) / 2, 1 + alpha, -2 * cosW0,
+                     1 - alpha);
+}
+
+BiquadCoefficients BiquadCoefficients::allPass(float sampleRate, float frequency, float q) {
+    const auto [cosW0, alpha] = design(sampleRate, frequency, q);
+    return normalize(1 - alpha, -2 * cosW0, 1 + alpha, 1 + alpha, -2 * cosW0, 1 - alpha);
+}
+
+float BiquadCoefficients::getMagnitude(float sampleRate, float frequency) const {
+    const double w = 2 * kPi * frequency / sampleRate;
+    const std::complex<double> z1 = std::polar(1.0, -w);
+    const std::complex<double> z2 = z1 * z1;
+    const std::complex<double> numerator = static_cast<double>(b0) + z1 * static_cast<double>(b1) +
+                                           z2 * static_cast<double>(b2);
+    const std::complex<double> denominator =
+            1.0 + z1 * static_cast<double>(a1) + z2 * static_cast<double>(a2);
+    return static_cast<float>(std::abs(numerator / denominator));
+}
+
+bool BiquadCascade::configure(size_t channelCount, size_t stageCount) {
+    if (channelCount == 0 || channelCount > kMaxChannels || stageCount == 0 ||
+        stageCount > kMaxStages) {
+        return false;
+    }
+    mChannelCount = channelCount;
+    mGroupCount = (channelCount + kFloat4Lanes - 1) / kFloat4Lanes;
+    mStageCount = stageCount;
+    const float4 one = broadcastFloat4(1.f);
+    const Coefficients4 passThrough = {.b0 = one, .b1 = {}, .b2 = {}, .a1 = {}, .a2 = {}};
+    for (size_t i = 0; i < kMaxStages; i++) {
+        mCurrent[i].fill(passThrough);
+        mTarget[i].fill(passThrough);
+        mStep[i].fill(Coefficients4{});
+    }
+    mRampBlocksLeft = 0;
+    reset();
+    return true;
+}
+
+void BiquadCascade::setCoefficients(size_t stage, const BiquadCoefficients& coefficients,
+                                    size_t rampFrames) {
+    if (stage >= mStageCount) {
+        return;
+    }
+    for (size_t channel = 0; channel < mChannelCount; channel++) {
+        setLane(stage, channel, coefficients, rampFrames);
+    }
+    startRamp(rampFrames);
+}
+
+void BiquadCascade::setCoefficients(size_t stage, size_t channel,
+                                    const BiquadCoefficients& coefficients, size_t rampFrames) {
+    if (stage >= mStageCount || channel >= mChannelCount) {
+        return;
+    }
+    setLane(stage, channel, coefficients, rampFrames);
+    startRamp(rampFrames);
+}
+
+BiquadCoefficients BiquadCascade::getCoefficients(size_t stage, size_t channel) const {
+    const Coefficients4& c = mCurrent[stage][channel / kFloat4Lanes];
+    const size_t lane = channel % kFloat4Lanes;
+    return {.b0 = c.b0[lane], .b1 = c.b1[lane], .b2 = c.b2[lane], .a1 = c.a1[lane],
+            .a2 = c.a2[lane]};
+}
+
+void BiquadCascade::setLane(size_t stage, size_t channel, const BiquadCoefficients& coefficients,
+                            size_t rampFrames) {
+    const size_t group = channel / kFloat4Lanes;
+    const size_t lane = channel % kFloat4Lanes;
+    auto set = [&](Coefficients4* c) {
+        c->b0[lane] = coefficients.b0;
+        c->b1[lane] = coefficients.b1;
+        c->b2[lane] = coefficients.b2;
+        c->a1[lane] = coefficients.a1;
+        c->a2[lane] = coefficients.a2;
+    };
+    set(&mTarget[stage][group]);
+    if (rampFrames == 0) {
+        // Other lanes and sections keep ramping, this one has arrived.
+        set(&mCurrent[stage][group]);
+    }
+}
+
+void BiquadCascade::startRamp(size_t rampFrames) {
+    if (rampFrames == 0) {
+        if (isRamping()) {
+            // Lanes set immediately must not move for the rest of the ongoing ramp.
+            startRamp(mRampBlocksLeft * kRampBlockFrames);
+        }
+        return;
+    }
+    // Restart the ramp of all sections so that they all arrive in 'rampFrames' frames.
+    mRampBlocksLeft = (rampFrames + kRampBlockFrames - 1) / kRampBlockFrames;
+    const float4 scale = broadcastFloat4(1.f / mRampBlocksLeft);
+    for (size_t i = 0; i < mStageCount; i++) {
+        for (size_t group = 0; group < mGroupCount; group++) {
+            const Coefficients4& current = mCurrent[i][group];
+            const Coefficients4& target = mTarget[i][group];
+            mStep[i][group] = {.b0 = (target.b0 - current.b0) * scale,
+                               .b1 = (target.b1 - current.b1) * scale,
+                               .b2 = (target.b2 - current.b2) * scale,
+                               .a1 = (target.a1 - current.a1) * scale,
+                               .a2 = (target.a2 - current.a2) * scale};
+        }
+    }
+}
+
+void BiquadCascade::reset() {
+    for (size_t i = 0; i < kMaxStages; i++) {
+        mS1[i].fill(float4{});
+        mS2[i].fill(float4{});
+    }
+}
+
+void BiquadCascade::advanceRamp() {
+    if (--mRampBlocksLeft == 0) {
+        // Land exactly on the target, the accumulated steps carry rounding errors.
+        mCurrent = mTarget;
+        return;
+    }
+    for (size_t i = 0; i < mStageCount; i++) {
+        for (size_t group = 0; group < mGroupCount; group++) {
+            Coefficients4& current = mCurrent[i][group];
+            const Coefficients4& step = mStep[i][group];
+            current.b0 += step.b0;
+            current.b1 += step.b1;
+            current.b2 += step.b2;
+            current.a1 += step.a1;
+            current.a2 += step.a2;
+        }
+    }
+}
+
+void BiquadCascade::process(const float* in, float* out, size_t frameCount) {
+    if (mStageCount == 0) {
+        if (in != out && frameCount > 0) {
+            std::memmove(out, in, frameCount * mChannelCount * sizeof(float));
+        }
+        return;
+    }
+    while (frameCount > 0) {
+        const size_t blockFrames =
+                isRamping() ? std::min(frameCount, kRampBlockFrames) : frameCount;
+        processBlock(in, out, blockFrames);
+        if (isRamping()) {
+            advanceRamp();
+        }
+        in += blockFrames * mChannelCount;
+        out += blockFrames * mChannelCount;
+        frameCount -= blockFrames;
+    }
+}
+
+void BiquadCascade::processBlock(const float* in, float* out, size_t frameCount) {
+    const size_t stride = mChannelCount;
+    for (size_t channel = 0, group = 0; channel < mChannelCount;
+         channel += kFloat4Lanes, group++) {
+        const size_t lanes = std::min(kFloat4Lanes, mChannelCount - channel);
+        // Work on local copies so that the state stays in registers across the frame loop.
+        std::array<Coefficients4, kMaxStages> c;
+        std::array<float4, kMaxStages> s1, s2;
+        for (size_t i = 0; i < mStageCount; i++) {
+            c[i] = mCurrent[i][group];
+            s1[i] = mS1[i][group];
+            s2[i] = mS2[i][group];
+        }
+
+        auto filterFrame = [&](float4 x) {
+            for (size_t i = 0; i < mStageCount; i++) {
+                const float4 y = c[i].b0 * x + s1[i];
+                s1[i] = c[i].b1 * x - c[i].a1 * y + s2[i];
+                s2[i] = c[i].b2 * x - c[i].a2 * y;
+                x = y;
+            }
+            return x;
+        };
+        // The lane count is a constant in each loop so that the partial loads and stores of the
+        // last group compile to plain register moves.
+        auto filterFrames = [&](auto lanesConstant) {
+            constexpr size_t kLanes = decltype(lanesConstant)::value;
+            const float* src = in + channel;
+            float* dst = out + channel;
+            for (size_t frame = 0; frame < frameCount; frame++, src += stride, dst += stride) {
+                if constexpr (kLanes == kFloat4Lanes) {
+                    storeFloat4(dst, filterFrame(loadFloat4(src)));
+                } else {
+                    storeFloat4Partial(dst, filterFrame(loadFloat4Partial(src, kLanes)), kLanes);
+                }
+            }
+        };
+        switch (lanes) {
+            case 1:
+                filterFrames(std::integral_constant<size_t, 1>());
+                break;
+            case 2:
+                filterFrames(std::integral_constant<size_t, 2>());
+                break;
+            case 3:
+                filterFrames(std::integral_constant<size_t, 3>());
+                break;
+            default:
+                filterFrames(std::integral_constant<size_t, kFloat4Lanes>());
+                break;
+        }
+
+        for (size_t i = 0; i < mStageCount; i++) {
+            flushDenormals(&s1[i]);
+            flushDenormals(&s2[i]);
+            mS1[i][group] = s1[i];
+            mS2[i][group] = s2[i];
+        }
+    }
+}
+
+}  // namespace aidl::android::hardware::audio::effect::dsp
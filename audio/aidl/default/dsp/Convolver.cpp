@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "dsp/Convolver.h"
+#include "dsp/Simd.h"
+
+namespace aidl::android::hardware::audio::effect::dsp {
+
+bool BinauralConvolver::configure(size_t channelCount, size_t blockFrames,
+                                  size_t maxFilterFrames) {
+    if (channelCount == 0 || channelCount > kMaxChannels || blockFrames < kMinBlockFrames ||
+        blockFrames > kMaxBlockFrames || (blockFrames & (blockFrames - 1)) != 0 ||
+        maxFilterFrames == 0 || !mFft.configure(2 * blockFrames)) {
+        return false;
+    }
+    mChannelCount = channelCount;
+    mBlockFrames = blockFrames;
+    mFftSize = 2 * blockFrames;
+    mPartitionCount = (maxFilterFrames + blockFrames - 1) / blockFrames;
+
+    const size_t spectraSize = channelCount * mPartitionCount * mFftSize;
+    mChannelPartitions.assign(channelCount, 0);
+    mFilterRe.assign(spectraSize, 0.f);
+    mFilterIm.assign(spectraSize, 0.f);
+    mInputSpectraRe.assign(spectraSize, 0.f);
+    mInputSpectraIm.assign(spectraSize, 0.f);
+    mInputBlocks.assign(channelCount * mFftSize, 0.f);
+    mOutputBlock.assign(2 * blockFrames, 0.f);
+    mWorkRe.assign(mFftSize, 0.f);
+    mWorkIm.assign(mFftSize, 0.f);
+    mSumRe.assign(mFftSize, 0.f);
+    mSumIm.assign(mFftSize, 0.f);
+    reset();
+    return true;
+}
+
+bool BinauralConvolver::setFilter(size_t channel, const float* left, const float* right,
+                                  size_t frameCount) {
+    if (channel >= mChannelCount || frameCount > mPartitionCount * mBlockFrames) {
+        return false;
+    }
+    const size_t partitions = (frameCount + mBlockFrames - 1) / mBlockFrames;
+    for (size_t partition = 0; partition < partitions; partition++) {
+        // The partition in the first half and zeros in the second, so that the last block of the
+        // circular convolution with two input blocks is the linear one.
+        const size_t offset = partition * mBlockFrames;
+        const size_t taps = std::min(mBlockFrames, frameCount - offset);
+        std::fill(mWorkRe.begin(), mWorkRe.end(), 0.f);
+        std::fill(mWorkIm.begin(), mWorkIm.end(), 0.f);
+        std::copy(left + offset, left + offset + taps, mWorkRe.begin());
+        std::copy(right + offset, right + offset + taps, mWorkIm.begin());
+        mFft.forward(mWorkRe.data(), mWorkIm.data());
+        std::copy(mWorkRe.begin(), mWorkRe.end(), filterRe(channel, partition));
+        std::copy(mWorkIm.begin(), mWorkIm.end(), filterIm(channel, partition));
+    }
+    if (mChannelPartitions[channel] == 0) {
+        // The delay line of a silent channel is not updated, start it from silence.
+        std::fill_n(inputSpectrumRe(channel, 0), mPartitionCount * mFftSize, 0.f);
+        std::fill_n(inputSpectrumIm(channel, 0), mPartitionCount * mFftSize, 0.f);
+    }
+    mChannelPartitions[channel] = partitions;
+    return true;
+}
+
+void BinauralConvolver::reset() {
+    std::fill(mInputSpectraRe.begin(), mInputSpectraRe.end(), 0.f);
+    std::fill(mInputSpectraIm.begin(), mInputSpectraIm.end(), 0.f);
+    std::fill(mInputBlocks.begin(), mInputBlocks.end(), 0.f);
+    std::fill(mOutputBlock.begin(), mOutputBlock.end(), 0.f);
+    mNewestSlot = 0;
+    mBlockPosition = 0;
+}
+
+void BinauralConvolver::process(const float* in, float* out, size_t frameCount) {
+    while (frameCount > 0) {
+        const size_t frames = std::min(frameCount, mBlockFrames - mBlockPosition);
+        for (size_t frame = 0; frame < frames; frame++) {
+            // Reads the whole input frame before writing the output frame, for in place use.
+            float* block = &mInputBlocks[mBlockFrames + mBlockPosition + frame];
+            for (size_t channel = 0; channel < mChannelCount; channel++) {
+                block[channel * mFftSize] = in[channel];
+            }
+            out[0] = mOutputBlock[2 * (mBlockPosition + frame)];
+            out[1] = mOutputBlock[2 * (mBlockPosition + frame) + 1];
+            in += mChannelCount;
+            out += 2;
+        }
+        mBlockPosition += frames;
+        frameCount -= frames;
+        if (mBlockPosition == mBlockFrames) {
+            processBlock();
+            mBlockPosition = 0;
+        }
+    }
+}
+
+void BinauralConvolver::processBlock() {
+    mNewestSlot = (mNewestSlot + 1) % mPartitionCount;
+    std::fill(mSumRe.begin(), mSumRe.end(), 0.f);
+    std::fill(mSumIm.begin(), mSumIm.end(), 0.f);
+    for (size_t channel = 0; channel < mChannelCount; channel++) {
+        float* block = &mInputBlocks[channel * mFftSize];
+        const size_t partitions = mChannelPartitions[channel];
+        if (partitions > 0) {
+            float* spectrumRe = inputSpectrumRe(channel, mNewestSlot);
+            float* spectrumIm = inputSpectrumIm(channel, mNewestSlot);
+            std::copy(block, block + mFftSize, spectrumRe);
+            std::fill_n(spectrumIm, mFftSize, 0.f);
+            mFft.forward(spectrumRe, spectrumIm);
+        }
+        // The current block becomes the previous one.
+        std::copy(block + mBlockFrames, block + mFftSize, block);
+
+        for (size_t partition = 0; partition < partitions; partition++) {
+            const size_t slot = (mNewestSlot + mPartitionCount - partition) % mPartitionCount;
+            const float* xRe = inputSpectrumRe(channel, slot);
+            const float* xIm = inputSpectrumIm(channel, slot);
+            const float* hRe = filterRe(channel, partition);
+            const float* hIm = filterIm(channel, partition);
+            for (size_t bin = 0; bin < mFftSize; bin += kFloat4Lanes) {
+                const float4 aRe = loadFloat4(xRe + bin);
+                const float4 aIm = loadFloat4(xIm + bin);
+                const float4 bRe = loadFloat4(hRe + bin);
+                const float4 bIm = loadFloat4(hIm + bin);
+                storeFloat4(&mSumRe[bin], loadFloat4(&mSumRe[bin]) + aRe * bRe - aIm * bIm);
+                storeFloat4(&mSumIm[bin], loadFloat4(&mSumIm[bin]) + aRe * bIm + aIm * bRe);
+            }
+        }
+    }
+
+    // Inverse transform as conj(fft(conj(x))) / size. The real part of the result is the left
+    // output and the imaginary part the right one, of which the second half is valid.
+    for (size_t bin = 0; bin < mFftSize; bin++) {
+        mSumIm[bin] = -mSumIm[bin];
+    }
+    mFft.forward(mSumRe.data(), mSumIm.data());
+    const float scale = 1.f / mFftSize;
+    for (size_t frame = 0; frame < mBlockFrames; frame++) {
+        mOutputBlock[2 * frame] = mSumRe[mBlockFrames + frame] * scale;
+        mOutputBlock[2 * frame + 1] = -mSumIm[mBlockFrames + frame] * scale;
+    }
+}
+
+void makeSphericalHeadHrir(float sampleRate, float azimuthDegrees, float elevationDegrees,
+                           float* left, float* right, size_t frameCount) {
+    constexpr double kHeadRadiusM = 0.0875;
+    constexpr double kSpeedOfSoundMps = 343;
+    constexpr double kMinAlpha = 0.1;
+    constexpr double kMinAlphaAngle = 150 * M_PI / 180;
+    const double azimuth = azimuthDegrees * M_PI / 180;
+    const double elevation = elevationDegrees * M_PI / 180;
+    // The lateral component of the source direction, towards the right ear.
+    const double lateral = std::cos(elevation) * std::sin(azimuth);
+    const double headDelayS = kHeadRadiusM / kSpeedOfSoundMps;
+    // Corner frequency of the head shadow, c / a, in rad/s.
+    const double k = 2.0 * sampleRate;
+    const double corner = kSpeedOfSoundMps / kHeadRadiusM;
+
+    for (float* ear : {left, right}) {
+        // Angle between the source and the ear, 0 when facing it.
+        const double angle = std::acos(std::clamp(ear == left ? -lateral : lateral, -1.0, 1.0));
+        // Woodworth's delay, offset so that the far side of the head is not negative.
+        const double delayS = headDelayS + (angle < M_PI / 2 ? -headDelayS * std::cos(angle)
+                                                             : headDelayS * (angle - M_PI / 2));
+        const double alpha =
+                1 + kMinAlpha / 2 + (1 - kMinAlpha / 2) * std::cos(angle / kMinAlphaAngle * M_PI);
+        // H(s) = (alpha * s + 2 * corner) / (s + 2 * corner), bilinear transform.
+        const double a0 = k + 2 * corner;
+        const double b0 = (alpha * k + 2 * corner) / a0;
+        const double b1 = (2 * corner - alpha * k) / a0;
+        const double a1 = (2 * corner - k) / a0;
+        // The delayed impulse, split between two taps, through the filter.
+        const double delayFrames = delayS * sampleRate;
+        const size_t delayTap = static_cast<size_t>(delayFrames);
+        const double fraction = delayFrames - delayTap;
+        double x1 = 0;
+        double y1 = 0;
+        for (size_t i = 0; i < frameCount; i++) {
+            const double x = i == delayTap ? 1 - fraction : i == delayTap + 1 ? fraction : 0;
+            const double y = b0 * x + b1 * x1 - a1 * y1;
+            x1 = x;
+            y1 = y;
+            ear[i] = static_cast<float>(y);
+        }
+    }
+}
+
+}  // namespace aidl::android::hardware::audio::effect::dsp
@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <array>
+#include <cmath>
+
+#include "dsp/Downmix.h"
+#include "dsp/Simd.h"
+
+namespace aidl::android::hardware::audio::effect::dsp {
+
+namespace {
+
+using Layout = StereoDownmixer::Layout;
+
+enum class Speaker {
+    kFrontLeft,
+    kFrontRight,
+    kFrontCenter,
+    kLowFrequency,
+    kBackLeft,
+    kBackRight,
+    kSideLeft,
+    kSideRight,
+    kTopFrontLeft,
+    kTopFrontRight,
+    kTopBackLeft,
+    kTopBackRight,
+    kTopSideLeft,
+    kTopSideRight,
+    kFrontWideLeft,
+    kFrontWideRight,
+};
+
+template <Layout>
+struct LayoutTraits;
+
+template <>
+struct LayoutTraits<Layout::k5Point1> {
+    static constexpr std::array kSpeakers = {
+            Speaker::kFrontLeft, Speaker::kFrontRight, Speaker::kFrontCenter,
+            Speaker::kLowFrequency, Speaker::kBackLeft, Speaker::kBackRight};
+};
+
+template <>
+struct LayoutTraits<Layout::k7Point1> {
+    static constexpr std::array kSpeakers = {
+            Speaker::kFrontLeft, Speaker::kFrontRight, Speaker::kFrontCenter,
+            Speaker::kLowFrequency, Speaker::kBackLeft, Speaker::kBackRight, Speaker::kSideLeft,
+            Speaker::kSideRight};
+};
+
+template <>
+struct LayoutTraits<Layout::k7Point1Point4> {
+    static constexpr std::array kSpeakers = {
+            Speaker::kFrontLeft, Speaker::kFrontRight, Speaker::kFrontCenter,
+            Speaker::kLowFrequency, Speaker::kBackLeft, Speaker::kBackRight, Speaker::kSideLeft,
+            Speaker::kSideRight, Speaker::kTopFrontLeft, Speaker::kTopFrontRight,
+            Speaker::kTopBackLeft, Speaker::kTopBackRight};
+};
+
+template <>
+struct LayoutTraits<Layout::k9Point1Point6> {
+    static constexpr std::array kSpeakers = {
+            Speaker::kFrontLeft, Speaker::kFrontRight, Speaker::kFrontCenter,
+            Speaker::kLowFrequency, Speaker::kBackLeft, Speaker::kBackRight, Speaker::kSideLeft,
+            Speaker::kSideRight, Speaker::kTopFrontLeft, Speaker::kTopFrontRight,
+            Speaker::kTopBackLeft, Speaker::kTopBackRight, Speaker::kTopSideLeft,
+            Speaker::kTopSideRight, Speaker::kFrontWideLeft, Speaker::kFrontWideRight};
+};
+
+constexpr float kMinus3Db = M_SQRT1_2;
+
+struct Gains {
+    float left;
+    float right;
+};
+
+constexpr Gains getGains(Speaker speaker) {
+    switch (speaker) {
+        case Speaker::kFrontLeft:
+        case Speaker::kFrontWideLeft:
+            return {1.f, 0.f};
+        case Speaker::kFrontRight:
+        case Speaker::kFrontWideRight:
+            return {0.f, 1.f};
+        case Speaker::kFrontCenter:
+        case Speaker::kLowFrequency:
+            return {kMinus3Db, kMinus3Db};
+        case Speaker::kBackLeft:
+        case Speaker::kSideLeft:
+        case Speaker::kTopFrontLeft:
+        case Speaker::kTopBackLeft:
+        case Speaker::kTopSideLeft:
+            return {kMinus3Db, 0.f};
+        case Speaker::kBackRight:
+        case Speaker::kSideRight:
+        case Speaker::kTopFrontRight:
+        case Speaker::kTopBackRight:
+        case Speaker::kTopSideRight:
+            return {0.f, kMinus3Db};
+    }
+    return {0.f, 0.f};
+}
+
+template <size_t N>
+constexpr std::array<Gains, N> makeMatrix(const std::array<Speaker, N>& speakers) {
+    std::array<Gains, N> matrix = {};
+    Gains sum = {0.f, 0.f};
+    for (size_t channel = 0; channel < N; channel++) {
+        matrix[channel] = getGains(speakers[channel]);
+        sum.left += matrix[channel].left;
+        sum.right += matrix[channel].right;
+    }
+    for (auto& gains : matrix) {
+        gains.left /= sum.left;
+        gains.right /= sum.right;
+    }
+    return matrix;
+}
+
+template <Layout kLayout>
+constexpr auto kMatrix = makeMatrix(LayoutTraits<kLayout>::kSpeakers);
+
+template <Layout kLayout>
+constexpr size_t kChannelCount = LayoutTraits<kLayout>::kSpeakers.size();
+
+// Two frames per iteration: each input sample is broadcast to the (left, right) lane pair of its
+// frame and multiplied by the channel's (left, right) gains, which accumulates the stereo output
+// of both frames in one float4. The channel loop has a constant trip count and unrolls fully.
+template <Layout kLayout>
+void fold(const float* in, float* out, size_t frameCount) {
+    constexpr size_t kChannels = kChannelCount<kLayout>;
+    constexpr auto& kGains = kMatrix<kLayout>;
+    size_t frame = 0;
+    for (; frame + 2 <= frameCount; frame += 2) {
+        const float* first = in + frame * kChannels;
+        const float* second = first + kChannels;
+        float4 sum = {};
+        for (size_t channel = 0; channel < kChannels; channel++) {
+            const float4 gains = {kGains[channel].left, kGains[channel].right,
+                                  kGains[channel].left, kGains[channel].right};
+            sum += float4{first[channel], first[channel], second[channel], second[channel]} *
+                   gains;
+        }
+        // Both frames are read before the store, which lands behind them when in == out.
+        storeFloat4(out + frame * 2, sum);
+    }
+    if (frame < frameCount) {
+        const float* last = in + frame * kChannels;
+        float left = 0.f;
+        float right = 0.f;
+        for (size_t channel = 0; channel < kChannels; channel++) {
+            left += last[channel] * kGains[channel].left;
+            right += last[channel] * kGains[channel].right;
+        }
+        out[frame * 2] = left;
+        out[frame * 2 + 1] = right;
+    }
+}
+
+}  // namespace
+
+size_t StereoDownmixer::getChannelCount(Layout layout) {
+    switch (layout) {
+        case Layout::k5Point1:
+            return kChannelCount<Layout::k5Point1>;
+        case Layout::k7Point1:
+            return kChannelCount<Layout::k7Point1>;
+        case Layout::k7Point1Point4:
+            return kChannelCount<Layout::k7Point1Point4>;
+        case Layout::k9Point1Point6:
+            return kChannelCount<Layout::k9Point1Point6>;
+    }
+    return 0;
+}
+
+void StereoDownmixer::configure(Layout layout) {
+    mLayout = layout;
+    switch (layout) {
+        case Layout::k5Point1:
+            mKernel = &fold<Layout::k5Point1>;
+            break;
+        case Layout::k7Point1:
+            mKernel = &fold<Layout::k7Point1>;
+            break;
+        case Layout::k7Point1Point4:
+            mKernel = &fold<Layout::k7Point1Point4>;
+            break;
+        case Layout::k9Point1Point6:
+            mKernel = &fold<Layout::k9Point1Point6>;
+            break;
+    }
+}
+
+void StereoDownmixer::process(const float* in, float* out, size_t frameCount) const {
+    if (mKernel == nullptr) {
+        stripToStereo(in, out, getChannelCount(), frameCount);
+        return;
+    }
+    mKernel(in, out, frameCount);
+}
+
+float StereoDownmixer::getCoefficient(size_t channel, size_t side) const {
+    auto get = [channel, side](const auto& matrix) {
+        if (channel >= matrix.size() || side > 1) {
+            return 0.f;
+        }
+        return side == 0 ? matrix[channel].left : matrix[channel].right;
+    };
+    switch (mLayout) {
+        case Layout::k5Point1:
+            return get(kMatrix<Layout::k5Point1>);
+        case Layout::k7Point1:
+            return get(kMatrix<Layout::k7Point1>);
+        case Layout::k7Point1Point4:
+            return get(kMatrix<Layout::k7Point1Point4>);
+        case Layout::k9Point1Point6:
+            return get(kMatrix<Layout::k9Point1Point6>);
+    }
+    return 0.f;
+}
+
+void stripToStereo(const float* in, float* out, size_t channelCount, size_t frameCount) {
+    for (size_t frame = 0; frame < frameCount; frame++) {
+        const float left = in[frame * channelCount];
+        const float right = in[frame * channelCount + 1];
+        out[frame * 2] = left;
+        out[frame * 2 + 1] = right;
+    }
+}
+
+}  // namespace aidl::android::hardware::audio::effect::dsp
@@ -0,0 +1,395 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "dsp/DynamicsProcessor.h"
+
+namespace aidl::android::hardware::audio::effect::dsp {
+
+namespace {
+
+// Butterworth sections: shelves without overshoot, and squared into Linkwitz-Riley crossovers.
+constexpr float kButterworthQ = M_SQRT1_2;
+// Envelope levels are floored here before the conversion to dB.
+constexpr float kMinLevel = 1e-10f;
+
+float dbToLinear(float db) {
+    return std::pow(10.f, db / 20.f);
+}
+
+BiquadCoefficients designEqBand(float sampleRate, const DynamicsProcessor::EqBand* bands,
+                                size_t bandCount, size_t band) {
+    const float gainDb = bands[band].gainDb;
+    if (bandCount == 1) {
+        // A single band covers the whole spectrum.
+        return {.b0 = dbToLinear(gainDb), .b1 = 0.f, .b2 = 0.f, .a1 = 0.f, .a2 = 0.f};
+    }
+    if (band == 0) {
+        return BiquadCoefficients::lowShelf(sampleRate, bands[0].cutoffFrequencyHz, kButterworthQ,
+                                            gainDb);
+    }
+    const float lower = std::max(bands[band - 1].cutoffFrequencyHz, 1.f);
+    if (band == bandCount - 1) {
+        return BiquadCoefficients::highShelf(sampleRate, lower, kButterworthQ, gainDb);
+    }
+    const float upper = std::max(bands[band].cutoffFrequencyHz, lower * 1.01f);
+    const float center = std::sqrt(lower * upper);
+    return BiquadCoefficients::peaking(sampleRate, center, center / (upper - lower), gainDb);
+}
+
+// Static curve of a compressor with soft knee and a downward expander below the noise gate.
+float computeMbcGainDb(const DynamicsProcessor::MbcBand& config, float levelDb) {
+    const float ratio = std::max(config.ratio, 1.f);
+    const float knee = std::fabs(config.kneeWidthDb);
+    const float over = levelDb - config.thresholdDb;
+    float outputDb = levelDb;
+    if (knee > 0 && std::fabs(over) <= knee / 2) {
+        const float x = over + knee / 2;
+        outputDb = levelDb + (1 / ratio - 1) * x * x / (2 * knee);
+    } else if (over > 0) {
+        outputDb = config.thresholdDb + over / ratio;
+    }
+    if (levelDb < config.noiseGateThresholdDb) {
+        const float expanderRatio = std::max(config.expanderRatio, 1.f);
+        outputDb -= (config.noiseGateThresholdDb - levelDb) * (expanderRatio - 1);
+    }
+    return outputDb - levelDb;
+}
+
+float computeLimiterGainDb(const DynamicsProcessor::Limiter& config, float levelDb) {
+    const float over = levelDb - config.thresholdDb;
+    return over > 0 ? over * (1 / std::max(config.ratio, 1.f) - 1) : 0;
+}
+
+void setLane(std::array<float4, DynamicsProcessor::kMaxChannels / kFloat4Lanes>* lanes,
+             size_t channel, float value) {
+    (*lanes)[channel / kFloat4Lanes][channel % kFloat4Lanes] = value;
+}
+
+}  // namespace
+
+bool DynamicsProcessor::configure(float sampleRate, size_t channelCount,
+                                  const Architecture& architecture) {
+    if (sampleRate <= 0 || channelCount == 0 || channelCount > kMaxChannels ||
+        architecture.preEqBandCount > kMaxEqBands || architecture.postEqBandCount > kMaxEqBands ||
+        architecture.mbcBandCount > kMaxMbcBands) {
+        return false;
+    }
+    mSampleRate = sampleRate;
+    mChannelCount = channelCount;
+    mGroupCount = (channelCount + kFloat4Lanes - 1) / kFloat4Lanes;
+    mStride = mGroupCount * kFloat4Lanes;
+
+    mInputGain.fill(broadcastFloat4(1.f));
+    mInputGainTarget.fill(broadcastFloat4(1.f));
+    configureEqualizer(&mPreEq, architecture.preEqBandCount);
+    configureEqualizer(&mPostEq, architecture.postEqBandCount);
+
+    mMbcBandCount = architecture.mbcBandCount;
+    mMbcChannelEnabled.assign(channelCount, false);
+    mMbcBands.assign(channelCount * mMbcBandCount, {});
+    for (size_t i = 0; i + 1 < mMbcBandCount; i++) {
+        mMbcLowPass[i].configure(mStride, 2);
+        mMbcHighPass[i].configure(mStride, 2);
+        if (i + 2 < mMbcBandCount) {
+            mMbcPhaseCompensation[i].configure(mStride, mMbcBandCount - 2 - i);
+        }
+    }
+    mMbcEnvelopes.fill({});
+    for (auto& envelope : mMbcEnvelopes) {
+        envelope.gain.fill(broadcastFloat4(1.f));
+    }
+    for (size_t channel = 0; channel < channelCount; channel++) {
+        // The crossovers start from pass through, which must not be ramped from.
+        updateMbc(channel, 0 /* rampFrames */);
+    }
+
+    mLimiterInUse = architecture.limiterInUse;
+    mLimiters.assign(channelCount, {});
+    mLimiterEnvelope = {};
+    mLimiterEnvelope.gain.fill(broadcastFloat4(1.f));
+
+    mWork.assign(kBlockFrames * mStride, 0.f);
+    mBandBuffers.assign(kBlockFrames * mStride * (mMbcBandCount > 0 ? mMbcBandCount - 1 : 0), 0.f);
+    return true;
+}
+
+void DynamicsProcessor::configureEqualizer(Equalizer* eq, size_t bandCount) {
+    eq->bandCount = bandCount;
+    eq->channelEnabled.assign(mChannelCount, false);
+    eq->bands.assign(mChannelCount * bandCount, {});
+    if (bandCount > 0) {
+        eq->filters.configure(mStride, bandCount);
+    }
+}
+
+void DynamicsProcessor::setInputGain(size_t channel, float gainDb) {
+    if (channel < mChannelCount) {
+        setLane(&mInputGainTarget, channel, dbToLinear(gainDb));
+    }
+}
+
+void DynamicsProcessor::setPreEqEnabled(size_t channel, bool enable) {
+    if (channel < mChannelCount && mPreEq.bandCount > 0) {
+        mPreEq.channelEnabled[channel] = enable;
+        updateEqualizer(&mPreEq, channel);
+    }
+}
+
+void DynamicsProcessor::setPreEqBand(size_t channel, size_t band, const EqBand& config) {
+    if (channel < mChannelCount && band < mPreEq.bandCount) {
+        mPreEq.bands[channel * mPreEq.bandCount + band] = config;
+        updateEqualizer(&mPreEq, channel);
+    }
+}
+
+void DynamicsProcessor::setPostEqEnabled(size_t channel, bool enable) {
+    if (channel < mChannelCount && mPostEq.bandCount > 0) {
+        mPostEq.channelEnabled[channel] = enable;
+        updateEqualizer(&mPostEq, channel);
+    }
+}
+
+void DynamicsProcessor::setPostEqBand(size_t channel, size_t band, const EqBand& config) {
+    if (channel < mChannelCount && band < mPostEq.bandCount) {
+        mPostEq.bands[channel * mPostEq.bandCount + band] = config;
+        updateEqualizer(&mPostEq, channel);
+    }
+}
+
+void DynamicsProcessor::setMbcEnabled(size_t channel, bool enable) {
+    if (channel < mChannelCount && mMbcBandCount > 0) {
+        mMbcChannelEnabled[channel] = enable;
+        updateMbc(channel);
+    }
+}
+
+void DynamicsProcessor::setMbcBand(size_t channel, size_t band, const MbcBand& config) {
+    if (channel < mChannelCount && band < mMbcBandCount) {
+        mMbcBands[channel * mMbcBandCount + band] = config;
+        updateMbc(channel);
+    }
+}
+
+void DynamicsProcessor::setLimiter(size_t channel, const Limiter& config) {
+    if (channel < mChannelCount) {
+        mLimiters[channel] = config;
+        setEnvelopeTimes(&mLimiterEnvelope, channel, config.attackTimeMs, config.releaseTimeMs);
+    }
+}
+
+// The bands of a channel depend on their neighbours' cutoff frequencies, so all the sections of
+// the channel are redesigned on any change.
+void DynamicsProcessor::updateEqualizer(Equalizer* eq, size_t channel) {
+    const EqBand* bands = eq->bands.data() + channel * eq->bandCount;
+    for (size_t band = 0; band < eq->bandCount; band++) {
+        BiquadCoefficients coefficients;
+        if (eq->channelEnabled[channel] && bands[band].enable) {
+            coefficients = designEqBand(mSampleRate, bands, eq->bandCount, band);
+        }
+        eq->filters.setCoefficients(band, channel, coefficients);
+    }
+}
+
+void DynamicsProcessor::updateMbc(size_t channel, size_t rampFrames) {
+    const MbcBand* bands = mMbcBands.data() + channel * mMbcBandCount;
+    for (size_t i = 0; i + 1 < mMbcBandCount; i++) {
+        const float cutoff = bands[i].cutoffFrequencyHz;
+        const auto lowPass = BiquadCoefficients::lowPass(mSampleRate, cutoff, kButterworthQ);
+        const auto highPass = BiquadCoefficients::highPass(mSampleRate, cutoff, kButterworthQ);
+        for (size_t stage = 0; stage < 2; stage++) {
+            mMbcLowPass[i].setCoefficients(stage, channel, lowPass, rampFrames);
+            mMbcHighPass[i].setCoefficients(stage, channel, highPass, rampFrames);
+        }
+        // A Linkwitz-Riley low pass plus high pass is the all-pass with the same poles.
+        const auto allPass = BiquadCoefficients::allPass(mSampleRate, cutoff, kButterworthQ);
+        for (size_t lower = 0; lower < i; lower++) {
+            mMbcPhaseCompensation[lower].setCoefficients(i - lower - 1, channel, allPass,
+                                                         rampFrames);
+        }
+    }
+    for (size_t band = 0; band < mMbcBandCount; band++) {
+        setEnvelopeTimes(&mMbcEnvelopes[band], channel, bands[band].attackTimeMs,
+                         bands[band].releaseTimeMs);
+    }
+}
+
+void DynamicsProcessor::setEnvelopeTimes(Envelope* envelope, size_t channel, float attackTimeMs,
+                                         float releaseTimeMs) {
+    // One pole smoothing of the block peaks, reaching 1 - 1/e of a step in the given time.
+    auto coefficient = [this](float timeMs) {
+        const float timeFrames = timeMs * mSampleRate / 1000.f;
+        return timeFrames <= kBlockFrames ? 1.f
+                                          : 1.f - std::exp(-static_cast<float>(kBlockFrames) /
+                                                                   timeFrames);
+    };
+    setLane(&envelope->attack, channel, coefficient(attackTimeMs));
+    setLane(&envelope->release, channel, coefficient(releaseTimeMs));
+}
+
+void DynamicsProcessor::process(const float* in, float* out, size_t frameCount) {
+    while (frameCount > 0) {
+        const size_t blockFrames = std::min(frameCount, kBlockFrames);
+        processBlock(in, out, blockFrames);
+        in += blockFrames * mChannelCount;
+        out += blockFrames * mChannelCount;
+        frameCount -= blockFrames;
+    }
+}
+
+void DynamicsProcessor::processBlock(const float* in, float* out, size_t frameCount) {
+    float* work = mWork.data();
+    // The padding lanes are zero and stay zero through all the stages.
+    if (mStride == mChannelCount) {
+        std::memcpy(work, in, frameCount * mChannelCount * sizeof(float));
+    } else {
+        for (size_t frame = 0; frame < frameCount; frame++) {
+            std::memcpy(work + frame * mStride, in + frame * mChannelCount,
+                        mChannelCount * sizeof(float));
+        }
+    }
+
+    applyGainRamp(work, frameCount, &mInputGain, mInputGainTarget);
+    if (mPreEq.bandCount > 0) {
+        mPreEq.filters.process(work, work, frameCount);
+    }
+    if (mMbcBandCount > 0) {
+        processMbc(frameCount);
+    }
+    if (mPostEq.bandCount > 0) {
+        mPostEq.filters.process(work, work, frameCount);
+    }
+    if (mLimiterInUse) {
+        processLimiter(frameCount);
+    }
+
+    if (mStride == mChannelCount) {
+        std::memcpy(out, work, frameCount * mChannelCount * sizeof(float));
+    } else {
+        for (size_t frame = 0; frame < frameCount; frame++) {
+            std::memcpy(out + frame * mChannelCount, work + frame * mStride,
+                        mChannelCount * sizeof(float));
+        }
+    }
+}
+
+void DynamicsProcessor::processMbc(size_t frameCount) {
+    float* work = mWork.data();
+    const size_t bandSize = kBlockFrames * mStride;
+    // Split off the bands from the bottom, what is left in mWork is the top band.
+    for (size_t band = 0; band + 1 < mMbcBandCount; band++) {
+        float* bandBuffer = &mBandBuffers[band * bandSize];
+        mMbcLowPass[band].process(work, bandBuffer, frameCount);
+        mMbcHighPass[band].process(work, work, frameCount);
+        if (band + 2 < mMbcBandCount) {
+            mMbcPhaseCompensation[band].process(bandBuffer, bandBuffer, frameCount);
+        }
+    }
+    for (size_t band = 0; band < mMbcBandCount; band++) {
+        compressBand(band + 1 < mMbcBandCount ? &mBandBuffers[band * bandSize] : work, band,
+                     frameCount);
+    }
+    const size_t samples = frameCount * mStride;
+    for (size_t band = 0; band + 1 < mMbcBandCount; band++) {
+        const float* bandBuffer = &mBandBuffers[band * bandSize];
+        for (size_t i = 0; i < samples; i += kFloat4Lanes) {
+            storeFloat4(work + i, loadFloat4(work + i) + loadFloat4(bandBuffer + i));
+        }
+    }
+}
+
+void DynamicsProcessor::compressBand(float* buffer, size_t band, size_t frameCount) {
+    Envelope& envelope = mMbcEnvelopes[band];
+    trackEnvelope(buffer, frameCount, &envelope);
+    Lanes targets;
+    targets.fill(broadcastFloat4(1.f));
+    for (size_t channel = 0; channel < mChannelCount; channel++) {
+        const MbcBand& config = mMbcBands[channel * mMbcBandCount + band];
+        if (!mMbcChannelEnabled[channel] || !config.enable) {
+            continue;
+        }
+        const float levelDb = getLevelDb(envelope, channel) + config.preGainDb;
+        setLane(&targets, channel,
+                dbToLinear(computeMbcGainDb(config, levelDb) + config.preGainDb +
+                           config.postGainDb));
+    }
+    applyGainRamp(buffer, frameCount, &envelope.gain, targets);
+}
+
+void DynamicsProcessor::processLimiter(size_t frameCount) {
+    trackEnvelope(mWork.data(), frameCount, &mLimiterEnvelope);
+    std::array<float, kMaxChannels> levelsDb;
+    for (size_t channel = 0; channel < mChannelCount; channel++) {
+        levelsDb[channel] = getLevelDb(mLimiterEnvelope, channel);
+    }
+    Lanes targets;
+    targets.fill(broadcastFloat4(1.f));
+    for (size_t channel = 0; channel < mChannelCount; channel++) {
+        const Limiter& config = mLimiters[channel];
+        if (!config.enable) {
+            continue;
+        }
+        float levelDb = levelsDb[channel];
+        for (size_t other = 0; other < mChannelCount; other++) {
+            if (mLimiters[other].enable && mLimiters[other].linkGroup == config.linkGroup) {
+                levelDb = std::max(levelDb, levelsDb[other]);
+            }
+        }
+        setLane(&targets, channel,
+                dbToLinear(computeLimiterGainDb(config, levelDb) + config.postGainDb));
+    }
+    applyGainRamp(mWork.data(), frameCount, &mLimiterEnvelope.gain, targets);
+}
+
+void DynamicsProcessor::trackEnvelope(const float* buffer, size_t frameCount,
+                                      Envelope* envelope) {
+    for (size_t group = 0; group < mGroupCount; group++) {
+        const float* src = buffer + group * kFloat4Lanes;
+        float4 peak = {};
+        for (size_t frame = 0; frame < frameCount; frame++, src += mStride) {
+            peak = maxFloat4(peak, absFloat4(loadFloat4(src)));
+        }
+        const float4 level = envelope->level[group];
+        const float4 coefficient =
+                selectFloat4(peak > level, envelope->attack[group], envelope->release[group]);
+        envelope->level[group] = level + (peak - level) * coefficient;
+    }
+}
+
+void DynamicsProcessor::applyGainRamp(float* buffer, size_t frameCount, Lanes* gains,
+                                      const Lanes& targets) {
+    const float4 scale = broadcastFloat4(1.f / frameCount);
+    for (size_t group = 0; group < mGroupCount; group++) {
+        float4 gain = (*gains)[group];
+        const float4 step = (targets[group] - gain) * scale;
+        float* dst = buffer + group * kFloat4Lanes;
+        for (size_t frame = 0; frame < frameCount; frame++, dst += mStride) {
+            gain += step;
+            storeFloat4(dst, loadFloat4(dst) * gain);
+        }
+        (*gains)[group] = targets[group];
+    }
+}
+
+float DynamicsProcessor::getLevelDb(const Envelope& envelope, size_t channel) const {
+    const float level = envelope.level[channel / kFloat4Lanes][channel % kFloat4Lanes];
+    return 20.f * std::log10(std::max(level, kMinLevel));
+}
+
+}  // namespace aidl::android::hardware::audio::effect::dsp
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <utility>
+
+#include "dsp/Fft.h"
+#include "dsp/Simd.h"
+
+namespace aidl::android::hardware::audio::effect::dsp {
+
+bool Fft::configure(size_t size) {
+    if (size < kMinSize || size > kMaxSize || (size & (size - 1)) != 0) {
+        return false;
+    }
+    mSize = size;
+
+    mSwaps.clear();
+    size_t bits = 0;
+    while ((size_t{1} << bits) < size) bits++;
+    for (size_t i = 0; i < size; i++) {
+        size_t reversed = 0;
+        for (size_t bit = 0; bit < bits; bit++) {
+            reversed |= ((i >> bit) & 1) << (bits - 1 - bit);
+        }
+        if (i < reversed) {
+            mSwaps.emplace_back(i, reversed);
+        }
+    }
+
+    mTwiddleRe.resize(size - 1);
+    mTwiddleIm.resize(size - 1);
+    for (size_t half = 1; half < size; half <<= 1) {
+        for (size_t j = 0; j < half; j++) {
+            // In double, the error of the float tables stays at the last bit for all sizes.
+            const double angle = -M_PI * j / half;
+            mTwiddleRe[half - 1 + j] = std::cos(angle);
+            mTwiddleIm[half - 1 + j] = std::sin(angle);
+        }
+    }
+    return true;
+}
+
+void Fft::forward(float* re, float* im) const {
+    for (const auto& [i, j] : mSwaps) {
+        std::swap(re[i], re[j]);
+        std::swap(im[i], im[j]);
+    }
+    for (size_t half = 1; half < mSize; half <<= 1) {
+        const float* wRe = &mTwiddleRe[half - 1];
+        const float* wIm = &mTwiddleIm[half - 1];
+        for (size_t group = 0; group < mSize; group += 2 * half) {
+            float* aRe = re + group;
+            float* aIm = im + group;
+            float* bRe = aRe + half;
+            float* bIm = aIm + half;
+            if (half < kFloat4Lanes) {
+                for (size_t j = 0; j < half; j++) {
+                    const float tRe = bRe[j] * wRe[j] - bIm[j] * wIm[j];
+                    const float tIm = bRe[j] * wIm[j] + bIm[j] * wRe[j];
+                    bRe[j] = aRe[j] - tRe;
+                    bIm[j] = aIm[j] - tIm;
+                    aRe[j] += tRe;
+                    aIm[j] += tIm;
+                }
+                continue;
+            }
+            for (size_t j = 0; j < half; j += kFloat4Lanes) {
+                const float4 twRe = loadFloat4(wRe + j);
+                const float4 twIm = loadFloat4(wIm + j);
+                const float4 xRe = loadFloat4(bRe + j);
+                const float4 xIm = loadFloat4(bIm + j);
+                const float4 tRe = xRe * twRe - xIm * twIm;
+                const float4 tIm = xRe * twIm + xIm * twRe;
+                const float4 yRe = loadFloat4(aRe + j);
+                const float4 yIm = loadFloat4(aIm + j);
+                storeFloat4(bRe + j, yRe - tRe);
+                storeFloat4(bIm + j, yIm - tIm);
+                storeFloat4(aRe + j, yRe + tRe);
+                storeFloat4(aIm + j, yIm + tIm);
+            }
+        }
+    }
+}
+
+}  // namespace aidl::android::hardware::audio::effect::dsp
@@ -0,0 +1,326 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+#include "dsp/Gain.h"
+
+namespace aidl::android::hardware::audio::effect::dsp {
+
+namespace {
+
+typedef int16_t short4 __attribute__((vector_size(4 * sizeof(int16_t))));
+
+// Loads four samples as float4 and stores a float4 back to four samples. The integer formats are
+// rounded to nearest and saturated on the way back, the scale of the samples is left as is.
+inline float4 loadSamples(const float* src) {
+    return loadFloat4(src);
+}
+
+inline void storeSamples(float* dst, float4 value) {
+    storeFloat4(dst, value);
+}
+
+inline float4 roundFloat4(float4 value) {
+    return value + selectFloat4(value < 0, broadcastFloat4(-0.5f), broadcastFloat4(0.5f));
+}
+
+inline float4 loadSamples(const int16_t* src) {
+    short4 value;
+    std::memcpy(&value, src, sizeof(value));
+    // Widened first, there is no direct 16 bit integer to float conversion instruction.
+    return __builtin_convertvector(__builtin_convertvector(value, int4), float4);
+}
+
+inline void storeSamples(int16_t* dst, float4 value) {
+    value = minFloat4(maxFloat4(value, broadcastFloat4(-32768.f)), broadcastFloat4(32767.f));
+    const short4 result =
+            __builtin_convertvector(__builtin_convertvector(roundFloat4(value), int4), short4);
+    std::memcpy(dst, &result, sizeof(result));
+}
+
+inline float4 loadSamples(const int32_t* src) {
+    int4 value;
+    std::memcpy(&value, src, sizeof(value));
+    return __builtin_convertvector(value, float4);
+}
+
+inline void storeSamples(int32_t* dst, float4 value) {
+    // The largest float below 2^31, INT32_MAX is not representable.
+    value = minFloat4(maxFloat4(value, broadcastFloat4(-2147483648.f)),
+                      broadcastFloat4(2147483520.f));
+    const int4 result = __builtin_convertvector(roundFloat4(value), int4);
+    std::memcpy(dst, &result, sizeof(result));
+}
+
+// Same as above for the first 'lanes' (< kFloat4Lanes) samples, through a zero padded copy.
+template <typename T>
+inline float4 loadSamplesPartial(const T* src, size_t lanes) {
+    T padded[kFloat4Lanes] = {};
+    for (size_t i = 0; i < lanes; i++) {
+        padded[i] = src[i];
+    }
+    return loadSamples(padded);
+}
+
+template <typename T>
+inline void storeSamplesPartial(T* dst, float4 value, size_t lanes) {
+    T padded[kFloat4Lanes];
+    storeSamples(padded, value);
+    for (size_t i = 0; i < lanes; i++) {
+        dst[i] = padded[i];
+    }
+}
+
+inline float4 loadSamplesPartial(const float* src, size_t lanes) {
+    return loadFloat4Partial(src, lanes);
+}
+
+inline void storeSamplesPartial(float* dst, float4 value, size_t lanes) {
+    storeFloat4Partial(dst, value, lanes);
+}
+
+}  // namespace
+
+float millibelsToGain(float levelMb) {
+    return std::pow(10.f, levelMb / 2000.f);
+}
+
+bool GainRamp::configure(size_t channelCount) {
+    if (channelCount == 0 || channelCount > kMaxChannels) {
+        mChannelCount = 0;
+        return false;
+    }
+    mChannelCount = channelCount;
+    mGroupCount = (channelCount + kFloat4Lanes - 1) / kFloat4Lanes;
+    mPatternSize = std::lcm(channelCount, kFloat4Lanes);
+    mCurrent.fill(broadcastFloat4(1.f));
+    mTarget.fill(broadcastFloat4(1.f));
+    mRampFramesLeft = 0;
+    finishRamp();
+    return true;
+}
+
+bool GainRamp::configure(size_t inputChannelCount, size_t outputChannelCount) {
+    return configure(inputChannelCount == outputChannelCount ? inputChannelCount : 0);
+}
+
+void GainRamp::setGain(float gain, size_t rampFrames, Shape shape) {
+    for (size_t channel = 0; channel < mChannelCount; channel++) {
+        setLane(channel, gain, rampFrames);
+    }
+    startRamp(rampFrames, shape);
+}
+
+void GainRamp::setGain(size_t channel, float gain, size_t rampFrames, Shape shape) {
+    if (channel >= mChannelCount) {
+        return;
+    }
+    setLane(channel, gain, rampFrames);
+    startRamp(rampFrames, shape);
+}
+
+float GainRamp::getGain(size_t channel) const {
+    return mCurrent[channel / kFloat4Lanes][channel % kFloat4Lanes];
+}
+
+float GainRamp::getTargetGain(size_t channel) const {
+    return mTarget[channel / kFloat4Lanes][channel % kFloat4Lanes];
+}
+
+void GainRamp::setLane(size_t channel, float gain, size_t rampFrames) {
+    const size_t group = channel / kFloat4Lanes;
+    const size_t lane = channel % kFloat4Lanes;
+    mTarget[group][lane] = std::max(gain, 0.f);
+    if (rampFrames == 0) {
+        // Other channels keep ramping, this one has arrived.
+        mCurrent[group][lane] = mTarget[group][lane];
+    }
+}
+
+void GainRamp::startRamp(size_t rampFrames, Shape shape) {
+    if (rampFrames == 0) {
+        if (isRamping()) {
+            // Channels set immediately must not move for the rest of the ongoing ramp.
+            startRamp(mRampFramesLeft, mShape);
+        } else {
+            finishRamp();
+        }
+        return;
+    }
+    mShape = shape;
+    mRampFramesLeft = rampFrames;
+    const float4 scale = broadcastFloat4(1.f / rampFrames);
+    for (size_t group = 0; group < mGroupCount; group++) {
+        if (shape == Shape::kLinear) {
+            mStep[group] = (mTarget[group] - mCurrent[group]) * scale;
+            continue;
+        }
+        const float4 minGain = broadcastFloat4(kMinExponentialGain);
+        mCurrent[group] = maxFloat4(mCurrent[group], minGain);
+        const float4 ratio = maxFloat4(mTarget[group], minGain) / mCurrent[group];
+        for (size_t lane = 0; lane < kFloat4Lanes; lane++) {
+            mStep[group][lane] = std::pow(ratio[lane], scale[lane]);
+        }
+    }
+}
+
+void GainRamp::finishRamp() {
+    mRampFramesLeft = 0;
+    mCurrent = mTarget;
+    mUnity = true;
+    for (size_t i = 0; i < mPatternSize; i++) {
+        mPattern[i] = getTargetGain(i % mChannelCount);
+        mUnity = mUnity && mPattern[i] == 1.f;
+    }
+}
+
+void GainRamp::process(const float* in, float* out, size_t frameCount) {
+    processImpl(in, out, frameCount);
+}
+
+void GainRamp::process(const int16_t* in, int16_t* out, size_t frameCount) {
+    processImpl(in, out, frameCount);
+}
+
+void GainRamp::process(const int32_t* in, int32_t* out, size_t frameCount) {
+    processImpl(in, out, frameCount);
+}
+
+void GainRamp::processInterleaved(const float* in, float* out, size_t sampleCount) {
+    size_t scaledSampleCount = 0;
+    if (mChannelCount > 0) {
+        const size_t frameCount = sampleCount / mChannelCount;
+        process(in, out, frameCount);
+        scaledSampleCount = frameCount * mChannelCount;
+    }
+    if (in != out) {
+        std::copy(in + scaledSampleCount, in + sampleCount, out + scaledSampleCount);
+    }
+}
+
+template <typename T>
+void GainRamp::processImpl(const T* in, T* out, size_t frameCount) {
+    if (isRamping()) {
+        const size_t rampFrames = std::min(frameCount, mRampFramesLeft);
+        processRamp(in, out, rampFrames);
+        in += rampFrames * mChannelCount;
+        out += rampFrames * mChannelCount;
+        frameCount -= rampFrames;
+    }
+    if (frameCount == 0) {
+        return;
+    }
+    const size_t sampleCount = frameCount * mChannelCount;
+    if (mUnity) {
+        if (in != out) {
+            std::copy(in, in + sampleCount, out);
+        }
+        return;
+    }
+    processSteady(in, out, sampleCount);
+}
+
+template <typename T>
+void GainRamp::processRamp(const T* in, T* out, size_t frameCount) {
+    // The frames covered by one pattern: 4 for an odd channel count, 1 for a multiple of 4.
+    const size_t patternFrames = mPatternSize / mChannelCount;
+    const size_t patternCount = frameCount / patternFrames;
+    if (patternCount > 0) {
+        // Same flat run of full vectors as processSteady(), with a pattern of the gains of the
+        // next 'patternFrames' frames that moves by 'patternFrames' steps after each pass.
+        std::array<float, kMaxPatternSize> gains;
+        std::array<float, kMaxPatternSize> steps;
+        for (size_t i = 0; i < mPatternSize; i++) {
+            const size_t frame = i / mChannelCount;
+            const size_t channel = i % mChannelCount;
+            const float step = mStep[channel / kFloat4Lanes][channel % kFloat4Lanes];
+            if (mShape == Shape::kLinear) {
+                gains[i] = getGain(channel) + step * frame;
+                steps[i] = step * patternFrames;
+            } else {
+                gains[i] = getGain(channel) * std::pow(step, frame);
+                steps[i] = std::pow(step, patternFrames);
+            }
+        }
+        for (size_t pattern = 0; pattern < patternCount; pattern++) {
+            for (size_t i = 0; i < mPatternSize; i += kFloat4Lanes) {
+                const float4 gain = loadFloat4(&gains[i]);
+                storeSamples(out + i, loadSamples(in + i) * gain);
+                storeFloat4(&gains[i], mShape == Shape::kLinear ? gain + loadFloat4(&steps[i])
+                                                                : gain * loadFloat4(&steps[i]));
+            }
+            in += mPatternSize;
+            out += mPatternSize;
+        }
+        for (size_t channel = 0; channel < mChannelCount; channel++) {
+            mCurrent[channel / kFloat4Lanes][channel % kFloat4Lanes] = gains[channel];
+        }
+    }
+    // The remaining frames, one at a time.
+    const size_t fullGroups = mChannelCount / kFloat4Lanes;
+    const size_t tailLanes = mChannelCount % kFloat4Lanes;
+    for (size_t frame = patternCount * patternFrames; frame < frameCount; frame++) {
+        for (size_t group = 0; group < fullGroups; group++) {
+            const size_t offset = group * kFloat4Lanes;
+            storeSamples(out + offset, loadSamples(in + offset) * mCurrent[group]);
+        }
+        if (tailLanes > 0) {
+            const size_t offset = fullGroups * kFloat4Lanes;
+            storeSamplesPartial(out + offset,
+                                loadSamplesPartial(in + offset, tailLanes) * mCurrent[fullGroups],
+                                tailLanes);
+        }
+        for (size_t group = 0; group < mGroupCount; group++) {
+            if (mShape == Shape::kLinear) {
+                mCurrent[group] += mStep[group];
+            } else {
+                mCurrent[group] *= mStep[group];
+            }
+        }
+        in += mChannelCount;
+        out += mChannelCount;
+    }
+    mRampFramesLeft -= frameCount;
+    if (mRampFramesLeft == 0) {
+        finishRamp();
+    }
+}
+
+template <typename T>
+void GainRamp::processSteady(const T* in, T* out, size_t sampleCount) const {
+    size_t i = 0;
+    size_t patternIndex = 0;
+    // mPatternSize is a multiple of four, so the pattern wraps on a vector boundary.
+    for (; i + kFloat4Lanes <= sampleCount; i += kFloat4Lanes) {
+        storeSamples(out + i, loadSamples(in + i) * loadFloat4(&mPattern[patternIndex]));
+        patternIndex += kFloat4Lanes;
+        if (patternIndex == mPatternSize) {
+            patternIndex = 0;
+        }
+    }
+    if (i < sampleCount) {
+        const size_t lanes = sampleCount - i;
+        storeSamplesPartial(out + i,
+                            loadSamplesPartial(in + i, lanes) * loadFloat4(&mPattern[patternIndex]),
+                            lanes);
+    }
+}
+
+}  // namespace aidl::android::hardware::audio::effect::dsp
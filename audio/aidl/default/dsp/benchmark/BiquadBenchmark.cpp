@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "dsp/Biquad.h"
+
+using aidl::android::hardware::audio::effect::dsp::BiquadCascade;
+using aidl::android::hardware::audio::effect::dsp::BiquadCoefficients;
+
+namespace {
+
+constexpr float kSampleRate = 48000.f;
+constexpr size_t kFrameCount = 960;  // 20 ms
+
+// The five bands of the equalizer effect.
+void configureEqualizer(BiquadCascade* cascade, size_t channelCount) {
+    cascade->configure(channelCount, 5);
+    cascade->setCoefficients(0, BiquadCoefficients::lowShelf(kSampleRate, 60, M_SQRT1_2, 3), 0);
+    cascade->setCoefficients(1, BiquadCoefficients::peaking(kSampleRate, 230, 0.67f, -2), 0);
+    cascade->setCoefficients(2, BiquadCoefficients::peaking(kSampleRate, 910, 0.67f, 1), 0);
+    cascade->setCoefficients(3, BiquadCoefficients::peaking(kSampleRate, 3600, 0.67f, -4), 0);
+    cascade->setCoefficients(4, BiquadCoefficients::highShelf(kSampleRate, 14000, M_SQRT1_2, 3),
+                             0);
+}
+
+std::vector<float> makeInput(size_t channelCount) {
+    std::vector<float> buffer(kFrameCount * channelCount);
+    for (size_t i = 0; i < buffer.size(); i++) {
+        buffer[i] = static_cast<float>(i % 97) / 97.f - 0.5f;
+    }
+    return buffer;
+}
+
+}  // namespace
+
+// Five band equalizer throughput, reported in frames per second for each channel count.
+static void BM_BiquadCascade(benchmark::State& state) {
+    const size_t channelCount = state.range(0);
+    BiquadCascade cascade;
+    configureEqualizer(&cascade, channelCount);
+    const std::vector<float> input = makeInput(channelCount);
+    std::vector<float> output(input.size());
+
+    for (auto _ : state) {
+        cascade.process(input.data(), output.data(), kFrameCount);
+        benchmark::DoNotOptimize(output.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kFrameCount);
+    state.SetBytesProcessed(state.iterations() * input.size() * sizeof(float));
+}
+
+// Same as above while the coefficients are continuously ramping to new band levels.
+static void BM_BiquadCascadeRamping(benchmark::State& state) {
+    const size_t channelCount = state.range(0);
+    BiquadCascade cascade;
+    configureEqualizer(&cascade, channelCount);
+    const std::vector<float> input = makeInput(channelCount);
+    std::vector<float> output(input.size());
+    float gainDb = 0;
+
+    for (auto _ : state) {
+        gainDb = gainDb > 10 ? -10 : gainDb + 1;
+        cascade.setCoefficients(2, BiquadCoefficients::peaking(kSampleRate, 910, 0.67f, gainDb),
+                                kFrameCount);
+        cascade.process(input.data(), output.data(), kFrameCount);
+        benchmark::DoNotOptimize(output.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kFrameCount);
+    state.SetBytesProcessed(state.iterations() * input.size() * sizeof(float));
+}
+
+static void channelCounts(benchmark::internal::Benchmark* b) {
+    for (int channelCount : {1, 2, 4, 6, 8, 12, 16, 24}) {
+        b->Arg(channelCount);
+    }
+}
+
+BENCHMARK(BM_BiquadCascade)->Apply(channelCounts);
+BENCHMARK(BM_BiquadCascadeRamping)->Apply(channelCounts);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "dsp/Convolver.h"
+
+using aidl::android::hardware::audio::effect::dsp::BinauralConvolver;
+using aidl::android::hardware::audio::effect::dsp::makeSphericalHeadHrir;
+
+namespace {
+
+constexpr float kSampleRate = 48000.f;
+constexpr size_t kFrameCount = 960;  // 20 ms
+
+// 7.1.4 speaker positions in AudioChannelLayout bit order: FL, FR, FC, LFE, BL, BR, SL, SR, TFL,
+// TFR, TBL, TBR.
+constexpr float kAzimuths[] = {-30, 30, 0, 0, -135, 135, -90, 90, -45, 45, -135, 135};
+constexpr float kElevations[] = {0, 0, 0, 0, 0, 0, 0, 0, 45, 45, 45, 45};
+constexpr size_t kChannelCount = std::size(kAzimuths);
+
+}  // namespace
+
+// 7.1.4 to binaural at 48 kHz for each block size (the latency), with 'range(1)' HRIR taps. The
+// 'realtime' counter is the audio duration rendered per second of CPU time.
+static void BM_BinauralConvolver7Point1Point4(benchmark::State& state) {
+    const size_t blockFrames = state.range(0);
+    const size_t filterFrames = state.range(1);
+    BinauralConvolver convolver;
+    convolver.configure(kChannelCount, blockFrames, filterFrames);
+    std::vector<float> left(filterFrames);
+    std::vector<float> right(filterFrames);
+    for (size_t channel = 0; channel < kChannelCount; channel++) {
+        makeSphericalHeadHrir(kSampleRate, kAzimuths[channel], kElevations[channel], left.data(),
+                              right.data(), filterFrames);
+        convolver.setFilter(channel, left.data(), right.data(), filterFrames);
+    }
+    std::vector<float> input(kFrameCount * kChannelCount);
+    for (size_t i = 0; i < input.size(); i++) {
+        input[i] = static_cast<float>(i % 97) / 97.f - 0.5f;
+    }
+    std::vector<float> output(kFrameCount * 2);
+
+    for (auto _ : state) {
+        convolver.process(input.data(), output.data(), kFrameCount);
+        benchmark::DoNotOptimize(output.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kFrameCount);
+    state.counters["realtime"] = benchmark::Counter(
+            state.iterations() * kFrameCount / kSampleRate, benchmark::Counter::kIsRate);
+}
+
+BENCHMARK(BM_BinauralConvolver7Point1Point4)
+        ->ArgsProduct({{64, 128, 256, 512}, {256, 1024, 4096}});
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "dsp/Downmix.h"
+
+using aidl::android::hardware::audio::effect::dsp::StereoDownmixer;
+
+static void BM_StereoDownmixer(benchmark::State& state) {
+    constexpr size_t kFrameCount = 480;
+    StereoDownmixer downmixer;
+    downmixer.configure(static_cast<StereoDownmixer::Layout>(state.range(0)));
+    std::vector<float> input(kFrameCount * downmixer.getChannelCount());
+    for (size_t i = 0; i < input.size(); i++) {
+        input[i] = static_cast<float>(i % 101) / 101.f - 0.5f;
+    }
+    std::vector<float> output(kFrameCount * 2);
+
+    for (auto _ : state) {
+        downmixer.process(input.data(), output.data(), kFrameCount);
+        benchmark::DoNotOptimize(output.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kFrameCount);
+}
+
+BENCHMARK(BM_StereoDownmixer)
+        ->ArgName("layout")
+        ->Arg(static_cast<int>(StereoDownmixer::Layout::k5Point1))
+        ->Arg(static_cast<int>(StereoDownmixer::Layout::k7Point1))
+        ->Arg(static_cast<int>(StereoDownmixer::Layout::k7Point1Point4))
+        ->Arg(static_cast<int>(StereoDownmixer::Layout::k9Point1Point6));
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "dsp/DynamicsProcessor.h"
+
+using aidl::android::hardware::audio::effect::dsp::DynamicsProcessor;
+
+namespace {
+
+constexpr float kSampleRate = 48000.f;
+constexpr size_t kFrameCount = 480;  // 10 ms, the EffectThread buffer at 48 kHz
+
+// Every stage in use and enabled on every channel.
+void configureFullChain(DynamicsProcessor* processor, size_t channelCount, size_t mbcBandCount) {
+    constexpr size_t kEqBandCount = 6;
+    processor->configure(kSampleRate, channelCount,
+                         {.preEqBandCount = kEqBandCount,
+                          .mbcBandCount = mbcBandCount,
+                          .postEqBandCount = kEqBandCount,
+                          .limiterInUse = true});
+    for (size_t channel = 0; channel < channelCount; channel++) {
+        processor->setInputGain(channel, -1);
+        processor->setPreEqEnabled(channel, true);
+        processor->setPostEqEnabled(channel, true);
+        for (size_t band = 0; band < kEqBandCount; band++) {
+            const DynamicsProcessor::EqBand eqBand = {
+                    .enable = true,
+                    .cutoffFrequencyHz = 100.f * (1 << (band * 2)),
+                    .gainDb = band % 2 ? 3.f : -3.f};
+            processor->setPreEqBand(channel, band, eqBand);
+            processor->setPostEqBand(channel, band, eqBand);
+        }
+        processor->setMbcEnabled(channel, true);
+        for (size_t band = 0; band < mbcBandCount; band++) {
+            processor->setMbcBand(channel, band,
+                                  {.enable = true,
+                                   .cutoffFrequencyHz = 150.f * (1 << (band * 2)),
+                                   .attackTimeMs = 3,
+                                   .releaseTimeMs = 80,
+                                   .ratio = 3,
+                                   .thresholdDb = -24,
+                                   .kneeWidthDb = 6,
+                                   .noiseGateThresholdDb = -70,
+                                   .expanderRatio = 2,
+                                   .postGainDb = 3});
+        }
+        processor->setLimiter(channel, {.enable = true,
+                                        .linkGroup = static_cast<int32_t>(channel / 2),
+                                        .attackTimeMs = 1,
+                                        .releaseTimeMs = 60,
+                                        .ratio = 10,
+                                        .thresholdDb = -2});
+    }
+}
+
+}  // namespace
+
+// Full chain on a 10 ms buffer. The "realtime" counter is the seconds of audio processed per
+// second, the engine fits the EffectThread budget as long as it stays well above 1.
+static void BM_DynamicsProcessor(benchmark::State& state) {
+    const size_t channelCount = state.range(0);
+    const size_t mbcBandCount = state.range(1);
+    DynamicsProcessor processor;
+    configureFullChain(&processor, channelCount, mbcBandCount);
+    std::vector<float> input(kFrameCount * channelCount);
+    for (size_t i = 0; i < input.size(); i++) {
+        input[i] = static_cast<float>(i % 101) / 101.f - 0.5f;
+    }
+    std::vector<float> output(input.size());
+
+    for (auto _ : state) {
+        processor.process(input.data(), output.data(), kFrameCount);
+        benchmark::DoNotOptimize(output.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kFrameCount);
+    state.counters["realtime"] = benchmark::Counter(
+            state.iterations() * kFrameCount / kSampleRate, benchmark::Counter::kIsRate);
+}
+
+BENCHMARK(BM_DynamicsProcessor)
+        ->ArgNames({"channels", "mbcBands"})
+        ->ArgsProduct({{2, 6, 8}, {1, 3, 5}});
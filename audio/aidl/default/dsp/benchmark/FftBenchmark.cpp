@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "dsp/Fft.h"
+
+using aidl::android::hardware::audio::effect::dsp::Fft;
+
+// Forward transform of the visualizer capture sizes, reported in transforms per second.
+static void BM_Fft(benchmark::State& state) {
+    const size_t size = state.range(0);
+    Fft fft;
+    fft.configure(size);
+    std::vector<float> re(size);
+    std::vector<float> im(size);
+    for (size_t i = 0; i < size; i++) {
+        re[i] = static_cast<float>(i % 97) / 97.f - 0.5f;
+    }
+
+    for (auto _ : state) {
+        fft.forward(re.data(), im.data());
+        benchmark::DoNotOptimize(re.data());
+        benchmark::DoNotOptimize(im.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_Fft)->RangeMultiplier(2)->Range(128, 1024);
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdint>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "dsp/Gain.h"
+
+using aidl::android::hardware::audio::effect::dsp::GainRamp;
+
+namespace {
+
+constexpr size_t kFrameCount = 960;  // 20 ms at 48 kHz
+
+template <typename T>
+std::vector<T> makeInput(size_t channelCount, float scale) {
+    std::vector<T> buffer(kFrameCount * channelCount);
+    for (size_t i = 0; i < buffer.size(); i++) {
+        buffer[i] = static_cast<T>((static_cast<float>(i % 97) / 97.f - 0.5f) * scale);
+    }
+    return buffer;
+}
+
+template <typename T>
+void runGain(benchmark::State& state, float scale, bool ramping, GainRamp::Shape shape) {
+    const size_t channelCount = state.range(0);
+    GainRamp gain;
+    gain.configure(channelCount);
+    for (size_t channel = 0; channel < channelCount; channel++) {
+        gain.setGain(channel, 0.5f + 0.01f * channel, 0);
+    }
+    const std::vector<T> input = makeInput<T>(channelCount, scale);
+    std::vector<T> output(input.size());
+    float target = 0.5f;
+
+    for (auto _ : state) {
+        if (ramping) {
+            // Ramps over the whole buffer, every frame has its own gains.
+            target = target > 0.9f ? 0.1f : target + 0.1f;
+            gain.setGain(target, kFrameCount, shape);
+        }
+        gain.process(input.data(), output.data(), kFrameCount);
+        benchmark::DoNotOptimize(output.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kFrameCount);
+    state.SetBytesProcessed(state.iterations() * input.size() * sizeof(T));
+}
+
+}  // namespace
+
+// Steady per-channel gains, reported in frames per second for each channel count.
+static void BM_GainFloat(benchmark::State& state) {
+    runGain<float>(state, 1.f, false, GainRamp::Shape::kLinear);
+}
+
+static void BM_GainInt16(benchmark::State& state) {
+    runGain<int16_t>(state, 32767.f, false, GainRamp::Shape::kLinear);
+}
+
+static void BM_GainInt32(benchmark::State& state) {
+    runGain<int32_t>(state, 2147483520.f, false, GainRamp::Shape::kLinear);
+}
+
+static void BM_GainFloatLinearRamp(benchmark::State& state) {
+    runGain<float>(state, 1.f, true, GainRamp::Shape::kLinear);
+}
+
+static void BM_GainFloatExponentialRamp(benchmark::State& state) {
+    runGain<float>(state, 1.f, true, GainRamp::Shape::kExponential);
+}
+
+static void BM_GainInt16LinearRamp(benchmark::State& state) {
+    runGain<int16_t>(state, 32767.f, true, GainRamp::Shape::kLinear);
+}
+
+static void gainChannelCounts(benchmark::internal::Benchmark* b) {
+    for (int channelCount : {1, 2, 3, 6, 8, 16}) {
+        b->Arg(channelCount);
+    }
+}
+
+BENCHMARK(BM_GainFloat)->Apply(gainChannelCounts);
+BENCHMARK(BM_GainInt16)->Apply(gainChannelCounts);
+BENCHMARK(BM_GainInt32)->Apply(gainChannelCounts);
+BENCHMARK(BM_GainFloatLinearRamp)->Apply(gainChannelCounts);
+BENCHMARK(BM_GainFloatExponentialRamp)->Apply(gainChannelCounts);
+BENCHMARK(BM_GainInt16LinearRamp)->Apply(gainChannelCounts);
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include "dsp/Simd.h"
+
+namespace aidl::android::hardware::audio::effect::dsp {
+
+/**
+ * Normalized (a0 == 1) second order section coefficients:
+ * H(z) = (b0 + b1 * z^-1 + b2 * z^-2) / (1 + a1 * z^-1 + a2 * z^-2).
+ *
+ * The designers follow the RBJ audio EQ cookbook. Frequencies are clamped into (0, Nyquist), so a
+ * fixed set of band frequencies can be used at any sample rate.
+ */
+struct BiquadCoefficients {
+    float b0 = 1.f;
+    float b1 = 0.f;
+    float b2 = 0.f;
+    float a1 = 0.f;
+    float a2 = 0.f;
+
+    static BiquadCoefficients peaking(float sampleRate, float frequency, float q, float gainDb);
+    static BiquadCoefficients lowShelf(float sampleRate, float frequency, float q, float gainDb);
+    static BiquadCoefficients highShelf(float sampleRate, float frequency, float q, float gainDb);
+    static BiquadCoefficients lowPass(float sampleRate, float frequency, float q);
+    static BiquadCoefficients highPass(float sampleRate, float frequency, float q);
+    static BiquadCoefficients allPass(float sampleRate, float frequency, float q);
+
+    // Magnitude of the frequency response at 'frequency', linear scale.
+    float getMagnitude(float sampleRate, float frequency) const;
+
+    bool operator==(const BiquadCoefficients& other) const = default;
+};
+
+/**
+ * A cascade of biquad sections (transposed direct form II) over interleaved float audio.
+ *
+ * Channels are processed four at a time in one float4, so a frame of N channels takes
+ * ceil(N / 4) vector passes per section instead of N scalar ones. Each channel has its own
+ * coefficients, stored lane by lane so that channels with different filters still share the
+ * vector pass. All state is held in fixed size arrays, nothing is allocated after construction and
+ * process() is real time safe.
+ *
+ * Coefficient changes can be ramped: the coefficients of every section move linearly from their
+ * current value to the target in steps of kRampBlockFrames frames. Each intermediate set lies on
+ * the segment between two stable filters, and the stability region of a biquad (|a2| < 1,
+ * |a1| < 1 + a2) is convex, so the ramp never passes through an unstable filter and band level
+ * changes are click free.
+ */
+class BiquadCascade {
+  public:
+    static constexpr size_t kMaxStages = 16;
+    static constexpr size_t kMaxChannels = 32;
+    // Coefficients are held constant within blocks of this many frames while ramping.
+    static constexpr size_t kRampBlockFrames = 32;
+    static constexpr size_t kDefaultRampFrames = 256;
+
+    /**
+     * Sets the channel count and number of sections, all sections reset to pass through and the
+     * filter state is cleared. Returns false if either count is 0 or above the limits.
+     */
+    bool configure(size_t channelCount, size_t stageCount);
+
+    /**
+     * Sets the coefficients of section 'stage' for all channels, or for 'channel' only. With
+     * 'rampFrames' of 0 the change is immediate, otherwise all sections glide from their current
+     * to their target coefficients within 'rampFrames' frames, restarting any ongoing ramp from
+     * where it is.
+     */
+    void setCoefficients(size_t stage, const BiquadCoefficients& coefficients,
+                         size_t rampFrames = kDefaultRampFrames);
+    void setCoefficients(size_t stage, size_t channel, const BiquadCoefficients& coefficients,
+                         size_t rampFrames = kDefaultRampFrames);
+
+    // Clears the filter state, keeps the coefficients.
+    void reset();
+
+    /**
+     * Filters 'frameCount' interleaved frames from 'in' to 'out', which may be the same buffer.
+     */
+    void process(const float* in, float* out, size_t frameCount);
+
+    size_t getChannelCount() const { return mChannelCount; }
+    size_t getStageCount() const { return mStageCount; }
+    bool isRamping() const { return mRampBlocksLeft > 0; }
+    BiquadCoefficients getCoefficients(size_t stage, size_t channel = 0) const;
+
+  private:
+    static constexpr size_t kMaxGroups = kMaxChannels / kFloat4Lanes;
+
+    // The coefficients of a group of four channels, one channel per lane.
+    struct Coefficients4 {
+        float4 b0, b1, b2, a1, a2;
+    };
+    using StageCoefficients = std::array<Coefficients4, kMaxGroups>;
+
+    size_t mChannelCount = 0;
+    size_t mGroupCount = 0;
+    size_t mStageCount = 0;
+    std::array<StageCoefficients, kMaxStages> mCurrent = {};
+    std::array<StageCoefficients, kMaxStages> mTarget = {};
+    std::array<StageCoefficients, kMaxStages> mStep = {};
+    size_t mRampBlocksLeft = 0;
+    // Transposed direct form II state per section, per group of four channels.
+    std::array<std::array<float4, kMaxGroups>, kMaxStages> mS1 = {};
+    std::array<std::array<float4, kMaxGroups>, kMaxStages> mS2 = {};
+
+    void setLane(size_t stage, size_t channel, const BiquadCoefficients& coefficients,
+                 size_t rampFrames);
+    void startRamp(size_t rampFrames);
+    void processBlock(const float* in, float* out, size_t frameCount);
+    void advanceRamp();
+};
+
+}  // namespace aidl::android::hardware::audio::effect::dsp
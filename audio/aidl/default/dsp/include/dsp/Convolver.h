@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "dsp/Fft.h"
+
+namespace aidl::android::hardware::audio::effect::dsp {
+
+/**
+ * Renders interleaved multichannel audio to stereo (binaural) through a pair of impulse
+ * responses per input channel, with a uniformly partitioned overlap-save convolution.
+ *
+ * The impulse responses are cut into partitions of one block, and the spectrum of every input
+ * block is kept in a frequency domain delay line, so each output block is the sum over channels
+ * and partitions of input spectra times partition spectra, followed by one inverse transform.
+ * The output is delayed by exactly one block, whatever the length of the responses.
+ *
+ * The left and right responses of a channel are transformed together as one complex signal
+ * (left + i * right). Since the input is real, multiplying its spectrum by that combined spectrum
+ * yields the left output spectrum plus i times the right one, so a single complex multiply
+ * accumulate per bin, done on float4s, and a single inverse transform serve both ears.
+ *
+ * configure() allocates, and one FFT plan is shared by all the transforms. The other calls are
+ * real time safe.
+ */
+class BinauralConvolver {
+  public:
+    static constexpr size_t kMaxChannels = 32;
+    static constexpr size_t kMinBlockFrames = 4;
+    static constexpr size_t kMaxBlockFrames = 4096;
+
+    /**
+     * Sets the channel count, the block size, which must be a power of two within
+     * [kMinBlockFrames, kMaxBlockFrames], and the longest impulse response that setFilter()
+     * accepts. All filters are cleared. Returns false if an argument is out of range.
+     */
+    bool configure(size_t channelCount, size_t blockFrames, size_t maxFilterFrames);
+
+    /**
+     * Sets the responses from input 'channel' to the left and right outputs, 'frameCount' taps
+     * each, at most the configured maximum. A 'frameCount' of 0 silences the channel and saves
+     * its transforms. Returns false if an argument is out of range.
+     */
+    bool setFilter(size_t channel, const float* left, const float* right, size_t frameCount);
+
+    // Clears the input history and the pending output, keeps the filters.
+    void reset();
+
+    /**
+     * Renders 'frameCount' interleaved frames of getChannelCount() channels from 'in' to
+     * interleaved stereo 'out'. 'out' may be the same buffer as 'in' if there are at least two
+     * input channels.
+     */
+    void process(const float* in, float* out, size_t frameCount);
+
+    size_t getChannelCount() const { return mChannelCount; }
+    size_t getLatencyFrames() const { return mBlockFrames; }
+
+  private:
+    size_t mChannelCount = 0;
+    size_t mBlockFrames = 0;
+    // Transform size, two blocks.
+    size_t mFftSize = 0;
+    size_t mPartitionCount = 0;
+    Fft mFft;
+
+    // Per channel: the number of partitions in use, 0 for a silent channel.
+    std::vector<size_t> mChannelPartitions;
+    // Per channel and partition, mFftSize bins: the combined left + i * right spectrum.
+    std::vector<float> mFilterRe;
+    std::vector<float> mFilterIm;
+    // Per channel and delay line slot, mFftSize bins: the spectra of the latest input blocks.
+    std::vector<float> mInputSpectraRe;
+    std::vector<float> mInputSpectraIm;
+    // The delay line slot of the latest input block.
+    size_t mNewestSlot = 0;
+
+    // Per channel, the previous and the current input block.
+    std::vector<float> mInputBlocks;
+    // The output block being played, interleaved stereo.
+    std::vector<float> mOutputBlock;
+    // Frames of the current block received so far.
+    size_t mBlockPosition = 0;
+
+    std::vector<float> mWorkRe;
+    std::vector<float> mWorkIm;
+    std::vector<float> mSumRe;
+    std::vector<float> mSumIm;
+
+    void processBlock();
+    float* filterRe(size_t channel, size_t partition) {
+        return &mFilterRe[(channel * mPartitionCount + partition) * mFftSize];
+    }
+    float* filterIm(size_t channel, size_t partition) {
+        return &mFilterIm[(channel * mPartitionCount + partition) * mFftSize];
+    }
+    float* inputSpectrumRe(size_t channel, size_t slot) {
+        return &mInputSpectraRe[(channel * mPartitionCount + slot) * mFftSize];
+    }
+    float* inputSpectrumIm(size_t channel, size_t slot) {
+        return &mInputSpectraIm[(channel * mPartitionCount + slot) * mFftSize];
+    }
+};
+
+/**
+ * Head related impulse responses of a rigid spherical head (Brown and Duda, 1998): for each ear,
+ * the interaural time difference and a first order head shadow filter, both functions of the
+ * angle between the source and the ear. There is no pinna or room model, so elevation only acts
+ * through that angle. It stands in for measured responses in the reference implementation.
+ *
+ * The azimuth is in degrees clockwise from the front, the elevation in degrees above the
+ * horizontal plane. 'left' and 'right' receive 'frameCount' taps each.
+ */
+void makeSphericalHeadHrir(float sampleRate, float azimuthDegrees, float elevationDegrees,
+                           float* left, float* right, size_t frameCount);
+
+}  // namespace aidl::android::hardware::audio::effect::dsp
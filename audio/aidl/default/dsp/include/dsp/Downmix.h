@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace aidl::android::hardware::audio::effect::dsp {
+
+/**
+ * Folds the standard multichannel layouts to stereo.
+ *
+ * Every layout has a mixing matrix computed at compile time and a kernel specialized for it, so
+ * the channel count and the coefficients are constants in the inner loop. configure() only picks
+ * the kernel, process() does no allocation and is real time safe.
+ *
+ * Each channel is mixed to its own side, or to both sides at -3 dB for the center and LFE
+ * channels. Channels other than the front left and right (and the front wides, which are further
+ * forward than the surrounds) are attenuated by 3 dB. The rows are then normalized to a sum of 1,
+ * so that correlated full scale input cannot clip.
+ */
+class StereoDownmixer {
+  public:
+    // The channels of each layout are interleaved in AudioChannelLayout bit order.
+    enum class Layout {
+        k5Point1,
+        k7Point1,
+        k7Point1Point4,
+        k9Point1Point6,
+    };
+
+    static size_t getChannelCount(Layout layout);
+
+    void configure(Layout layout);
+
+    /**
+     * Folds 'frameCount' interleaved frames from 'in' to stereo 'out'. 'out' may be the same
+     * buffer as 'in', the output is written behind the input that is still to be read.
+     */
+    void process(const float* in, float* out, size_t frameCount) const;
+
+    Layout getLayout() const { return mLayout; }
+    size_t getChannelCount() const { return getChannelCount(mLayout); }
+    // The gain of input 'channel' in the left (side 0) or right (side 1) output.
+    float getCoefficient(size_t channel, size_t side) const;
+
+  private:
+    using Kernel = void (*)(const float* in, float* out, size_t frameCount);
+
+    Layout mLayout = Layout::k5Point1;
+    Kernel mKernel = nullptr;
+};
+
+/**
+ * Keeps the first two channels of each of 'frameCount' frames of 'channelCount' channels. 'out'
+ * may be the same buffer as 'in'.
+ */
+void stripToStereo(const float* in, float* out, size_t channelCount, size_t frameCount);
+
+}  // namespace aidl::android::hardware::audio::effect::dsp
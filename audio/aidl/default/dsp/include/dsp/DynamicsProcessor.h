@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "dsp/Biquad.h"
+#include "dsp/Simd.h"
+
+namespace aidl::android::hardware::audio::effect::dsp {
+
+/**
+ * The DynamicsProcessing signal chain: input gain, pre-EQ, multi-band compressor (MBC), post-EQ
+ * and limiter, each configured per channel.
+ *
+ * The configuration structures mirror the DynamicsProcessing AIDL parcelables without depending on
+ * them. As in the AIDL, the cutoff frequency of an EQ or MBC band is its upper edge.
+ *
+ * Audio is processed in blocks of kBlockFrames frames. Within a block every per-sample operation
+ * (filters, peak detection and gain application) runs on groups of four channels in one float4.
+ * The envelope followers and gain computers run once per block and per channel, and the gains are
+ * linearly interpolated across the next block, so the transcendental math is amortized over the
+ * block while the gain stays continuous.
+ *
+ * configure() allocates, all the other calls are real time safe.
+ */
+class DynamicsProcessor {
+  public:
+    static constexpr size_t kMaxChannels = BiquadCascade::kMaxChannels;
+    static constexpr size_t kMaxEqBands = BiquadCascade::kMaxStages;
+    static constexpr size_t kMaxMbcBands = 8;
+    static constexpr size_t kBlockFrames = 32;
+
+    struct EqBand {
+        bool enable = false;
+        float cutoffFrequencyHz = 0;
+        float gainDb = 0;
+    };
+
+    struct MbcBand {
+        bool enable = false;
+        float cutoffFrequencyHz = 0;
+        float attackTimeMs = 0;
+        float releaseTimeMs = 0;
+        float ratio = 1;
+        float thresholdDb = 0;
+        float kneeWidthDb = 0;
+        float noiseGateThresholdDb = 0;
+        float expanderRatio = 1;
+        float preGainDb = 0;
+        float postGainDb = 0;
+    };
+
+    struct Limiter {
+        bool enable = false;
+        // Channels in the same link group are limited by the loudest of them.
+        int32_t linkGroup = 0;
+        float attackTimeMs = 0;
+        float releaseTimeMs = 0;
+        float ratio = 1;
+        float thresholdDb = 0;
+        float postGainDb = 0;
+    };
+
+    // A band count of 0 means the stage is not in use.
+    struct Architecture {
+        size_t preEqBandCount = 0;
+        size_t mbcBandCount = 0;
+        size_t postEqBandCount = 0;
+        bool limiterInUse = false;
+    };
+
+    /**
+     * Sets the stream format and stage layout. All channels and bands are reset to disabled, the
+     * input gains to 0 dB. Returns false if a count is out of range.
+     */
+    bool configure(float sampleRate, size_t channelCount, const Architecture& architecture);
+
+    void setInputGain(size_t channel, float gainDb);
+    void setPreEqEnabled(size_t channel, bool enable);
+    void setPreEqBand(size_t channel, size_t band, const EqBand& config);
+    void setPostEqEnabled(size_t channel, bool enable);
+    void setPostEqBand(size_t channel, size_t band, const EqBand& config);
+    void setMbcEnabled(size_t channel, bool enable);
+    void setMbcBand(size_t channel, size_t band, const MbcBand& config);
+    void setLimiter(size_t channel, const Limiter& config);
+
+    /**
+     * Processes 'frameCount' interleaved frames from 'in' to 'out', which may be the same buffer.
+     */
+    void process(const float* in, float* out, size_t frameCount);
+
+    size_t getChannelCount() const { return mChannelCount; }
+
+  private:
+    static constexpr size_t kMaxGroups = kMaxChannels / kFloat4Lanes;
+    using Lanes = std::array<float4, kMaxGroups>;
+
+    // An equalizer stage, one biquad section per band.
+    struct Equalizer {
+        size_t bandCount = 0;
+        std::vector<bool> channelEnabled;
+        // channel * bandCount + band
+        std::vector<EqBand> bands;
+        BiquadCascade filters;
+    };
+
+    // Block rate envelope follower and the gain it drives, per channel lane.
+    struct Envelope {
+        Lanes attack = {};
+        Lanes release = {};
+        Lanes level = {};
+        // The linear gain reached at the end of the last block.
+        Lanes gain = {};
+    };
+
+    float mSampleRate = 0;
+    size_t mChannelCount = 0;
+    size_t mGroupCount = 0;
+    // Channel stride of the internal buffers, the channel count rounded up to whole float4s.
+    size_t mStride = 0;
+
+    Lanes mInputGain = {};
+    Lanes mInputGainTarget = {};
+    Equalizer mPreEq;
+    Equalizer mPostEq;
+
+    size_t mMbcBandCount = 0;
+    std::vector<bool> mMbcChannelEnabled;
+    // channel * mMbcBandCount + band
+    std::vector<MbcBand> mMbcBands;
+    // Linkwitz-Riley crossovers between band i and the bands above it, two sections each.
+    std::array<BiquadCascade, kMaxMbcBands - 1> mMbcLowPass;
+    std::array<BiquadCascade, kMaxMbcBands - 1> mMbcHighPass;
+    // The all-pass responses of the crossovers above band i, applied to band i so that the sum of
+    // the bands has a flat magnitude response.
+    std::array<BiquadCascade, kMaxMbcBands - 2> mMbcPhaseCompensation;
+    std::array<Envelope, kMaxMbcBands> mMbcEnvelopes;
+
+    bool mLimiterInUse = false;
+    std::vector<Limiter> mLimiters;
+    Envelope mLimiterEnvelope;
+
+    std::vector<float> mWork;
+    // mMbcBandCount - 1 band buffers, the top band is processed in mWork.
+    std::vector<float> mBandBuffers;
+
+    void processBlock(const float* in, float* out, size_t frameCount);
+    void processMbc(size_t frameCount);
+    void processLimiter(size_t frameCount);
+    void compressBand(float* buffer, size_t band, size_t frameCount);
+
+    void configureEqualizer(Equalizer* eq, size_t bandCount);
+    void updateEqualizer(Equalizer* eq, size_t channel);
+    void updateMbc(size_t channel, size_t rampFrames = BiquadCascade::kDefaultRampFrames);
+
+    // Measures the peak of each lane over the block and updates the envelope levels.
+    void trackEnvelope(const float* buffer, size_t frameCount, Envelope* envelope);
+    // Multiplies the buffer by gains interpolated from 'gains' to 'targets', then stores the
+    // targets in 'gains'.
+    void applyGainRamp(float* buffer, size_t frameCount, Lanes* gains, const Lanes& targets);
+    float getLevelDb(const Envelope& envelope, size_t channel) const;
+    void setEnvelopeTimes(Envelope* envelope, size_t channel, float attackTimeMs,
+                          float releaseTimeMs);
+};
+
+}  // namespace aidl::android::hardware::audio::effect::dsp
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace aidl::android::hardware::audio::effect::dsp {
+
+/**
+ * Radix-2 complex FFT over split real and imaginary arrays.
+ *
+ * The transform is an iterative decimation in time after a bit reversal permutation. The twiddle
+ * factors of each stage are stored contiguously, so from the stage with four butterflies per
+ * group onwards, four butterflies are computed at once on float4s. Only the first two stages run
+ * scalar.
+ *
+ * configure() allocates, forward() is real time safe.
+ */
+class Fft {
+  public:
+    static constexpr size_t kMinSize = 2;
+    static constexpr size_t kMaxSize = 1 << 16;
+
+    /**
+     * Sets the transform size, which must be a power of two within [kMinSize, kMaxSize]. Returns
+     * false otherwise.
+     */
+    bool configure(size_t size);
+
+    /**
+     * In place forward transform of getSize() points, X[k] = sum(x[n] * exp(-2 * pi * i * k * n /
+     * size)), unscaled.
+     */
+    void forward(float* re, float* im) const;
+
+    size_t getSize() const { return mSize; }
+
+  private:
+    size_t mSize = 0;
+    // Index pairs exchanged by the bit reversal permutation.
+    std::vector<std::pair<uint32_t, uint32_t>> mSwaps;
+    // exp(-pi * i * j / half) for j < half, for each stage; the stage of 'half' starts at
+    // 'half - 1'.
+    std::vector<float> mTwiddleRe;
+    std::vector<float> mTwiddleIm;
+};
+
+}  // namespace aidl::android::hardware::audio::effect::dsp
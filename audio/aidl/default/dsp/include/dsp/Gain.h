@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "dsp/Simd.h"
+
+namespace aidl::android::hardware::audio::effect::dsp {
+
+// Linear gain of a level in millibels.
+float millibelsToGain(float levelMb);
+
+/**
+ * Per-channel gain over interleaved float, 16 bit or 32 bit integer PCM, with ramped changes.
+ *
+ * While the gains are steady, the buffer is processed as a flat run of samples in float4s,
+ * multiplied by a precomputed pattern of the channel gains that repeats every lcm(channels, 4)
+ * samples, so that any channel count uses full vectors. During a ramp, each frame is processed
+ * four channels at a time, one channel per lane, and the gains move every frame.
+ *
+ * A linear ramp moves the gains by a constant step, which suits fades to and from silence. An
+ * exponential ramp moves them by a constant factor, that is by a constant number of dB per frame,
+ * which sounds even for level changes. Since an exponential ramp cannot start or end at 0, gains
+ * below kMinExponentialGain are raised to it for the ramp and the exact target is set at its end.
+ *
+ * Integer samples are converted to float, scaled, rounded to nearest and saturated. A 32 bit
+ * sample keeps the 24 bit precision of the float mantissa unless the gain is unity, in which case
+ * it is copied.
+ *
+ * All state is held in fixed size arrays, nothing is allocated and every call is real time safe.
+ */
+class GainRamp {
+  public:
+    enum class Shape {
+        kLinear,
+        kExponential,
+    };
+
+    static constexpr size_t kMaxChannels = 32;
+    static constexpr size_t kDefaultRampFrames = 256;
+    // -80 dB.
+    static constexpr float kMinExponentialGain = 1e-4f;
+
+    /**
+     * Sets the channel count and resets all gains to unity. Returns false if the count is 0 or
+     * above kMaxChannels, in which case the ramp is left unconfigured.
+     */
+    bool configure(size_t channelCount);
+    /**
+     * As above, for an effect from 'inputChannelCount' to 'outputChannelCount' channels. The gain
+     * is applied in place, so the ramp is left unconfigured unless the counts are the same.
+     */
+    bool configure(size_t inputChannelCount, size_t outputChannelCount);
+
+    /**
+     * Sets the gain of all channels, or of 'channel' only. Negative gains are taken as 0. With
+     * 'rampFrames' of 0 the change is immediate, otherwise all channels move from their current
+     * to their target gain along 'shape' in 'rampFrames' frames, restarting any ongoing ramp from
+     * where it is.
+     */
+    void setGain(float gain, size_t rampFrames = kDefaultRampFrames, Shape shape = Shape::kLinear);
+    void setGain(size_t channel, float gain, size_t rampFrames = kDefaultRampFrames,
+                 Shape shape = Shape::kLinear);
+
+    /**
+     * Scales 'frameCount' interleaved frames from 'in' to 'out', which may be the same buffer.
+     */
+    void process(const float* in, float* out, size_t frameCount);
+    void process(const int16_t* in, int16_t* out, size_t frameCount);
+    void process(const int32_t* in, int32_t* out, size_t frameCount);
+    /**
+     * Scales 'sampleCount' interleaved float samples, as passed to an effect, from 'in' to 'out'.
+     * A trailing partial frame is passed through, and so is everything while unconfigured.
+     */
+    void processInterleaved(const float* in, float* out, size_t sampleCount);
+
+    size_t getChannelCount() const { return mChannelCount; }
+    bool isRamping() const { return mRampFramesLeft > 0; }
+    // True if the gains are steady at 1, so that processing is a copy.
+    bool isUnity() const { return !isRamping() && mUnity; }
+    float getGain(size_t channel) const;
+    float getTargetGain(size_t channel) const;
+
+  private:
+    static constexpr size_t kMaxGroups = kMaxChannels / kFloat4Lanes;
+    // lcm(channels, 4) is at most 4 * channels.
+    static constexpr size_t kMaxPatternSize = kFloat4Lanes * kMaxChannels;
+
+    size_t mChannelCount = 0;
+    size_t mGroupCount = 0;
+    // The gains of a group of four channels, one channel per lane.
+    std::array<float4, kMaxGroups> mCurrent = {};
+    std::array<float4, kMaxGroups> mTarget = {};
+    // Added to (linear) or multiplied into (exponential) the current gains every frame.
+    std::array<float4, kMaxGroups> mStep = {};
+    Shape mShape = Shape::kLinear;
+    size_t mRampFramesLeft = 0;
+
+    // The steady gains repeated over mPatternSize samples.
+    std::array<float, kMaxPatternSize> mPattern = {};
+    size_t mPatternSize = 0;
+    bool mUnity = true;
+
+    void setLane(size_t channel, float gain, size_t rampFrames);
+    void startRamp(size_t rampFrames, Shape shape);
+    void finishRamp();
+
+    template <typename T>
+    void processImpl(const T* in, T* out, size_t frameCount);
+    template <typename T>
+    void processRamp(const T* in, T* out, size_t frameCount);
+    template <typename T>
+    void processSteady(const T* in, T* out, size_t sampleCount) const;
+};
+
+}  // namespace aidl::android::hardware::audio::effect::dsp
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace aidl::android::hardware::audio::effect::dsp {
+
+/**
+ * Four float lanes, lowered by clang to one NEON (arm64) or SSE (x86_64) register. The generic
+ * vector extension keeps the kernels portable across the architectures the reference HAL is built
+ * for, while arithmetic on float4 compiles to the native SIMD instructions.
+ */
+typedef float float4 __attribute__((vector_size(4 * sizeof(float))));
+// Result type of float4 comparisons: all bits set in the lanes where the comparison holds.
+typedef int32_t int4 __attribute__((vector_size(4 * sizeof(int32_t))));
+
+constexpr size_t kFloat4Lanes = 4;
+
+inline float4 broadcastFloat4(float value) {
+    return float4{value, value, value, value};
+}
+
+// Interleaved audio buffers have no alignment guarantee, memcpy compiles to an unaligned load.
+inline float4 loadFloat4(const float* src) {
+    float4 value;
+    std::memcpy(&value, src, sizeof(value));
+    return value;
+}
+
+inline void storeFloat4(float* dst, float4 value) {
+    std::memcpy(dst, &value, sizeof(value));
+}
+
+// Loads the first 'lanes' (< kFloat4Lanes) floats and zeroes the remaining lanes. Lane by lane
+// access rather than memcpy avoids a store forwarding stall, and unrolls when 'lanes' is constant.
+inline float4 loadFloat4Partial(const float* src, size_t lanes) {
+    float4 value = {};
+    for (size_t i = 0; i < lanes; i++) {
+        value[i] = src[i];
+    }
+    return value;
+}
+
+inline void storeFloat4Partial(float* dst, float4 value, size_t lanes) {
+    for (size_t i = 0; i < lanes; i++) {
+        dst[i] = value[i];
+    }
+}
+
+// Picks the lanes of 'a' where 'mask' is set and the lanes of 'b' elsewhere. Bitwise so that it
+// does not depend on vector ?: support.
+inline float4 selectFloat4(int4 mask, float4 a, float4 b) {
+    return (float4)((mask & (int4)a) | (~mask & (int4)b));
+}
+
+inline float4 maxFloat4(float4 a, float4 b) {
+    return selectFloat4(a > b, a, b);
+}
+
+inline float4 minFloat4(float4 a, float4 b) {
+    return selectFloat4(a < b, a, b);
+}
+
+inline float4 absFloat4(float4 value) {
+    return (float4)((int4)value & 0x7fffffff);
+}
+
+inline float maxLane(float4 value) {
+    return std::max(std::max(value[0], value[1]), std::max(value[2], value[3]));
+}
+
+}  // namespace aidl::android::hardware::audio::effect::dsp
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "dsp/Biquad.h"
+
+using aidl::android::hardware::audio::effect::dsp::BiquadCascade;
+using aidl::android::hardware::audio::effect::dsp::BiquadCoefficients;
+
+namespace {
+
+constexpr float kSampleRate = 48000.f;
+
+std::vector<float> makeNoise(size_t samples) {
+    std::vector<float> buffer(samples);
+    uint32_t seed = 1;
+    for (auto& sample : buffer) {
+        seed = seed * 1664525u + 1013904223u;
+        sample = static_cast<float>(seed >> 8) / (1u << 23) - 1.f;
+    }
+    return buffer;
+}
+
+// Scalar direct form I reference of one channel through the cascade.
+std::vector<float> referenceFilter(const std::vector<BiquadCoefficients>& stages,
+                                   const std::vector<float>& in, size_t channelCount,
+                                   size_t channel) {
+    std::vector<float> out;
+    std::vector<double> x1(stages.size()), x2(stages.size()), y1(stages.size()),
+            y2(stages.size());
+    for (size_t i = channel; i < in.size(); i += channelCount) {
+        double x = in[i];
+        for (size_t s = 0; s < stages.size(); s++) {
+            const auto& c = stages[s];
+            const double y = c.b0 * x + c.b1 * x1[s] + c.b2 * x2[s] - c.a1 * y1[s] - c.a2 * y2[s];
+            x2[s] = x1[s];
+            x1[s] = x;
+            y2[s] = y1[s];
+            y1[s] = y;
+            x = y;
+        }
+        out.push_back(static_cast<float>(x));
+    }
+    return out;
+}
+
+}  // namespace
+
+class BiquadCascadeChannelTest : public ::testing::TestWithParam<size_t> {};
+
+TEST_P(BiquadCascadeChannelTest, MatchesScalarReference) {
+    const size_t channelCount = GetParam();
+    const std::vector<BiquadCoefficients> stages = {
+            BiquadCoefficients::lowShelf(kSampleRate, 60, M_SQRT1_2, 6),
+            BiquadCoefficients::peaking(kSampleRate, 910, 0.7f, -9),
+            BiquadCoefficients::highShelf(kSampleRate, 14000, M_SQRT1_2, 3)};
+    BiquadCascade cascade;
+    ASSERT_TRUE(cascade.configure(channelCount, stages.size()));
+    for (size_t i = 0; i < stages.size(); i++) {
+        cascade.setCoefficients(i, stages[i], 0);
+    }
+    const std::vector<float> in = makeNoise(channelCount * 1000);
+    std::vector<float> out(in.size());
+
+    // Odd block sizes, and the second half in place.
+    cascade.process(in.data(), out.data(), 333);
+    cascade.process(in.data() + 333 * channelCount, out.data() + 333 * channelCount, 167);
+    std::copy(in.begin() + 500 * channelCount, in.end(), out.begin() + 500 * channelCount);
+    cascade.process(out.data() + 500 * channelCount, out.data() + 500 * channelCount, 500);
+
+    for (size_t channel = 0; channel < channelCount; channel++) {
+        const std::vector<float> expected = referenceFilter(stages, in, channelCount, channel);
+        for (size_t frame = 0; frame < expected.size(); frame++) {
+            ASSERT_NEAR(expected[frame], out[frame * channelCount + channel], 1e-3)
+                    << "channel " << channel << " frame " << frame;
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(BiquadTest, BiquadCascadeChannelTest,
+                         ::testing::Values(1, 2, 3, 4, 5, 6, 8, 12, 16));
+
+TEST(BiquadTest, DesignGains) {
+    const auto peaking = BiquadCoefficients::peaking(kSampleRate, 1000, 1, 6);
+    EXPECT_NEAR(20 * std::log10(peaking.getMagnitude(kSampleRate, 1000)), 6, 0.01);
+    EXPECT_NEAR(20 * std::log10(peaking.getMagnitude(kSampleRate, 20)), 0, 0.05);
+
+    const auto lowShelf = BiquadCoefficients::lowShelf(kSampleRate, 100, M_SQRT1_2, -12);
+    EXPECT_NEAR(20 * std::log10(lowShelf.getMagnitude(kSampleRate, 10)), -12, 0.1);
+    EXPECT_NEAR(20 * std::log10(lowShelf.getMagnitude(kSampleRate, 10000)), 0, 0.1);
+
+    const auto highShelf = BiquadCoefficients::highShelf(kSampleRate, 5000, M_SQRT1_2, 9);
+    EXPECT_NEAR(20 * std::log10(highShelf.getMagnitude(kSampleRate, 20000)), 9, 0.2);
+    EXPECT_NEAR(20 * std::log10(highShelf.getMagnitude(kSampleRate, 50)), 0, 0.1);
+
+    // 0 dB peaking and shelving sections are pass through.
+    EXPECT_EQ(BiquadCoefficients::peaking(kSampleRate, 1000, 1, 0).b0, 1.f);
+}
+
+TEST(BiquadTest, FrequencyAboveNyquistIsClamped) {
+    const auto coefficients = BiquadCoefficients::highShelf(16000, 14000, M_SQRT1_2, 6);
+    for (float c : {coefficients.b0, coefficients.b1, coefficients.b2, coefficients.a1,
+                    coefficients.a2}) {
+        EXPECT_TRUE(std::isfinite(c));
+    }
+}
+
+TEST(BiquadTest, RampReachesTargetSmoothly) {
+    BiquadCascade cascade;
+    ASSERT_TRUE(cascade.configure(1, 1));
+    std::vector<float> buffer(4096, 1.f);
+    cascade.process(buffer.data(), buffer.data(), buffer.size());
+    const auto target = BiquadCoefficients::lowShelf(kSampleRate, 1000, M_SQRT1_2, 12);
+    cascade.setCoefficients(0, target, 256);
+    EXPECT_TRUE(cascade.isRamping());
+
+    // The steady DC output rises towards the new shelf gain in small steps instead of jumping.
+    buffer.assign(256, 1.f);
+    cascade.process(buffer.data(), buffer.data(), buffer.size());
+    EXPECT_FALSE(cascade.isRamping());
+    EXPECT_EQ(cascade.getCoefficients(0), target);
+    for (size_t i = 1; i < buffer.size(); i++) {
+        EXPECT_LT(std::fabs(buffer[i] - buffer[i - 1]), 0.05f) << i;
+    }
+}
+
+TEST(BiquadTest, ConfigureLimits) {
+    BiquadCascade cascade;
+    EXPECT_FALSE(cascade.configure(0, 1));
+    EXPECT_FALSE(cascade.configure(1, 0));
+    EXPECT_FALSE(cascade.configure(BiquadCascade::kMaxChannels + 1, 1));
+    EXPECT_FALSE(cascade.configure(1, BiquadCascade::kMaxStages + 1));
+    EXPECT_TRUE(cascade.configure(BiquadCascade::kMaxChannels, BiquadCascade::kMaxStages));
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "dsp/Convolver.h"
+
+using aidl::android::hardware::audio::effect::dsp::BinauralConvolver;
+using aidl::android::hardware::audio::effect::dsp::makeSphericalHeadHrir;
+
+namespace {
+
+constexpr size_t kBlockFrames = 32;
+constexpr size_t kFilterFrames = 100;  // not a whole number of blocks
+constexpr size_t kFrameCount = 500;
+
+std::vector<float> makeNoise(size_t samples, uint32_t seed) {
+    std::vector<float> buffer(samples);
+    for (auto& sample : buffer) {
+        seed = seed * 1664525u + 1013904223u;
+        sample = static_cast<float>(seed >> 8) / (1u << 23) - 1.f;
+    }
+    return buffer;
+}
+
+// Direct time domain convolution in double, delayed by one block.
+std::vector<float> referenceRender(const std::vector<float>& in, size_t channelCount,
+                                   const std::vector<std::vector<float>>& left,
+                                   const std::vector<std::vector<float>>& right) {
+    const size_t frameCount = in.size() / channelCount;
+    std::vector<float> out(2 * frameCount);
+    for (size_t frame = kBlockFrames; frame < frameCount; frame++) {
+        const size_t inputFrame = frame - kBlockFrames;
+        for (size_t side = 0; side < 2; side++) {
+            double sum = 0;
+            for (size_t channel = 0; channel < channelCount; channel++) {
+                const auto& filter = side == 0 ? left[channel] : right[channel];
+                for (size_t tap = 0; tap < filter.size() && tap <= inputFrame; tap++) {
+                    sum += filter[tap] * in[(inputFrame - tap) * channelCount + channel];
+                }
+            }
+            out[frame * 2 + side] = sum;
+        }
+    }
+    return out;
+}
+
+}  // namespace
+
+TEST(BinauralConvolverTest, Configure) {
+    BinauralConvolver convolver;
+    EXPECT_FALSE(convolver.configure(0, kBlockFrames, kFilterFrames));
+    EXPECT_FALSE(convolver.configure(BinauralConvolver::kMaxChannels + 1, kBlockFrames,
+                                     kFilterFrames));
+    EXPECT_FALSE(convolver.configure(2, 48, kFilterFrames));
+    EXPECT_FALSE(convolver.configure(2, kBlockFrames, 0));
+    ASSERT_TRUE(convolver.configure(2, kBlockFrames, kFilterFrames));
+    EXPECT_EQ(kBlockFrames, convolver.getLatencyFrames());
+    const std::vector<float> filter(kFilterFrames + 50);
+    EXPECT_FALSE(convolver.setFilter(2, filter.data(), filter.data(), kFilterFrames));
+    // Rounded up to whole blocks.
+    EXPECT_TRUE(convolver.setFilter(1, filter.data(), filter.data(), 4 * kBlockFrames));
+    EXPECT_FALSE(convolver.setFilter(1, filter.data(), filter.data(), 4 * kBlockFrames + 1));
+}
+
+TEST(BinauralConvolverTest, MatchesDirectConvolution) {
+    constexpr size_t kChannelCount = 3;
+    BinauralConvolver convolver;
+    ASSERT_TRUE(convolver.configure(kChannelCount, kBlockFrames, kFilterFrames));
+    std::vector<std::vector<float>> left(kChannelCount);
+    std::vector<std::vector<float>> right(kChannelCount);
+    for (size_t channel = 0; channel < kChannelCount; channel++) {
+        // Channel 1 is silent.
+        const size_t taps = channel == 1 ? 0 : kFilterFrames - channel * 40;
+        left[channel] = makeNoise(taps, 10 + channel);
+        right[channel] = makeNoise(taps, 20 + channel);
+        ASSERT_TRUE(convolver.setFilter(channel, left[channel].data(), right[channel].data(),
+                                        taps));
+    }
+    const std::vector<float> in = makeNoise(kFrameCount * kChannelCount, 1);
+    const std::vector<float> expected = referenceRender(in, kChannelCount, left, right);
+
+    // In place and in uneven chunks, so that blocks straddle the calls.
+    std::vector<float> out(expected.size());
+    size_t frame = 0;
+    for (size_t chunk = 1; frame < kFrameCount; chunk = chunk * 3 % 61 + 1) {
+        const size_t frames = std::min(chunk, kFrameCount - frame);
+        std::vector<float> io(in.begin() + frame * kChannelCount,
+                              in.begin() + (frame + frames) * kChannelCount);
+        convolver.process(io.data(), io.data(), frames);
+        std::copy(io.begin(), io.begin() + 2 * frames, out.begin() + 2 * frame);
+        frame += frames;
+    }
+    for (size_t i = 0; i < expected.size(); i++) {
+        ASSERT_NEAR(expected[i], out[i], 1e-4f) << "frame " << i / 2 << " side " << i % 2;
+    }
+}
+
+TEST(BinauralConvolverTest, ResetClearsHistory) {
+    BinauralConvolver convolver;
+    ASSERT_TRUE(convolver.configure(1, kBlockFrames, kBlockFrames));
+    const std::vector<float> impulse = {1.f};
+    ASSERT_TRUE(convolver.setFilter(0, impulse.data(), impulse.data(), 1));
+    std::vector<float> in(kBlockFrames, 1.f);
+    std::vector<float> out(2 * kBlockFrames);
+    convolver.process(in.data(), out.data(), kBlockFrames);
+    convolver.reset();
+    std::fill(in.begin(), in.end(), 0.f);
+    convolver.process(in.data(), out.data(), kBlockFrames);
+    convolver.process(in.data(), out.data(), kBlockFrames);
+    EXPECT_TRUE(std::all_of(out.begin(), out.end(), [](float sample) { return sample == 0; }));
+}
+
+TEST(SphericalHeadHrirTest, MirrorImage) {
+    constexpr size_t kTaps = 128;
+    std::vector<float> left(kTaps), right(kTaps), mirroredLeft(kTaps), mirroredRight(kTaps);
+    makeSphericalHeadHrir(48000, 30, 10, left.data(), right.data(), kTaps);
+    makeSphericalHeadHrir(48000, -30, 10, mirroredLeft.data(), mirroredRight.data(), kTaps);
+    EXPECT_EQ(left, mirroredRight);
+    EXPECT_EQ(right, mirroredLeft);
+}
+
+TEST(SphericalHeadHrirTest, SourceOnTheRight) {
+    constexpr size_t kTaps = 128;
+    std::vector<float> left(kTaps), right(kTaps);
+    makeSphericalHeadHrir(48000, 90, 0, left.data(), right.data(), kTaps);
+    const auto onset = [](const std::vector<float>& response) {
+        return std::find_if(response.begin(), response.end(),
+                            [](float tap) { return std::abs(tap) > 1e-3f; }) -
+               response.begin();
+    };
+    // About 0.66 ms of interaural time difference.
+    EXPECT_NEAR(32, onset(left) - onset(right), 2);
+    const auto energy = [](const std::vector<float>& response) {
+        return std::inner_product(response.begin(), response.end(), response.begin(), 0.f);
+    };
+    EXPECT_GT(energy(right), 2 * energy(left));
+    // Both ears pass DC unchanged.
+    EXPECT_NEAR(1.f, std::accumulate(left.begin(), left.end(), 0.f), 1e-2f);
+    EXPECT_NEAR(1.f, std::accumulate(right.begin(), right.end(), 0.f), 1e-2f);
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "dsp/Downmix.h"
+
+using aidl::android::hardware::audio::effect::dsp::StereoDownmixer;
+using aidl::android::hardware::audio::effect::dsp::stripToStereo;
+
+namespace {
+
+constexpr size_t kFrameCount = 257;  // odd, so that the single frame tail runs too
+
+std::vector<float> makeInput(size_t channelCount) {
+    std::vector<float> buffer(kFrameCount * channelCount);
+    for (size_t i = 0; i < buffer.size(); i++) {
+        buffer[i] = static_cast<float>((i * 37) % 201) / 100.f - 1.f;
+    }
+    return buffer;
+}
+
+}  // namespace
+
+class StereoDownmixerTest : public ::testing::TestWithParam<StereoDownmixer::Layout> {
+  protected:
+    void SetUp() override {
+        mDownmixer.configure(GetParam());
+        mChannelCount = mDownmixer.getChannelCount();
+    }
+
+    // Out of place, accumulated in double from the published coefficients.
+    std::vector<float> getReference(const std::vector<float>& in) const {
+        std::vector<float> out(kFrameCount * 2);
+        for (size_t frame = 0; frame < kFrameCount; frame++) {
+            for (size_t side = 0; side < 2; side++) {
+                double sum = 0;
+                for (size_t channel = 0; channel < mChannelCount; channel++) {
+                    sum += in[frame * mChannelCount + channel] *
+                           mDownmixer.getCoefficient(channel, side);
+                }
+                out[frame * 2 + side] = sum;
+            }
+        }
+        return out;
+    }
+
+    StereoDownmixer mDownmixer;
+    size_t mChannelCount = 0;
+};
+
+TEST_P(StereoDownmixerTest, MatrixIsNormalizedAndSymmetric) {
+    float leftSum = 0;
+    float rightSum = 0;
+    for (size_t channel = 0; channel < mChannelCount; channel++) {
+        leftSum += mDownmixer.getCoefficient(channel, 0);
+        rightSum += mDownmixer.getCoefficient(channel, 1);
+    }
+    EXPECT_NEAR(1.f, leftSum, 1e-6);
+    EXPECT_NEAR(1.f, rightSum, 1e-6);
+    // Front left and right only go to their own side, the center goes to both equally.
+    EXPECT_EQ(0.f, mDownmixer.getCoefficient(0, 1));
+    EXPECT_EQ(0.f, mDownmixer.getCoefficient(1, 0));
+    EXPECT_EQ(mDownmixer.getCoefficient(2, 0), mDownmixer.getCoefficient(2, 1));
+    EXPECT_EQ(mDownmixer.getCoefficient(0, 0), mDownmixer.getCoefficient(1, 1));
+}
+
+TEST_P(StereoDownmixerTest, MatchesReference) {
+    const std::vector<float> in = makeInput(mChannelCount);
+    std::vector<float> out(kFrameCount * 2);
+    mDownmixer.process(in.data(), out.data(), kFrameCount);
+
+    const std::vector<float> reference = getReference(in);
+    for (size_t i = 0; i < out.size(); i++) {
+        ASSERT_NEAR(reference[i], out[i], 1e-6) << i;
+    }
+}
+
+TEST_P(StereoDownmixerTest, InPlace) {
+    std::vector<float> buffer = makeInput(mChannelCount);
+    const std::vector<float> reference = getReference(buffer);
+    mDownmixer.process(buffer.data(), buffer.data(), kFrameCount);
+
+    for (size_t i = 0; i < reference.size(); i++) {
+        ASSERT_NEAR(reference[i], buffer[i], 1e-6) << i;
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(Layouts, StereoDownmixerTest,
+                         ::testing::Values(StereoDownmixer::Layout::k5Point1,
+                                           StereoDownmixer::Layout::k7Point1,
+                                           StereoDownmixer::Layout::k7Point1Point4,
+                                           StereoDownmixer::Layout::k9Point1Point6));
+
+TEST(StripToStereoTest, KeepsFrontChannels) {
+    constexpr size_t kChannelCount = 6;
+    std::vector<float> buffer = makeInput(kChannelCount);
+    const std::vector<float> in = buffer;
+    stripToStereo(buffer.data(), buffer.data(), kChannelCount, kFrameCount);
+
+    for (size_t frame = 0; frame < kFrameCount; frame++) {
+        ASSERT_EQ(in[frame * kChannelCount], buffer[frame * 2]);
+        ASSERT_EQ(in[frame * kChannelCount + 1], buffer[frame * 2 + 1]);
+    }
+}
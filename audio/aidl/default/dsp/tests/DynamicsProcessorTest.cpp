@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "dsp/DynamicsProcessor.h"
+
+using aidl::android::hardware::audio::effect::dsp::DynamicsProcessor;
+
+namespace {
+
+constexpr float kSampleRate = 48000.f;
+constexpr size_t kFrameCount = 24000;
+
+// A sine of 'amplitude' on the channels set in 'channelMask', silence on the others.
+std::vector<float> makeSine(size_t channelCount, float frequency, float amplitude,
+                            uint32_t channelMask = ~0u) {
+    std::vector<float> buffer(kFrameCount * channelCount);
+    for (size_t frame = 0; frame < kFrameCount; frame++) {
+        const float sample = amplitude * std::sin(2 * M_PI * frequency * frame / kSampleRate);
+        for (size_t channel = 0; channel < channelCount; channel++) {
+            buffer[frame * channelCount + channel] = (channelMask >> channel) & 1 ? sample : 0.f;
+        }
+    }
+    return buffer;
+}
+
+// RMS level of a channel over the second half of the buffer, after the filters and envelopes
+// have settled. Unlike the sample peak it does not depend on the phase of the sine.
+float getSettledLevelDb(const std::vector<float>& buffer, size_t channelCount, size_t channel) {
+    double sum = 0;
+    for (size_t frame = kFrameCount / 2; frame < kFrameCount; frame++) {
+        const double sample = buffer[frame * channelCount + channel];
+        sum += sample * sample;
+    }
+    return 10 * std::log10(std::max(sum / (kFrameCount / 2), 1e-20));
+}
+
+// RMS level of a sine with peak level 'peakDb'.
+float sineLevelDb(float peakDb) {
+    return peakDb - 10 * std::log10(2.f);
+}
+
+DynamicsProcessor::MbcBand makeNeutralMbcBand(float cutoffFrequencyHz) {
+    return {.enable = true, .cutoffFrequencyHz = cutoffFrequencyHz, .noiseGateThresholdDb = -90};
+}
+
+}  // namespace
+
+TEST(DynamicsProcessorTest, ConfigureLimits) {
+    DynamicsProcessor processor;
+    EXPECT_FALSE(processor.configure(kSampleRate, 0, {}));
+    EXPECT_FALSE(processor.configure(kSampleRate, DynamicsProcessor::kMaxChannels + 1, {}));
+    EXPECT_FALSE(processor.configure(
+            kSampleRate, 2, {.mbcBandCount = DynamicsProcessor::kMaxMbcBands + 1}));
+    EXPECT_TRUE(processor.configure(kSampleRate, 2, {.preEqBandCount = 4, .limiterInUse = true}));
+}
+
+TEST(DynamicsProcessorTest, DisabledStagesArePassThrough) {
+    constexpr size_t kChannelCount = 6;
+    DynamicsProcessor processor;
+    ASSERT_TRUE(processor.configure(kSampleRate, kChannelCount,
+                                    {.preEqBandCount = 3, .postEqBandCount = 3,
+                                     .limiterInUse = true}));
+    // Only channel 1 has its pre-EQ enabled.
+    processor.setPreEqEnabled(1, true);
+    processor.setPreEqBand(1, 0, {.enable = true, .cutoffFrequencyHz = 200, .gainDb = 6});
+
+    const std::vector<float> in = makeSine(kChannelCount, 100, 0.5f);
+    std::vector<float> out(in.size());
+    processor.process(in.data(), out.data(), kFrameCount);
+
+    for (size_t frame = 0; frame < kFrameCount; frame++) {
+        for (size_t channel : {0, 2, 5}) {
+            ASSERT_EQ(in[frame * kChannelCount + channel], out[frame * kChannelCount + channel]);
+        }
+    }
+    EXPECT_GT(getSettledLevelDb(out, kChannelCount, 1),
+              getSettledLevelDb(in, kChannelCount, 1) + 3);
+}
+
+TEST(DynamicsProcessorTest, InputGain) {
+    DynamicsProcessor processor;
+    ASSERT_TRUE(processor.configure(kSampleRate, 2, {}));
+    processor.setInputGain(1, -6);
+
+    std::vector<float> buffer = makeSine(2, 1000, 0.5f);
+    processor.process(buffer.data(), buffer.data(), kFrameCount);
+
+    EXPECT_NEAR(getSettledLevelDb(buffer, 2, 0), sineLevelDb(-6.02f), 0.01);
+    EXPECT_NEAR(getSettledLevelDb(buffer, 2, 1), sineLevelDb(-12.02f), 0.01);
+}
+
+// With neutral bands the crossovers and their phase compensation sum back to a flat magnitude.
+TEST(DynamicsProcessorTest, NeutralMbcIsFlat) {
+    constexpr size_t kBandCount = 4;
+    constexpr float kCutoffs[kBandCount] = {200, 1000, 5000, 20000};
+    for (float frequency : {50.f, 200.f, 700.f, 3000.f, 5000.f, 12000.f}) {
+        DynamicsProcessor processor;
+        ASSERT_TRUE(processor.configure(kSampleRate, 1, {.mbcBandCount = kBandCount}));
+        processor.setMbcEnabled(0, true);
+        for (size_t band = 0; band < kBandCount; band++) {
+            processor.setMbcBand(0, band, makeNeutralMbcBand(kCutoffs[band]));
+        }
+
+        std::vector<float> buffer = makeSine(1, frequency, 0.5f);
+        processor.process(buffer.data(), buffer.data(), kFrameCount);
+
+        EXPECT_NEAR(getSettledLevelDb(buffer, 1, 0), sineLevelDb(-6.02f), 0.1) << frequency;
+    }
+}
+
+TEST(DynamicsProcessorTest, MbcCompressesAboveThreshold) {
+    DynamicsProcessor processor;
+    ASSERT_TRUE(processor.configure(kSampleRate, 1, {.mbcBandCount = 1}));
+    processor.setMbcEnabled(0, true);
+    auto band = makeNeutralMbcBand(20000);
+    band.attackTimeMs = 1;
+    band.releaseTimeMs = 50;
+    band.ratio = 4;
+    band.thresholdDb = -20;
+    processor.setMbcBand(0, 0, band);
+
+    std::vector<float> buffer = makeSine(1, 1000, 1.f);
+    processor.process(buffer.data(), buffer.data(), kFrameCount);
+
+    // 0 dB in, 20 dB over the threshold reduced to 5 dB.
+    EXPECT_NEAR(getSettledLevelDb(buffer, 1, 0), sineLevelDb(-15), 0.5);
+}
+
+TEST(DynamicsProcessorTest, MbcNoiseGateExpands) {
+    DynamicsProcessor processor;
+    ASSERT_TRUE(processor.configure(kSampleRate, 1, {.mbcBandCount = 1}));
+    processor.setMbcEnabled(0, true);
+    auto band = makeNeutralMbcBand(20000);
+    band.noiseGateThresholdDb = -30;
+    band.expanderRatio = 2;
+    processor.setMbcBand(0, 0, band);
+
+    std::vector<float> buffer = makeSine(1, 1000, 0.01f);
+    processor.process(buffer.data(), buffer.data(), kFrameCount);
+
+    // -40 dB in, 10 dB below the gate expanded to 20 dB below.
+    EXPECT_NEAR(getSettledLevelDb(buffer, 1, 0), sineLevelDb(-50), 0.5);
+}
+
+TEST(DynamicsProcessorTest, LimiterLinkGroups) {
+    constexpr size_t kChannelCount = 3;
+    DynamicsProcessor processor;
+    ASSERT_TRUE(processor.configure(kSampleRate, kChannelCount, {.limiterInUse = true}));
+    const DynamicsProcessor::Limiter limiter = {
+            .enable = true, .attackTimeMs = 1, .releaseTimeMs = 50, .ratio = 10,
+            .thresholdDb = -10};
+    // Channels 0 and 1 are linked, channel 2 is on its own.
+    processor.setLimiter(0, limiter);
+    processor.setLimiter(1, limiter);
+    auto unlinked = limiter;
+    unlinked.linkGroup = 1;
+    processor.setLimiter(2, unlinked);
+
+    // Channel 0 is loud, channels 1 and 2 are below the threshold.
+    std::vector<float> buffer = makeSine(kChannelCount, 1000, 1.f, 0b001);
+    const std::vector<float> quiet = makeSine(kChannelCount, 1000, 0.1f, 0b110);
+    for (size_t i = 0; i < buffer.size(); i++) {
+        buffer[i] += quiet[i];
+    }
+    processor.process(buffer.data(), buffer.data(), kFrameCount);
+
+    // 10 dB over the threshold reduced to 1 dB, the linked channel follows.
+    EXPECT_NEAR(getSettledLevelDb(buffer, kChannelCount, 0), sineLevelDb(-9), 0.5);
+    EXPECT_NEAR(getSettledLevelDb(buffer, kChannelCount, 1), sineLevelDb(-29), 0.5);
+    EXPECT_NEAR(getSettledLevelDb(buffer, kChannelCount, 2), sineLevelDb(-20), 0.1);
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <complex>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "dsp/Fft.h"
+
+using aidl::android::hardware::audio::effect::dsp::Fft;
+
+namespace {
+
+std::vector<float> makeNoise(size_t samples, uint32_t seed) {
+    std::vector<float> buffer(samples);
+    for (auto& sample : buffer) {
+        seed = seed * 1664525u + 1013904223u;
+        sample = static_cast<float>(seed >> 8) / (1u << 23) - 1.f;
+    }
+    return buffer;
+}
+
+}  // namespace
+
+TEST(FftTest, Configure) {
+    Fft fft;
+    EXPECT_FALSE(fft.configure(0));
+    EXPECT_FALSE(fft.configure(1));
+    EXPECT_FALSE(fft.configure(96));
+    EXPECT_FALSE(fft.configure(Fft::kMaxSize * 2));
+    EXPECT_TRUE(fft.configure(Fft::kMinSize));
+    EXPECT_TRUE(fft.configure(1024));
+    EXPECT_EQ(1024u, fft.getSize());
+}
+
+class FftSizeTest : public ::testing::TestWithParam<size_t> {};
+
+// Against a direct DFT in double.
+TEST_P(FftSizeTest, MatchesDft) {
+    const size_t size = GetParam();
+    Fft fft;
+    ASSERT_TRUE(fft.configure(size));
+    std::vector<float> re = makeNoise(size, 1);
+    std::vector<float> im = makeNoise(size, 2);
+    std::vector<std::complex<double>> expected(size);
+    for (size_t k = 0; k < size; k++) {
+        for (size_t n = 0; n < size; n++) {
+            expected[k] += std::complex<double>(re[n], im[n]) *
+                           std::polar(1.0, -2 * M_PI * static_cast<double>(k * n % size) / size);
+        }
+    }
+    fft.forward(re.data(), im.data());
+    // The float rounding error grows with log2(size) stages over a sum of 'size' terms.
+    const double tolerance = 1e-5 * size;
+    for (size_t k = 0; k < size; k++) {
+        ASSERT_NEAR(expected[k].real(), re[k], tolerance) << "bin " << k;
+        ASSERT_NEAR(expected[k].imag(), im[k], tolerance) << "bin " << k;
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(Fft, FftSizeTest, ::testing::Values(2, 4, 8, 16, 128, 1024));
+
+TEST(FftTest, SineLandsInItsBin) {
+    constexpr size_t kSize = 256;
+    constexpr size_t kBin = 10;
+    Fft fft;
+    ASSERT_TRUE(fft.configure(kSize));
+    std::vector<float> re(kSize);
+    std::vector<float> im(kSize);
+    for (size_t n = 0; n < kSize; n++) {
+        re[n] = std::cos(2 * M_PI * kBin * n / kSize);
+    }
+    fft.forward(re.data(), im.data());
+    for (size_t k = 0; k < kSize; k++) {
+        const float magnitude = std::hypot(re[k], im[k]);
+        if (k == kBin || k == kSize - kBin) {
+            EXPECT_NEAR(kSize / 2.f, magnitude, 1e-3f) << "bin " << k;
+        } else {
+            EXPECT_NEAR(0.f, magnitude, 1e-3f) << "bin " << k;
+        }
+    }
+}
@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "dsp/Gain.h"
+
+using aidl::android::hardware::audio::effect::dsp::GainRamp;
+using aidl::android::hardware::audio::effect::dsp::millibelsToGain;
+
+namespace {
+
+constexpr size_t kFrameCount = 257;  // odd, so that the partial vector tail runs too
+
+std::vector<float> makeInput(size_t channelCount) {
+    std::vector<float> buffer(kFrameCount * channelCount);
+    for (size_t i = 0; i < buffer.size(); i++) {
+        buffer[i] = static_cast<float>((i * 37) % 201) / 100.f - 1.f;
+    }
+    return buffer;
+}
+
+float channelGain(size_t channel) {
+    return 0.1f * (channel + 1);
+}
+
+}  // namespace
+
+TEST(GainRampTest, Configure) {
+    GainRamp gain;
+    EXPECT_FALSE(gain.configure(0));
+    EXPECT_FALSE(gain.configure(GainRamp::kMaxChannels + 1));
+    EXPECT_TRUE(gain.configure(GainRamp::kMaxChannels));
+    EXPECT_TRUE(gain.isUnity());
+    EXPECT_EQ(1.f, gain.getGain(GainRamp::kMaxChannels - 1));
+}
+
+TEST(GainRampTest, ConfigureInputOutput) {
+    GainRamp gain;
+    EXPECT_TRUE(gain.configure(2, 2));
+    EXPECT_EQ(2u, gain.getChannelCount());
+    EXPECT_FALSE(gain.configure(2, 1));
+    EXPECT_EQ(0u, gain.getChannelCount());
+}
+
+TEST(GainRampTest, ProcessInterleavedPassesPartialFrameThrough) {
+    constexpr size_t kChannelCount = 3;
+    GainRamp gain;
+    ASSERT_TRUE(gain.configure(kChannelCount));
+    gain.setGain(0.5f, 0);
+    const std::vector<float> input = makeInput(kChannelCount);
+    // Two samples short of a whole frame at the end.
+    const size_t sampleCount = input.size() - 2;
+    const size_t scaledSampleCount = (kFrameCount - 1) * kChannelCount;
+    std::vector<float> output(input.size(), 5.f);
+    gain.processInterleaved(input.data(), output.data(), sampleCount);
+    for (size_t i = 0; i < scaledSampleCount; i++) {
+        ASSERT_FLOAT_EQ(input[i] * 0.5f, output[i]) << "sample " << i;
+    }
+    for (size_t i = scaledSampleCount; i < sampleCount; i++) {
+        EXPECT_EQ(input[i], output[i]) << "sample " << i;
+    }
+    EXPECT_EQ(5.f, output[sampleCount]);
+}
+
+TEST(GainRampTest, ProcessInterleavedUnconfiguredIsBypass) {
+    GainRamp gain;
+    EXPECT_FALSE(gain.configure(2, 1));
+    gain.setGain(0.5f, 0);
+    const std::vector<float> input = makeInput(2);
+    std::vector<float> output(input.size());
+    gain.processInterleaved(input.data(), output.data(), input.size());
+    EXPECT_EQ(input, output);
+}
+
+TEST(GainRampTest, MillibelsToGain) {
+    EXPECT_FLOAT_EQ(1.f, millibelsToGain(0));
+    EXPECT_FLOAT_EQ(0.1f, millibelsToGain(-2000));
+    EXPECT_FLOAT_EQ(10.f, millibelsToGain(2000));
+}
+
+class GainRampChannelTest : public ::testing::TestWithParam<size_t> {};
+
+TEST_P(GainRampChannelTest, SteadyPerChannelGains) {
+    const size_t channelCount = GetParam();
+    GainRamp gain;
+    ASSERT_TRUE(gain.configure(channelCount));
+    for (size_t channel = 0; channel < channelCount; channel++) {
+        gain.setGain(channel, channelGain(channel), 0);
+    }
+    EXPECT_FALSE(gain.isRamping());
+    const std::vector<float> input = makeInput(channelCount);
+    std::vector<float> output(input.size());
+    gain.process(input.data(), output.data(), kFrameCount);
+    for (size_t i = 0; i < input.size(); i++) {
+        ASSERT_FLOAT_EQ(input[i] * channelGain(i % channelCount), output[i]) << "sample " << i;
+    }
+    // In place gives the same result.
+    std::vector<float> buffer = input;
+    gain.process(buffer.data(), buffer.data(), kFrameCount);
+    EXPECT_EQ(output, buffer);
+}
+
+TEST_P(GainRampChannelTest, LinearRamp) {
+    const size_t channelCount = GetParam();
+    constexpr size_t kRampFrames = 100;
+    GainRamp gain;
+    ASSERT_TRUE(gain.configure(channelCount));
+    gain.setGain(0.f, kRampFrames);
+    const std::vector<float> input(kFrameCount * channelCount, 1.f);
+    std::vector<float> output(input.size());
+    // Split across calls, so that the ramp continues from one buffer to the next.
+    gain.process(input.data(), output.data(), 30);
+    gain.process(input.data() + 30 * channelCount, output.data() + 30 * channelCount,
+                 kFrameCount - 30);
+    for (size_t frame = 0; frame < kFrameCount; frame++) {
+        const float expected =
+                frame < kRampFrames ? 1.f - static_cast<float>(frame) / kRampFrames : 0.f;
+        for (size_t channel = 0; channel < channelCount; channel++) {
+            ASSERT_NEAR(expected, output[frame * channelCount + channel], 1e-5f)
+                    << "frame " << frame << " channel " << channel;
+        }
+    }
+    EXPECT_FALSE(gain.isRamping());
+    EXPECT_EQ(0.f, gain.getGain(channelCount - 1));
+}
+
+INSTANTIATE_TEST_SUITE_P(GainRamp, GainRampChannelTest, ::testing::Values(1, 2, 3, 4, 6, 8, 31));
+
+TEST(GainRampTest, ExponentialRampHasConstantDbSteps) {
+    constexpr size_t kRampFrames = 64;
+    GainRamp gain;
+    ASSERT_TRUE(gain.configure(1));
+    gain.setGain(0.01f, kRampFrames, GainRamp::Shape::kExponential);
+    std::vector<float> buffer(kRampFrames + 1, 1.f);
+    gain.process(buffer.data(), buffer.data(), buffer.size());
+    const float stepDb = -40.f / kRampFrames;
+    for (size_t frame = 0; frame < kRampFrames; frame++) {
+        ASSERT_NEAR(stepDb * frame, 20 * std::log10(buffer[frame]), 1e-3f) << "frame " << frame;
+    }
+    EXPECT_EQ(0.01f, buffer[kRampFrames]);
+}
+
+TEST(GainRampTest, ExponentialRampFromSilence) {
+    constexpr size_t kRampFrames = 16;
+    GainRamp gain;
+    ASSERT_TRUE(gain.configure(2));
+    gain.setGain(0.f, 0);
+    gain.setGain(1.f, kRampFrames, GainRamp::Shape::kExponential);
+    std::vector<float> buffer(2 * (kRampFrames + 1), 1.f);
+    gain.process(buffer.data(), buffer.data(), kRampFrames + 1);
+    EXPECT_FLOAT_EQ(GainRamp::kMinExponentialGain, buffer[0]);
+    for (size_t i = 2; i < buffer.size(); i++) {
+        ASSERT_GT(buffer[i], buffer[i - 2]) << "sample " << i;
+    }
+    EXPECT_EQ(1.f, buffer.back());
+}
+
+TEST(GainRampTest, ImmediateChannelChangeDuringRamp) {
+    GainRamp gain;
+    ASSERT_TRUE(gain.configure(2));
+    gain.setGain(0.f, 10);
+    std::vector<float> buffer(2 * 5, 1.f);
+    gain.process(buffer.data(), buffer.data(), 5);
+    gain.setGain(1, 0.25f, 0);
+    EXPECT_TRUE(gain.isRamping());
+    EXPECT_EQ(0.25f, gain.getGain(1));
+    std::fill(buffer.begin(), buffer.end(), 1.f);
+    gain.process(buffer.data(), buffer.data(), 5);
+    for (size_t frame = 0; frame < 5; frame++) {
+        EXPECT_NEAR(0.5f - 0.1f * frame, buffer[frame * 2], 1e-6f) << "frame " << frame;
+        EXPECT_EQ(0.25f, buffer[frame * 2 + 1]) << "frame " << frame;
+    }
+    EXPECT_FALSE(gain.isRamping());
+}
+
+TEST(GainRampTest, Int16RoundsAndSaturates) {
+    GainRamp gain;
+    ASSERT_TRUE(gain.configure(1));
+    gain.setGain(2.f, 0);
+    const std::vector<int16_t> input = {0, 1, -1, 10000, -10000, 20000, -20000};
+    const std::vector<int16_t> expected = {0, 2, -2, 20000, -20000, 32767, -32768};
+    std::vector<int16_t> output(input.size());
+    gain.process(input.data(), output.data(), input.size());
+    EXPECT_EQ(expected, output);
+
+    gain.setGain(0.5f, 0);
+    const std::vector<int16_t> odd = {3, -3, 5, -5};
+    const std::vector<int16_t> halved = {2, -2, 3, -3};
+    gain.process(odd.data(), output.data(), odd.size());
+    output.resize(odd.size());
+    EXPECT_EQ(halved, output);
+}
+
+TEST(GainRampTest, Int32Saturates) {
+    constexpr int32_t kMax = std::numeric_limits<int32_t>::max();
+    constexpr int32_t kMin = std::numeric_limits<int32_t>::min();
+    GainRamp gain;
+    ASSERT_TRUE(gain.configure(1));
+    const std::vector<int32_t> input = {kMax, kMin, 1 << 24, -(1 << 24), 0};
+    std::vector<int32_t> output(input.size());
+    // Unity gain is exact.
+    gain.process(input.data(), output.data(), input.size());
+    EXPECT_EQ(input, output);
+    gain.setGain(4.f, 0);
+    gain.process(input.data(), output.data(), input.size());
+    EXPECT_EQ(kMax - 127, output[0]);
+    EXPECT_EQ(kMin, output[1]);
+    EXPECT_EQ(1 << 26, output[2]);
+    EXPECT_EQ(-(1 << 26), output[3]);
+    EXPECT_EQ(0, output[4]);
+}
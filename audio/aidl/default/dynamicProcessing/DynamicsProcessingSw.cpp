@@ -61,6 +61,44 @@ extern "C" binder_exception_t queryEffect(const AudioUuid* in_impl_uuid, Descrip
 
 namespace aidl::android::hardware::audio::effect {
 
+namespace {
+
+using dsp::DynamicsProcessor;
+
+DynamicsProcessor::EqBand toEngineEqBand(const DynamicsProcessing::EqBandConfig& cfg) {
+    return {.enable = cfg.enable, .cutoffFrequencyHz = cfg.cutoffFrequencyHz, .gainDb = cfg.gainDb};
+}
+
+DynamicsProcessor::MbcBand toEngineMbcBand(const DynamicsProcessing::MbcBandConfig& cfg) {
+    return {.enable = cfg.enable,
+            .cutoffFrequencyHz = cfg.cutoffFrequencyHz,
+            .attackTimeMs = cfg.attackTimeMs,
+            .releaseTimeMs = cfg.releaseTimeMs,
+            .ratio = cfg.ratio,
+            .thresholdDb = cfg.thresholdDb,
+            .kneeWidthDb = cfg.kneeWidthDb,
+            .noiseGateThresholdDb = cfg.noiseGateThresholdDb,
+            .expanderRatio = cfg.expanderRatio,
+            .preGainDb = cfg.preGainDb,
+            .postGainDb = cfg.postGainDb};
+}
+
+DynamicsProcessor::Limiter toEngineLimiter(const DynamicsProcessing::LimiterConfig& cfg) {
+    return {.enable = cfg.enable,
+            .linkGroup = cfg.linkGroup,
+            .attackTimeMs = cfg.attackTimeMs,
+            .releaseTimeMs = cfg.releaseTimeMs,
+            .ratio = cfg.ratio,
+            .thresholdDb = cfg.thresholdDb,
+            .postGainDb = cfg.postGainDb};
+}
+
+size_t getEngineBandCount(const DynamicsProcessing::StageEnablement& stage) {
+    return stage.inUse ? stage.bandCount : 0;
+}
+
+}  // namespace
+
 const std::string DynamicsProcessingSw::kEffectName = "DynamicsProcessingSw";
 const DynamicsProcessing::EqBandConfig DynamicsProcessingSw::kEqBandConfigMin =
         DynamicsProcessing::EqBandConfig({.channel = 0,
@@ -269,12 +307,8 @@ RetCode DynamicsProcessingSw::releaseContext() {
 
 // Processing method running in EffectWorker thread.
 IEffect::Status DynamicsProcessingSw::effectProcessImpl(float* in, float* out, int samples) {
-    // TODO: get data buffer and process.
-    LOG(DEBUG) << __func__ << " in " << in << " out " << out << " samples " << samples;
-    for (int i = 0; i < samples; i++) {
-        *out++ = *in++;
-    }
-    return {STATUS_OK, samples, samples};
+    RETURN_VALUE_IF(!mContext, (IEffect::Status{EX_NULL_POINTER, 0, 0}), "nullContext");
+    return mContext->process(in, out, samples);
 }
 
 RetCode DynamicsProcessingSwContext::setCommon(const Parameter::Common& common) {
@@ -286,6 +320,7 @@ RetCode DynamicsProcessingSwContext::setCommon(const Parameter::Common& common)
             common.input.base.channelMask);
     resizeChannels();
     resizeBands();
+    configureEngine();
     LOG(INFO) << __func__ << mCommon.toString();
     return RetCode::SUCCESS;
 }
@@ -301,6 +336,7 @@ RetCode DynamicsProcessingSwContext::setEngineArchitecture(
     }
     mEngineSettings = cfg;
     resizeBands();
+    configureEngine();
     return RetCode::SUCCESS;
 }
 
@@ -331,17 +367,23 @@ RetCode DynamicsProcessingSwContext::setChannelCfgs(
 
 RetCode DynamicsProcessingSwContext::setPreEqChannelCfgs(
         const std::vector<DynamicsProcessing::ChannelConfig>& cfgs) {
-    return setChannelCfgs(cfgs, mPreEqChCfgs, mEngineSettings.preEqStage);
+    RetCode ret = setChannelCfgs(cfgs, mPreEqChCfgs, mEngineSettings.preEqStage);
+    updateEngine();
+    return ret;
 }
 
 RetCode DynamicsProcessingSwContext::setPostEqChannelCfgs(
         const std::vector<DynamicsProcessing::ChannelConfig>& cfgs) {
-    return setChannelCfgs(cfgs, mPostEqChCfgs, mEngineSettings.postEqStage);
+    RetCode ret = setChannelCfgs(cfgs, mPostEqChCfgs, mEngineSettings.postEqStage);
+    updateEngine();
+    return ret;
 }
 
 RetCode DynamicsProcessingSwContext::setMbcChannelCfgs(
         const std::vector<DynamicsProcessing::ChannelConfig>& cfgs) {
-    return setChannelCfgs(cfgs, mMbcChCfgs, mEngineSettings.mbcStage);
+    RetCode ret = setChannelCfgs(cfgs, mMbcChCfgs, mEngineSettings.mbcStage);
+    updateEngine();
+    return ret;
 }
 
 RetCode DynamicsProcessingSwContext::setEqBandCfgs(
@@ -373,12 +415,17 @@ RetCode DynamicsProcessingSwContext::setEqBandCfgs(
 
 RetCode DynamicsProcessingSwContext::setPreEqBandCfgs(
         const std::vector<DynamicsProcessing::EqBandConfig>& cfgs) {
-    return setEqBandCfgs(cfgs, mPreEqChBands, mEngineSettings.preEqStage, mPreEqChCfgs);
+    RetCode ret = setEqBandCfgs(cfgs, mPreEqChBands, mEngineSettings.preEqStage, mPreEqChCfgs);
+    updateEngine();
+    return ret;
 }
 
 RetCode DynamicsProcessingSwContext::setPostEqBandCfgs(
         const std::vector<DynamicsProcessing::EqBandConfig>& cfgs) {
-    return setEqBandCfgs(cfgs, mPostEqChBands, mEngineSettings.postEqStage, mPostEqChCfgs);
+    RetCode ret =
+            setEqBandCfgs(cfgs, mPostEqChBands, mEngineSettings.postEqStage, mPostEqChCfgs);
+    updateEngine();
+    return ret;
 }
 
 RetCode DynamicsProcessingSwContext::setMbcBandCfgs(
@@ -406,6 +453,7 @@ RetCode DynamicsProcessingSwContext::setMbcBandCfgs(
         }
         mMbcChBands[it.channel * bandCount + it.band] = it;
     }
+    updateEngine();
     return ret;
 }
 
@@ -431,6 +479,7 @@ RetCode DynamicsProcessingSwContext::setLimiterCfgs(
         }
         mLimiterCfgs[it.channel] = it;
     }
+    updateEngine();
     return ret;
 }
 
@@ -474,9 +523,85 @@ RetCode DynamicsProcessingSwContext::setInputGainCfgs(
                         RetCode::ERROR_ILLEGAL_PARAMETER, "invalidChannel");
         mInputGainCfgs[cfg.channel] = cfg;
     }
+    updateEngine();
     return RetCode::SUCCESS;
 }
 
+void DynamicsProcessingSwContext::configureEngine() {
+    const DynamicsProcessor::Architecture architecture = {
+            .preEqBandCount = getEngineBandCount(mEngineSettings.preEqStage),
+            .mbcBandCount = getEngineBandCount(mEngineSettings.mbcStage),
+            .postEqBandCount = getEngineBandCount(mEngineSettings.postEqStage),
+            .limiterInUse = mEngineSettings.limiterInUse};
+    mEngineEnabled = mInputChannelCount == mOutputChannelCount &&
+                     mEngine.configure(mCommon.input.base.sampleRate, mChannelCount, architecture);
+    if (!mEngineEnabled) {
+        LOG(WARNING) << __func__ << " unsupported configuration, bypass: in channels "
+                     << mInputChannelCount << " out channels " << mOutputChannelCount
+                     << " sample rate " << mCommon.input.base.sampleRate << " "
+                     << mEngineSettings.toString();
+        return;
+    }
+    updateEngine();
+}
+
+// Parameter changes are rare, so the whole configuration is pushed to the engine rather than
+// tracking which bands changed. Bands never set are pushed too, as the disabled placeholders
+// resizeBands() fills in. Only input gains never set are skipped, which leaves them at the 0 dB
+// the engine resets them to in configure().
+void DynamicsProcessingSwContext::updateEngine() {
+    if (!mEngineEnabled) {
+        return;
+    }
+    for (size_t channel = 0; channel < mChannelCount; channel++) {
+        updateEngineChannel(channel);
+    }
+}
+
+void DynamicsProcessingSwContext::updateEngineChannel(size_t channel) {
+    if (mInputGainCfgs[channel].channel != kInvalidChannelId) {
+        mEngine.setInputGain(channel, mInputGainCfgs[channel].gainDb);
+    }
+
+    const size_t preEqBandCount = getEngineBandCount(mEngineSettings.preEqStage);
+    mEngine.setPreEqEnabled(channel, mPreEqChCfgs[channel].enable);
+    for (size_t band = 0; band < preEqBandCount; band++) {
+        mEngine.setPreEqBand(channel, band,
+                             toEngineEqBand(mPreEqChBands[channel * preEqBandCount + band]));
+    }
+
+    const size_t mbcBandCount = getEngineBandCount(mEngineSettings.mbcStage);
+    mEngine.setMbcEnabled(channel, mMbcChCfgs[channel].enable);
+    for (size_t band = 0; band < mbcBandCount; band++) {
+        mEngine.setMbcBand(channel, band,
+                           toEngineMbcBand(mMbcChBands[channel * mbcBandCount + band]));
+    }
+
+    const size_t postEqBandCount = getEngineBandCount(mEngineSettings.postEqStage);
+    mEngine.setPostEqEnabled(channel, mPostEqChCfgs[channel].enable);
+    for (size_t band = 0; band < postEqBandCount; band++) {
+        mEngine.setPostEqBand(channel, band,
+                              toEngineEqBand(mPostEqChBands[channel * postEqBandCount + band]));
+    }
+
+    if (mEngineSettings.limiterInUse) {
+        mEngine.setLimiter(channel, toEngineLimiter(mLimiterCfgs[channel]));
+    }
+}
+
+IEffect::Status DynamicsProcessingSwContext::process(float* in, float* out, int samples) {
+    if (!mEngineEnabled) {
+        std::copy(in, in + samples, out);
+        return {STATUS_OK, samples, samples};
+    }
+    const size_t frameCount = samples / mChannelCount;
+    mEngine.process(in, out, frameCount);
+    // A trailing partial frame is passed through.
+    const size_t processedSamples = frameCount * mChannelCount;
+    std::copy(in + processedSamples, in + samples, out + processedSamples);
+    return {STATUS_OK, samples, samples};
+}
+
 std::vector<DynamicsProcessing::InputGain> DynamicsProcessingSwContext::getInputGainCfgs() {
     std::vector<DynamicsProcessing::InputGain> ret;
     std::copy_if(mInputGainCfgs.begin(), mInputGainCfgs.end(), std::back_inserter(ret),
@@ -24,6 +24,7 @@
 #include <aidl/android/hardware/audio/effect/BnEffect.h>
 #include <fmq/AidlMessageQueue.h>
 
+#include "dsp/DynamicsProcessor.h"
 #include "effect-impl/EffectImpl.h"
 
 namespace aidl::android::hardware::audio::effect {
@@ -37,8 +38,10 @@ class DynamicsProcessingSwContext final : public EffectContext {
           mPreEqChCfgs(mChannelCount, {.channel = kInvalidChannelId}),
           mPostEqChCfgs(mChannelCount, {.channel = kInvalidChannelId}),
           mMbcChCfgs(mChannelCount, {.channel = kInvalidChannelId}),
-          mLimiterCfgs(mChannelCount, {.channel = kInvalidChannelId}) {
+          mLimiterCfgs(mChannelCount, {.channel = kInvalidChannelId}),
+          mInputGainCfgs(mChannelCount, {.channel = kInvalidChannelId}) {
         LOG(DEBUG) << __func__;
+        configureEngine();
     }
 
     // utils
@@ -74,6 +77,8 @@ class DynamicsProcessingSwContext final : public EffectContext {
     std::vector<DynamicsProcessing::LimiterConfig> getLimiterCfgs() { return mLimiterCfgs; }
     std::vector<DynamicsProcessing::InputGain> getInputGainCfgs();
 
+    IEffect::Status process(float* in, float* out, int samples);
+
   private:
     static constexpr int32_t kInvalidChannelId = -1;
     size_t mChannelCount = 0;
@@ -88,6 +93,9 @@ class DynamicsProcessingSwContext final : public EffectContext {
     std::vector<DynamicsProcessing::EqBandConfig> mPreEqChBands;
     std::vector<DynamicsProcessing::EqBandConfig> mPostEqChBands;
     std::vector<DynamicsProcessing::MbcBandConfig> mMbcChBands;
+    // The signal chain, kept in sync with the configurations above.
+    dsp::DynamicsProcessor mEngine;
+    bool mEngineEnabled = false;
     bool validateStageEnablement(const DynamicsProcessing::StageEnablement& enablement);
     bool validateEngineConfig(const DynamicsProcessing::EngineArchitecture& engine);
     bool validateEqBandConfig(const DynamicsProcessing::EqBandConfig& band, int maxChannel,
@@ -99,6 +107,9 @@ class DynamicsProcessingSwContext final : public EffectContext {
     bool validateLimiterConfig(const DynamicsProcessing::LimiterConfig& limiter, int maxChannel);
     void resizeChannels();
     void resizeBands();
+    void configureEngine();
+    void updateEngineChannel(size_t channel);
+    void updateEngine();
 };  // DynamicsProcessingSwContext
 
 class DynamicsProcessingSw final : public EffectImpl {
@@ -15,6 +15,7 @@
  */
 
 #include <algorithm>
+#include <cmath>
 #include <cstddef>
 
 #define LOG_TAG "AHAL_EqualizerSw"
@@ -207,11 +208,64 @@ RetCode EqualizerSw::releaseContext() {
 
 // Processing method running in EffectWorker thread.
 IEffect::Status EqualizerSw::effectProcessImpl(float* in, float* out, int samples) {
-    // TODO: get data buffer and process.
-    LOG(DEBUG) << __func__ << " in " << in << " out " << out << " samples " << samples;
-    for (int i = 0; i < samples; i++) {
-        *out++ = *in++;
+    RETURN_VALUE_IF(!mContext, (IEffect::Status{EX_NULL_POINTER, 0, 0}), "nullContext");
+    return mContext->process(in, out, samples);
+}
+
+RetCode EqualizerSwContext::setCommon(const Parameter::Common& common) {
+    if (auto ret = EffectContext::setCommon(common); ret != RetCode::SUCCESS) {
+        return ret;
+    }
+    configureFilters();
+    return RetCode::SUCCESS;
+}
+
+void EqualizerSwContext::configureFilters() {
+    mFiltersEnabled = mInputChannelCount == mOutputChannelCount &&
+                      mCommon.input.base.sampleRate > 0 &&
+                      mFilters.configure(mInputChannelCount, kMaxBandNumber);
+    if (!mFiltersEnabled) {
+        LOG(WARNING) << __func__ << " unsupported IO, bypass: in channels " << mInputChannelCount
+                     << " out channels " << mOutputChannelCount << " sample rate "
+                     << mCommon.input.base.sampleRate;
+        return;
+    }
+    for (int band = 0; band < kMaxBandNumber; band++) {
+        updateFilter(band, 0 /* rampFrames */);
+    }
+}
+
+void EqualizerSwContext::updateFilter(int band, size_t rampFrames) {
+    if (!mFiltersEnabled) {
+        return;
+    }
+    // Shelves use a Butterworth slope, the peaking bands are two octaves wide like the bands.
+    constexpr float kShelfQ = M_SQRT1_2;
+    constexpr float kPeakingQ = 2.f / 3.f;
+    const float sampleRate = mCommon.input.base.sampleRate;
+    const float frequency = kPresetsFrequencies[band];
+    const float gainDb = mBandLevels[band] / 100.f;
+    dsp::BiquadCoefficients coefficients;
+    if (band == 0) {
+        coefficients = dsp::BiquadCoefficients::lowShelf(sampleRate, frequency, kShelfQ, gainDb);
+    } else if (band == kMaxBandNumber - 1) {
+        coefficients = dsp::BiquadCoefficients::highShelf(sampleRate, frequency, kShelfQ, gainDb);
+    } else {
+        coefficients = dsp::BiquadCoefficients::peaking(sampleRate, frequency, kPeakingQ, gainDb);
+    }
+    mFilters.setCoefficients(band, coefficients, rampFrames);
+}
+
+IEffect::Status EqualizerSwContext::process(float* in, float* out, int samples) {
+    if (!mFiltersEnabled) {
+        std::copy(in, in + samples, out);
+        return {STATUS_OK, samples, samples};
     }
+    const size_t frameCount = samples / mInputChannelCount;
+    mFilters.process(in, out, frameCount);
+    // A trailing partial frame is passed through.
+    const size_t filteredSamples = frameCount * mInputChannelCount;
+    std::copy(in + filteredSamples, in + samples, out + filteredSamples);
     return {STATUS_OK, samples, samples};
 }
 
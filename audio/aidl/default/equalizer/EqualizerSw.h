@@ -21,6 +21,7 @@
 #include <cstdlib>
 #include <memory>
 
+#include "dsp/Biquad.h"
 #include "effect-impl/EffectImpl.h"
 
 namespace aidl::android::hardware::audio::effect {
@@ -30,8 +31,11 @@ class EqualizerSwContext final : public EffectContext {
     EqualizerSwContext(int statusDepth, const Parameter::Common& common)
         : EffectContext(statusDepth, common) {
         LOG(DEBUG) << __func__;
+        configureFilters();
     }
 
+    RetCode setCommon(const Parameter::Common& common) override;
+
     RetCode setEqPreset(const int& presetIdx) {
         if (presetIdx < 0 || presetIdx >= kMaxPresetNumber) {
             return RetCode::ERROR_ILLEGAL_PARAMETER;
@@ -54,6 +58,7 @@ class EqualizerSwContext final : public EffectContext {
                 ret = RetCode::ERROR_ILLEGAL_PARAMETER;
             } else {
                 mBandLevels[it.index] = it.levelMb;
+                updateFilter(it.index, dsp::BiquadCascade::kDefaultRampFrames);
             }
         }
         return ret;
@@ -70,6 +75,9 @@ class EqualizerSwContext final : public EffectContext {
     std::vector<int> getCenterFreqs() {
         return {std::begin(kPresetsFrequencies), std::end(kPresetsFrequencies)};
     }
+
+    IEffect::Status process(float* in, float* out, int samples);
+
     static const int kMaxBandNumber = 5;
     static const int kMaxPresetNumber = 10;
     static const int kCustomPreset = -1;
@@ -81,7 +89,12 @@ class EqualizerSwContext final : public EffectContext {
     int mPreset = kCustomPreset;
     int32_t mBandLevels[kMaxBandNumber] = {3, 0, 0, 0, 3};
 
-    // Add equalizer specific context for processing here
+    // One section per band: a low shelf, three peaking filters and a high shelf.
+    dsp::BiquadCascade mFilters;
+    bool mFiltersEnabled = false;
+
+    void configureFilters();
+    void updateFilter(int band, size_t rampFrames);
 };
 
 class EqualizerSw final : public EffectImpl {
@@ -24,12 +24,14 @@
 
 #include "HapticGeneratorSw.h"
 
+using aidl::android::hardware::audio::common::getChannelCount;
 using aidl::android::hardware::audio::effect::Descriptor;
 using aidl::android::hardware::audio::effect::getEffectImplUuidHapticGeneratorSw;
 using aidl::android::hardware::audio::effect::getEffectTypeUuidHapticGenerator;
 using aidl::android::hardware::audio::effect::HapticGeneratorSw;
 using aidl::android::hardware::audio::effect::IEffect;
 using aidl::android::hardware::audio::effect::State;
+using aidl::android::media::audio::common::AudioChannelLayout;
 using aidl::android::media::audio::common::AudioUuid;
 
 extern "C" binder_exception_t createEffect(const AudioUuid* in_impl_uuid,
@@ -167,12 +169,16 @@ RetCode HapticGeneratorSw::releaseContext() {
 
 // Processing method running in EffectWorker thread.
 IEffect::Status HapticGeneratorSw::effectProcessImpl(float* in, float* out, int samples) {
-    // TODO: get data buffer and process.
-    LOG(DEBUG) << __func__ << " in " << in << " out " << out << " samples " << samples;
-    for (int i = 0; i < samples; i++) {
-        *out++ = *in++;
+    RETURN_VALUE_IF(!mContext, (IEffect::Status{EX_NULL_POINTER, 0, 0}), "nullContext");
+    return mContext->process(in, out, samples);
+}
+
+RetCode HapticGeneratorSwContext::setCommon(const Parameter::Common& common) {
+    if (auto ret = EffectContext::setCommon(common); ret != RetCode::SUCCESS) {
+        return ret;
     }
-    return {STATUS_OK, samples, samples};
+    configureGain();
+    return RetCode::SUCCESS;
 }
 
 RetCode HapticGeneratorSwContext::setHgHapticScales(
@@ -181,6 +187,7 @@ RetCode HapticGeneratorSwContext::setHgHapticScales(
     for (auto& it : hapticScales) {
         mHapticScales[it.id] = it;
     }
+    updateHapticGain(dsp::GainRamp::kDefaultRampFrames);
     return RetCode::SUCCESS;
 }
 
@@ -191,4 +198,57 @@ std::vector<HapticGenerator::HapticScale> HapticGeneratorSwContext::getHgHapticS
     return result;
 }
 
+void HapticGeneratorSwContext::configureGain() {
+    if (!mGain.configure(mInputChannelCount, mOutputChannelCount)) {
+        LOG(WARNING) << __func__ << " unsupported IO, bypass: in channels " << mInputChannelCount
+                     << " out channels " << mOutputChannelCount;
+        return;
+    }
+    mHapticChannelCount = getChannelCount(
+            mCommon.input.base.channelMask,
+            AudioChannelLayout::CHANNEL_HAPTIC_A | AudioChannelLayout::CHANNEL_HAPTIC_B);
+    updateHapticGain(0 /* rampFrames */);
+}
+
+// Linear approximations of the intensity curves of the framework haptic scaling: the reduced
+// scales match its maximum amplitude ratios, the raised ones their inverse.
+static float getVibratorScaleGain(HapticGenerator::VibratorScale scale) {
+    switch (scale) {
+        case HapticGenerator::VibratorScale::MUTE:
+            return 0.f;
+        case HapticGenerator::VibratorScale::VERY_LOW:
+            return 2.f / 3.f;
+        case HapticGenerator::VibratorScale::LOW:
+            return 3.f / 4.f;
+        case HapticGenerator::VibratorScale::NONE:
+            return 1.f;
+        case HapticGenerator::VibratorScale::HIGH:
+            return 4.f / 3.f;
+        case HapticGenerator::VibratorScale::VERY_HIGH:
+            return 3.f / 2.f;
+    }
+    return 0.f;
+}
+
+void HapticGeneratorSwContext::updateHapticGain(size_t rampFrames) {
+    if (mGain.getChannelCount() == 0) {
+        return;
+    }
+    // As in the framework, the haptic channels are muted until a track has a scale.
+    auto maxScale = HapticGenerator::VibratorScale::MUTE;
+    for (const auto& [_, hapticScale] : mHapticScales) {
+        maxScale = std::max(maxScale, hapticScale.scale);
+    }
+    const float gain = getVibratorScaleGain(maxScale);
+    for (size_t channel = mInputChannelCount - mHapticChannelCount; channel < mInputChannelCount;
+         channel++) {
+        mGain.setGain(channel, gain, rampFrames);
+    }
+}
+
+IEffect::Status HapticGeneratorSwContext::process(float* in, float* out, int samples) {
+    mGain.processInterleaved(in, out, samples);
+    return {STATUS_OK, samples, samples};
+}
+
 }  // namespace aidl::android::hardware::audio::effect
@@ -23,6 +23,7 @@
 #include <aidl/android/hardware/audio/effect/BnEffect.h>
 #include <fmq/AidlMessageQueue.h>
 
+#include "dsp/Gain.h"
 #include "effect-impl/EffectImpl.h"
 
 namespace aidl::android::hardware::audio::effect {
@@ -32,8 +33,11 @@ class HapticGeneratorSwContext final : public EffectContext {
     HapticGeneratorSwContext(int statusDepth, const Parameter::Common& common)
         : EffectContext(statusDepth, common) {
         LOG(DEBUG) << __func__;
+        configureGain();
     }
 
+    RetCode setCommon(const Parameter::Common& common) override;
+
     RetCode setHgHapticScales(const std::vector<HapticGenerator::HapticScale>& hapticScales);
     std::vector<HapticGenerator::HapticScale> getHgHapticScales() const;
 
@@ -47,6 +51,8 @@ class HapticGeneratorSwContext final : public EffectContext {
         return mVibratorInformation;
     }
 
+    IEffect::Status process(float* in, float* out, int samples);
+
   private:
     static constexpr float DEFAULT_RESONANT_FREQUENCY = 150.0f;
     static constexpr float DEFAULT_Q_FACTOR = 1.0f;
@@ -54,6 +60,14 @@ class HapticGeneratorSwContext final : public EffectContext {
     std::map<int /* trackID */, HapticGenerator::HapticScale> mHapticScales;
     HapticGenerator::VibratorInformation mVibratorInformation = {
             DEFAULT_RESONANT_FREQUENCY, DEFAULT_Q_FACTOR, DEFAULT_MAX_AMPLITUDE};
+
+    // The haptic channels, last in each frame, are scaled by the highest scale of all tracks.
+    // The audio channels have unity gain.
+    dsp::GainRamp mGain;
+    size_t mHapticChannelCount = 0;
+
+    void configureGain();
+    void updateHapticGain(size_t rampFrames);
 };
 
 class HapticGeneratorSw final : public EffectImpl {
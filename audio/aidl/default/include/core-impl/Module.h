@@ -27,6 +27,7 @@
 #include <aidl/android/hardware/audio/core/BnModule.h>
 
 #include "core-impl/ChildInterface.h"
+#include "core-impl/ModuleTopology.h"
 #include "core-impl/Stream.h"
 
 namespace aidl::android::hardware::audio::core {
@@ -158,6 +159,15 @@ class Module : public BnModule {
     // Maps port ids and port config ids to patch ids.
     // Multimap because both ports and configs can be used by multiple patches.
     using Patches = std::multimap<int32_t, int32_t>;
+    // Indexes over the configuration, for lookups by id and for routing queries.
+    // Code changing the configuration must keep them up to date, see ModuleTopology.h.
+    struct Topology {
+        IdIndex<::aidl::android::media::audio::common::AudioPort> ports;
+        IdIndex<::aidl::android::media::audio::common::AudioPortConfig> portConfigs;
+        IdIndex<::aidl::android::media::audio::common::AudioPortConfig> initialConfigs;
+        IdIndex<AudioPatch> patches;
+        RouteIndex<AudioRoute> routes;
+    };
 
     const Type mType;
     std::unique_ptr<Configuration> mConfig;
@@ -166,6 +176,7 @@ class Module : public BnModule {
     ConnectedDevicePorts mConnectedDevicePorts;
     Streams mStreams;
     Patches mPatches;
+    Topology mTopology;
     bool mMicMute = false;
     bool mMasterMute = false;
     float mMasterVolume = 1.0f;
@@ -236,6 +247,8 @@ class Module : public BnModule {
     bool generateDefaultPortConfig(const ::aidl::android::media::audio::common::AudioPort& port,
                                    ::aidl::android::media::audio::common::AudioPortConfig* config);
     std::vector<AudioRoute*> getAudioRoutesForAudioPortImpl(int32_t portId);
+    // The indexes over the configuration follow entries being added or removed. Subclasses must
+    // not change the ids of existing entries, or the sources of existing routes, in place.
     Configuration& getConfig();
     const ConnectedDevicePorts& getConnectedDevicePorts() const { return mConnectedDevicePorts; }
     bool getMasterMute() const { return mMasterMute; }
@@ -252,6 +265,8 @@ class Module : public BnModule {
     template <typename C>
     std::set<int32_t> portIdsFromPortConfigIds(C portConfigIds);
     void registerPatch(const AudioPatch& patch);
+    std::vector<::aidl::android::media::audio::common::AudioPortConfig*> selectPortConfigsByIds(
+            const std::vector<int32_t>& ids, std::vector<int32_t>* missingIds);
     ndk::ScopedAStatus setAudioPortConfigImpl(
             const ::aidl::android::media::audio::common::AudioPortConfig& in_requested,
             const std::function<bool(const ::aidl::android::media::audio::common::AudioPort& port,
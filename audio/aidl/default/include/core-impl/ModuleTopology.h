@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <unordered_map>
+#include <vector>
+
+namespace aidl::android::hardware::audio::core {
+
+// Positions of the elements of a vector by their 'id' field, so that lookups by id are done in
+// constant time instead of the linear scan of 'findById'. The results are the same, including
+// for duplicate ids, where the first element is found.
+//
+// Appending an element updates the index in place, any other change of the vector size
+// invalidates it and the next lookup rebuilds it. Changes that keep the size (for example,
+// changing an id in place) must be followed by a call to 'invalidate'.
+template <typename T>
+class IdIndex {
+  public:
+    typename std::vector<T>::iterator find(std::vector<T>& v, int32_t id) {
+        if (mIndexedSize != v.size()) {
+            rebuild(v);
+        }
+        auto it = mPositions.find(id);
+        if (it == mPositions.end()) {
+            return v.end();
+        }
+        return v.begin() + it->second;
+    }
+
+    // To be called after an element was added to the end of 'v'.
+    void onAppended(const std::vector<T>& v) {
+        if (mIndexedSize + 1 != v.size()) {
+            invalidate();
+            return;
+        }
+        mPositions.emplace(v.back().id, v.size() - 1);
+        mIndexedSize = v.size();
+    }
+
+    void invalidate() { mIndexedSize = kInvalidSize; }
+
+  private:
+    static constexpr size_t kInvalidSize = SIZE_MAX;
+
+    void rebuild(const std::vector<T>& v) {
+        mPositions.clear();
+        for (size_t i = 0; i < v.size(); ++i) {
+            mPositions.emplace(v[i].id, i);  // keeps the first position of duplicates
+        }
+        mIndexedSize = v.size();
+    }
+
+    std::unordered_map<int32_t, size_t> mPositions;
+    size_t mIndexedSize = kInvalidSize;
+};
+
+// Adjacency lists of the route graph: for each port, the positions of the routes which have it
+// as the sink or as one of the sources, in ascending order. Positions rather than pointers are
+// kept, so that appending routes does not invalidate the index.
+//
+// Appending a route or a source to a route updates the index in place. Erasing routes, or sources
+// from routes, must be followed by a call to 'invalidate'.
+template <typename R>
+class RouteIndex {
+  public:
+    // Same result as scanning 'routes' for the ones that have 'portId' as the sink or a source.
+    std::vector<R*> getRoutes(std::vector<R>& routes, int32_t portId) {
+        validate(routes);
+        std::vector<size_t> positions;
+        const std::vector<size_t>& bySink = findOrEmpty(mBySink, portId);
+        const std::vector<size_t>& bySource = findOrEmpty(mBySource, portId);
+        std::set_union(bySink.begin(), bySink.end(), bySource.begin(), bySource.end(),
+                       std::back_inserter(positions));
+        std::vector<R*> result;
+        result.reserve(positions.size());
+        for (size_t position : positions) {
+            result.push_back(&routes[position]);
+        }
+        return result;
+    }
+
+    // Routes having 'portId' among their sources, in ascending order.
+    const std::vector<size_t>& getRoutesFromSource(const std::vector<R>& routes, int32_t portId) {
+        validate(routes);
+        return findOrEmpty(mBySource, portId);
+    }
+
+    // To be called after a route was added to the end of 'routes'.
+    void onAppended(const std::vector<R>& routes) {
+        if (mIndexedSize + 1 != routes.size()) {
+            invalidate();
+            return;
+        }
+        addRoute(routes.back(), routes.size() - 1);
+        mIndexedSize = routes.size();
+    }
+
+    // To be called after 'portId' was added to the sources of the route at 'position'.
+    void onSourceAppended(const std::vector<R>& routes, size_t position, int32_t portId) {
+        if (mIndexedSize != routes.size()) {
+            invalidate();
+            return;
+        }
+        insertSorted(mBySource[portId], position);
+    }
+
+    void invalidate() { mIndexedSize = kInvalidSize; }
+
+  private:
+    static constexpr size_t kInvalidSize = SIZE_MAX;
+
+    static const std::vector<size_t>& findOrEmpty(
+            const std::unordered_map<int32_t, std::vector<size_t>>& m, int32_t portId) {
+        static const std::vector<size_t> kEmpty;
+        auto it = m.find(portId);
+        return it != m.end() ? it->second : kEmpty;
+    }
+
+    static void insertSorted(std::vector<size_t>& positions, size_t position) {
+        auto it = std::lower_bound(positions.begin(), positions.end(), position);
+        if (it == positions.end() || *it != position) {
+            positions.insert(it, position);
+        }
+    }
+
+    void addRoute(const R& route, size_t position) {
+        insertSorted(mBySink[route.sinkPortId], position);
+        for (int32_t source : route.sourcePortIds) {
+            insertSorted(mBySource[source], position);
+        }
+    }
+
+    void validate(const std::vector<R>& routes) {
+        if (mIndexedSize == routes.size()) return;
+        mBySink.clear();
+        mBySource.clear();
+        for (size_t i = 0; i < routes.size(); ++i) {
+            addRoute(routes[i], i);
+        }
+        mIndexedSize = routes.size();
+    }
+
+    std::unordered_map<int32_t, std::vector<size_t>> mBySink;
+    std::unordered_map<int32_t, std::vector<size_t>> mBySource;
+    size_t mIndexedSize = kInvalidSize;
+};
+
+}  // namespace aidl::android::hardware::audio::core
@@ -16,7 +16,12 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <mutex>
+#include <thread>
+#include <vector>
 
 #include <aidl/android/hardware/audio/core/sounddose/BnSoundDose.h>
 #include <aidl/android/media/audio/common/AudioDevice.h>
@@ -24,6 +29,8 @@
 #include <audio_utils/MelProcessor.h>
 #include <audio_utils/mutex.h>
 
+#include "core-impl/SpscByteRing.h"
+
 namespace aidl::android::hardware::audio::core::sounddose {
 
 // Interface used for processing the data received by a stream.
@@ -41,7 +48,12 @@ class StreamDataProcessorInterface {
 
 class SoundDose final : public BnSoundDose, public StreamDataProcessorInterface {
   public:
-    SoundDose() : mMelCallback(::android::sp<MelCallback>::make(this)){};
+    // With 'deferredProcessing', 'process' only copies the data into a lock-free ring buffer.
+    // The MEL values are computed on a low priority worker thread and reported in batches.
+    explicit SoundDose(bool deferredProcessing = false)
+        : mDeferredProcessing(deferredProcessing),
+          mMelCallback(::android::sp<MelCallback>::make(this)){};
+    ~SoundDose() override;
 
     // -------------------------------------- BnSoundDose ------------------------------------------
     ndk::ScopedAStatus setOutputRs2UpperBound(float in_rs2ValueDbA) override;
@@ -70,18 +82,50 @@ class SoundDose final : public BnSoundDose, public StreamDataProcessorInterface
         SoundDose& mSoundDose;  // must outlive MelCallback, not owning
     };
 
+    // Deferred processing: the ring holds the data of this duration, the worker empties it at
+    // least every period, and the MEL values are sent when there are this many, or when the
+    // oldest of them waits for longer than the delay.
+    static constexpr int kRingDurationMs = 400;
+    static constexpr auto kWorkerPeriod = std::chrono::milliseconds(100);
+    static constexpr size_t kMaxMelBatchSize = 10;
+    static constexpr int64_t kMaxMelBatchDelaySec = 10;
+
     void onNewMelValues(const std::vector<float>& mels, size_t offset, size_t length,
                         audio_port_handle_t deviceId) const;
     void onMomentaryExposure(float currentMel, audio_port_handle_t deviceId) const;
+    bool canSendCallbackLocked(const char* caller) const REQUIRES(mCbMutex);
+    void flushMelBatchLocked() const REQUIRES(mCbMutex);
 
+    void lockProducer();
+    void unlockProducer() { mProducerBusy.clear(std::memory_order_release); }
+    void processRingLocked() REQUIRES(mMutex);
+    void workerLoop();
+
+    const bool mDeferredProcessing;
     mutable ::android::audio_utils::mutex mCbMutex;
     std::shared_ptr<ISoundDose::IHalSoundDoseCallback> mCallback GUARDED_BY(mCbMutex);
     std::optional<::aidl::android::media::audio::common::AudioDevice> mAudioDevice
             GUARDED_BY(mCbMutex);
+    // Deferred processing: MEL values not sent yet, reused to avoid allocations.
+    mutable ISoundDose::IHalSoundDoseCallback::MelRecord mMelBatch GUARDED_BY(mCbMutex);
     mutable ::android::audio_utils::mutex mMutex;
     float mRs2Value GUARDED_BY(mMutex) = DEFAULT_MAX_RS2;
     ::android::sp<::android::audio_utils::MelProcessor> mMelProcessor GUARDED_BY(mMutex);
     ::android::sp<MelCallback> mMelCallback GUARDED_BY(mMutex);
+
+    // Deferred processing. The ring is written by the stream threads, one at a time, and read
+    // by the worker with mMutex held. Writers do not wait for each other: a buffer which comes
+    // while another one is being written is dropped.
+    SpscByteRing mRing;
+    std::atomic_flag mProducerBusy = ATOMIC_FLAG_INIT;
+    std::atomic<uint64_t> mDroppedBytes = 0;
+    size_t mFrameSize GUARDED_BY(mMutex) = 0;
+    std::vector<uint8_t> mProcessBuffer GUARDED_BY(mMutex);
+    uint64_t mReportedDroppedBytes GUARDED_BY(mMutex) = 0;
+    std::mutex mWorkerMutex;
+    std::condition_variable mWorkerCv;
+    bool mWorkerExit GUARDED_BY(mWorkerMutex) = false;
+    std::thread mWorker;
 };
 
 }  // namespace aidl::android::hardware::audio::core::sounddose
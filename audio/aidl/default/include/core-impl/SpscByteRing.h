@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace aidl::android::hardware::audio::core {
+
+// Lock-free ring buffer of bytes with a single writer thread and a single reader thread.
+//
+// A write is either done entirely or not at all, so the reader never sees a part of a write,
+// and neither side ever blocks or allocates.
+class SpscByteRing {
+  public:
+    SpscByteRing() = default;
+    explicit SpscByteRing(size_t capacity) { reset(capacity); }
+
+    // Rounds the capacity up to a power of two and empties the ring. Neither the writer nor the
+    // reader may use the ring at the same time.
+    void reset(size_t capacity) {
+        size_t rounded = capacity > 0 ? 1 : 0;
+        while (rounded < capacity) rounded <<= 1;
+        mBuffer.assign(rounded, 0);
+        mReadIndex.store(0, std::memory_order_relaxed);
+        mWriteIndex.store(0, std::memory_order_relaxed);
+    }
+    size_t capacity() const { return mBuffer.size(); }
+
+    // Writer side. Returns false if there is not enough space for all of 'size' bytes.
+    bool write(const void* data, size_t size) {
+        const uint64_t writeIndex = mWriteIndex.load(std::memory_order_relaxed);
+        const uint64_t readIndex = mReadIndex.load(std::memory_order_acquire);
+        if (size > capacity() - (writeIndex - readIndex)) return false;
+        if (size == 0) return true;
+        const size_t offset = writeIndex & (capacity() - 1);
+        const size_t firstPart = std::min(size, capacity() - offset);
+        memcpy(&mBuffer[offset], data, firstPart);
+        memcpy(&mBuffer[0], static_cast<const uint8_t*>(data) + firstPart, size - firstPart);
+        mWriteIndex.store(writeIndex + size, std::memory_order_release);
+        return true;
+    }
+
+    // Reader side.
+    size_t availableToRead() const {
+        return mWriteIndex.load(std::memory_order_acquire) -
+               mReadIndex.load(std::memory_order_relaxed);
+    }
+    // Reads up to 'size' bytes, returns the number of bytes read.
+    size_t read(void* data, size_t size) {
+        const uint64_t readIndex = mReadIndex.load(std::memory_order_relaxed);
+        const uint64_t writeIndex = mWriteIndex.load(std::memory_order_acquire);
+        size = std::min<uint64_t>(size, writeIndex - readIndex);
+        if (size == 0) return 0;
+        const size_t offset = readIndex & (capacity() - 1);
+        const size_t firstPart = std::min(size, capacity() - offset);
+        memcpy(data, &mBuffer[offset], firstPart);
+        memcpy(static_cast<uint8_t*>(data) + firstPart, &mBuffer[0], size - firstPart);
+        mReadIndex.store(readIndex + size, std::memory_order_release);
+        return size;
+    }
+
+  private:
+    std::vector<uint8_t> mBuffer;
+    // Free running byte counts, the positions in the buffer are taken modulo the capacity.
+    // On separate cache lines, so that the writer and the reader do not contend.
+    alignas(64) std::atomic<uint64_t> mReadIndex = 0;
+    alignas(64) std::atomic<uint64_t> mWriteIndex = 0;
+};
+
+}  // namespace aidl::android::hardware::audio::core
@@ -171,6 +171,12 @@ struct DriverInterface {
     virtual ::android::status_t start() = 0;
     virtual ::android::status_t transfer(void* buffer, size_t frameCount, size_t* actualFrameCount,
                                          int32_t* latencyMs) = 0;
+    // Drivers returning 'true' get the memory of the data MQ passed directly to 'transfer',
+    // instead of an intermediate buffer which the worker copies to or from the MQ. When the
+    // transferred region wraps around the end of the MQ, 'transfer' is called once for each of
+    // the two contiguous parts, thus the driver must not assume that each call corresponds
+    // to a complete client burst.
+    virtual bool isInPlaceTransferSupported() const { return false; }
     // No need to implement 'refinePosition' unless the driver can provide more precise
     // data than just total frame count. For example, the driver may correctly account
     // for any intermediate buffers.
@@ -208,6 +214,15 @@ class StreamWorkerCommonLogic : public ::android::hardware::audio::common::Strea
         mState = state;
         mTransientStateStart = std::chrono::steady_clock::now();
     }
+    // Returns whether the first 'byteCount' bytes of the MQ transaction can be passed to the
+    // driver in place, that is, whether the driver supports it and no frame is split by
+    // the wrap-around of the MQ.
+    bool canTransferInPlace(const StreamContext::DataMQ::MemTransaction& transaction,
+                            size_t byteCount) const;
+    // Calls 'DriverInterface::transfer' directly on the regions of the MQ transaction.
+    ::android::status_t transferInPlace(const StreamContext::DataMQ::MemTransaction& transaction,
+                                        size_t frameCount, size_t* actualFrameCount,
+                                        int32_t* latencyMs);
 
     // The context is only used for reading, except for updating the frame count,
     // which happens on the worker thread only.
@@ -223,6 +238,9 @@ class StreamWorkerCommonLogic : public ::android::hardware::audio::common::Strea
     // All fields below are used on the worker thread only.
     const std::chrono::duration<int, std::milli> mTransientStateDelayMs;
     std::chrono::time_point<std::chrono::steady_clock> mTransientStateStart;
+    // Set from the driver during 'init'.
+    bool mIsInPlaceTransferSupported = false;
+    // The intermediate buffer used when the data can not be transferred in place.
     // We use an array and the "size" field instead of a vector to be able to detect
     // memory allocation issues.
     std::unique_ptr<DataBufferElement[]> mDataBuffer;
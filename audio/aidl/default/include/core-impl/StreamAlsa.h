@@ -41,6 +41,7 @@ class StreamAlsa : public StreamCommonImpl {
     ::android::status_t start() override;
     ::android::status_t transfer(void* buffer, size_t frameCount, size_t* actualFrameCount,
                                  int32_t* latencyMs) override;
+    bool isInPlaceTransferSupported() const override { return true; }
     ::android::status_t refinePosition(StreamDescriptor::Position* position) override;
     void shutdown() override;
 
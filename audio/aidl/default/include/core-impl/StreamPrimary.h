@@ -30,6 +30,8 @@ class StreamPrimary : public StreamAlsa {
     ::android::status_t start() override;
     ::android::status_t transfer(void* buffer, size_t frameCount, size_t* actualFrameCount,
                                  int32_t* latencyMs) override;
+    // The pacing workaround in 'transfer' expects to be called once per burst.
+    bool isInPlaceTransferSupported() const override { return false; }
     ::android::status_t refinePosition(StreamDescriptor::Position* position) override;
 
   protected:
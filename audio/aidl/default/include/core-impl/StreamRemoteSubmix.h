@@ -20,6 +20,7 @@
 
 #include "core-impl/Stream.h"
 #include "core-impl/StreamSwitcher.h"
+#include "r_submix/SubmixPacer.h"
 #include "r_submix/SubmixRoute.h"
 
 namespace aidl::android::hardware::audio::core {
@@ -38,6 +39,7 @@ class StreamRemoteSubmix : public StreamCommonImpl {
     ::android::status_t start() override;
     ::android::status_t transfer(void* buffer, size_t frameCount, size_t* actualFrameCount,
                                  int32_t* latencyMs) override;
+    bool isInPlaceTransferSupported() const override { return true; }
     ::android::status_t refinePosition(StreamDescriptor::Position* position) override;
     void shutdown() override;
 
@@ -52,20 +54,15 @@ class StreamRemoteSubmix : public StreamCommonImpl {
 
     const ::aidl::android::media::audio::common::AudioDeviceAddress mDeviceAddress;
     const bool mIsInput;
+    r_submix::SubmixPacer mPacer;
     r_submix::AudioConfig mStreamConfig;
     std::shared_ptr<r_submix::SubmixRoute> mCurrentRoute = nullptr;
 
     // Limit for the number of error log entries to avoid spamming the logs.
     static constexpr int kMaxErrorLogs = 5;
-    // The duration of kMaxReadFailureAttempts * READ_ATTEMPT_SLEEP_MS must be strictly inferior
-    // to the duration of a record buffer at the current record sample rate (of the device, not of
-    // the recording itself). Here we have: 3 * 5ms = 15ms < 1024 frames * 1000 / 48000 = 21.333ms
+    // Limit for the number of logged consecutive short reads, they are counted in the route stats.
     static constexpr int kMaxReadFailureAttempts = 3;
-    // 5ms between two read attempts when pipe is empty
-    static constexpr int kReadAttemptSleepUs = 5000;
 
-    int64_t mStartTimeNs = 0;
-    long mFramesSinceStart = 0;
     int mReadErrorCount = 0;
     int mReadFailureCount = 0;
     int mWriteShutdownCount = 0;
@@ -32,6 +32,7 @@ class StreamStub : public StreamCommonImpl {
     ::android::status_t start() override;
     ::android::status_t transfer(void* buffer, size_t frameCount, size_t* actualFrameCount,
                                  int32_t* latencyMs) override;
+    bool isInPlaceTransferSupported() const override { return true; }
     void shutdown() override;
 
   private:
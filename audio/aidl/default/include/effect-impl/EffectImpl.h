@@ -25,11 +25,15 @@
 #include "EffectThread.h"
 #include "EffectTypes.h"
 #include "effect-impl/EffectContext.h"
+#include "effect-impl/EffectScheduler.h"
 #include "effect-impl/EffectThread.h"
 #include "effect-impl/EffectTypes.h"
 
 extern "C" binder_exception_t destroyEffect(
         const std::shared_ptr<aidl::android::hardware::audio::effect::IEffect>& instanceSp);
+extern "C" binder_exception_t setEffectScheduler(
+        const std::shared_ptr<aidl::android::hardware::audio::effect::IEffect>& instanceSp,
+        const std::shared_ptr<aidl::android::hardware::audio::effect::EffectScheduler>& scheduler);
 
 namespace aidl::android::hardware::audio::effect {
 
@@ -88,6 +92,11 @@ class EffectImpl : public BnEffect, public EffectThread {
      */
     void process() override;
 
+    // EffectScheduler::Task, valid from open() to close().
+    int getGroupId() override { return mSessionId; }
+    std::atomic<uint32_t>* getWakeWord() override { return mEventFlagWord; }
+    uint32_t getWakeMask() override { return mDataMqNotEmptyEf; }
+
   protected:
     // current Hal version
     int mVersion = 0;
@@ -118,5 +127,8 @@ class EffectImpl : public BnEffect, public EffectThread {
     }
 
     ::android::hardware::EventFlag* mEventFlag;
+    // The word behind mEventFlag and the session, cached for the scheduler which can not lock.
+    std::atomic<uint32_t>* mEventFlagWord = nullptr;
+    int mSessionId = INVALID_AUDIO_SESSION_ID;
 };
 }  // namespace aidl::android::hardware::audio::effect
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace aidl::android::hardware::audio::effect {
+
+/**
+ * Runs the processing of several effect instances on shared worker threads, instead of one
+ * EffectThread per instance.
+ *
+ * The scheduler is owned by the effect factory and handed to the effect libraries it loads, so
+ * this is a pure interface: the libraries only call through the vtable and never depend on the
+ * implementation.
+ */
+class EffectScheduler {
+  public:
+    class Task {
+      public:
+        virtual ~Task() = default;
+
+        virtual std::string getTaskName() = 0;
+        // Tasks of the same group (the audio session) run on the same worker, back to back.
+        virtual int getGroupId() = 0;
+        /**
+         * The event flag word the client wakes when there is input to process, and the bits it
+         * sets. Both must stay valid until removeTask() returns.
+         */
+        virtual std::atomic<uint32_t>* getWakeWord() = 0;
+        virtual uint32_t getWakeMask() = 0;
+        // Called on a worker thread once any of the wake bits are set.
+        virtual void process() = 0;
+    };
+
+    virtual ~EffectScheduler() = default;
+
+    /**
+     * Adds a stopped task. Returns false if the task can not be scheduled, the caller then has to
+     * process on a thread of its own.
+     */
+    virtual bool addTask(Task* task) = 0;
+    /**
+     * Removes a task. When this returns, process() is not running and will not be called anymore
+     * for the task.
+     */
+    virtual void removeTask(Task* task) = 0;
+    virtual void startTask(Task* task) = 0;
+    virtual void stopTask(Task* task) = 0;
+};
+
+}  // namespace aidl::android::hardware::audio::effect
@@ -25,14 +25,21 @@
 #include <system/thread_defs.h>
 
 #include "effect-impl/EffectContext.h"
+#include "effect-impl/EffectScheduler.h"
 #include "effect-impl/EffectTypes.h"
 
 namespace aidl::android::hardware::audio::effect {
 
-class EffectThread {
+class EffectThread : public EffectScheduler::Task {
   public:
     virtual ~EffectThread();
 
+    /**
+     * Runs process() on the workers of 'scheduler' instead of a thread of its own, from the next
+     * createThread() on. Falls back to a thread of its own if the scheduler is full.
+     */
+    void setScheduler(std::shared_ptr<EffectScheduler> scheduler);
+
     // called by effect implementation
     RetCode createThread(const std::string& name, int priority = ANDROID_PRIORITY_URGENT_AUDIO);
     RetCode destroyThread();
@@ -47,7 +54,9 @@ class EffectThread {
      * processing to be called under Effect thread mutex mThreadMutex, to avoid the effect state
      * change before/during data processing, and keep the thread and effect state consistent.
      */
-    virtual void process() = 0;
+    void process() override = 0;
+
+    std::string getTaskName() override { return mName; }
 
   private:
     static constexpr int kMaxTaskNameLen = 15;
@@ -60,5 +69,9 @@ class EffectThread {
     std::thread mThread;
     int mPriority;
     std::string mName;
+
+    std::shared_ptr<EffectScheduler> mScheduler;
+    // Set while the effect is registered with mScheduler rather than running mThread.
+    bool mScheduled = false;
 };
 }  // namespace aidl::android::hardware::audio::effect
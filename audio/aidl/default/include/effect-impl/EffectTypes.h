@@ -22,6 +22,8 @@
 #include <android-base/logging.h>
 #include <system/audio_effects/aidl_effects_utils.h>
 
+#include "effect-impl/EffectScheduler.h"
+
 typedef binder_exception_t (*EffectCreateFunctor)(
         const ::aidl::android::media::audio::common::AudioUuid*,
         std::shared_ptr<::aidl::android::hardware::audio::effect::IEffect>*);
@@ -30,11 +32,16 @@ typedef binder_exception_t (*EffectDestroyFunctor)(
 typedef binder_exception_t (*EffectQueryFunctor)(
         const ::aidl::android::media::audio::common::AudioUuid*,
         ::aidl::android::hardware::audio::effect::Descriptor*);
+typedef binder_exception_t (*EffectSetSchedulerFunctor)(
+        const std::shared_ptr<::aidl::android::hardware::audio::effect::IEffect>&,
+        const std::shared_ptr<::aidl::android::hardware::audio::effect::EffectScheduler>&);
 
 struct effect_dl_interface_s {
     EffectCreateFunctor createEffectFunc;
     EffectDestroyFunctor destroyEffectFunc;
     EffectQueryFunctor queryEffectFunc;
+    // Optional, libraries without it process every instance on its own thread.
+    EffectSetSchedulerFunctor setSchedulerFunc;
 };
 
 namespace aidl::android::hardware::audio::effect {
@@ -26,6 +26,7 @@
 #include <aidl/android/hardware/audio/effect/BnFactory.h>
 #include <android-base/thread_annotations.h>
 #include "EffectConfig.h"
+#include "EffectWorkerPool.h"
 
 namespace aidl::android::hardware::audio::effect {
 
@@ -80,10 +81,15 @@ class Factory : public BnFactory {
             const std::shared_ptr<::aidl::android::hardware::audio::effect::IEffect>& in_handle)
             override;
 
+    binder_status_t dump(int fd, const char** args, uint32_t numArgs) override;
+
   private:
     const EffectConfig mConfig;
     ~Factory();
 
+    // Shared by the effects of libraries which support it, null if disabled.
+    std::shared_ptr<EffectWorkerPool> mWorkerPool;
+
     std::mutex mMutex;
     // Set of effect descriptors supported by the devices.
     std::set<Descriptor> mDescSet GUARDED_BY(mMutex);
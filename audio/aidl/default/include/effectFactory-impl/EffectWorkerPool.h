@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <android-base/thread_annotations.h>
+#include <system/thread_defs.h>
+
+#include "effect-impl/EffectScheduler.h"
+
+namespace aidl::android::hardware::audio::effect {
+
+/**
+ * EffectScheduler on a fixed number of worker threads.
+ *
+ * Each worker waits on the event flag words of all its started effects at once with futex_waitv,
+ * and on wakeup processes every effect with pending input back to back. The effects of a session
+ * share a worker, so a preprocessing or post-processing chain costs one wakeup per period instead
+ * of one per effect.
+ *
+ * The processing time of each effect is measured and reported by dump().
+ */
+class EffectWorkerPool final : public EffectScheduler {
+  public:
+    /**
+     * Returns nullptr if the kernel does not support futex_waitv, the effects then keep a thread
+     * each.
+     */
+    static std::shared_ptr<EffectWorkerPool> create(size_t workerCount,
+                                                    int priority = ANDROID_PRIORITY_URGENT_AUDIO);
+    ~EffectWorkerPool() override;
+
+    bool addTask(Task* task) override;
+    void removeTask(Task* task) override;
+    void startTask(Task* task) override;
+    void stopTask(Task* task) override;
+
+    void dump(int fd);
+
+  private:
+    class Worker;
+
+    EffectWorkerPool(size_t workerCount, int priority);
+
+    // Fixed at construction.
+    std::vector<std::unique_ptr<Worker>> mWorkers;
+
+    std::mutex mMutex;
+    std::map<Task*, Worker*> mTaskWorkers GUARDED_BY(mMutex);
+
+    Worker* getWorker(Task* task);
+};
+
+}  // namespace aidl::android::hardware::audio::effect
@@ -156,11 +156,36 @@ RetCode LoudnessEnhancerSw::releaseContext() {
 
 // Processing method running in EffectWorker thread.
 IEffect::Status LoudnessEnhancerSw::effectProcessImpl(float* in, float* out, int samples) {
-    // TODO: get data buffer and process.
-    LOG(DEBUG) << __func__ << " in " << in << " out " << out << " samples " << samples;
-    for (int i = 0; i < samples; i++) {
-        *out++ = *in++;
+    RETURN_VALUE_IF(!mContext, (IEffect::Status{EX_NULL_POINTER, 0, 0}), "nullContext");
+    return mContext->process(in, out, samples);
+}
+
+RetCode LoudnessEnhancerSwContext::setCommon(const Parameter::Common& common) {
+    if (auto ret = EffectContext::setCommon(common); ret != RetCode::SUCCESS) {
+        return ret;
     }
+    configureGain();
+    return RetCode::SUCCESS;
+}
+
+RetCode LoudnessEnhancerSwContext::setLeGainMb(int gainMb) {
+    mGainMb = gainMb;
+    mGain.setGain(dsp::millibelsToGain(mGainMb), dsp::GainRamp::kDefaultRampFrames,
+                  dsp::GainRamp::Shape::kExponential);
+    return RetCode::SUCCESS;
+}
+
+void LoudnessEnhancerSwContext::configureGain() {
+    if (!mGain.configure(mInputChannelCount, mOutputChannelCount)) {
+        LOG(WARNING) << __func__ << " unsupported IO, bypass: in channels " << mInputChannelCount
+                     << " out channels " << mOutputChannelCount;
+        return;
+    }
+    mGain.setGain(dsp::millibelsToGain(mGainMb), 0 /* rampFrames */);
+}
+
+IEffect::Status LoudnessEnhancerSwContext::process(float* in, float* out, int samples) {
+    mGain.processInterleaved(in, out, samples);
     return {STATUS_OK, samples, samples};
 }
 
@@ -21,6 +21,7 @@
 #include <cstdlib>
 #include <memory>
 
+#include "dsp/Gain.h"
 #include "effect-impl/EffectImpl.h"
 
 namespace aidl::android::hardware::audio::effect {
@@ -30,17 +31,24 @@ class LoudnessEnhancerSwContext final : public EffectContext {
     LoudnessEnhancerSwContext(int statusDepth, const Parameter::Common& common)
         : EffectContext(statusDepth, common) {
         LOG(DEBUG) << __func__;
+        configureGain();
     }
 
-    RetCode setLeGainMb(int gainMb) {
-        // TODO : Add implementation to apply new gain
-        mGainMb = gainMb;
-        return RetCode::SUCCESS;
-    }
+    RetCode setCommon(const Parameter::Common& common) override;
+
+    RetCode setLeGainMb(int gainMb);
     int getLeGainMb() const { return mGainMb; }
 
+    IEffect::Status process(float* in, float* out, int samples);
+
   private:
     int mGainMb = 0;  // Default Gain
+
+    // The target gain is applied as is, without the limiter of the framework implementation, so
+    // the float output may exceed full scale.
+    dsp::GainRamp mGain;
+
+    void configureGain();
 };
 
 class LoudnessEnhancerSw final : public EffectImpl {
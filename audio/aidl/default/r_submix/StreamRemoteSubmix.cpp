@@ -24,6 +24,7 @@
 
 using aidl::android::hardware::audio::common::SinkMetadata;
 using aidl::android::hardware::audio::common::SourceMetadata;
+using aidl::android::hardware::audio::core::r_submix::SubmixPacer;
 using aidl::android::hardware::audio::core::r_submix::SubmixRoute;
 using aidl::android::media::audio::common::AudioDeviceAddress;
 using aidl::android::media::audio::common::AudioOffloadInfo;
@@ -36,7 +37,8 @@ StreamRemoteSubmix::StreamRemoteSubmix(StreamContext* context, const Metadata& m
                                        const AudioDeviceAddress& deviceAddress)
     : StreamCommonImpl(context, metadata),
       mDeviceAddress(deviceAddress),
-      mIsInput(isInput(metadata)) {
+      mIsInput(isInput(metadata)),
+      mPacer(context->getSampleRate()) {
     mStreamConfig.frameSize = context->getFrameSize();
     mStreamConfig.format = context->getFormat();
     mStreamConfig.channelLayout = context->getChannelLayout();
@@ -90,8 +92,7 @@ StreamRemoteSubmix::StreamRemoteSubmix(StreamContext* context, const Metadata& m
 
 ::android::status_t StreamRemoteSubmix::start() {
     mCurrentRoute->exitStandby(mIsInput);
-    mStartTimeNs = ::android::uptimeNanos();
-    mFramesSinceStart = 0;
+    mPacer.start();
     return ::android::OK;
 }
 
@@ -140,20 +141,17 @@ void StreamRemoteSubmix::shutdown() {
         ((status != ::android::OK && status != ::android::DEAD_OBJECT) && !mIsInput)) {
         return status;
     }
-    mFramesSinceStart += *actualFrameCount;
-    if (!mIsInput && status != ::android::DEAD_OBJECT) return ::android::OK;
     // Input streams always need to block, output streams need to block when there is no sink.
     // When the sink exists, more sophisticated blocking algorithm is implemented by MonoPipe.
-    const long bufferDurationUs =
-            (*actualFrameCount) * MICROS_PER_SECOND / mContext.getSampleRate();
-    const auto totalDurationUs = (::android::uptimeNanos() - mStartTimeNs) / NANOS_PER_MICROSECOND;
-    const long totalOffsetUs =
-            mFramesSinceStart * MICROS_PER_SECOND / mContext.getSampleRate() - totalDurationUs;
-    LOG(VERBOSE) << __func__ << ": totalOffsetUs " << totalOffsetUs;
-    if (totalOffsetUs > 0) {
-        const long sleepTimeUs = std::min(totalOffsetUs, bufferDurationUs);
-        LOG(VERBOSE) << __func__ << ": sleeping for " << sleepTimeUs << " us";
-        usleep(sleepTimeUs);
+    bool isLate = false;
+    if (mIsInput || status == ::android::DEAD_OBJECT) {
+        isLate = mPacer.pace(*actualFrameCount);
+    } else {
+        mPacer.advance(*actualFrameCount, &isLate);
+    }
+    if (isLate) {
+        LOG(VERBOSE) << __func__ << ": late by more than " << *actualFrameCount << " frames";
+        mCurrentRoute->onLatePeriod(mIsInput);
     }
     return ::android::OK;
 }
@@ -220,6 +218,7 @@ size_t StreamRemoteSubmix::getStreamPipeSizeInFrames() {
         size_t framesToFlushFromSource = frameCount - availableToWrite;
         LOG(DEBUG) << __func__ << ": flushing " << framesToFlushFromSource
                    << " frames from the pipe to avoid blocking";
+        mCurrentRoute->onOverrun(framesToFlushFromSource);
         while (framesToFlushFromSource) {
             const size_t flushSize = std::min(framesToFlushFromSource, flushBufferSizeFrames);
             framesToFlushFromSource -= flushSize;
@@ -233,6 +232,7 @@ size_t StreamRemoteSubmix::getStreamPipeSizeInFrames() {
         LOG(WARNING) << __func__ << ": writing " << availableToWrite << " vs. requested "
                      << frameCount;
         // Truncate the request to avoid blocking.
+        mCurrentRoute->onOverrun(frameCount - availableToWrite);
         frameCount = availableToWrite;
     }
     ssize_t writtenFrames = sink->write(buffer, frameCount);
@@ -257,6 +257,9 @@ size_t StreamRemoteSubmix::getStreamPipeSizeInFrames() {
     if (writtenFrames > 0 && frameCount > (size_t)writtenFrames) {
         LOG(WARNING) << __func__ << ": wrote " << writtenFrames << " vs. requested " << frameCount;
     }
+    if (writtenFrames > 0) {
+        mCurrentRoute->notifyWrite();
+    }
     *actualFrameCount = writtenFrames;
     return ::android::OK;
 }
@@ -285,10 +288,10 @@ size_t StreamRemoteSubmix::getStreamPipeSizeInFrames() {
     char* buff = (char*)buffer;
     size_t actuallyRead = 0;
     long remainingFrames = frameCount;
-    const int64_t deadlineTimeNs =
-            ::android::uptimeNanos() +
-            getDelayInUsForFrameCount(frameCount) * NANOS_PER_MICROSECOND / 2;
+    const int64_t deadlineTimeNs = SubmixPacer::nowNs() + mPacer.getDurationNs(frameCount) / 2;
     while (remainingFrames > 0) {
+        // Taken before reading, so that a write done after the read ends the wait right away.
+        const uint64_t writeCount = mCurrentRoute->getWriteCount();
         ssize_t framesRead = source->read(buff, remainingFrames);
         LOG(VERBOSE) << __func__ << ": frames read " << framesRead;
         if (framesRead > 0) {
@@ -298,14 +301,13 @@ size_t StreamRemoteSubmix::getStreamPipeSizeInFrames() {
                          << " frames, remaining =" << remainingFrames;
             actuallyRead += framesRead;
         }
-        if (::android::uptimeNanos() >= deadlineTimeNs) break;
-        if (framesRead <= 0) {
-            LOG(VERBOSE) << __func__ << ": read returned " << framesRead
-                         << ", read failure, sleeping for " << kReadAttemptSleepUs << " us";
-            usleep(kReadAttemptSleepUs);
+        if (remainingFrames > 0 && !mCurrentRoute->waitForWrite(writeCount, deadlineTimeNs)) {
+            LOG(VERBOSE) << __func__ << ": no write to the pipe until the deadline";
+            break;
         }
     }
     if (actuallyRead < frameCount) {
+        mCurrentRoute->onUnderrun(frameCount - actuallyRead);
         if (++mReadFailureCount < kMaxReadFailureAttempts) {
             LOG(WARNING) << __func__ << ": read " << actuallyRead << " vs. requested " << frameCount
                          << " (not all errors will be logged)";
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <ctime>
+
+#include "SubmixPacer.h"
+
+namespace aidl::android::hardware::audio::core::r_submix {
+
+namespace {
+
+constexpr int64_t kNanosPerSecond = 1000000000;
+
+}  // namespace
+
+// static
+int64_t SubmixPacer::nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * kNanosPerSecond + ts.tv_nsec;
+}
+
+// static
+void SubmixPacer::sleepUntilNs(int64_t deadlineNs) {
+    const struct timespec deadline = {.tv_sec = static_cast<time_t>(deadlineNs / kNanosPerSecond),
+                                      .tv_nsec = static_cast<long>(deadlineNs % kNanosPerSecond)};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {
+    }
+}
+
+void SubmixPacer::start() {
+    mStartNs = mClock();
+    mFramesSinceStart = 0;
+}
+
+int64_t SubmixPacer::getDurationNs(size_t frameCount) const {
+    return framesToNs(frameCount);
+}
+
+int64_t SubmixPacer::advance(size_t frameCount, bool* isLate) {
+    mFramesSinceStart += frameCount;
+    const int64_t nowNs = mClock();
+    const int64_t durationNs = getDurationNs(frameCount);
+    const int64_t deadlineNs = mStartNs + framesToNs(mFramesSinceStart);
+    if (isLate != nullptr) {
+        *isLate = deadlineNs < nowNs - durationNs;
+    }
+    return std::min(deadlineNs, nowNs + durationNs);
+}
+
+bool SubmixPacer::pace(size_t frameCount) {
+    bool isLate = false;
+    sleepUntilNs(advance(frameCount, &isLate));
+    return isLate;
+}
+
+// Split into whole seconds to avoid an overflow on long running streams.
+int64_t SubmixPacer::framesToNs(int64_t frames) const {
+    return frames / mSampleRate * kNanosPerSecond +
+           frames % mSampleRate * kNanosPerSecond / mSampleRate;
+}
+
+}  // namespace aidl::android::hardware::audio::core::r_submix
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace aidl::android::hardware::audio::core::r_submix {
+
+// Paces a stream to its sample rate using absolute deadlines on CLOCK_MONOTONIC.
+//
+// The deadline of a transfer is the time at which all the frames transferred since 'start' have
+// been played at the nominal rate. Sleeping until an absolute deadline, rather than for a relative
+// duration, keeps scheduling latency and the processing time of the caller from accumulating
+// into drift.
+class SubmixPacer {
+  public:
+    static int64_t nowNs();
+    // Sleeps until 'deadlineNs' on CLOCK_MONOTONIC, restarting after signals.
+    static void sleepUntilNs(int64_t deadlineNs);
+
+    // 'clock' returns the current time in nanoseconds for 'start' and 'advance', tests can pass a
+    // simulated one.
+    explicit SubmixPacer(int sampleRate, int64_t (*clock)() = &SubmixPacer::nowNs)
+        : mSampleRate(sampleRate), mClock(clock) {}
+
+    void start();
+    int64_t getDurationNs(size_t frameCount) const;
+    // Counts 'frameCount' transferred frames and returns when they would have been played, but
+    // never later than their own duration from now, so that a transfer is not delayed by more than
+    // a period. 'isLate' is set if the frames should have been played more than their duration
+    // ago, that is, the client has missed a period.
+    int64_t advance(size_t frameCount, bool* isLate = nullptr);
+    // Calls 'advance' and sleeps until the returned deadline. Returns the 'isLate' result.
+    bool pace(size_t frameCount);
+
+  private:
+    int64_t framesToNs(int64_t frames) const;
+
+    const int mSampleRate;
+    int64_t (*const mClock)();
+    int64_t mStartNs = 0;
+    int64_t mFramesSinceStart = 0;
+};
+
+}  // namespace aidl::android::hardware::audio::core::r_submix
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <chrono>
 #include <mutex>
 
 #define LOG_TAG "AHAL_SubmixRoute"
@@ -146,6 +147,45 @@ long SubmixRoute::updateReadCounterFrames(size_t frameCount) {
     return mReadCounterFrames;
 }
 
+void SubmixRoute::notifyWrite() {
+    {
+        std::lock_guard guard(mWriteLock);
+        ++mWriteCount;
+    }
+    mWriteCv.notify_all();
+}
+
+uint64_t SubmixRoute::getWriteCount() {
+    std::lock_guard guard(mWriteLock);
+    return mWriteCount;
+}
+
+bool SubmixRoute::waitForWrite(uint64_t writeCount, int64_t deadlineNs) {
+    // steady_clock is CLOCK_MONOTONIC.
+    const std::chrono::steady_clock::time_point deadline{std::chrono::nanoseconds(deadlineNs)};
+    std::unique_lock lock(mWriteLock);
+    ::android::base::ScopedLockAssertion lock_assertion(mWriteLock);
+    return mWriteCv.wait_until(lock, deadline, [&]() REQUIRES(mWriteLock) {
+        return mWriteCount != writeCount;
+    });
+}
+
+void SubmixRoute::onLatePeriod(bool isInput) {
+    std::lock_guard guard(mLock);
+    ++(isInput ? mStats.lateInputPeriods : mStats.lateOutputPeriods);
+}
+
+void SubmixRoute::onOverrun(size_t frameCount) {
+    std::lock_guard guard(mLock);
+    mStats.overrunFrames += frameCount;
+}
+
+void SubmixRoute::onUnderrun(size_t frameCount) {
+    std::lock_guard guard(mLock);
+    ++mStats.underrunCount;
+    mStats.underrunFrames += frameCount;
+}
+
 void SubmixRoute::openStream(bool isInput) {
     std::lock_guard guard(mLock);
     if (isInput) {
@@ -290,7 +330,17 @@ std::string SubmixRoute::dump() NO_THREAD_SAFETY_ANALYSIS {
                                  .append(mStreamOutOpen ? "open" : "closed")
                                  .append(mStreamOutStandby ? ", standby" : ", active")
                                  .append(", framesWritten: ")
-                                 .append(mSink ? std::to_string(mSink->framesWritten()) : "<null>");
+                                 .append(mSink ? std::to_string(mSink->framesWritten()) : "<null>")
+                                 .append("; underruns: ")
+                                 .append(std::to_string(mStats.underrunCount))
+                                 .append(" (")
+                                 .append(std::to_string(mStats.underrunFrames))
+                                 .append(" frames), overrun frames: ")
+                                 .append(std::to_string(mStats.overrunFrames))
+                                 .append(", late periods: input ")
+                                 .append(std::to_string(mStats.lateInputPeriods))
+                                 .append(", output ")
+                                 .append(std::to_string(mStats.lateOutputPeriods));
     if (isLocked) mLock.unlock();
     return result;
 }
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <condition_variable>
+#include <cstdint>
 #include <mutex>
 #include <string>
 
@@ -62,6 +64,18 @@ struct AudioConfig {
 
 class SubmixRoute {
   public:
+    // Timing problems of the streams using the route.
+    struct Stats {
+        // Reads that could not get all the requested frames from the pipe in time.
+        uint64_t underrunCount = 0;
+        uint64_t underrunFrames = 0;
+        // Frames discarded from the pipe so that a non-blocking write does not block.
+        uint64_t overrunFrames = 0;
+        // Transfers that came late by more than their own duration.
+        uint64_t lateInputPeriods = 0;
+        uint64_t lateOutputPeriods = 0;
+    };
+
     static std::shared_ptr<SubmixRoute> findOrCreateRoute(
             const ::aidl::android::media::audio::common::AudioDeviceAddress& deviceAddress,
             const AudioConfig& pipeConfig);
@@ -103,6 +117,10 @@ class SubmixRoute {
         std::lock_guard guard(mLock);
         return mPipeConfig;
     }
+    Stats getStats() {
+        std::lock_guard guard(mLock);
+        return mStats;
+    }
 
     bool isStreamConfigValid(bool isInput, const AudioConfig& streamConfig);
     void closeStream(bool isInput);
@@ -117,6 +135,18 @@ class SubmixRoute {
     void standby(bool isInput);
     long updateReadCounterFrames(size_t frameCount);
 
+    // Wakes up the readers waiting in 'waitForWrite'. Called after each write to the pipe.
+    void notifyWrite();
+    // Number of 'notifyWrite' calls so far, to be taken before reading from the pipe.
+    uint64_t getWriteCount();
+    // Waits until a write after the one counted by 'writeCount', or 'deadlineNs' on
+    // CLOCK_MONOTONIC. Returns false on timeout.
+    bool waitForWrite(uint64_t writeCount, int64_t deadlineNs);
+
+    void onLatePeriod(bool isInput);
+    void onOverrun(size_t frameCount);
+    void onUnderrun(size_t frameCount);
+
     std::string dump();
 
   private:
@@ -148,6 +178,12 @@ class SubmixRoute {
     bool mStreamOutStandby GUARDED_BY(mLock) = true;
     // how many frames have been requested to be read since standby
     long mReadCounterFrames GUARDED_BY(mLock) = 0;
+    Stats mStats GUARDED_BY(mLock);
+
+    // Separate from mLock which the writer takes several times per period.
+    std::mutex mWriteLock;
+    std::condition_variable mWriteCv;
+    uint64_t mWriteCount GUARDED_BY(mWriteLock) = 0;
 
     // Pipe variables: they handle the ring buffer that "pipes" audio:
     //  - from the submix virtual audio output == what needs to be played
@@ -21,6 +21,8 @@
 #include <android-base/logging.h>
 #include <system/audio_effects/effect_uuid.h>
 
+#include <algorithm>
+#include <cmath>
 #include <optional>
 
 using aidl::android::hardware::audio::common::getChannelCount;
@@ -67,6 +69,19 @@ const std::string SpatializerSw::kEffectName = "SpatializerSw";
 const AudioChannelLayout kSupportedChannelMask =
         AudioChannelLayout::make<AudioChannelLayout::layoutMask>(
                 AudioChannelLayout::LAYOUT_5POINT1);
+// Loudspeaker directions of the channels of the supported layout in AudioChannelLayout bit order,
+// ITU-R BS.775 for the surrounds: azimuth clockwise from the front and elevation, in degrees.
+const struct {
+    float azimuthDegrees;
+    float elevationDegrees;
+} kSpeakerPositions[] = {
+        {-30, 0},   // CHANNEL_FRONT_LEFT
+        {30, 0},    // CHANNEL_FRONT_RIGHT
+        {0, 0},     // CHANNEL_FRONT_CENTER
+        {0, 0},     // CHANNEL_LOW_FREQUENCY
+        {-110, 0},  // CHANNEL_BACK_LEFT
+        {110, 0},   // CHANNEL_BACK_RIGHT
+};
 const std::vector<Range::SpatializerRange> SpatializerSw::kRanges = {
         MAKE_RANGE(Spatializer, supportedChannelLayout, {kSupportedChannelMask},
                    {kSupportedChannelMask}),
@@ -172,6 +187,7 @@ IEffect::Status SpatializerSw::effectProcessImpl(float* in, float* out, int samp
 SpatializerSwContext::SpatializerSwContext(int statusDepth, const Parameter::Common& common)
     : EffectContext(statusDepth, common) {
     LOG(DEBUG) << __func__;
+    configureRenderer();
 }
 
 SpatializerSwContext::~SpatializerSwContext() {
@@ -196,25 +212,78 @@ ndk::ScopedAStatus SpatializerSwContext::setParam(TAG tag, Spatializer spatializ
     RETURN_IF(tag == Spatializer::supportedChannelLayout, EX_ILLEGAL_ARGUMENT,
               "supportedChannelLayoutGetOnly");
 
+    if (tag == Spatializer::spatializationLevel) {
+        const bool enabled = spatializer.get<Spatializer::spatializationLevel>() !=
+                             Spatialization::Level::NONE;
+        if (enabled && !mSpatializationEnabled) {
+            // Rendering restarts from silence rather than from the input before the fold down.
+            mConvolver.reset();
+        }
+        mSpatializationEnabled = enabled;
+    }
     mParamsMap[tag] = spatializer;
     return ndk::ScopedAStatus::ok();
 }
 
+RetCode SpatializerSwContext::setCommon(const Parameter::Common& common) {
+    if (auto ret = EffectContext::setCommon(common); ret != RetCode::SUCCESS) {
+        return ret;
+    }
+    configureRenderer();
+    return RetCode::SUCCESS;
+}
+
+void SpatializerSwContext::configureRenderer() {
+    mDownmixer.configure(dsp::StereoDownmixer::Layout::k5Point1);
+    mRendererEnabled = mCommon.input.base.channelMask == kSupportedChannelMask &&
+                       mOutputChannelCount == 2 &&
+                       mConvolver.configure(mInputChannelCount, kBlockFrames, kFilterFrames);
+    if (!mRendererEnabled) {
+        LOG(WARNING) << __func__ << " unsupported IO, bypass: in channels " << mInputChannelCount
+                     << " out channels " << mOutputChannelCount;
+        return;
+    }
+    std::vector<float> left(kFilterFrames);
+    std::vector<float> right(kFilterFrames);
+    for (size_t channel = 0; channel < std::size(kSpeakerPositions); channel++) {
+        dsp::makeSphericalHeadHrir(mCommon.input.base.sampleRate,
+                                   kSpeakerPositions[channel].azimuthDegrees,
+                                   kSpeakerPositions[channel].elevationDegrees, left.data(),
+                                   right.data(), kFilterFrames);
+        // Each channel keeps the power it has in the stereo fold down.
+        const float weight = std::hypot(mDownmixer.getCoefficient(channel, 0),
+                                        mDownmixer.getCoefficient(channel, 1));
+        for (size_t i = 0; i < kFilterFrames; i++) {
+            left[i] *= weight;
+            right[i] *= weight;
+        }
+        mConvolver.setFilter(channel, left.data(), right.data(), kFilterFrames);
+    }
+}
+
 IEffect::Status SpatializerSwContext::process(float* in, float* out, int samples) {
-    LOG(DEBUG) << __func__ << " in " << in << " out " << out << " samples " << samples;
-    IEffect::Status status = {EX_ILLEGAL_ARGUMENT, 0, 0};
+    if (mRendererEnabled) {
+        const size_t frameCount = samples / mInputChannelCount;
+        if (mSpatializationEnabled) {
+            mConvolver.process(in, out, frameCount);
+        } else {
+            mDownmixer.process(in, out, frameCount);
+        }
+        return {STATUS_OK, static_cast<int32_t>(frameCount * mInputChannelCount),
+                static_cast<int32_t>(frameCount * mOutputChannelCount)};
+    }
 
     const auto inputChannelCount = getChannelCount(mCommon.input.base.channelMask);
     const auto outputChannelCount = getChannelCount(mCommon.output.base.channelMask);
     if (outputChannelCount < 2 || inputChannelCount < outputChannelCount) {
         LOG(ERROR) << __func__ << " invalid channel count, in: " << inputChannelCount
                    << " out: " << outputChannelCount;
-        return status;
+        return {EX_ILLEGAL_ARGUMENT, 0, 0};
     }
 
     int iFrames = samples / inputChannelCount;
     for (int i = 0; i < iFrames; i++) {
-        std::memcpy(out, in, outputChannelCount);
+        std::copy_n(in, outputChannelCount, out);
         in += inputChannelCount;
         out += outputChannelCount;
     }
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include "dsp/Convolver.h"
+#include "dsp/Downmix.h"
 #include "effect-impl/EffectContext.h"
 #include "effect-impl/EffectImpl.h"
 
@@ -36,10 +38,26 @@ class SpatializerSwContext final : public EffectContext {
     template <typename TAG>
     ndk::ScopedAStatus setParam(TAG tag, Spatializer spatializer);
 
+    RetCode setCommon(const Parameter::Common& common) override;
+
     IEffect::Status process(float* in, float* out, int samples);
 
   private:
+    // One block of latency, 2.7 ms at 48 kHz.
+    static constexpr size_t kBlockFrames = 128;
+    static constexpr size_t kFilterFrames = 256;
+
     std::unordered_map<Spatializer::Tag, Spatializer> mParamsMap;
+
+    // Renders the speakers of the input layout to binaural output, for both spatialization modes.
+    // Head tracking is not applied.
+    dsp::BinauralConvolver mConvolver;
+    dsp::StereoDownmixer mDownmixer;
+    bool mRendererEnabled = false;
+    // Spatialization level NONE folds down to stereo instead of rendering.
+    bool mSpatializationEnabled = true;
+
+    void configureRenderer();
 };
 
 class SpatializerSw final : public EffectImpl {
@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "effectFactory-impl/EffectWorkerPool.h"
+
+using aidl::android::hardware::audio::effect::EffectScheduler;
+using aidl::android::hardware::audio::effect::EffectWorkerPool;
+
+namespace {
+
+constexpr uint32_t kWakeMask = 1;
+// How long the workers get to react. Only bounds waits for something that should happen, so it
+// can be generous.
+constexpr std::chrono::seconds kTimeout{5};
+// How long to watch for something that should not happen.
+constexpr std::chrono::milliseconds kQuietTime{50};
+
+template <typename Predicate>
+bool waitFor(Predicate predicate) {
+    const auto deadline = std::chrono::steady_clock::now() + kTimeout;
+    while (!predicate()) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+// Stands in for an effect: process() consumes the wake bit, like EffectImpl consumes the
+// data MQ not empty flag.
+class StubTask : public EffectScheduler::Task {
+  public:
+    explicit StubTask(int groupId) : mGroupId(groupId) {}
+
+    std::string getTaskName() override { return "stub" + std::to_string(mGroupId); }
+    int getGroupId() override { return mGroupId; }
+    std::atomic<uint32_t>* getWakeWord() override { return &mWord; }
+    uint32_t getWakeMask() override { return kWakeMask; }
+
+    void process() override {
+        mWord.fetch_and(~kWakeMask);
+        {
+            std::unique_lock l(mMutex);
+            mInProcess = true;
+            mCv.notify_all();
+            mCv.wait(l, [this] { return !mBlocked; });
+            mInProcess = false;
+            mThreadId = std::this_thread::get_id();
+        }
+        mProcessCount++;
+    }
+
+    // Sets the wake bit and wakes the worker, like the client writing to the input MQ.
+    void wake() {
+        mWord.fetch_or(kWakeMask);
+        syscall(__NR_futex, &mWord, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+    }
+
+    // While blocked, process() does not return.
+    void setBlocked(bool blocked) {
+        std::lock_guard lg(mMutex);
+        mBlocked = blocked;
+        mCv.notify_all();
+    }
+
+    bool waitForProcess() {
+        std::unique_lock l(mMutex);
+        return mCv.wait_for(l, kTimeout, [this] { return mInProcess; });
+    }
+
+    int getProcessCount() const { return mProcessCount; }
+
+    std::thread::id getThreadId() {
+        std::lock_guard lg(mMutex);
+        return mThreadId;
+    }
+
+  private:
+    const int mGroupId;
+    std::atomic<uint32_t> mWord = 0;
+    std::atomic<int> mProcessCount = 0;
+    std::mutex mMutex;
+    std::condition_variable mCv;
+    bool mBlocked = false;
+    bool mInProcess = false;
+    std::thread::id mThreadId;
+};
+
+}  // namespace
+
+class EffectWorkerPoolTest : public testing::Test {
+  protected:
+    void SetUp() override {
+        mPool = EffectWorkerPool::create(2, 0 /* priority */);
+        if (!mPool) {
+            GTEST_SKIP() << "futex_waitv not supported";
+        }
+    }
+
+    void TearDown() override {
+        for (auto& task : mTasks) {
+            task->setBlocked(false);
+            if (mPool) mPool->removeTask(task.get());
+        }
+    }
+
+    StubTask* addStartedTask(int groupId) {
+        mTasks.push_back(std::make_unique<StubTask>(groupId));
+        StubTask* task = mTasks.back().get();
+        EXPECT_TRUE(mPool->addTask(task));
+        mPool->startTask(task);
+        return task;
+    }
+
+    std::shared_ptr<EffectWorkerPool> mPool;
+    std::vector<std::unique_ptr<StubTask>> mTasks;
+};
+
+TEST_F(EffectWorkerPoolTest, ProcessesOnWake) {
+    StubTask* task = addStartedTask(1);
+    for (int i = 1; i <= 10; i++) {
+        task->wake();
+        ASSERT_TRUE(waitFor([&] { return task->getProcessCount() == i; }));
+    }
+}
+
+TEST_F(EffectWorkerPoolTest, StoppedTaskIsNotProcessed) {
+    mTasks.push_back(std::make_unique<StubTask>(1));
+    StubTask* task = mTasks.back().get();
+    ASSERT_TRUE(mPool->addTask(task));
+
+    // Added, but not started yet.
+    task->wake();
+    std::this_thread::sleep_for(kQuietTime);
+    EXPECT_EQ(0, task->getProcessCount());
+
+    // The wake bit is still set, so starting processes it right away.
+    mPool->startTask(task);
+    ASSERT_TRUE(waitFor([&] { return task->getProcessCount() == 1; }));
+
+    mPool->stopTask(task);
+    task->wake();
+    std::this_thread::sleep_for(kQuietTime);
+    EXPECT_EQ(1, task->getProcessCount());
+
+    mPool->startTask(task);
+    EXPECT_TRUE(waitFor([&] { return task->getProcessCount() == 2; }));
+}
+
+TEST_F(EffectWorkerPoolTest, SessionSharesWorker) {
+    // With two workers, a second session goes to the idle one, the effects of the first session
+    // stay together.
+    StubTask* first = addStartedTask(1);
+    StubTask* other = addStartedTask(2);
+    StubTask* second = addStartedTask(1);
+    StubTask* third = addStartedTask(1);
+    for (StubTask* task : {first, other, second, third}) {
+        task->wake();
+        ASSERT_TRUE(waitFor([&] { return task->getProcessCount() == 1; }));
+    }
+    EXPECT_EQ(first->getThreadId(), second->getThreadId());
+    EXPECT_EQ(first->getThreadId(), third->getThreadId());
+    EXPECT_NE(first->getThreadId(), other->getThreadId());
+}
+
+TEST_F(EffectWorkerPoolTest, RemoveWaitsForProcess) {
+    StubTask* task = addStartedTask(1);
+    task->setBlocked(true);
+    task->wake();
+    ASSERT_TRUE(task->waitForProcess());
+
+    std::atomic<bool> removed = false;
+    std::thread remover([&] {
+        mPool->removeTask(task);
+        removed = true;
+    });
+    std::this_thread::sleep_for(kQuietTime);
+    EXPECT_FALSE(removed);
+
+    task->setBlocked(false);
+    remover.join();
+    EXPECT_TRUE(removed);
+    EXPECT_EQ(1, task->getProcessCount());
+
+    // Not called anymore once removed.
+    task->wake();
+    std::this_thread::sleep_for(kQuietTime);
+    EXPECT_EQ(1, task->getProcessCount());
+}
+
+TEST_F(EffectWorkerPoolTest, RemoveDoesNotBlockOtherWorker) {
+    StubTask* blocked = addStartedTask(1);
+    StubTask* other = addStartedTask(2);
+    blocked->setBlocked(true);
+    blocked->wake();
+    ASSERT_TRUE(blocked->waitForProcess());
+
+    std::thread remover([&] { mPool->removeTask(blocked); });
+    // The session on the other worker keeps being processed meanwhile.
+    for (int i = 1; i <= 3; i++) {
+        other->wake();
+        EXPECT_TRUE(waitFor([&] { return other->getProcessCount() == i; }));
+    }
+    blocked->setBlocked(false);
+    remover.join();
+}
+
+TEST_F(EffectWorkerPoolTest, DestroyWithWorkQueued) {
+    StubTask* first = addStartedTask(1);
+    StubTask* second = addStartedTask(2);
+    // Input is pending for one task, the other is in the middle of a process() call.
+    first->wake();
+    ASSERT_TRUE(waitFor([&] { return first->getProcessCount() == 1; }));
+    first->wake();
+    second->setBlocked(true);
+    second->wake();
+    ASSERT_TRUE(second->waitForProcess());
+
+    std::thread destroyer([&] { mPool.reset(); });
+    std::this_thread::sleep_for(kQuietTime);
+    second->setBlocked(false);
+    destroyer.join();
+
+    // The workers are gone, nothing is called anymore.
+    const int firstCount = first->getProcessCount();
+    const int secondCount = second->getProcessCount();
+    first->wake();
+    second->wake();
+    std::this_thread::sleep_for(kQuietTime);
+    EXPECT_EQ(firstCount, first->getProcessCount());
+    EXPECT_EQ(secondCount, second->getProcessCount());
+}
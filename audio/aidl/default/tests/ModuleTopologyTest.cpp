@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "core-impl/ModuleTopology.h"
+
+using aidl::android::hardware::audio::core::IdIndex;
+using aidl::android::hardware::audio::core::RouteIndex;
+
+namespace {
+
+struct Element {
+    int32_t id;
+    int value;
+};
+
+struct Route {
+    std::vector<int32_t> sourcePortIds;
+    int32_t sinkPortId;
+};
+
+// The linear scans the indexes replace.
+auto findLinear(std::vector<Element>& v, int32_t id) {
+    return std::find_if(v.begin(), v.end(), [&](const auto& e) { return e.id == id; });
+}
+
+std::vector<Route*> getRoutesLinear(std::vector<Route>& routes, int32_t portId) {
+    std::vector<Route*> result;
+    for (auto& r : routes) {
+        const auto& srcs = r.sourcePortIds;
+        if (r.sinkPortId == portId || std::find(srcs.begin(), srcs.end(), portId) != srcs.end()) {
+            result.push_back(&r);
+        }
+    }
+    return result;
+}
+
+std::vector<size_t> getRoutesFromSourceLinear(const std::vector<Route>& routes, int32_t portId) {
+    std::vector<size_t> result;
+    for (size_t i = 0; i < routes.size(); ++i) {
+        const auto& srcs = routes[i].sourcePortIds;
+        if (std::find(srcs.begin(), srcs.end(), portId) != srcs.end()) {
+            result.push_back(i);
+        }
+    }
+    return result;
+}
+
+}  // namespace
+
+class IdIndexTest : public ::testing::Test {
+  protected:
+    void expectSameAsLinear() {
+        for (int32_t id = -1; id < 40; ++id) {
+            EXPECT_EQ(findLinear(mElements, id), mIndex.find(mElements, id)) << "id " << id;
+        }
+    }
+
+    std::vector<Element> mElements = {{5, 0}, {3, 1}, {9, 2}, {3, 3}, {20, 4}};
+    IdIndex<Element> mIndex;
+};
+
+TEST_F(IdIndexTest, Find) {
+    expectSameAsLinear();
+}
+
+TEST_F(IdIndexTest, FindsFirstOfDuplicates) {
+    EXPECT_EQ(1, mIndex.find(mElements, 3)->value);
+}
+
+TEST_F(IdIndexTest, Append) {
+    mIndex.find(mElements, 5);
+    mElements.push_back({30, 5});
+    mIndex.onAppended(mElements);
+    mElements.push_back({9, 6});
+    mIndex.onAppended(mElements);
+    expectSameAsLinear();
+}
+
+TEST_F(IdIndexTest, EraseIsDetected) {
+    mIndex.find(mElements, 5);
+    mElements.erase(mElements.begin() + 1);
+    expectSameAsLinear();
+    mElements.pop_back();
+    expectSameAsLinear();
+}
+
+TEST_F(IdIndexTest, EraseAndAppendWithInvalidate) {
+    mIndex.find(mElements, 5);
+    mElements.erase(mElements.begin());
+    mIndex.invalidate();
+    mElements.push_back({31, 7});
+    mIndex.onAppended(mElements);
+    expectSameAsLinear();
+}
+
+class RouteIndexTest : public ::testing::Test {
+  protected:
+    void expectSameAsLinear() {
+        for (int32_t portId = 0; portId < 30; ++portId) {
+            EXPECT_EQ(getRoutesLinear(mRoutes, portId), mIndex.getRoutes(mRoutes, portId))
+                    << "port " << portId;
+            EXPECT_EQ(getRoutesFromSourceLinear(mRoutes, portId),
+                      mIndex.getRoutesFromSource(mRoutes, portId))
+                    << "port " << portId;
+        }
+    }
+
+    // Port 4 is a sink of one route and a source of others, port 7 is both in the same route.
+    std::vector<Route> mRoutes = {{{1, 2}, 4}, {{4}, 10}, {{1, 4, 7}, 11}, {{7}, 7}, {{3}, 12}};
+    RouteIndex<Route> mIndex;
+};
+
+TEST_F(RouteIndexTest, GetRoutes) {
+    expectSameAsLinear();
+}
+
+TEST_F(RouteIndexTest, ConnectDevicePort) {
+    // What Module::connectExternalDevice does for a new port 20 from the template port 1.
+    mIndex.getRoutes(mRoutes, 1);
+    mRoutes[2].sourcePortIds.push_back(20);
+    mIndex.onSourceAppended(mRoutes, 2, 20);
+    mRoutes[0].sourcePortIds.push_back(20);
+    mIndex.onSourceAppended(mRoutes, 0, 20);
+    mRoutes.push_back({{3, 20}, 21});
+    mIndex.onAppended(mRoutes);
+    expectSameAsLinear();
+}
+
+TEST_F(RouteIndexTest, DisconnectWithInvalidate) {
+    mIndex.getRoutes(mRoutes, 1);
+    mRoutes.erase(mRoutes.begin() + 1);
+    for (auto& r : mRoutes) {
+        std::erase(r.sourcePortIds, 1);
+    }
+    mIndex.invalidate();
+    expectSameAsLinear();
+}
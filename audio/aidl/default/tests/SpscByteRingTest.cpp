@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <numeric>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "core-impl/SpscByteRing.h"
+
+using aidl::android::hardware::audio::core::SpscByteRing;
+
+namespace {
+
+std::vector<uint8_t> makeData(size_t size, uint8_t first) {
+    std::vector<uint8_t> data(size);
+    std::iota(data.begin(), data.end(), first);
+    return data;
+}
+
+}  // namespace
+
+TEST(SpscByteRingTest, CapacityIsPowerOfTwo) {
+    EXPECT_EQ(0u, SpscByteRing().capacity());
+    EXPECT_EQ(1u, SpscByteRing(1).capacity());
+    EXPECT_EQ(64u, SpscByteRing(64).capacity());
+    EXPECT_EQ(128u, SpscByteRing(65).capacity());
+}
+
+TEST(SpscByteRingTest, EmptyRing) {
+    SpscByteRing ring;
+    uint8_t byte = 0;
+    EXPECT_FALSE(ring.write(&byte, 1));
+    EXPECT_EQ(0u, ring.read(&byte, 1));
+}
+
+TEST(SpscByteRingTest, WriteIsAllOrNothing) {
+    SpscByteRing ring(16);
+    const auto data = makeData(10, 0);
+    EXPECT_TRUE(ring.write(data.data(), data.size()));
+    EXPECT_FALSE(ring.write(data.data(), data.size()));
+    EXPECT_EQ(10u, ring.availableToRead());
+    EXPECT_TRUE(ring.write(data.data(), 6));
+    EXPECT_EQ(16u, ring.availableToRead());
+}
+
+TEST(SpscByteRingTest, ReadAcrossTheEnd) {
+    SpscByteRing ring(16);
+    std::vector<uint8_t> out(16);
+    const auto first = makeData(12, 0);
+    ASSERT_TRUE(ring.write(first.data(), first.size()));
+    ASSERT_EQ(12u, ring.read(out.data(), out.size()));
+    // Starts at offset 12 and wraps around.
+    const auto second = makeData(10, 100);
+    ASSERT_TRUE(ring.write(second.data(), second.size()));
+    EXPECT_EQ(4u, ring.read(out.data(), 4));
+    EXPECT_EQ(6u, ring.read(out.data() + 4, out.size()));
+    out.resize(10);
+    EXPECT_EQ(second, out);
+    EXPECT_EQ(0u, ring.availableToRead());
+}
+
+TEST(SpscByteRingTest, Reset) {
+    SpscByteRing ring(8);
+    const auto data = makeData(8, 0);
+    ASSERT_TRUE(ring.write(data.data(), data.size()));
+    ring.reset(32);
+    EXPECT_EQ(32u, ring.capacity());
+    EXPECT_EQ(0u, ring.availableToRead());
+}
+
+TEST(SpscByteRingTest, ConcurrentWriterAndReader) {
+    constexpr size_t kWriteSize = 96;  // not a divisor of the capacity
+    constexpr size_t kWriteCount = 100000;
+    SpscByteRing ring(1024);
+    std::thread writer([&]() {
+        for (size_t i = 0; i < kWriteCount; ++i) {
+            const auto data = makeData(kWriteSize, static_cast<uint8_t>(i));
+            while (!ring.write(data.data(), data.size())) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    std::vector<uint8_t> received;
+    received.reserve(kWriteSize);
+    size_t writeIndex = 0;
+    bool mismatch = false;
+    std::vector<uint8_t> buffer(200);
+    while (writeIndex < kWriteCount) {
+        const size_t read = ring.read(buffer.data(), buffer.size());
+        if (read == 0) {
+            std::this_thread::yield();
+        }
+        for (size_t i = 0; i < read; ++i) {
+            received.push_back(buffer[i]);
+            if (received.size() == kWriteSize) {
+                // Not ASSERT, returning with the writer still joinable would terminate. Keeps
+                // draining after a mismatch so that the writer is not left blocked on a full ring.
+                const auto expected = makeData(kWriteSize, static_cast<uint8_t>(writeIndex));
+                if (!mismatch && expected != received) {
+                    mismatch = true;
+                    EXPECT_EQ(expected, received) << "write " << writeIndex;
+                }
+                received.clear();
+                ++writeIndex;
+            }
+        }
+    }
+    writer.join();
+    EXPECT_EQ(0u, ring.availableToRead());
+}
@@ -0,0 +1,374 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "core-impl/Module.h"
+#include "core-impl/Stream.h"
+
+using aidl::android::hardware::audio::common::SinkMetadata;
+using aidl::android::hardware::audio::common::SourceMetadata;
+using aidl::android::hardware::audio::core::AudioPatch;
+using aidl::android::hardware::audio::core::AudioRoute;
+using aidl::android::hardware::audio::core::createStreamInstance;
+using aidl::android::hardware::audio::core::IModule;
+using aidl::android::hardware::audio::core::IStreamCommon;
+using aidl::android::hardware::audio::core::Module;
+using aidl::android::hardware::audio::core::StreamCommonImpl;
+using aidl::android::hardware::audio::core::StreamContext;
+using aidl::android::hardware::audio::core::StreamDescriptor;
+using aidl::android::hardware::audio::core::StreamIn;
+using aidl::android::hardware::audio::core::StreamOut;
+using aidl::android::media::audio::common::AudioChannelLayout;
+using aidl::android::media::audio::common::AudioDeviceType;
+using aidl::android::media::audio::common::AudioFormatDescription;
+using aidl::android::media::audio::common::AudioFormatType;
+using aidl::android::media::audio::common::AudioIoFlags;
+using aidl::android::media::audio::common::AudioOffloadInfo;
+using aidl::android::media::audio::common::AudioPort;
+using aidl::android::media::audio::common::AudioPortConfig;
+using aidl::android::media::audio::common::AudioPortDeviceExt;
+using aidl::android::media::audio::common::AudioPortExt;
+using aidl::android::media::audio::common::AudioPortMixExt;
+using aidl::android::media::audio::common::AudioProfile;
+using aidl::android::media::audio::common::Int;
+using aidl::android::media::audio::common::MicrophoneInfo;
+using aidl::android::media::audio::common::PcmType;
+
+namespace {
+
+constexpr int32_t kSampleRate = 48000;
+// Stereo PCM 16 bit.
+constexpr size_t kFrameSize = 4;
+constexpr int64_t kBufferSizeFrames = 1024;
+constexpr size_t kBufferSizeBytes = kBufferSizeFrames * kFrameSize;
+// Three quarters of the data MQ, so that every other burst wraps around its end.
+constexpr size_t kBurstFrames = kBufferSizeFrames * 3 / 4;
+constexpr size_t kBurstBytes = kBurstFrames * kFrameSize;
+
+// What the worker passed to the driver.
+struct TransferLog {
+    std::mutex lock;
+    // The frame count of each 'transfer' call.
+    std::vector<size_t> frameCounts;
+    // Output: the data received. Input: the next byte to produce.
+    std::vector<int8_t> data;
+    uint8_t nextByte = 0;
+
+    std::vector<size_t> takeFrameCounts() {
+        std::lock_guard lg(lock);
+        return std::exchange(frameCounts, {});
+    }
+    std::vector<int8_t> takeData() {
+        std::lock_guard lg(lock);
+        return std::exchange(data, {});
+    }
+};
+
+// A driver without timing, which records the output data and produces a counting byte pattern
+// as input.
+class StreamLoopback : public StreamCommonImpl {
+  public:
+    StreamLoopback(StreamContext* context, const Metadata& metadata, bool isInPlace,
+                   std::shared_ptr<TransferLog> log)
+        : StreamCommonImpl(context, metadata),
+          mIsInput(isInput(metadata)),
+          mIsInPlace(isInPlace),
+          mLog(std::move(log)) {}
+
+    ::android::status_t init() override { return ::android::OK; }
+    ::android::status_t drain(StreamDescriptor::DrainMode) override { return ::android::OK; }
+    ::android::status_t flush() override { return ::android::OK; }
+    ::android::status_t pause() override { return ::android::OK; }
+    ::android::status_t standby() override { return ::android::OK; }
+    ::android::status_t start() override { return ::android::OK; }
+    ::android::status_t transfer(void* buffer, size_t frameCount, size_t* actualFrameCount,
+                                 int32_t*) override {
+        std::lock_guard lg(mLog->lock);
+        mLog->frameCounts.push_back(frameCount);
+        int8_t* bytes = static_cast<int8_t*>(buffer);
+        if (mIsInput) {
+            for (size_t i = 0; i < frameCount * kFrameSize; i++) {
+                bytes[i] = static_cast<int8_t>(mLog->nextByte++);
+            }
+        } else {
+            mLog->data.insert(mLog->data.end(), bytes, bytes + frameCount * kFrameSize);
+        }
+        *actualFrameCount = frameCount;
+        return ::android::OK;
+    }
+    bool isInPlaceTransferSupported() const override { return mIsInPlace; }
+    void shutdown() override {}
+
+  private:
+    const bool mIsInput;
+    const bool mIsInPlace;
+    const std::shared_ptr<TransferLog> mLog;
+};
+
+class StreamInLoopback final : public StreamIn, public StreamLoopback {
+  public:
+    StreamInLoopback(StreamContext&& context, const SinkMetadata& sinkMetadata,
+                     const std::vector<MicrophoneInfo>& microphones, bool isInPlace,
+                     std::shared_ptr<TransferLog> log)
+        : StreamIn(std::move(context), microphones),
+          StreamLoopback(&mContextInstance, sinkMetadata, isInPlace, std::move(log)) {}
+
+  private:
+    void onClose(StreamDescriptor::State) override { defaultOnClose(); }
+};
+
+class StreamOutLoopback final : public StreamOut, public StreamLoopback {
+  public:
+    StreamOutLoopback(StreamContext&& context, const SourceMetadata& sourceMetadata,
+                      const std::optional<AudioOffloadInfo>& offloadInfo, bool isInPlace,
+                      std::shared_ptr<TransferLog> log)
+        : StreamOut(std::move(context), offloadInfo),
+          StreamLoopback(&mContextInstance, sourceMetadata, isInPlace, std::move(log)) {}
+
+  private:
+    void onClose(StreamDescriptor::State) override { defaultOnClose(); }
+};
+
+class ModuleLoopback final : public Module {
+  public:
+    ModuleLoopback(std::unique_ptr<Configuration>&& config, bool isInPlace,
+                   std::shared_ptr<TransferLog> log)
+        : Module(Type::STUB, std::move(config)), mIsInPlace(isInPlace), mLog(std::move(log)) {}
+
+  protected:
+    ndk::ScopedAStatus createInputStream(StreamContext&& context,
+                                         const SinkMetadata& sinkMetadata,
+                                         const std::vector<MicrophoneInfo>& microphones,
+                                         std::shared_ptr<StreamIn>* result) override {
+        return createStreamInstance<StreamInLoopback>(result, std::move(context), sinkMetadata,
+                                                      microphones, mIsInPlace, mLog);
+    }
+    ndk::ScopedAStatus createOutputStream(StreamContext&& context,
+                                          const SourceMetadata& sourceMetadata,
+                                          const std::optional<AudioOffloadInfo>& offloadInfo,
+                                          std::shared_ptr<StreamOut>* result) override {
+        return createStreamInstance<StreamOutLoopback>(result, std::move(context), sourceMetadata,
+                                                       offloadInfo, mIsInPlace, mLog);
+    }
+
+  private:
+    const bool mIsInPlace;
+    const std::shared_ptr<TransferLog> mLog;
+};
+
+AudioPort createPort(int32_t id, const std::string& name, bool isInput, const AudioPortExt& ext) {
+    AudioProfile profile;
+    profile.format = AudioFormatDescription{.type = AudioFormatType::PCM,
+                                            .pcm = PcmType::INT_16_BIT};
+    profile.channelMasks.push_back(AudioChannelLayout::make<AudioChannelLayout::layoutMask>(
+            AudioChannelLayout::LAYOUT_STEREO));
+    profile.sampleRates.push_back(kSampleRate);
+    AudioPort port;
+    port.id = id;
+    port.name = name;
+    port.profiles.push_back(profile);
+    port.flags = isInput ? AudioIoFlags::make<AudioIoFlags::Tag::input>(0)
+                         : AudioIoFlags::make<AudioIoFlags::Tag::output>(0);
+    port.ext = ext;
+    return port;
+}
+
+AudioPortConfig createPortConfig(int32_t id, const AudioPort& port) {
+    AudioPortConfig config;
+    config.id = id;
+    config.portId = port.id;
+    config.format = port.profiles[0].format;
+    config.channelMask = port.profiles[0].channelMasks[0];
+    config.sampleRate = Int{.value = kSampleRate};
+    config.flags = port.flags;
+    config.ext = port.ext;
+    return config;
+}
+
+}  // namespace
+
+// Runs bursts through a stream whose driver records each 'transfer' call, with in-place
+// transfers enabled or not.
+class StreamTransferTest : public testing::TestWithParam<bool> {
+  protected:
+    void openStream(bool isInput) {
+        // One mix port routed to one attached device port.
+        auto config = std::make_unique<Module::Configuration>();
+        AudioPortMixExt mixExt;
+        mixExt.handle = config->nextPortId;
+        const AudioPort mixPort =
+                createPort(config->nextPortId++, "mix", isInput,
+                           AudioPortExt::make<AudioPortExt::Tag::mix>(mixExt));
+        config->ports.push_back(mixPort);
+        const AudioPortConfig mixPortConfig = createPortConfig(config->nextPortId++, mixPort);
+        config->portConfigs.push_back(mixPortConfig);
+        AudioPortDeviceExt deviceExt;
+        deviceExt.device.type.type =
+                isInput ? AudioDeviceType::IN_MICROPHONE : AudioDeviceType::OUT_SPEAKER;
+        const AudioPort devicePort =
+                createPort(config->nextPortId++, "device", isInput,
+                           AudioPortExt::make<AudioPortExt::Tag::device>(deviceExt));
+        config->ports.push_back(devicePort);
+        const AudioPortConfig devicePortConfig =
+                createPortConfig(config->nextPortId++, devicePort);
+        config->initialConfigs.push_back(devicePortConfig);
+        config->portConfigs.push_back(devicePortConfig);
+        config->routes.push_back(
+                isInput ? AudioRoute{.sourcePortIds = {devicePort.id}, .sinkPortId = mixPort.id}
+                        : AudioRoute{.sourcePortIds = {mixPort.id}, .sinkPortId = devicePort.id});
+        mModule = ndk::SharedRefBase::make<ModuleLoopback>(std::move(config), GetParam(), mLog);
+
+        // Patched, so that the stream is connected and the worker calls the driver.
+        AudioPatch requested, patch;
+        requested.sourcePortConfigIds.push_back(isInput ? devicePortConfig.id : mixPortConfig.id);
+        requested.sinkPortConfigIds.push_back(isInput ? mixPortConfig.id : devicePortConfig.id);
+        ASSERT_TRUE(mModule->setAudioPatch(requested, &patch).isOk());
+        StreamDescriptor desc;
+        if (isInput) {
+            IModule::OpenInputStreamArguments args;
+            args.portConfigId = mixPortConfig.id;
+            args.bufferSizeFrames = kBufferSizeFrames;
+            IModule::OpenInputStreamReturn ret;
+            ASSERT_TRUE(mModule->openInputStream(args, &ret).isOk());
+            ASSERT_TRUE(ret.stream->getStreamCommon(&mStreamCommon).isOk());
+            mStream = ret.stream;
+            desc = std::move(ret.desc);
+        } else {
+            IModule::OpenOutputStreamArguments args;
+            args.portConfigId = mixPortConfig.id;
+            args.bufferSizeFrames = kBufferSizeFrames;
+            IModule::OpenOutputStreamReturn ret;
+            ASSERT_TRUE(mModule->openOutputStream(args, &ret).isOk());
+            ASSERT_TRUE(ret.stream->getStreamCommon(&mStreamCommon).isOk());
+            mStream = ret.stream;
+            desc = std::move(ret.desc);
+        }
+        ASSERT_EQ(static_cast<int32_t>(kFrameSize), desc.frameSizeBytes);
+        ASSERT_EQ(kBufferSizeFrames, desc.bufferSizeFrames);
+        mCommandMQ = std::make_unique<StreamContext::CommandMQ>(desc.command);
+        mReplyMQ = std::make_unique<StreamContext::ReplyMQ>(desc.reply);
+        mDataMQ = std::make_unique<StreamContext::DataMQ>(
+                desc.audio.get<StreamDescriptor::AudioBuffer::Tag::fmq>());
+        ASSERT_TRUE(mCommandMQ->isValid());
+        ASSERT_TRUE(mReplyMQ->isValid());
+        ASSERT_TRUE(mDataMQ->isValid());
+    }
+
+    void TearDown() override {
+        if (mStreamCommon != nullptr) mStreamCommon->close();
+    }
+
+    // Sends a burst command of 'byteCount' bytes and returns the byte count of the reply.
+    int32_t burst(size_t byteCount) {
+        const auto command = StreamDescriptor::Command::make<StreamDescriptor::Command::Tag::burst>(
+                static_cast<int32_t>(byteCount));
+        StreamDescriptor::Reply reply;
+        if (!mCommandMQ->writeBlocking(&command, 1) || !mReplyMQ->readBlocking(&reply, 1) ||
+            reply.status != STATUS_OK) {
+            return -1;
+        }
+        return reply.fmqByteCount;
+    }
+
+    // Writes 'byteCount' bytes of a pattern continuing from the previous call, and plays them.
+    // All of them are consumed, the reply only counts whole frames.
+    void writeBurst(size_t byteCount, std::vector<int8_t>* written) {
+        std::vector<int8_t> data(byteCount);
+        for (auto& byte : data) byte = static_cast<int8_t>(mNextByte++ * 7);
+        ASSERT_TRUE(mDataMQ->write(data.data(), data.size()));
+        ASSERT_EQ(static_cast<int32_t>(byteCount / kFrameSize * kFrameSize), burst(byteCount));
+        written->insert(written->end(), data.begin(), data.end());
+    }
+
+    const std::shared_ptr<TransferLog> mLog = std::make_shared<TransferLog>();
+    std::shared_ptr<IModule> mModule;
+    std::shared_ptr<ndk::ICInterface> mStream;
+    std::shared_ptr<IStreamCommon> mStreamCommon;
+    std::unique_ptr<StreamContext::CommandMQ> mCommandMQ;
+    std::unique_ptr<StreamContext::ReplyMQ> mReplyMQ;
+    std::unique_ptr<StreamContext::DataMQ> mDataMQ;
+    uint8_t mNextByte = 0;
+};
+
+TEST_P(StreamTransferTest, OutputWrapsAroundTheDataMQ) {
+    ASSERT_NO_FATAL_FAILURE(openStream(false /*isInput*/));
+    std::vector<int8_t> written;
+    // Bursts start at 0, 3/4, 1/2 and 1/4 of the MQ, the second and the third wrap around.
+    for (int i = 0; i < 4; i++) {
+        ASSERT_NO_FATAL_FAILURE(writeBurst(kBurstBytes, &written));
+    }
+    EXPECT_EQ(written, mLog->takeData());
+    const std::vector<size_t> expected =
+            GetParam() ? std::vector<size_t>{kBurstFrames, kBufferSizeFrames / 4,
+                                             kBufferSizeFrames / 2, kBufferSizeFrames / 2,
+                                             kBufferSizeFrames / 4, kBufferSizeFrames * 3 / 4}
+                       : std::vector<size_t>(4, kBurstFrames);
+    EXPECT_EQ(expected, mLog->takeFrameCounts());
+}
+
+TEST_P(StreamTransferTest, OutputFrameSplitByWrapAroundIsCopied) {
+    ASSERT_NO_FATAL_FAILURE(openStream(false /*isInput*/));
+    // A burst of one and a half frames: the driver gets one frame, all of it is consumed, and
+    // the MQ is no longer aligned on frames.
+    std::vector<int8_t> written;
+    ASSERT_NO_FATAL_FAILURE(writeBurst(kFrameSize * 3 / 2, &written));
+    EXPECT_EQ(std::vector<size_t>{1}, mLog->takeFrameCounts());
+    EXPECT_EQ(std::vector<int8_t>(written.begin(), written.begin() + kFrameSize),
+              mLog->takeData());
+    written.clear();
+
+    // The first burst ends 2 bytes short of the MQ end, the second one wraps in the middle
+    // of a frame, so it goes through the intermediate buffer in one piece.
+    ASSERT_NO_FATAL_FAILURE(writeBurst(kBufferSizeBytes - kFrameSize * 2, &written));
+    ASSERT_NO_FATAL_FAILURE(writeBurst(kBurstBytes, &written));
+    EXPECT_EQ(written, mLog->takeData());
+    EXPECT_EQ((std::vector<size_t>{kBufferSizeFrames - 2, kBurstFrames}),
+              mLog->takeFrameCounts());
+}
+
+TEST_P(StreamTransferTest, InputWrapsAroundTheDataMQ) {
+    ASSERT_NO_FATAL_FAILURE(openStream(true /*isInput*/));
+    uint8_t expectedByte = 0;
+    // As for output, the second and the third burst wrap around.
+    for (int i = 0; i < 4; i++) {
+        ASSERT_EQ(static_cast<int32_t>(kBurstBytes), burst(kBurstBytes));
+        std::vector<int8_t> data(kBurstBytes);
+        ASSERT_TRUE(mDataMQ->read(data.data(), data.size()));
+        for (size_t j = 0; j < data.size(); j++) {
+            ASSERT_EQ(static_cast<int8_t>(expectedByte++), data[j]) << "burst " << i << " byte "
+                                                                    << j;
+        }
+    }
+    const std::vector<size_t> expected =
+            GetParam() ? std::vector<size_t>{kBurstFrames, kBufferSizeFrames / 4,
+                                             kBufferSizeFrames / 2, kBufferSizeFrames / 2,
+                                             kBufferSizeFrames / 4, kBufferSizeFrames * 3 / 4}
+                       : std::vector<size_t>(4, kBurstFrames);
+    EXPECT_EQ(expected, mLog->takeFrameCounts());
+}
+
+INSTANTIATE_TEST_SUITE_P(StreamTransfer, StreamTransferTest, testing::Bool(),
+                         [](const testing::TestParamInfo<bool>& info) {
+                             return info.param ? "InPlace" : "Copy";
+                         });
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "r_submix/SubmixPacer.h"
+
+using aidl::android::hardware::audio::core::r_submix::SubmixPacer;
+
+namespace {
+
+constexpr int kSampleRate = 48000;
+constexpr size_t kPeriodFrames = 480;  // 10 ms
+constexpr int64_t kPeriodNs = 10000000;
+constexpr int kPeriodCount = 30;
+// Only the lower bounds of the elapsed times are exact. A busy test host can wake the test late by
+// any amount, so the upper bounds only check that the pacing does not drift by several periods, as
+// it would with relative sleeps. For the same reason, the tests that sleep do not check 'isLate',
+// the tests on a simulated clock do.
+constexpr int64_t kMaxDriftNs = 3 * kPeriodNs;
+
+// Simulates the processing done by the stream worker between two transfers.
+void busyWaitNs(int64_t durationNs) {
+    const int64_t endNs = SubmixPacer::nowNs() + durationNs;
+    while (SubmixPacer::nowNs() < endNs) {
+    }
+}
+
+// The simulated clock, only advanced by the tests.
+int64_t gSimulatedNowNs = 0;
+
+int64_t simulatedNowNs() {
+    return gSimulatedNowNs;
+}
+
+class SubmixPacerSimulatedTest : public testing::Test {
+  protected:
+    void SetUp() override {
+        gSimulatedNowNs = kStartNs;
+        mPacer.start();
+    }
+
+    static constexpr int64_t kStartNs = 1000000000;
+    SubmixPacer mPacer{kSampleRate, &simulatedNowNs};
+};
+
+}  // namespace
+
+TEST(SubmixPacerTest, Duration) {
+    SubmixPacer pacer(kSampleRate);
+    EXPECT_EQ(kPeriodNs, pacer.getDurationNs(kPeriodFrames));
+    EXPECT_EQ(1000000000, pacer.getDurationNs(kSampleRate));
+}
+
+TEST(SubmixPacerTest, SleepUntil) {
+    const int64_t deadlineNs = SubmixPacer::nowNs() + kPeriodNs;
+    SubmixPacer::sleepUntilNs(deadlineNs);
+    const int64_t nowNs = SubmixPacer::nowNs();
+    EXPECT_GE(nowNs, deadlineNs);
+}
+
+TEST(SubmixPacerTest, KeepsNominalRate) {
+    SubmixPacer pacer(kSampleRate);
+    pacer.start();
+    const int64_t startNs = SubmixPacer::nowNs();
+    for (int i = 0; i < kPeriodCount; ++i) {
+        pacer.pace(kPeriodFrames);
+    }
+    const int64_t elapsedNs = SubmixPacer::nowNs() - startNs;
+    EXPECT_GE(elapsedNs, kPeriodCount * kPeriodNs);
+    EXPECT_LT(elapsedNs, kPeriodCount * kPeriodNs + kMaxDriftNs);
+}
+
+TEST(SubmixPacerTest, ProcessingTimeDoesNotDrift) {
+    SubmixPacer pacer(kSampleRate);
+    pacer.start();
+    const int64_t startNs = SubmixPacer::nowNs();
+    for (int i = 0; i < kPeriodCount; ++i) {
+        busyWaitNs(kPeriodNs / 5);
+        pacer.pace(kPeriodFrames);
+    }
+    // With relative sleeps, the processing time would add up to 'kPeriodCount * kPeriodNs / 5',
+    // that is 6 periods.
+    const int64_t elapsedNs = SubmixPacer::nowNs() - startNs;
+    EXPECT_GE(elapsedNs, kPeriodCount * kPeriodNs);
+    EXPECT_LT(elapsedNs, kPeriodCount * kPeriodNs + kMaxDriftNs);
+}
+
+TEST_F(SubmixPacerSimulatedTest, DeadlinesDoNotDrift) {
+    for (int i = 1; i <= kPeriodCount; ++i) {
+        // Each transfer comes some processing time after the previous deadline.
+        gSimulatedNowNs += kPeriodNs / 5;
+        bool isLate = true;
+        const int64_t deadlineNs = mPacer.advance(kPeriodFrames, &isLate);
+        EXPECT_FALSE(isLate) << "period " << i;
+        EXPECT_EQ(kStartNs + i * kPeriodNs, deadlineNs) << "period " << i;
+        gSimulatedNowNs = deadlineNs;
+    }
+}
+
+TEST_F(SubmixPacerSimulatedTest, DeadlineIsLimitedToDuration) {
+    // Transfers ahead of time by several periods, for example, after a write to a full pipe.
+    mPacer.advance(4 * kPeriodFrames);
+    bool isLate = true;
+    EXPECT_EQ(kStartNs + kPeriodNs, mPacer.advance(kPeriodFrames, &isLate));
+    EXPECT_FALSE(isLate);
+}
+
+TEST_F(SubmixPacerSimulatedTest, LatePeriod) {
+    bool isLate = true;
+    EXPECT_EQ(kStartNs + kPeriodNs, mPacer.advance(kPeriodFrames, &isLate));
+    EXPECT_FALSE(isLate);
+    // The client misses one and a half periods.
+    gSimulatedNowNs = kStartNs + 7 * kPeriodNs / 2;
+    EXPECT_EQ(kStartNs + 2 * kPeriodNs, mPacer.advance(kPeriodFrames, &isLate));
+    EXPECT_TRUE(isLate);
+    // Catching up does not sleep, then the pacing resumes on the original schedule.
+    EXPECT_EQ(kStartNs + 3 * kPeriodNs, mPacer.advance(kPeriodFrames, &isLate));
+    EXPECT_FALSE(isLate);
+    EXPECT_EQ(kStartNs + 4 * kPeriodNs, mPacer.advance(kPeriodFrames, &isLate));
+    EXPECT_FALSE(isLate);
+}
+
+TEST_F(SubmixPacerSimulatedTest, LateByOnePeriod) {
+    // Due exactly one period ago, the client has not missed a period yet.
+    gSimulatedNowNs = kStartNs + 2 * kPeriodNs;
+    bool isLate = true;
+    EXPECT_EQ(kStartNs + kPeriodNs, mPacer.advance(kPeriodFrames, &isLate));
+    EXPECT_FALSE(isLate);
+    // Any later, it has.
+    gSimulatedNowNs = kStartNs + 3 * kPeriodNs + 1;
+    EXPECT_EQ(kStartNs + 2 * kPeriodNs, mPacer.advance(kPeriodFrames, &isLate));
+    EXPECT_TRUE(isLate);
+}
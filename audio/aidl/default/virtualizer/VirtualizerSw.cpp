@@ -178,10 +178,10 @@ ndk::ScopedAStatus VirtualizerSw::getSpeakerAngles(const Virtualizer::SpeakerAng
                    .elevationDegree = 0}};
     } else if (chNum == 2) {
         angles = {{.channel = (int32_t)AudioChannelLayout::CHANNEL_FRONT_LEFT,
-                   .azimuthDegree = -90,
+                   .azimuthDegree = -VirtualizerSwContext::kSpeakerAzimuthDegrees,
                    .elevationDegree = 0},
                   {.channel = (int32_t)AudioChannelLayout::CHANNEL_FRONT_RIGHT,
-                   .azimuthDegree = 90,
+                   .azimuthDegree = VirtualizerSwContext::kSpeakerAzimuthDegrees,
                    .elevationDegree = 0}};
     } else {
         return ndk::ScopedAStatus::fromExceptionCodeWithMessage(EX_ILLEGAL_ARGUMENT,
@@ -212,17 +212,81 @@ RetCode VirtualizerSw::releaseContext() {
 
 // Processing method running in EffectWorker thread.
 IEffect::Status VirtualizerSw::effectProcessImpl(float* in, float* out, int samples) {
-    // TODO: get data buffer and process.
-    LOG(DEBUG) << __func__ << " in " << in << " out " << out << " samples " << samples;
-    for (int i = 0; i < samples; i++) {
-        *out++ = *in++;
+    RETURN_VALUE_IF(!mContext, (IEffect::Status{EX_NULL_POINTER, 0, 0}), "nullContext");
+    return mContext->process(in, out, samples);
+}
+
+RetCode VirtualizerSwContext::setCommon(const Parameter::Common& common) {
+    if (auto ret = EffectContext::setCommon(common); ret != RetCode::SUCCESS) {
+        return ret;
     }
-    return {STATUS_OK, samples, samples};
+    configureRenderer();
+    return RetCode::SUCCESS;
 }
 
 RetCode VirtualizerSwContext::setVrStrength(int strength) {
+    if (mRendererEnabled && mStrength == 0 && strength != 0) {
+        // Leaving the bypass, don't render what was left over from before it.
+        mConvolver.reset();
+        std::fill(mDryDelay.begin(), mDryDelay.end(), 0.f);
+        mDryDelayPosition = 0;
+    }
     mStrength = strength;
     return RetCode::SUCCESS;
 }
 
+void VirtualizerSwContext::configureRenderer() {
+    mRendererEnabled = mInputChannelCount == 2 && mOutputChannelCount == 2 &&
+                       mConvolver.configure(mInputChannelCount, kBlockFrames, kFilterFrames);
+    if (!mRendererEnabled) {
+        LOG(WARNING) << __func__ << " unsupported IO, bypass: in channels " << mInputChannelCount
+                     << " out channels " << mOutputChannelCount;
+        return;
+    }
+    std::vector<float> left(kFilterFrames);
+    std::vector<float> right(kFilterFrames);
+    for (size_t channel = 0; channel < 2; channel++) {
+        const float azimuth = channel == 0 ? -kSpeakerAzimuthDegrees : kSpeakerAzimuthDegrees;
+        dsp::makeSphericalHeadHrir(mCommon.input.base.sampleRate, azimuth, 0 /* elevation */,
+                                   left.data(), right.data(), kFilterFrames);
+        mConvolver.setFilter(channel, left.data(), right.data(), kFilterFrames);
+    }
+    mDryDelay.assign(2 * mConvolver.getLatencyFrames(), 0.f);
+    mDryDelayPosition = 0;
+    mDry.assign(2 * kBlockFrames, 0.f);
+}
+
+IEffect::Status VirtualizerSwContext::process(float* in, float* out, int samples) {
+    // Nothing to render at zero strength, pass through without the latency of the convolver.
+    if (!mRendererEnabled || mStrength == 0) {
+        std::copy(in, in + samples, out);
+        return {STATUS_OK, samples, samples};
+    }
+    // The strength is the share of the rendered signal, the rest is the dry input.
+    const float wet = mStrength / 1000.f;
+    const float dry = 1.f - wet;
+    const size_t frameCount = samples / 2;
+    for (size_t frame = 0; frame < frameCount;) {
+        const size_t frames = std::min(frameCount - frame, kBlockFrames);
+        float* blockIn = in + 2 * frame;
+        float* blockOut = out + 2 * frame;
+        // Read ahead of the convolver, which may overwrite the input.
+        for (size_t i = 0; i < 2 * frames; i++) {
+            mDry[i] = mDryDelay[mDryDelayPosition];
+            mDryDelay[mDryDelayPosition] = blockIn[i];
+            if (++mDryDelayPosition == mDryDelay.size()) {
+                mDryDelayPosition = 0;
+            }
+        }
+        mConvolver.process(blockIn, blockOut, frames);
+        for (size_t i = 0; i < 2 * frames; i++) {
+            blockOut[i] = blockOut[i] * wet + mDry[i] * dry;
+        }
+        frame += frames;
+    }
+    // A trailing partial frame is passed through.
+    std::copy(in + 2 * frameCount, in + samples, out + 2 * frameCount);
+    return {STATUS_OK, samples, samples};
+}
+
 }  // namespace aidl::android::hardware::audio::effect
@@ -20,7 +20,9 @@
 #include <fmq/AidlMessageQueue.h>
 #include <cstdlib>
 #include <memory>
+#include <vector>
 
+#include "dsp/Convolver.h"
 #include "effect-impl/EffectImpl.h"
 
 namespace aidl::android::hardware::audio::effect {
@@ -30,7 +32,11 @@ class VirtualizerSwContext final : public EffectContext {
     VirtualizerSwContext(int statusDepth, const Parameter::Common& common)
         : EffectContext(statusDepth, common) {
         LOG(DEBUG) << __func__;
+        configureRenderer();
     }
+
+    RetCode setCommon(const Parameter::Common& common) override;
+
     RetCode setVrStrength(int strength);
     int getVrStrength() const { return mStrength; }
     RetCode setForcedDevice(
@@ -42,9 +48,28 @@ class VirtualizerSwContext final : public EffectContext {
         return mForceDevice;
     }
 
+    IEffect::Status process(float* in, float* out, int samples);
+
+    // Azimuth in degrees of the virtual speakers the stereo channels are rendered from.
+    static constexpr int kSpeakerAzimuthDegrees = 30;
+
   private:
+    // One block of latency, 2.7 ms at 48 kHz.
+    static constexpr size_t kBlockFrames = 128;
+    static constexpr size_t kFilterFrames = 256;
+
     int mStrength = 0;
     ::aidl::android::media::audio::common::AudioDeviceDescription mForceDevice;
+
+    dsp::BinauralConvolver mConvolver;
+    bool mRendererEnabled = false;
+    // The dry input is delayed by the latency of the convolver before it is mixed with the
+    // rendered output, interleaved stereo.
+    std::vector<float> mDryDelay;
+    size_t mDryDelayPosition = 0;
+    std::vector<float> mDry;
+
+    void configureRenderer();
 };
 
 class VirtualizerSw final : public EffectImpl {
@@ -68,7 +93,8 @@ class VirtualizerSw final : public EffectImpl {
             REQUIRES(mImplMutex) override;
     RetCode releaseContext() REQUIRES(mImplMutex) override;
 
-    IEffect::Status effectProcessImpl(float* in, float* out, int samples) override;
+    IEffect::Status effectProcessImpl(float* in, float* out, int samples)
+            REQUIRES(mImplMutex) override;
     std::string getEffectName() override { return kEffectName; }
 
   private:
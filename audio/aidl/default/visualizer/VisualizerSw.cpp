@@ -14,18 +14,24 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <cmath>
+
 #define LOG_TAG "AHAL_VisualizerSw"
 
+#include <aidl/android/hardware/audio/effect/DefaultExtension.h>
 #include <android-base/logging.h>
 #include <system/audio_effects/effect_uuid.h>
 
 #include "VisualizerSw.h"
 
+using aidl::android::hardware::audio::effect::DefaultExtension;
 using aidl::android::hardware::audio::effect::Descriptor;
 using aidl::android::hardware::audio::effect::getEffectImplUuidVisualizerSw;
 using aidl::android::hardware::audio::effect::getEffectTypeUuidVisualizer;
 using aidl::android::hardware::audio::effect::IEffect;
 using aidl::android::hardware::audio::effect::State;
+using aidl::android::hardware::audio::effect::VendorExtension;
 using aidl::android::hardware::audio::effect::VisualizerSw;
 using aidl::android::media::audio::common::AudioUuid;
 
@@ -180,6 +186,38 @@ ndk::ScopedAStatus VisualizerSw::getParameterVisualizer(const Visualizer::Tag& t
     return ndk::ScopedAStatus::ok();
 }
 
+ndk::ScopedAStatus VisualizerSw::getParameter(const Parameter::Id& id, Parameter* param) {
+    if (id.getTag() != Parameter::Id::visualizerTag ||
+        id.get<Parameter::Id::visualizerTag>().getTag() != Visualizer::Id::vendorExtensionTag) {
+        return EffectImpl::getParameter(id, param);
+    }
+    Parameter::Specific specific;
+    RETURN_IF_ASTATUS_NOT_OK(getParameterVisualizerFft(&specific), "SpecParamNotSupported");
+    param->set<Parameter::specific>(specific);
+    return ndk::ScopedAStatus::ok();
+}
+
+ndk::ScopedAStatus VisualizerSw::getParameterVisualizerFft(Parameter::Specific* specific) {
+    VisualizerSwContext::FftInput input;
+    input.capture.reserve(VisualizerSwContext::kMaxCaptureSize);
+    {
+        std::lock_guard lg(mImplMutex);
+        RETURN_IF(!mContext, EX_NULL_POINTER, "nullContext");
+        mContext->getVsFftInput(&input);
+    }
+
+    DefaultExtension fft;
+    fft.bytes = VisualizerSwContext::computeVsFft(input);
+    RETURN_IF(fft.bytes.empty(), EX_ILLEGAL_ARGUMENT, "fftNotSupported");
+    VendorExtension extension;
+    RETURN_IF(STATUS_OK != extension.extension.setParcelable(fft), EX_ILLEGAL_ARGUMENT,
+              "setParcelableFailed");
+    Visualizer vsParam;
+    vsParam.set<Visualizer::vendor>(extension);
+    specific->set<Parameter::Specific::visualizer>(vsParam);
+    return ndk::ScopedAStatus::ok();
+}
+
 std::shared_ptr<EffectContext> VisualizerSw::createContext(const Parameter::Common& common) {
     if (mContext) {
         LOG(DEBUG) << __func__ << " context already exist";
@@ -199,16 +237,15 @@ RetCode VisualizerSw::releaseContext() {
 
 // Processing method running in EffectWorker thread.
 IEffect::Status VisualizerSw::effectProcessImpl(float* in, float* out, int samples) {
-    // TODO: get data buffer and process.
-    LOG(DEBUG) << __func__ << " in " << in << " out " << out << " samples " << samples;
-    for (int i = 0; i < samples; i++) {
-        *out++ = *in++;
-    }
-    return {STATUS_OK, samples, samples};
+    RETURN_VALUE_IF(!mContext, (IEffect::Status{EX_NULL_POINTER, 0, 0}), "nullContext");
+    return mContext->process(in, out, samples);
 }
 
 RetCode VisualizerSwContext::setVsCaptureSize(int captureSize) {
     mCaptureSize = captureSize;
+    // Not a power of two leaves no transform, computeVsFft() then returns nothing.
+    auto fft = std::make_shared<dsp::Fft>();
+    mFft = fft->configure(captureSize) ? std::move(fft) : nullptr;
     return RetCode::SUCCESS;
 }
 
@@ -218,6 +255,11 @@ RetCode VisualizerSwContext::setVsScalingMode(Visualizer::ScalingMode scalingMod
 }
 
 RetCode VisualizerSwContext::setVsMeasurementMode(Visualizer::MeasurementMode measurementMode) {
+    if (measurementMode != mMeasurementMode) {
+        // Buffers measured in the previous mode, or left over from before it, do not count.
+        mMeasurementPosition = 0;
+        mMeasurementCount = 0;
+    }
     mMeasurementMode = measurementMode;
     return RetCode::SUCCESS;
 }
@@ -227,4 +269,125 @@ RetCode VisualizerSwContext::setVsLatency(int latency) {
     return RetCode::SUCCESS;
 }
 
+bool VisualizerSwContext::isStalled() const {
+    return !mProcessTime || std::chrono::steady_clock::now() - *mProcessTime > kMaxStallTime;
+}
+
+Visualizer::Measurement VisualizerSwContext::getVsMeasurement() const {
+    if (mMeasurementMode != Visualizer::MeasurementMode::PEAK_RMS) {
+        return {0, 0};
+    }
+    if (mMeasurementCount == 0 || isStalled()) {
+        return {.rms = kMinLevelMb, .peak = kMinLevelMb};
+    }
+    const auto toMillibels = [](float level) {
+        return level > 0 ? std::max(kMinLevelMb, static_cast<int32_t>(2000 * std::log10(level)))
+                         : kMinLevelMb;
+    };
+    float peak = 0;
+    float meanSquare = 0;
+    for (size_t i = 0; i < mMeasurementCount; i++) {
+        peak = std::max(peak, mBufferPeaks[i]);
+        meanSquare += mBufferMeanSquares[i];
+    }
+    meanSquare /= mMeasurementCount;
+    return {.rms = toMillibels(std::sqrt(meanSquare)), .peak = toMillibels(peak)};
+}
+
+void VisualizerSwContext::fillCaptureSampleBuffer(uint8_t* buffer) const {
+    if (isStalled()) {
+        std::fill(buffer, buffer + mCaptureSize, 0x80);
+        return;
+    }
+    // The latest mCaptureSize samples start this far after the oldest one in the ring.
+    const size_t start = mHistoryPosition + kMaxCaptureSize - mCaptureSize;
+    const auto sample = [&](int i) { return mHistory[(start + i) % kMaxCaptureSize]; };
+    float scale = 128.f;
+    if (mScalingMode == Visualizer::ScalingMode::NORMALIZED) {
+        float maxAbs = 0;
+        for (int i = 0; i < mCaptureSize; i++) {
+            maxAbs = std::max(maxAbs, std::abs(sample(i)));
+        }
+        if (maxAbs > 0) {
+            scale = 127.f / maxAbs;
+        }
+    }
+    for (int i = 0; i < mCaptureSize; i++) {
+        buffer[i] = std::clamp(std::lround(sample(i) * scale) + 128, 0L, 255L);
+    }
+}
+
+std::vector<uint8_t> VisualizerSwContext::getVsCaptureSampleBuffer() const {
+    std::vector<uint8_t> buffer(mCaptureSize);
+    fillCaptureSampleBuffer(buffer.data());
+    return buffer;
+}
+
+void VisualizerSwContext::getVsFftInput(FftInput* input) const {
+    input->fft = mFft;
+    input->capture.resize(mCaptureSize);
+    fillCaptureSampleBuffer(input->capture.data());
+}
+
+std::vector<uint8_t> VisualizerSwContext::computeVsFft(const FftInput& input) {
+    if (!input.fft) {
+        return {};
+    }
+    const size_t size = input.fft->getSize();
+    std::vector<float> re(size);
+    std::vector<float> im(size);
+    for (size_t i = 0; i < size; i++) {
+        re[i] = (input.capture[i] - 128) / 128.f;
+    }
+    input.fft->forward(re.data(), im.data());
+    // A full scale sine has a magnitude of size / 2 in its bin.
+    const float scale = 128.f * 2 / size;
+    const auto toByte = [scale](float value) {
+        return static_cast<uint8_t>(std::clamp(std::lround(value * scale), -128L, 127L));
+    };
+    std::vector<uint8_t> fft(size);
+    fft[0] = toByte(re[0]);
+    fft[1] = toByte(re[size / 2]);
+    for (size_t k = 1; k < size / 2; k++) {
+        fft[2 * k] = toByte(re[k]);
+        fft[2 * k + 1] = toByte(im[k]);
+    }
+    return fft;
+}
+
+IEffect::Status VisualizerSwContext::process(float* in, float* out, int samples) {
+    if (in != out) {
+        std::copy(in, in + samples, out);
+    }
+    if (mInputChannelCount == 0) {
+        return {STATUS_OK, samples, samples};
+    }
+    const size_t frameCount = samples / mInputChannelCount;
+    if (frameCount == 0) {
+        return {STATUS_OK, samples, samples};
+    }
+    const float channelScale = 1.f / mInputChannelCount;
+    float peak = 0;
+    float sumSquares = 0;
+    for (size_t frame = 0; frame < frameCount; frame++) {
+        float sum = 0;
+        for (size_t channel = 0; channel < mInputChannelCount; channel++) {
+            sum += in[frame * mInputChannelCount + channel];
+        }
+        const float sample = sum * channelScale;
+        mHistory[mHistoryPosition] = sample;
+        mHistoryPosition = (mHistoryPosition + 1) % kMaxCaptureSize;
+        peak = std::max(peak, std::abs(sample));
+        sumSquares += sample * sample;
+    }
+    if (mMeasurementMode == Visualizer::MeasurementMode::PEAK_RMS) {
+        mBufferPeaks[mMeasurementPosition] = peak;
+        mBufferMeanSquares[mMeasurementPosition] = sumSquares / frameCount;
+        mMeasurementPosition = (mMeasurementPosition + 1) % kMeasurementBufferCount;
+        mMeasurementCount = std::min(mMeasurementCount + 1, kMeasurementBufferCount);
+    }
+    mProcessTime = std::chrono::steady_clock::now();
+    return {STATUS_OK, samples, samples};
+}
+
 }  // namespace aidl::android::hardware::audio::effect
@@ -16,10 +16,15 @@
 
 #pragma once
 
+#include <array>
+#include <chrono>
+#include <memory>
+#include <optional>
 #include <vector>
 
 #include <aidl/android/hardware/audio/effect/BnEffect.h>
 #include <system/audio_effects/effect_visualizer.h>
+#include "dsp/Fft.h"
 #include "effect-impl/EffectImpl.h"
 
 namespace aidl::android::hardware::audio::effect {
@@ -31,11 +36,17 @@ class VisualizerSwContext final : public EffectContext {
     static constexpr int32_t kMinCaptureSize = VISUALIZER_CAPTURE_SIZE_MIN;
     static constexpr int32_t kMaxCaptureSize = VISUALIZER_CAPTURE_SIZE_MAX;
     static constexpr int32_t kMaxLatencyMs = 3000;
+    // Peak and RMS are measured over this many of the latest processed buffers.
+    static constexpr size_t kMeasurementBufferCount = 25;
+    // A capture older than this is reported as silence, the stream has stopped.
+    static constexpr std::chrono::milliseconds kMaxStallTime{1000};
+    // Level reported for silence, in millibels.
+    static constexpr int32_t kMinLevelMb = -9600;
+
     VisualizerSwContext(int statusDepth, const Parameter::Common& common)
         : EffectContext(statusDepth, common) {
         LOG(DEBUG) << __func__;
-        mCaptureSampleBuffer.resize(kMaxCaptureSize);
-        fill(mCaptureSampleBuffer.begin(), mCaptureSampleBuffer.end(), 0x80);
+        setVsCaptureSize(mCaptureSize);
     }
 
     RetCode setVsCaptureSize(int captureSize);
@@ -50,16 +61,51 @@ class VisualizerSwContext final : public EffectContext {
     RetCode setVsLatency(int latency);
     int getVsLatency() const { return mLatency; }
 
-    Visualizer::Measurement getVsMeasurement() const { return mMeasurement; }
-    std::vector<uint8_t> getVsCaptureSampleBuffer() const { return mCaptureSampleBuffer; }
+    Visualizer::Measurement getVsMeasurement() const;
+    // The latest 'captureSize' samples, mixed to mono, as unsigned 8 bit PCM.
+    std::vector<uint8_t> getVsCaptureSampleBuffer() const;
+
+    // What computeVsFft() needs, taken under the effect lock so that the transform runs without it.
+    struct FftInput {
+        std::shared_ptr<const dsp::Fft> fft;
+        // Reserve kMaxCaptureSize bytes before getVsFftInput() to keep it from allocating.
+        std::vector<uint8_t> capture;
+    };
+    void getVsFftInput(FftInput* input) const;
+    /**
+     * The spectrum of getVsCaptureSampleBuffer() in the format of the framework Visualizer
+     * getFft(): the real parts of bin 0 and bin 'captureSize / 2', then the real and imaginary
+     * parts of the bins in between, as signed 8 bit values relative to a full scale sine. Empty if
+     * the capture size is not a power of two.
+     */
+    static std::vector<uint8_t> computeVsFft(const FftInput& input);
+
+    IEffect::Status process(float* in, float* out, int samples);
 
   private:
     int mCaptureSize = kMaxCaptureSize;
     Visualizer::ScalingMode mScalingMode = Visualizer::ScalingMode::NORMALIZED;
     Visualizer::MeasurementMode mMeasurementMode = Visualizer::MeasurementMode::NONE;
     int mLatency = 0;
-    const Visualizer::Measurement mMeasurement = {0, 0};
-    std::vector<uint8_t> mCaptureSampleBuffer;
+    // Null if the capture size is not a power of two. Replaced rather than reconfigured, an FFT
+    // may still be running on the previous one.
+    std::shared_ptr<const dsp::Fft> mFft;
+
+    // The latest kMaxCaptureSize mono samples, mHistoryPosition is the oldest.
+    std::array<float, kMaxCaptureSize> mHistory = {};
+    size_t mHistoryPosition = 0;
+    // Peak and mean square of the latest mMeasurementCount buffers.
+    std::array<float, kMeasurementBufferCount> mBufferPeaks = {};
+    std::array<float, kMeasurementBufferCount> mBufferMeanSquares = {};
+    size_t mMeasurementPosition = 0;
+    size_t mMeasurementCount = 0;
+    // When process() last ran, unset before the first buffer.
+    std::optional<std::chrono::steady_clock::time_point> mProcessTime;
+
+    // True if no buffer was processed within kMaxStallTime.
+    bool isStalled() const;
+    // Writes the latest 'captureSize' samples as unsigned 8 bit PCM to 'buffer'.
+    void fillCaptureSampleBuffer(uint8_t* buffer) const;
 };
 
 class VisualizerSw final : public EffectImpl {
@@ -79,6 +125,10 @@ class VisualizerSw final : public EffectImpl {
     ndk::ScopedAStatus getParameterSpecific(const Parameter::Id& id, Parameter::Specific* specific)
             REQUIRES(mImplMutex) override;
 
+    // Serves the spectrum without holding mImplMutex for the transform, the rest goes to
+    // EffectImpl::getParameter().
+    ndk::ScopedAStatus getParameter(const Parameter::Id& id, Parameter* param) override;
+
     std::shared_ptr<EffectContext> createContext(const Parameter::Common& common)
             REQUIRES(mImplMutex) override;
     RetCode releaseContext() REQUIRES(mImplMutex) override;
@@ -92,5 +142,8 @@ class VisualizerSw final : public EffectImpl {
     std::shared_ptr<VisualizerSwContext> mContext GUARDED_BY(mImplMutex);
     ndk::ScopedAStatus getParameterVisualizer(const Visualizer::Tag& tag,
                                               Parameter::Specific* specific) REQUIRES(mImplMutex);
+    // The spectrum is returned in the bytes of a DefaultExtension for any vendor extension id.
+    ndk::ScopedAStatus getParameterVisualizerFft(Parameter::Specific* specific)
+            EXCLUDES(mImplMutex);
 };
 }  // namespace aidl::android::hardware::audio::effect
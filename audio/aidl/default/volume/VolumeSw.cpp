@@ -169,23 +169,50 @@ RetCode VolumeSw::releaseContext() {
 
 // Processing method running in EffectWorker thread.
 IEffect::Status VolumeSw::effectProcessImpl(float* in, float* out, int samples) {
-    // TODO: get data buffer and process.
-    LOG(DEBUG) << __func__ << " in " << in << " out " << out << " samples " << samples;
-    for (int i = 0; i < samples; i++) {
-        *out++ = *in++;
+    RETURN_VALUE_IF(!mContext, (IEffect::Status{EX_NULL_POINTER, 0, 0}), "nullContext");
+    return mContext->process(in, out, samples);
+}
+
+RetCode VolumeSwContext::setCommon(const Parameter::Common& common) {
+    if (auto ret = EffectContext::setCommon(common); ret != RetCode::SUCCESS) {
+        return ret;
     }
-    return {STATUS_OK, samples, samples};
+    configureGain();
+    return RetCode::SUCCESS;
 }
 
 RetCode VolumeSwContext::setVolLevel(int level) {
     mLevel = level;
+    // Level changes move by constant dB steps.
+    mGain.setGain(getTargetGain(), dsp::GainRamp::kDefaultRampFrames,
+                  dsp::GainRamp::Shape::kExponential);
     return RetCode::SUCCESS;
 }
 
 RetCode VolumeSwContext::setVolMute(bool mute) {
-    // TODO : Add implementation to modify mute
     mMute = mute;
+    // A linear fade reaches silence, an exponential one would stop at its floor.
+    mGain.setGain(getTargetGain(), dsp::GainRamp::kDefaultRampFrames,
+                  dsp::GainRamp::Shape::kLinear);
     return RetCode::SUCCESS;
 }
 
+void VolumeSwContext::configureGain() {
+    if (!mGain.configure(mInputChannelCount, mOutputChannelCount)) {
+        LOG(WARNING) << __func__ << " unsupported IO, bypass: in channels " << mInputChannelCount
+                     << " out channels " << mOutputChannelCount;
+        return;
+    }
+    mGain.setGain(getTargetGain(), 0 /* rampFrames */);
+}
+
+float VolumeSwContext::getTargetGain() const {
+    return mMute ? 0.f : dsp::millibelsToGain(mLevel);
+}
+
+IEffect::Status VolumeSwContext::process(float* in, float* out, int samples) {
+    mGain.processInterleaved(in, out, samples);
+    return {STATUS_OK, samples, samples};
+}
+
 }  // namespace aidl::android::hardware::audio::effect
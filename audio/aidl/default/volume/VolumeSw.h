@@ -21,6 +21,7 @@
 #include <cstdlib>
 #include <memory>
 
+#include "dsp/Gain.h"
 #include "effect-impl/EffectImpl.h"
 
 namespace aidl::android::hardware::audio::effect {
@@ -30,8 +31,11 @@ class VolumeSwContext final : public EffectContext {
     VolumeSwContext(int statusDepth, const Parameter::Common& common)
         : EffectContext(statusDepth, common) {
         LOG(DEBUG) << __func__;
+        configureGain();
     }
 
+    RetCode setCommon(const Parameter::Common& common) override;
+
     RetCode setVolLevel(int level);
 
     int getVolLevel() const { return mLevel; }
@@ -40,9 +44,17 @@ class VolumeSwContext final : public EffectContext {
 
     bool getVolMute() const { return mMute; }
 
+    IEffect::Status process(float* in, float* out, int samples);
+
   private:
+    // Level in millibels.
     int mLevel = 0;
     bool mMute = false;
+
+    dsp::GainRamp mGain;
+
+    void configureGain();
+    float getTargetGain() const;
 };
 
 class VolumeSw final : public EffectImpl {
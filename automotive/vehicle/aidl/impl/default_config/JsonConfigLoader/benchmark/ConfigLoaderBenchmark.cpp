@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <BinaryConfigLoader.h>
+#include <JsonConfigLoader.h>
+
+#include <android-base/file.h>
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+namespace {
+
+constexpr char kDefaultPropertiesConfigFile[] = "DefaultProperties.json";
+
+std::string getConfigPath() {
+    return android::base::GetExecutableDirectory() + "/" + kDefaultPropertiesConfigFile;
+}
+
+// The startup path without an image: parse the JSON config and resolve every constant by name.
+void BM_LoadJsonConfig(benchmark::State& state) {
+    std::string configPath = getConfigPath();
+    for (auto _ : state) {
+        JsonConfigLoader loader;
+        auto result = loader.loadPropConfig(configPath);
+        if (!result.ok()) {
+            state.SkipWithError(result.error().message().c_str());
+            return;
+        }
+        benchmark::DoNotOptimize(result);
+    }
+}
+BENCHMARK(BM_LoadJsonConfig);
+
+// The startup path with an image: hash the JSON config to check that the image is up to date,
+// then mmap the precompiled image of the same config.
+void BM_LoadConfigImage(benchmark::State& state) {
+    std::string configPath = getConfigPath();
+    JsonConfigLoader jsonLoader;
+    auto configs = jsonLoader.loadPropConfig(configPath);
+    if (!configs.ok()) {
+        state.SkipWithError(configs.error().message().c_str());
+        return;
+    }
+    auto sourceHash = BinaryConfigLoader::hashSourceFile(configPath);
+    if (!sourceHash.ok()) {
+        state.SkipWithError(sourceHash.error().message().c_str());
+        return;
+    }
+    std::vector<uint8_t> image =
+            BinaryConfigLoader::serializePropConfig(configs.value(), sourceHash.value());
+    TemporaryFile imageFile;
+    if (!android::base::WriteFully(imageFile.fd, image.data(), image.size())) {
+        state.SkipWithError("failed to write the config image");
+        return;
+    }
+    std::string imagePath = imageFile.path;
+
+    for (auto _ : state) {
+        BinaryConfigLoader loader;
+        auto result = loader.loadPropConfig(imagePath, configPath);
+        if (!result.ok()) {
+            state.SkipWithError(result.error().message().c_str());
+            return;
+        }
+        benchmark::DoNotOptimize(result);
+    }
+    state.counters["imageBytes"] = image.size();
+}
+BENCHMARK(BM_LoadConfigImage);
+
+}  // namespace
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+BENCHMARK_MAIN();
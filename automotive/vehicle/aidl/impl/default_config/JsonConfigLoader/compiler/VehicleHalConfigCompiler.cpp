@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compiles a VHAL JSON config file into a binary config image that BinaryConfigLoader can load
+// without parsing JSON.
+//
+// Usage: VehicleHalConfigCompiler <input JSON file> <output image file>
+
+#include <BinaryConfigLoader.h>
+#include <JsonConfigLoader.h>
+
+#include <fstream>
+#include <iostream>
+
+using ::android::hardware::automotive::vehicle::BinaryConfigLoader;
+using ::android::hardware::automotive::vehicle::JsonConfigLoader;
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <input JSON file> <output image file>" << std::endl;
+        return 1;
+    }
+    const std::string inputPath = argv[1];
+    const std::string outputPath = argv[2];
+
+    auto sourceHash = BinaryConfigLoader::hashSourceFile(inputPath);
+    if (!sourceHash.ok()) {
+        std::cerr << "Failed to hash " << inputPath << ": " << sourceHash.error().message()
+                  << std::endl;
+        return 1;
+    }
+    JsonConfigLoader loader;
+    auto result = loader.loadPropConfig(inputPath);
+    if (!result.ok()) {
+        std::cerr << "Failed to load " << inputPath << ": " << result.error().message()
+                  << std::endl;
+        return 1;
+    }
+
+    std::vector<uint8_t> image =
+            BinaryConfigLoader::serializePropConfig(result.value(), sourceHash.value());
+    std::ofstream ofs(outputPath, std::ios::binary | std::ios::trunc);
+    ofs.write(reinterpret_cast<const char*>(image.data()), image.size());
+    ofs.close();
+    if (!ofs) {
+        std::cerr << "Failed to write " << outputPath << std::endl;
+        return 1;
+    }
+    return 0;
+}
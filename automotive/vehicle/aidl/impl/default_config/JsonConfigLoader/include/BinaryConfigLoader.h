@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef android_hardware_automotive_vehicle_aidl_impl_default_config_JsonConfigLoader_include_BinaryConfigLoader_H_
+#define android_hardware_automotive_vehicle_aidl_impl_default_config_JsonConfigLoader_include_BinaryConfigLoader_H_
+
+#include <ConfigDeclaration.h>
+
+#include <android-base/result.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+// A class to load vehicle property configs and initial values from a precompiled binary image.
+//
+// The image is produced offline from a JSON config file by VehicleHalConfigCompiler, so loading
+// it does not need to parse JSON or resolve constant names. The image starts with a magic, a
+// format version and the hash of the JSON config it was compiled from. An image with a different
+// version, or compiled from a different JSON config, is rejected and the caller should fall back
+// to the JSON config.
+class BinaryConfigLoader final {
+  public:
+    // The file extension for a config image. "DefaultProperties.json" compiles to
+    // "DefaultProperties.vhalcfg".
+    inline static const std::string IMAGE_FILE_EXTENSION = ".vhalcfg";
+    static constexpr uint32_t IMAGE_VERSION = 2;
+
+    // Returns the hash of the content of a JSON config, recorded in the images compiled from it.
+    // This only detects an image that is out of date, it is not a cryptographic hash.
+    static uint64_t hashSource(const void* data, size_t size);
+
+    // Reads a JSON config file and returns the hash of its content.
+    static android::base::Result<uint64_t> hashSourceFile(const std::string& sourcePath);
+
+    // Serializes the config declarations to a binary image, recording 'sourceHash', the hash of
+    // the JSON config they were loaded from. The output is deterministic, the configs are
+    // ordered by property ID.
+    static std::vector<uint8_t> serializePropConfig(
+            const std::unordered_map<int32_t, ConfigDeclaration>& configsByPropId,
+            uint64_t sourceHash);
+
+    // Parses a binary image in memory to a map from propId to ConfigDeclarations. Fails if the
+    // image was not compiled from a JSON config with the hash 'sourceHash'.
+    android::base::Result<std::unordered_map<int32_t, ConfigDeclaration>> loadPropConfig(
+            const uint8_t* data, size_t size, uint64_t sourceHash);
+
+    // Maps a binary image file into memory and parses it to a map from propId to
+    // ConfigDeclarations. Fails if the image was not compiled from the current content of the
+    // JSON config file 'sourcePath', for example after the JSON config was edited on the device.
+    android::base::Result<std::unordered_map<int32_t, ConfigDeclaration>> loadPropConfig(
+            const std::string& imagePath, const std::string& sourcePath);
+};
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif  // android_hardware_automotive_vehicle_aidl_impl_default_config_JsonConfigLoader_include_BinaryConfigLoader_H_
@@ -0,0 +1,401 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <BinaryConfigLoader.h>
+
+#include <android-base/file.h>
+#include <android-base/unique_fd.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <type_traits>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+namespace {
+
+using ::aidl::android::hardware::automotive::vehicle::RawPropValues;
+using ::aidl::android::hardware::automotive::vehicle::VehicleAreaConfig;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropConfig;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropertyAccess;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropertyChangeMode;
+
+using ::android::base::Error;
+using ::android::base::Result;
+using ::android::base::unique_fd;
+
+// The image layout, all the values are in host byte order:
+//
+// header: IMAGE_MAGIC, uint32 IMAGE_VERSION, uint64 source hash, uint32 config count
+// config: VehiclePropConfig, RawPropValues initialValue,
+//         uint32 area value count, (int32 areaId, RawPropValues)...
+//
+// A vector is a uint32 element count followed by the elements, a string is a vector of chars and
+// a nullable vector is a uint8 flag followed by the vector if the flag is 1.
+constexpr char IMAGE_MAGIC[8] = {'V', 'H', 'A', 'L', 'C', 'F', 'G', '\0'};
+
+// 64-bit FNV-1a.
+constexpr uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325;
+constexpr uint64_t FNV_PRIME = 0x100000001b3;
+
+class ImageWriter final {
+  public:
+    template <class T>
+    void writeScalar(T value) {
+        static_assert(std::is_arithmetic_v<T>);
+        const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+        mBuffer.insert(mBuffer.end(), bytes, bytes + sizeof(T));
+    }
+
+    void writeBool(bool value) { writeScalar<uint8_t>(value ? 1 : 0); }
+
+    template <class T>
+    void writeVector(const std::vector<T>& values) {
+        static_assert(std::is_arithmetic_v<T>);
+        writeScalar<uint32_t>(values.size());
+        const auto* bytes = reinterpret_cast<const uint8_t*>(values.data());
+        mBuffer.insert(mBuffer.end(), bytes, bytes + values.size() * sizeof(T));
+    }
+
+    void writeString(const std::string& value) {
+        writeScalar<uint32_t>(value.size());
+        mBuffer.insert(mBuffer.end(), value.begin(), value.end());
+    }
+
+    void writeMagic() {
+        mBuffer.insert(mBuffer.end(), std::begin(IMAGE_MAGIC), std::end(IMAGE_MAGIC));
+    }
+
+    std::vector<uint8_t> release() { return std::move(mBuffer); }
+
+  private:
+    std::vector<uint8_t> mBuffer;
+};
+
+class ImageReader final {
+  public:
+    ImageReader(const uint8_t* data, size_t size) : mData(data), mSize(size) {}
+
+    template <class T>
+    bool readScalar(T* out) {
+        static_assert(std::is_arithmetic_v<T>);
+        if (remaining() < sizeof(T)) {
+            return false;
+        }
+        memcpy(out, mData + mOffset, sizeof(T));
+        mOffset += sizeof(T);
+        return true;
+    }
+
+    bool readBool(bool* out) {
+        uint8_t value;
+        if (!readScalar(&value) || value > 1) {
+            return false;
+        }
+        *out = (value == 1);
+        return true;
+    }
+
+    template <class T>
+    bool readVector(std::vector<T>* out) {
+        static_assert(std::is_arithmetic_v<T>);
+        uint32_t count;
+        if (!readScalar(&count) || remaining() / sizeof(T) < count) {
+            return false;
+        }
+        out->resize(count);
+        if (count > 0) {
+            memcpy(out->data(), mData + mOffset, count * sizeof(T));
+            mOffset += count * sizeof(T);
+        }
+        return true;
+    }
+
+    bool readString(std::string* out) {
+        uint32_t size;
+        if (!readScalar(&size) || remaining() < size) {
+            return false;
+        }
+        out->assign(reinterpret_cast<const char*>(mData + mOffset), size);
+        mOffset += size;
+        return true;
+    }
+
+    bool readMagic() {
+        if (remaining() < sizeof(IMAGE_MAGIC) ||
+            memcmp(mData + mOffset, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) != 0) {
+            return false;
+        }
+        mOffset += sizeof(IMAGE_MAGIC);
+        return true;
+    }
+
+    size_t offset() const { return mOffset; }
+
+    size_t remaining() const { return mSize - mOffset; }
+
+  private:
+    const uint8_t* mData;
+    size_t mSize;
+    size_t mOffset = 0;
+};
+
+void writeRawPropValues(const RawPropValues& values, ImageWriter* writer) {
+    writer->writeVector(values.int32Values);
+    writer->writeVector(values.floatValues);
+    writer->writeVector(values.int64Values);
+    writer->writeVector(values.byteValues);
+    writer->writeString(values.stringValue);
+}
+
+bool readRawPropValues(ImageReader* reader, RawPropValues* values) {
+    return reader->readVector(&values->int32Values) && reader->readVector(&values->floatValues) &&
+           reader->readVector(&values->int64Values) && reader->readVector(&values->byteValues) &&
+           reader->readString(&values->stringValue);
+}
+
+void writeAreaConfig(const VehicleAreaConfig& areaConfig, ImageWriter* writer) {
+    writer->writeScalar(areaConfig.areaId);
+    writer->writeScalar(static_cast<int32_t>(areaConfig.access));
+    writer->writeScalar(areaConfig.minInt32Value);
+    writer->writeScalar(areaConfig.maxInt32Value);
+    writer->writeScalar(areaConfig.minInt64Value);
+    writer->writeScalar(areaConfig.maxInt64Value);
+    writer->writeScalar(areaConfig.minFloatValue);
+    writer->writeScalar(areaConfig.maxFloatValue);
+    writer->writeBool(areaConfig.supportedEnumValues.has_value());
+    if (areaConfig.supportedEnumValues.has_value()) {
+        writer->writeVector(*areaConfig.supportedEnumValues);
+    }
+    writer->writeBool(areaConfig.supportVariableUpdateRate);
+}
+
+bool readAreaConfig(ImageReader* reader, VehicleAreaConfig* areaConfig) {
+    int32_t access;
+    bool hasSupportedEnumValues;
+    if (!reader->readScalar(&areaConfig->areaId) || !reader->readScalar(&access) ||
+        !reader->readScalar(&areaConfig->minInt32Value) ||
+        !reader->readScalar(&areaConfig->maxInt32Value) ||
+        !reader->readScalar(&areaConfig->minInt64Value) ||
+        !reader->readScalar(&areaConfig->maxInt64Value) ||
+        !reader->readScalar(&areaConfig->minFloatValue) ||
+        !reader->readScalar(&areaConfig->maxFloatValue) ||
+        !reader->readBool(&hasSupportedEnumValues)) {
+        return false;
+    }
+    areaConfig->access = static_cast<VehiclePropertyAccess>(access);
+    if (hasSupportedEnumValues) {
+        std::vector<int64_t> supportedEnumValues;
+        if (!reader->readVector(&supportedEnumValues)) {
+            return false;
+        }
+        areaConfig->supportedEnumValues = std::move(supportedEnumValues);
+    }
+    return reader->readBool(&areaConfig->supportVariableUpdateRate);
+}
+
+void writeConfigDeclaration(const ConfigDeclaration& configDecl, ImageWriter* writer) {
+    const VehiclePropConfig& config = configDecl.config;
+    writer->writeScalar(config.prop);
+    writer->writeScalar(static_cast<int32_t>(config.access));
+    writer->writeScalar(static_cast<int32_t>(config.changeMode));
+    writer->writeScalar<uint32_t>(config.areaConfigs.size());
+    for (const auto& areaConfig : config.areaConfigs) {
+        writeAreaConfig(areaConfig, writer);
+    }
+    writer->writeVector(config.configArray);
+    writer->writeString(config.configString);
+    writer->writeScalar(config.minSampleRate);
+    writer->writeScalar(config.maxSampleRate);
+
+    writeRawPropValues(configDecl.initialValue, writer);
+
+    std::vector<int32_t> areaIds;
+    for (const auto& [areaId, _] : configDecl.initialAreaValues) {
+        areaIds.push_back(areaId);
+    }
+    std::sort(areaIds.begin(), areaIds.end());
+    writer->writeScalar<uint32_t>(areaIds.size());
+    for (int32_t areaId : areaIds) {
+        writer->writeScalar(areaId);
+        writeRawPropValues(configDecl.initialAreaValues.at(areaId), writer);
+    }
+}
+
+bool readConfigDeclaration(ImageReader* reader, ConfigDeclaration* configDecl) {
+    VehiclePropConfig& config = configDecl->config;
+    int32_t access;
+    int32_t changeMode;
+    uint32_t areaConfigCount;
+    if (!reader->readScalar(&config.prop) || !reader->readScalar(&access) ||
+        !reader->readScalar(&changeMode) || !reader->readScalar(&areaConfigCount)) {
+        return false;
+    }
+    config.access = static_cast<VehiclePropertyAccess>(access);
+    config.changeMode = static_cast<VehiclePropertyChangeMode>(changeMode);
+    for (uint32_t i = 0; i < areaConfigCount; i++) {
+        VehicleAreaConfig areaConfig = {};
+        if (!readAreaConfig(reader, &areaConfig)) {
+            return false;
+        }
+        config.areaConfigs.push_back(std::move(areaConfig));
+    }
+    if (!reader->readVector(&config.configArray) || !reader->readString(&config.configString) ||
+        !reader->readScalar(&config.minSampleRate) || !reader->readScalar(&config.maxSampleRate)) {
+        return false;
+    }
+
+    if (!readRawPropValues(reader, &configDecl->initialValue)) {
+        return false;
+    }
+
+    uint32_t areaValueCount;
+    if (!reader->readScalar(&areaValueCount)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < areaValueCount; i++) {
+        int32_t areaId;
+        RawPropValues areaValue = {};
+        if (!reader->readScalar(&areaId) || !readRawPropValues(reader, &areaValue)) {
+            return false;
+        }
+        configDecl->initialAreaValues[areaId] = std::move(areaValue);
+    }
+    return true;
+}
+
+}  // namespace
+
+uint64_t BinaryConfigLoader::hashSource(const void* data, size_t size) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+Result<uint64_t> BinaryConfigLoader::hashSourceFile(const std::string& sourcePath) {
+    std::string content;
+    if (!android::base::ReadFileToString(sourcePath, &content)) {
+        return Error() << "couldn't read " << sourcePath;
+    }
+    return hashSource(content.data(), content.size());
+}
+
+std::vector<uint8_t> BinaryConfigLoader::serializePropConfig(
+        const std::unordered_map<int32_t, ConfigDeclaration>& configsByPropId,
+        uint64_t sourceHash) {
+    std::vector<int32_t> propIds;
+    for (const auto& [propId, _] : configsByPropId) {
+        propIds.push_back(propId);
+    }
+    std::sort(propIds.begin(), propIds.end());
+
+    ImageWriter writer;
+    writer.writeMagic();
+    writer.writeScalar(IMAGE_VERSION);
+    writer.writeScalar(sourceHash);
+    writer.writeScalar<uint32_t>(propIds.size());
+    for (int32_t propId : propIds) {
+        writeConfigDeclaration(configsByPropId.at(propId), &writer);
+    }
+    return writer.release();
+}
+
+Result<std::unordered_map<int32_t, ConfigDeclaration>> BinaryConfigLoader::loadPropConfig(
+        const uint8_t* data, size_t size, uint64_t sourceHash) {
+    ImageReader reader(data, size);
+    if (!reader.readMagic()) {
+        return Error() << "not a VHAL config image";
+    }
+    uint32_t version;
+    if (!reader.readScalar(&version)) {
+        return Error() << "config image is truncated";
+    }
+    if (version != IMAGE_VERSION) {
+        return Error() << "unsupported config image version: " << version
+                       << ", expected: " << IMAGE_VERSION;
+    }
+    uint64_t imageSourceHash;
+    if (!reader.readScalar(&imageSourceHash)) {
+        return Error() << "config image is truncated";
+    }
+    if (imageSourceHash != sourceHash) {
+        return Error() << "config image is out of date, it was compiled from a different config";
+    }
+    uint32_t configCount;
+    if (!reader.readScalar(&configCount)) {
+        return Error() << "config image is truncated";
+    }
+    std::unordered_map<int32_t, ConfigDeclaration> configsByPropId;
+    configsByPropId.reserve(configCount);
+    for (uint32_t i = 0; i < configCount; i++) {
+        ConfigDeclaration configDecl = {};
+        if (!readConfigDeclaration(&reader, &configDecl)) {
+            return Error() << "config image is truncated or corrupted at offset: "
+                           << reader.offset();
+        }
+        int32_t propId = configDecl.config.prop;
+        configsByPropId[propId] = std::move(configDecl);
+    }
+    if (reader.remaining() != 0) {
+        return Error() << "config image has " << reader.remaining() << " unexpected trailing bytes";
+    }
+    return configsByPropId;
+}
+
+Result<std::unordered_map<int32_t, ConfigDeclaration>> BinaryConfigLoader::loadPropConfig(
+        const std::string& imagePath, const std::string& sourcePath) {
+    Result<uint64_t> sourceHash = hashSourceFile(sourcePath);
+    if (!sourceHash.ok()) {
+        return sourceHash.error();
+    }
+    unique_fd fd(open(imagePath.c_str(), O_RDONLY | O_CLOEXEC));
+    if (fd.get() < 0) {
+        return Error() << "couldn't open " << imagePath << " for parsing.";
+    }
+    struct stat st;
+    if (fstat(fd.get(), &st) != 0) {
+        return Error() << "couldn't stat " << imagePath;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    if (size == 0) {
+        return Error() << imagePath << " is empty";
+    }
+    void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd.get(), 0);
+    if (addr == MAP_FAILED) {
+        return Error() << "couldn't mmap " << imagePath;
+    }
+    auto result = loadPropConfig(static_cast<const uint8_t*>(addr), size, sourceHash.value());
+    munmap(addr, size);
+    if (!result.ok()) {
+        return Error() << "failed to parse " << imagePath << ": " << result.error().message();
+    }
+    return result;
+}
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
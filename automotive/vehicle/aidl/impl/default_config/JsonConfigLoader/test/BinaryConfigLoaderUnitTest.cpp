@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <BinaryConfigLoader.h>
+#include <JsonConfigLoader.h>
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+class BinaryConfigLoaderUnitTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        mSource = R"(
+        {
+            "properties": [
+                {
+                    "property": "VehicleProperty::INFO_FUEL_CAPACITY",
+                    "configArray": [1, 2, "Constants::HVAC_ALL"],
+                    "configString": "blahblah",
+                    "minSampleRate": 1.5,
+                    "maxSampleRate": 10.0,
+                    "defaultValue": {
+                        "int32Values": [1, 2],
+                        "floatValues": [1.1, 2.2],
+                        "int64Values": [3],
+                        "stringValue": "abc"
+                    }
+                },
+                {
+                    "property": "VehicleProperty::HVAC_FAN_SPEED",
+                    "areas": [
+                        {
+                            "areaId": "Constants::SEAT_1_LEFT",
+                            "minInt32Value": 1,
+                            "maxInt32Value": 7,
+                            "supportedEnumValues": [1, 2, 3],
+                            "supportVariableUpdateRate": false,
+                            "defaultValue": {
+                                "int32Values": [3]
+                            }
+                        },
+                        {
+                            "areaId": "Constants::SEAT_1_RIGHT",
+                            "minInt32Value": 1,
+                            "maxInt32Value": 7
+                        }
+                    ]
+                }
+            ]
+        }
+        )";
+        mSourceHash = BinaryConfigLoader::hashSource(mSource.data(), mSource.size());
+        std::istringstream iss(mSource);
+        auto result = mJsonLoader.loadPropConfig(iss);
+        ASSERT_TRUE(result.ok()) << result.error().message();
+        mConfigs = std::move(result.value());
+    }
+
+    JsonConfigLoader mJsonLoader;
+    BinaryConfigLoader mLoader;
+    std::unordered_map<int32_t, ConfigDeclaration> mConfigs;
+    std::string mSource;
+    uint64_t mSourceHash = 0;
+};
+
+TEST_F(BinaryConfigLoaderUnitTest, testRoundTrip) {
+    std::vector<uint8_t> image = BinaryConfigLoader::serializePropConfig(mConfigs, mSourceHash);
+
+    auto result = mLoader.loadPropConfig(image.data(), image.size(), mSourceHash);
+
+    ASSERT_TRUE(result.ok()) << result.error().message();
+    ASSERT_EQ(result.value(), mConfigs);
+}
+
+TEST_F(BinaryConfigLoaderUnitTest, testSerializeIsDeterministic) {
+    // A map with a different bucket count and insertion order iterates in a different order.
+    std::vector<std::pair<int32_t, ConfigDeclaration>> entries(mConfigs.begin(), mConfigs.end());
+    std::unordered_map<int32_t, ConfigDeclaration> reversedConfigs(/*bucket_count=*/1024);
+    for (auto it = entries.rbegin(); it != entries.rend(); it++) {
+        reversedConfigs.insert(*it);
+    }
+
+    ASSERT_EQ(BinaryConfigLoader::serializePropConfig(mConfigs, mSourceHash),
+              BinaryConfigLoader::serializePropConfig(reversedConfigs, mSourceHash));
+}
+
+TEST_F(BinaryConfigLoaderUnitTest, testLoadFromFile) {
+    std::vector<uint8_t> image = BinaryConfigLoader::serializePropConfig(mConfigs, mSourceHash);
+    TemporaryFile imageFile;
+    ASSERT_TRUE(android::base::WriteFully(imageFile.fd, image.data(), image.size()));
+    TemporaryFile sourceFile;
+    ASSERT_TRUE(android::base::WriteStringToFd(mSource, sourceFile.fd));
+
+    auto result = mLoader.loadPropConfig(std::string(imageFile.path), std::string(sourceFile.path));
+
+    ASSERT_TRUE(result.ok()) << result.error().message();
+    ASSERT_EQ(result.value(), mConfigs);
+}
+
+TEST_F(BinaryConfigLoaderUnitTest, testFileNotExist) {
+    TemporaryFile sourceFile;
+    ASSERT_TRUE(android::base::WriteStringToFd(mSource, sourceFile.fd));
+
+    ASSERT_FALSE(
+            mLoader.loadPropConfig(std::string("/not/exist.vhalcfg"), std::string(sourceFile.path))
+                    .ok());
+}
+
+TEST_F(BinaryConfigLoaderUnitTest, testSourceMismatch) {
+    std::vector<uint8_t> image = BinaryConfigLoader::serializePropConfig(mConfigs, mSourceHash);
+
+    ASSERT_FALSE(mLoader.loadPropConfig(image.data(), image.size(), mSourceHash + 1).ok())
+            << "image compiled from another config must cause error";
+}
+
+TEST_F(BinaryConfigLoaderUnitTest, testLoadFromFileWithEditedSource) {
+    std::vector<uint8_t> image = BinaryConfigLoader::serializePropConfig(mConfigs, mSourceHash);
+    TemporaryFile imageFile;
+    ASSERT_TRUE(android::base::WriteFully(imageFile.fd, image.data(), image.size()));
+    // The JSON config was edited after the image was built, e.g. pushed to the device with adb.
+    std::string editedSource = mSource;
+    editedSource.replace(editedSource.find("blahblah"), strlen("blahblah"), "edited");
+    TemporaryFile sourceFile;
+    ASSERT_TRUE(android::base::WriteStringToFd(editedSource, sourceFile.fd));
+
+    ASSERT_FALSE(
+            mLoader.loadPropConfig(std::string(imageFile.path), std::string(sourceFile.path)).ok())
+            << "image out of date with its JSON config must cause error";
+}
+
+TEST_F(BinaryConfigLoaderUnitTest, testSourceFileNotExist) {
+    std::vector<uint8_t> image = BinaryConfigLoader::serializePropConfig(mConfigs, mSourceHash);
+    TemporaryFile imageFile;
+    ASSERT_TRUE(android::base::WriteFully(imageFile.fd, image.data(), image.size()));
+
+    ASSERT_FALSE(mLoader.loadPropConfig(std::string(imageFile.path), std::string("/not/exist.json"))
+                         .ok());
+}
+
+TEST_F(BinaryConfigLoaderUnitTest, testBadMagic) {
+    std::vector<uint8_t> image = BinaryConfigLoader::serializePropConfig(mConfigs, mSourceHash);
+    image[0] = 'X';
+
+    ASSERT_FALSE(mLoader.loadPropConfig(image.data(), image.size(), mSourceHash).ok())
+            << "bad magic must cause error";
+}
+
+TEST_F(BinaryConfigLoaderUnitTest, testVersionMismatch) {
+    std::vector<uint8_t> image = BinaryConfigLoader::serializePropConfig(mConfigs, mSourceHash);
+    // The version follows the 8-byte magic.
+    image[8]++;
+
+    ASSERT_FALSE(mLoader.loadPropConfig(image.data(), image.size(), mSourceHash).ok())
+            << "unknown version must cause error";
+}
+
+TEST_F(BinaryConfigLoaderUnitTest, testTruncated) {
+    std::vector<uint8_t> image = BinaryConfigLoader::serializePropConfig(mConfigs, mSourceHash);
+
+    for (size_t size = 0; size < image.size(); size++) {
+        ASSERT_FALSE(mLoader.loadPropConfig(image.data(), size, mSourceHash).ok())
+                << "truncated image of size " << size << " must cause error";
+    }
+}
+
+TEST_F(BinaryConfigLoaderUnitTest, testTrailingBytes) {
+    std::vector<uint8_t> image = BinaryConfigLoader::serializePropConfig(mConfigs, mSourceHash);
+    image.push_back(0);
+
+    ASSERT_FALSE(mLoader.loadPropConfig(image.data(), image.size(), mSourceHash).ok())
+            << "trailing bytes must cause error";
+}
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
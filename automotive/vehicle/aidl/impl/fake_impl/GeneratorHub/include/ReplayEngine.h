@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef android_hardware_automotive_vehicle_aidl_impl_fake_impl_GeneratorHub_include_ReplayEngine_H_
+#define android_hardware_automotive_vehicle_aidl_impl_fake_impl_GeneratorHub_include_ReplayEngine_H_
+
+#include "FakeValueGenerator.h"
+
+#include <VehicleHalTypes.h>
+#include <android-base/thread_annotations.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace fake {
+
+// A preloaded trace of property events stored column by column.
+//
+// Each scalar field is kept in its own array and the variable length values of all events are
+// concatenated into one pool per value type, so a trace of many small events only uses a few
+// large allocations and replaying it walks the memory sequentially.
+class EventTrace final {
+  public:
+    EventTrace();
+
+    // Appends an event to the end of the trace.
+    void addEvent(const aidl::android::hardware::automotive::vehicle::VehiclePropValue& event);
+
+    // Creates a trace from the events in order.
+    static EventTrace fromEvents(
+            const std::vector<aidl::android::hardware::automotive::vehicle::VehiclePropValue>&
+                    events);
+
+    // Creates a trace from at most 'maxEvents' events produced by the generator. This works for
+    // generators that never end, e.g. LinearFakeValueGenerator.
+    static EventTrace fromGenerator(FakeValueGenerator* generator, size_t maxEvents);
+
+    size_t size() const;
+
+    int64_t getTimestamp(size_t index) const;
+
+    // Writes the event at 'index' to 'event', reusing the capacity of its value vectors.
+    void getEvent(size_t index,
+                  aidl::android::hardware::automotive::vehicle::VehiclePropValue* event) const;
+
+  private:
+    std::vector<int64_t> mTimestamps;
+    std::vector<int32_t> mPropIds;
+    std::vector<int32_t> mAreaIds;
+    std::vector<aidl::android::hardware::automotive::vehicle::VehiclePropertyStatus> mStatuses;
+    // The values of event i are in [offsets[i], offsets[i + 1]) of the pools.
+    std::vector<uint32_t> mInt32Offsets;
+    std::vector<uint32_t> mFloatOffsets;
+    std::vector<uint32_t> mInt64Offsets;
+    std::vector<uint32_t> mByteOffsets;
+    std::vector<uint32_t> mStringOffsets;
+    std::vector<int32_t> mInt32Pool;
+    std::vector<float> mFloatPool;
+    std::vector<int64_t> mInt64Pool;
+    std::vector<uint8_t> mBytePool;
+    std::string mStringPool;
+};
+
+// Replays an EventTrace on a dedicated thread and delivers the events in batches.
+//
+// By default the events are paced by the relative timestamps in the trace, the same way
+// JsonFakeValueGenerator generates events. All the events due at the time the thread wakes up are
+// delivered in one batch. If 'unpaced' is set, the events are delivered back to back as fast as
+// possible, which is useful to stress test the VHAL event pipeline. The replayed events are
+// stamped with their scheduled time, or with the time they are delivered if unpaced.
+class ReplayEngine final {
+  public:
+    using OnHalEvents = std::function<void(
+            std::vector<aidl::android::hardware::automotive::vehicle::VehiclePropValue> events)>;
+
+    struct Options {
+        // The max number of events delivered in one callback.
+        size_t batchSize = 64;
+        // Whether to ignore the trace timestamps and deliver the events as fast as possible.
+        bool unpaced = false;
+        // How many times the trace would be replayed. If it is less than 0, replay indefinitely.
+        int32_t iterations = 1;
+    };
+
+    struct Stats {
+        int64_t eventCount = 0;
+        int64_t batchCount = 0;
+        int64_t durationInNanos = 0;
+    };
+
+    explicit ReplayEngine(OnHalEvents&& onHalEvents);
+
+    ~ReplayEngine();
+
+    // Starts replaying the trace. The ongoing replay, if any, is stopped first.
+    void start(std::shared_ptr<const EventTrace> trace, const Options& options);
+
+    // Stops the ongoing replay. Returns true if a replay was running.
+    bool stop();
+
+    // Waits until the ongoing replay finishes. Returns false if it is still running after the
+    // timeout.
+    bool waitForFinish(std::chrono::nanoseconds timeout);
+
+    bool isRunning() const;
+
+    // Gets the stats of the ongoing replay or the last finished one.
+    Stats getStats() const;
+
+  private:
+    // The interval between the last event of an iteration and the first event of the next one,
+    // this is the same as JsonFakeValueGenerator.
+    static constexpr int64_t ITERATION_INTERVAL_IN_NANOS = 1'000'000;
+
+    const OnHalEvents mOnHalEvents;
+
+    // Serializes start and stop, the replay thread never takes this lock.
+    std::mutex mStartStopLock;
+    std::thread mThread GUARDED_BY(mStartStopLock);
+
+    mutable std::mutex mLock;
+    std::condition_variable mCv;
+    bool mRunning GUARDED_BY(mLock) = false;
+    // Only modified with mLock held so that the waiting replay thread sees the change.
+    std::atomic<bool> mStopRequested = false;
+
+    std::atomic<int64_t> mEventCount = 0;
+    std::atomic<int64_t> mBatchCount = 0;
+    std::atomic<int64_t> mStartTimeInNanos = 0;
+    std::atomic<int64_t> mEndTimeInNanos = 0;
+
+    void run(std::shared_ptr<const EventTrace> trace, Options options);
+
+    // Waits until 'timeInNanos' on the elapsed realtime clock. Returns false if stop is requested.
+    bool waitUntil(int64_t timeInNanos);
+
+    void deliver(std::vector<aidl::android::hardware::automotive::vehicle::VehiclePropValue>* batch,
+                 size_t batchSize);
+};
+
+}  // namespace fake
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif  // android_hardware_automotive_vehicle_aidl_impl_fake_impl_GeneratorHub_include_ReplayEngine_H_
@@ -0,0 +1,263 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "ReplayEngine"
+
+#include "ReplayEngine.h"
+
+#include <utils/Log.h>
+#include <utils/SystemClock.h>
+
+#include <inttypes.h>
+#include <algorithm>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace fake {
+
+namespace {
+
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropValue;
+using ::android::base::ScopedLockAssertion;
+
+template <class T>
+void appendValues(const std::vector<T>& values, std::vector<T>* pool,
+                  std::vector<uint32_t>* offsets) {
+    pool->insert(pool->end(), values.begin(), values.end());
+    offsets->push_back(static_cast<uint32_t>(pool->size()));
+}
+
+template <class T>
+void copyValues(const std::vector<T>& pool, const std::vector<uint32_t>& offsets, size_t index,
+                std::vector<T>* values) {
+    values->assign(pool.begin() + offsets[index], pool.begin() + offsets[index + 1]);
+}
+
+}  // namespace
+
+EventTrace::EventTrace()
+    : mInt32Offsets({0}),
+      mFloatOffsets({0}),
+      mInt64Offsets({0}),
+      mByteOffsets({0}),
+      mStringOffsets({0}) {}
+
+void EventTrace::addEvent(const VehiclePropValue& event) {
+    mTimestamps.push_back(event.timestamp);
+    mPropIds.push_back(event.prop);
+    mAreaIds.push_back(event.areaId);
+    mStatuses.push_back(event.status);
+    appendValues(event.value.int32Values, &mInt32Pool, &mInt32Offsets);
+    appendValues(event.value.floatValues, &mFloatPool, &mFloatOffsets);
+    appendValues(event.value.int64Values, &mInt64Pool, &mInt64Offsets);
+    appendValues(event.value.byteValues, &mBytePool, &mByteOffsets);
+    mStringPool += event.value.stringValue;
+    mStringOffsets.push_back(static_cast<uint32_t>(mStringPool.size()));
+}
+
+EventTrace EventTrace::fromEvents(const std::vector<VehiclePropValue>& events) {
+    EventTrace trace;
+    for (const auto& event : events) {
+        trace.addEvent(event);
+    }
+    return trace;
+}
+
+EventTrace EventTrace::fromGenerator(FakeValueGenerator* generator, size_t maxEvents) {
+    EventTrace trace;
+    for (size_t i = 0; i < maxEvents; i++) {
+        auto maybeEvent = generator->nextEvent();
+        if (!maybeEvent.has_value()) {
+            break;
+        }
+        trace.addEvent(maybeEvent.value());
+    }
+    return trace;
+}
+
+size_t EventTrace::size() const {
+    return mTimestamps.size();
+}
+
+int64_t EventTrace::getTimestamp(size_t index) const {
+    return mTimestamps[index];
+}
+
+void EventTrace::getEvent(size_t index, VehiclePropValue* event) const {
+    event->timestamp = mTimestamps[index];
+    event->prop = mPropIds[index];
+    event->areaId = mAreaIds[index];
+    event->status = mStatuses[index];
+    copyValues(mInt32Pool, mInt32Offsets, index, &event->value.int32Values);
+    copyValues(mFloatPool, mFloatOffsets, index, &event->value.floatValues);
+    copyValues(mInt64Pool, mInt64Offsets, index, &event->value.int64Values);
+    copyValues(mBytePool, mByteOffsets, index, &event->value.byteValues);
+    event->value.stringValue.assign(mStringPool, mStringOffsets[index],
+                                    mStringOffsets[index + 1] - mStringOffsets[index]);
+}
+
+ReplayEngine::ReplayEngine(OnHalEvents&& onHalEvents) : mOnHalEvents(std::move(onHalEvents)) {}
+
+ReplayEngine::~ReplayEngine() {
+    stop();
+}
+
+void ReplayEngine::start(std::shared_ptr<const EventTrace> trace, const Options& options) {
+    std::scoped_lock<std::mutex> startStopLockGuard(mStartStopLock);
+    {
+        std::scoped_lock<std::mutex> lockGuard(mLock);
+        mStopRequested.store(true);
+    }
+    mCv.notify_all();
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+
+    mEventCount.store(0);
+    mBatchCount.store(0);
+    mStartTimeInNanos.store(elapsedRealtimeNano());
+    mEndTimeInNanos.store(0);
+    {
+        std::scoped_lock<std::mutex> lockGuard(mLock);
+        mStopRequested.store(false);
+        mRunning = true;
+    }
+    mThread = std::thread([this, trace, options] { run(trace, options); });
+}
+
+bool ReplayEngine::stop() {
+    std::scoped_lock<std::mutex> startStopLockGuard(mStartStopLock);
+    bool wasRunning;
+    {
+        std::scoped_lock<std::mutex> lockGuard(mLock);
+        wasRunning = mRunning;
+        mStopRequested.store(true);
+    }
+    mCv.notify_all();
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+    return wasRunning;
+}
+
+bool ReplayEngine::waitForFinish(std::chrono::nanoseconds timeout) {
+    std::unique_lock<std::mutex> uniqueLock(mLock);
+    return mCv.wait_for(uniqueLock, timeout, [this] {
+        ScopedLockAssertion lockAssertion(mLock);
+        return !mRunning;
+    });
+}
+
+bool ReplayEngine::isRunning() const {
+    std::scoped_lock<std::mutex> lockGuard(mLock);
+    return mRunning;
+}
+
+ReplayEngine::Stats ReplayEngine::getStats() const {
+    int64_t endTimeInNanos = mEndTimeInNanos.load();
+    if (endTimeInNanos == 0) {
+        endTimeInNanos = elapsedRealtimeNano();
+    }
+    return Stats{
+            .eventCount = mEventCount.load(),
+            .batchCount = mBatchCount.load(),
+            .durationInNanos = endTimeInNanos - mStartTimeInNanos.load(),
+    };
+}
+
+bool ReplayEngine::waitUntil(int64_t timeInNanos) {
+    std::unique_lock<std::mutex> uniqueLock(mLock);
+    int64_t waitTimeInNanos = timeInNanos - elapsedRealtimeNano();
+    if (waitTimeInNanos > 0) {
+        mCv.wait_for(uniqueLock, std::chrono::nanoseconds(waitTimeInNanos),
+                     [this] { return mStopRequested.load(); });
+    }
+    return !mStopRequested.load();
+}
+
+void ReplayEngine::deliver(std::vector<VehiclePropValue>* batch, size_t batchSize) {
+    if (batch->empty()) {
+        return;
+    }
+    mEventCount.fetch_add(batch->size());
+    mBatchCount.fetch_add(1);
+    mOnHalEvents(std::move(*batch));
+    batch->clear();
+    batch->reserve(batchSize);
+}
+
+void ReplayEngine::run(std::shared_ptr<const EventTrace> trace, Options options) {
+    size_t batchSize = std::max<size_t>(options.batchSize, 1);
+    size_t eventCount = trace->size();
+    int32_t iterationsLeft = eventCount == 0 ? 0 : options.iterations;
+    int64_t iterationStartInNanos = elapsedRealtimeNano();
+    std::vector<VehiclePropValue> batch;
+    batch.reserve(batchSize);
+
+    while (iterationsLeft != 0 && !mStopRequested.load()) {
+        int64_t firstTimestamp = trace->getTimestamp(0);
+        int64_t eventTimeInNanos = iterationStartInNanos;
+        for (size_t i = 0; i < eventCount; i++) {
+            int64_t nowInNanos = elapsedRealtimeNano();
+            if (options.unpaced) {
+                eventTimeInNanos = nowInNanos;
+            } else {
+                eventTimeInNanos =
+                        iterationStartInNanos + (trace->getTimestamp(i) - firstTimestamp);
+                if (eventTimeInNanos > nowInNanos) {
+                    // Deliver the events that are already due before waiting for this one.
+                    deliver(&batch, batchSize);
+                    if (!waitUntil(eventTimeInNanos)) {
+                        break;
+                    }
+                }
+            }
+            batch.emplace_back();
+            trace->getEvent(i, &batch.back());
+            batch.back().timestamp = eventTimeInNanos;
+            if (batch.size() >= batchSize) {
+                deliver(&batch, batchSize);
+                if (mStopRequested.load()) {
+                    break;
+                }
+            }
+        }
+        if (iterationsLeft > 0) {
+            iterationsLeft--;
+        }
+        iterationStartInNanos = eventTimeInNanos + ITERATION_INTERVAL_IN_NANOS;
+    }
+    if (!mStopRequested.load()) {
+        deliver(&batch, batchSize);
+    }
+
+    mEndTimeInNanos.store(elapsedRealtimeNano());
+    ALOGI("%s: replay ended, %" PRId64 " events in %" PRId64 " batches", __func__,
+          mEventCount.load(), mBatchCount.load());
+    {
+        std::scoped_lock<std::mutex> lockGuard(mLock);
+        mRunning = false;
+    }
+    mCv.notify_all();
+}
+
+}  // namespace fake
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
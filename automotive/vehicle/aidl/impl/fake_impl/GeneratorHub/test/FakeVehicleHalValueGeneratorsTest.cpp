@@ -17,6 +17,7 @@
 #include <GeneratorHub.h>
 #include <JsonFakeValueGenerator.h>
 #include <LinearFakeValueGenerator.h>
+#include <ReplayEngine.h>
 #include <VehicleUtils.h>
 #include <android-base/file.h>
 #include <android-base/thread_annotations.h>
@@ -476,6 +477,142 @@ TEST_F(FakeVehicleHalValueGeneratorsTest, testJsonFakeValueGeneratorDifferentTyp
     EXPECT_EQ(events, expectedValues);
 }
 
+TEST_F(FakeVehicleHalValueGeneratorsTest, testEventTraceRoundTrip) {
+    std::vector<VehiclePropValue> events = {
+            VehiclePropValue{
+                    .timestamp = 1,
+                    .areaId = 2,
+                    .prop = 289408000,
+                    .value.int32Values = {1, 2},
+            },
+            VehiclePropValue{
+                    .timestamp = 2,
+                    .prop = 286265094,
+                    .value.stringValue = "test",
+            },
+            VehiclePropValue{
+                    .timestamp = 3,
+                    .prop = 299896626,
+                    .value =
+                            {
+                                    .int32Values = {3},
+                                    .floatValues = {1.5},
+                                    .int64Values = {4, 5},
+                                    .byteValues = {0x01, 0x02},
+                                    .stringValue = "abc",
+                            },
+            },
+            VehiclePropValue{
+                    .timestamp = 4,
+                    .prop = 291504905,
+            },
+    };
+
+    EventTrace trace = EventTrace::fromEvents(events);
+
+    ASSERT_EQ(trace.size(), events.size());
+    VehiclePropValue event;
+    for (size_t i = 0; i < events.size(); i++) {
+        // Reuse the same output value to make sure stale values are overwritten.
+        trace.getEvent(i, &event);
+        EXPECT_EQ(event, events[i]);
+        EXPECT_EQ(trace.getTimestamp(i), events[i].timestamp);
+    }
+}
+
+TEST_F(FakeVehicleHalValueGeneratorsTest, testEventTraceFromGenerator) {
+    LinearFakeValueGenerator generator(toInt(VehicleProperty::PERF_VEHICLE_SPEED),
+                                       /*middleValue=*/50.0, /*initValue=*/30.0,
+                                       /*dispersion=*/50.0, /*increment=*/20.0,
+                                       /*interval=*/10000000);
+
+    EventTrace trace = EventTrace::fromGenerator(&generator, /*maxEvents=*/10);
+
+    ASSERT_EQ(trace.size(), 10u);
+    for (size_t i = 1; i < trace.size(); i++) {
+        EXPECT_EQ(trace.getTimestamp(i) - trace.getTimestamp(i - 1), 10000000);
+    }
+}
+
+TEST_F(FakeVehicleHalValueGeneratorsTest, testReplayEngineUnpaced) {
+    std::vector<VehiclePropValue> events;
+    for (int32_t i = 0; i < 1000; i++) {
+        events.push_back(VehiclePropValue{
+                // The timestamps would be ignored, otherwise the replay takes 1000s.
+                .timestamp = static_cast<int64_t>(i) * 1'000'000'000,
+                .prop = toInt(VehicleProperty::PERF_VEHICLE_SPEED),
+                .value.floatValues = {static_cast<float>(i)},
+        });
+    }
+    auto trace = std::make_shared<EventTrace>(EventTrace::fromEvents(events));
+    std::mutex lock;
+    std::vector<size_t> batchSizes;
+    std::vector<VehiclePropValue> replayedEvents;
+    ReplayEngine engine([&](std::vector<VehiclePropValue> batch) {
+        std::scoped_lock<std::mutex> lockGuard(lock);
+        batchSizes.push_back(batch.size());
+        replayedEvents.insert(replayedEvents.end(), batch.begin(), batch.end());
+    });
+
+    engine.start(trace, {.batchSize = 64, .unpaced = true, .iterations = 2});
+
+    ASSERT_TRUE(engine.waitForFinish(10s)) << "replay did not finish";
+    std::scoped_lock<std::mutex> lockGuard(lock);
+    ASSERT_EQ(replayedEvents.size(), 2000u);
+    for (size_t i = 0; i < replayedEvents.size(); i++) {
+        EXPECT_EQ(replayedEvents[i].value.floatValues, events[i % 1000].value.floatValues);
+    }
+    // The events from two iterations are batched together.
+    ASSERT_EQ(batchSizes.size(), 32u);
+    for (size_t i = 0; i < batchSizes.size() - 1; i++) {
+        EXPECT_EQ(batchSizes[i], 64u);
+    }
+    auto stats = engine.getStats();
+    EXPECT_EQ(stats.eventCount, 2000);
+    EXPECT_EQ(stats.batchCount, 32);
+}
+
+TEST_F(FakeVehicleHalValueGeneratorsTest, testReplayEnginePaced) {
+    auto trace = std::make_shared<EventTrace>(EventTrace::fromGenerator(
+            std::make_unique<JsonFakeValueGenerator>(getTestFilePath("prop.json"), 1).get(),
+            /*maxEvents=*/100));
+    ASSERT_EQ(trace->size(), 4u);
+    std::mutex lock;
+    std::vector<VehiclePropValue> replayedEvents;
+    ReplayEngine engine([&](std::vector<VehiclePropValue> batch) {
+        std::scoped_lock<std::mutex> lockGuard(lock);
+        replayedEvents.insert(replayedEvents.end(), batch.begin(), batch.end());
+    });
+
+    int64_t startTime = elapsedRealtimeNano();
+    engine.start(trace, {});
+
+    ASSERT_TRUE(engine.waitForFinish(10s)) << "replay did not finish";
+    std::scoped_lock<std::mutex> lockGuard(lock);
+    ASSERT_EQ(replayedEvents.size(), 4u);
+    EXPECT_GE(replayedEvents[0].timestamp, startTime);
+    for (size_t i = 1; i < replayedEvents.size(); i++) {
+        // The events in prop.json are 1ms apart.
+        EXPECT_EQ(replayedEvents[i].timestamp - replayedEvents[i - 1].timestamp, 1'000'000);
+    }
+    EXPECT_GE(elapsedRealtimeNano() - startTime, 3'000'000);
+}
+
+TEST_F(FakeVehicleHalValueGeneratorsTest, testReplayEngineStop) {
+    auto trace = std::make_shared<EventTrace>(EventTrace::fromEvents({VehiclePropValue{
+            .prop = toInt(VehicleProperty::PERF_VEHICLE_SPEED),
+            .value.floatValues = {1.0},
+    }}));
+    ReplayEngine engine([](std::vector<VehiclePropValue>) {});
+
+    engine.start(trace, {.unpaced = true, .iterations = -1});
+
+    ASSERT_TRUE(engine.isRunning());
+    ASSERT_TRUE(engine.stop());
+    ASSERT_FALSE(engine.isRunning());
+    ASSERT_FALSE(engine.stop());
+}
+
 }  // namespace fake
 }  // namespace vehicle
 }  // namespace automotive
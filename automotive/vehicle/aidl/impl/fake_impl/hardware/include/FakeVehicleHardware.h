@@ -17,6 +17,7 @@
 #ifndef android_hardware_automotive_vehicle_aidl_impl_fake_impl_hardware_include_FakeVehicleHardware_H_
 #define android_hardware_automotive_vehicle_aidl_impl_fake_impl_hardware_include_FakeVehicleHardware_H_
 
+#include <BinaryConfigLoader.h>
 #include <ConcurrentQueue.h>
 #include <ConfigDeclaration.h>
 #include <FakeObd2Frame.h>
@@ -25,6 +26,7 @@
 #include <IVehicleHardware.h>
 #include <JsonConfigLoader.h>
 #include <RecurrentTimer.h>
+#include <ReplayEngine.h>
 #include <VehicleHalTypes.h>
 #include <VehiclePropertyStore.h>
 #include <aidl/android/hardware/automotive/vehicle/VehicleHwKeyInputAction.h>
@@ -160,6 +162,8 @@ class FakeVehicleHardware : public IVehicleHardware {
     std::unique_ptr<RecurrentTimer> mRecurrentTimer;
     // GeneratorHub is thread-safe.
     std::unique_ptr<GeneratorHub> mGeneratorHub;
+    // ReplayEngine is thread-safe.
+    std::unique_ptr<ReplayEngine> mReplayEngine;
 
     // Only allowed to set once.
     std::unique_ptr<const PropertyChangeCallback> mOnPropertyChangeCallback;
@@ -188,6 +192,7 @@ class FakeVehicleHardware : public IVehicleHardware {
 
     // Only used during initialization.
     JsonConfigLoader mLoader;
+    BinaryConfigLoader mImageLoader;
 
     // Only used during initialization. If not empty, points to an external grpc server that
     // provides power controlling related properties.
@@ -205,13 +210,18 @@ class FakeVehicleHardware : public IVehicleHardware {
             std::vector<aidl::android::hardware::automotive::vehicle::VehiclePropValue> values)
             EXCLUDES(mLock);
     // Load the config files in format '*.json' from the directory and parse the config files
-    // into a map from property ID to ConfigDeclarations.
+    // into a map from property ID to ConfigDeclarations. If a precompiled '*.vhalcfg' image
+    // exists next to a JSON file, the image is loaded instead.
     bool loadPropConfigsFromDir(const std::string& dirPath,
                                 std::unordered_map<int32_t, ConfigDeclaration>* configs);
     // Function to be called when a value change event comes from vehicle bus. In our fake
     // implementation, this function is only called during "--inject-event" dump command.
     void eventFromVehicleBus(
             const aidl::android::hardware::automotive::vehicle::VehiclePropValue& value);
+    // Function to be called when a batch of value change events comes from the replay engine.
+    // Every event is delivered even if the value does not change.
+    void eventsFromVehicleBus(
+            std::vector<aidl::android::hardware::automotive::vehicle::VehiclePropValue> values);
 
     int getHvacTempNumIncrements(int requestedTemp, int minTemp, int maxTemp, int increment);
     void updateHvacTemperatureValueSuggestionInput(
@@ -39,6 +39,8 @@
 #include <dirent.h>
 #include <inttypes.h>
 #include <sys/types.h>
+#include <unistd.h>
+#include <cstring>
 #include <regex>
 #include <unordered_set>
 #include <vector>
@@ -123,6 +125,8 @@ constexpr char OVERRIDE_PROPERTY[] = "persist.vendor.vhal_init_value_override";
 constexpr char POWER_STATE_REQ_CONFIG_PROPERTY[] = "ro.vendor.fake_vhal.ap_power_state_req.config";
 // The value to be returned if VENDOR_PROPERTY_FOR_ERROR_CODE_TESTING is set as the property
 constexpr int VENDOR_ERROR_CODE = 0x00ab0005;
+// Continuous property refreshes that are due within 1ms of each other share one timer wakeup.
+constexpr int64_t RECURRENT_TIMER_SLACK_IN_NANOS = 1'000'000;
 // A list of supported options for "--set" command.
 const std::unordered_set<std::string> SET_PROP_OPTIONS = {
         // integer.
@@ -354,9 +358,12 @@ FakeVehicleHardware::FakeVehicleHardware(std::string defaultConfigDir,
       mOverrideConfigDir(overrideConfigDir),
       mFakeObd2Frame(new obd2frame::FakeObd2Frame(mServerSidePropStore)),
       mFakeUserHal(new FakeUserHal(mValuePool)),
-      mRecurrentTimer(new RecurrentTimer()),
+      mRecurrentTimer(new RecurrentTimer(RECURRENT_TIMER_SLACK_IN_NANOS)),
       mGeneratorHub(new GeneratorHub(
               [this](const VehiclePropValue& value) { eventFromVehicleBus(value); })),
+      mReplayEngine(new ReplayEngine([this](std::vector<VehiclePropValue> values) {
+          eventsFromVehicleBus(std::move(values));
+      })),
       mPendingGetValueRequests(this),
       mPendingSetValueRequests(this),
       mForceOverride(forceOverride) {
@@ -367,6 +374,7 @@ FakeVehicleHardware::~FakeVehicleHardware() {
     mPendingGetValueRequests.stop();
     mPendingSetValueRequests.stop();
     mGeneratorHub.reset();
+    mReplayEngine.reset();
 }
 
 bool FakeVehicleHardware::UseOverrideConfigDir() {
@@ -1397,6 +1405,14 @@ provided, it would iterate indefinitely.
 
 --genfakedata --stopjson [generatorID(string)]: Stop a JSON generator.
 
+--genfakedata --startreplay [jsonFilePath] [repetition(int32)] [batchSize(int32)] [--unpaced]:
+Preload the events in a JSON file (same format as --startjson) and replay them in batches of at
+most batchSize events. If repetition is less than 0, replay indefinitely. With --unpaced, the
+timestamps are ignored and the events are replayed as fast as possible. Only one replay runs at a
+time, starting a new one stops the old one.
+
+--genfakedata --stopreplay: Stop the replay and show how many events were replayed.
+
 --genfakedata --keypress [keyCode(int32)] [display[int32]]: Generate key press.
 
 --genfakedata --keyinputv2 [area(int32)] [display(int32)] [keyCode[int32]] [action[int32]]
@@ -1537,6 +1553,47 @@ std::string FakeVehicleHardware::genFakeDataCommand(const std::vector<std::strin
         } else {
             return StringPrintf("No JSON event generator found for ID: %s", options[2].c_str());
         }
+    } else if (command == "--startreplay") {
+        // --genfakedata --startreplay [jsonFilePath] [repetition] [batchSize] [--unpaced]
+        if (options.size() != 5 && options.size() != 6) {
+            return "incorrect argument count, need 5 or 6 arguments for --genfakedata "
+                   "--startreplay\n" +
+                   genFakeDataHelp();
+        }
+        ReplayEngine::Options replayOptions;
+        int32_t batchSize;
+        if (!android::base::ParseInt(options[3], &replayOptions.iterations)) {
+            return parseErrMsg("repetition", options[3], "int");
+        }
+        if (!android::base::ParseInt(options[4], &batchSize) || batchSize <= 0) {
+            return parseErrMsg("batchSize", options[4], "positive int");
+        }
+        replayOptions.batchSize = static_cast<size_t>(batchSize);
+        if (options.size() == 6) {
+            if (options[5] != "--unpaced") {
+                return StringPrintf("unknown option: %s\n", options[5].c_str()) +
+                       genFakeDataHelp();
+            }
+            replayOptions.unpaced = true;
+        }
+        JsonFakeValueGenerator generator(options[2], /*iteration=*/1);
+        if (!generator.hasNext()) {
+            return "invalid JSON file, no events";
+        }
+        auto trace = std::make_shared<EventTrace>(EventTrace::fromEvents(generator.getAllEvents()));
+        mReplayEngine->start(trace, replayOptions);
+        return StringPrintf("Replay started successfully, %zu events", trace->size());
+    } else if (command == "--stopreplay") {
+        // --genfakedata --stopreplay
+        if (options.size() != 2) {
+            return "incorrect argument count, need 2 arguments for --genfakedata --stopreplay\n";
+        }
+        bool wasRunning = mReplayEngine->stop();
+        ReplayEngine::Stats stats = mReplayEngine->getStats();
+        return StringPrintf("%s, replayed %" PRId64 " events in %" PRId64 " batches in %" PRId64
+                            " ms",
+                            wasRunning ? "Replay stopped successfully" : "No replay is running",
+                            stats.eventCount, stats.batchCount, stats.durationInNanos / 1'000'000);
     } else if (command == "--keypress") {
         int32_t keyCode;
         int32_t display;
@@ -1759,6 +1816,29 @@ void FakeVehicleHardware::eventFromVehicleBus(const VehiclePropValue& value) {
     mServerSidePropStore->writeValue(mValuePool->obtain(value));
 }
 
+void FakeVehicleHardware::eventsFromVehicleBus(std::vector<VehiclePropValue> values) {
+    ATRACE_CALL();
+    std::vector<VehiclePropValue> updatedValues;
+    updatedValues.reserve(values.size());
+    for (auto& value : values) {
+        // Only store the value here, the events are delivered together below.
+        if (auto result = mServerSidePropStore->writeValue(
+                    mValuePool->obtain(value), /*updateStatus=*/false,
+                    VehiclePropertyStore::EventMode::NEVER);
+            !result.ok()) {
+            if (FAKE_VEHICLEHARDWARE_DEBUG) {
+                ALOGD("failed to write replayed value: %s, error: %s", value.toString().c_str(),
+                      getErrorMsg(result).c_str());
+            }
+            continue;
+        }
+        updatedValues.push_back(std::move(value));
+    }
+    if (!updatedValues.empty()) {
+        onValuesChangeCallback(std::move(updatedValues));
+    }
+}
+
 std::string FakeVehicleHardware::dumpSubscriptions() {
     std::scoped_lock<std::mutex> lockGuard(mLock);
     std::string result = "Subscriptions: \n";
@@ -1776,6 +1856,7 @@ std::string FakeVehicleHardware::dumpSubscriptions() {
         result += StringPrintf("OnChange{property: %s, areaId: %d}\n",
                                PROP_ID_TO_CSTR(propIdAreaId.propId), propIdAreaId.areaId);
     }
+    result += mRecurrentTimer->dump();
     return result;
 }
 
@@ -1818,6 +1899,7 @@ std::string FakeVehicleHardware::dumpAllProperties() {
     for (const VehiclePropConfig& config : configs) {
         msg += dumpOnePropertyByConfig(rowNumber++, config);
     }
+    msg += mValuePool->dump();
     return msg;
 }
 
@@ -2436,8 +2518,23 @@ bool FakeVehicleHardware::loadPropConfigsFromDir(
             continue;
         }
         std::string filePath = dirPath + "/" + std::string(f->d_name);
-        ALOGI("loading properties from %s", filePath.c_str());
-        auto result = mLoader.loadPropConfig(filePath);
+        // The image has the same base name as the JSON file, e.g. "DefaultProperties.vhalcfg".
+        std::string imagePath = filePath.substr(0, filePath.size() - strlen(".json")) +
+                                BinaryConfigLoader::IMAGE_FILE_EXTENSION;
+        Result<std::unordered_map<int32_t, ConfigDeclaration>> result =
+                Error() << "no config image";
+        if (access(imagePath.c_str(), F_OK) == 0) {
+            ALOGI("loading properties from %s", imagePath.c_str());
+            result = mImageLoader.loadPropConfig(imagePath, filePath);
+            if (!result.ok()) {
+                ALOGW("failed to load config image: %s, error: %s, falling back to JSON",
+                      imagePath.c_str(), result.error().message().c_str());
+            }
+        }
+        if (!result.ok()) {
+            ALOGI("loading properties from %s", filePath.c_str());
+            result = mLoader.loadPropConfig(filePath);
+        }
         if (!result.ok()) {
             ALOGE("failed to load config file: %s, error: %s", filePath.c_str(),
                   result.error().message().c_str());
@@ -2990,6 +2990,18 @@ std::vector<OptionsTestCase> GenInvalidOptions() {
             {"genfakedata_stopjson_no_args",
              {"--genfakedata", "--stopjson"},
              "incorrect argument count"},
+            {"genfakedata_startreplay_no_args",
+             {"--genfakedata", "--startreplay"},
+             "incorrect argument count"},
+            {"genfakedata_startreplay_invalid_batch_size",
+             {"--genfakedata", "--startreplay", "file", "1", "0"},
+             "failed to parse batchSize as positive int: \"0\""},
+            {"genfakedata_startreplay_unknown_option",
+             {"--genfakedata", "--startreplay", "file", "1", "1", "--abcd"},
+             "unknown option"},
+            {"genfakedata_startreplay_invalid_json_file",
+             {"--genfakedata", "--startreplay", "file", "1", "1"},
+             "invalid JSON file"},
             {"genfakedata_keypress_no_args",
              {"--genfakedata", "--keypress"},
              "incorrect argument count"},
@@ -3171,6 +3183,33 @@ TEST_F(FakeVehicleHardwareTest, testDebugGenFakeDataJsonByContent) {
     EXPECT_EQ(8, events[0].value.int32Values[0]);
 }
 
+TEST_F(FakeVehicleHardwareTest, testDebugGenFakeDataReplayUnpaced) {
+    subscribe(toInt(VehicleProperty::GEAR_SELECTION), /*areaId*/ 0, /*sampleRateHz*/ 0);
+
+    std::vector<std::string> options = {"--genfakedata", "--startreplay",
+                                        getTestFilePath("prop.json"), "2", "4", "--unpaced"};
+
+    DumpResult result = getHardware()->dump(options);
+
+    ASSERT_FALSE(result.callerShouldDumpState);
+    ASSERT_THAT(result.buffer, HasSubstr("successfully"));
+
+    // Replayed events are delivered even if the value does not change.
+    ASSERT_TRUE(waitForChangedProperties(/*count=*/8, milliseconds(1000)))
+            << "not enough events generated for replay";
+
+    auto events = getChangedProperties();
+    ASSERT_EQ(8u, events.size());
+    EXPECT_EQ(8, events[0].value.int32Values[0]);
+    EXPECT_EQ(10, events[3].value.int32Values[0]);
+    EXPECT_EQ(8, events[4].value.int32Values[0]);
+    EXPECT_EQ(10, events[7].value.int32Values[0]);
+
+    result = getHardware()->dump({"--genfakedata", "--stopreplay"});
+
+    ASSERT_THAT(result.buffer, HasSubstr("replayed 8 events in 2 batches"));
+}
+
 TEST_F(FakeVehicleHardwareTest, testDebugGenFakeDataJsonInvalidContent) {
     std::vector<std::string> options = {"--genfakedata", "--startjson", "--content", "[{", "2"};
 
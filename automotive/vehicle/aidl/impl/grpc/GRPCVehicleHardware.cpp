@@ -22,8 +22,10 @@
 #include <grpc++/grpc++.h>
 
 #include <cstdlib>
+#include <map>
 #include <mutex>
 #include <shared_mutex>
+#include <unordered_map>
 #include <utility>
 
 namespace android::hardware::automotive::vehicle::virtualization {
@@ -33,11 +35,106 @@ static std::shared_ptr<::grpc::ChannelCredentials> getChannelCredentials() {
     return ::grpc::InsecureChannelCredentials();
 }
 
-GRPCVehicleHardware::GRPCVehicleHardware(std::string service_addr)
+static void toProtoRequests(const std::vector<aidlvhal::GetValueRequest>& requests,
+                            proto::VehiclePropValueRequests* protoRequests) {
+    for (const auto& request : requests) {
+        auto& protoRequest = *protoRequests->add_requests();
+        protoRequest.set_request_id(request.requestId);
+        proto_msg_converter::aidlToProto(request.prop, protoRequest.mutable_value());
+    }
+}
+
+static void toProtoRequests(const std::vector<aidlvhal::SetValueRequest>& requests,
+                            proto::VehiclePropValueRequests* protoRequests) {
+    for (const auto& request : requests) {
+        auto& protoRequest = *protoRequests->add_requests();
+        protoRequest.set_request_id(request.requestId);
+        proto_msg_converter::aidlToProto(request.value, protoRequest.mutable_value());
+    }
+}
+
+static aidlvhal::GetValueResult toAidlResult(const proto::GetValueResult& protoResult) {
+    aidlvhal::GetValueResult result;
+    result.requestId = protoResult.request_id();
+    result.status = static_cast<aidlvhal::StatusCode>(protoResult.status());
+    if (protoResult.has_value()) {
+        aidlvhal::VehiclePropValue value;
+        proto_msg_converter::protoToAidl(protoResult.value(), &value);
+        result.prop = std::move(value);
+    }
+    return result;
+}
+
+static aidlvhal::SetValueResult toAidlResult(const proto::SetValueResult& protoResult) {
+    aidlvhal::SetValueResult result;
+    result.requestId = protoResult.request_id();
+    result.status = static_cast<aidlvhal::StatusCode>(protoResult.status());
+    // TODO(chenhaosjtuacm): call on-set-error callback.
+    return result;
+}
+
+// Remove the callbacks for the results from callbackById and invoke each callback once with all
+// of its results.
+template <class Callback, class ProtoResult>
+static void dispatchStreamResults(
+        std::mutex& mutex,
+        std::unordered_map<int64_t, std::shared_ptr<const Callback>>& callbackById,
+        const ::google::protobuf::RepeatedPtrField<ProtoResult>& protoResults) {
+    using AidlResult = decltype(toAidlResult(std::declval<const ProtoResult&>()));
+
+    std::vector<std::shared_ptr<const Callback>> callbacks;
+    callbacks.reserve(protoResults.size());
+    {
+        std::lock_guard lck(mutex);
+        for (const auto& protoResult : protoResults) {
+            auto it = callbackById.find(protoResult.request_id());
+            if (it == callbackById.end()) {
+                callbacks.push_back(nullptr);
+                continue;
+            }
+            callbacks.push_back(std::move(it->second));
+            callbackById.erase(it);
+        }
+    }
+    std::map<std::shared_ptr<const Callback>, std::vector<AidlResult>> resultsByCallback;
+    for (int i = 0; i < protoResults.size(); i++) {
+        if (callbacks[i] == nullptr) {
+            LOG(WARNING) << __func__
+                         << ": received result for unknown request ID: "
+                         << protoResults[i].request_id();
+            continue;
+        }
+        resultsByCallback[callbacks[i]].push_back(toAidlResult(protoResults[i]));
+    }
+    for (auto& [callback, results] : resultsByCallback) {
+        (*callback)(std::move(results));
+    }
+}
+
+template <class AidlResult, class Callback>
+static void failRequests(
+        std::unordered_map<int64_t, std::shared_ptr<const Callback>>&& callbackById) {
+    std::map<std::shared_ptr<const Callback>, std::vector<AidlResult>> resultsByCallback;
+    for (const auto& [requestId, callback] : callbackById) {
+        auto& result = resultsByCallback[callback].emplace_back();
+        result.requestId = requestId;
+        result.status = aidlvhal::StatusCode::INTERNAL_ERROR;
+    }
+    for (auto& [callback, results] : resultsByCallback) {
+        (*callback)(std::move(results));
+    }
+}
+
+GRPCVehicleHardware::GRPCVehicleHardware(std::string service_addr, bool enableValueStream)
     : mServiceAddr(std::move(service_addr)),
       mGrpcChannel(::grpc::CreateChannel(mServiceAddr, getChannelCredentials())),
       mGrpcStub(proto::VehicleServer::NewStub(mGrpcChannel)),
-      mValuePollingThread([this] { ValuePollingLoop(); }) {}
+      mValuePollingThread([this] { ValuePollingLoop(); }),
+      mValueStreamEnabled(enableValueStream) {
+    if (mValueStreamEnabled) {
+        mValueStreamingThread = std::thread([this] { ValueStreamingLoop(); });
+    }
+}
 
 // Only used for unit testing.
 GRPCVehicleHardware::GRPCVehicleHardware(std::unique_ptr<proto::VehicleServer::StubInterface> stub)
@@ -52,7 +149,15 @@ GRPCVehicleHardware::~GRPCVehicleHardware() {
         mShuttingDownFlag.store(true);
     }
     mShutdownCV.notify_all();
+    {
+        // Make sure the value streaming thread is either waiting or will see the flag.
+        std::lock_guard lck(mStreamMutex);
+    }
+    mStreamCV.notify_all();
     mValuePollingThread.join();
+    if (mValueStreamingThread.joinable()) {
+        mValueStreamingThread.join();
+    }
 }
 
 std::vector<aidlvhal::VehiclePropConfig> GRPCVehicleHardware::getAllPropertyConfigs() const {
@@ -76,15 +181,42 @@ std::vector<aidlvhal::VehiclePropConfig> GRPCVehicleHardware::getAllPropertyConf
 aidlvhal::StatusCode GRPCVehicleHardware::setValues(
         std::shared_ptr<const SetValuesCallback> callback,
         const std::vector<aidlvhal::SetValueRequest>& requests) {
+    if (!mValueStreamEnabled) {
+        return UnarySetValues(callback, requests);
+    }
+    proto::VehiclePropValueRequests protoRequests;
+    toProtoRequests(requests, &protoRequests);
+    {
+        std::lock_guard lck(mStreamMutex);
+        if (mStreamConnected) {
+            for (const auto& request : requests) {
+                if (mStreamSetCallbackById.find(request.requestId) !=
+                    mStreamSetCallbackById.end()) {
+                    LOG(ERROR) << __func__ << ": duplicate request ID: " << request.requestId;
+                    return aidlvhal::StatusCode::INVALID_ARG;
+                }
+            }
+            if (PendingStreamRequestCountLocked() == 0) {
+                mFirstPendingStreamRequestTime = std::chrono::steady_clock::now();
+            }
+            for (auto& protoRequest : *protoRequests.mutable_requests()) {
+                mStreamSetCallbackById[protoRequest.request_id()] = callback;
+                mPendingStreamSetRequests.add_requests()->Swap(&protoRequest);
+            }
+            mStreamCV.notify_all();
+            return aidlvhal::StatusCode::OK;
+        }
+    }
+    return UnarySetValues(callback, requests);
+}
+
+aidlvhal::StatusCode GRPCVehicleHardware::UnarySetValues(
+        std::shared_ptr<const SetValuesCallback> callback,
+        const std::vector<aidlvhal::SetValueRequest>& requests) {
     ::grpc::ClientContext context;
     proto::VehiclePropValueRequests protoRequests;
     proto::SetValueResults protoResults;
-    for (const auto& request : requests) {
-        auto& protoRequest = *protoRequests.add_requests();
-        protoRequest.set_request_id(request.requestId);
-        proto_msg_converter::aidlToProto(request.value, protoRequest.mutable_value());
-    }
-    // TODO(chenhaosjtuacm): Make it Async.
+    toProtoRequests(requests, &protoRequests);
     auto grpc_status = mGrpcStub->SetValues(&context, protoRequests, &protoResults);
     if (!grpc_status.ok()) {
         LOG(ERROR) << __func__ << ": GRPC SetValues Failed: " << grpc_status.error_message();
@@ -96,10 +228,7 @@ aidlvhal::StatusCode GRPCVehicleHardware::setValues(
     }
     std::vector<aidlvhal::SetValueResult> results;
     for (const auto& protoResult : protoResults.results()) {
-        auto& result = results.emplace_back();
-        result.requestId = protoResult.request_id();
-        result.status = static_cast<aidlvhal::StatusCode>(protoResult.status());
-        // TODO(chenhaosjtuacm): call on-set-error callback.
+        results.push_back(toAidlResult(protoResult));
     }
     (*callback)(std::move(results));
 
@@ -109,15 +238,42 @@ aidlvhal::StatusCode GRPCVehicleHardware::setValues(
 aidlvhal::StatusCode GRPCVehicleHardware::getValues(
         std::shared_ptr<const GetValuesCallback> callback,
         const std::vector<aidlvhal::GetValueRequest>& requests) const {
+    if (!mValueStreamEnabled) {
+        return UnaryGetValues(callback, requests);
+    }
+    proto::VehiclePropValueRequests protoRequests;
+    toProtoRequests(requests, &protoRequests);
+    {
+        std::lock_guard lck(mStreamMutex);
+        if (mStreamConnected) {
+            for (const auto& request : requests) {
+                if (mStreamGetCallbackById.find(request.requestId) !=
+                    mStreamGetCallbackById.end()) {
+                    LOG(ERROR) << __func__ << ": duplicate request ID: " << request.requestId;
+                    return aidlvhal::StatusCode::INVALID_ARG;
+                }
+            }
+            if (PendingStreamRequestCountLocked() == 0) {
+                mFirstPendingStreamRequestTime = std::chrono::steady_clock::now();
+            }
+            for (auto& protoRequest : *protoRequests.mutable_requests()) {
+                mStreamGetCallbackById[protoRequest.request_id()] = callback;
+                mPendingStreamGetRequests.add_requests()->Swap(&protoRequest);
+            }
+            mStreamCV.notify_all();
+            return aidlvhal::StatusCode::OK;
+        }
+    }
+    return UnaryGetValues(callback, requests);
+}
+
+aidlvhal::StatusCode GRPCVehicleHardware::UnaryGetValues(
+        std::shared_ptr<const GetValuesCallback> callback,
+        const std::vector<aidlvhal::GetValueRequest>& requests) const {
     ::grpc::ClientContext context;
     proto::VehiclePropValueRequests protoRequests;
     proto::GetValueResults protoResults;
-    for (const auto& request : requests) {
-        auto& protoRequest = *protoRequests.add_requests();
-        protoRequest.set_request_id(request.requestId);
-        proto_msg_converter::aidlToProto(request.prop, protoRequest.mutable_value());
-    }
-    // TODO(chenhaosjtuacm): Make it Async.
+    toProtoRequests(requests, &protoRequests);
     auto grpc_status = mGrpcStub->GetValues(&context, protoRequests, &protoResults);
     if (!grpc_status.ok()) {
         LOG(ERROR) << __func__ << ": GRPC GetValues Failed: " << grpc_status.error_message();
@@ -125,14 +281,7 @@ aidlvhal::StatusCode GRPCVehicleHardware::getValues(
     }
     std::vector<aidlvhal::GetValueResult> results;
     for (const auto& protoResult : protoResults.results()) {
-        auto& result = results.emplace_back();
-        result.requestId = protoResult.request_id();
-        result.status = static_cast<aidlvhal::StatusCode>(protoResult.status());
-        if (protoResult.has_value()) {
-            aidlvhal::VehiclePropValue value;
-            proto_msg_converter::protoToAidl(protoResult.value(), &value);
-            result.prop = std::move(value);
-        }
+        results.push_back(toAidlResult(protoResult));
     }
     (*callback)(std::move(results));
 
@@ -242,8 +391,18 @@ aidlvhal::StatusCode GRPCVehicleHardware::updateSampleRate(int32_t propId, int32
 }
 
 bool GRPCVehicleHardware::waitForConnected(std::chrono::milliseconds waitTime) {
-    return mGrpcChannel->WaitForConnected(gpr_time_add(
-            gpr_now(GPR_CLOCK_MONOTONIC), gpr_time_from_millis(waitTime.count(), GPR_TIMESPAN)));
+    auto deadline = std::chrono::steady_clock::now() + waitTime;
+    if (!mGrpcChannel->WaitForConnected(
+                gpr_time_add(gpr_now(GPR_CLOCK_MONOTONIC),
+                             gpr_time_from_millis(waitTime.count(), GPR_TIMESPAN)))) {
+        return false;
+    }
+    if (!mValueStreamEnabled) {
+        return true;
+    }
+    std::unique_lock lck(mStreamMutex);
+    return mStreamCV.wait_until(lck, deadline,
+                                [this] { return mStreamConnected || mStreamUnsupported; });
 }
 
 void GRPCVehicleHardware::ValuePollingLoop() {
@@ -290,4 +449,135 @@ void GRPCVehicleHardware::ValuePollingLoop() {
     }
 }
 
+void GRPCVehicleHardware::ValueStreamingLoop() {
+    while (!mShuttingDownFlag.load()) {
+        if (!RunValueStream()) {
+            LOG(INFO) << __func__
+                      << ": GRPC StreamValues is not supported by the server, use unary RPCs";
+            {
+                std::lock_guard lck(mStreamMutex);
+                mStreamUnsupported = true;
+            }
+            mStreamCV.notify_all();
+            return;
+        }
+        std::unique_lock lck(mShutdownMutex);
+        mShutdownCV.wait_for(lck, kStreamReconnectDelay,
+                             [this] { return mShuttingDownFlag.load(); });
+    }
+}
+
+bool GRPCVehicleHardware::RunValueStream() {
+    ::grpc::ClientContext context;
+    auto stream = mGrpcStub->StreamValues(&context);
+
+    bool readerStopped{false};
+    bool streamStarted{false};
+    std::thread reader([this, &stream, &readerStopped, &streamStarted] {
+        proto::StreamResponse response;
+        // The first response is the handshake from the server.
+        if (stream->Read(&response)) {
+            {
+                std::lock_guard lck(mStreamMutex);
+                streamStarted = true;
+                mStreamConnected = true;
+            }
+            mStreamCV.notify_all();
+            LOG(INFO) << "ValueStreamingLoop: GRPC Value Stream Started";
+            while (stream->Read(&response)) {
+                OnStreamResponse(response);
+            }
+        }
+        {
+            std::lock_guard lck(mStreamMutex);
+            readerStopped = true;
+        }
+        mStreamCV.notify_all();
+    });
+
+    // Collect the requests that arrive within the batch window and send them as one message.
+    while (true) {
+        proto::StreamRequest getRequest;
+        proto::StreamRequest setRequest;
+        {
+            std::unique_lock lck(mStreamMutex);
+            auto stopped = [this, &readerStopped] {
+                return readerStopped || mShuttingDownFlag.load();
+            };
+            auto batchFull = [this] {
+                return PendingStreamRequestCountLocked() >= kMaxStreamBatchSize;
+            };
+            mStreamCV.wait(lck, [this, &stopped] {
+                return stopped() || PendingStreamRequestCountLocked() > 0;
+            });
+            mStreamCV.wait_until(lck, mFirstPendingStreamRequestTime + kStreamBatchWindow,
+                                 [&stopped, &batchFull] { return stopped() || batchFull(); });
+            if (stopped()) {
+                break;
+            }
+            getRequest.mutable_get_values()->Swap(&mPendingStreamGetRequests);
+            setRequest.mutable_set_values()->Swap(&mPendingStreamSetRequests);
+        }
+        if (getRequest.get_values().requests_size() > 0 && !stream->Write(getRequest)) {
+            break;
+        }
+        if (setRequest.set_values().requests_size() > 0 && !stream->Write(setRequest)) {
+            break;
+        }
+    }
+
+    {
+        std::lock_guard lck(mStreamMutex);
+        mStreamConnected = false;
+    }
+    context.TryCancel();
+    reader.join();
+    auto grpc_status = stream->Finish();
+    // The reader has stopped, so no result could arrive for the requests still pending.
+    FailPendingStreamRequests();
+
+    if (!streamStarted && grpc_status.error_code() == ::grpc::StatusCode::UNIMPLEMENTED) {
+        return false;
+    }
+    if (!mShuttingDownFlag.load()) {
+        LOG(ERROR) << __func__ << ": GRPC Value Stream Failed: " << grpc_status.error_message();
+    }
+    return true;
+}
+
+void GRPCVehicleHardware::OnStreamResponse(const proto::StreamResponse& response) const {
+    switch (response.response_case()) {
+        case proto::StreamResponse::kGetValueResults:
+            dispatchStreamResults(mStreamMutex, mStreamGetCallbackById,
+                                  response.get_value_results().results());
+            break;
+        case proto::StreamResponse::kSetValueResults:
+            dispatchStreamResults(mStreamMutex, mStreamSetCallbackById,
+                                  response.set_value_results().results());
+            break;
+        default:
+            LOG(WARNING) << __func__ << ": ignore stream response with unknown type: "
+                         << response.response_case();
+            break;
+    }
+}
+
+void GRPCVehicleHardware::FailPendingStreamRequests() const {
+    std::unordered_map<int64_t, std::shared_ptr<const GetValuesCallback>> getCallbackById;
+    std::unordered_map<int64_t, std::shared_ptr<const SetValuesCallback>> setCallbackById;
+    {
+        std::lock_guard lck(mStreamMutex);
+        mPendingStreamGetRequests.Clear();
+        mPendingStreamSetRequests.Clear();
+        getCallbackById.swap(mStreamGetCallbackById);
+        setCallbackById.swap(mStreamSetCallbackById);
+    }
+    failRequests<aidlvhal::GetValueResult>(std::move(getCallbackById));
+    failRequests<aidlvhal::SetValueResult>(std::move(setCallbackById));
+}
+
+size_t GRPCVehicleHardware::PendingStreamRequestCountLocked() const {
+    return mPendingStreamGetRequests.requests_size() + mPendingStreamSetRequests.requests_size();
+}
+
 }  // namespace android::hardware::automotive::vehicle::virtualization
@@ -29,10 +29,13 @@
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <shared_mutex>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 namespace android::hardware::automotive::vehicle::virtualization {
@@ -41,7 +44,10 @@ namespace aidlvhal = ::aidl::android::hardware::automotive::vehicle;
 
 class GRPCVehicleHardware : public IVehicleHardware {
   public:
-    explicit GRPCVehicleHardware(std::string service_addr);
+    // If enableValueStream is true, get/set requests are pipelined over one persistent
+    // bidirectional StreamValues RPC instead of one unary RPC per call. Requests fall back to the
+    // unary RPCs while the stream is not connected, or if the server does not support it.
+    explicit GRPCVehicleHardware(std::string service_addr, bool enableValueStream = false);
 
     // Only used for unit testing.
     explicit GRPCVehicleHardware(std::unique_ptr<proto::VehicleServer::StubInterface> stub);
@@ -87,6 +93,8 @@ class GRPCVehicleHardware : public IVehicleHardware {
 
     aidlvhal::StatusCode unsubscribe(int32_t propId, int32_t areaId) override;
 
+    // Wait for the channel to be connected. If the value stream is enabled, also wait until the
+    // stream is ready or the server is known not to support it.
     bool waitForConnected(std::chrono::milliseconds waitTime);
 
   protected:
@@ -94,7 +102,25 @@ class GRPCVehicleHardware : public IVehicleHardware {
     std::unique_ptr<const PropertyChangeCallback> mOnPropChange;
 
   private:
+    // Small requests issued within this window are sent to the server in one stream message.
+    static constexpr auto kStreamBatchWindow = std::chrono::microseconds(200);
+    // A batch is sent right away once it holds this many requests.
+    static constexpr size_t kMaxStreamBatchSize = 64;
+    static constexpr auto kStreamReconnectDelay = std::chrono::milliseconds(100);
+
     void ValuePollingLoop();
+    void ValueStreamingLoop();
+    // Run one StreamValues RPC until it breaks. Returns false if the server does not support it.
+    bool RunValueStream();
+    void OnStreamResponse(const proto::StreamResponse& response) const;
+    // Fail all the requests sent to or waiting for the current stream with INTERNAL_ERROR.
+    void FailPendingStreamRequests() const;
+    size_t PendingStreamRequestCountLocked() const;
+
+    aidlvhal::StatusCode UnaryGetValues(std::shared_ptr<const GetValuesCallback> callback,
+                                        const std::vector<aidlvhal::GetValueRequest>& requests) const;
+    aidlvhal::StatusCode UnarySetValues(std::shared_ptr<const SetValuesCallback> callback,
+                                        const std::vector<aidlvhal::SetValueRequest>& requests);
 
     std::string mServiceAddr;
     std::shared_ptr<::grpc::Channel> mGrpcChannel;
@@ -106,6 +132,26 @@ class GRPCVehicleHardware : public IVehicleHardware {
     std::mutex mShutdownMutex;
     std::condition_variable mShutdownCV;
     std::atomic<bool> mShuttingDownFlag{false};
+
+    bool mValueStreamEnabled{false};
+    std::thread mValueStreamingThread;
+
+    // State for the bidirectional value stream, all guarded by mStreamMutex.
+    mutable std::mutex mStreamMutex;
+    mutable std::condition_variable mStreamCV;
+    // Whether the current stream has received the server handshake.
+    mutable bool mStreamConnected{false};
+    // Whether the server is known not to support the StreamValues RPC.
+    mutable bool mStreamUnsupported{false};
+    // Requests waiting for the batch window to close.
+    mutable proto::VehiclePropValueRequests mPendingStreamGetRequests;
+    mutable proto::VehiclePropValueRequests mPendingStreamSetRequests;
+    mutable std::chrono::steady_clock::time_point mFirstPendingStreamRequestTime;
+    // Callbacks for the requests that are pending or sent, keyed by request id.
+    mutable std::unordered_map<int64_t, std::shared_ptr<const GetValuesCallback>>
+            mStreamGetCallbackById;
+    mutable std::unordered_map<int64_t, std::shared_ptr<const SetValuesCallback>>
+            mStreamSetCallbackById;
 };
 
 }  // namespace android::hardware::automotive::vehicle::virtualization
@@ -38,6 +38,50 @@ static std::shared_ptr<::grpc::ServerCredentials> getServerCredentials() {
     return ::grpc::InsecureServerCredentials();
 }
 
+static std::vector<aidlvhal::GetValueRequest> toAidlGetValueRequests(
+        const proto::VehiclePropValueRequests& requests) {
+    std::vector<aidlvhal::GetValueRequest> aidlRequests;
+    for (const auto& protoRequest : requests.requests()) {
+        auto& aidlRequest = aidlRequests.emplace_back();
+        aidlRequest.requestId = protoRequest.request_id();
+        proto_msg_converter::protoToAidl(protoRequest.value(), &aidlRequest.prop);
+    }
+    return aidlRequests;
+}
+
+static std::vector<aidlvhal::SetValueRequest> toAidlSetValueRequests(
+        const proto::VehiclePropValueRequests& requests) {
+    std::vector<aidlvhal::SetValueRequest> aidlRequests;
+    for (const auto& protoRequest : requests.requests()) {
+        auto& aidlRequest = aidlRequests.emplace_back();
+        aidlRequest.requestId = protoRequest.request_id();
+        proto_msg_converter::protoToAidl(protoRequest.value(), &aidlRequest.value);
+    }
+    return aidlRequests;
+}
+
+static void toProtoResults(const std::vector<aidlvhal::GetValueResult>& getValueResults,
+                           proto::GetValueResults* results) {
+    for (const auto& aidlResult : getValueResults) {
+        auto& protoResult = *results->add_results();
+        protoResult.set_request_id(aidlResult.requestId);
+        protoResult.set_status(static_cast<proto::StatusCode>(aidlResult.status));
+        if (aidlResult.prop) {
+            auto* valuePtr = protoResult.mutable_value();
+            proto_msg_converter::aidlToProto(*aidlResult.prop, valuePtr);
+        }
+    }
+}
+
+static void toProtoResults(const std::vector<aidlvhal::SetValueResult>& setValueResults,
+                           proto::SetValueResults* results) {
+    for (const auto& aidlResult : setValueResults) {
+        auto& protoResult = *results->add_results();
+        protoResult.set_request_id(aidlResult.requestId);
+        protoResult.set_status(static_cast<proto::StatusCode>(aidlResult.status));
+    }
+}
+
 GrpcVehicleProxyServer::GrpcVehicleProxyServer(std::string serverAddr,
                                                std::unique_ptr<IVehicleHardware>&& hardware)
     : mServiceAddr(std::move(serverAddr)), mHardware(std::move(hardware)) {
@@ -64,12 +108,7 @@ GrpcVehicleProxyServer::GrpcVehicleProxyServer(std::string serverAddr,
 ::grpc::Status GrpcVehicleProxyServer::SetValues(::grpc::ServerContext* context,
                                                  const proto::VehiclePropValueRequests* requests,
                                                  proto::SetValueResults* results) {
-    std::vector<aidlvhal::SetValueRequest> aidlRequests;
-    for (const auto& protoRequest : requests->requests()) {
-        auto& aidlRequest = aidlRequests.emplace_back();
-        aidlRequest.requestId = protoRequest.request_id();
-        proto_msg_converter::protoToAidl(protoRequest.value(), &aidlRequest.value);
-    }
+    auto aidlRequests = toAidlSetValueRequests(*requests);
     auto waitMtx = std::make_shared<std::mutex>();
     auto waitCV = std::make_shared<std::condition_variable>();
     auto complete = std::make_shared<bool>(false);
@@ -78,12 +117,7 @@ GrpcVehicleProxyServer::GrpcVehicleProxyServer(std::string serverAddr,
             std::make_shared<const IVehicleHardware::SetValuesCallback>(
                     [waitMtx, waitCV, complete,
                      tmpResults](std::vector<aidlvhal::SetValueResult> setValueResults) {
-                        for (const auto& aidlResult : setValueResults) {
-                            auto& protoResult = *tmpResults->add_results();
-                            protoResult.set_request_id(aidlResult.requestId);
-                            protoResult.set_status(
-                                    static_cast<proto::StatusCode>(aidlResult.status));
-                        }
+                        toProtoResults(setValueResults, tmpResults.get());
                         {
                             std::lock_guard lck(*waitMtx);
                             *complete = true;
@@ -109,12 +143,7 @@ GrpcVehicleProxyServer::GrpcVehicleProxyServer(std::string serverAddr,
 ::grpc::Status GrpcVehicleProxyServer::GetValues(::grpc::ServerContext* context,
                                                  const proto::VehiclePropValueRequests* requests,
                                                  proto::GetValueResults* results) {
-    std::vector<aidlvhal::GetValueRequest> aidlRequests;
-    for (const auto& protoRequest : requests->requests()) {
-        auto& aidlRequest = aidlRequests.emplace_back();
-        aidlRequest.requestId = protoRequest.request_id();
-        proto_msg_converter::protoToAidl(protoRequest.value(), &aidlRequest.prop);
-    }
+    auto aidlRequests = toAidlGetValueRequests(*requests);
     auto waitMtx = std::make_shared<std::mutex>();
     auto waitCV = std::make_shared<std::condition_variable>();
     auto complete = std::make_shared<bool>(false);
@@ -123,16 +152,7 @@ GrpcVehicleProxyServer::GrpcVehicleProxyServer(std::string serverAddr,
             std::make_shared<const IVehicleHardware::GetValuesCallback>(
                     [waitMtx, waitCV, complete,
                      tmpResults](std::vector<aidlvhal::GetValueResult> getValueResults) {
-                        for (const auto& aidlResult : getValueResults) {
-                            auto& protoResult = *tmpResults->add_results();
-                            protoResult.set_request_id(aidlResult.requestId);
-                            protoResult.set_status(
-                                    static_cast<proto::StatusCode>(aidlResult.status));
-                            if (aidlResult.prop) {
-                                auto* valuePtr = protoResult.mutable_value();
-                                proto_msg_converter::aidlToProto(*aidlResult.prop, valuePtr);
-                            }
-                        }
+                        toProtoResults(getValueResults, tmpResults.get());
                         {
                             std::lock_guard lck(*waitMtx);
                             *complete = true;
@@ -216,6 +236,86 @@ GrpcVehicleProxyServer::GrpcVehicleProxyServer(std::string serverAddr,
     return ::grpc::Status(::grpc::StatusCode::ABORTED, "Connection lost.");
 }
 
+::grpc::Status GrpcVehicleProxyServer::StreamValues(
+        ::grpc::ServerContext* context,
+        ::grpc::ServerReaderWriter<proto::StreamResponse, proto::StreamRequest>* stream) {
+    {
+        std::lock_guard lck(mStreamValuesMutex);
+        mStreamValuesContexts.insert(context);
+    }
+    auto writer = std::make_shared<StreamResponseWriter>(stream);
+    // Let the client know that this RPC is supported before it sends any requests.
+    if (writer->Write(proto::StreamResponse())) {
+        proto::StreamRequest request;
+        while (stream->Read(&request)) {
+            switch (request.request_case()) {
+                case proto::StreamRequest::kGetValues:
+                    StreamGetValues(request.get_values(), writer);
+                    break;
+                case proto::StreamRequest::kSetValues:
+                    StreamSetValues(request.set_values(), writer);
+                    break;
+                default:
+                    LOG(WARNING) << __func__ << ": ignore stream request with unknown type: "
+                                 << request.request_case();
+                    break;
+            }
+        }
+    }
+    writer->Close();
+    {
+        std::lock_guard lck(mStreamValuesMutex);
+        mStreamValuesContexts.erase(context);
+    }
+    return ::grpc::Status::OK;
+}
+
+void GrpcVehicleProxyServer::StreamGetValues(const proto::VehiclePropValueRequests& requests,
+                                             std::shared_ptr<StreamResponseWriter> writer) {
+    auto aidlRequests = toAidlGetValueRequests(requests);
+    auto aidlStatus = mHardware->getValues(
+            std::make_shared<const IVehicleHardware::GetValuesCallback>(
+                    [writer](std::vector<aidlvhal::GetValueResult> getValueResults) {
+                        proto::StreamResponse response;
+                        toProtoResults(getValueResults, response.mutable_get_value_results());
+                        writer->Write(response);
+                    }),
+            aidlRequests);
+    if (aidlStatus != aidlvhal::StatusCode::OK) {
+        // Fail each request so the client stops waiting for it.
+        proto::StreamResponse response;
+        for (const auto& aidlRequest : aidlRequests) {
+            auto& protoResult = *response.mutable_get_value_results()->add_results();
+            protoResult.set_request_id(aidlRequest.requestId);
+            protoResult.set_status(static_cast<proto::StatusCode>(aidlStatus));
+        }
+        writer->Write(response);
+    }
+}
+
+void GrpcVehicleProxyServer::StreamSetValues(const proto::VehiclePropValueRequests& requests,
+                                             std::shared_ptr<StreamResponseWriter> writer) {
+    auto aidlRequests = toAidlSetValueRequests(requests);
+    auto aidlStatus = mHardware->setValues(
+            std::make_shared<const IVehicleHardware::SetValuesCallback>(
+                    [writer](std::vector<aidlvhal::SetValueResult> setValueResults) {
+                        proto::StreamResponse response;
+                        toProtoResults(setValueResults, response.mutable_set_value_results());
+                        writer->Write(response);
+                    }),
+            aidlRequests);
+    if (aidlStatus != aidlvhal::StatusCode::OK) {
+        // Fail each request so the client stops waiting for it.
+        proto::StreamResponse response;
+        for (const auto& aidlRequest : aidlRequests) {
+            auto& protoResult = *response.mutable_set_value_results()->add_results();
+            protoResult.set_request_id(aidlRequest.requestId);
+            protoResult.set_status(static_cast<proto::StatusCode>(aidlStatus));
+        }
+        writer->Write(response);
+    }
+}
+
 void GrpcVehicleProxyServer::OnVehiclePropChange(
         const std::vector<aidlvhal::VehiclePropValue>& values) {
     std::unordered_set<uint64_t> brokenConn;
@@ -266,6 +366,12 @@ GrpcVehicleProxyServer& GrpcVehicleProxyServer::Shutdown() {
     for (auto& conn : mValueStreamingConnections) {
         conn->Shutdown();
     }
+    {
+        std::lock_guard lck(mStreamValuesMutex);
+        for (auto* context : mStreamValuesContexts) {
+            context->TryCancel();
+        }
+    }
     if (mServer) {
         mServer->Shutdown();
     }
@@ -314,4 +420,21 @@ void GrpcVehicleProxyServer::ConnectionDescriptor::Shutdown() {
     mCV->notify_all();
 }
 
+bool GrpcVehicleProxyServer::StreamResponseWriter::Write(const proto::StreamResponse& response) {
+    std::lock_guard lck(mMtx);
+    if (!mStream) {
+        return false;
+    }
+    if (!mStream->Write(response)) {
+        LOG(ERROR) << __func__ << ": Server Write failed, stream lost.";
+        return false;
+    }
+    return true;
+}
+
+void GrpcVehicleProxyServer::StreamResponseWriter::Close() {
+    std::lock_guard lck(mMtx);
+    mStream = nullptr;
+}
+
 }  // namespace android::hardware::automotive::vehicle::virtualization
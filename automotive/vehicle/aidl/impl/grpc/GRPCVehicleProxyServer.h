@@ -28,8 +28,10 @@
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <shared_mutex>
 #include <string>
+#include <unordered_set>
 #include <utility>
 
 namespace android::hardware::automotive::vehicle::virtualization {
@@ -74,6 +76,11 @@ class GrpcVehicleProxyServer : public proto::VehicleServer::Service {
             ::grpc::ServerContext* context, const ::google::protobuf::Empty* request,
             ::grpc::ServerWriter<proto::VehiclePropValues>* stream) override;
 
+    ::grpc::Status StreamValues(
+            ::grpc::ServerContext* context,
+            ::grpc::ServerReaderWriter<proto::StreamResponse, proto::StreamRequest>* stream)
+            override;
+
     GrpcVehicleProxyServer& Start();
 
     GrpcVehicleProxyServer& Shutdown();
@@ -116,6 +123,29 @@ class GrpcVehicleProxyServer : public proto::VehicleServer::Service {
         static std::atomic<uint64_t> connection_id_counter_;
     };
 
+    // Serializes the writes to one StreamValues stream. The hardware callbacks may run after the
+    // RPC returns, so writes after Close() are dropped.
+    class StreamResponseWriter {
+      public:
+        explicit StreamResponseWriter(
+                ::grpc::ServerReaderWriter<proto::StreamResponse, proto::StreamRequest>* stream)
+            : mStream(stream) {}
+
+        bool Write(const proto::StreamResponse& response);
+
+        void Close();
+
+      private:
+        std::mutex mMtx;
+        ::grpc::ServerReaderWriter<proto::StreamResponse, proto::StreamRequest>* mStream;
+    };
+
+    void StreamGetValues(const proto::VehiclePropValueRequests& requests,
+                         std::shared_ptr<StreamResponseWriter> writer);
+
+    void StreamSetValues(const proto::VehiclePropValueRequests& requests,
+                         std::shared_ptr<StreamResponseWriter> writer);
+
     std::string mServiceAddr;
     std::unique_ptr<::grpc::Server> mServer{nullptr};
     std::unique_ptr<IVehicleHardware> mHardware;
@@ -123,6 +153,10 @@ class GrpcVehicleProxyServer : public proto::VehicleServer::Service {
     std::shared_mutex mConnectionMutex;
     std::vector<std::shared_ptr<ConnectionDescriptor>> mValueStreamingConnections;
 
+    // The StreamValues RPCs block in Read until the client leaves, so Shutdown cancels them.
+    std::mutex mStreamValuesMutex;
+    std::unordered_set<::grpc::ServerContext*> mStreamValuesContexts;
+
     static constexpr auto kHardwareOpTimeout = std::chrono::seconds(1);
 };
 
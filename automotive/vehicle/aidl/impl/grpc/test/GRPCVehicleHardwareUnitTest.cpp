@@ -103,6 +103,33 @@ TEST(GRPCVehicleHardwareUnitTest, Reconnect) {
     }
 }
 
+TEST(GRPCVehicleHardwareUnitTest, ValueStreamFallbackToUnary) {
+    // FakeVehicleServer does not implement StreamValues, like a legacy server.
+    auto fakeServer = std::make_unique<FakeVehicleServer>();
+    ::grpc::ServerBuilder builder;
+    builder.RegisterService(fakeServer.get());
+    builder.AddListeningPort(kFakeServerAddr, ::grpc::InsecureServerCredentials());
+    auto grpcServer = builder.BuildAndStart();
+
+    auto vehicleHardware =
+            std::make_unique<GRPCVehicleHardware>(kFakeServerAddr, /*enableValueStream=*/true);
+    EXPECT_TRUE(vehicleHardware->waitForConnected(std::chrono::seconds(5)));
+
+    // The request goes through the unary GetValues RPC and completes synchronously.
+    bool callbackCalled = false;
+    auto status = vehicleHardware->getValues(
+            std::make_shared<const IVehicleHardware::GetValuesCallback>(
+                    [&callbackCalled](const auto&) { callbackCalled = true; }),
+            {{.requestId = 1}});
+
+    EXPECT_EQ(status, aidlvhal::StatusCode::OK);
+    EXPECT_TRUE(callbackCalled);
+
+    vehicleHardware.reset();
+    grpcServer->Shutdown();
+    grpcServer->Wait();
+}
+
 class GRPCVehicleHardwareMockServerUnitTest : public ::testing::Test {
   protected:
     NiceMock<MockVehicleServerStub>* mGrpcStub;
@@ -22,11 +22,15 @@
 #include <grpc++/grpc++.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <utility>
+#include <vector>
 
 namespace android::hardware::automotive::vehicle::virtualization {
 
@@ -34,6 +38,7 @@ namespace aidlvhal = ::aidl::android::hardware::automotive::vehicle;
 
 using ::testing::_;
 using ::testing::DoAll;
+using ::testing::Invoke;
 using ::testing::Return;
 using ::testing::SaveArg;
 
@@ -64,9 +69,36 @@ class VehicleHardwareForTest : public IVehicleHardware {
     aidlvhal::StatusCode getValues(
             std::shared_ptr<const GetValuesCallback> callback,
             const std::vector<aidlvhal::GetValueRequest>& requests) const override {
+        std::lock_guard lck(mPendingGetMutex);
+        for (const auto& request : requests) {
+            mPendingGets.emplace_back(callback, request);
+        }
         return aidlvhal::StatusCode::OK;
     }
 
+    size_t pendingGetCount() const {
+        std::lock_guard lck(mPendingGetMutex);
+        return mPendingGets.size();
+    }
+
+    // Reply to each pending get request separately, latest request first.
+    void replyPendingGetsInReverseOrder() {
+        std::vector<std::pair<std::shared_ptr<const GetValuesCallback>, aidlvhal::GetValueRequest>>
+                pendingGets;
+        {
+            std::lock_guard lck(mPendingGetMutex);
+            pendingGets.swap(mPendingGets);
+        }
+        for (auto it = pendingGets.rbegin(); it != pendingGets.rend(); it++) {
+            const auto& [callback, request] = *it;
+            (*callback)({{
+                    .requestId = request.requestId,
+                    .status = aidlvhal::StatusCode::OK,
+                    .prop = request.prop,
+            }});
+        }
+    }
+
     DumpResult dump(const std::vector<std::string>& options) override { return {}; }
 
     aidlvhal::StatusCode checkHealth() override { return aidlvhal::StatusCode::OK; }
@@ -76,6 +108,10 @@ class VehicleHardwareForTest : public IVehicleHardware {
 
   private:
     std::unique_ptr<const PropertyChangeCallback> mOnProp;
+    mutable std::mutex mPendingGetMutex;
+    mutable std::vector<
+            std::pair<std::shared_ptr<const GetValuesCallback>, aidlvhal::GetValueRequest>>
+            mPendingGets;
 };
 
 class MockVehicleHardware : public IVehicleHardware {
@@ -172,6 +208,134 @@ TEST(GRPCVehicleProxyServerUnitTest, ClientConnectDisconnect) {
     vehicleServer->Shutdown().Wait();
 }
 
+TEST(GRPCVehicleProxyServerUnitTest, StreamGetValuesPipelined) {
+    auto testHardware = std::make_unique<VehicleHardwareForTest>();
+    auto* testHardwareRaw = testHardware.get();
+    auto vehicleServer =
+            std::make_unique<GrpcVehicleProxyServer>(kFakeServerAddr, std::move(testHardware));
+    vehicleServer->Start();
+
+    constexpr auto kWaitForConnectionMaxTime = std::chrono::seconds(5);
+    constexpr auto kWaitForResultsMaxTime = std::chrono::seconds(5);
+    constexpr int64_t kRequestCount = 3;
+
+    auto vehicleHardware =
+            std::make_unique<GRPCVehicleHardware>(kFakeServerAddr, /*enableValueStream=*/true);
+    ASSERT_TRUE(vehicleHardware->waitForConnected(kWaitForConnectionMaxTime));
+
+    std::mutex resultsMutex;
+    std::condition_variable resultsCV;
+    std::vector<std::vector<aidlvhal::GetValueResult>> resultsByCall(kRequestCount);
+    for (int64_t i = 0; i < kRequestCount; i++) {
+        auto status = vehicleHardware->getValues(
+                std::make_shared<const IVehicleHardware::GetValuesCallback>(
+                        [i, &resultsMutex, &resultsCV,
+                         &resultsByCall](std::vector<aidlvhal::GetValueResult> results) {
+                            {
+                                std::lock_guard lck(resultsMutex);
+                                resultsByCall[i] = std::move(results);
+                            }
+                            resultsCV.notify_all();
+                        }),
+                {{.requestId = i, .prop = {.prop = static_cast<int32_t>(i + 100)}}});
+        ASSERT_EQ(status, aidlvhal::StatusCode::OK);
+    }
+
+    // All the requests must reach the hardware before any of them is answered.
+    auto startTime = std::chrono::steady_clock::now();
+    while (testHardwareRaw->pendingGetCount() < kRequestCount &&
+           std::chrono::steady_clock::now() - startTime < kWaitForResultsMaxTime) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(testHardwareRaw->pendingGetCount(), static_cast<size_t>(kRequestCount));
+    testHardwareRaw->replyPendingGetsInReverseOrder();
+
+    {
+        std::unique_lock lck(resultsMutex);
+        ASSERT_TRUE(resultsCV.wait_for(lck, kWaitForResultsMaxTime, [&resultsByCall] {
+            for (const auto& results : resultsByCall) {
+                if (results.empty()) {
+                    return false;
+                }
+            }
+            return true;
+        }));
+        for (int64_t i = 0; i < kRequestCount; i++) {
+            ASSERT_EQ(resultsByCall[i].size(), 1u);
+            EXPECT_EQ(resultsByCall[i][0].requestId, i);
+            EXPECT_EQ(resultsByCall[i][0].status, aidlvhal::StatusCode::OK);
+            ASSERT_TRUE(resultsByCall[i][0].prop.has_value());
+            EXPECT_EQ(resultsByCall[i][0].prop->prop, i + 100);
+        }
+    }
+
+    vehicleHardware.reset();
+    vehicleServer->Shutdown().Wait();
+}
+
+TEST(GRPCVehicleProxyServerUnitTest, StreamSetValues) {
+    auto mockHardware = std::make_unique<MockVehicleHardware>();
+    MockVehicleHardware* mockHardwarePtr = mockHardware.get();
+    auto vehicleServer =
+            std::make_unique<GrpcVehicleProxyServer>(kFakeServerAddr, std::move(mockHardware));
+    vehicleServer->Start();
+
+    EXPECT_CALL(*mockHardwarePtr, setValues(_, _))
+            .WillRepeatedly(Invoke([](std::shared_ptr<const IVehicleHardware::SetValuesCallback>
+                                              callback,
+                                      const std::vector<aidlvhal::SetValueRequest>& requests) {
+                std::vector<aidlvhal::SetValueResult> results;
+                for (const auto& request : requests) {
+                    results.push_back({
+                            .requestId = request.requestId,
+                            .status = request.value.prop == 1 ? aidlvhal::StatusCode::OK
+                                                              : aidlvhal::StatusCode::INVALID_ARG,
+                    });
+                }
+                (*callback)(std::move(results));
+                return aidlvhal::StatusCode::OK;
+            }));
+
+    constexpr auto kWaitForConnectionMaxTime = std::chrono::seconds(5);
+    constexpr auto kWaitForResultsMaxTime = std::chrono::seconds(5);
+
+    auto vehicleHardware =
+            std::make_unique<GRPCVehicleHardware>(kFakeServerAddr, /*enableValueStream=*/true);
+    ASSERT_TRUE(vehicleHardware->waitForConnected(kWaitForConnectionMaxTime));
+
+    std::mutex resultsMutex;
+    std::condition_variable resultsCV;
+    std::vector<aidlvhal::SetValueResult> results;
+    auto status = vehicleHardware->setValues(
+            std::make_shared<const IVehicleHardware::SetValuesCallback>(
+                    [&resultsMutex, &resultsCV,
+                     &results](std::vector<aidlvhal::SetValueResult> setValueResults) {
+                        {
+                            std::lock_guard lck(resultsMutex);
+                            results.insert(results.end(), setValueResults.begin(),
+                                           setValueResults.end());
+                        }
+                        resultsCV.notify_all();
+                    }),
+            {{.requestId = 1, .value = {.prop = 1}}, {.requestId = 2, .value = {.prop = 2}}});
+    ASSERT_EQ(status, aidlvhal::StatusCode::OK);
+
+    {
+        std::unique_lock lck(resultsMutex);
+        ASSERT_TRUE(resultsCV.wait_for(lck, kWaitForResultsMaxTime,
+                                       [&results] { return results.size() == 2; }));
+        std::sort(results.begin(), results.end(),
+                  [](const auto& a, const auto& b) { return a.requestId < b.requestId; });
+        EXPECT_EQ(results[0].requestId, 1);
+        EXPECT_EQ(results[0].status, aidlvhal::StatusCode::OK);
+        EXPECT_EQ(results[1].requestId, 2);
+        EXPECT_EQ(results[1].status, aidlvhal::StatusCode::INVALID_ARG);
+    }
+
+    vehicleHardware.reset();
+    vehicleServer->Shutdown().Wait();
+}
+
 TEST(GRPCVehicleProxyServerUnitTest, Subscribe) {
     auto mockHardware = std::make_unique<MockVehicleHardware>();
     // We make sure this is alive inside the function scope.
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ConcurrentQueue.h>
+#include <VehicleHalTypes.h>
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <thread>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+namespace {
+
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropValue;
+
+constexpr size_t QUEUE_CAPACITY = 4096;
+constexpr auto BATCH_INTERVAL = std::chrono::milliseconds(1);
+
+VehiclePropValue createValue(int64_t i) {
+    VehiclePropValue value;
+    value.timestamp = i;
+    value.prop = static_cast<int32_t>(i % 64);
+    value.value.floatValues = {static_cast<float>(i)};
+    return value;
+}
+
+// Runs a BatchingConsumer draining the queue in the background while the benchmark threads push
+// to it, which is how DefaultVehicleHal uses the queue.
+template <typename QueueType>
+class ConsumerFixture : public benchmark::Fixture {
+  public:
+    void SetUp(::benchmark::State& state) override {
+        if (state.thread_index() != 0) {
+            return;
+        }
+        mQueue = createQueue(static_cast<QueueOverflowPolicy>(state.range(0)));
+        mConsumer = std::make_unique<BatchingConsumer<VehiclePropValue, QueueType>>();
+        mConsumer->run(mQueue.get(), BATCH_INTERVAL, [](std::vector<VehiclePropValue> values) {
+            benchmark::DoNotOptimize(values);
+        });
+    }
+
+    void TearDown(::benchmark::State& state) override {
+        if (state.thread_index() != 0) {
+            return;
+        }
+        mQueue->deactivate();
+        mConsumer->requestStop();
+        mConsumer->waitStopped();
+        mConsumer.reset();
+        mQueue.reset();
+    }
+
+  protected:
+    std::unique_ptr<QueueType> mQueue;
+    std::unique_ptr<BatchingConsumer<VehiclePropValue, QueueType>> mConsumer;
+
+    static std::unique_ptr<QueueType> createQueue(QueueOverflowPolicy policy);
+};
+
+template <>
+std::unique_ptr<ConcurrentQueue<VehiclePropValue>>
+ConsumerFixture<ConcurrentQueue<VehiclePropValue>>::createQueue(QueueOverflowPolicy) {
+    return std::make_unique<ConcurrentQueue<VehiclePropValue>>();
+}
+
+template <>
+std::unique_ptr<ConcurrentRingQueue<VehiclePropValue>>
+ConsumerFixture<ConcurrentRingQueue<VehiclePropValue>>::createQueue(QueueOverflowPolicy policy) {
+    return std::make_unique<ConcurrentRingQueue<VehiclePropValue>>(
+            QUEUE_CAPACITY, policy,
+            [](const VehiclePropValue& value) { return static_cast<int64_t>(value.prop); });
+}
+
+template <typename QueueType>
+void pushValues(QueueType* queue, benchmark::State& state) {
+    int64_t i = 0;
+    for (auto _ : state) {
+        queue->push(createValue(i));
+        i++;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+}  // namespace
+
+BENCHMARK_TEMPLATE_DEFINE_F(ConsumerFixture, BM_ConcurrentQueuePush,
+                            ConcurrentQueue<VehiclePropValue>)
+(benchmark::State& state) {
+    pushValues(mQueue.get(), state);
+}
+// The policy argument is ignored for the unbounded queue.
+BENCHMARK_REGISTER_F(ConsumerFixture, BM_ConcurrentQueuePush)
+        ->Arg(0)
+        ->ThreadRange(1, 8)
+        ->UseRealTime();
+
+BENCHMARK_TEMPLATE_DEFINE_F(ConsumerFixture, BM_ConcurrentRingQueuePush,
+                            ConcurrentRingQueue<VehiclePropValue>)
+(benchmark::State& state) {
+    pushValues(mQueue.get(), state);
+}
+BENCHMARK_REGISTER_F(ConsumerFixture, BM_ConcurrentRingQueuePush)
+        ->Arg(static_cast<int64_t>(QueueOverflowPolicy::DROP_OLDEST))
+        ->Arg(static_cast<int64_t>(QueueOverflowPolicy::BLOCK))
+        ->Arg(static_cast<int64_t>(QueueOverflowPolicy::COALESCE_BY_KEY))
+        ->ThreadRange(1, 8)
+        ->UseRealTime();
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <VehicleHalTypes.h>
+#include <VehicleObjectPool.h>
+#include <benchmark/benchmark.h>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+namespace {
+
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropertyType;
+
+VehiclePropValuePool* getValuePool() {
+    static VehiclePropValuePool valuePool;
+    return &valuePool;
+}
+
+}  // namespace
+
+// Every thread obtains and releases values of mixed types and vector sizes, which is what the
+// property store and the hardware event path do. The hit rate is reported as a counter.
+static void BM_ObtainRecycle(benchmark::State& state) {
+    VehiclePropValuePool* valuePool = getValuePool();
+    size_t i = 0;
+
+    for (auto _ : state) {
+        auto value = (i % 3 == 0) ? valuePool->obtainFloat(static_cast<float>(i))
+                                  : valuePool->obtain(VehiclePropertyType::INT32_VEC, i % 4 + 1);
+        benchmark::DoNotOptimize(value);
+        i++;
+    }
+
+    if (state.thread_index() == 0) {
+        state.counters["hit_rate"] = getValuePool()->getStats().getHitRate();
+    }
+}
+BENCHMARK(BM_ObtainRecycle)->ThreadRange(1, 16)->UseRealTime();
+
+// Each thread holds a batch of values before releasing them, so values move between the thread
+// caches and the shared free list.
+static void BM_ObtainRecycleBatch(benchmark::State& state) {
+    VehiclePropValuePool* valuePool = getValuePool();
+    std::vector<VehiclePropValuePool::RecyclableType> values;
+    values.reserve(64);
+
+    for (auto _ : state) {
+        for (size_t i = 0; i < 64; i++) {
+            values.push_back(valuePool->obtain(VehiclePropertyType::INT32));
+        }
+        values.clear();
+    }
+    state.SetItemsProcessed(state.iterations() * 64);
+}
+BENCHMARK(BM_ObtainRecycleBatch)->ThreadRange(1, 16)->UseRealTime();
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
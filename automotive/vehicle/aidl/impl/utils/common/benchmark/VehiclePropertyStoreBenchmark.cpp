@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <VehicleHalTypes.h>
+#include <VehiclePropertyStore.h>
+#include <VehicleUtils.h>
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+namespace {
+
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropConfig;
+using ::aidl::android::hardware::automotive::vehicle::VehicleProperty;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropertyAccess;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropertyChangeMode;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropValue;
+
+// The continuous properties that are written by the writer thread, modelling a speed/RPM feed.
+const int32_t kWrittenPropIds[] = {
+        toInt(VehicleProperty::PERF_VEHICLE_SPEED),
+        toInt(VehicleProperty::ENGINE_RPM),
+};
+
+// The properties that are only read, modelling car services calling getValues.
+const int32_t kReadPropIds[] = {
+        toInt(VehicleProperty::PERF_VEHICLE_SPEED), toInt(VehicleProperty::ENGINE_RPM),
+        toInt(VehicleProperty::INFO_FUEL_CAPACITY), toInt(VehicleProperty::FUEL_LEVEL),
+        toInt(VehicleProperty::GEAR_SELECTION),     toInt(VehicleProperty::NIGHT_MODE),
+};
+
+std::unique_ptr<VehiclePropertyStore> createStore(VehiclePropertyStore::StoreMode storeMode) {
+    auto valuePool = std::make_shared<VehiclePropValuePool>();
+    auto store = std::make_unique<VehiclePropertyStore>(valuePool, storeMode);
+    for (int32_t propId : kReadPropIds) {
+        store->registerProperty(VehiclePropConfig{
+                .prop = propId,
+                .access = VehiclePropertyAccess::READ,
+                .changeMode = VehiclePropertyChangeMode::ON_CHANGE,
+        });
+        VehiclePropValue value = {
+                .prop = propId,
+                .value = {.floatValues = {0.0f}},
+        };
+        store->writeValue(valuePool->obtain(value));
+    }
+    return store;
+}
+
+VehiclePropertyStore* getStore(VehiclePropertyStore::StoreMode storeMode) {
+    static auto globalLockStore = createStore(VehiclePropertyStore::StoreMode::GLOBAL_LOCK);
+    static auto shardedStore = createStore(VehiclePropertyStore::StoreMode::SHARDED);
+    return storeMode == VehiclePropertyStore::StoreMode::SHARDED ? shardedStore.get()
+                                                                 : globalLockStore.get();
+}
+
+}  // namespace
+
+// Thread 0 keeps writing the continuous properties and refreshing their timestamps, all the other
+// threads read. The reported reads per second are the aggregate over all reader threads.
+static void BM_ReadWriteContention(benchmark::State& state) {
+    auto storeMode = static_cast<VehiclePropertyStore::StoreMode>(state.range(0));
+    VehiclePropertyStore* store = getStore(storeMode);
+    std::shared_ptr<VehiclePropValuePool> valuePool = store->getValuePool();
+    bool isWriter = state.thread_index() == 0;
+    size_t i = 0;
+    int64_t readCount = 0;
+    int64_t writeCount = 0;
+
+    for (auto _ : state) {
+        if (isWriter) {
+            int32_t propId = kWrittenPropIds[i % std::size(kWrittenPropIds)];
+            auto value = valuePool->obtainFloat(static_cast<float>(i));
+            value->prop = propId;
+            store->writeValue(std::move(value), /*updateStatus=*/false,
+                              VehiclePropertyStore::EventMode::NEVER,
+                              /*useCurrentTimestamp=*/true);
+            writeCount++;
+        } else {
+            auto result = store->readValue(kReadPropIds[i % std::size(kReadPropIds)]);
+            benchmark::DoNotOptimize(result);
+            readCount++;
+        }
+        i++;
+    }
+
+    state.counters["reads"] = benchmark::Counter(readCount, benchmark::Counter::kIsRate);
+    state.counters["writes"] = benchmark::Counter(writeCount, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_ReadWriteContention)
+        ->Arg(static_cast<int64_t>(VehiclePropertyStore::StoreMode::GLOBAL_LOCK))
+        ->Arg(static_cast<int64_t>(VehiclePropertyStore::StoreMode::SHARDED))
+        ->ThreadRange(2, 16)
+        ->UseRealTime();
+
+// Single-threaded read cost, to make sure the sharded store does not regress the uncontended case.
+static void BM_ReadUncontended(benchmark::State& state) {
+    auto storeMode = static_cast<VehiclePropertyStore::StoreMode>(state.range(0));
+    VehiclePropertyStore* store = getStore(storeMode);
+    size_t i = 0;
+
+    for (auto _ : state) {
+        auto result = store->readValue(kReadPropIds[i % std::size(kReadPropIds)]);
+        benchmark::DoNotOptimize(result);
+        i++;
+    }
+}
+BENCHMARK(BM_ReadUncontended)
+        ->Arg(static_cast<int64_t>(VehiclePropertyStore::StoreMode::GLOBAL_LOCK))
+        ->Arg(static_cast<int64_t>(VehiclePropertyStore::StoreMode::SHARDED));
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+BENCHMARK_MAIN();
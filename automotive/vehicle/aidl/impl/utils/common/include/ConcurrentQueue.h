@@ -21,9 +21,14 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <queue>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 
 namespace android {
 namespace hardware {
@@ -105,7 +110,312 @@ class ConcurrentQueue {
     std::queue<T> mQueue GUARDED_BY(mLock);
 };
 
+// The policy when pushing an item to a full ConcurrentRingQueue.
+enum class QueueOverflowPolicy {
+    // Drops the oldest item in the queue to make room for the new item.
+    DROP_OLDEST = 0,
+    // Blocks the producer until the consumer flushes the queue or the queue is deactivated.
+    BLOCK = 1,
+    // Keeps the overflowing items in a side table that only holds the latest item for each key.
+    // The side table is flushed after the items in the ring.
+    COALESCE_BY_KEY = 2,
+};
+
+// A bounded multi-producer single-consumer queue with the same interface as ConcurrentQueue.
+//
+// Pushing is lock-free: the items are stored in a fixed size ring where each slot carries a
+// sequence number, so producers only need one CAS to claim a slot. The mutex is only taken to
+// wake up a waiting consumer, to block producers for the BLOCK policy, or to access the side
+// table for the COALESCE_BY_KEY policy.
+//
+// Only one thread may call waitForItems and flush. With DROP_OLDEST, producers also remove items
+// from the ring, which is safe since removing an item also takes a CAS.
+//
+// T must be default constructible and movable.
 template <typename T>
+class ConcurrentRingQueue {
+  public:
+    using GetKeyFunc = std::function<int64_t(const T&)>;
+
+    // The capacity is rounded up to a power of two, and is at least 2. 'getKey' is required for
+    // COALESCE_BY_KEY.
+    ConcurrentRingQueue(size_t capacity, QueueOverflowPolicy policy, GetKeyFunc getKey = nullptr)
+        : mPolicy(policy),
+          mGetKey(std::move(getKey)),
+          mMask(roundUpToPowerOfTwo(capacity) - 1),
+          mCells(new Cell[mMask + 1]) {
+        for (size_t i = 0; i <= mMask; i++) {
+            mCells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ConcurrentRingQueue(const ConcurrentRingQueue&) = delete;
+    ConcurrentRingQueue& operator=(const ConcurrentRingQueue&) = delete;
+
+    bool waitForItems() {
+        std::unique_lock<std::mutex> lockGuard(mLock);
+        android::base::ScopedLockAssertion lockAssertion(mLock);
+        // Both this and the slot sequence are sequentially consistent, so either we see the new
+        // item or the producer sees mConsumerWaiting and notifies us.
+        mConsumerWaiting.store(true);
+        while (!hasItems() && mIsActive.load()) {
+            mCond.wait(lockGuard);
+        }
+        mConsumerWaiting.store(false);
+        return mIsActive.load();
+    }
+
+    std::vector<T> flush() {
+        std::vector<T> items;
+        T item;
+        // Even if the queue is deactivated, we should still flush all the remaining values in
+        // the queue.
+        while (tryPop(&item)) {
+            items.push_back(std::move(item));
+        }
+        if (mPolicy == QueueOverflowPolicy::COALESCE_BY_KEY && mHasOverflow.load()) {
+            std::scoped_lock<std::mutex> lockGuard(mOverflowLock);
+            // Items pushed to the ring before the side table was used must come first.
+            while (tryPop(&item)) {
+                items.push_back(std::move(item));
+            }
+            for (T& overflowItem : mOverflowItems) {
+                items.push_back(std::move(overflowItem));
+            }
+            mOverflowItems.clear();
+            mOverflowIndexByKey.clear();
+            mHasOverflow.store(false);
+        }
+        if (!items.empty()) {
+            notifyProducers();
+        }
+        return items;
+    }
+
+    void push(T&& item) {
+        if (!mIsActive.load()) {
+            return;
+        }
+        pushInternal(item);
+        notifyConsumer();
+    }
+
+    void push(std::vector<T>&& items) {
+        if (!mIsActive.load()) {
+            return;
+        }
+        for (T& item : items) {
+            pushInternal(item);
+        }
+        notifyConsumer();
+    }
+
+    // Deactivates the queue, thus no one can push items to it, also notifies all waiting threads,
+    // including the producers blocked by the BLOCK policy.
+    // The items already in the queue could still be flushed even after the queue is deactivated.
+    void deactivate() {
+        mIsActive.store(false);
+        {
+            // Makes sure the waiting threads either see the change or are already waiting.
+            std::scoped_lock<std::mutex> lockGuard(mLock);
+        }
+        mCond.notify_all();
+        mNotFullCond.notify_all();
+    }
+
+    size_t getCapacity() const { return mMask + 1; }
+
+    // The number of items dropped by the DROP_OLDEST policy.
+    uint64_t getDroppedCount() const { return mDroppedCount.load(std::memory_order_relaxed); }
+
+    // The number of items replaced by a newer item with the same key by the COALESCE_BY_KEY
+    // policy.
+    uint64_t getCoalescedCount() const { return mCoalescedCount.load(std::memory_order_relaxed); }
+
+  private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    const QueueOverflowPolicy mPolicy;
+    const GetKeyFunc mGetKey;
+    const size_t mMask;
+    const std::unique_ptr<Cell[]> mCells;
+
+    // Keeps the producer and consumer positions in different cache lines.
+    alignas(64) std::atomic<size_t> mEnqueuePos = 0;
+    alignas(64) std::atomic<size_t> mDequeuePos = 0;
+
+    std::atomic<bool> mIsActive = true;
+    std::atomic<bool> mConsumerWaiting = false;
+    std::atomic<size_t> mBlockedProducerCount = 0;
+    std::atomic<uint64_t> mDroppedCount = 0;
+    std::atomic<uint64_t> mCoalescedCount = 0;
+
+    // Only used to wait and notify, the ring is not guarded by it.
+    std::mutex mLock;
+    std::condition_variable mCond;
+    std::condition_variable mNotFullCond;
+
+    // Whether the side table is not empty. Once it is set, producers push to the side table until
+    // the consumer flushes it, so that the items from one producer are not reordered.
+    std::atomic<bool> mHasOverflow = false;
+    std::mutex mOverflowLock;
+    std::vector<T> mOverflowItems GUARDED_BY(mOverflowLock);
+    std::unordered_map<int64_t, size_t> mOverflowIndexByKey GUARDED_BY(mOverflowLock);
+
+    static size_t roundUpToPowerOfTwo(size_t value) {
+        // With one slot, a published item would have the same sequence as a free slot of the next
+        // lap.
+        size_t result = 2;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    // Moves 'item' into the ring if there is a free slot, 'item' is not touched otherwise.
+    bool tryPush(T& item) {
+        size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &mCells[pos & mMask];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                // The slot still holds the item from the last lap, the ring is full.
+                return false;
+            } else {
+                pos = mEnqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::move(item);
+        // Sequentially consistent to pair with mConsumerWaiting, see waitForItems.
+        cell->sequence.store(pos + 1);
+        return true;
+    }
+
+    bool tryPop(T* item) {
+        size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &mCells[pos & mMask];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (mDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                // The slot is not published yet, the ring is empty.
+                return false;
+            } else {
+                pos = mDequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+        *item = std::move(cell->data);
+        // Sequentially consistent to pair with mBlockedProducerCount, see pushBlock.
+        cell->sequence.store(pos + mMask + 1);
+        return true;
+    }
+
+    bool ringHasItems() const {
+        size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+        return mCells[pos & mMask].sequence.load() == pos + 1;
+    }
+
+    bool ringIsFull() const {
+        size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+        return mCells[pos & mMask].sequence.load() != pos;
+    }
+
+    bool hasItems() const { return ringHasItems() || mHasOverflow.load(); }
+
+    void pushInternal(T& item) {
+        switch (mPolicy) {
+            case QueueOverflowPolicy::DROP_OLDEST:
+                pushDropOldest(item);
+                return;
+            case QueueOverflowPolicy::BLOCK:
+                pushBlock(item);
+                return;
+            case QueueOverflowPolicy::COALESCE_BY_KEY:
+                pushCoalesce(item);
+                return;
+        }
+    }
+
+    void pushDropOldest(T& item) {
+        T dropped;
+        while (!tryPush(item)) {
+            if (tryPop(&dropped)) {
+                mDroppedCount.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void pushBlock(T& item) {
+        while (!tryPush(item)) {
+            std::unique_lock<std::mutex> lockGuard(mLock);
+            android::base::ScopedLockAssertion lockAssertion(mLock);
+            // Either we see the slot freed by the consumer or the consumer sees the count and
+            // notifies us.
+            mBlockedProducerCount.fetch_add(1);
+            mNotFullCond.wait(lockGuard, [this] { return !ringIsFull() || !mIsActive.load(); });
+            mBlockedProducerCount.fetch_sub(1);
+            if (!mIsActive.load()) {
+                return;
+            }
+        }
+    }
+
+    void pushCoalesce(T& item) {
+        if (!mHasOverflow.load() && tryPush(item)) {
+            return;
+        }
+        std::scoped_lock<std::mutex> lockGuard(mOverflowLock);
+        int64_t key = mGetKey(item);
+        if (auto it = mOverflowIndexByKey.find(key); it != mOverflowIndexByKey.end()) {
+            mOverflowItems[it->second] = std::move(item);
+            mCoalescedCount.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        mOverflowIndexByKey[key] = mOverflowItems.size();
+        mOverflowItems.push_back(std::move(item));
+        mHasOverflow.store(true);
+    }
+
+    void notifyConsumer() {
+        if (!mConsumerWaiting.load()) {
+            return;
+        }
+        {
+            // The consumer holds the lock until it waits, so the notification is not lost.
+            std::scoped_lock<std::mutex> lockGuard(mLock);
+        }
+        mCond.notify_one();
+    }
+
+    void notifyProducers() {
+        if (mPolicy != QueueOverflowPolicy::BLOCK) {
+            return;
+        }
+        if (mBlockedProducerCount.load() == 0) {
+            return;
+        }
+        {
+            std::scoped_lock<std::mutex> lockGuard(mLock);
+        }
+        mNotFullCond.notify_all();
+    }
+};
+
+template <typename T, typename QueueType = ConcurrentQueue<T>>
 class BatchingConsumer {
   private:
     enum class State {
@@ -123,12 +433,12 @@ class BatchingConsumer {
 
     using OnBatchReceivedFunc = std::function<void(std::vector<T> vec)>;
 
-    void run(ConcurrentQueue<T>* queue, std::chrono::nanoseconds batchInterval,
+    void run(QueueType* queue, std::chrono::nanoseconds batchInterval,
              const OnBatchReceivedFunc& func) {
         mQueue = queue;
         mBatchInterval = batchInterval;
 
-        mWorkerThread = std::thread(&BatchingConsumer<T>::runInternal, this, func);
+        mWorkerThread = std::thread(&BatchingConsumer::runInternal, this, func);
     }
 
     void requestStop() { mState = State::STOP_REQUESTED; }
@@ -165,7 +475,7 @@ class BatchingConsumer {
 
     std::atomic<State> mState;
     std::chrono::nanoseconds mBatchInterval;
-    ConcurrentQueue<T>* mQueue;
+    QueueType* mQueue;
 };
 
 }  // namespace vehicle
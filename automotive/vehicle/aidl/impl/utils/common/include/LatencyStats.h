@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef android_hardware_automotive_vehicle_aidl_impl_utils_common_include_LatencyStats_H_
+#define android_hardware_automotive_vehicle_aidl_impl_utils_common_include_LatencyStats_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+// A lock-free latency histogram.
+//
+// Samples are counted in power-of-two buckets of microseconds: bucket 0 counts samples below
+// 2us, bucket i counts samples in [2^i, 2^(i+1)) us and the last bucket counts everything above.
+// Recording a sample is a few relaxed atomic operations, so it could be called on hot paths from
+// any thread.
+class LatencyHistogram final {
+  public:
+    static constexpr size_t NUM_BUCKETS = 24;
+
+    struct Snapshot {
+        std::array<uint64_t, NUM_BUCKETS> buckets = {};
+        uint64_t count = 0;
+        uint64_t totalInNanos = 0;
+        uint64_t maxInNanos = 0;
+
+        // Gets the upper bound of the bucket containing the 'percentile' (0-100) sample.
+        uint64_t getPercentileInNanos(double percentile) const;
+    };
+
+    void record(int64_t latencyInNanos);
+
+    // The returned snapshot is not atomic as a whole, samples recorded concurrently might only
+    // be partially included.
+    Snapshot getSnapshot() const;
+
+    void reset();
+
+    static size_t getBucketIndex(int64_t latencyInNanos);
+
+  private:
+    std::array<std::atomic<uint64_t>, NUM_BUCKETS> mBuckets = {};
+    std::atomic<uint64_t> mTotalInNanos = 0;
+    std::atomic<uint64_t> mMaxInNanos = 0;
+};
+
+// Lock-free per-property, per-operation latency statistics for the VHAL hot paths.
+//
+// The per-property histograms are created the first time a property is recorded and live until
+// this object is destroyed, reset only clears the counters. Properties are kept in a fixed size
+// open addressing table, if the table is full the samples are counted in an overflow entry with
+// property ID 0.
+class PropertyLatencyStats final {
+  public:
+    enum class Operation : size_t {
+        // From receiving getValues to the result being delivered to the client.
+        GET_VALUES = 0,
+        // From receiving setValues to the result being delivered to the client.
+        SET_VALUES,
+        // From the hardware property change callback to the event being delivered to all the
+        // subscribed clients.
+        EVENT_DELIVERY,
+        NUM_OPERATIONS,
+    };
+    static constexpr size_t NUM_OPERATIONS = static_cast<size_t>(Operation::NUM_OPERATIONS);
+    static constexpr size_t MAX_PROPERTIES = 1024;
+
+    struct PropertySnapshot {
+        int32_t propId = 0;
+        std::array<LatencyHistogram::Snapshot, NUM_OPERATIONS> histograms = {};
+    };
+
+    PropertyLatencyStats();
+
+    ~PropertyLatencyStats();
+
+    void record(int32_t propId, Operation operation, int64_t latencyInNanos);
+
+    // Records pending getValues/setValues requests that timed out. The pending request pool only
+    // knows the request IDs, so timeouts are counted per operation.
+    void recordTimeouts(Operation operation, size_t count);
+
+    uint64_t getTimeoutCount(Operation operation) const;
+
+    // Gets the snapshots of all the recorded properties, ordered by property ID.
+    std::vector<PropertySnapshot> getSnapshots() const;
+
+    // Clears all the recorded samples. Samples recorded concurrently might be kept.
+    void reset();
+
+    // Dumps the statistics into a human readable string.
+    std::string dump() const;
+
+    static const char* toString(Operation operation);
+
+  private:
+    struct PropertyEntry {
+        explicit PropertyEntry(int32_t propId) : propId(propId) {}
+
+        const int32_t propId;
+        std::array<LatencyHistogram, NUM_OPERATIONS> histograms;
+    };
+
+    // Each slot is set at most once, from nullptr to an entry owned by this object.
+    std::array<std::atomic<PropertyEntry*>, MAX_PROPERTIES> mEntries = {};
+    PropertyEntry mOverflowEntry{0};
+    std::array<std::atomic<uint64_t>, NUM_OPERATIONS> mTimeoutCounts = {};
+
+    PropertyEntry* getOrCreateEntry(int32_t propId);
+};
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif  // android_hardware_automotive_vehicle_aidl_impl_utils_common_include_LatencyStats_H_
@@ -17,6 +17,8 @@
 #ifndef android_hardware_automotive_vehicle_aidl_impl_vhal_include_RecurrentTimer_H_
 #define android_hardware_automotive_vehicle_aidl_impl_vhal_include_RecurrentTimer_H_
 
+#include "TimerWheel.h"
+
 #include <android-base/thread_annotations.h>
 
 #include <utils/Looper.h>
@@ -24,6 +26,7 @@
 #include <memory>
 #include <mutex>
 #include <queue>
+#include <string>
 #include <thread>
 #include <unordered_map>
 #include <vector>
@@ -37,12 +40,28 @@ namespace vehicle {
 class RecurrentMessageHandler;
 
 // A thread-safe recurrent timer.
+//
+// All the registered callbacks are kept in one timer wheel and the timer thread only wakes up for
+// the earliest one. Callbacks that are due at the same time, or within the slack window after a
+// wakeup, are called together during that wakeup.
 class RecurrentTimer final {
   public:
     // The class for the function that would be called recurrently.
     using Callback = std::function<void()>;
 
-    RecurrentTimer();
+    struct Stats {
+        // The number of times the timer thread woke up to call callbacks.
+        int64_t wakeupCount = 0;
+        // The number of callbacks called.
+        int64_t callbackCount = 0;
+        // The max and total difference between the time a callback is called and its due time.
+        int64_t maxJitterInNanos = 0;
+        int64_t totalJitterInNanos = 0;
+    };
+
+    // Callbacks that are due within 'slackInNanos' after a wakeup are called in that wakeup,
+    // which might be earlier than their due time.
+    explicit RecurrentTimer(int64_t slackInNanos = 0);
 
     ~RecurrentTimer();
 
@@ -53,6 +72,12 @@ class RecurrentTimer final {
     // Unregisters a previously registered recurrent callback.
     void unregisterTimerCallback(std::shared_ptr<Callback> callback);
 
+    // Gets the wakeup and jitter statistics since the timer is created.
+    Stats getStats() const;
+
+    // Dumps the statistics into a human readable string.
+    std::string dump() const;
+
   private:
     friend class RecurrentMessageHandler;
 
@@ -65,18 +90,31 @@ class RecurrentTimer final {
         int64_t nextTimeInNanos;
     };
 
+    // The resolution for the timer wheel.
+    static constexpr int64_t TICK_IN_NANOS = 1'000'000;
+    static constexpr int64_t NO_WAKEUP = -1;
+
+    const int64_t mSlackInNanos;
+
     android::sp<Looper> mLooper;
     android::sp<RecurrentMessageHandler> mHandler;
 
     std::atomic<bool> mStopRequested = false;
     std::atomic<int> mCallbackId = 0;
-    std::mutex mLock;
+    mutable std::mutex mLock;
     std::thread mThread;
     std::unordered_map<std::shared_ptr<Callback>, int> mIdByCallback GUARDED_BY(mLock);
     std::unordered_map<int, std::unique_ptr<CallbackInfo>> mCallbackInfoById GUARDED_BY(mLock);
+    // Keeps the next due time for every callback ID.
+    TimerWheel mTimerWheel GUARDED_BY(mLock);
+    // The time for the pending wakeup message, or NO_WAKEUP if there is none.
+    int64_t mNextWakeupTimeInNanos GUARDED_BY(mLock) = NO_WAKEUP;
+    Stats mStats GUARDED_BY(mLock);
 
     void handleMessage(const android::Message& message) EXCLUDES(mLock);
     int getCallbackIdLocked(std::shared_ptr<Callback> callback) REQUIRES(mLock);
+    // Makes sure the pending wakeup message is for the earliest due time in the timer wheel.
+    void scheduleWakeupLocked() REQUIRES(mLock);
 };
 
 class RecurrentMessageHandler final : public android::MessageHandler {
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef android_hardware_automotive_vehicle_aidl_impl_utils_common_include_TimerWheel_H_
+#define android_hardware_automotive_vehicle_aidl_impl_utils_common_include_TimerWheel_H_
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+// A hierarchical timer wheel that keeps one-shot timers identified by an integer ID.
+//
+// Time is divided into ticks. The first level has one slot per tick for the next 256 ticks, each
+// following level has 64 slots that each cover all the slots of the previous level. Timers further
+// in the future than the last level are kept in an overflow list. Timers are moved to a lower
+// level when the wheel advances into their slot, so scheduling, cancelling and expiring a timer are
+// all O(1) amortized regardless of the number of timers.
+//
+// This class is not thread-safe.
+class TimerWheel final {
+  public:
+    // 'tickInNanos' is the resolution of the wheel, timers due within the same tick expire
+    // together. 'startTimeInNanos' is the current time.
+    TimerWheel(int64_t tickInNanos, int64_t startTimeInNanos);
+
+    // Schedules a timer. If a timer with the same ID already exists, it is rescheduled. If the due
+    // time is already passed, the timer expires on the next {@code advance}.
+    void schedule(int32_t id, int64_t dueTimeInNanos);
+
+    // Cancels a timer. Returns false if the timer does not exist.
+    bool cancel(int32_t id);
+
+    // Advances the wheel to 'timeInNanos' and returns the IDs of all timers due at or before that
+    // time. The returned timers are removed from the wheel.
+    std::vector<int32_t> advance(int64_t timeInNanos);
+
+    // Returns the earliest due time for all the timers, or std::nullopt if there is no timer.
+    std::optional<int64_t> getNextDueTime() const;
+
+    // Returns the number of timers.
+    size_t size() const;
+
+  private:
+    static constexpr size_t LEVEL_COUNT = 3;
+    static constexpr int LEVEL_BITS[LEVEL_COUNT] = {8, 6, 6};
+    static constexpr size_t MAX_SLOT_COUNT = 1 << 8;
+    // Used as the level for timers in the overflow list.
+    static constexpr size_t OVERFLOW_LEVEL = LEVEL_COUNT;
+
+    struct Timer {
+        int32_t id;
+        int64_t dueTimeInNanos;
+        int64_t dueTick;
+    };
+
+    struct Location {
+        size_t level;
+        size_t slot;
+    };
+
+    using Slot = std::vector<Timer>;
+
+    const int64_t mTickInNanos;
+    // The next tick that has not been expired yet.
+    int64_t mCurrentTick;
+    std::array<std::array<Slot, MAX_SLOT_COUNT>, LEVEL_COUNT> mLevels;
+    Slot mOverflow;
+    std::unordered_map<int32_t, Location> mLocationById;
+
+    static int shiftForLevel(size_t level);
+    static size_t slotCountForLevel(size_t level);
+
+    void insert(const Timer& timer);
+    Slot& getSlot(const Location& location);
+    // Moves all the timers in the slot for the current tick at 'level' to lower levels.
+    void cascade(size_t level);
+};
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif  // android_hardware_automotive_vehicle_aidl_impl_utils_common_include_TimerWheel_H_
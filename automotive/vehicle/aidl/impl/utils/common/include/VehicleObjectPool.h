@@ -17,10 +17,15 @@
 #ifndef android_hardware_automotive_vehicle_utils_include_VehicleObjectPool_H_
 #define android_hardware_automotive_vehicle_utils_include_VehicleObjectPool_H_
 
-#include <deque>
-#include <map>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <VehicleHalTypes.h>
 
@@ -46,6 +51,40 @@ struct PoolStats {
     }
 };
 
+// Counters for one object pool, or the sum for a group of pools.
+struct ObjectPoolStats {
+    // The number of objects obtained from the pool.
+    uint64_t obtainedCount = 0;
+    // The number of obtained objects that were taken from the calling thread's cache.
+    uint64_t threadCacheHitCount = 0;
+    // The number of obtained objects that were taken from the shared free list.
+    uint64_t freeListHitCount = 0;
+    // The number of objects returned to the pool.
+    uint64_t recycledCount = 0;
+    // The number of objects deleted instead of returned to the pool because the pool is full.
+    uint64_t deletedCount = 0;
+    // The approximate memory held by the objects in the pool, in bytes.
+    size_t pooledObjectsSize = 0;
+
+    // The ratio of obtained objects that did not need to be created.
+    double getHitRate() const {
+        return obtainedCount == 0
+                       ? 0.
+                       : static_cast<double>(threadCacheHitCount + freeListHitCount) /
+                                 obtainedCount;
+    }
+
+    ObjectPoolStats& operator+=(const ObjectPoolStats& other) {
+        obtainedCount += other.obtainedCount;
+        threadCacheHitCount += other.threadCacheHitCount;
+        freeListHitCount += other.freeListHitCount;
+        recycledCount += other.recycledCount;
+        deletedCount += other.deletedCount;
+        pooledObjectsSize += other.pooledObjectsSize;
+        return *this;
+    }
+};
+
 template <typename T>
 struct Deleter {
     using OnDeleteFunc = std::function<void(T*)>;
@@ -66,8 +105,108 @@ struct Deleter {
 template <typename T>
 using recyclable_ptr = typename std::unique_ptr<T, Deleter<T>>;
 
+// A bounded lock-free LIFO list of object pointers.
+//
+// The list has a fixed number of nodes allocated up front. Nodes are linked by index and the list
+// heads carry a tag that changes on every update, so a node that is popped and pushed back
+// between a load and a compare-exchange does not corrupt the list (the ABA problem).
+//
+// This class is thread-safe.
+template <typename T>
+class LockFreeFreeList final {
+  public:
+    explicit LockFreeFreeList(size_t capacity)
+        : mCapacity(static_cast<uint32_t>(std::min<size_t>(capacity, NIL))),
+          mNodes(new Node[mCapacity]) {
+        for (uint32_t i = 0; i < mCapacity; i++) {
+            mNodes[i].next.store(i + 1 < mCapacity ? i + 1 : NIL, std::memory_order_relaxed);
+        }
+        mEmptyHead.store(pack(mCapacity == 0 ? NIL : 0, 0), std::memory_order_relaxed);
+        mFullHead.store(pack(NIL, 0), std::memory_order_relaxed);
+    }
+
+    // Pushes an object. Returns false if the list is full.
+    bool push(T* object) {
+        uint32_t index = popNode(mEmptyHead);
+        if (index == NIL) {
+            return false;
+        }
+        mNodes[index].object = object;
+        pushNode(mFullHead, index);
+        return true;
+    }
+
+    // Pops the last pushed object. Returns nullptr if the list is empty.
+    T* pop() {
+        uint32_t index = popNode(mFullHead);
+        if (index == NIL) {
+            return nullptr;
+        }
+        T* object = mNodes[index].object;
+        mNodes[index].object = nullptr;
+        pushNode(mEmptyHead, index);
+        return object;
+    }
+
+    LockFreeFreeList(const LockFreeFreeList&) = delete;
+    LockFreeFreeList& operator=(const LockFreeFreeList&) = delete;
+
+  private:
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    struct Node {
+        // Only accessed by the thread that owns the node after popping it.
+        T* object = nullptr;
+        std::atomic<uint32_t> next{NIL};
+    };
+
+    static uint64_t pack(uint32_t index, uint32_t tag) {
+        return (static_cast<uint64_t>(tag) << 32) | index;
+    }
+    static uint32_t indexOf(uint64_t head) { return static_cast<uint32_t>(head); }
+    static uint32_t tagOf(uint64_t head) { return static_cast<uint32_t>(head >> 32); }
+
+    uint32_t popNode(std::atomic<uint64_t>& head) {
+        uint64_t oldHead = head.load(std::memory_order_acquire);
+        while (true) {
+            uint32_t index = indexOf(oldHead);
+            if (index == NIL) {
+                return NIL;
+            }
+            uint64_t newHead =
+                    pack(mNodes[index].next.load(std::memory_order_relaxed), tagOf(oldHead) + 1);
+            if (head.compare_exchange_weak(oldHead, newHead, std::memory_order_acq_rel,
+                                           std::memory_order_acquire)) {
+                return index;
+            }
+        }
+    }
+
+    void pushNode(std::atomic<uint64_t>& head, uint32_t index) {
+        uint64_t oldHead = head.load(std::memory_order_relaxed);
+        uint64_t newHead;
+        do {
+            mNodes[index].next.store(indexOf(oldHead), std::memory_order_relaxed);
+            newHead = pack(index, tagOf(oldHead) + 1);
+        } while (!head.compare_exchange_weak(oldHead, newHead, std::memory_order_release,
+                                             std::memory_order_relaxed));
+    }
+
+    const uint32_t mCapacity;
+    std::unique_ptr<Node[]> mNodes;
+    // The list of nodes holding objects.
+    std::atomic<uint64_t> mFullHead;
+    // The list of unused nodes.
+    std::atomic<uint64_t> mEmptyHead;
+};
+
 // Generic abstract object pool class. Users of this class must implement {@Code createObject}.
 //
+// Recycled objects first go to a small cache owned by the calling thread, and then to a shared
+// lock-free free list. {@Code obtain} and recycling never take a lock, except the first time a
+// thread uses the pool to register its cache. The thread caches are owned by the pool, objects
+// cached by a thread that has exited are only released when the pool is destroyed.
+//
 // This class is thread-safe. Concurrent calls to {@Code obtain} from multiple threads is OK, also
 // client can obtain an object in one thread and then move ownership to another thread.
 template <typename T>
@@ -75,22 +214,68 @@ class ObjectPool {
   public:
     using GetSizeFunc = std::function<size_t(const T&)>;
 
+    // 'maxPoolObjectsSize' is the upper bound for the memory held by the pool (as reported by
+    // 'getSizeFunc'). 'maxPoolObjectCount' is the max number of objects in the shared free list.
+    ObjectPool(size_t maxPoolObjectsSize, GetSizeFunc getSizeFunc, size_t maxPoolObjectCount)
+        : mMaxPoolObjectsSize(maxPoolObjectsSize),
+          mPoolId(sNextPoolId++),
+          mFreeList(maxPoolObjectCount),
+          mGetSizeFunc(getSizeFunc) {}
+
     ObjectPool(size_t maxPoolObjectsSize, GetSizeFunc getSizeFunc)
-        : mMaxPoolObjectsSize(maxPoolObjectsSize), mGetSizeFunc(getSizeFunc){};
-    virtual ~ObjectPool() = default;
+        : ObjectPool(maxPoolObjectsSize, getSizeFunc, maxPoolObjectsSize / sizeof(T)) {}
+
+    virtual ~ObjectPool() {
+        while (T* o = mFreeList.pop()) {
+            delete o;
+        }
+        std::scoped_lock<std::mutex> lockGuard(mThreadCachesLock);
+        for (const auto& cache : mThreadCaches) {
+            for (size_t i = 0; i < cache->count; i++) {
+                delete cache->objects[i];
+            }
+        }
+    }
 
     virtual recyclable_ptr<T> obtain() {
-        std::scoped_lock<std::mutex> lock(mLock);
         INC_METRIC_IF_DEBUG(Obtained)
-        if (mObjects.empty()) {
+        ThreadCache* cache = getThreadCache();
+        increment(cache->obtainedCount);
+
+        T* o = nullptr;
+        if (cache->count > 0) {
+            o = cache->objects[--cache->count];
+            increment(cache->threadCacheHitCount);
+        } else {
+            o = mFreeList.pop();
+            if (o != nullptr) {
+                increment(cache->freeListHitCount);
+            }
+        }
+        if (o == nullptr) {
             INC_METRIC_IF_DEBUG(Created)
             return wrap(createObject());
         }
+        mPoolObjectsSize.fetch_sub(mGetSizeFunc(*o), std::memory_order_relaxed);
+        return wrap(o);
+    }
 
-        auto o = wrap(mObjects.front().release());
-        mObjects.pop_front();
-        mPoolObjectsSize -= mGetSizeFunc(*o);
-        return o;
+    // Returns the counters for this pool.
+    ObjectPoolStats getStats() const {
+        ObjectPoolStats stats;
+        {
+            std::scoped_lock<std::mutex> lockGuard(mThreadCachesLock);
+            for (const auto& cache : mThreadCaches) {
+                stats.obtainedCount += cache->obtainedCount.load(std::memory_order_relaxed);
+                stats.threadCacheHitCount +=
+                        cache->threadCacheHitCount.load(std::memory_order_relaxed);
+                stats.freeListHitCount += cache->freeListHitCount.load(std::memory_order_relaxed);
+                stats.recycledCount += cache->recycledCount.load(std::memory_order_relaxed);
+                stats.deletedCount += cache->deletedCount.load(std::memory_order_relaxed);
+            }
+        }
+        stats.pooledObjectsSize = mPoolObjectsSize.load(std::memory_order_relaxed);
+        return stats;
     }
 
     ObjectPool& operator=(const ObjectPool&) = delete;
@@ -100,42 +285,107 @@ class ObjectPool {
     virtual T* createObject() = 0;
 
     virtual void recycle(T* o) {
-        std::scoped_lock<std::mutex> lock(mLock);
+        ThreadCache* cache = getThreadCache();
         size_t objectSize = mGetSizeFunc(*o);
 
-        if (objectSize > mMaxPoolObjectsSize ||
-            mPoolObjectsSize > mMaxPoolObjectsSize - objectSize) {
-            INC_METRIC_IF_DEBUG(Deleted)
-
-            // We have no space left in the pool.
-            delete o;
+        if (!reservePoolObjectsSize(objectSize)) {
+            deleteObject(cache, o);
+            return;
+        }
+        if (cache->count < THREAD_CACHE_SIZE) {
+            cache->objects[cache->count++] = o;
+        } else if (!mFreeList.push(o)) {
+            mPoolObjectsSize.fetch_sub(objectSize, std::memory_order_relaxed);
+            deleteObject(cache, o);
             return;
         }
 
         INC_METRIC_IF_DEBUG(Recycled)
-
-        mObjects.push_back(std::unique_ptr<T>{o});
-        mPoolObjectsSize += objectSize;
+        increment(cache->recycledCount);
     }
 
     const size_t mMaxPoolObjectsSize;
 
   private:
-    const Deleter<T>& getDeleter() {
-        if (!mDeleter.get()) {
-            Deleter<T>* d =
-                    new Deleter<T>(std::bind(&ObjectPool::recycle, this, std::placeholders::_1));
-            mDeleter.reset(d);
+    // The max number of objects cached by each thread.
+    static constexpr size_t THREAD_CACHE_SIZE = 16;
+
+    // The objects cached by one thread. Only the owner thread accesses the objects, the counters
+    // are atomic so that they could be read by {@Code getStats} from other threads.
+    struct ThreadCache {
+        std::array<T*, THREAD_CACHE_SIZE> objects;
+        size_t count = 0;
+        std::atomic<uint64_t> obtainedCount = 0;
+        std::atomic<uint64_t> threadCacheHitCount = 0;
+        std::atomic<uint64_t> freeListHitCount = 0;
+        std::atomic<uint64_t> recycledCount = 0;
+        std::atomic<uint64_t> deletedCount = 0;
+    };
+
+    // Only the owner thread writes the counter, so this does not need a read-modify-write.
+    static void increment(std::atomic<uint64_t>& counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    ThreadCache* getThreadCache() {
+        // Pool IDs are never reused, so entries for destroyed pools are never looked up again.
+        thread_local uint64_t lastPoolId = 0;
+        thread_local ThreadCache* lastCache = nullptr;
+        thread_local std::unordered_map<uint64_t, ThreadCache*> cacheByPoolId;
+
+        if (lastPoolId == mPoolId) {
+            return lastCache;
+        }
+        ThreadCache*& cache = cacheByPoolId[mPoolId];
+        if (cache == nullptr) {
+            std::scoped_lock<std::mutex> lockGuard(mThreadCachesLock);
+            mThreadCaches.push_back(std::make_unique<ThreadCache>());
+            cache = mThreadCaches.back().get();
         }
+        lastPoolId = mPoolId;
+        lastCache = cache;
+        return cache;
+    }
+
+    bool reservePoolObjectsSize(size_t objectSize) {
+        size_t poolObjectsSize = mPoolObjectsSize.load(std::memory_order_relaxed);
+        do {
+            if (objectSize > mMaxPoolObjectsSize ||
+                poolObjectsSize > mMaxPoolObjectsSize - objectSize) {
+                // We have no space left in the pool.
+                return false;
+            }
+        } while (!mPoolObjectsSize.compare_exchange_weak(poolObjectsSize,
+                                                         poolObjectsSize + objectSize,
+                                                         std::memory_order_relaxed));
+        return true;
+    }
+
+    void deleteObject(ThreadCache* cache, T* o) {
+        INC_METRIC_IF_DEBUG(Deleted)
+        increment(cache->deletedCount);
+        delete o;
+    }
+
+    const Deleter<T>& getDeleter() {
+        std::call_once(mDeleterOnce, [this] {
+            mDeleter = std::make_unique<Deleter<T>>(
+                    std::bind(&ObjectPool::recycle, this, std::placeholders::_1));
+        });
         return *mDeleter.get();
     }
 
     recyclable_ptr<T> wrap(T* raw) { return recyclable_ptr<T>{raw, getDeleter()}; }
 
-    mutable std::mutex mLock;
-    std::deque<std::unique_ptr<T>> mObjects GUARDED_BY(mLock);
+    static inline std::atomic<uint64_t> sNextPoolId = 1;
+
+    const uint64_t mPoolId;
+    LockFreeFreeList<T> mFreeList;
+    std::atomic<size_t> mPoolObjectsSize = 0;
+    mutable std::mutex mThreadCachesLock;
+    std::vector<std::unique_ptr<ThreadCache>> mThreadCaches GUARDED_BY(mThreadCachesLock);
+    std::once_flag mDeleterOnce;
     std::unique_ptr<Deleter<T>> mDeleter;
-    size_t mPoolObjectsSize GUARDED_BY(mLock);
     GetSizeFunc mGetSizeFunc;
 };
 
@@ -178,11 +428,12 @@ class VehiclePropValuePool {
     // unique pointer instead of a recyclable pointer. The object would not be recycled once it
     // goes out of scope, but would be deleted.
     // @param maxPoolObjectsSize - The approximate upper bound of memory each internal recycling
-    // pool could take. We have 4 different type pools, each with 4 different vector size, so
-    // approximately this pool would at-most take 4 * 4 * 10240 = 160k memory.
-    VehiclePropValuePool(size_t maxRecyclableVectorSize = 4, size_t maxPoolObjectsSize = 10240)
-        : mMaxRecyclableVectorSize(maxRecyclableVectorSize),
-          mMaxPoolObjectsSize(maxPoolObjectsSize){};
+    // pool could take. We have 8 different type pools, each with 3 different vector capacity
+    // classes (1, 2, 4) by default, so approximately this pool would at-most take
+    // 8 * 3 * 10240 = 240k memory.
+    VehiclePropValuePool(size_t maxRecyclableVectorSize = 4, size_t maxPoolObjectsSize = 10240);
+
+    ~VehiclePropValuePool();
 
     // Obtain a recyclable VehiclePropertyValue object from the pool for the given type. If the
     // given type is not MIXED or STRING, the internal value vector size would be set to 1.
@@ -215,6 +466,12 @@ class VehiclePropValuePool {
     // Obtain a recyclable mixed object.
     RecyclableType obtainComplex();
 
+    // Returns the sum of the counters for all the internal pools.
+    ObjectPoolStats getStats() const;
+
+    // Dumps the counters into a human readable string.
+    std::string dump() const;
+
     VehiclePropValuePool(VehiclePropValuePool&) = delete;
     VehiclePropValuePool& operator=(VehiclePropValuePool&) = delete;
 
@@ -245,15 +502,14 @@ class VehiclePropValuePool {
             aidl::android::hardware::automotive::vehicle::VehiclePropertyType type,
             size_t vectorSize);
 
+    // A pool for values of one property type whose value vector has a capacity of
+    // 'vectorCapacity'. The obtained values could be resized to any size up to the capacity
+    // without allocation.
     class InternalPool
         : public ObjectPool<aidl::android::hardware::automotive::vehicle::VehiclePropValue> {
       public:
         InternalPool(aidl::android::hardware::automotive::vehicle::VehiclePropertyType type,
-                     size_t vectorSize, size_t maxPoolObjectsSize,
-                     ObjectPool::GetSizeFunc getSizeFunc)
-            : ObjectPool(maxPoolObjectsSize, getSizeFunc),
-              mPropType(type),
-              mVectorSize(vectorSize) {}
+                     size_t vectorCapacity, size_t maxPoolObjectsSize);
 
       protected:
         aidl::android::hardware::automotive::vehicle::VehiclePropValue* createObject() override;
@@ -264,25 +520,44 @@ class VehiclePropValuePool {
 
         template <typename VecType>
         bool check(std::vector<VecType>* vec, bool isVectorType) {
-            return vec->size() == (isVectorType ? mVectorSize : 0);
+            if (!isVectorType) {
+                return vec->size() == 0;
+            }
+            return vec->size() <= mVectorCapacity && vec->capacity() >= mVectorCapacity;
         }
 
       private:
         aidl::android::hardware::automotive::vehicle::VehiclePropertyType mPropType;
-        size_t mVectorSize;
+        size_t mVectorCapacity;
     };
+
+    // The number of property types that could be recycled.
+    static constexpr size_t RECYCLABLE_TYPE_COUNT = 8;
+
+    // Returns the index for the recyclable property type, the type must not be a complex type.
+    static size_t getTypeIndex(
+            aidl::android::hardware::automotive::vehicle::VehiclePropertyType type);
+    // Returns the index for the smallest vector capacity class that could hold 'vectorSize'.
+    static size_t getCapacityClassIndex(size_t vectorSize);
+
+    InternalPool* getInternalPool(
+            aidl::android::hardware::automotive::vehicle::VehiclePropertyType type,
+            size_t vectorSize);
+
     const Deleter<aidl::android::hardware::automotive::vehicle::VehiclePropValue>
             mDisposableDeleter{
                     [](aidl::android::hardware::automotive::vehicle::VehiclePropValue* v) {
                         delete v;
                     }};
 
-    mutable std::mutex mLock;
     const size_t mMaxRecyclableVectorSize;
     const size_t mMaxPoolObjectsSize;
-    // A map with 'property_type' | 'value_vector_size' as key and a recyclable object pool as
-    // value. We would create a recyclable pool for each property type and vector size combination.
-    std::map<int32_t, std::unique_ptr<InternalPool>> mValueTypePools GUARDED_BY(mLock);
+    // The number of vector capacity classes, the capacity for class i is 2^i.
+    const size_t mCapacityClassCount;
+    // The recyclable object pools indexed by
+    // 'type index' * mCapacityClassCount + 'capacity class index'. Each pool is created the first
+    // time it is used and never removed until this object is destroyed.
+    std::unique_ptr<std::atomic<InternalPool*>[]> mValueTypePools;
 };
 
 }  // namespace vehicle
@@ -17,10 +17,12 @@
 #ifndef android_hardware_automotive_vehicle_aidl_impl_utils_common_include_VehiclePropertyStore_H_
 #define android_hardware_automotive_vehicle_aidl_impl_utils_common_include_VehiclePropertyStore_H_
 
+#include <array>
 #include <cstdint>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <unordered_map>
 
 #include <VehicleHalTypes.h>
@@ -40,7 +42,10 @@ namespace vehicle {
 // VehiclePropertyValues stored in a sorted map thus it makes easier to get range of values, e.g.
 // to get value for all areas for particular property.
 //
-// This class is thread-safe, however it uses blocking synchronization across all methods.
+// This class is thread-safe. By default it uses blocking synchronization across all methods. If
+// constructed with {@code StoreMode::SHARDED}, the records are sharded by property ID and the
+// values are published as immutable snapshots, so that readers and writers do not wait for each
+// other beyond a pointer swap. See {@code StoreMode} for details.
 class VehiclePropertyStore final {
   public:
     using ValueResultType = VhalResult<VehiclePropValuePool::RecyclableType>;
@@ -73,8 +78,29 @@ class VehiclePropertyStore final {
         NEVER,
     };
 
-    explicit VehiclePropertyStore(std::shared_ptr<VehiclePropValuePool> valuePool)
-        : mValuePool(valuePool) {}
+    enum class StoreMode : uint8_t {
+        /**
+         * All operations are serialized through one store-wide lock.
+         */
+        GLOBAL_LOCK,
+        /**
+         * Records are sharded by property ID. Each shard is protected by a reader-writer lock that
+         * is only held exclusively while registering a property. Values for one property are kept
+         * in an immutable snapshot that writers replace as a whole (read-copy-update), so
+         * {@code readValue} and {@code getPropConfig} only wait for a concurrent
+         * {@code writeValue} or {@code refreshTimestamp} while it swaps the snapshot pointer.
+         * Writers to the same property are still serialized with each other, and every write
+         * copies the map of values of its property.
+         *
+         * This should be used when high rate continuous properties are written concurrently with
+         * many reads.
+         */
+        SHARDED,
+    };
+
+    explicit VehiclePropertyStore(std::shared_ptr<VehiclePropValuePool> valuePool,
+                                  StoreMode storeMode = StoreMode::GLOBAL_LOCK)
+        : mStoreMode(storeMode), mValuePool(valuePool) {}
 
     ~VehiclePropertyStore();
 
@@ -176,6 +202,8 @@ class VehiclePropertyStore final {
 
     inline std::shared_ptr<VehiclePropValuePool> getValuePool() { return mValuePool; }
 
+    inline StoreMode getStoreMode() const { return mStoreMode; }
+
   private:
     struct RecordId {
         int32_t area;
@@ -196,22 +224,90 @@ class VehiclePropertyStore final {
         std::unordered_map<RecordId, VehiclePropValuePool::RecyclableType, RecordIdHash> values;
     };
 
+    // The values of a record in {@code StoreMode::SHARDED} mode. A snapshot is never modified
+    // after it is published, writers publish a modified copy instead. The values keep the deleter
+    // of {@code VehiclePropValuePool}, so they are recycled once no snapshot holds them anymore.
+    using ValueSnapshot = std::unordered_map<
+            RecordId,
+            std::shared_ptr<const aidl::android::hardware::automotive::vehicle::VehiclePropValue>,
+            RecordIdHash>;
+
+    struct ShardedRecord {
+        // Only modified with the shard lock held exclusively.
+        aidl::android::hardware::automotive::vehicle::VehiclePropConfig propConfig;
+        TokenFunction tokenFunction;
+        // Serializes the writers for this record. Readers never take this lock.
+        std::mutex writeLock;
+        // Only held to copy or to replace the snapshot pointer, see {@code loadValues} and
+        // {@code storeValues}.
+        mutable std::mutex snapshotLock;
+        std::shared_ptr<const ValueSnapshot> values GUARDED_BY(snapshotLock);
+    };
+
+    struct Shard {
+        // Held exclusively only when a property is registered. Records are never removed and are
+        // updated in place when registered again, so pointers to them stay valid.
+        mutable std::shared_mutex lock;
+        std::unordered_map<int32_t, ShardedRecord> recordsByPropId;
+    };
+
+    static constexpr size_t kShardCount = 16;
+
+    const StoreMode mStoreMode;
     // {@code VehiclePropValuePool} is thread-safe.
     std::shared_ptr<VehiclePropValuePool> mValuePool;
+    // Only used in {@code StoreMode::GLOBAL_LOCK} mode.
     mutable std::mutex mLock;
     std::unordered_map<int32_t, Record> mRecordsByPropId GUARDED_BY(mLock);
-    OnValueChangeCallback mOnValueChangeCallback GUARDED_BY(mLock);
-    OnValuesChangeCallback mOnValuesChangeCallback GUARDED_BY(mLock);
+    // Only used in {@code StoreMode::SHARDED} mode.
+    std::array<Shard, kShardCount> mShards;
+    mutable std::mutex mCallbackLock;
+    OnValueChangeCallback mOnValueChangeCallback GUARDED_BY(mCallbackLock);
+    OnValuesChangeCallback mOnValuesChangeCallback GUARDED_BY(mCallbackLock);
 
     const Record* getRecordLocked(int32_t propId) const;
 
     Record* getRecordLocked(int32_t propId);
 
-    RecordId getRecordIdLocked(
+    RecordId getRecordId(
             const aidl::android::hardware::automotive::vehicle::VehiclePropValue& propValue,
-            const Record& record) const;
+            const TokenFunction& tokenFunction) const;
 
     ValueResultType readValueLocked(const RecordId& recId, const Record& record) const;
+
+    void getCallbacks(OnValueChangeCallback* onValueChangeCallback,
+                      OnValuesChangeCallback* onValuesChangeCallback) const
+            EXCLUDES(mCallbackLock);
+
+    const Shard& getShard(int32_t propId) const;
+
+    Shard& getShard(int32_t propId);
+
+    // The shard lock must be held.
+    static const ShardedRecord* getShardedRecord(const Shard& shard, int32_t propId);
+
+    static ShardedRecord* getShardedRecord(Shard& shard, int32_t propId);
+
+    static std::shared_ptr<const ValueSnapshot> loadValues(const ShardedRecord& record);
+
+    static void storeValues(ShardedRecord& record, std::shared_ptr<const ValueSnapshot> values);
+
+    ValueResultType readValueFromSnapshot(const RecordId& recId,
+                                          const ShardedRecord& record) const;
+
+    void registerPropertySharded(
+            const aidl::android::hardware::automotive::vehicle::VehiclePropConfig& config,
+            TokenFunction tokenFunc);
+
+    VhalResult<void> writeValueSharded(VehiclePropValuePool::RecyclableType propValue,
+                                       bool updateStatus, EventMode eventMode,
+                                       bool useCurrentTimestamp);
+
+    void refreshTimestampsSharded(
+            const std::unordered_map<PropIdAreaId, EventMode, PropIdAreaIdHash>&
+                    eventModeByPropIdAreaId,
+            std::vector<aidl::android::hardware::automotive::vehicle::VehiclePropValue>*
+                    updatedValues);
 };
 
 }  // namespace vehicle
@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LatencyStats.h"
+
+#include <VehicleUtils.h>
+
+#include <android-base/stringprintf.h>
+
+#include <inttypes.h>
+#include <algorithm>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+namespace {
+
+using ::android::base::StringAppendF;
+
+constexpr int64_t NANOS_PER_MICRO = 1'000;
+
+size_t hashPropId(int32_t propId) {
+    // Property IDs share the group, area type and value type bits, so mix the bits before using
+    // them as an index.
+    uint32_t hash = static_cast<uint32_t>(propId) * 0x9E3779B1u;
+    return static_cast<size_t>(hash ^ (hash >> 16));
+}
+
+void updateMax(std::atomic<uint64_t>* max, uint64_t value) {
+    uint64_t currentMax = max->load(std::memory_order_relaxed);
+    while (value > currentMax &&
+           !max->compare_exchange_weak(currentMax, value, std::memory_order_relaxed)) {
+    }
+}
+
+}  // namespace
+
+size_t LatencyHistogram::getBucketIndex(int64_t latencyInNanos) {
+    uint64_t latencyInMicros = static_cast<uint64_t>(std::max<int64_t>(latencyInNanos, 0)) /
+                               static_cast<uint64_t>(NANOS_PER_MICRO);
+    if (latencyInMicros < 2) {
+        return 0;
+    }
+    // 63 - clz(x) is floor(log2(x)).
+    return std::min(static_cast<size_t>(63 - __builtin_clzll(latencyInMicros)), NUM_BUCKETS - 1);
+}
+
+void LatencyHistogram::record(int64_t latencyInNanos) {
+    uint64_t latency = static_cast<uint64_t>(std::max<int64_t>(latencyInNanos, 0));
+    mBuckets[getBucketIndex(latencyInNanos)].fetch_add(1, std::memory_order_relaxed);
+    mTotalInNanos.fetch_add(latency, std::memory_order_relaxed);
+    updateMax(&mMaxInNanos, latency);
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::getSnapshot() const {
+    Snapshot snapshot;
+    for (size_t i = 0; i < NUM_BUCKETS; i++) {
+        snapshot.buckets[i] = mBuckets[i].load(std::memory_order_relaxed);
+        snapshot.count += snapshot.buckets[i];
+    }
+    snapshot.totalInNanos = mTotalInNanos.load(std::memory_order_relaxed);
+    snapshot.maxInNanos = mMaxInNanos.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+void LatencyHistogram::reset() {
+    for (auto& bucket : mBuckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    mTotalInNanos.store(0, std::memory_order_relaxed);
+    mMaxInNanos.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::Snapshot::getPercentileInNanos(double percentile) const {
+    if (count == 0) {
+        return 0;
+    }
+    double target = static_cast<double>(count) * std::clamp(percentile, 0.0, 100.0) / 100.0;
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; i++) {
+        cumulative += buckets[i];
+        if (buckets[i] != 0 && static_cast<double>(cumulative) >= target) {
+            if (i == NUM_BUCKETS - 1) {
+                return maxInNanos;
+            }
+            // Never report more than the max sample.
+            uint64_t upperBoundInNanos = (uint64_t{2} << i) * NANOS_PER_MICRO;
+            return std::min(upperBoundInNanos, maxInNanos);
+        }
+    }
+    return maxInNanos;
+}
+
+PropertyLatencyStats::PropertyLatencyStats() = default;
+
+PropertyLatencyStats::~PropertyLatencyStats() {
+    for (auto& slot : mEntries) {
+        delete slot.load(std::memory_order_acquire);
+    }
+}
+
+PropertyLatencyStats::PropertyEntry* PropertyLatencyStats::getOrCreateEntry(int32_t propId) {
+    size_t start = hashPropId(propId);
+    PropertyEntry* newEntry = nullptr;
+    for (size_t i = 0; i < MAX_PROPERTIES; i++) {
+        std::atomic<PropertyEntry*>& slot = mEntries[(start + i) % MAX_PROPERTIES];
+        PropertyEntry* entry = slot.load(std::memory_order_acquire);
+        if (entry == nullptr) {
+            if (newEntry == nullptr) {
+                newEntry = new PropertyEntry(propId);
+            }
+            if (slot.compare_exchange_strong(entry, newEntry, std::memory_order_acq_rel,
+                                             std::memory_order_acquire)) {
+                return newEntry;
+            }
+            // Another thread took the slot, 'entry' is now the entry it installed.
+        }
+        if (entry->propId == propId) {
+            delete newEntry;
+            return entry;
+        }
+    }
+    delete newEntry;
+    return &mOverflowEntry;
+}
+
+void PropertyLatencyStats::record(int32_t propId, Operation operation, int64_t latencyInNanos) {
+    getOrCreateEntry(propId)->histograms[static_cast<size_t>(operation)].record(latencyInNanos);
+}
+
+void PropertyLatencyStats::recordTimeouts(Operation operation, size_t count) {
+    mTimeoutCounts[static_cast<size_t>(operation)].fetch_add(count, std::memory_order_relaxed);
+}
+
+uint64_t PropertyLatencyStats::getTimeoutCount(Operation operation) const {
+    return mTimeoutCounts[static_cast<size_t>(operation)].load(std::memory_order_relaxed);
+}
+
+std::vector<PropertyLatencyStats::PropertySnapshot> PropertyLatencyStats::getSnapshots() const {
+    std::vector<PropertySnapshot> snapshots;
+    auto addSnapshot = [&snapshots](const PropertyEntry& entry) {
+        PropertySnapshot snapshot;
+        snapshot.propId = entry.propId;
+        bool hasSample = false;
+        for (size_t i = 0; i < NUM_OPERATIONS; i++) {
+            snapshot.histograms[i] = entry.histograms[i].getSnapshot();
+            hasSample |= snapshot.histograms[i].count != 0;
+        }
+        if (hasSample) {
+            snapshots.push_back(std::move(snapshot));
+        }
+    };
+    for (const auto& slot : mEntries) {
+        if (const PropertyEntry* entry = slot.load(std::memory_order_acquire); entry != nullptr) {
+            addSnapshot(*entry);
+        }
+    }
+    addSnapshot(mOverflowEntry);
+    std::sort(snapshots.begin(), snapshots.end(),
+              [](const PropertySnapshot& a, const PropertySnapshot& b) {
+                  return a.propId < b.propId;
+              });
+    return snapshots;
+}
+
+void PropertyLatencyStats::reset() {
+    for (auto& slot : mEntries) {
+        if (PropertyEntry* entry = slot.load(std::memory_order_acquire); entry != nullptr) {
+            for (auto& histogram : entry->histograms) {
+                histogram.reset();
+            }
+        }
+    }
+    for (auto& histogram : mOverflowEntry.histograms) {
+        histogram.reset();
+    }
+    for (auto& count : mTimeoutCounts) {
+        count.store(0, std::memory_order_relaxed);
+    }
+}
+
+const char* PropertyLatencyStats::toString(Operation operation) {
+    switch (operation) {
+        case Operation::GET_VALUES:
+            return "getValues";
+        case Operation::SET_VALUES:
+            return "setValues";
+        case Operation::EVENT_DELIVERY:
+            return "eventDelivery";
+        default:
+            return "unknown";
+    }
+}
+
+std::string PropertyLatencyStats::dump() const {
+    std::string msg = "Latency stats (us):\n";
+    StringAppendF(&msg, "Timeouts: getValues: %" PRIu64 ", setValues: %" PRIu64 "\n",
+                  getTimeoutCount(Operation::GET_VALUES),
+                  getTimeoutCount(Operation::SET_VALUES));
+    for (const auto& snapshot : getSnapshots()) {
+        std::string propName =
+                snapshot.propId == 0 ? "OVERFLOW" : propIdToString(snapshot.propId);
+        for (size_t i = 0; i < NUM_OPERATIONS; i++) {
+            const LatencyHistogram::Snapshot& histogram = snapshot.histograms[i];
+            if (histogram.count == 0) {
+                continue;
+            }
+            StringAppendF(&msg,
+                          "%s, %s: count: %" PRIu64 ", avg: %" PRIu64 ", p50: %" PRIu64
+                          ", p90: %" PRIu64 ", p99: %" PRIu64 ", max: %" PRIu64 "\n",
+                          propName.c_str(), toString(static_cast<Operation>(i)), histogram.count,
+                          histogram.totalInNanos / histogram.count / NANOS_PER_MICRO,
+                          histogram.getPercentileInNanos(50) / NANOS_PER_MICRO,
+                          histogram.getPercentileInNanos(90) / NANOS_PER_MICRO,
+                          histogram.getPercentileInNanos(99) / NANOS_PER_MICRO,
+                          histogram.maxInNanos / NANOS_PER_MICRO);
+        }
+    }
+    return msg;
+}
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -16,12 +16,15 @@
 
 #include "RecurrentTimer.h"
 
+#include <android-base/stringprintf.h>
 #include <utils/Log.h>
 #include <utils/Looper.h>
 #include <utils/SystemClock.h>
 
 #include <inttypes.h>
 #include <math.h>
+#include <stdlib.h>
+#include <algorithm>
 
 namespace android {
 namespace hardware {
@@ -31,12 +34,22 @@ namespace vehicle {
 namespace {
 
 using ::android::base::ScopedLockAssertion;
+using ::android::base::StringPrintf;
 
 constexpr int INVALID_ID = -1;
+// All the callbacks share one wakeup message.
+constexpr int WAKEUP_MESSAGE = 0;
+
+// Rounds towards negative infinity, unlike the integer division. 'divisor' must be positive.
+int64_t floorDiv(int64_t dividend, int64_t divisor) {
+    int64_t quotient = dividend / divisor;
+    return (dividend % divisor < 0) ? quotient - 1 : quotient;
+}
 
 }  // namespace
 
-RecurrentTimer::RecurrentTimer() {
+RecurrentTimer::RecurrentTimer(int64_t slackInNanos)
+    : mSlackInNanos(slackInNanos), mTimerWheel(TICK_IN_NANOS, uptimeNanos()) {
     mHandler = sp<RecurrentMessageHandler>::make(this);
     mLooper = sp<Looper>::make(/*allowNonCallbacks=*/false);
     mThread = std::thread([this] {
@@ -79,7 +92,6 @@ void RecurrentTimer::registerTimerCallback(int64_t intervalInNanos,
             ALOGI("Replacing an existing timer callback with a new interval, current: %" PRId64
                   " ns, new: %" PRId64 " ns",
                   mCallbackInfoById[callbackId]->intervalInNanos, intervalInNanos);
-            mLooper->removeMessages(mHandler, callbackId);
         }
 
         // Aligns the nextTime to multiply of interval.
@@ -89,9 +101,10 @@ void RecurrentTimer::registerTimerCallback(int64_t intervalInNanos,
         info->callback = callback;
         info->intervalInNanos = intervalInNanos;
         info->nextTimeInNanos = nextTimeInNanos;
-        mCallbackInfoById.insert({callbackId, std::move(info)});
+        mCallbackInfoById[callbackId] = std::move(info);
 
-        mLooper->sendMessageAtTime(nextTimeInNanos, mHandler, Message(callbackId));
+        mTimerWheel.schedule(callbackId, nextTimeInNanos);
+        scheduleWakeupLocked();
     }
 }
 
@@ -106,37 +119,90 @@ void RecurrentTimer::unregisterTimerCallback(std::shared_ptr<RecurrentTimer::Cal
             return;
         }
 
-        mLooper->removeMessages(mHandler, callbackId);
+        mTimerWheel.cancel(callbackId);
         mCallbackInfoById.erase(callbackId);
         mIdByCallback.erase(callback);
+        scheduleWakeupLocked();
     }
 }
 
-void RecurrentTimer::handleMessage(const Message& message) {
-    std::shared_ptr<RecurrentTimer::Callback> callback;
+void RecurrentTimer::scheduleWakeupLocked() {
+    std::optional<int64_t> nextDueTimeInNanos = mTimerWheel.getNextDueTime();
+    if (!nextDueTimeInNanos.has_value()) {
+        if (mNextWakeupTimeInNanos != NO_WAKEUP) {
+            mLooper->removeMessages(mHandler);
+            mNextWakeupTimeInNanos = NO_WAKEUP;
+        }
+        return;
+    }
+    if (*nextDueTimeInNanos == mNextWakeupTimeInNanos) {
+        return;
+    }
+    mLooper->removeMessages(mHandler);
+    mLooper->sendMessageAtTime(*nextDueTimeInNanos, mHandler, Message(WAKEUP_MESSAGE));
+    mNextWakeupTimeInNanos = *nextDueTimeInNanos;
+}
+
+RecurrentTimer::Stats RecurrentTimer::getStats() const {
+    std::scoped_lock<std::mutex> lockGuard(mLock);
+    return mStats;
+}
+
+std::string RecurrentTimer::dump() const {
+    Stats stats = getStats();
+    int64_t averageJitterInNanos =
+            stats.callbackCount == 0 ? 0 : stats.totalJitterInNanos / stats.callbackCount;
+    return StringPrintf("Recurrent timer: slack: %" PRId64 " ns, wakeups: %" PRId64
+                        ", callbacks: %" PRId64 ", average jitter: %" PRId64
+                        " ns, max jitter: %" PRId64 " ns\n",
+                        mSlackInNanos, stats.wakeupCount, stats.callbackCount,
+                        averageJitterInNanos, stats.maxJitterInNanos);
+}
+
+void RecurrentTimer::handleMessage(const Message&) {
+    std::vector<std::shared_ptr<RecurrentTimer::Callback>> callbacks;
     {
         std::scoped_lock<std::mutex> lockGuard(mLock);
 
-        int callbackId = message.what;
-
-        auto it = mCallbackInfoById.find(callbackId);
-        if (it == mCallbackInfoById.end()) {
-            ALOGW("The event for callback ID: %d is outdated, ignore", callbackId);
-            return;
+        mNextWakeupTimeInNanos = NO_WAKEUP;
+        int64_t nowNanos = uptimeNanos();
+        std::vector<int32_t> dueCallbackIds = mTimerWheel.advance(nowNanos + mSlackInNanos);
+        if (!dueCallbackIds.empty()) {
+            mStats.wakeupCount++;
         }
 
-        CallbackInfo* callbackInfo = it->second.get();
-        callback = callbackInfo->callback;
-        int64_t nowNanos = uptimeNanos();
-        // intervalCount is the number of interval we have to advance until we pass now.
-        size_t intervalCount =
-                (nowNanos - callbackInfo->nextTimeInNanos) / callbackInfo->intervalInNanos + 1;
-        callbackInfo->nextTimeInNanos += intervalCount * callbackInfo->intervalInNanos;
+        for (int32_t callbackId : dueCallbackIds) {
+            auto it = mCallbackInfoById.find(callbackId);
+            if (it == mCallbackInfoById.end()) {
+                ALOGW("The event for callback ID: %d is outdated, ignore", callbackId);
+                continue;
+            }
+
+            CallbackInfo* callbackInfo = it->second.get();
+            callbacks.push_back(callbackInfo->callback);
+
+            int64_t jitterInNanos = llabs(nowNanos - callbackInfo->nextTimeInNanos);
+            mStats.callbackCount++;
+            mStats.totalJitterInNanos += jitterInNanos;
+            mStats.maxJitterInNanos = std::max(mStats.maxJitterInNanos, jitterInNanos);
+
+            // intervalCount is the number of interval we have to advance until we pass now. The
+            // callback might be called before its due time because of the slack, even by more
+            // than one interval if the interval is shorter than the slack, in which case we only
+            // advance one interval.
+            int64_t elapsedIntervals = floorDiv(nowNanos - callbackInfo->nextTimeInNanos,
+                                                callbackInfo->intervalInNanos);
+            int64_t intervalCount = std::max<int64_t>(1, elapsedIntervals + 1);
+            callbackInfo->nextTimeInNanos += intervalCount * callbackInfo->intervalInNanos;
+            mTimerWheel.schedule(callbackId, callbackInfo->nextTimeInNanos);
+        }
 
-        mLooper->sendMessageAtTime(callbackInfo->nextTimeInNanos, mHandler, Message(callbackId));
+        scheduleWakeupLocked();
     }
 
-    (*callback)();
+    for (const auto& callback : callbacks) {
+        (*callback)();
+    }
 }
 
 void RecurrentMessageHandler::handleMessage(const Message& message) {
@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TimerWheel.h"
+
+#include <algorithm>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+TimerWheel::TimerWheel(int64_t tickInNanos, int64_t startTimeInNanos)
+    : mTickInNanos(tickInNanos), mCurrentTick(startTimeInNanos / tickInNanos) {}
+
+int TimerWheel::shiftForLevel(size_t level) {
+    int shift = 0;
+    for (size_t i = 0; i < level; i++) {
+        shift += LEVEL_BITS[i];
+    }
+    return shift;
+}
+
+size_t TimerWheel::slotCountForLevel(size_t level) {
+    return static_cast<size_t>(1) << LEVEL_BITS[level];
+}
+
+TimerWheel::Slot& TimerWheel::getSlot(const Location& location) {
+    if (location.level == OVERFLOW_LEVEL) {
+        return mOverflow;
+    }
+    return mLevels[location.level][location.slot];
+}
+
+void TimerWheel::insert(const Timer& timer) {
+    Timer timerToInsert = timer;
+    timerToInsert.dueTick = std::max(timer.dueTick, mCurrentTick);
+    int64_t delta = timerToInsert.dueTick - mCurrentTick;
+
+    Location location = {.level = OVERFLOW_LEVEL, .slot = 0};
+    for (size_t level = 0; level < LEVEL_COUNT; level++) {
+        int shift = shiftForLevel(level);
+        if (delta < (static_cast<int64_t>(1) << (shift + LEVEL_BITS[level]))) {
+            location.level = level;
+            location.slot = static_cast<size_t>(timerToInsert.dueTick >> shift) &
+                            (slotCountForLevel(level) - 1);
+            break;
+        }
+    }
+    getSlot(location).push_back(timerToInsert);
+    mLocationById[timer.id] = location;
+}
+
+void TimerWheel::cascade(size_t level) {
+    size_t slotIndex = static_cast<size_t>(mCurrentTick >> shiftForLevel(level)) &
+                       (slotCountForLevel(level) - 1);
+    Slot timers = std::move(mLevels[level][slotIndex]);
+    mLevels[level][slotIndex].clear();
+    for (const Timer& timer : timers) {
+        insert(timer);
+    }
+}
+
+void TimerWheel::schedule(int32_t id, int64_t dueTimeInNanos) {
+    cancel(id);
+    insert(Timer{
+            .id = id,
+            .dueTimeInNanos = dueTimeInNanos,
+            .dueTick = dueTimeInNanos / mTickInNanos,
+    });
+}
+
+bool TimerWheel::cancel(int32_t id) {
+    auto it = mLocationById.find(id);
+    if (it == mLocationById.end()) {
+        return false;
+    }
+    Slot& slot = getSlot(it->second);
+    auto timerIt = std::find_if(slot.begin(), slot.end(),
+                                [id](const Timer& timer) { return timer.id == id; });
+    if (timerIt != slot.end()) {
+        *timerIt = slot.back();
+        slot.pop_back();
+    }
+    mLocationById.erase(it);
+    return true;
+}
+
+std::vector<int32_t> TimerWheel::advance(int64_t timeInNanos) {
+    std::vector<Timer> expiredTimers;
+    int64_t targetTick = timeInNanos / mTickInNanos;
+
+    while (mCurrentTick <= targetTick && !mLocationById.empty()) {
+        // Entering a new slot on one level means all the levels below have wrapped around, the
+        // timers in the new slot must be moved down before they could expire.
+        if ((mCurrentTick & (slotCountForLevel(0) - 1)) == 0) {
+            bool wrapped = true;
+            for (size_t level = 1; level < LEVEL_COUNT && wrapped; level++) {
+                cascade(level);
+                wrapped = ((mCurrentTick >> shiftForLevel(level)) &
+                           (slotCountForLevel(level) - 1)) == 0;
+            }
+            if (wrapped) {
+                Slot timers = std::move(mOverflow);
+                mOverflow.clear();
+                for (const Timer& timer : timers) {
+                    insert(timer);
+                }
+            }
+        }
+
+        Slot& slot = mLevels[0][mCurrentTick & (slotCountForLevel(0) - 1)];
+        if (mCurrentTick < targetTick) {
+            for (const Timer& timer : slot) {
+                expiredTimers.push_back(timer);
+                mLocationById.erase(timer.id);
+            }
+            slot.clear();
+            mCurrentTick++;
+            continue;
+        }
+
+        // This is the last tick, only expire the timers that are already due and stay at this
+        // tick for the rest.
+        auto notDueIt = std::partition(slot.begin(), slot.end(), [timeInNanos](const Timer& timer) {
+            return timer.dueTimeInNanos <= timeInNanos;
+        });
+        for (auto it = slot.begin(); it != notDueIt; it++) {
+            expiredTimers.push_back(*it);
+            mLocationById.erase(it->id);
+        }
+        slot.erase(slot.begin(), notDueIt);
+        break;
+    }
+
+    if (mLocationById.empty() && mCurrentTick < targetTick) {
+        // Nothing to expire, skip the empty ticks.
+        mCurrentTick = targetTick;
+    }
+
+    std::stable_sort(expiredTimers.begin(), expiredTimers.end(),
+                     [](const Timer& left, const Timer& right) {
+                         return left.dueTimeInNanos < right.dueTimeInNanos;
+                     });
+    std::vector<int32_t> expiredIds;
+    expiredIds.reserve(expiredTimers.size());
+    for (const Timer& timer : expiredTimers) {
+        expiredIds.push_back(timer.id);
+    }
+    return expiredIds;
+}
+
+std::optional<int64_t> TimerWheel::getNextDueTime() const {
+    std::optional<int64_t> nextDueTime;
+    auto updateWithSlot = [&nextDueTime](const Slot& slot) {
+        for (const Timer& timer : slot) {
+            if (!nextDueTime.has_value() || timer.dueTimeInNanos < *nextDueTime) {
+                nextDueTime = timer.dueTimeInNanos;
+            }
+        }
+    };
+
+    if (mLocationById.empty()) {
+        return std::nullopt;
+    }
+    for (size_t level = 0; level < LEVEL_COUNT; level++) {
+        size_t slotCount = slotCountForLevel(level);
+        // On level 0 the current slot is the earliest one, on the other levels the current slot
+        // was already cascaded and may only contain timers for the next round.
+        size_t startIndex = static_cast<size_t>(mCurrentTick >> shiftForLevel(level)) +
+                            (level == 0 ? 0 : 1);
+        for (size_t i = 0; i < slotCount; i++) {
+            const Slot& slot = mLevels[level][(startIndex + i) & (slotCount - 1)];
+            if (!slot.empty()) {
+                updateWithSlot(slot);
+                break;
+            }
+        }
+    }
+    updateWithSlot(mOverflow);
+    return nextDueTime;
+}
+
+size_t TimerWheel::size() const {
+    return mLocationById.size();
+}
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
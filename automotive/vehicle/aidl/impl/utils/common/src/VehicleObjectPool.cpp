@@ -20,9 +20,12 @@
 
 #include <VehicleUtils.h>
 
+#include <android-base/stringprintf.h>
 #include <assert.h>
 #include <utils/Log.h>
 
+#include <inttypes.h>
+
 namespace android {
 namespace hardware {
 namespace automotive {
@@ -32,6 +35,90 @@ using ::aidl::android::hardware::automotive::vehicle::RawPropValues;
 using ::aidl::android::hardware::automotive::vehicle::VehicleProperty;
 using ::aidl::android::hardware::automotive::vehicle::VehiclePropertyType;
 using ::aidl::android::hardware::automotive::vehicle::VehiclePropValue;
+using ::android::base::StringPrintf;
+
+namespace {
+
+// Calls 'func' with the vector that holds the values for the type. Does nothing for a complex type.
+template <typename Func>
+void forValueVector(RawPropValues* value, VehiclePropertyType type, Func&& func) {
+    switch (type) {
+        case VehiclePropertyType::BOOLEAN:
+        case VehiclePropertyType::INT32:
+        case VehiclePropertyType::INT32_VEC:
+            func(value->int32Values);
+            return;
+        case VehiclePropertyType::INT64:
+        case VehiclePropertyType::INT64_VEC:
+            func(value->int64Values);
+            return;
+        case VehiclePropertyType::FLOAT:
+        case VehiclePropertyType::FLOAT_VEC:
+            func(value->floatValues);
+            return;
+        case VehiclePropertyType::BYTES:
+            func(value->byteValues);
+            return;
+        default:
+            return;
+    }
+}
+
+size_t getPooledValueSize(VehiclePropertyType type, size_t vectorCapacity) {
+    return getVehiclePropValueSize(*createVehiclePropValueVec(type, vectorCapacity));
+}
+
+}  // namespace
+
+VehiclePropValuePool::VehiclePropValuePool(size_t maxRecyclableVectorSize,
+                                           size_t maxPoolObjectsSize)
+    : mMaxRecyclableVectorSize(maxRecyclableVectorSize),
+      mMaxPoolObjectsSize(maxPoolObjectsSize),
+      mCapacityClassCount(getCapacityClassIndex(std::max<size_t>(maxRecyclableVectorSize, 1)) + 1),
+      mValueTypePools(new std::atomic<InternalPool*>[RECYCLABLE_TYPE_COUNT * mCapacityClassCount]) {
+    for (size_t i = 0; i < RECYCLABLE_TYPE_COUNT * mCapacityClassCount; i++) {
+        mValueTypePools[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+VehiclePropValuePool::~VehiclePropValuePool() {
+    for (size_t i = 0; i < RECYCLABLE_TYPE_COUNT * mCapacityClassCount; i++) {
+        delete mValueTypePools[i].load(std::memory_order_acquire);
+    }
+}
+
+size_t VehiclePropValuePool::getTypeIndex(VehiclePropertyType type) {
+    switch (type) {
+        case VehiclePropertyType::BOOLEAN:
+            return 0;
+        case VehiclePropertyType::INT32:
+            return 1;
+        case VehiclePropertyType::INT64:
+            return 2;
+        case VehiclePropertyType::FLOAT:
+            return 3;
+        case VehiclePropertyType::INT32_VEC:
+            return 4;
+        case VehiclePropertyType::INT64_VEC:
+            return 5;
+        case VehiclePropertyType::FLOAT_VEC:
+            return 6;
+        case VehiclePropertyType::BYTES:
+            return 7;
+        default:
+            // Complex types are never recycled.
+            assert(false);
+            return 0;
+    }
+}
+
+size_t VehiclePropValuePool::getCapacityClassIndex(size_t vectorSize) {
+    size_t index = 0;
+    while ((static_cast<size_t>(1) << index) < vectorSize) {
+        index++;
+    }
+    return index;
+}
 
 VehiclePropValuePool::RecyclableType VehiclePropValuePool::obtain(VehiclePropertyType type) {
     if (isComplexType(type)) {
@@ -94,21 +181,55 @@ VehiclePropValuePool::RecyclableType VehiclePropValuePool::obtainComplex() {
     return obtain(VehiclePropertyType::MIXED);
 }
 
+VehiclePropValuePool::InternalPool* VehiclePropValuePool::getInternalPool(
+        VehiclePropertyType type, size_t vectorSize) {
+    size_t capacityClassIndex = getCapacityClassIndex(vectorSize);
+    std::atomic<InternalPool*>& poolSlot =
+            mValueTypePools[getTypeIndex(type) * mCapacityClassCount + capacityClassIndex];
+    InternalPool* pool = poolSlot.load(std::memory_order_acquire);
+    if (pool != nullptr) {
+        return pool;
+    }
+
+    auto newPool = std::make_unique<InternalPool>(
+            type, static_cast<size_t>(1) << capacityClassIndex, mMaxPoolObjectsSize);
+    if (poolSlot.compare_exchange_strong(pool, newPool.get(), std::memory_order_acq_rel,
+                                         std::memory_order_acquire)) {
+        return newPool.release();
+    }
+    // Another thread created the pool first, 'pool' is updated to that pool.
+    return pool;
+}
+
 VehiclePropValuePool::RecyclableType VehiclePropValuePool::obtainRecyclable(
         VehiclePropertyType type, size_t vectorSize) {
-    std::scoped_lock<std::mutex> lock(mLock);
     assert(vectorSize > 0);
 
-    // VehiclePropertyType is not overlapping with vectorSize.
-    int32_t key = static_cast<int32_t>(type) | static_cast<int32_t>(vectorSize);
-    auto it = mValueTypePools.find(key);
+    auto value = getInternalPool(type, vectorSize)->obtain();
+    // The pooled value has enough capacity so this does not allocate.
+    forValueVector(&value->value, type, [vectorSize](auto& vec) { vec.resize(vectorSize); });
+    return value;
+}
 
-    if (it == mValueTypePools.end()) {
-        auto newPool(std::make_unique<InternalPool>(type, vectorSize, mMaxPoolObjectsSize,
-                                                    getVehiclePropValueSize));
-        it = mValueTypePools.emplace(key, std::move(newPool)).first;
+ObjectPoolStats VehiclePropValuePool::getStats() const {
+    ObjectPoolStats stats;
+    for (size_t i = 0; i < RECYCLABLE_TYPE_COUNT * mCapacityClassCount; i++) {
+        if (const InternalPool* pool = mValueTypePools[i].load(std::memory_order_acquire);
+            pool != nullptr) {
+            stats += pool->getStats();
+        }
     }
-    return it->second->obtain();
+    return stats;
+}
+
+std::string VehiclePropValuePool::dump() const {
+    ObjectPoolStats stats = getStats();
+    return StringPrintf("Value pool: obtained: %" PRIu64 ", hit rate: %.1f%%, thread cache hits: %" PRIu64
+                        ", free list hits: %" PRIu64 ", recycled: %" PRIu64 ", deleted: %" PRIu64
+                        ", pooled memory: %zu bytes\n",
+                        stats.obtainedCount, stats.getHitRate() * 100, stats.threadCacheHitCount,
+                        stats.freeListHitCount, stats.recycledCount, stats.deletedCount,
+                        stats.pooledObjectsSize);
 }
 
 VehiclePropValuePool::RecyclableType VehiclePropValuePool::obtainBoolean(bool value) {
@@ -121,6 +242,18 @@ VehiclePropValuePool::RecyclableType VehiclePropValuePool::obtainDisposable(
                           mDisposableDeleter};
 }
 
+VehiclePropValuePool::InternalPool::InternalPool(VehiclePropertyType type,
+                                                 size_t vectorCapacity, size_t maxPoolObjectsSize)
+    // Account every pooled value by its capacity, which is the same for all values in this pool.
+    : ObjectPool(
+              maxPoolObjectsSize,
+              [valueSize = getPooledValueSize(type, vectorCapacity)](const VehiclePropValue&) {
+                  return valueSize;
+              },
+              maxPoolObjectsSize / getPooledValueSize(type, vectorCapacity)),
+      mPropType(type),
+      mVectorCapacity(vectorCapacity) {}
+
 void VehiclePropValuePool::InternalPool::recycle(VehiclePropValue* o) {
     if (o == nullptr) {
         ALOGE("Attempt to recycle nullptr");
@@ -130,8 +263,8 @@ void VehiclePropValuePool::InternalPool::recycle(VehiclePropValue* o) {
     if (!check(&o->value)) {
         ALOGE("Discarding value for prop 0x%x because it contains "
               "data that is not consistent with this pool. "
-              "Expected type: %d, vector size: %zu",
-              o->prop, toInt(mPropType), mVectorSize);
+              "Expected type: %d, vector capacity: %zu",
+              o->prop, toInt(mPropType), mVectorCapacity);
         delete o;
     } else {
         ObjectPool<VehiclePropValue>::recycle(o);
@@ -151,7 +284,7 @@ bool VehiclePropValuePool::InternalPool::check(RawPropValues* v) {
 }
 
 VehiclePropValue* VehiclePropValuePool::InternalPool::createObject() {
-    return createVehiclePropValueVec(mPropType, mVectorSize).release();
+    return createVehiclePropValueVec(mPropType, mVectorCapacity).release();
 }
 
 }  // namespace vehicle
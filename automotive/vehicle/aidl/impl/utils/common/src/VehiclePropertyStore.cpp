@@ -40,6 +40,36 @@ using ::aidl::android::hardware::automotive::vehicle::VehiclePropValue;
 using ::android::base::Result;
 using ::android::base::StringPrintf;
 
+namespace {
+
+// Checks that 'propValue' is not older than 'valueToUpdate', the stored value or nullptr if there
+// is none, and sets its status unless 'updateStatus'. Sets 'valueUpdated' to whether the value or
+// the status changes.
+VhalResult<void> prepareWrite(const VehiclePropValue* valueToUpdate, bool updateStatus,
+                              VehiclePropValue* propValue, bool* valueUpdated) {
+    if (valueToUpdate != nullptr) {
+        int64_t oldTimestampNanos = valueToUpdate->timestamp;
+        VehiclePropertyStatus oldStatus = valueToUpdate->status;
+        // propValue is outdated and drops it.
+        if (oldTimestampNanos > propValue->timestamp) {
+            return StatusError(StatusCode::INVALID_ARG)
+                   << "outdated timestampNanos: " << propValue->timestamp;
+        }
+        if (!updateStatus) {
+            propValue->status = oldStatus;
+        }
+
+        // areaId and propId must be the same between valueToUpdate and propValue.
+        *valueUpdated = (valueToUpdate->value != propValue->value ||
+                         valueToUpdate->status != propValue->status);
+    } else if (!updateStatus) {
+        propValue->status = VehiclePropertyStatus::AVAILABLE;
+    }
+    return {};
+}
+
+}  // namespace
+
 bool VehiclePropertyStore::RecordId::operator==(const VehiclePropertyStore::RecordId& other) const {
     return area == other.area && token == other.token;
 }
@@ -60,6 +90,10 @@ VehiclePropertyStore::~VehiclePropertyStore() {
 
     // Recycling record requires mValuePool, so need to recycle them before destroying mValuePool.
     mRecordsByPropId.clear();
+    for (Shard& shard : mShards) {
+        std::unique_lock<std::shared_mutex> g(shard.lock);
+        shard.recordsByPropId.clear();
+    }
     mValuePool.reset();
 }
 
@@ -75,14 +109,14 @@ VehiclePropertyStore::Record* VehiclePropertyStore::getRecordLocked(int32_t prop
     return RecordIt == mRecordsByPropId.end() ? nullptr : &RecordIt->second;
 }
 
-VehiclePropertyStore::RecordId VehiclePropertyStore::getRecordIdLocked(
-        const VehiclePropValue& propValue, const VehiclePropertyStore::Record& record) const
-        REQUIRES(mLock) {
+VehiclePropertyStore::RecordId VehiclePropertyStore::getRecordId(
+        const VehiclePropValue& propValue,
+        const VehiclePropertyStore::TokenFunction& tokenFunction) const {
     VehiclePropertyStore::RecordId recId{
             .area = isGlobalProp(propValue.prop) ? 0 : propValue.areaId, .token = 0};
 
-    if (record.tokenFunction != nullptr) {
-        recId.token = record.tokenFunction(propValue);
+    if (tokenFunction != nullptr) {
+        recId.token = tokenFunction(propValue);
     }
     return recId;
 }
@@ -96,8 +130,68 @@ VhalResult<VehiclePropValuePool::RecyclableType> VehiclePropertyStore::readValue
            << "Record ID: " << recId.toString() << " is not found";
 }
 
+void VehiclePropertyStore::getCallbacks(OnValueChangeCallback* onValueChangeCallback,
+                                        OnValuesChangeCallback* onValuesChangeCallback) const {
+    std::scoped_lock<std::mutex> g(mCallbackLock);
+
+    *onValueChangeCallback = mOnValueChangeCallback;
+    *onValuesChangeCallback = mOnValuesChangeCallback;
+}
+
+const VehiclePropertyStore::Shard& VehiclePropertyStore::getShard(int32_t propId) const {
+    return mShards[static_cast<uint32_t>(propId) % kShardCount];
+}
+
+VehiclePropertyStore::Shard& VehiclePropertyStore::getShard(int32_t propId) {
+    return mShards[static_cast<uint32_t>(propId) % kShardCount];
+}
+
+const VehiclePropertyStore::ShardedRecord* VehiclePropertyStore::getShardedRecord(
+        const Shard& shard, int32_t propId) {
+    auto recordIt = shard.recordsByPropId.find(propId);
+    return recordIt == shard.recordsByPropId.end() ? nullptr : &recordIt->second;
+}
+
+VehiclePropertyStore::ShardedRecord* VehiclePropertyStore::getShardedRecord(Shard& shard,
+                                                                            int32_t propId) {
+    auto recordIt = shard.recordsByPropId.find(propId);
+    return recordIt == shard.recordsByPropId.end() ? nullptr : &recordIt->second;
+}
+
+std::shared_ptr<const VehiclePropertyStore::ValueSnapshot> VehiclePropertyStore::loadValues(
+        const ShardedRecord& record) {
+    std::scoped_lock<std::mutex> g(record.snapshotLock);
+    return record.values;
+}
+
+void VehiclePropertyStore::storeValues(ShardedRecord& record,
+                                       std::shared_ptr<const ValueSnapshot> values) {
+    {
+        std::scoped_lock<std::mutex> g(record.snapshotLock);
+        record.values.swap(values);
+    }
+    // The previous snapshot is released here, outside the lock.
+}
+
+VhalResult<VehiclePropValuePool::RecyclableType> VehiclePropertyStore::readValueFromSnapshot(
+        const RecordId& recId, const ShardedRecord& record) const {
+    std::shared_ptr<const ValueSnapshot> values = loadValues(record);
+    if (values != nullptr) {
+        if (auto it = values->find(recId); it != values->end()) {
+            return mValuePool->obtain(*(it->second));
+        }
+    }
+    return StatusError(StatusCode::NOT_AVAILABLE)
+           << "Record ID: " << recId.toString() << " is not found";
+}
+
 void VehiclePropertyStore::registerProperty(const VehiclePropConfig& config,
                                             VehiclePropertyStore::TokenFunction tokenFunc) {
+    if (mStoreMode == StoreMode::SHARDED) {
+        registerPropertySharded(config, tokenFunc);
+        return;
+    }
+
     std::scoped_lock<std::mutex> g(mLock);
 
     mRecordsByPropId[config.prop] = Record{
@@ -106,16 +200,33 @@ void VehiclePropertyStore::registerProperty(const VehiclePropConfig& config,
     };
 }
 
+void VehiclePropertyStore::registerPropertySharded(const VehiclePropConfig& config,
+                                                   VehiclePropertyStore::TokenFunction tokenFunc) {
+    Shard& shard = getShard(config.prop);
+    std::unique_lock<std::shared_mutex> g(shard.lock);
+
+    // Updated in place, so that the pointers returned by getConfig stay valid. No writer holds
+    // the record while the shard is locked exclusively.
+    ShardedRecord& record = shard.recordsByPropId[config.prop];
+    record.propConfig = config;
+    record.tokenFunction = tokenFunc;
+    storeValues(record, nullptr);
+}
+
 VhalResult<void> VehiclePropertyStore::writeValue(VehiclePropValuePool::RecyclableType propValue,
                                                   bool updateStatus,
                                                   VehiclePropertyStore::EventMode eventMode,
                                                   bool useCurrentTimestamp) {
+    if (mStoreMode == StoreMode::SHARDED) {
+        return writeValueSharded(std::move(propValue), updateStatus, eventMode,
+                                 useCurrentTimestamp);
+    }
+
     bool valueUpdated = true;
     VehiclePropValue updatedValue;
     OnValueChangeCallback onValueChangeCallback = nullptr;
     OnValuesChangeCallback onValuesChangeCallback = nullptr;
     int32_t propId;
-    int32_t areaId;
     {
         std::scoped_lock<std::mutex> g(mLock);
 
@@ -126,7 +237,6 @@ VhalResult<void> VehiclePropertyStore::writeValue(VehiclePropValuePool::Recyclab
         }
 
         propId = propValue->prop;
-        areaId = propValue->areaId;
 
         VehiclePropertyStore::Record* record = getRecordLocked(propId);
         if (record == nullptr) {
@@ -139,25 +249,12 @@ VhalResult<void> VehiclePropertyStore::writeValue(VehiclePropValuePool::Recyclab
                    << "no config for property: " << propId << " area ID: " << propValue->areaId;
         }
 
-        VehiclePropertyStore::RecordId recId = getRecordIdLocked(*propValue, *record);
-        if (auto it = record->values.find(recId); it != record->values.end()) {
-            const VehiclePropValue* valueToUpdate = it->second.get();
-            int64_t oldTimestampNanos = valueToUpdate->timestamp;
-            VehiclePropertyStatus oldStatus = valueToUpdate->status;
-            // propValue is outdated and drops it.
-            if (oldTimestampNanos > propValue->timestamp) {
-                return StatusError(StatusCode::INVALID_ARG)
-                       << "outdated timestampNanos: " << propValue->timestamp;
-            }
-            if (!updateStatus) {
-                propValue->status = oldStatus;
-            }
-
-            // areaId and propId must be the same between valueToUpdate and propValue.
-            valueUpdated = (valueToUpdate->value != propValue->value ||
-                            valueToUpdate->status != propValue->status);
-        } else if (!updateStatus) {
-            propValue->status = VehiclePropertyStatus::AVAILABLE;
+        VehiclePropertyStore::RecordId recId = getRecordId(*propValue, record->tokenFunction);
+        auto it = record->values.find(recId);
+        if (auto result = prepareWrite(it == record->values.end() ? nullptr : it->second.get(),
+                                       updateStatus, propValue.get(), &valueUpdated);
+            !result.ok()) {
+            return result;
         }
 
         record->values[recId] = std::move(propValue);
@@ -167,8 +264,7 @@ VhalResult<void> VehiclePropertyStore::writeValue(VehiclePropValuePool::Recyclab
         }
         updatedValue = *(record->values[recId]);
 
-        onValuesChangeCallback = mOnValuesChangeCallback;
-        onValueChangeCallback = mOnValueChangeCallback;
+        getCallbacks(&onValueChangeCallback, &onValuesChangeCallback);
     }
 
     if (onValuesChangeCallback == nullptr && onValueChangeCallback == nullptr) {
@@ -187,6 +283,79 @@ VhalResult<void> VehiclePropertyStore::writeValue(VehiclePropValuePool::Recyclab
     return {};
 }
 
+VhalResult<void> VehiclePropertyStore::writeValueSharded(
+        VehiclePropValuePool::RecyclableType propValue, bool updateStatus,
+        VehiclePropertyStore::EventMode eventMode, bool useCurrentTimestamp) {
+    bool valueUpdated = true;
+    std::shared_ptr<const VehiclePropValue> updatedValue;
+    {
+        int32_t propId = propValue->prop;
+        Shard& shard = getShard(propId);
+        std::shared_lock<std::shared_mutex> shardLock(shard.lock);
+
+        VehiclePropertyStore::ShardedRecord* record = getShardedRecord(shard, propId);
+        if (record == nullptr) {
+            return StatusError(StatusCode::INVALID_ARG)
+                   << "property: " << propId << " not registered";
+        }
+
+        if (!isGlobalProp(propId) && getAreaConfig(*propValue, record->propConfig) == nullptr) {
+            return StatusError(StatusCode::INVALID_ARG)
+                   << "no config for property: " << propId << " area ID: " << propValue->areaId;
+        }
+
+        std::scoped_lock<std::mutex> g(record->writeLock);
+
+        // Must set timestamp inside the lock to make sure no other writeValue will update the
+        // the timestamp to a newer one while we are writing this value.
+        if (useCurrentTimestamp) {
+            propValue->timestamp = elapsedRealtimeNano();
+        }
+
+        std::shared_ptr<const ValueSnapshot> currentValues = loadValues(*record);
+        VehiclePropertyStore::RecordId recId = getRecordId(*propValue, record->tokenFunction);
+        const VehiclePropValue* valueToUpdate = nullptr;
+        if (currentValues != nullptr) {
+            if (auto it = currentValues->find(recId); it != currentValues->end()) {
+                valueToUpdate = it->second.get();
+            }
+        }
+        if (auto result = prepareWrite(valueToUpdate, updateStatus, propValue.get(), &valueUpdated);
+            !result.ok()) {
+            return result;
+        }
+
+        // The pooled value is kept, with its deleter, so that it is recycled once replaced.
+        updatedValue = std::move(propValue);
+        auto newValues = currentValues == nullptr ? std::make_shared<ValueSnapshot>()
+                                                  : std::make_shared<ValueSnapshot>(*currentValues);
+        (*newValues)[recId] = updatedValue;
+        storeValues(*record, std::move(newValues));
+    }
+
+    if (eventMode == EventMode::NEVER) {
+        return {};
+    }
+
+    OnValueChangeCallback onValueChangeCallback = nullptr;
+    OnValuesChangeCallback onValuesChangeCallback = nullptr;
+    getCallbacks(&onValueChangeCallback, &onValuesChangeCallback);
+    if (onValuesChangeCallback == nullptr && onValueChangeCallback == nullptr) {
+        // No callback registered.
+        return {};
+    }
+
+    // Invoke the callback outside the lock to prevent dead-lock.
+    if (eventMode == EventMode::ALWAYS || valueUpdated) {
+        if (onValuesChangeCallback != nullptr) {
+            onValuesChangeCallback({*updatedValue});
+        } else {
+            onValueChangeCallback(*updatedValue);
+        }
+    }
+    return {};
+}
+
 void VehiclePropertyStore::refreshTimestamp(int32_t propId, int32_t areaId, EventMode eventMode) {
     std::unordered_map<PropIdAreaId, EventMode, PropIdAreaIdHash> eventModeByPropIdAreaId;
     PropIdAreaId propIdAreaId = {
@@ -202,11 +371,13 @@ void VehiclePropertyStore::refreshTimestamps(
     std::vector<VehiclePropValue> updatedValues;
     OnValuesChangeCallback onValuesChangeCallback = nullptr;
     OnValueChangeCallback onValueChangeCallback = nullptr;
-    {
+    if (mStoreMode == StoreMode::SHARDED) {
+        getCallbacks(&onValueChangeCallback, &onValuesChangeCallback);
+        refreshTimestampsSharded(eventModeByPropIdAreaId, &updatedValues);
+    } else {
         std::scoped_lock<std::mutex> g(mLock);
 
-        onValuesChangeCallback = mOnValuesChangeCallback;
-        onValueChangeCallback = mOnValueChangeCallback;
+        getCallbacks(&onValueChangeCallback, &onValuesChangeCallback);
 
         for (const auto& [propIdAreaId, eventMode] : eventModeByPropIdAreaId) {
             int32_t propId = propIdAreaId.propId;
@@ -222,7 +393,7 @@ void VehiclePropertyStore::refreshTimestamps(
                     .value = {},
             };
 
-            VehiclePropertyStore::RecordId recId = getRecordIdLocked(propValue, *record);
+            VehiclePropertyStore::RecordId recId = getRecordId(propValue, record->tokenFunction);
             if (auto it = record->values.find(recId); it != record->values.end()) {
                 it->second->timestamp = elapsedRealtimeNano();
                 if (eventMode == EventMode::ALWAYS) {
@@ -257,7 +428,74 @@ void VehiclePropertyStore::refreshTimestamps(
     }
 }
 
+void VehiclePropertyStore::refreshTimestampsSharded(
+        const std::unordered_map<PropIdAreaId, EventMode, PropIdAreaIdHash>&
+                eventModeByPropIdAreaId,
+        std::vector<VehiclePropValue>* updatedValues) {
+    for (const auto& [propIdAreaId, eventMode] : eventModeByPropIdAreaId) {
+        int32_t propId = propIdAreaId.propId;
+        int32_t areaId = propIdAreaId.areaId;
+        Shard& shard = getShard(propId);
+        std::shared_lock<std::shared_mutex> shardLock(shard.lock);
+
+        VehiclePropertyStore::ShardedRecord* record = getShardedRecord(shard, propId);
+        if (record == nullptr) {
+            continue;
+        }
+
+        VehiclePropValue propValue = {
+                .areaId = areaId,
+                .prop = propId,
+                .value = {},
+        };
+
+        VehiclePropertyStore::RecordId recId = getRecordId(propValue, record->tokenFunction);
+
+        std::scoped_lock<std::mutex> g(record->writeLock);
+
+        std::shared_ptr<const ValueSnapshot> currentValues = loadValues(*record);
+        if (currentValues == nullptr) {
+            continue;
+        }
+        auto it = currentValues->find(recId);
+        if (it == currentValues->end()) {
+            continue;
+        }
+        VehiclePropValuePool::RecyclableType refreshedValue = mValuePool->obtain(*(it->second));
+        refreshedValue->timestamp = elapsedRealtimeNano();
+        if (eventMode == EventMode::ALWAYS) {
+            updatedValues->push_back(*refreshedValue);
+        }
+        auto newValues = std::make_shared<ValueSnapshot>(*currentValues);
+        (*newValues)[recId] = std::move(refreshedValue);
+        storeValues(*record, std::move(newValues));
+    }
+}
+
 void VehiclePropertyStore::removeValue(const VehiclePropValue& propValue) {
+    if (mStoreMode == StoreMode::SHARDED) {
+        Shard& shard = getShard(propValue.prop);
+        std::shared_lock<std::shared_mutex> shardLock(shard.lock);
+
+        VehiclePropertyStore::ShardedRecord* record = getShardedRecord(shard, propValue.prop);
+        if (record == nullptr) {
+            return;
+        }
+
+        VehiclePropertyStore::RecordId recId = getRecordId(propValue, record->tokenFunction);
+
+        std::scoped_lock<std::mutex> g(record->writeLock);
+
+        std::shared_ptr<const ValueSnapshot> currentValues = loadValues(*record);
+        if (currentValues == nullptr || currentValues->find(recId) == currentValues->end()) {
+            return;
+        }
+        auto newValues = std::make_shared<ValueSnapshot>(*currentValues);
+        newValues->erase(recId);
+        storeValues(*record, std::move(newValues));
+        return;
+    }
+
     std::scoped_lock<std::mutex> g(mLock);
 
     VehiclePropertyStore::Record* record = getRecordLocked(propValue.prop);
@@ -265,13 +503,27 @@ void VehiclePropertyStore::removeValue(const VehiclePropValue& propValue) {
         return;
     }
 
-    VehiclePropertyStore::RecordId recId = getRecordIdLocked(propValue, *record);
+    VehiclePropertyStore::RecordId recId = getRecordId(propValue, record->tokenFunction);
     if (auto it = record->values.find(recId); it != record->values.end()) {
         record->values.erase(it);
     }
 }
 
 void VehiclePropertyStore::removeValuesForProperty(int32_t propId) {
+    if (mStoreMode == StoreMode::SHARDED) {
+        Shard& shard = getShard(propId);
+        std::shared_lock<std::shared_mutex> shardLock(shard.lock);
+
+        VehiclePropertyStore::ShardedRecord* record = getShardedRecord(shard, propId);
+        if (record == nullptr) {
+            return;
+        }
+
+        std::scoped_lock<std::mutex> g(record->writeLock);
+        storeValues(*record, nullptr);
+        return;
+    }
+
     std::scoped_lock<std::mutex> g(mLock);
 
     VehiclePropertyStore::Record* record = getRecordLocked(propId);
@@ -283,10 +535,27 @@ void VehiclePropertyStore::removeValuesForProperty(int32_t propId) {
 }
 
 std::vector<VehiclePropValuePool::RecyclableType> VehiclePropertyStore::readAllValues() const {
-    std::scoped_lock<std::mutex> g(mLock);
-
     std::vector<VehiclePropValuePool::RecyclableType> allValues;
 
+    if (mStoreMode == StoreMode::SHARDED) {
+        for (const Shard& shard : mShards) {
+            std::shared_lock<std::shared_mutex> shardLock(shard.lock);
+
+            for (auto const& [_, record] : shard.recordsByPropId) {
+                std::shared_ptr<const ValueSnapshot> values = loadValues(record);
+                if (values == nullptr) {
+                    continue;
+                }
+                for (auto const& [_, value] : *values) {
+                    allValues.push_back(std::move(mValuePool->obtain(*value)));
+                }
+            }
+        }
+        return allValues;
+    }
+
+    std::scoped_lock<std::mutex> g(mLock);
+
     for (auto const& [_, record] : mRecordsByPropId) {
         for (auto const& [_, value] : record.values) {
             allValues.push_back(std::move(mValuePool->obtain(*value)));
@@ -298,10 +567,29 @@ std::vector<VehiclePropValuePool::RecyclableType> VehiclePropertyStore::readAllV
 
 VehiclePropertyStore::ValuesResultType VehiclePropertyStore::readValuesForProperty(
         int32_t propId) const {
-    std::scoped_lock<std::mutex> g(mLock);
-
     std::vector<VehiclePropValuePool::RecyclableType> values;
 
+    if (mStoreMode == StoreMode::SHARDED) {
+        const Shard& shard = getShard(propId);
+        std::shared_lock<std::shared_mutex> shardLock(shard.lock);
+
+        const VehiclePropertyStore::ShardedRecord* record = getShardedRecord(shard, propId);
+        if (record == nullptr) {
+            return StatusError(StatusCode::INVALID_ARG)
+                   << "property: " << propId << " not registered";
+        }
+
+        std::shared_ptr<const ValueSnapshot> currentValues = loadValues(*record);
+        if (currentValues != nullptr) {
+            for (auto const& [_, value] : *currentValues) {
+                values.push_back(std::move(mValuePool->obtain(*value)));
+            }
+        }
+        return values;
+    }
+
+    std::scoped_lock<std::mutex> g(mLock);
+
     const VehiclePropertyStore::Record* record = getRecordLocked(propId);
     if (record == nullptr) {
         return StatusError(StatusCode::INVALID_ARG) << "property: " << propId << " not registered";
@@ -315,21 +603,50 @@ VehiclePropertyStore::ValuesResultType VehiclePropertyStore::readValuesForProper
 
 VehiclePropertyStore::ValueResultType VehiclePropertyStore::readValue(
         const VehiclePropValue& propValue) const {
+    int32_t propId = propValue.prop;
+
+    if (mStoreMode == StoreMode::SHARDED) {
+        const Shard& shard = getShard(propId);
+        std::shared_lock<std::shared_mutex> shardLock(shard.lock);
+
+        const VehiclePropertyStore::ShardedRecord* record = getShardedRecord(shard, propId);
+        if (record == nullptr) {
+            return StatusError(StatusCode::INVALID_ARG)
+                   << "property: " << propId << " not registered";
+        }
+
+        return readValueFromSnapshot(getRecordId(propValue, record->tokenFunction), *record);
+    }
+
     std::scoped_lock<std::mutex> g(mLock);
 
-    int32_t propId = propValue.prop;
     const VehiclePropertyStore::Record* record = getRecordLocked(propId);
     if (record == nullptr) {
         return StatusError(StatusCode::INVALID_ARG) << "property: " << propId << " not registered";
     }
 
-    VehiclePropertyStore::RecordId recId = getRecordIdLocked(propValue, *record);
+    VehiclePropertyStore::RecordId recId = getRecordId(propValue, record->tokenFunction);
     return readValueLocked(recId, *record);
 }
 
 VehiclePropertyStore::ValueResultType VehiclePropertyStore::readValue(int32_t propId,
                                                                       int32_t areaId,
                                                                       int64_t token) const {
+    VehiclePropertyStore::RecordId recId{.area = isGlobalProp(propId) ? 0 : areaId, .token = token};
+
+    if (mStoreMode == StoreMode::SHARDED) {
+        const Shard& shard = getShard(propId);
+        std::shared_lock<std::shared_mutex> shardLock(shard.lock);
+
+        const VehiclePropertyStore::ShardedRecord* record = getShardedRecord(shard, propId);
+        if (record == nullptr) {
+            return StatusError(StatusCode::INVALID_ARG)
+                   << "property: " << propId << " not registered";
+        }
+
+        return readValueFromSnapshot(recId, *record);
+    }
+
     std::scoped_lock<std::mutex> g(mLock);
 
     const VehiclePropertyStore::Record* record = getRecordLocked(propId);
@@ -337,14 +654,25 @@ VehiclePropertyStore::ValueResultType VehiclePropertyStore::readValue(int32_t pr
         return StatusError(StatusCode::INVALID_ARG) << "property: " << propId << " not registered";
     }
 
-    VehiclePropertyStore::RecordId recId{.area = isGlobalProp(propId) ? 0 : areaId, .token = token};
     return readValueLocked(recId, *record);
 }
 
 std::vector<VehiclePropConfig> VehiclePropertyStore::getAllConfigs() const {
+    std::vector<VehiclePropConfig> configs;
+
+    if (mStoreMode == StoreMode::SHARDED) {
+        for (const Shard& shard : mShards) {
+            std::shared_lock<std::shared_mutex> shardLock(shard.lock);
+
+            for (auto& [_, record] : shard.recordsByPropId) {
+                configs.push_back(record.propConfig);
+            }
+        }
+        return configs;
+    }
+
     std::scoped_lock<std::mutex> g(mLock);
 
-    std::vector<VehiclePropConfig> configs;
     configs.reserve(mRecordsByPropId.size());
     for (auto& [_, config] : mRecordsByPropId) {
         configs.push_back(config.propConfig);
@@ -353,6 +681,20 @@ std::vector<VehiclePropConfig> VehiclePropertyStore::getAllConfigs() const {
 }
 
 VhalResult<const VehiclePropConfig*> VehiclePropertyStore::getConfig(int32_t propId) const {
+    if (mStoreMode == StoreMode::SHARDED) {
+        const Shard& shard = getShard(propId);
+        std::shared_lock<std::shared_mutex> shardLock(shard.lock);
+
+        const VehiclePropertyStore::ShardedRecord* record = getShardedRecord(shard, propId);
+        if (record == nullptr) {
+            return StatusError(StatusCode::INVALID_ARG)
+                   << "property: " << propId << " not registered";
+        }
+
+        // Sharded records are never removed, so the pointer stays valid.
+        return &record->propConfig;
+    }
+
     std::scoped_lock<std::mutex> g(mLock);
 
     const VehiclePropertyStore::Record* record = getRecordLocked(propId);
@@ -364,6 +706,19 @@ VhalResult<const VehiclePropConfig*> VehiclePropertyStore::getConfig(int32_t pro
 }
 
 VhalResult<VehiclePropConfig> VehiclePropertyStore::getPropConfig(int32_t propId) const {
+    if (mStoreMode == StoreMode::SHARDED) {
+        const Shard& shard = getShard(propId);
+        std::shared_lock<std::shared_mutex> shardLock(shard.lock);
+
+        const VehiclePropertyStore::ShardedRecord* record = getShardedRecord(shard, propId);
+        if (record == nullptr) {
+            return StatusError(StatusCode::INVALID_ARG)
+                   << "property: " << propId << " not registered";
+        }
+
+        return record->propConfig;
+    }
+
     std::scoped_lock<std::mutex> g(mLock);
 
     const VehiclePropertyStore::Record* record = getRecordLocked(propId);
@@ -376,14 +731,14 @@ VhalResult<VehiclePropConfig> VehiclePropertyStore::getPropConfig(int32_t propId
 
 void VehiclePropertyStore::setOnValueChangeCallback(
         const VehiclePropertyStore::OnValueChangeCallback& callback) {
-    std::scoped_lock<std::mutex> g(mLock);
+    std::scoped_lock<std::mutex> g(mCallbackLock);
 
     mOnValueChangeCallback = callback;
 }
 
 void VehiclePropertyStore::setOnValuesChangeCallback(
         const VehiclePropertyStore::OnValuesChangeCallback& callback) {
-    std::scoped_lock<std::mutex> g(mLock);
+    std::scoped_lock<std::mutex> g(mCallbackLock);
 
     mOnValuesChangeCallback = callback;
 }
@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <LatencyStats.h>
+#include <VehicleHalTypes.h>
+#include <VehicleUtils.h>
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+namespace {
+
+using ::aidl::android::hardware::automotive::vehicle::VehicleProperty;
+
+using Operation = PropertyLatencyStats::Operation;
+
+constexpr int64_t MICRO = 1'000;
+
+}  // namespace
+
+TEST(LatencyStatsTest, testGetBucketIndex) {
+    ASSERT_EQ(LatencyHistogram::getBucketIndex(-1), 0u);
+    ASSERT_EQ(LatencyHistogram::getBucketIndex(0), 0u);
+    ASSERT_EQ(LatencyHistogram::getBucketIndex(1 * MICRO), 0u);
+    ASSERT_EQ(LatencyHistogram::getBucketIndex(2 * MICRO), 1u);
+    ASSERT_EQ(LatencyHistogram::getBucketIndex(3 * MICRO), 1u);
+    ASSERT_EQ(LatencyHistogram::getBucketIndex(4 * MICRO), 2u);
+    ASSERT_EQ(LatencyHistogram::getBucketIndex(1024 * MICRO), 10u);
+    ASSERT_EQ(LatencyHistogram::getBucketIndex(INT64_MAX), LatencyHistogram::NUM_BUCKETS - 1);
+}
+
+TEST(LatencyStatsTest, testHistogramSnapshot) {
+    LatencyHistogram histogram;
+    for (int i = 0; i < 98; i++) {
+        histogram.record(3 * MICRO);
+    }
+    histogram.record(100 * MICRO);
+    histogram.record(1000 * MICRO);
+
+    auto snapshot = histogram.getSnapshot();
+
+    ASSERT_EQ(snapshot.count, 100u);
+    ASSERT_EQ(snapshot.maxInNanos, static_cast<uint64_t>(1000 * MICRO));
+    ASSERT_EQ(snapshot.totalInNanos, static_cast<uint64_t>((98 * 3 + 100 + 1000) * MICRO));
+    // The percentile is the upper bound of the bucket.
+    ASSERT_EQ(snapshot.getPercentileInNanos(50), static_cast<uint64_t>(4 * MICRO));
+    ASSERT_EQ(snapshot.getPercentileInNanos(99), static_cast<uint64_t>(128 * MICRO));
+    ASSERT_EQ(snapshot.getPercentileInNanos(100), static_cast<uint64_t>(1000 * MICRO));
+}
+
+TEST(LatencyStatsTest, testHistogramReset) {
+    LatencyHistogram histogram;
+    histogram.record(3 * MICRO);
+
+    histogram.reset();
+
+    auto snapshot = histogram.getSnapshot();
+    ASSERT_EQ(snapshot.count, 0u);
+    ASSERT_EQ(snapshot.maxInNanos, 0u);
+    ASSERT_EQ(snapshot.getPercentileInNanos(50), 0u);
+}
+
+TEST(LatencyStatsTest, testRecordPerPropertyPerOperation) {
+    PropertyLatencyStats stats;
+    int32_t speed = toInt(VehicleProperty::PERF_VEHICLE_SPEED);
+    int32_t gear = toInt(VehicleProperty::GEAR_SELECTION);
+
+    stats.record(speed, Operation::GET_VALUES, 10 * MICRO);
+    stats.record(speed, Operation::GET_VALUES, 20 * MICRO);
+    stats.record(speed, Operation::EVENT_DELIVERY, 5 * MICRO);
+    stats.record(gear, Operation::SET_VALUES, 30 * MICRO);
+
+    auto snapshots = stats.getSnapshots();
+
+    ASSERT_EQ(snapshots.size(), 2u);
+    // Snapshots are ordered by property ID.
+    ASSERT_LT(snapshots[0].propId, snapshots[1].propId);
+    for (const auto& snapshot : snapshots) {
+        const auto& histograms = snapshot.histograms;
+        if (snapshot.propId == speed) {
+            ASSERT_EQ(histograms[static_cast<size_t>(Operation::GET_VALUES)].count, 2u);
+            ASSERT_EQ(histograms[static_cast<size_t>(Operation::SET_VALUES)].count, 0u);
+            ASSERT_EQ(histograms[static_cast<size_t>(Operation::EVENT_DELIVERY)].count, 1u);
+        } else {
+            ASSERT_EQ(snapshot.propId, gear);
+            ASSERT_EQ(histograms[static_cast<size_t>(Operation::GET_VALUES)].count, 0u);
+            ASSERT_EQ(histograms[static_cast<size_t>(Operation::SET_VALUES)].count, 1u);
+        }
+    }
+}
+
+TEST(LatencyStatsTest, testTimeouts) {
+    PropertyLatencyStats stats;
+
+    stats.recordTimeouts(Operation::GET_VALUES, 2);
+    stats.recordTimeouts(Operation::SET_VALUES, 1);
+
+    ASSERT_EQ(stats.getTimeoutCount(Operation::GET_VALUES), 2u);
+    ASSERT_EQ(stats.getTimeoutCount(Operation::SET_VALUES), 1u);
+}
+
+TEST(LatencyStatsTest, testReset) {
+    PropertyLatencyStats stats;
+    stats.record(toInt(VehicleProperty::PERF_VEHICLE_SPEED), Operation::GET_VALUES, 10 * MICRO);
+    stats.recordTimeouts(Operation::GET_VALUES, 1);
+
+    stats.reset();
+
+    ASSERT_TRUE(stats.getSnapshots().empty());
+    ASSERT_EQ(stats.getTimeoutCount(Operation::GET_VALUES), 0u);
+}
+
+TEST(LatencyStatsTest, testOverflow) {
+    PropertyLatencyStats stats;
+
+    for (size_t i = 1; i <= PropertyLatencyStats::MAX_PROPERTIES + 1; i++) {
+        stats.record(static_cast<int32_t>(i), Operation::GET_VALUES, MICRO);
+    }
+
+    auto snapshots = stats.getSnapshots();
+    ASSERT_EQ(snapshots.size(), PropertyLatencyStats::MAX_PROPERTIES + 1);
+    // The overflow entry has property ID 0.
+    ASSERT_EQ(snapshots[0].propId, 0);
+    ASSERT_EQ(snapshots[0].histograms[static_cast<size_t>(Operation::GET_VALUES)].count, 1u);
+}
+
+TEST(LatencyStatsTest, testConcurrentRecord) {
+    PropertyLatencyStats stats;
+    constexpr int threadCount = 8;
+    constexpr int recordCount = 1000;
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < threadCount; i++) {
+        threads.emplace_back([&stats] {
+            for (int j = 0; j < recordCount; j++) {
+                stats.record(j % 16 + 1, Operation::GET_VALUES, j * MICRO);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto snapshots = stats.getSnapshots();
+    ASSERT_EQ(snapshots.size(), 16u);
+    uint64_t total = 0;
+    for (const auto& snapshot : snapshots) {
+        total += snapshot.histograms[static_cast<size_t>(Operation::GET_VALUES)].count;
+    }
+    ASSERT_EQ(total, static_cast<uint64_t>(threadCount * recordCount));
+}
+
+TEST(LatencyStatsTest, testDump) {
+    PropertyLatencyStats stats;
+    stats.record(toInt(VehicleProperty::PERF_VEHICLE_SPEED), Operation::SET_VALUES, 10 * MICRO);
+
+    std::string dump = stats.dump();
+
+    ASSERT_NE(dump.find("PERF_VEHICLE_SPEED, setValues: count: 1"), std::string::npos) << dump;
+}
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
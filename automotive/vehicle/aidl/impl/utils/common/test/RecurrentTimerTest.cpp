@@ -18,8 +18,10 @@
 
 #include <android-base/thread_annotations.h>
 #include <gtest/gtest.h>
+#include <utils/SystemClock.h>
 #include <condition_variable>
 
+#include <algorithm>
 #include <chrono>
 #include <memory>
 #include <mutex>
@@ -210,6 +212,92 @@ TEST_F(RecurrentTimerTest, testRegisterSameCallbackMultipleTimes) {
     ASSERT_EQ(countIdByCallback(&timer), 0u);
 }
 
+TEST_F(RecurrentTimerTest, testCallbacksWithSameIntervalShareWakeups) {
+    RecurrentTimer timer;
+    // 0.1s
+    int64_t interval = 100'000'000;
+
+    std::vector<std::shared_ptr<RecurrentTimer::Callback>> actions;
+    for (size_t i = 0; i < 10; i++) {
+        actions.push_back(getCallback(i));
+        timer.registerTimerCallback(interval, actions.back());
+    }
+
+    // Should only takes 0.5s, use 5s as timeout to be safe.
+    ASSERT_TRUE(waitForCalledCallbacks(/* count= */ 50u, /* timeoutInMs= */ 5000))
+            << "Not enough callbacks called before timeout";
+
+    for (const auto& action : actions) {
+        timer.unregisterTimerCallback(action);
+    }
+
+    RecurrentTimer::Stats stats = timer.getStats();
+    ASSERT_GE(stats.callbackCount, 50);
+    // All the callbacks are aligned to the same due time so they must be called in one wakeup,
+    // except for the first call right after registering.
+    ASSERT_LE(stats.wakeupCount, stats.callbackCount / 10 + 10);
+    ASSERT_LE(stats.maxJitterInNanos, interval);
+}
+
+TEST_F(RecurrentTimerTest, testSlackCoalescesCallbacks) {
+    // 20ms
+    int64_t slack = 20'000'000;
+    RecurrentTimer timer(slack);
+    // 0.1s
+    int64_t interval1 = 100'000'000;
+    // 0.11s
+    int64_t interval2 = 110'000'000;
+
+    auto action1 = getCallback(1);
+    auto action2 = getCallback(2);
+    timer.registerTimerCallback(interval1, action1);
+    timer.registerTimerCallback(interval2, action2);
+
+    // Should only takes about 1s, use 5s as timeout to be safe.
+    ASSERT_TRUE(waitForCalledCallbacks(/* count= */ 20u, /* timeoutInMs= */ 5000))
+            << "Not enough callbacks called before timeout";
+
+    timer.unregisterTimerCallback(action1);
+    timer.unregisterTimerCallback(action2);
+
+    RecurrentTimer::Stats stats = timer.getStats();
+    // Callbacks due within the slack window are called together, so there must be fewer
+    // wakeups than callbacks.
+    ASSERT_LT(stats.wakeupCount, stats.callbackCount);
+    ASSERT_NE(timer.dump(), "");
+}
+
+TEST_F(RecurrentTimerTest, testIntervalShorterThanSlack) {
+    // 20ms
+    int64_t slack = 20'000'000;
+    RecurrentTimer timer(slack);
+    // 3ms, 5ms and 7ms, so that a wakeup for one callback calls the others more than one of their
+    // intervals early.
+    std::vector<int64_t> intervals = {3'000'000, 5'000'000, 7'000'000};
+
+    std::vector<std::shared_ptr<RecurrentTimer::Callback>> actions;
+    int64_t startTimeInNanos = uptimeNanos();
+    for (size_t i = 0; i < intervals.size(); i++) {
+        actions.push_back(getCallback(i));
+        timer.registerTimerCallback(intervals[i], actions.back());
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    for (const auto& action : actions) {
+        timer.unregisterTimerCallback(action);
+    }
+    int64_t elapsedInNanos = uptimeNanos() - startTimeInNanos;
+
+    std::vector<size_t> calledCallbacks = getCalledCallbacks();
+    for (size_t i = 0; i < intervals.size(); i++) {
+        int64_t callCount = std::count(calledCallbacks.begin(), calledCallbacks.end(), i);
+        // A callback is called at most once per interval, plus the ones called early because of
+        // the slack. It must neither stop being called nor be called again in every wakeup.
+        EXPECT_GT(callCount, 0) << "interval: " << intervals[i];
+        EXPECT_LE(callCount, (elapsedInNanos + slack) / intervals[i] + 2)
+                << "interval: " << intervals[i];
+    }
+}
+
 TEST_F(RecurrentTimerTest, testRegisterCallbackMultipleTimesNoDeadLock) {
     // We want to avoid the following situation:
     // Caller holds a lock while calling registerTimerCallback, registerTimerCallback will try
@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TimerWheel.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+namespace {
+
+// 1ms
+constexpr int64_t TICK = 1'000'000;
+
+}  // namespace
+
+TEST(TimerWheelTest, testAdvanceExpiresDueTimers) {
+    TimerWheel wheel(TICK, /*startTimeInNanos=*/0);
+    wheel.schedule(/*id=*/1, 10 * TICK);
+    wheel.schedule(/*id=*/2, 5 * TICK);
+    wheel.schedule(/*id=*/3, 20 * TICK);
+
+    ASSERT_EQ(wheel.size(), 3u);
+    ASSERT_EQ(wheel.getNextDueTime(), 5 * TICK);
+
+    ASSERT_TRUE(wheel.advance(4 * TICK).empty());
+    ASSERT_EQ(wheel.advance(10 * TICK), std::vector<int32_t>({2, 1}));
+    ASSERT_EQ(wheel.size(), 1u);
+    ASSERT_EQ(wheel.getNextDueTime(), 20 * TICK);
+    ASSERT_EQ(wheel.advance(20 * TICK), std::vector<int32_t>({3}));
+    ASSERT_EQ(wheel.size(), 0u);
+    ASSERT_EQ(wheel.getNextDueTime(), std::nullopt);
+}
+
+TEST(TimerWheelTest, testAdvanceWithinTickDoesNotExpireEarly) {
+    TimerWheel wheel(TICK, /*startTimeInNanos=*/0);
+    wheel.schedule(/*id=*/1, 10 * TICK + TICK / 2);
+
+    ASSERT_TRUE(wheel.advance(10 * TICK).empty());
+    ASSERT_EQ(wheel.advance(10 * TICK + TICK / 2), std::vector<int32_t>({1}));
+}
+
+TEST(TimerWheelTest, testScheduleInThePast) {
+    TimerWheel wheel(TICK, /*startTimeInNanos=*/100 * TICK);
+    wheel.schedule(/*id=*/1, 10 * TICK);
+
+    ASSERT_EQ(wheel.getNextDueTime(), 10 * TICK);
+    ASSERT_EQ(wheel.advance(100 * TICK), std::vector<int32_t>({1}));
+}
+
+TEST(TimerWheelTest, testCancel) {
+    TimerWheel wheel(TICK, /*startTimeInNanos=*/0);
+    wheel.schedule(/*id=*/1, 10 * TICK);
+    wheel.schedule(/*id=*/2, 100'000 * TICK);
+
+    ASSERT_TRUE(wheel.cancel(1));
+    ASSERT_FALSE(wheel.cancel(1));
+    ASSERT_TRUE(wheel.cancel(2));
+    ASSERT_EQ(wheel.size(), 0u);
+    ASSERT_TRUE(wheel.advance(200'000 * TICK).empty());
+}
+
+TEST(TimerWheelTest, testReschedule) {
+    TimerWheel wheel(TICK, /*startTimeInNanos=*/0);
+    wheel.schedule(/*id=*/1, 10 * TICK);
+    wheel.schedule(/*id=*/1, 1000 * TICK);
+
+    ASSERT_EQ(wheel.size(), 1u);
+    ASSERT_TRUE(wheel.advance(999 * TICK).empty());
+    ASSERT_EQ(wheel.advance(1000 * TICK), std::vector<int32_t>({1}));
+}
+
+TEST(TimerWheelTest, testAllLevels) {
+    // Covers timers on every level and in the overflow list, advancing in uneven steps.
+    std::vector<int64_t> dueTicks = {1,      255,     256,     257,     1000,
+                                     16383,  16384,   16385,   100000,  1048575,
+                                     1048576, 1048577, 3000000, 5000000};
+    TimerWheel wheel(TICK, /*startTimeInNanos=*/7 * TICK);
+    std::map<int32_t, int64_t> dueTimeById;
+    for (size_t i = 0; i < dueTicks.size(); i++) {
+        int64_t dueTime = dueTicks[i] * TICK + 7 * TICK;
+        wheel.schedule(static_cast<int32_t>(i), dueTime);
+        dueTimeById[static_cast<int32_t>(i)] = dueTime;
+    }
+
+    int64_t now = 7 * TICK;
+    size_t expiredCount = 0;
+    while (wheel.size() > 0) {
+        std::optional<int64_t> nextDueTime = wheel.getNextDueTime();
+        ASSERT_TRUE(nextDueTime.has_value());
+        ASSERT_EQ(*nextDueTime, dueTicks[expiredCount] * TICK + 7 * TICK);
+
+        // Advancing to just before the due time must not expire anything.
+        ASSERT_TRUE(wheel.advance(*nextDueTime - 1).empty());
+        now = *nextDueTime;
+        std::vector<int32_t> expiredIds = wheel.advance(now);
+        ASSERT_EQ(expiredIds.size(), 1u);
+        ASSERT_EQ(dueTimeById[expiredIds[0]], now);
+        expiredCount++;
+    }
+    ASSERT_EQ(expiredCount, dueTicks.size());
+}
+
+TEST(TimerWheelTest, testCoalesceTimersInOneAdvance) {
+    TimerWheel wheel(TICK, /*startTimeInNanos=*/0);
+    for (int32_t i = 0; i < 100; i++) {
+        wheel.schedule(i, 1000 * TICK + i * 1000);
+    }
+
+    std::vector<int32_t> expiredIds = wheel.advance(1001 * TICK);
+
+    ASSERT_EQ(expiredIds.size(), 100u);
+    for (int32_t i = 0; i < 100; i++) {
+        ASSERT_EQ(expiredIds[i], i);
+    }
+}
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -342,6 +342,38 @@ TEST_F(VehicleObjectPoolTest, testObtainCopyMixed) {
     ASSERT_EQ(*gotValue, prop);
 }
 
+TEST_F(VehicleObjectPoolTest, testRecycleWithinCapacityClass) {
+    auto value = mValuePool->obtain(VehiclePropertyType::INT32_VEC, 3);
+    ASSERT_EQ(value->value.int32Values.size(), 3u);
+    void* raw = value.get();
+    value.reset();
+
+    // Vector size 3 and 4 are in the same capacity class, so the value must be reused.
+    value = mValuePool->obtain(VehiclePropertyType::INT32_VEC, 4);
+
+    ASSERT_EQ(value.get(), raw);
+    ASSERT_EQ(value->value.int32Values.size(), 4u);
+    ASSERT_EQ(mStats->Created, 1u);
+}
+
+TEST_F(VehicleObjectPoolTest, testGetStats) {
+    auto value = mValuePool->obtain(VehiclePropertyType::INT32);
+    value.reset();
+    value = mValuePool->obtain(VehiclePropertyType::INT32);
+
+    ObjectPoolStats stats = mValuePool->getStats();
+
+    ASSERT_EQ(stats.obtainedCount, 2u);
+    ASSERT_EQ(stats.threadCacheHitCount, 1u);
+    ASSERT_EQ(stats.recycledCount, 1u);
+    ASSERT_EQ(stats.pooledObjectsSize, 0u);
+    ASSERT_DOUBLE_EQ(stats.getHitRate(), 0.5);
+
+    value.reset();
+
+    ASSERT_GT(mValuePool->getStats().pooledObjectsSize, 0u);
+}
+
 TEST_F(VehicleObjectPoolTest, testMultithreaded) {
     // In this test we have T threads that concurrently in C cycles
     // obtain and release O VehiclePropValue objects of FLOAT / INT32 types.
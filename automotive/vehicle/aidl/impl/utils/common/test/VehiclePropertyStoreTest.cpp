@@ -22,6 +22,9 @@
 #include <gtest/gtest.h>
 #include <utils/SystemClock.h>
 
+#include <atomic>
+#include <thread>
+
 namespace android {
 namespace hardware {
 namespace automotive {
@@ -655,6 +658,122 @@ TEST_F(VehiclePropertyStoreTest, testRefreshTimestamps) {
     ASSERT_GE(updatedValues[1].timestamp, now);
 }
 
+TEST_F(VehiclePropertyStoreTest, testShardedStoreReadWrite) {
+    VehiclePropertyStore store(mValuePool, VehiclePropertyStore::StoreMode::SHARDED);
+    store.registerProperty(mConfigFuelCapacity);
+    std::vector<VehiclePropValue> updatedValues;
+    store.setOnValuesChangeCallback(
+            [&updatedValues](std::vector<VehiclePropValue> values) { updatedValues = values; });
+
+    VehiclePropValue fuelCapacity = {
+            .prop = toInt(VehicleProperty::INFO_FUEL_CAPACITY),
+            .value = {.floatValues = {1.0}},
+    };
+    ASSERT_RESULT_OK(store.writeValue(mValuePool->obtain(fuelCapacity)));
+
+    auto result = store.readValue(toInt(VehicleProperty::INFO_FUEL_CAPACITY));
+
+    ASSERT_RESULT_OK(result);
+    ASSERT_EQ(*(result.value()), fuelCapacity);
+    ASSERT_EQ(updatedValues, std::vector<VehiclePropValue>({fuelCapacity}));
+    ASSERT_EQ(store.getAllConfigs().size(), 1u);
+
+    store.removeValuesForProperty(toInt(VehicleProperty::INFO_FUEL_CAPACITY));
+
+    result = store.readValue(toInt(VehicleProperty::INFO_FUEL_CAPACITY));
+    ASSERT_FALSE(result.ok());
+    ASSERT_EQ(result.error().code(), StatusCode::NOT_AVAILABLE);
+}
+
+TEST_F(VehiclePropertyStoreTest, testShardedStoreConcurrentReadWrite) {
+    VehiclePropertyStore store(mValuePool, VehiclePropertyStore::StoreMode::SHARDED);
+    store.registerProperty(mConfigFuelCapacity);
+    int32_t propId = toInt(VehicleProperty::INFO_FUEL_CAPACITY);
+    constexpr int64_t kWriteCount = 1000;
+    ASSERT_RESULT_OK(store.writeValue(mValuePool->obtain(VehiclePropValue{
+            .timestamp = 0,
+            .prop = propId,
+            .value = {.int64Values = {0}},
+    })));
+
+    std::atomic<bool> done = false;
+    std::vector<std::thread> readers;
+    std::atomic<int> errorCount = 0;
+    for (int i = 0; i < 4; i++) {
+        readers.emplace_back([&] {
+            int64_t lastTimestamp = 0;
+            while (!done) {
+                auto result = store.readValue(propId);
+                if (!result.ok()) {
+                    errorCount++;
+                    continue;
+                }
+                // Each value's timestamp equals its payload, a torn read would break this.
+                const VehiclePropValue& value = *result.value();
+                if (value.value.int64Values.size() != 1 ||
+                    value.value.int64Values[0] != value.timestamp ||
+                    value.timestamp < lastTimestamp) {
+                    errorCount++;
+                }
+                lastTimestamp = value.timestamp;
+            }
+        });
+    }
+
+    for (int64_t i = 1; i <= kWriteCount; i++) {
+        ASSERT_RESULT_OK(store.writeValue(mValuePool->obtain(VehiclePropValue{
+                .timestamp = i,
+                .prop = propId,
+                .value = {.int64Values = {i}},
+        })));
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    ASSERT_EQ(errorCount, 0);
+    auto result = store.readValue(propId);
+    ASSERT_RESULT_OK(result);
+    ASSERT_EQ(result.value()->timestamp, kWriteCount);
+}
+
+TEST_F(VehiclePropertyStoreTest, testGetConfigAfterRegisterAgain) {
+    for (auto storeMode : {VehiclePropertyStore::StoreMode::GLOBAL_LOCK,
+                           VehiclePropertyStore::StoreMode::SHARDED}) {
+        VehiclePropertyStore store(mValuePool, storeMode);
+        store.registerProperty(mConfigFuelCapacity);
+        auto result = store.getConfig(toInt(VehicleProperty::INFO_FUEL_CAPACITY));
+        ASSERT_RESULT_OK(result);
+
+        VehiclePropConfig newConfig = mConfigFuelCapacity;
+        newConfig.access = VehiclePropertyAccess::READ_WRITE;
+        store.registerProperty(newConfig);
+
+        // The config is updated in place, so the pointer is still valid.
+        ASSERT_EQ(*result.value(), newConfig);
+    }
+}
+
+TEST_F(VehiclePropertyStoreTest, testShardedStoreRecyclesValues) {
+    VehiclePropertyStore store(mValuePool, VehiclePropertyStore::StoreMode::SHARDED);
+    store.registerProperty(mConfigFuelCapacity);
+    VehiclePropValue fuelCapacity = {
+            .timestamp = 1,
+            .prop = toInt(VehicleProperty::INFO_FUEL_CAPACITY),
+            .value = {.floatValues = {1.0}},
+    };
+    ASSERT_RESULT_OK(store.writeValue(mValuePool->obtain(fuelCapacity)));
+    uint64_t recycledCount = mValuePool->getStats().recycledCount;
+
+    fuelCapacity.timestamp = 2;
+    fuelCapacity.value.floatValues = {2.0};
+    ASSERT_RESULT_OK(store.writeValue(mValuePool->obtain(fuelCapacity)));
+
+    // The replaced value goes back to the pool.
+    ASSERT_EQ(mValuePool->getStats().recycledCount, recycledCount + 1);
+}
+
 }  // namespace vehicle
 }  // namespace automotive
 }  // namespace hardware
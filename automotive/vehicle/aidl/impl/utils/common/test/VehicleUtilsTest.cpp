@@ -764,6 +764,147 @@ TEST(VehicleUtilsTest, testConcurrentQueueDeactivateNotifyWaitingThread) {
     t.join();
 }
 
+TEST(VehicleUtilsTest, testConcurrentRingQueueOneThread) {
+    ConcurrentRingQueue<int> queue(/*capacity=*/4, QueueOverflowPolicy::BLOCK);
+
+    queue.push(1);
+    queue.push(std::vector<int>({2, 3}));
+    auto result = queue.flush();
+
+    ASSERT_EQ(result, std::vector<int>({1, 2, 3}));
+    ASSERT_TRUE(queue.flush().empty());
+}
+
+TEST(VehicleUtilsTest, testConcurrentRingQueueCapacityRoundUp) {
+    ConcurrentRingQueue<int> queue(/*capacity=*/5, QueueOverflowPolicy::DROP_OLDEST);
+    ConcurrentRingQueue<int> minQueue(/*capacity=*/1, QueueOverflowPolicy::DROP_OLDEST);
+
+    ASSERT_EQ(queue.getCapacity(), 8u);
+    ASSERT_EQ(minQueue.getCapacity(), 2u);
+}
+
+TEST(VehicleUtilsTest, testConcurrentRingQueueDropOldest) {
+    ConcurrentRingQueue<int> queue(/*capacity=*/4, QueueOverflowPolicy::DROP_OLDEST);
+
+    for (int i = 0; i < 6; i++) {
+        queue.push(std::move(i));
+    }
+
+    ASSERT_EQ(queue.flush(), std::vector<int>({2, 3, 4, 5}));
+    ASSERT_EQ(queue.getDroppedCount(), 2u);
+}
+
+TEST(VehicleUtilsTest, testConcurrentRingQueueCoalesceByKey) {
+    // The key is the tens digit.
+    ConcurrentRingQueue<int> queue(/*capacity=*/2, QueueOverflowPolicy::COALESCE_BY_KEY,
+                                   [](const int& item) { return item / 10; });
+
+    queue.push(std::vector<int>({1, 2, 11, 21, 12, 3, 13}));
+
+    // 1 and 2 are in the ring, the others are coalesced by key in the order the keys first
+    // overflowed.
+    ASSERT_EQ(queue.flush(), std::vector<int>({1, 2, 13, 21, 3}));
+    ASSERT_EQ(queue.getCoalescedCount(), 2u);
+
+    // The ring is used again after the side table is flushed.
+    queue.push(4);
+    ASSERT_EQ(queue.flush(), std::vector<int>({4}));
+}
+
+TEST(VehicleUtilsTest, testConcurrentRingQueueBlock) {
+    ConcurrentRingQueue<int> queue(/*capacity=*/2, QueueOverflowPolicy::BLOCK);
+    std::atomic<bool> pushed = false;
+
+    queue.push(std::vector<int>({1, 2}));
+    std::thread t([&queue, &pushed]() {
+        // This would block until the queue is flushed.
+        queue.push(3);
+        pushed = true;
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    ASSERT_FALSE(pushed);
+    ASSERT_EQ(queue.flush(), std::vector<int>({1, 2}));
+
+    t.join();
+    ASSERT_TRUE(pushed);
+    ASSERT_EQ(queue.flush(), std::vector<int>({3}));
+}
+
+TEST(VehicleUtilsTest, testConcurrentRingQueueDeactivateUnblockProducer) {
+    ConcurrentRingQueue<int> queue(/*capacity=*/2, QueueOverflowPolicy::BLOCK);
+    queue.push(std::vector<int>({1, 2}));
+
+    std::thread t([&queue]() {
+        // This would block until queue is deactivated.
+        queue.push(3);
+    });
+
+    queue.deactivate();
+    t.join();
+
+    ASSERT_EQ(queue.flush(), std::vector<int>({1, 2}));
+}
+
+TEST(VehicleUtilsTest, testConcurrentRingQueueMultipleThreads) {
+    ConcurrentRingQueue<int> queue(/*capacity=*/16, QueueOverflowPolicy::BLOCK);
+    constexpr int threadCount = 4;
+    constexpr int pushCount = 10000;
+    std::vector<int> results;
+    std::atomic<bool> stop = false;
+
+    std::vector<std::thread> producers;
+    for (int i = 0; i < threadCount; i++) {
+        producers.emplace_back([&queue, i]() {
+            for (int j = 0; j < pushCount; j++) {
+                queue.push(i * pushCount + j);
+            }
+        });
+    }
+    std::thread consumer([&queue, &results, &stop]() {
+        while (!stop) {
+            queue.waitForItems();
+            for (int i : queue.flush()) {
+                results.push_back(i);
+            }
+        }
+
+        // After we stop, get all the remaining values in the queue.
+        for (int i : queue.flush()) {
+            results.push_back(i);
+        }
+    });
+
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    stop = true;
+    queue.deactivate();
+    consumer.join();
+
+    ASSERT_EQ(results.size(), static_cast<size_t>(threadCount * pushCount));
+    // Items from the same producer keep their order.
+    std::vector<int> lastValues(threadCount, -1);
+    for (int value : results) {
+        int producer = value / pushCount;
+        ASSERT_GT(value, lastValues[producer]);
+        lastValues[producer] = value;
+    }
+}
+
+TEST(VehicleUtilsTest, testConcurrentRingQueueDeactivateNotifyWaitingThread) {
+    ConcurrentRingQueue<int> queue(/*capacity=*/4, QueueOverflowPolicy::BLOCK);
+
+    std::thread t([&queue]() {
+        // This would block until queue is deactivated.
+        queue.waitForItems();
+    });
+
+    queue.deactivate();
+
+    t.join();
+}
+
 TEST(VehicleUtilsTest, testVhalError) {
     VhalResult<void> result = Error<VhalError>(StatusCode::INVALID_ARG) << "error message";
 
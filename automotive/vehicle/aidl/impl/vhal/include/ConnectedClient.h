@@ -18,8 +18,10 @@
 #define android_hardware_automotive_vehicle_aidl_impl_vhal_include_ConnectedClient_H_
 
 #include "PendingRequestPool.h"
+#include "SharedMemoryPool.h"
 
 #include <IVehicleHardware.h>
+#include <LatencyStats.h>
 #include <VehicleHalTypes.h>
 #include <VehicleUtils.h>
 
@@ -77,7 +79,9 @@ class ConnectedClient {
 template <class ResultType, class ResultsType>
 class GetSetValuesClient final : public ConnectedClient {
   public:
-    GetSetValuesClient(std::shared_ptr<PendingRequestPool> requestPool, CallbackType callback);
+    // If 'latencyStats' is not nullptr, the timed-out requests are counted in it.
+    GetSetValuesClient(std::shared_ptr<PendingRequestPool> requestPool, CallbackType callback,
+                       std::shared_ptr<PropertyLatencyStats> latencyStats = nullptr);
 
     // Sends the results to this client.
     void sendResults(std::vector<ResultType>&& results);
@@ -105,11 +109,13 @@ class SubscriptionClient {
             std::shared_ptr<aidl::android::hardware::automotive::vehicle::IVehicleCallback>;
 
     // Marshals the updated values into largeParcelable and sends it through {@code onPropertyEvent}
-    // callback.
+    // callback. If 'sharedMemoryPool' is not nullptr, large payloads are delivered through one of
+    // the client's pooled shared memory files.
     static void sendUpdatedValues(
             CallbackType callback,
             std::vector<aidl::android::hardware::automotive::vehicle::VehiclePropValue>&&
-                    updatedValues);
+                    updatedValues,
+            SharedMemoryPool* sharedMemoryPool = nullptr);
     // Marshals the set property error events into largeParcelable and sends it through
     // {@code onPropertySetError} callback.
     static void sendPropertySetErrors(
@@ -25,6 +25,7 @@
 
 #include <ConcurrentQueue.h>
 #include <IVehicleHardware.h>
+#include <LatencyStats.h>
 #include <VehicleUtils.h>
 #include <aidl/android/hardware/automotive/vehicle/BnVehicle.h>
 #include <android-base/expected.h>
@@ -121,17 +122,26 @@ class DefaultVehicleHal final : public aidlvhal::BnVehicle {
     static constexpr int64_t TIMEOUT_IN_NANO = 30'000'000'000;
     // heart beat event interval: 3s
     static constexpr int64_t HEART_BEAT_INTERVAL_IN_NANO = 3'000'000'000;
+    // The dump options to print or reset the latency stats.
+    static constexpr const char* DUMP_STATS_OPTION = "--stats";
+    static constexpr const char* DUMP_STATS_RESET_OPTION = "--reset";
+    // The max number of property change events waiting to be batched. Producers are blocked when
+    // the queue is full until the batching consumer flushes it.
+    static constexpr size_t BATCHED_EVENT_QUEUE_CAPACITY = 4096;
     bool mShouldRefreshPropertyConfigs;
     std::unique_ptr<IVehicleHardware> mVehicleHardware;
 
     // PendingRequestPool is thread-safe.
     std::shared_ptr<PendingRequestPool> mPendingRequestPool;
+    // PropertyLatencyStats is thread-safe.
+    std::shared_ptr<PropertyLatencyStats> mLatencyStats;
     // SubscriptionManager is thread-safe.
     std::shared_ptr<SubscriptionManager> mSubscriptionManager;
-    // ConcurrentQueue is thread-safe.
-    std::shared_ptr<ConcurrentQueue<aidlvhal::VehiclePropValue>> mBatchedEventQueue;
+    // ConcurrentRingQueue is thread-safe.
+    std::shared_ptr<ConcurrentRingQueue<aidlvhal::VehiclePropValue>> mBatchedEventQueue;
     // BatchingConsumer is thread-safe.
-    std::shared_ptr<BatchingConsumer<aidlvhal::VehiclePropValue>>
+    std::shared_ptr<BatchingConsumer<aidlvhal::VehiclePropValue,
+                                     ConcurrentRingQueue<aidlvhal::VehiclePropValue>>>
             mPropertyChangeEventsBatchingConsumer;
     // Only set once during initialization.
     std::chrono::nanoseconds mEventBatchingWindow;
@@ -204,6 +214,9 @@ class DefaultVehicleHal final : public aidlvhal::BnVehicle {
 
     size_t countSubscribeClients();
 
+    // Handles the "--stats [--reset]" dump options.
+    void dumpLatencyStats(int fd, const std::vector<std::string>& options);
+
     // Handles the property change events in batch.
     void handleBatchedPropertyEvents(std::vector<aidlvhal::VehiclePropValue>&& batchedEvents);
 
@@ -216,17 +229,21 @@ class DefaultVehicleHal final : public aidlvhal::BnVehicle {
 
     // Puts the property change events into a queue so that they can handled in batch.
     static void batchPropertyChangeEvent(
-            const std::weak_ptr<ConcurrentQueue<aidlvhal::VehiclePropValue>>& batchedEventQueue,
+            const std::weak_ptr<ConcurrentRingQueue<aidlvhal::VehiclePropValue>>&
+                    batchedEventQueue,
             std::vector<aidlvhal::VehiclePropValue>&& updatedValues);
 
     // Gets or creates a {@code T} object for the client to or from {@code clients}.
     template <class T>
     static std::shared_ptr<T> getOrCreateClient(
             std::unordered_map<const AIBinder*, std::shared_ptr<T>>* clients,
-            const CallbackType& callback, std::shared_ptr<PendingRequestPool> pendingRequestPool);
+            const CallbackType& callback, std::shared_ptr<PendingRequestPool> pendingRequestPool,
+            std::shared_ptr<PropertyLatencyStats> latencyStats);
 
+    // If 'latencyStats' is not nullptr, the delivery latency of each event is recorded in it.
     static void onPropertyChangeEvent(const std::weak_ptr<SubscriptionManager>& subscriptionManager,
-                                      std::vector<aidlvhal::VehiclePropValue>&& updatedValues);
+                                      std::vector<aidlvhal::VehiclePropValue>&& updatedValues,
+                                      PropertyLatencyStats* latencyStats = nullptr);
 
     static void onPropertySetErrorEvent(
             const std::weak_ptr<SubscriptionManager>& subscriptionManager,
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef android_hardware_automotive_vehicle_aidl_impl_vhal_include_SharedMemoryPool_H_
+#define android_hardware_automotive_vehicle_aidl_impl_vhal_include_SharedMemoryPool_H_
+
+#include <VehicleHalTypes.h>
+
+#include <android-base/thread_annotations.h>
+#include <android/binder_auto_utils.h>
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+// A pool of shared memory files used to deliver large {@code onPropertyEvent} payloads to one
+// subscription client.
+//
+// If the marshalled payload is larger than the inline threshold, it is written into a pooled
+// shared memory file instead of being sent through binder. The file's ID is passed to the client
+// via {@code VehiclePropValues.sharedMemoryId} and the file is not reused until the client returns
+// it via {@code IVehicle.returnSharedMemory}. At most {@code maxFileCount} files are allocated. If
+// all of them are in use, the payload falls back to a one-shot shared memory file.
+//
+// The layout of the shared memory file is the same as the one created by
+// {@code LargeParcelableBase}, so clients do not need to know whether a file is pooled.
+//
+// This class is thread-safe.
+class SharedMemoryPool final {
+  public:
+    // Payloads with a marshalled size no larger than this are sent inline through binder.
+    static constexpr size_t DEFAULT_INLINE_THRESHOLD_BYTES = 4 * 1024;
+
+    struct Stats {
+        // The number of payloads sent inline through binder.
+        uint64_t inlineCount = 0;
+        // The number of payloads written into a pooled shared memory file.
+        uint64_t pooledCount = 0;
+        // The number of payloads that reused an existing pooled file, without allocating.
+        uint64_t reusedCount = 0;
+        // The number of payloads that fell back to a one-shot shared memory file because all
+        // pooled files were in use.
+        uint64_t fallbackCount = 0;
+        // The number of shared memory files allocated by this pool.
+        uint64_t allocatedFileCount = 0;
+        // The total size of shared memory files allocated by this pool.
+        uint64_t allocatedBytes = 0;
+    };
+
+    explicit SharedMemoryPool(int32_t maxFileCount,
+                              size_t inlineThresholdBytes = DEFAULT_INLINE_THRESHOLD_BYTES);
+
+    ~SharedMemoryPool();
+
+    // Moves the values into 'output'. If the marshalled values are larger than the inline
+    // threshold, they are written into a shared memory file and 'output.sharedMemoryId' and
+    // 'output.sharedMemoryFd' are filled in.
+    ndk::ScopedAStatus toVehiclePropValues(
+            std::vector<aidl::android::hardware::automotive::vehicle::VehiclePropValue>&& values,
+            aidl::android::hardware::automotive::vehicle::VehiclePropValues* output)
+            EXCLUDES(mLock);
+
+    // Marks the shared memory file as no longer used by the client, so it could be reused.
+    // Returns false if 'sharedMemoryId' does not match any file that is in use.
+    bool returnSharedMemory(int64_t sharedMemoryId) EXCLUDES(mLock);
+
+    // Gets the number of shared memory files allocated by this pool.
+    int32_t getFileCount() const EXCLUDES(mLock);
+
+    // Updates the maximum number of files. Existing files beyond the new limit are kept until
+    // the pool is destroyed.
+    void setMaxFileCount(int32_t maxFileCount) EXCLUDES(mLock);
+
+    Stats getStats() const EXCLUDES(mLock);
+
+    SharedMemoryPool(const SharedMemoryPool&) = delete;
+    SharedMemoryPool& operator=(const SharedMemoryPool&) = delete;
+
+  private:
+    struct MemoryFile {
+        int64_t id;
+        ndk::ScopedFileDescriptor fd;
+        uint8_t* buffer;
+        size_t capacity;
+        bool inUse;
+    };
+
+    const size_t mInlineThresholdBytes;
+
+    mutable std::mutex mLock;
+    int32_t mMaxFileCount GUARDED_BY(mLock);
+    std::vector<MemoryFile> mFiles GUARDED_BY(mLock);
+    int64_t mNextId GUARDED_BY(mLock);
+    Stats mStats GUARDED_BY(mLock);
+
+    // Gets a free file with at least 'size' bytes, allocating or growing one if necessary.
+    // Returns nullptr if all the files are in use.
+    MemoryFile* obtainFileLocked(size_t size) REQUIRES(mLock);
+
+    static bool allocateFile(size_t capacity, MemoryFile* file);
+
+    static void releaseFile(MemoryFile* file);
+};
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif  // android_hardware_automotive_vehicle_aidl_impl_vhal_include_SharedMemoryPool_H_
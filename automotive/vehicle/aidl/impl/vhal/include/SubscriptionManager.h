@@ -18,6 +18,7 @@
 #define android_hardware_automotive_vehicle_aidl_impl_vhal_include_SubscriptionManager_H_
 
 #include <IVehicleHardware.h>
+#include <SharedMemoryPool.h>
 #include <VehicleHalTypes.h>
 #include <VehicleUtils.h>
 
@@ -110,6 +111,8 @@ class SubscriptionManager final {
     // For a list of updated properties, returns a map that maps clients subscribing to
     // the updated properties to a list of updated values. This would only return on-change property
     // clients that should be informed for the given updated values.
+    // If the same continuous [propId, areaId] is updated more than once in 'updatedValues', only
+    // the latest value is returned since clients only need the latest sample.
     std::unordered_map<CallbackType, std::vector<VehiclePropValue>> getSubscribedClients(
             std::vector<VehiclePropValue>&& updatedValues);
 
@@ -122,6 +125,13 @@ class SubscriptionManager final {
     // Returns the number of subscribed clients.
     size_t countClients();
 
+    // Sets the maximum number of shared memory files used to deliver large property events to the
+    // client. If 'maxSharedMemoryFileCount' is 0, no shared memory file is pooled for the client.
+    void setMaxSharedMemoryFileCount(ClientIdType client, int32_t maxSharedMemoryFileCount);
+
+    // Returns the shared memory pool for the client, or nullptr if the client does not use one.
+    std::shared_ptr<SharedMemoryPool> getSharedMemoryPool(ClientIdType client) const;
+
     // Checks whether the sample rate is valid.
     static bool checkSampleRateHz(float sampleRateHz);
 
@@ -149,6 +159,23 @@ class SubscriptionManager final {
         }
     };
 
+    // One client to deliver the events for a [propId, areaId] to.
+    struct FanOutTarget {
+        CallbackType callback;
+        // The resolution to sanitize the value by, 0 if no sanitization is required.
+        float resolution;
+        // Whether the client enables VUR but IVehicleHardware does not, so unchanged values must
+        // be filtered out here.
+        bool filterVur;
+    };
+
+    // All the clients to deliver the events for a [propId, areaId] to. This is computed when the
+    // subscriptions change so that delivering an event does not need to look up the configs.
+    struct FanOut {
+        bool isContinuous;
+        std::vector<FanOutTarget> targets;
+    };
+
     mutable std::mutex mLock;
     std::unordered_map<PropIdAreaId, std::unordered_map<ClientIdType, CallbackType>,
                        PropIdAreaIdHash>
@@ -161,6 +188,10 @@ class SubscriptionManager final {
                        std::unordered_set<VehiclePropValue, VehiclePropValueHashPropIdAreaId,
                                           VehiclePropValueEqualPropIdAreaId>>
             mContSubValuesByCallback GUARDED_BY(mLock);
+    std::unordered_map<ClientIdType, std::shared_ptr<SharedMemoryPool>> mSharedMemoryPoolByClient
+            GUARDED_BY(mLock);
+    std::unordered_map<PropIdAreaId, FanOut, PropIdAreaIdHash> mFanOutByPropIdAreaId
+            GUARDED_BY(mLock);
 
     VhalResult<void> addContinuousSubscriberLocked(const ClientIdType& clientId,
                                                    const PropIdAreaId& propIdAreaId,
@@ -182,6 +213,9 @@ class SubscriptionManager final {
                                                    const PropIdAreaId& propIdAreaId)
             REQUIRES(mLock);
 
+    // Rebuilds the fan-out for the [propId, areaId] from the current subscriptions.
+    void refreshFanOutLocked(const PropIdAreaId& propIdAreaId) REQUIRES(mLock);
+
     // Checks whether the manager is empty. For testing purpose.
     bool isEmpty();
 
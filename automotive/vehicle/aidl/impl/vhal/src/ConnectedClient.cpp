@@ -22,6 +22,7 @@
 #include <utils/Log.h>
 
 #include <inttypes.h>
+#include <type_traits>
 #include <unordered_set>
 #include <vector>
 
@@ -113,7 +114,13 @@ void sendGetOrSetValueResults(std::shared_ptr<IVehicleCallback> callback,
 template <class ResultType, class ResultsType>
 void onTimeout(
         std::shared_ptr<::aidl::android::hardware::automotive::vehicle::IVehicleCallback> callback,
-        const std::unordered_set<int64_t>& timeoutIds) {
+        const std::unordered_set<int64_t>& timeoutIds, PropertyLatencyStats* latencyStats) {
+    if (latencyStats != nullptr) {
+        latencyStats->recordTimeouts(std::is_same_v<ResultType, GetValueResult>
+                                             ? PropertyLatencyStats::Operation::GET_VALUES
+                                             : PropertyLatencyStats::Operation::SET_VALUES,
+                                     timeoutIds.size());
+    }
     std::vector<ResultType> timeoutResults;
     for (int64_t requestId : timeoutIds) {
         ALOGD("hardware request timeout, request ID: %" PRId64, requestId);
@@ -174,10 +181,10 @@ template void sendGetOrSetValueResultsSeparately<SetValueResult, SetValueResults
 
 template void onTimeout<GetValueResult, GetValueResults>(
         std::shared_ptr<::aidl::android::hardware::automotive::vehicle::IVehicleCallback> callback,
-        const std::unordered_set<int64_t>& timeoutIds);
+        const std::unordered_set<int64_t>& timeoutIds, PropertyLatencyStats* latencyStats);
 template void onTimeout<SetValueResult, SetValueResults>(
         std::shared_ptr<::aidl::android::hardware::automotive::vehicle::IVehicleCallback> callback,
-        const std::unordered_set<int64_t>& timeoutIds);
+        const std::unordered_set<int64_t>& timeoutIds, PropertyLatencyStats* latencyStats);
 
 template void getOrSetValuesCallback<GetValueResult, GetValueResults>(
         const void* clientId,
@@ -209,11 +216,13 @@ std::unordered_set<int64_t> ConnectedClient::tryFinishRequests(
 
 template <class ResultType, class ResultsType>
 GetSetValuesClient<ResultType, ResultsType>::GetSetValuesClient(
-        std::shared_ptr<PendingRequestPool> requestPool, std::shared_ptr<IVehicleCallback> callback)
+        std::shared_ptr<PendingRequestPool> requestPool, std::shared_ptr<IVehicleCallback> callback,
+        std::shared_ptr<PropertyLatencyStats> latencyStats)
     : ConnectedClient(requestPool, callback) {
     mTimeoutCallback = std::make_shared<const PendingRequestPool::TimeoutCallbackFunc>(
-            [callback](const std::unordered_set<int64_t>& timeoutIds) {
-                return onTimeout<ResultType, ResultsType>(callback, timeoutIds);
+            [callback, latencyStats](const std::unordered_set<int64_t>& timeoutIds) {
+                return onTimeout<ResultType, ResultsType>(callback, timeoutIds,
+                                                          latencyStats.get());
             });
     auto requestPoolCopy = mRequestPool;
     const void* clientId = id();
@@ -251,16 +260,22 @@ template class GetSetValuesClient<GetValueResult, GetValueResults>;
 template class GetSetValuesClient<SetValueResult, SetValueResults>;
 
 void SubscriptionClient::sendUpdatedValues(std::shared_ptr<IVehicleCallback> callback,
-                                           std::vector<VehiclePropValue>&& updatedValues) {
+                                           std::vector<VehiclePropValue>&& updatedValues,
+                                           SharedMemoryPool* sharedMemoryPool) {
     if (updatedValues.empty()) {
         return;
     }
 
-    // TODO(b/205189110): Use memory pool here and fill in sharedMemoryId.
     VehiclePropValues vehiclePropValues;
     int32_t sharedMemoryFileCount = 0;
-    ScopedAStatus status =
-            vectorToStableLargeParcelable(std::move(updatedValues), &vehiclePropValues);
+    ScopedAStatus status;
+    if (sharedMemoryPool != nullptr) {
+        status = sharedMemoryPool->toVehiclePropValues(std::move(updatedValues),
+                                                       &vehiclePropValues);
+        sharedMemoryFileCount = sharedMemoryPool->getFileCount();
+    } else {
+        status = vectorToStableLargeParcelable(std::move(updatedValues), &vehiclePropValues);
+    }
     if (!status.isOk()) {
         int statusCode = status.getServiceSpecificError();
         ALOGE("subscribe: failed to marshal result into large parcelable, error: "
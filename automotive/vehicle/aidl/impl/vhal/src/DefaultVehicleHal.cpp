@@ -34,6 +34,7 @@
 #include <utils/Trace.h>
 
 #include <inttypes.h>
+#include <algorithm>
 #include <chrono>
 #include <set>
 #include <unordered_set>
@@ -49,6 +50,7 @@ using ::aidl::android::hardware::automotive::vehicle::GetValueRequest;
 using ::aidl::android::hardware::automotive::vehicle::GetValueRequests;
 using ::aidl::android::hardware::automotive::vehicle::GetValueResult;
 using ::aidl::android::hardware::automotive::vehicle::GetValueResults;
+using ::aidl::android::hardware::automotive::vehicle::IVehicle;
 using ::aidl::android::hardware::automotive::vehicle::SetValueRequest;
 using ::aidl::android::hardware::automotive::vehicle::SetValueRequests;
 using ::aidl::android::hardware::automotive::vehicle::SetValueResult;
@@ -95,6 +97,44 @@ float getDefaultSampleRateHz(float sampleRateHz, float minSampleRateHz, float ma
     return sampleRateHz;
 }
 
+// Property ID of each hardware request, sorted by request ID.
+using PropIdByRequestId = std::vector<std::pair<int64_t, int32_t>>;
+
+// Wraps the client's result callback so that the latency from receiving the getValues/setValues
+// request to delivering the result to the client is recorded for each property. Results that
+// arrive after the request timed out are recorded as well since they show a slow hardware.
+template <class ResultType>
+std::shared_ptr<const std::function<void(std::vector<ResultType>)>> withLatencyStats(
+        std::shared_ptr<const std::function<void(std::vector<ResultType>)>> resultCallback,
+        PropIdByRequestId&& propIdByRequestId, int64_t startTimeInNanos,
+        std::shared_ptr<PropertyLatencyStats> latencyStats,
+        PropertyLatencyStats::Operation operation) {
+    std::sort(propIdByRequestId.begin(), propIdByRequestId.end());
+    return std::make_shared<const std::function<void(std::vector<ResultType>)>>(
+            [resultCallback, propIdByRequestId = std::move(propIdByRequestId), startTimeInNanos,
+             latencyStats, operation](std::vector<ResultType> results) {
+                // The hardware may deliver results from any of its threads, each keeps its own
+                // buffer, which stops allocating once it has grown to the largest batch.
+                thread_local std::vector<int32_t> propIds;
+                propIds.clear();
+                for (const auto& result : results) {
+                    auto it = std::lower_bound(
+                            propIdByRequestId.begin(), propIdByRequestId.end(), result.requestId,
+                            [](const auto& entry, int64_t requestId) {
+                                return entry.first < requestId;
+                            });
+                    if (it != propIdByRequestId.end() && it->first == result.requestId) {
+                        propIds.push_back(it->second);
+                    }
+                }
+                (*resultCallback)(std::move(results));
+                int64_t latencyInNanos = elapsedRealtimeNano() - startTimeInNanos;
+                for (int32_t propId : propIds) {
+                    latencyStats->record(propId, operation, latencyInNanos);
+                }
+            });
+}
+
 }  // namespace
 
 DefaultVehicleHal::DefaultVehicleHal(std::unique_ptr<IVehicleHardware> vehicleHardware)
@@ -104,15 +144,17 @@ DefaultVehicleHal::DefaultVehicleHal(std::unique_ptr<IVehicleHardware> vehicleHa
                                      int32_t testInterfaceVersion)
     : mVehicleHardware(std::move(vehicleHardware)),
       mPendingRequestPool(std::make_shared<PendingRequestPool>(TIMEOUT_IN_NANO)),
+      mLatencyStats(std::make_shared<PropertyLatencyStats>()),
       mTestInterfaceVersion(testInterfaceVersion) {
     ALOGD("DefaultVehicleHal init");
     IVehicleHardware* vehicleHardwarePtr = mVehicleHardware.get();
     mSubscriptionManager = std::make_shared<SubscriptionManager>(vehicleHardwarePtr);
     mEventBatchingWindow = mVehicleHardware->getPropertyOnChangeEventBatchingWindow();
     if (mEventBatchingWindow != std::chrono::nanoseconds(0)) {
-        mBatchedEventQueue = std::make_shared<ConcurrentQueue<VehiclePropValue>>();
-        mPropertyChangeEventsBatchingConsumer =
-                std::make_shared<BatchingConsumer<VehiclePropValue>>();
+        mBatchedEventQueue = std::make_shared<ConcurrentRingQueue<VehiclePropValue>>(
+                BATCHED_EVENT_QUEUE_CAPACITY, QueueOverflowPolicy::BLOCK);
+        mPropertyChangeEventsBatchingConsumer = std::make_shared<
+                BatchingConsumer<VehiclePropValue, ConcurrentRingQueue<VehiclePropValue>>>();
         mPropertyChangeEventsBatchingConsumer->run(
                 mBatchedEventQueue.get(), mEventBatchingWindow,
                 [this](std::vector<VehiclePropValue> batchedEvents) {
@@ -120,19 +162,22 @@ DefaultVehicleHal::DefaultVehicleHal(std::unique_ptr<IVehicleHardware> vehicleHa
                 });
     }
 
-    std::weak_ptr<ConcurrentQueue<VehiclePropValue>> batchedEventQueueCopy = mBatchedEventQueue;
+    std::weak_ptr<ConcurrentRingQueue<VehiclePropValue>> batchedEventQueueCopy =
+            mBatchedEventQueue;
     std::chrono::nanoseconds eventBatchingWindow = mEventBatchingWindow;
     std::weak_ptr<SubscriptionManager> subscriptionManagerCopy = mSubscriptionManager;
+    std::shared_ptr<PropertyLatencyStats> latencyStatsCopy = mLatencyStats;
     mVehicleHardware->registerOnPropertyChangeEvent(
             std::make_unique<IVehicleHardware::PropertyChangeCallback>(
-                    [subscriptionManagerCopy, batchedEventQueueCopy,
-                     eventBatchingWindow](std::vector<VehiclePropValue> updatedValues) {
+                    [subscriptionManagerCopy, batchedEventQueueCopy, eventBatchingWindow,
+                     latencyStatsCopy](std::vector<VehiclePropValue> updatedValues) {
                         if (eventBatchingWindow != std::chrono::nanoseconds(0)) {
                             batchPropertyChangeEvent(batchedEventQueueCopy,
                                                      std::move(updatedValues));
                         } else {
                             onPropertyChangeEvent(subscriptionManagerCopy,
-                                                  std::move(updatedValues));
+                                                  std::move(updatedValues),
+                                                  latencyStatsCopy.get());
                         }
                     }));
     mVehicleHardware->registerOnPropertySetErrorEvent(
@@ -183,7 +228,7 @@ DefaultVehicleHal::~DefaultVehicleHal() {
 }
 
 void DefaultVehicleHal::batchPropertyChangeEvent(
-        const std::weak_ptr<ConcurrentQueue<VehiclePropValue>>& batchedEventQueue,
+        const std::weak_ptr<ConcurrentRingQueue<VehiclePropValue>>& batchedEventQueue,
         std::vector<VehiclePropValue>&& updatedValues) {
     auto batchedEventQueueStrong = batchedEventQueue.lock();
     if (batchedEventQueueStrong == nullptr) {
@@ -194,21 +239,38 @@ void DefaultVehicleHal::batchPropertyChangeEvent(
 }
 
 void DefaultVehicleHal::handleBatchedPropertyEvents(std::vector<VehiclePropValue>&& batchedEvents) {
-    onPropertyChangeEvent(mSubscriptionManager, std::move(batchedEvents));
+    onPropertyChangeEvent(mSubscriptionManager, std::move(batchedEvents), mLatencyStats.get());
 }
 
 void DefaultVehicleHal::onPropertyChangeEvent(
         const std::weak_ptr<SubscriptionManager>& subscriptionManager,
-        std::vector<VehiclePropValue>&& updatedValues) {
+        std::vector<VehiclePropValue>&& updatedValues, PropertyLatencyStats* latencyStats) {
     ATRACE_CALL();
+    int64_t startTimeInNanos = elapsedRealtimeNano();
     auto manager = subscriptionManager.lock();
     if (manager == nullptr) {
         ALOGW("the SubscriptionManager is destroyed, DefaultVehicleHal is ending");
         return;
     }
+    std::vector<int32_t> propIds;
+    if (latencyStats != nullptr) {
+        propIds.reserve(updatedValues.size());
+        for (const auto& value : updatedValues) {
+            propIds.push_back(value.prop);
+        }
+    }
     auto updatedValuesByClients = manager->getSubscribedClients(std::move(updatedValues));
     for (auto& [callback, values] : updatedValuesByClients) {
-        SubscriptionClient::sendUpdatedValues(callback, std::move(values));
+        std::shared_ptr<SharedMemoryPool> sharedMemoryPool =
+                manager->getSharedMemoryPool(callback->asBinder().get());
+        SubscriptionClient::sendUpdatedValues(callback, std::move(values), sharedMemoryPool.get());
+    }
+    if (latencyStats != nullptr) {
+        int64_t latencyInNanos = elapsedRealtimeNano() - startTimeInNanos;
+        for (int32_t propId : propIds) {
+            latencyStats->record(propId, PropertyLatencyStats::Operation::EVENT_DELIVERY,
+                                 latencyInNanos);
+        }
     }
 }
 
@@ -229,10 +291,11 @@ void DefaultVehicleHal::onPropertySetErrorEvent(
 template <class T>
 std::shared_ptr<T> DefaultVehicleHal::getOrCreateClient(
         std::unordered_map<const AIBinder*, std::shared_ptr<T>>* clients,
-        const CallbackType& callback, std::shared_ptr<PendingRequestPool> pendingRequestPool) {
+        const CallbackType& callback, std::shared_ptr<PendingRequestPool> pendingRequestPool,
+        std::shared_ptr<PropertyLatencyStats> latencyStats) {
     const AIBinder* clientId = callback->asBinder().get();
     if (clients->find(clientId) == clients->end()) {
-        (*clients)[clientId] = std::make_shared<T>(pendingRequestPool, callback);
+        (*clients)[clientId] = std::make_shared<T>(pendingRequestPool, callback, latencyStats);
     }
     return (*clients)[clientId];
 }
@@ -308,11 +371,13 @@ void DefaultVehicleHal::onBinderDiedUnlinkedHandler() {
 template std::shared_ptr<DefaultVehicleHal::GetValuesClient>
 DefaultVehicleHal::getOrCreateClient<DefaultVehicleHal::GetValuesClient>(
         std::unordered_map<const AIBinder*, std::shared_ptr<GetValuesClient>>* clients,
-        const CallbackType& callback, std::shared_ptr<PendingRequestPool> pendingRequestPool);
+        const CallbackType& callback, std::shared_ptr<PendingRequestPool> pendingRequestPool,
+        std::shared_ptr<PropertyLatencyStats> latencyStats);
 template std::shared_ptr<DefaultVehicleHal::SetValuesClient>
 DefaultVehicleHal::getOrCreateClient<DefaultVehicleHal::SetValuesClient>(
         std::unordered_map<const AIBinder*, std::shared_ptr<SetValuesClient>>* clients,
-        const CallbackType& callback, std::shared_ptr<PendingRequestPool> pendingRequestPool);
+        const CallbackType& callback, std::shared_ptr<PendingRequestPool> pendingRequestPool,
+        std::shared_ptr<PropertyLatencyStats> latencyStats);
 
 void DefaultVehicleHal::setTimeout(int64_t timeoutInNano) {
     mPendingRequestPool = std::make_unique<PendingRequestPool>(timeoutInNano);
@@ -447,6 +512,7 @@ Result<void> DefaultVehicleHal::checkProperty(const VehiclePropValue& propValue)
 ScopedAStatus DefaultVehicleHal::getValues(const CallbackType& callback,
                                            const GetValueRequests& requests) {
     ATRACE_CALL();
+    int64_t startTimeInNanos = elapsedRealtimeNano();
     if (callback == nullptr) {
         return ScopedAStatus::fromExceptionCode(EX_NULL_POINTER);
     }
@@ -498,7 +564,8 @@ ScopedAStatus DefaultVehicleHal::getValues(const CallbackType& callback,
                                                                "client died");
         }
 
-        client = getOrCreateClient(&mGetValuesClients, callback, mPendingRequestPool);
+        client = getOrCreateClient(&mGetValuesClients, callback, mPendingRequestPool,
+                                   mLatencyStats);
     }
 
     // Register the pending hardware requests and also check for duplicate request Ids.
@@ -517,8 +584,16 @@ ScopedAStatus DefaultVehicleHal::getValues(const CallbackType& callback,
         return ScopedAStatus::ok();
     }
 
-    if (StatusCode status =
-                mVehicleHardware->getValues(client->getResultCallback(), hardwareRequests);
+    PropIdByRequestId propIdByRequestId;
+    propIdByRequestId.reserve(hardwareRequests.size());
+    for (const auto& request : hardwareRequests) {
+        propIdByRequestId.emplace_back(request.requestId, request.prop.prop);
+    }
+    auto resultCallback = withLatencyStats(
+            client->getResultCallback(), std::move(propIdByRequestId), startTimeInNanos,
+            mLatencyStats, PropertyLatencyStats::Operation::GET_VALUES);
+
+    if (StatusCode status = mVehicleHardware->getValues(resultCallback, hardwareRequests);
         status != StatusCode::OK) {
         // If the hardware returns error, finish all the pending requests for this request because
         // we never expect hardware to call callback for these requests.
@@ -534,6 +609,7 @@ ScopedAStatus DefaultVehicleHal::getValues(const CallbackType& callback,
 ScopedAStatus DefaultVehicleHal::setValues(const CallbackType& callback,
                                            const SetValueRequests& requests) {
     ATRACE_CALL();
+    int64_t startTimeInNanos = elapsedRealtimeNano();
     if (callback == nullptr) {
         return ScopedAStatus::fromExceptionCode(EX_NULL_POINTER);
     }
@@ -594,7 +670,8 @@ ScopedAStatus DefaultVehicleHal::setValues(const CallbackType& callback,
             return ScopedAStatus::fromExceptionCodeWithMessage(EX_TRANSACTION_FAILED,
                                                                "client died");
         }
-        client = getOrCreateClient(&mSetValuesClients, callback, mPendingRequestPool);
+        client = getOrCreateClient(&mSetValuesClients, callback, mPendingRequestPool,
+                                   mLatencyStats);
     }
 
     // Register the pending hardware requests and also check for duplicate request Ids.
@@ -613,8 +690,16 @@ ScopedAStatus DefaultVehicleHal::setValues(const CallbackType& callback,
         return ScopedAStatus::ok();
     }
 
-    if (StatusCode status =
-                mVehicleHardware->setValues(client->getResultCallback(), hardwareRequests);
+    PropIdByRequestId propIdByRequestId;
+    propIdByRequestId.reserve(hardwareRequests.size());
+    for (const auto& request : hardwareRequests) {
+        propIdByRequestId.emplace_back(request.requestId, request.value.prop);
+    }
+    auto resultCallback = withLatencyStats(
+            client->getResultCallback(), std::move(propIdByRequestId), startTimeInNanos,
+            mLatencyStats, PropertyLatencyStats::Operation::SET_VALUES);
+
+    if (StatusCode status = mVehicleHardware->setValues(resultCallback, hardwareRequests);
         status != StatusCode::OK) {
         // If the hardware returns error, finish all the pending requests for this request because
         // we never expect hardware to call callback for these requests.
@@ -762,11 +847,18 @@ VhalResult<void> DefaultVehicleHal::checkSubscribeOptions(
 
 ScopedAStatus DefaultVehicleHal::subscribe(const CallbackType& callback,
                                            const std::vector<SubscribeOptions>& options,
-                                           [[maybe_unused]] int32_t maxSharedMemoryFileCount) {
-    // TODO(b/205189110): Use shared memory file count.
+                                           int32_t maxSharedMemoryFileCount) {
     if (callback == nullptr) {
         return ScopedAStatus::fromExceptionCode(EX_NULL_POINTER);
     }
+    if (maxSharedMemoryFileCount < 0 ||
+        maxSharedMemoryFileCount > IVehicle::MAX_SHARED_MEMORY_FILES_PER_CLIENT) {
+        ALOGW("subscribe: invalid maxSharedMemoryFileCount: %" PRId32 ", clamped to [0, %" PRId32
+              "]",
+              maxSharedMemoryFileCount, IVehicle::MAX_SHARED_MEMORY_FILES_PER_CLIENT);
+        maxSharedMemoryFileCount = std::clamp(maxSharedMemoryFileCount, 0,
+                                              IVehicle::MAX_SHARED_MEMORY_FILES_PER_CLIENT);
+    }
     if (auto result = checkSubscribeOptions(options); !result.ok()) {
         ALOGE("subscribe: invalid subscribe options: %s", getErrorMsg(result).c_str());
         return toScopedAStatus(result);
@@ -854,6 +946,8 @@ ScopedAStatus DefaultVehicleHal::subscribe(const CallbackType& callback,
                 return toScopedAStatus(result);
             }
         }
+        mSubscriptionManager->setMaxSharedMemoryFileCount(callback->asBinder().get(),
+                                                          maxSharedMemoryFileCount);
     }
     return ScopedAStatus::ok();
 }
@@ -866,8 +960,28 @@ ScopedAStatus DefaultVehicleHal::unsubscribe(const CallbackType& callback,
     return toScopedAStatus(mSubscriptionManager->unsubscribe(callback->asBinder().get(), propIds));
 }
 
-ScopedAStatus DefaultVehicleHal::returnSharedMemory(const CallbackType&, int64_t) {
-    // TODO(b/200737967): implement this.
+ScopedAStatus DefaultVehicleHal::returnSharedMemory(const CallbackType& callback,
+                                                    int64_t sharedMemoryId) {
+    if (callback == nullptr) {
+        return ScopedAStatus::fromExceptionCode(EX_NULL_POINTER);
+    }
+    if (sharedMemoryId == IVehicle::INVALID_MEMORY_ID) {
+        return ScopedAStatus::ok();
+    }
+    std::shared_ptr<SharedMemoryPool> sharedMemoryPool =
+            mSubscriptionManager->getSharedMemoryPool(callback->asBinder().get());
+    if (sharedMemoryPool == nullptr) {
+        // The client might have unsubscribed after the event was delivered, the pool and all its
+        // files are already released.
+        ALOGW("returnSharedMemory: no shared memory pool for the client, ID: %" PRId64,
+              sharedMemoryId);
+        return ScopedAStatus::ok();
+    }
+    if (!sharedMemoryPool->returnSharedMemory(sharedMemoryId)) {
+        return ScopedAStatus::fromServiceSpecificErrorWithMessage(
+                toInt(StatusCode::INVALID_ARG),
+                StringPrintf("unknown shared memory ID: %" PRId64, sharedMemoryId).c_str());
+    }
     return ScopedAStatus::ok();
 }
 
@@ -964,12 +1078,21 @@ binder_status_t DefaultVehicleHal::dump(int fd, const char** args, uint32_t numA
         // Ignore "-a" option. Bugreport will call with this option.
         options.clear();
     }
+    if (!options.empty() && options[0] == DUMP_STATS_OPTION) {
+        dumpLatencyStats(fd, options);
+        return STATUS_OK;
+    }
     DumpResult result = mVehicleHardware->dump(options);
     if (result.refreshPropertyConfigs) {
         std::scoped_lock lockGuard(mConfigInitLock);
         getAllPropConfigsFromHardwareLocked();
     }
     dprintf(fd, "%s", (result.buffer + "\n").c_str());
+    if (options.size() == 1 && options[0] == "--help") {
+        dprintf(fd, "%s [%s]: dumps the per-property latency stats of getValues, setValues and "
+                "property change events, or resets them with %s\n",
+                DUMP_STATS_OPTION, DUMP_STATS_RESET_OPTION, DUMP_STATS_RESET_OPTION);
+    }
     if (!result.callerShouldDumpState) {
         return STATUS_OK;
     }
@@ -983,9 +1106,23 @@ binder_status_t DefaultVehicleHal::dump(int fd, const char** args, uint32_t numA
         dprintf(fd, "Currently have %zu setValues clients\n", mSetValuesClients.size());
         dprintf(fd, "Currently have %zu subscribe clients\n", countSubscribeClients());
     }
+    dprintf(fd, "%s", mRecurrentTimer.dump().c_str());
     return STATUS_OK;
 }
 
+void DefaultVehicleHal::dumpLatencyStats(int fd, const std::vector<std::string>& options) {
+    if (options.size() == 1) {
+        dprintf(fd, "%s", mLatencyStats->dump().c_str());
+        return;
+    }
+    if (options.size() == 2 && options[1] == DUMP_STATS_RESET_OPTION) {
+        mLatencyStats->reset();
+        dprintf(fd, "Latency stats reset\n");
+        return;
+    }
+    dprintf(fd, "Usage: %s [%s]\n", DUMP_STATS_OPTION, DUMP_STATS_RESET_OPTION);
+}
+
 size_t DefaultVehicleHal::countSubscribeClients() {
     return mSubscriptionManager->countClients();
 }
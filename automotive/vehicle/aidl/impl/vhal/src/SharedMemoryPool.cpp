@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "SharedMemoryPool"
+
+#include "SharedMemoryPool.h"
+#include "ParcelableUtils.h"
+
+#include <VehicleUtils.h>
+
+#include <android/binder_parcel.h>
+#include <cutils/ashmem.h>
+#include <utils/Log.h>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <inttypes.h>
+#include <memory>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+namespace {
+
+using ::aidl::android::hardware::automotive::vehicle::IVehicle;
+using ::aidl::android::hardware::automotive::vehicle::StatusCode;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropValue;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropValues;
+using ::ndk::ScopedAStatus;
+using ::ndk::ScopedFileDescriptor;
+
+// Rounds up the file size so that a file could be reused for slightly larger payloads.
+size_t roundUpCapacity(size_t size) {
+    size_t capacity = static_cast<size_t>(getpagesize());
+    while (capacity < size) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+}  // namespace
+
+SharedMemoryPool::SharedMemoryPool(int32_t maxFileCount, size_t inlineThresholdBytes)
+    : mInlineThresholdBytes(inlineThresholdBytes), mMaxFileCount(maxFileCount), mNextId(0) {}
+
+SharedMemoryPool::~SharedMemoryPool() {
+    std::scoped_lock<std::mutex> lockGuard(mLock);
+
+    for (MemoryFile& file : mFiles) {
+        releaseFile(&file);
+    }
+    mFiles.clear();
+}
+
+bool SharedMemoryPool::allocateFile(size_t capacity, MemoryFile* file) {
+    int fd = ashmem_create_region("VehiclePropValues", capacity);
+    if (fd < 0) {
+        ALOGE("failed to create shared memory file with size: %zu", capacity);
+        return false;
+    }
+    void* buffer = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (buffer == MAP_FAILED) {
+        ALOGE("failed to map shared memory file with size: %zu", capacity);
+        close(fd);
+        return false;
+    }
+    file->fd = ScopedFileDescriptor(fd);
+    file->buffer = static_cast<uint8_t*>(buffer);
+    file->capacity = capacity;
+    return true;
+}
+
+void SharedMemoryPool::releaseFile(MemoryFile* file) {
+    if (file->buffer != nullptr) {
+        munmap(file->buffer, file->capacity);
+        file->buffer = nullptr;
+    }
+    file->fd = ScopedFileDescriptor();
+    file->capacity = 0;
+}
+
+SharedMemoryPool::MemoryFile* SharedMemoryPool::obtainFileLocked(size_t size) {
+    MemoryFile* bestFit = nullptr;
+    MemoryFile* freeFile = nullptr;
+    for (MemoryFile& file : mFiles) {
+        if (file.inUse) {
+            continue;
+        }
+        freeFile = &file;
+        if (file.capacity >= size && (bestFit == nullptr || file.capacity < bestFit->capacity)) {
+            bestFit = &file;
+        }
+    }
+    if (bestFit != nullptr) {
+        mStats.reusedCount++;
+        return bestFit;
+    }
+
+    MemoryFile* file = nullptr;
+    if (static_cast<int32_t>(mFiles.size()) < mMaxFileCount) {
+        mFiles.push_back({});
+        file = &mFiles.back();
+    } else if (freeFile != nullptr) {
+        // All the free files are too small, replace one of them with a larger one.
+        releaseFile(freeFile);
+        file = freeFile;
+    } else {
+        return nullptr;
+    }
+
+    size_t capacity = roundUpCapacity(size);
+    if (!allocateFile(capacity, file)) {
+        if (file == &mFiles.back() && file->capacity == 0) {
+            mFiles.pop_back();
+        }
+        return nullptr;
+    }
+    // IDs start from 1 since 0 is IVehicle::INVALID_MEMORY_ID.
+    file->id = ++mNextId;
+    file->inUse = false;
+    mStats.allocatedFileCount++;
+    mStats.allocatedBytes += capacity;
+    return file;
+}
+
+ScopedAStatus SharedMemoryPool::toVehiclePropValues(std::vector<VehiclePropValue>&& values,
+                                                    VehiclePropValues* output) {
+    output->payloads = std::move(values);
+    output->sharedMemoryId = IVehicle::INVALID_MEMORY_ID;
+    output->sharedMemoryFd = ScopedFileDescriptor();
+
+    std::unique_ptr<AParcel, decltype(&AParcel_delete)> parcel(AParcel_create(), AParcel_delete);
+    if (binder_status_t status = output->writeToParcel(parcel.get()); status != STATUS_OK) {
+        return ScopedAStatus::fromServiceSpecificErrorWithMessage(
+                toInt(StatusCode::INTERNAL_ERROR), "failed to write VehiclePropValues to parcel");
+    }
+    size_t dataSize = static_cast<size_t>(AParcel_getDataSize(parcel.get()));
+
+    std::scoped_lock<std::mutex> lockGuard(mLock);
+
+    if (dataSize <= mInlineThresholdBytes) {
+        mStats.inlineCount++;
+        return ScopedAStatus::ok();
+    }
+
+    MemoryFile* file = obtainFileLocked(dataSize);
+    if (file == nullptr) {
+        mStats.fallbackCount++;
+        return vectorToStableLargeParcelable(std::move(output->payloads), output);
+    }
+
+    if (binder_status_t status = AParcel_marshal(parcel.get(), file->buffer, 0, dataSize);
+        status != STATUS_OK) {
+        ALOGE("failed to marshal VehiclePropValues into shared memory, status: %d",
+              static_cast<int>(status));
+        mStats.fallbackCount++;
+        return vectorToStableLargeParcelable(std::move(output->payloads), output);
+    }
+    int fd = dup(file->fd.get());
+    if (fd < 0) {
+        ALOGE("failed to dup shared memory file descriptor");
+        mStats.fallbackCount++;
+        return vectorToStableLargeParcelable(std::move(output->payloads), output);
+    }
+
+    file->inUse = true;
+    mStats.pooledCount++;
+    output->payloads.clear();
+    output->sharedMemoryId = file->id;
+    output->sharedMemoryFd = ScopedFileDescriptor(fd);
+    return ScopedAStatus::ok();
+}
+
+bool SharedMemoryPool::returnSharedMemory(int64_t sharedMemoryId) {
+    std::scoped_lock<std::mutex> lockGuard(mLock);
+
+    for (MemoryFile& file : mFiles) {
+        if (file.id == sharedMemoryId && file.inUse) {
+            file.inUse = false;
+            return true;
+        }
+    }
+    ALOGW("unknown shared memory ID: %" PRId64, sharedMemoryId);
+    return false;
+}
+
+int32_t SharedMemoryPool::getFileCount() const {
+    std::scoped_lock<std::mutex> lockGuard(mLock);
+
+    return static_cast<int32_t>(mFiles.size());
+}
+
+void SharedMemoryPool::setMaxFileCount(int32_t maxFileCount) {
+    std::scoped_lock<std::mutex> lockGuard(mLock);
+
+    mMaxFileCount = maxFileCount;
+}
+
+SharedMemoryPool::Stats SharedMemoryPool::getStats() const {
+    std::scoped_lock<std::mutex> lockGuard(mLock);
+
+    return mStats;
+}
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -65,6 +65,8 @@ SubscriptionManager::~SubscriptionManager() {
 
     mClientsByPropIdAreaId.clear();
     mSubscribedPropsByClient.clear();
+    mSharedMemoryPoolByClient.clear();
+    mFanOutByPropIdAreaId.clear();
 }
 
 bool SubscriptionManager::checkSampleRateHz(float sampleRateHz) {
@@ -306,6 +308,7 @@ VhalResult<void> SubscriptionManager::subscribe(const std::shared_ptr<IVehicleCa
 
             mSubscribedPropsByClient[clientId].insert(propIdAreaId);
             mClientsByPropIdAreaId[propIdAreaId][clientId] = callback;
+            refreshFanOutLocked(propIdAreaId);
         }
     }
     return {};
@@ -337,9 +340,47 @@ VhalResult<void> SubscriptionManager::unsubscribePropIdAreaIdLocked(
         mClientsByPropIdAreaId.erase(propIdAreaId);
         mContSubConfigsByPropIdArea.erase(propIdAreaId);
     }
+    refreshFanOutLocked(propIdAreaId);
     return {};
 }
 
+void SubscriptionManager::refreshFanOutLocked(const PropIdAreaId& propIdAreaId) {
+    auto clientsIt = mClientsByPropIdAreaId.find(propIdAreaId);
+    if (clientsIt == mClientsByPropIdAreaId.end() || clientsIt->second.empty()) {
+        mFanOutByPropIdAreaId.erase(propIdAreaId);
+        return;
+    }
+
+    // For on-change properties, there is no ContSubConfigs, so the values are delivered as is.
+    const ContSubConfigs* contSubConfigs = nullptr;
+    if (auto it = mContSubConfigsByPropIdArea.find(propIdAreaId);
+        it != mContSubConfigsByPropIdArea.end()) {
+        contSubConfigs = &it->second;
+    }
+
+    FanOut fanOut = {
+            .isContinuous = contSubConfigs != nullptr && contSubConfigs->getMaxSampleRateHz() > 0,
+    };
+    fanOut.targets.reserve(clientsIt->second.size());
+    for (const auto& [clientId, callback] : clientsIt->second) {
+        FanOutTarget target = {
+                .callback = callback,
+                .resolution = 0.0f,
+                .filterVur = false,
+        };
+        if (contSubConfigs != nullptr) {
+            target.resolution = contSubConfigs->getResolutionForClient(clientId);
+            // If client wants VUR (and VUR is supported as checked in DefaultVehicleHal), it is
+            // possible that VUR is not enabled in IVehicleHardware because another client does
+            // not enable VUR. We will implement VUR filtering here for the client that enables it.
+            target.filterVur = contSubConfigs->isVurEnabledForClient(clientId) &&
+                               !contSubConfigs->isVurEnabled();
+        }
+        fanOut.targets.push_back(std::move(target));
+    }
+    mFanOutByPropIdAreaId[propIdAreaId] = std::move(fanOut);
+}
+
 VhalResult<void> SubscriptionManager::unsubscribe(SubscriptionManager::ClientIdType clientId,
                                                   const std::vector<int32_t>& propIds) {
     std::scoped_lock<std::mutex> lockGuard(mLock);
@@ -370,6 +411,7 @@ VhalResult<void> SubscriptionManager::unsubscribe(SubscriptionManager::ClientIdT
 
     if (subscribedPropIdsAreaIds.empty()) {
         mSubscribedPropsByClient.erase(clientId);
+        mSharedMemoryPoolByClient.erase(clientId);
     }
     return {};
 }
@@ -388,6 +430,7 @@ VhalResult<void> SubscriptionManager::unsubscribe(SubscriptionManager::ClientIdT
         }
     }
     mSubscribedPropsByClient.erase(clientId);
+    mSharedMemoryPoolByClient.erase(clientId);
     return {};
 }
 
@@ -424,33 +467,57 @@ SubscriptionManager::getSubscribedClients(std::vector<VehiclePropValue>&& update
     std::scoped_lock<std::mutex> lockGuard(mLock);
     std::unordered_map<std::shared_ptr<IVehicleCallback>, std::vector<VehiclePropValue>> clients;
 
-    for (auto& value : updatedValues) {
+    // Pairs of the index in 'updatedValues' and the fan-out for the value. For continuous
+    // properties, only the latest value for each [propId, areaId] in this batch is kept.
+    std::vector<std::pair<size_t, const FanOut*>> eventsToDeliver;
+    eventsToDeliver.reserve(updatedValues.size());
+    std::unordered_map<PropIdAreaId, size_t, PropIdAreaIdHash> eventIndexByContPropIdAreaId;
+    for (size_t i = 0; i < updatedValues.size(); i++) {
+        const VehiclePropValue& value = updatedValues[i];
         PropIdAreaId propIdAreaId{
                 .propId = value.prop,
                 .areaId = value.areaId,
         };
-        if (mClientsByPropIdAreaId.find(propIdAreaId) == mClientsByPropIdAreaId.end()) {
+        auto fanOutIt = mFanOutByPropIdAreaId.find(propIdAreaId);
+        if (fanOutIt == mFanOutByPropIdAreaId.end()) {
             continue;
         }
+        const FanOut* fanOut = &fanOutIt->second;
+        if (fanOut->isContinuous) {
+            auto [it, inserted] =
+                    eventIndexByContPropIdAreaId.try_emplace(propIdAreaId, eventsToDeliver.size());
+            if (!inserted) {
+                size_t& valueIndex = eventsToDeliver[it->second].first;
+                if (updatedValues[valueIndex].timestamp <= value.timestamp) {
+                    valueIndex = i;
+                }
+                continue;
+            }
+        }
+        eventsToDeliver.push_back({i, fanOut});
+    }
 
-        for (const auto& [client, callback] : mClientsByPropIdAreaId[propIdAreaId]) {
-            // if propId is on-change, propIdAreaId will not exist in mContSubConfigsByPropIdArea,
-            // returning an empty ContSubConfigs value for subConfigs i.e. with resolution = 0 and
-            // enableVur = false.
-            auto& subConfigs = mContSubConfigsByPropIdArea[propIdAreaId];
+    for (const auto& [valueIndex, fanOut] : eventsToDeliver) {
+        VehiclePropValue& value = updatedValues[valueIndex];
+        size_t targetCount = fanOut->targets.size();
+        for (size_t i = 0; i < targetCount; i++) {
+            const FanOutTarget& target = fanOut->targets[i];
+            std::vector<VehiclePropValue>& clientValues = clients[target.callback];
+            // Each client gets its own copy since the value is sanitized per client, the last
+            // client takes the original value.
+            if (i == targetCount - 1) {
+                clientValues.push_back(std::move(value));
+            } else {
+                clientValues.push_back(value);
+            }
             // Clients must be sent different VehiclePropValues with different levels of granularity
             // as requested by the client using resolution.
-            VehiclePropValue newValue = value;
-            sanitizeByResolution(&(newValue.value), subConfigs.getResolutionForClient(client));
-            // If client wants VUR (and VUR is supported as checked in DefaultVehicleHal), it is
-            // possible that VUR is not enabled in IVehicleHardware because another client does not
-            // enable VUR. We will implement VUR filtering here for the client that enables it.
-            if (subConfigs.isVurEnabledForClient(client) && !subConfigs.isVurEnabled()) {
-                if (isValueUpdatedLocked(callback, newValue)) {
-                    clients[callback].push_back(newValue);
+            sanitizeByResolution(&(clientValues.back().value), target.resolution);
+            if (target.filterVur && !isValueUpdatedLocked(target.callback, clientValues.back())) {
+                clientValues.pop_back();
+                if (clientValues.empty()) {
+                    clients.erase(target.callback);
                 }
-            } else {
-                clients[callback].push_back(newValue);
             }
         }
     }
@@ -493,6 +560,32 @@ size_t SubscriptionManager::countClients() {
     return mSubscribedPropsByClient.size();
 }
 
+void SubscriptionManager::setMaxSharedMemoryFileCount(SubscriptionManager::ClientIdType clientId,
+                                                      int32_t maxSharedMemoryFileCount) {
+    std::scoped_lock<std::mutex> lockGuard(mLock);
+
+    if (maxSharedMemoryFileCount <= 0) {
+        mSharedMemoryPoolByClient.erase(clientId);
+        return;
+    }
+    if (auto it = mSharedMemoryPoolByClient.find(clientId);
+        it != mSharedMemoryPoolByClient.end()) {
+        // Keep the existing pool so that the files in use by the client could still be returned.
+        it->second->setMaxFileCount(maxSharedMemoryFileCount);
+        return;
+    }
+    mSharedMemoryPoolByClient[clientId] =
+            std::make_shared<SharedMemoryPool>(maxSharedMemoryFileCount);
+}
+
+std::shared_ptr<SharedMemoryPool> SubscriptionManager::getSharedMemoryPool(
+        SubscriptionManager::ClientIdType clientId) const {
+    std::scoped_lock<std::mutex> lockGuard(mLock);
+
+    auto it = mSharedMemoryPoolByClient.find(clientId);
+    return it == mSharedMemoryPoolByClient.end() ? nullptr : it->second;
+}
+
 }  // namespace vehicle
 }  // namespace automotive
 }  // namespace hardware
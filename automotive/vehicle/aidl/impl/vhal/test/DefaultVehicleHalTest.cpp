@@ -1256,6 +1256,28 @@ TEST_F(DefaultVehicleHalTest, testSubscribeUnsubscribe) {
     ASSERT_TRUE(status.isOk()) << "unsubscribe failed: " << status.getMessage();
 }
 
+TEST_F(DefaultVehicleHalTest, testReturnSharedMemory) {
+    std::vector<SubscribeOptions> options = {
+            {
+                    .propId = GLOBAL_ON_CHANGE_PROP,
+            },
+    };
+
+    auto status = getClient()->subscribe(getCallbackClient(), options,
+                                         /*maxSharedMemoryFileCount=*/2);
+
+    ASSERT_TRUE(status.isOk()) << "subscribe failed: " << status.getMessage();
+
+    status = getClient()->returnSharedMemory(getCallbackClient(), IVehicle::INVALID_MEMORY_ID);
+
+    ASSERT_TRUE(status.isOk()) << "returnSharedMemory with INVALID_MEMORY_ID must be ignored";
+
+    status = getClient()->returnSharedMemory(getCallbackClient(), /*sharedMemoryId=*/1);
+
+    ASSERT_FALSE(status.isOk()) << "returnSharedMemory with an unknown ID must fail";
+    ASSERT_EQ(status.getServiceSpecificError(), toInt(StatusCode::INVALID_ARG));
+}
+
 TEST_F(DefaultVehicleHalTest, testSubscribeGlobalOnChangeNormal) {
     std::vector<SubscribeOptions> options = {
             {
@@ -1913,6 +1935,55 @@ TEST_F(DefaultVehicleHalTest, testDumpCallerShouldNotDump) {
     ASSERT_EQ(msg.find("Vehicle HAL State: "), std::string::npos);
 }
 
+TEST_F(DefaultVehicleHalTest, testDumpStats) {
+    GetValueRequests requests;
+    std::vector<GetValueResult> expectedResults;
+    std::vector<GetValueRequest> expectedHardwareRequests;
+    ASSERT_TRUE(getValuesTestCases(10, requests, expectedResults, expectedHardwareRequests).ok());
+    getHardware()->addGetValueResponses(expectedResults);
+    ASSERT_TRUE(getClient()->getValues(getCallbackClient(), requests).isOk());
+
+    int fd = memfd_create("memfile", 0);
+    const char* args[] = {"--stats"};
+    getClient()->dump(fd, args, 1);
+
+    lseek(fd, 0, SEEK_SET);
+    char buf[10240] = {};
+    read(fd, buf, sizeof(buf));
+    close(fd);
+
+    std::string msg(buf);
+
+    ASSERT_THAT(msg, ContainsRegex("Latency stats"));
+    ASSERT_THAT(msg, ContainsRegex("getValues: count: 1,"));
+    ASSERT_EQ(msg.find("setValues: count:"), std::string::npos);
+}
+
+TEST_F(DefaultVehicleHalTest, testDumpStatsReset) {
+    GetValueRequests requests;
+    std::vector<GetValueResult> expectedResults;
+    std::vector<GetValueRequest> expectedHardwareRequests;
+    ASSERT_TRUE(getValuesTestCases(10, requests, expectedResults, expectedHardwareRequests).ok());
+    getHardware()->addGetValueResponses(expectedResults);
+    ASSERT_TRUE(getClient()->getValues(getCallbackClient(), requests).isOk());
+
+    int fd = memfd_create("memfile", 0);
+    const char* resetArgs[] = {"--stats", "--reset"};
+    getClient()->dump(fd, resetArgs, 2);
+    const char* args[] = {"--stats"};
+    getClient()->dump(fd, args, 1);
+
+    lseek(fd, 0, SEEK_SET);
+    char buf[10240] = {};
+    read(fd, buf, sizeof(buf));
+    close(fd);
+
+    std::string msg(buf);
+
+    ASSERT_THAT(msg, ContainsRegex("Latency stats reset"));
+    ASSERT_EQ(msg.find("getValues: count:"), std::string::npos);
+}
+
 TEST_F(DefaultVehicleHalTest, testOnPropertySetErrorEvent) {
     std::vector<SubscribeOptions> options = {
             {
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SharedMemoryPool.h"
+
+#include <LargeParcelableBase.h>
+#include <VehicleHalTypes.h>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+
+namespace {
+
+using ::aidl::android::hardware::automotive::vehicle::IVehicle;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropValue;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropValues;
+using ::android::automotive::car_binder_lib::LargeParcelableBase;
+using ::ndk::ScopedAStatus;
+
+constexpr size_t kBatchSize = 1000;
+constexpr int kBatchCount = 100;
+
+std::vector<VehiclePropValue> getTestValues(size_t count) {
+    std::vector<VehiclePropValue> values;
+    for (size_t i = 0; i < count; i++) {
+        values.push_back({
+                .timestamp = static_cast<int64_t>(i),
+                .areaId = 0,
+                .prop = static_cast<int32_t>(i),
+                .value.int32Values = {static_cast<int32_t>(i)},
+        });
+    }
+    return values;
+}
+
+std::vector<VehiclePropValue> readValues(const VehiclePropValues& output) {
+    auto result = LargeParcelableBase::stableLargeParcelableToParcelable(output);
+    if (!result.ok()) {
+        return {};
+    }
+    return result.value().getObject()->payloads;
+}
+
+}  // namespace
+
+TEST(SharedMemoryPoolTest, testSmallPayloadSentInline) {
+    SharedMemoryPool pool(/*maxFileCount=*/2);
+    VehiclePropValues output;
+
+    ScopedAStatus status = pool.toVehiclePropValues(getTestValues(1), &output);
+
+    ASSERT_TRUE(status.isOk()) << status.getMessage();
+    ASSERT_EQ(output.payloads, getTestValues(1));
+    ASSERT_EQ(output.sharedMemoryId, IVehicle::INVALID_MEMORY_ID);
+    ASSERT_EQ(output.sharedMemoryFd.get(), -1);
+    ASSERT_EQ(pool.getStats().inlineCount, 1u);
+    ASSERT_EQ(pool.getFileCount(), 0);
+}
+
+TEST(SharedMemoryPoolTest, testLargePayloadReadableAsLargeParcelable) {
+    SharedMemoryPool pool(/*maxFileCount=*/2);
+    VehiclePropValues output;
+
+    ScopedAStatus status = pool.toVehiclePropValues(getTestValues(kBatchSize), &output);
+
+    ASSERT_TRUE(status.isOk()) << status.getMessage();
+    ASSERT_TRUE(output.payloads.empty());
+    ASSERT_NE(output.sharedMemoryId, IVehicle::INVALID_MEMORY_ID);
+    ASSERT_EQ(readValues(output), getTestValues(kBatchSize));
+}
+
+TEST(SharedMemoryPoolTest, testReturnedFileReusedAcrossBatches) {
+    SharedMemoryPool pool(/*maxFileCount=*/2);
+
+    for (int i = 0; i < kBatchCount; i++) {
+        VehiclePropValues output;
+        ASSERT_TRUE(pool.toVehiclePropValues(getTestValues(kBatchSize), &output).isOk());
+        ASSERT_EQ(readValues(output), getTestValues(kBatchSize));
+        ASSERT_TRUE(pool.returnSharedMemory(output.sharedMemoryId));
+    }
+
+    SharedMemoryPool::Stats stats = pool.getStats();
+    // Without the pool, every batch would allocate, map and unmap a new shared memory file.
+    EXPECT_EQ(stats.allocatedFileCount, 1u);
+    EXPECT_EQ(stats.reusedCount, static_cast<uint64_t>(kBatchCount - 1));
+    EXPECT_EQ(stats.pooledCount, static_cast<uint64_t>(kBatchCount));
+    EXPECT_EQ(stats.fallbackCount, 0u);
+    EXPECT_EQ(pool.getFileCount(), 1);
+}
+
+TEST(SharedMemoryPoolTest, testFallbackWhenAllFilesInUse) {
+    SharedMemoryPool pool(/*maxFileCount=*/2);
+    std::vector<VehiclePropValues> outputs(3);
+
+    for (auto& output : outputs) {
+        ASSERT_TRUE(pool.toVehiclePropValues(getTestValues(kBatchSize), &output).isOk());
+    }
+
+    EXPECT_NE(outputs[0].sharedMemoryId, IVehicle::INVALID_MEMORY_ID);
+    EXPECT_NE(outputs[1].sharedMemoryId, IVehicle::INVALID_MEMORY_ID);
+    EXPECT_NE(outputs[0].sharedMemoryId, outputs[1].sharedMemoryId);
+    // The third batch uses a one-shot shared memory file that is not returned.
+    EXPECT_EQ(outputs[2].sharedMemoryId, IVehicle::INVALID_MEMORY_ID);
+    EXPECT_EQ(readValues(outputs[2]), getTestValues(kBatchSize));
+    EXPECT_EQ(pool.getStats().fallbackCount, 1u);
+    EXPECT_EQ(pool.getFileCount(), 2);
+}
+
+TEST(SharedMemoryPoolTest, testReturnUnknownSharedMemory) {
+    SharedMemoryPool pool(/*maxFileCount=*/2);
+    VehiclePropValues output;
+    ASSERT_TRUE(pool.toVehiclePropValues(getTestValues(kBatchSize), &output).isOk());
+
+    ASSERT_FALSE(pool.returnSharedMemory(output.sharedMemoryId + 1));
+    ASSERT_TRUE(pool.returnSharedMemory(output.sharedMemoryId));
+    // Returning the same file twice is not allowed.
+    ASSERT_FALSE(pool.returnSharedMemory(output.sharedMemoryId));
+}
+
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -508,6 +508,115 @@ TEST_F(SubscriptionManagerTest, testUnsubscribeOnchange) {
                 UnorderedElementsAre(std::pair<int32_t, int32_t>(1, 0)));
 }
 
+TEST_F(SubscriptionManagerTest, testGetSubscribedClients_coalesceContinuousEvents) {
+    std::vector<SubscribeOptions> options = {
+            {
+                    .propId = 0,
+                    .areaIds = {0},
+                    .sampleRate = 10.0,
+            },
+    };
+    auto result = getManager()->subscribe(getCallbackClient(), options, true);
+    ASSERT_TRUE(result.ok()) << "failed to subscribe: " << result.error().message();
+
+    std::vector<VehiclePropValue> updatedValues = {
+            {
+                    .timestamp = 1,
+                    .areaId = 0,
+                    .prop = 0,
+                    .value = {.int32Values = {1}},
+            },
+            {
+                    .timestamp = 3,
+                    .areaId = 0,
+                    .prop = 0,
+                    .value = {.int32Values = {3}},
+            },
+            {
+                    .timestamp = 2,
+                    .areaId = 0,
+                    .prop = 0,
+                    .value = {.int32Values = {2}},
+            },
+    };
+    auto clients = getManager()->getSubscribedClients(std::vector<VehiclePropValue>(updatedValues));
+
+    ASSERT_THAT(clients[getCallbackClient()], ElementsAre(updatedValues[1]))
+            << "only the latest continuous event in a batch must be delivered";
+}
+
+TEST_F(SubscriptionManagerTest, testGetSubscribedClients_mustNotCoalesceOnChangeEvents) {
+    std::vector<SubscribeOptions> options = {
+            {
+                    .propId = 0,
+                    .areaIds = {0},
+            },
+    };
+    auto result = getManager()->subscribe(getCallbackClient(), options, false);
+    ASSERT_TRUE(result.ok()) << "failed to subscribe: " << result.error().message();
+
+    std::vector<VehiclePropValue> updatedValues = {
+            {
+                    .timestamp = 1,
+                    .areaId = 0,
+                    .prop = 0,
+                    .value = {.int32Values = {1}},
+            },
+            {
+                    .timestamp = 2,
+                    .areaId = 0,
+                    .prop = 0,
+                    .value = {.int32Values = {2}},
+            },
+    };
+    auto clients = getManager()->getSubscribedClients(std::vector<VehiclePropValue>(updatedValues));
+
+    ASSERT_THAT(clients[getCallbackClient()], ElementsAre(updatedValues[0], updatedValues[1]));
+}
+
+TEST_F(SubscriptionManagerTest, testGetSubscribedClients_manyClients) {
+    std::vector<SubscribeOptions> options = {
+            {
+                    .propId = 0,
+                    .areaIds = {0},
+                    .sampleRate = 10.0,
+            },
+    };
+    std::vector<SpAIBinder> binders;
+    std::vector<std::shared_ptr<IVehicleCallback>> clients;
+    for (size_t i = 0; i < 10; i++) {
+        binders.push_back(ndk::SharedRefBase::make<PropertyCallback>()->asBinder());
+        clients.push_back(IVehicleCallback::fromBinder(binders.back()));
+        auto result = getManager()->subscribe(clients.back(), options, true);
+        ASSERT_TRUE(result.ok()) << "failed to subscribe: " << result.error().message();
+    }
+
+    VehiclePropValue value = {
+            .timestamp = 1,
+            .areaId = 0,
+            .prop = 0,
+            .value = {.int32Values = {1}},
+    };
+    auto updatedValuesByClient = getManager()->getSubscribedClients({value});
+
+    ASSERT_EQ(updatedValuesByClient.size(), 10u);
+    for (const auto& client : clients) {
+        ASSERT_THAT(updatedValuesByClient[client], ElementsAre(value));
+    }
+
+    // Unsubscribe half of the clients, the rest must still get the events.
+    for (size_t i = 0; i < 5; i++) {
+        auto result = getManager()->unsubscribe(clients[i]->asBinder().get());
+        ASSERT_TRUE(result.ok()) << "failed to unsubscribe: " << result.error().message();
+    }
+    updatedValuesByClient = getManager()->getSubscribedClients({value});
+
+    ASSERT_EQ(updatedValuesByClient.size(), 5u);
+    for (size_t i = 5; i < 10; i++) {
+        ASSERT_THAT(updatedValuesByClient[clients[i]], ElementsAre(value));
+    }
+}
+
 TEST_F(SubscriptionManagerTest, testCheckSampleRateHzValid) {
     ASSERT_TRUE(SubscriptionManager::checkSampleRateHz(1.0));
 }
@@ -179,6 +179,7 @@ bool ExternalCameraDeviceSession::initialize() {
         return true;
     }
     mOutputThread->setExifMakeModel(mExifMake, mExifModel);
+    mOutputThread->startPipeline();
 
     status_t status = initDefaultRequests();
     if (status != OK) {
@@ -226,6 +227,7 @@ void ExternalCameraDeviceSession::initOutputThread() {
 void ExternalCameraDeviceSession::closeOutputThread() {
     if (mOutputThread != nullptr) {
         mOutputThread->flush();
+        mOutputThread->stopPipeline();
         mOutputThread->requestExitAndWait();
         mOutputThread.reset();
     }
@@ -2131,15 +2133,43 @@ ExternalCameraDeviceSession::OutputThread::OutputThread(
       mCameraCharacteristics(chars),
       mBufferRequestThread(bufReqThread) {}
 
-ExternalCameraDeviceSession::OutputThread::~OutputThread() {}
+ExternalCameraDeviceSession::OutputThread::~OutputThread() {
+    stopPipeline();
+}
+
+void ExternalCameraDeviceSession::OutputThread::startPipeline() {
+    if (mPipelineStarted) {
+        return;
+    }
+    mPipelineStarted = true;
+    mConvertThread = std::make_unique<StageThread>([this] { return convertLoop(); });
+    mJpegThread = std::make_unique<StageThread>([this] { return jpegLoop(); });
+    mConvertThread->run();
+    mJpegThread->run();
+}
+
+void ExternalCameraDeviceSession::OutputThread::stopPipeline() {
+    if (!mPipelineStarted) {
+        return;
+    }
+    // Unblocks the stages waiting on a queue, they exit on the failed push or pop
+    mFreeYu12Frames.close();
+    mConvertQueue.close();
+    mJpegQueue.close();
+    mConvertThread->requestExitAndWait();
+    mJpegThread->requestExitAndWait();
+    mConvertThread.reset();
+    mJpegThread.reset();
+    mPipelineStarted = false;
+}
 
 Status ExternalCameraDeviceSession::OutputThread::allocateIntermediateBuffers(
         const Size& v4lSize, const Size& thumbSize, const std::vector<Stream>& streams,
         uint32_t blobBufferSize) {
     std::lock_guard<std::mutex> lk(mBufferLock);
-    if (!mScaledYu12Frames.empty()) {
+    if (!mScaledYu12Frames.empty() || !mJpegScaledYu12Frames.empty()) {
         ALOGE("%s: intermediate buffer pool has %zu inflight buffers! (expect 0)", __FUNCTION__,
-              mScaledYu12Frames.size());
+              mScaledYu12Frames.size() + mJpegScaledYu12Frames.size());
         return Status::INTERNAL_ERROR;
     }
 
@@ -2167,13 +2197,62 @@ Status ExternalCameraDeviceSession::OutputThread::allocateIntermediateBuffers(
         }
     }
 
+    Status status = allocateScaleBuffers(v4lSize, streams, &mIntermediateBuffers);
+    if (status != Status::OK) {
+        return status;
+    }
+
+    if (mPipelineStarted) {
+        // The JPEG stage scales the frame after the one being converted, to its own buffers
+        std::vector<Stream> blobStreams;
+        for (const auto& stream : streams) {
+            if (stream.format == PixelFormat::BLOB) {
+                blobStreams.push_back(stream);
+            }
+        }
+        status = allocateScaleBuffers(v4lSize, blobStreams, &mJpegIntermediateBuffers);
+        if (status != Status::OK) {
+            return status;
+        }
+
+        // Each frame in flight is decoded to its own YU12 frame, mYu12Frame being the first
+        mYu12FramePool.resize(kPipelineDepth);
+        mYu12FramePool[0] = mYu12Frame;
+        for (size_t i = 1; i < mYu12FramePool.size(); i++) {
+            auto& frame = mYu12FramePool[i];
+            if (frame == nullptr || frame->mWidth != v4lSize.width ||
+                frame->mHeight != v4lSize.height) {
+                frame = std::make_shared<AllocatedFrame>(v4lSize.width, v4lSize.height);
+                int ret = frame->allocate();
+                if (ret != 0) {
+                    ALOGE("%s: allocating YU12 frame failed!", __FUNCTION__);
+                    frame.reset();
+                    return Status::INTERNAL_ERROR;
+                }
+            }
+        }
+        mFreeYu12Frames.clear();
+        for (const auto& frame : mYu12FramePool) {
+            mFreeYu12Frames.push(frame);
+        }
+    }
+
+    // Allocate mute test pattern frame
+    mMuteTestPatternFrame.resize(mYu12Frame->mWidth * mYu12Frame->mHeight * 3);
+
+    mBlobBufferSize = blobBufferSize;
+    return Status::OK;
+}
+
+Status ExternalCameraDeviceSession::OutputThread::allocateScaleBuffers(
+        const Size& v4lSize, const std::vector<Stream>& streams, FrameMap* buffers) {
     // Allocating scaled buffers
     for (const auto& stream : streams) {
         Size sz = {stream.width, stream.height};
         if (sz == v4lSize) {
             continue;  // Don't need an intermediate buffer same size as v4lBuffer
         }
-        if (mIntermediateBuffers.count(sz) == 0) {
+        if (buffers->count(sz) == 0) {
             // Create new intermediate buffer
             std::shared_ptr<AllocatedFrame> buf =
                     std::make_shared<AllocatedFrame>(stream.width, stream.height);
@@ -2183,13 +2262,13 @@ Status ExternalCameraDeviceSession::OutputThread::allocateIntermediateBuffers(
                       stream.width, stream.height);
                 return Status::INTERNAL_ERROR;
             }
-            mIntermediateBuffers[sz] = buf;
+            (*buffers)[sz] = buf;
         }
     }
 
     // Remove unconfigured buffers
-    auto it = mIntermediateBuffers.begin();
-    while (it != mIntermediateBuffers.end()) {
+    auto it = buffers->begin();
+    while (it != buffers->end()) {
         bool configured = false;
         auto sz = it->first;
         for (const auto& stream : streams) {
@@ -2201,14 +2280,9 @@ Status ExternalCameraDeviceSession::OutputThread::allocateIntermediateBuffers(
         if (configured) {
             it++;
         } else {
-            it = mIntermediateBuffers.erase(it);
+            it = buffers->erase(it);
         }
     }
-
-    // Allocate mute test pattern frame
-    mMuteTestPatternFrame.resize(mYu12Frame->mWidth * mYu12Frame->mHeight * 3);
-
-    mBlobBufferSize = blobBufferSize;
     return Status::OK;
 }
 
@@ -2232,13 +2306,7 @@ void ExternalCameraDeviceSession::OutputThread::flush() {
     std::unique_lock<std::mutex> lk(mRequestListLock);
     std::list<std::shared_ptr<HalRequest>> reqs = std::move(mRequestList);
     mRequestList.clear();
-    if (mProcessingRequest) {
-        auto timeout = std::chrono::seconds(kFlushWaitTimeoutSec);
-        auto st = mRequestDoneCond.wait_for(lk, timeout);
-        if (st == std::cv_status::timeout) {
-            ALOGE("%s: wait for inflight request finish timeout!", __FUNCTION__);
-        }
-    }
+    waitForInflightRequestsLocked(lk);
 
     ALOGV("%s: flushing inflight requests", __FUNCTION__);
     lk.unlock();
@@ -2247,10 +2315,22 @@ void ExternalCameraDeviceSession::OutputThread::flush() {
     }
 }
 
+void ExternalCameraDeviceSession::OutputThread::waitForInflightRequestsLocked(
+        std::unique_lock<std::mutex>& lk) {
+    auto timeout = std::chrono::seconds(kFlushWaitTimeoutSec);
+    if (!mRequestDoneCond.wait_for(lk, timeout, [this] { return mInflightFrameNumbers.empty(); })) {
+        ALOGE("%s: wait for inflight request finish timeout!", __FUNCTION__);
+    }
+}
+
 void ExternalCameraDeviceSession::OutputThread::dump(int fd) {
-    std::lock_guard<std::mutex> lk(mRequestListLock);
-    if (mProcessingRequest) {
-        dprintf(fd, "OutputThread processing frame %d\n", mProcessingFrameNumber);
+    std::unique_lock<std::mutex> lk(mRequestListLock);
+    if (!mInflightFrameNumbers.empty()) {
+        dprintf(fd, "OutputThread processing frame: ");
+        for (int32_t frameNumber : mInflightFrameNumbers) {
+            dprintf(fd, "%d, ", frameNumber);
+        }
+        dprintf(fd, "\n");
     } else {
         dprintf(fd, "OutputThread not processing any frames\n");
     }
@@ -2259,6 +2339,23 @@ void ExternalCameraDeviceSession::OutputThread::dump(int fd) {
         dprintf(fd, "%d, ", req->frameNumber);
     }
     dprintf(fd, "\n");
+    lk.unlock();
+
+    if (!mPipelineStarted) {
+        return;
+    }
+    std::lock_guard<std::mutex> latencyLock(mLatencyLock);
+    dprintf(fd, "OutputThread latency over %" PRIu64 " frames (last/avg/max ms):\n",
+            mTotalLatency.count);
+    auto dumpLatency = [fd](const char* name, const StageLatency& latency) {
+        nsecs_t avgNs = latency.count == 0 ? 0 : latency.totalNs / latency.count;
+        dprintf(fd, "  %s: %.2f/%.2f/%.2f\n", name, latency.lastNs / 1e6, avgNs / 1e6,
+                latency.maxNs / 1e6);
+    };
+    dumpLatency("decode", mStageLatency[kDecodeStage]);
+    dumpLatency("convert", mStageLatency[kConvertStage]);
+    dumpLatency("jpeg", mStageLatency[kJpegStage]);
+    dumpLatency("total", mTotalLatency);
 }
 
 void ExternalCameraDeviceSession::OutputThread::setExifMakeModel(const std::string& make,
@@ -2279,13 +2376,7 @@ ExternalCameraDeviceSession::OutputThread::switchToOffline() {
     std::unique_lock<std::mutex> lk(mRequestListLock);
     std::list<std::shared_ptr<HalRequest>> reqs = std::move(mRequestList);
     mRequestList.clear();
-    if (mProcessingRequest) {
-        auto timeout = std::chrono::seconds(kFlushWaitTimeoutSec);
-        auto st = mRequestDoneCond.wait_for(lk, timeout);
-        if (st == std::cv_status::timeout) {
-            ALOGE("%s: wait for inflight request finish timeout!", __FUNCTION__);
-        }
-    }
+    waitForInflightRequestsLocked(lk);
     lk.unlock();
     clearIntermediateBuffers();
     ALOGV("%s: returning %zu request for offline processing", __FUNCTION__, reqs.size());
@@ -2334,20 +2425,26 @@ void ExternalCameraDeviceSession::OutputThread::waitForNextRequest(
     }
     *out = mRequestList.front();
     mRequestList.pop_front();
-    mProcessingRequest = true;
-    mProcessingFrameNumber = (*out)->frameNumber;
+    mInflightFrameNumbers.push_back((*out)->frameNumber);
 }
 
 void ExternalCameraDeviceSession::OutputThread::signalRequestDone() {
     std::unique_lock<std::mutex> lk(mRequestListLock);
-    mProcessingRequest = false;
-    mProcessingFrameNumber = 0;
+    if (!mInflightFrameNumbers.empty()) {
+        mInflightFrameNumbers.pop_front();
+    }
     lk.unlock();
-    mRequestDoneCond.notify_one();
+    mRequestDoneCond.notify_all();
 }
 
 int ExternalCameraDeviceSession::OutputThread::cropAndScaleLocked(
         std::shared_ptr<AllocatedFrame>& in, const Size& outSz, YCbCrLayout* out) {
+    return cropAndScale(in, outSz, mIntermediateBuffers, &mScaledYu12Frames, out);
+}
+
+int ExternalCameraDeviceSession::OutputThread::cropAndScale(
+        const std::shared_ptr<AllocatedFrame>& in, const Size& outSz,
+        const FrameMap& intermediateBuffers, FrameMap* scaledFrames, YCbCrLayout* out) {
     Size inSz = {in->mWidth, in->mHeight};
 
     int ret;
@@ -2384,13 +2481,13 @@ int ExternalCameraDeviceSession::OutputThread::cropAndScaleLocked(
         return 0;
     }
 
-    auto it = mScaledYu12Frames.find(outSz);
+    auto it = scaledFrames->find(outSz);
     std::shared_ptr<AllocatedFrame> scaledYu12Buf;
-    if (it != mScaledYu12Frames.end()) {
+    if (it != scaledFrames->end()) {
         scaledYu12Buf = it->second;
     } else {
-        it = mIntermediateBuffers.find(outSz);
-        if (it == mIntermediateBuffers.end()) {
+        it = intermediateBuffers.find(outSz);
+        if (it == intermediateBuffers.end()) {
             ALOGE("%s: failed to find intermediate buffer size %dx%d", __FUNCTION__, outSz.width,
                   outSz.height);
             return -1;
@@ -2422,12 +2519,12 @@ int ExternalCameraDeviceSession::OutputThread::cropAndScaleLocked(
     }
 
     *out = outLayout;
-    mScaledYu12Frames.insert({outSz, scaledYu12Buf});
+    scaledFrames->insert({outSz, scaledYu12Buf});
     return 0;
 }
 
 int ExternalCameraDeviceSession::OutputThread::cropAndScaleThumbLocked(
-        std::shared_ptr<AllocatedFrame>& in, const Size& outSz, YCbCrLayout* out) {
+        const std::shared_ptr<AllocatedFrame>& in, const Size& outSz, YCbCrLayout* out) {
     Size inSz{in->mWidth, in->mHeight};
 
     if ((outSz.width * outSz.height) > (mYu12ThumbFrame->mWidth * mYu12ThumbFrame->mHeight)) {
@@ -2551,6 +2648,13 @@ int ExternalCameraDeviceSession::OutputThread::cropAndScaleThumbLocked(
 
 int ExternalCameraDeviceSession::OutputThread::createJpegLocked(
         HalStreamBuffer& halBuf, const common::V1_0::helper::CameraMetadata& setting) {
+    return createJpeg(halBuf, setting, mYu12Frame, mIntermediateBuffers, &mScaledYu12Frames);
+}
+
+int ExternalCameraDeviceSession::OutputThread::createJpeg(
+        HalStreamBuffer& halBuf, const common::V1_0::helper::CameraMetadata& setting,
+        const std::shared_ptr<AllocatedFrame>& yu12Frame, const FrameMap& intermediateBuffers,
+        FrameMap* scaledFrames) {
     ATRACE_CALL();
     int ret;
     auto lfail = [&](auto... args) {
@@ -2568,7 +2672,7 @@ int ExternalCameraDeviceSession::OutputThread::createJpegLocked(
           static_cast<uint64_t>(halBuf.bufferId), halBuf.width, halBuf.height);
     ALOGV("%s: HAL buffer fmt: %x usage: %" PRIx64 " ptr: %p", __FUNCTION__, halBuf.format,
           static_cast<uint64_t>(halBuf.usage), halBuf.bufPtr);
-    ALOGV("%s: YV12 buffer %d x %d", __FUNCTION__, mYu12Frame->mWidth, mYu12Frame->mHeight);
+    ALOGV("%s: YV12 buffer %d x %d", __FUNCTION__, yu12Frame->mWidth, yu12Frame->mHeight);
 
     int jpegQuality, thumbQuality;
     Size thumbSize;
@@ -2623,7 +2727,7 @@ int ExternalCameraDeviceSession::OutputThread::createJpegLocked(
 
     YCbCrLayout yu12Thumb;
     if (outputThumbnail) {
-        ret = cropAndScaleThumbLocked(mYu12Frame, thumbSize, &yu12Thumb);
+        ret = cropAndScaleThumbLocked(yu12Frame, thumbSize, &yu12Thumb);
 
         if (ret != 0) {
             return lfail("%s: crop and scale thumbnail failed!", __FUNCTION__);
@@ -2631,7 +2735,7 @@ int ExternalCameraDeviceSession::OutputThread::createJpegLocked(
     }
 
     /* Scale and crop main jpeg */
-    ret = cropAndScaleLocked(mYu12Frame, jpegSize, &yu12Main);
+    ret = cropAndScale(yu12Frame, jpegSize, intermediateBuffers, scaledFrames, &yu12Main);
 
     if (ret != 0) {
         return lfail("%s: crop and scale main failed!", __FUNCTION__);
@@ -2712,6 +2816,9 @@ void ExternalCameraDeviceSession::OutputThread::clearIntermediateBuffers() {
     mYu12Frame.reset();
     mYu12ThumbFrame.reset();
     mIntermediateBuffers.clear();
+    mJpegIntermediateBuffers.clear();
+    mYu12FramePool.clear();
+    mFreeYu12Frames.clear();
     mMuteTestPatternFrame.clear();
     mBlobBufferSize = 0;
 }
@@ -2724,6 +2831,11 @@ bool ExternalCameraDeviceSession::OutputThread::threadLoop() {
         return false;
     }
 
+    if (mDeviceError) {
+        // Same as the serial thread stopping on a device error: requests are left to flush()
+        return false;
+    }
+
     // TODO: maybe we need to setup a sensor thread to dq/enq v4l frames
     //       regularly to prevent v4l buffer queue filled with stale buffers
     //       when app doesn't program a preview request
@@ -2733,12 +2845,22 @@ bool ExternalCameraDeviceSession::OutputThread::threadLoop() {
         return true;
     }
 
+    auto frame = std::make_shared<PipelineFrame>();
+    frame->req = req;
+    frame->startTs = systemTime(SYSTEM_TIME_MONOTONIC);
+
+    // Errors are reported by the JPEG stage, after the results of the frames ahead of this one
     auto onDeviceError = [&](auto... args) {
         ALOGE(args...);
-        parent->notifyError(req->frameNumber, /*stream*/ -1, ErrorCode::ERROR_DEVICE);
-        signalRequestDone();
+        frame->deviceError = true;
+        mDeviceError = true;
+        forwardFrame(mConvertQueue, frame);
         return false;
     };
+    auto onRequestError = [&]() {
+        frame->requestError = true;
+        return forwardFrame(mConvertQueue, frame);
+    };
 
     if (req->frameIn->mFourcc != V4L2_PIX_FMT_MJPEG && req->frameIn->mFourcc != V4L2_PIX_FMT_Z16) {
         return onDeviceError("%s: do not support V4L2 format %c%c%c%c", __FUNCTION__,
@@ -2747,19 +2869,29 @@ bool ExternalCameraDeviceSession::OutputThread::threadLoop() {
                              (req->frameIn->mFourcc >> 24) & 0xFF);
     }
 
+    // Blocks while kPipelineDepth frames are in flight
+    ATRACE_BEGIN("Wait for YU12 frame");
+    bool gotFrame = mFreeYu12Frames.pop(&frame->yu12Frame);
+    ATRACE_END();
+    if (!gotFrame) {
+        ALOGW("%s: pipeline stopped, returning frame %d", __FUNCTION__, req->frameNumber);
+        parent->processCaptureRequestError(req);
+        signalRequestDone();
+        return false;
+    }
+    nsecs_t decodeStartTs = systemTime(SYSTEM_TIME_MONOTONIC);
+
     int res = requestBufferStart(req->buffers);
     if (res != 0) {
         ALOGE("%s: send BufferRequest failed! res %d", __FUNCTION__, res);
         return onDeviceError("%s: failed to send buffer request!", __FUNCTION__);
     }
 
-    std::unique_lock<std::mutex> lk(mBufferLock);
     // Convert input V4L2 frame to YU12 of the same size
     // TODO: see if we can save some computation by converting to YV12 here
     uint8_t* inData;
     size_t inDataSize;
     if (req->frameIn->getData(&inData, &inDataSize) != 0) {
-        lk.unlock();
         return onDeviceError("%s: V4L2 buffer map failed", __FUNCTION__);
     }
 
@@ -2787,28 +2919,14 @@ bool ExternalCameraDeviceSession::OutputThread::threadLoop() {
         }
     }
 
-    // TODO: in some special case maybe we can decode jpg directly to gralloc output?
-    if (req->frameIn->mFourcc == V4L2_PIX_FMT_MJPEG) {
-        ATRACE_BEGIN("MJPGtoI420");
-        res = 0;
-        if (mCameraMuted) {
-            res = libyuv::ConvertToI420(
-                    mMuteTestPatternFrame.data(), mMuteTestPatternFrame.size(),
-                    static_cast<uint8_t*>(mYu12FrameLayout.y), mYu12FrameLayout.yStride,
-                    static_cast<uint8_t*>(mYu12FrameLayout.cb), mYu12FrameLayout.cStride,
-                    static_cast<uint8_t*>(mYu12FrameLayout.cr), mYu12FrameLayout.cStride, 0, 0,
-                    mYu12Frame->mWidth, mYu12Frame->mHeight, mYu12Frame->mWidth,
-                    mYu12Frame->mHeight, libyuv::kRotate0, libyuv::FOURCC_RAW);
-        } else {
-            res = libyuv::MJPGToI420(
-                    inData, inDataSize, static_cast<uint8_t*>(mYu12FrameLayout.y),
-                    mYu12FrameLayout.yStride, static_cast<uint8_t*>(mYu12FrameLayout.cb),
-                    mYu12FrameLayout.cStride, static_cast<uint8_t*>(mYu12FrameLayout.cr),
-                    mYu12FrameLayout.cStride, mYu12Frame->mWidth, mYu12Frame->mHeight,
-                    mYu12Frame->mWidth, mYu12Frame->mHeight);
-        }
-        ATRACE_END();
-
+    const Size v4lSize{frame->yu12Frame->mWidth, frame->yu12Frame->mHeight};
+    const bool isMjpeg = req->frameIn->mFourcc == V4L2_PIX_FMT_MJPEG;
+    // The output buffer must be ready to be decoded to, so only decode ahead of the buffer
+    // request otherwise
+    const bool tryDecodeToOutput =
+            isMjpeg && !mCameraMuted && canDecodeToOutput(req->buffers, v4lSize);
+    if (isMjpeg && !tryDecodeToOutput) {
+        res = decodeToYu12(frame->yu12Frame, inData, inDataSize);
         if (res != 0) {
             // For some webcam, the first few V4L2 frames might be malformed...
             ALOGE("%s: Convert V4L2 frame to YU12 failed! res %d", __FUNCTION__, res);
@@ -2817,13 +2935,7 @@ bool ExternalCameraDeviceSession::OutputThread::threadLoop() {
             res = waitForBufferRequestDone(&req->buffers);
             ATRACE_END();
 
-            lk.unlock();
-            Status st = parent->processCaptureRequestError(req);
-            if (st != Status::OK) {
-                return onDeviceError("%s: failed to process capture request error!", __FUNCTION__);
-            }
-            signalRequestDone();
-            return true;
+            return onRequestError();
         }
     }
 
@@ -2834,13 +2946,7 @@ bool ExternalCameraDeviceSession::OutputThread::threadLoop() {
     if (res != 0) {
         // HAL buffer management buffer request can fail
         ALOGE("%s: wait for BufferRequest done failed! res %d", __FUNCTION__, res);
-        lk.unlock();
-        Status st = parent->processCaptureRequestError(req);
-        if (st != Status::OK) {
-            return onDeviceError("%s: failed to process capture request error!", __FUNCTION__);
-        }
-        signalRequestDone();
-        return true;
+        return onRequestError();
     }
 
     ALOGV("%s processing new request", __FUNCTION__);
@@ -2858,22 +2964,125 @@ bool ExternalCameraDeviceSession::OutputThread::threadLoop() {
                 halBuf.acquireFence = -1;
             }
         }
+    }
+
+    if (tryDecodeToOutput && !req->buffers[0].fenceTimeout) {
+        frame->decodedToOutput =
+                decodeToOutput(inData, inDataSize, v4lSize, req->buffers[0]) == 0;
+        if (!frame->decodedToOutput) {
+            // Not a 422 or 420 frame, or a malformed one: take the regular path
+            res = decodeToYu12(frame->yu12Frame, inData, inDataSize);
+            if (res != 0) {
+                ALOGE("%s: Convert V4L2 frame to YU12 failed! res %d", __FUNCTION__, res);
+                return onRequestError();
+            }
+        }
+    }
+
+    frame->stageNs[kDecodeStage] = systemTime(SYSTEM_TIME_MONOTONIC) - decodeStartTs;
+    return forwardFrame(mConvertQueue, frame);
+}
+
+int ExternalCameraDeviceSession::OutputThread::decodeToYu12(
+        const std::shared_ptr<AllocatedFrame>& yu12Frame, const uint8_t* inData,
+        size_t inDataSize) {
+    YCbCrLayout yu12Layout;
+    if (yu12Frame->getLayout(&yu12Layout) != 0) {
+        ALOGE("%s: failed to get YU12 frame layout", __FUNCTION__);
+        return -1;
+    }
+    ATRACE_BEGIN("MJPGtoI420");
+    int res = 0;
+    if (mCameraMuted) {
+        res = libyuv::ConvertToI420(
+                mMuteTestPatternFrame.data(), mMuteTestPatternFrame.size(),
+                static_cast<uint8_t*>(yu12Layout.y), yu12Layout.yStride,
+                static_cast<uint8_t*>(yu12Layout.cb), yu12Layout.cStride,
+                static_cast<uint8_t*>(yu12Layout.cr), yu12Layout.cStride, 0, 0, yu12Frame->mWidth,
+                yu12Frame->mHeight, yu12Frame->mWidth, yu12Frame->mHeight, libyuv::kRotate0,
+                libyuv::FOURCC_RAW);
+    } else {
+        res = libyuv::MJPGToI420(
+                inData, inDataSize, static_cast<uint8_t*>(yu12Layout.y), yu12Layout.yStride,
+                static_cast<uint8_t*>(yu12Layout.cb), yu12Layout.cStride,
+                static_cast<uint8_t*>(yu12Layout.cr), yu12Layout.cStride, yu12Frame->mWidth,
+                yu12Frame->mHeight, yu12Frame->mWidth, yu12Frame->mHeight);
+    }
+    ATRACE_END();
+    return res;
+}
+
+int ExternalCameraDeviceSession::OutputThread::decodeToOutput(const uint8_t* inData,
+                                                              size_t inDataSize,
+                                                              const Size& v4lSize,
+                                                              HalStreamBuffer& halBuf) {
+    ATRACE_CALL();
+    android::Rect outRect{0, 0, static_cast<int32_t>(halBuf.width),
+                          static_cast<int32_t>(halBuf.height)};
+    android_ycbcr result = sHandleImporter.lockYCbCr(
+            *(halBuf.bufPtr), static_cast<uint64_t>(halBuf.usage), outRect);
+    int ret = -1;
+    if (result.ystride > UINT32_MAX || result.cstride > UINT32_MAX ||
+        result.chroma_step > UINT32_MAX) {
+        ALOGE("%s: lockYCbCr failed. Unexpected values!", __FUNCTION__);
+    } else {
+        YCbCrLayout outLayout = {.y = result.y,
+                                 .cb = result.cb,
+                                 .cr = result.cr,
+                                 .yStride = static_cast<uint32_t>(result.ystride),
+                                 .cStride = static_cast<uint32_t>(result.cstride),
+                                 .chromaStep = static_cast<uint32_t>(result.chroma_step)};
+        ret = decodeJpegYCbCr(inData, inDataSize, v4lSize, Size{halBuf.width, halBuf.height},
+                              outLayout);
+    }
+    int relFence = sHandleImporter.unlock(*(halBuf.bufPtr));
+    if (relFence >= 0) {
+        halBuf.acquireFence = relFence;
+    }
+    return ret;
+}
+
+bool ExternalCameraDeviceSession::OutputThread::convertLoop() {
+    std::shared_ptr<PipelineFrame> frame;
+    if (!mConvertQueue.pop(&frame)) {
+        return false;
+    }
+
+    // After ERROR_DEVICE the JPEG stage fails the frame, don't bother converting it
+    if (!frame->requestError && !frame->deviceError && !frame->decodedToOutput &&
+        !mDeviceErrorNotified) {
+        nsecs_t startTs = systemTime(SYSTEM_TIME_MONOTONIC);
+        if (convertBuffers(*frame) != 0) {
+            frame->deviceError = true;
+            mDeviceError = true;
+        }
+        mScaledYu12Frames.clear();
+        frame->stageNs[kConvertStage] = systemTime(SYSTEM_TIME_MONOTONIC) - startTs;
+    }
+    forwardFrame(mJpegQueue, frame);
+    return true;
+}
 
+int ExternalCameraDeviceSession::OutputThread::convertBuffers(PipelineFrame& frame) {
+    ATRACE_CALL();
+    std::shared_ptr<HalRequest>& req = frame.req;
+    for (auto& halBuf : req->buffers) {
         if (halBuf.fenceTimeout) {
             continue;
         }
 
         // Gralloc lockYCbCr the buffer
         switch (halBuf.format) {
-            case PixelFormat::BLOB: {
-                int ret = createJpegLocked(halBuf, req->setting);
-
-                if (ret != 0) {
-                    lk.unlock();
-                    return onDeviceError("%s: createJpegLocked failed with %d", __FUNCTION__, ret);
-                }
-            } break;
+            case PixelFormat::BLOB:
+                // Encoded by the JPEG stage
+                break;
             case PixelFormat::Y16: {
+                uint8_t* inData;
+                size_t inDataSize;
+                if (req->frameIn->getData(&inData, &inDataSize) != 0) {
+                    ALOGE("%s: V4L2 buffer map failed", __FUNCTION__);
+                    return 1;
+                }
                 void* outLayout = sHandleImporter.lock(
                         *(halBuf.bufPtr), static_cast<uint64_t>(halBuf.usage), inDataSize);
 
@@ -2895,7 +3104,8 @@ bool ExternalCameraDeviceSession::OutputThread::threadLoop() {
                       result.chroma_step);
                 if (result.ystride > UINT32_MAX || result.cstride > UINT32_MAX ||
                     result.chroma_step > UINT32_MAX) {
-                    return onDeviceError("%s: lockYCbCr failed. Unexpected values!", __FUNCTION__);
+                    ALOGE("%s: lockYCbCr failed. Unexpected values!", __FUNCTION__);
+                    return 1;
                 }
                 YCbCrLayout outLayout = {.y = result.y,
                                          .cb = result.cb,
@@ -2911,13 +3121,13 @@ bool ExternalCameraDeviceSession::OutputThread::threadLoop() {
                       (outputFourcc >> 24) & 0xFF);
 
                 YCbCrLayout cropAndScaled;
-                ATRACE_BEGIN("cropAndScaleLocked");
-                int ret = cropAndScaleLocked(mYu12Frame, Size{halBuf.width, halBuf.height},
-                                             &cropAndScaled);
+                ATRACE_BEGIN("cropAndScale");
+                int ret = cropAndScale(frame.yu12Frame, Size{halBuf.width, halBuf.height},
+                                       mIntermediateBuffers, &mScaledYu12Frames, &cropAndScaled);
                 ATRACE_END();
                 if (ret != 0) {
-                    lk.unlock();
-                    return onDeviceError("%s: crop and scale failed!", __FUNCTION__);
+                    ALOGE("%s: crop and scale failed!", __FUNCTION__);
+                    return ret;
                 }
 
                 Size sz{halBuf.width, halBuf.height};
@@ -2925,8 +3135,8 @@ bool ExternalCameraDeviceSession::OutputThread::threadLoop() {
                 ret = formatConvert(cropAndScaled, outLayout, sz, outputFourcc);
                 ATRACE_END();
                 if (ret != 0) {
-                    lk.unlock();
-                    return onDeviceError("%s: format conversion failed!", __FUNCTION__);
+                    ALOGE("%s: format conversion failed!", __FUNCTION__);
+                    return ret;
                 }
                 int relFence = sHandleImporter.unlock(*(halBuf.bufPtr));
                 if (relFence >= 0) {
@@ -2934,22 +3144,99 @@ bool ExternalCameraDeviceSession::OutputThread::threadLoop() {
                 }
             } break;
             default:
-                lk.unlock();
-                return onDeviceError("%s: unknown output format %x", __FUNCTION__, halBuf.format);
+                ALOGE("%s: unknown output format %x", __FUNCTION__, halBuf.format);
+                return 1;
         }
     }  // for each buffer
-    mScaledYu12Frames.clear();
+    return 0;
+}
 
-    // Don't hold the lock while calling back to parent
-    lk.unlock();
-    Status st = parent->processCaptureResult(req);
-    if (st != Status::OK) {
-        return onDeviceError("%s: failed to process capture result!", __FUNCTION__);
+bool ExternalCameraDeviceSession::OutputThread::jpegLoop() {
+    std::shared_ptr<PipelineFrame> frame;
+    if (!mJpegQueue.pop(&frame)) {
+        return false;
     }
-    signalRequestDone();
+    auto parent = mParent.lock();
+    if (parent == nullptr) {
+        ALOGE("%s: session has been disconnected!", __FUNCTION__);
+        signalRequestDone();
+        return false;
+    }
+
+    if (!frame->requestError && !frame->deviceError && !mDeviceErrorNotified) {
+        nsecs_t startTs = systemTime(SYSTEM_TIME_MONOTONIC);
+        for (auto& halBuf : frame->req->buffers) {
+            if (halBuf.fenceTimeout || halBuf.format != PixelFormat::BLOB) {
+                continue;
+            }
+            int ret = createJpeg(halBuf, frame->req->setting, frame->yu12Frame,
+                                 mJpegIntermediateBuffers, &mJpegScaledYu12Frames);
+            if (ret != 0) {
+                ALOGE("%s: createJpeg failed with %d", __FUNCTION__, ret);
+                frame->deviceError = true;
+                mDeviceError = true;
+                break;
+            }
+        }
+        mJpegScaledYu12Frames.clear();
+        frame->stageNs[kJpegStage] = systemTime(SYSTEM_TIME_MONOTONIC) - startTs;
+    }
+    returnFrame(parent, *frame);
     return true;
 }
 
+bool ExternalCameraDeviceSession::OutputThread::forwardFrame(
+        BoundedQueue<std::shared_ptr<PipelineFrame>>& queue,
+        const std::shared_ptr<PipelineFrame>& frame) {
+    if (queue.push(frame)) {
+        return true;
+    }
+    // The session is closing, its buffers are released with it
+    ALOGW("%s: pipeline stopped, dropping frame %d", __FUNCTION__, frame->req->frameNumber);
+    signalRequestDone();
+    return false;
+}
+
+void ExternalCameraDeviceSession::OutputThread::returnFrame(
+        const std::shared_ptr<OutputThreadInterface>& parent, PipelineFrame& frame) {
+    // The decoded frame is no longer needed, let the decode stage start the next request
+    if (frame.yu12Frame != nullptr) {
+        mFreeYu12Frames.push(std::move(frame.yu12Frame));
+    }
+
+    if (mDeviceErrorNotified) {
+        // Return the frames behind the failing one as flush() does, so that their V4L2 and
+        // output buffers come back
+        ALOGW("%s: device error, failing frame %d", __FUNCTION__, frame.req->frameNumber);
+        parent->processCaptureRequestError(frame.req);
+    } else if (frame.deviceError) {
+        notifyDeviceError(parent, frame);
+    } else {
+        // Don't hold the lock while calling back to parent
+        Status st = frame.requestError ? parent->processCaptureRequestError(frame.req)
+                                       : parent->processCaptureResult(frame.req);
+        if (st != Status::OK) {
+            ALOGE("%s: failed to process capture %s!", __FUNCTION__,
+                  frame.requestError ? "request error" : "result");
+            notifyDeviceError(parent, frame);
+        } else if (!frame.requestError) {
+            std::lock_guard<std::mutex> lk(mLatencyLock);
+            for (int stage = 0; stage < kStageCount; stage++) {
+                mStageLatency[stage].add(frame.stageNs[stage]);
+            }
+            mTotalLatency.add(systemTime(SYSTEM_TIME_MONOTONIC) - frame.startTs);
+        }
+    }
+    signalRequestDone();
+}
+
+void ExternalCameraDeviceSession::OutputThread::notifyDeviceError(
+        const std::shared_ptr<OutputThreadInterface>& parent, const PipelineFrame& frame) {
+    mDeviceError = true;
+    mDeviceErrorNotified = true;
+    parent->notifyError(frame.req->frameNumber, /*stream*/ -1, ErrorCode::ERROR_DEVICE);
+}
+
 // End ExternalCameraDeviceSession::OutputThread functions
 
 }  // namespace implementation
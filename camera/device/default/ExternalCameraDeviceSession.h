@@ -29,7 +29,10 @@
 #include <android/hardware/graphics/mapper/4.0/IMapper.h>
 #include <fmq/AidlMessageQueue.h>
 #include <utils/Thread.h>
+#include <algorithm>
+#include <atomic>
 #include <deque>
+#include <functional>
 #include <list>
 
 namespace android {
@@ -178,6 +181,12 @@ class ExternalCameraDeviceSession : public BnCameraDeviceSession, public OutputT
 
         void setExifMakeModel(const std::string& make, const std::string& model);
 
+        // Starts the scale/convert and JPEG stage threads fed by threadLoop(), which then only
+        // decodes. Must be called before run() and allocateIntermediateBuffers().
+        void startPipeline();
+        // Stops the stage threads. Frames still queued between stages are dropped.
+        void stopPipeline();
+
         // The remaining request list is returned for offline processing
         std::list<std::shared_ptr<HalRequest>> switchToOffline();
 
@@ -185,6 +194,51 @@ class ExternalCameraDeviceSession : public BnCameraDeviceSession, public OutputT
         static const int kFlushWaitTimeoutSec = 3;  // 3 sec
         static const int kReqWaitTimeoutMs = 33;    // 33ms
         static const int kReqWaitTimesMax = 90;     // 33ms * 90 ~= 3 sec
+        // Frames in flight in the pipeline, one per stage
+        static const size_t kPipelineDepth = 3;
+
+        using FrameMap = std::unordered_map<Size, std::shared_ptr<AllocatedFrame>, SizeHasher>;
+
+        // Runs the loop of one pipeline stage until it returns false.
+        class StageThread : public SimpleThread {
+          public:
+            explicit StageThread(std::function<bool()> loop) : mLoop(std::move(loop)) {}
+
+          protected:
+            bool threadLoop() override { return mLoop(); }
+
+          private:
+            const std::function<bool()> mLoop;
+        };
+
+        enum Stage { kDecodeStage, kConvertStage, kJpegStage, kStageCount };
+
+        // A request moving through the pipeline. Every request, failed or not, reaches the JPEG
+        // stage, which returns them all so that results stay in frame order.
+        struct PipelineFrame {
+            std::shared_ptr<HalRequest> req;
+            // YU12 decode of req->frameIn, taken from mFreeYu12Frames
+            std::shared_ptr<AllocatedFrame> yu12Frame;
+            bool requestError = false;  // return the request through processCaptureRequestError
+            bool deviceError = false;   // notify ERROR_DEVICE instead of returning the request
+            bool decodedToOutput = false;  // the only output buffer was decoded to directly
+            nsecs_t startTs = 0;
+            nsecs_t stageNs[kStageCount] = {};
+        };
+
+        struct StageLatency {
+            nsecs_t lastNs = 0;
+            nsecs_t maxNs = 0;
+            nsecs_t totalNs = 0;
+            uint64_t count = 0;
+
+            void add(nsecs_t ns) {
+                lastNs = ns;
+                maxNs = std::max(maxNs, ns);
+                totalNs += ns;
+                count++;
+            }
+        };
 
         // Methods to request output buffer in parallel
         int requestBufferStart(const std::vector<HalStreamBuffer>&);
@@ -192,40 +246,79 @@ class ExternalCameraDeviceSession : public BnCameraDeviceSession, public OutputT
                 /*out*/ std::vector<HalStreamBuffer>*);
 
         void waitForNextRequest(std::shared_ptr<HalRequest>* out);
+        // Requests complete in order, this retires the oldest one in flight
         void signalRequestDone();
+        // Waits until no request is in flight, with mRequestListLock held in 'lk'
+        void waitForInflightRequestsLocked(std::unique_lock<std::mutex>& lk);
 
         int cropAndScaleLocked(std::shared_ptr<AllocatedFrame>& in, const Size& outSize,
                                YCbCrLayout* out);
+        int cropAndScale(const std::shared_ptr<AllocatedFrame>& in, const Size& outSize,
+                         const FrameMap& intermediateBuffers, FrameMap* scaledFrames,
+                         YCbCrLayout* out);
 
-        int cropAndScaleThumbLocked(std::shared_ptr<AllocatedFrame>& in, const Size& outSize,
-                                    YCbCrLayout* out);
+        int cropAndScaleThumbLocked(const std::shared_ptr<AllocatedFrame>& in,
+                                    const Size& outSize, YCbCrLayout* out);
 
         int createJpegLocked(HalStreamBuffer& halBuf,
                              const common::V1_0::helper::CameraMetadata& settings);
+        int createJpeg(HalStreamBuffer& halBuf,
+                       const common::V1_0::helper::CameraMetadata& settings,
+                       const std::shared_ptr<AllocatedFrame>& yu12Frame,
+                       const FrameMap& intermediateBuffers, FrameMap* scaledFrames);
 
+        Status allocateScaleBuffers(const Size& v4lSize, const std::vector<Stream>& streams,
+                                    FrameMap* buffers);
         void clearIntermediateBuffers();
 
+        // Pipeline stages after the decode done by threadLoop()
+        int decodeToYu12(const std::shared_ptr<AllocatedFrame>& yu12Frame, const uint8_t* inData,
+                         size_t inDataSize);
+        // Decodes straight to the single YUV output of the request when canDecodeToOutput()
+        // allows it, skipping the YU12 frame and the conversion
+        int decodeToOutput(const uint8_t* inData, size_t inDataSize, const Size& v4lSize,
+                           HalStreamBuffer& halBuf);
+        bool convertLoop();
+        bool jpegLoop();
+        int convertBuffers(PipelineFrame& frame);
+        // Passes 'frame' to the next stage, returns false if the pipeline is stopping
+        bool forwardFrame(BoundedQueue<std::shared_ptr<PipelineFrame>>& queue,
+                          const std::shared_ptr<PipelineFrame>& frame);
+        // Returns the request of 'frame', as a request error if ERROR_DEVICE was already sent
+        void returnFrame(const std::shared_ptr<OutputThreadInterface>& parent,
+                         PipelineFrame& frame);
+        void notifyDeviceError(const std::shared_ptr<OutputThreadInterface>& parent,
+                               const PipelineFrame& frame);
+
         const std::weak_ptr<OutputThreadInterface> mParent;
         const CroppingType mCroppingType;
         const common::V1_0::helper::CameraMetadata mCameraCharacteristics;
 
-        mutable std::mutex mRequestListLock;       // Protect access to mRequestList,
-                                                   // mProcessingRequest and mProcessingFrameNumber
+        mutable std::mutex mRequestListLock;       // Protect access to mRequestList and
+                                                   // mInflightFrameNumbers
         std::condition_variable mRequestCond;      // signaled when a new request is submitted
         std::condition_variable mRequestDoneCond;  // signaled when a request is done processing
         std::list<std::shared_ptr<HalRequest>> mRequestList;
-        bool mProcessingRequest = false;
-        uint32_t mProcessingFrameNumber = 0;
+        // Frames taken from mRequestList and not returned yet, oldest first
+        std::deque<int32_t> mInflightFrameNumbers;
 
         // V4L2 frameIn
         // (MJPG decode)-> mYu12Frame
         // (Scale)-> mScaledYu12Frames
         // (Format convert) -> output gralloc frames
+        //
+        // When the pipeline runs, each frame in flight is decoded to its own frame of
+        // mYu12FramePool, the convert stage scales into mIntermediateBuffers and the JPEG stage
+        // into mJpegIntermediateBuffers. The stages don't take mBufferLock: the buffers are only
+        // reallocated or cleared while no request is in flight.
         mutable std::mutex mBufferLock;  // Protect access to intermediate buffers
         std::shared_ptr<AllocatedFrame> mYu12Frame;
         std::shared_ptr<AllocatedFrame> mYu12ThumbFrame;
-        std::unordered_map<Size, std::shared_ptr<AllocatedFrame>, SizeHasher> mIntermediateBuffers;
-        std::unordered_map<Size, std::shared_ptr<AllocatedFrame>, SizeHasher> mScaledYu12Frames;
+        FrameMap mIntermediateBuffers;
+        FrameMap mScaledYu12Frames;
+        FrameMap mJpegIntermediateBuffers;
+        FrameMap mJpegScaledYu12Frames;
+        std::vector<std::shared_ptr<AllocatedFrame>> mYu12FramePool;
         YCbCrLayout mYu12FrameLayout;
         YCbCrLayout mYu12ThumbFrameLayout;
         std::vector<uint8_t> mMuteTestPatternFrame;
@@ -237,6 +330,21 @@ class ExternalCameraDeviceSession : public BnCameraDeviceSession, public OutputT
         std::string mExifModel;
 
         const std::shared_ptr<BufferRequestThread> mBufferRequestThread;
+
+        // Decode (threadLoop) -> mConvertQueue -> convert -> mJpegQueue -> JPEG and result
+        bool mPipelineStarted = false;
+        std::atomic_bool mDeviceError = false;
+        // Set by the JPEG stage once it sent ERROR_DEVICE, the frames behind then fail
+        std::atomic_bool mDeviceErrorNotified = false;
+        BoundedQueue<std::shared_ptr<AllocatedFrame>> mFreeYu12Frames{kPipelineDepth};
+        BoundedQueue<std::shared_ptr<PipelineFrame>> mConvertQueue{1};
+        BoundedQueue<std::shared_ptr<PipelineFrame>> mJpegQueue{1};
+        std::unique_ptr<StageThread> mConvertThread;
+        std::unique_ptr<StageThread> mJpegThread;
+
+        mutable std::mutex mLatencyLock;  // Protect access to mStageLatency and mTotalLatency
+        StageLatency mStageLatency[kStageCount];
+        StageLatency mTotalLatency;  // from dequeuing the request to returning it
     };
 
   private:
@@ -26,6 +26,9 @@
 #include <algorithm>
 #include <cinttypes>
 #include <cmath>
+#include <csetjmp>
+#include <memory>
+#include <thread>
 
 #define HAVE_JPEG  // required for libyuv.h to export MJPEG decode APIs
 #include <libyuv.h>
@@ -567,9 +570,21 @@ int formatConvert(const YCbCrLayout& in, const YCbCrLayout& out, Size sz, uint32
     return 0;
 }
 
-int encodeJpegYU12(const Size& inSz, const YCbCrLayout& inLayout, int jpegQuality,
-                   const void* app1Buffer, size_t app1Size, void* out, size_t maxOutSize,
-                   size_t& actualCodeSize) {
+namespace {
+
+/* Strips of the parallel encoder are at least this many MCU rows high */
+const int32_t kMinJpegStripMcuRows = 16;
+const size_t kMaxJpegStrips = 4;
+const uint8_t kJpegSof0 = 0xC0;
+const uint8_t kJpegSos = 0xDA;
+
+/* Encodes 'rowCount' rows of 'inLayout' from 'firstRow', a multiple of the
+ * MCU height, as a standalone JPEG. With 'restartRows', every MCU row but
+ * the last one ends with a restart marker, so that the scan can be
+ * continued by another strip */
+int encodeJpegYU12Rows(const Size& inSz, const YCbCrLayout& inLayout, int32_t firstRow,
+                       int32_t rowCount, int jpegQuality, const void* app1Buffer, size_t app1Size,
+                       bool restartRows, void* out, size_t maxOutSize, size_t& actualCodeSize) {
     /* libjpeg is a C library so we use C-style "inheritance" by
      * putting libjpeg's jpeg_destination_mgr first in our custom
      * struct. This allows us to cast jpeg_destination_mgr* to
@@ -641,7 +656,7 @@ int encodeJpegYU12(const Size& inSz, const YCbCrLayout& inLayout, int jpegQualit
      * straight subsampled planar YCbCr and it will not touch our pixel
      * data or do any scaling or anything */
     cinfo.image_width = inSz.width;
-    cinfo.image_height = inSz.height;
+    cinfo.image_height = rowCount;
     cinfo.input_components = 3;
     cinfo.in_color_space = JCS_YCbCr;
 
@@ -652,6 +667,9 @@ int encodeJpegYU12(const Size& inSz, const YCbCrLayout& inLayout, int jpegQualit
     jpeg_set_colorspace(&cinfo, JCS_YCbCr);
     cinfo.raw_data_in = 1;
     cinfo.dct_method = JDCT_IFAST;
+    if (restartRows) {
+        cinfo.restart_in_rows = 1;
+    }
 
     /* Configure sampling factors. The sampling factor is JPEG subsampling 420
      * because the source format is YUV420. Note that libjpeg sampling factors
@@ -676,7 +694,7 @@ int encodeJpegYU12(const Size& inSz, const YCbCrLayout& inLayout, int jpegQualit
      * pads horizontally */
 
     size_t mcuV = DCTSIZE * maxVSampFactor;
-    size_t paddedHeight = mcuV * ((inSz.height + mcuV - 1) / mcuV);
+    size_t paddedHeight = mcuV * ((rowCount + mcuV - 1) / mcuV);
 
     /* libjpeg uses arrays of row pointers, which makes it really easy to pad
      * data vertically (unfortunately doesn't help horizontally) */
@@ -684,17 +702,17 @@ int encodeJpegYU12(const Size& inSz, const YCbCrLayout& inLayout, int jpegQualit
     std::vector<JSAMPROW> cbLines(paddedHeight / cVSubSampling);
     std::vector<JSAMPROW> crLines(paddedHeight / cVSubSampling);
 
-    uint8_t* py = static_cast<uint8_t*>(inLayout.y);
-    uint8_t* pcb = static_cast<uint8_t*>(inLayout.cb);
-    uint8_t* pcr = static_cast<uint8_t*>(inLayout.cr);
+    uint8_t* py = static_cast<uint8_t*>(inLayout.y) + firstRow * inLayout.yStride;
+    uint8_t* pcb = static_cast<uint8_t*>(inLayout.cb) + firstRow / cVSubSampling * inLayout.cStride;
+    uint8_t* pcr = static_cast<uint8_t*>(inLayout.cr) + firstRow / cVSubSampling * inLayout.cStride;
 
     for (int32_t i = 0; i < paddedHeight; i++) {
         /* Once we are in the padding territory we still point to the last line
          * effectively replicating it several times ~ CLAMP_TO_EDGE */
-        int li = std::min(i, inSz.height - 1);
+        int li = std::min(i, rowCount - 1);
         yLines[i] = static_cast<JSAMPROW>(py + li * inLayout.yStride);
         if (i < paddedHeight / cVSubSampling) {
-            li = std::min(i, (inSz.height - 1) / cVSubSampling);
+            li = std::min(i, (rowCount - 1) / cVSubSampling);
             cbLines[i] = static_cast<JSAMPROW>(pcb + li * inLayout.cStride);
             crLines[i] = static_cast<JSAMPROW>(pcr + li * inLayout.cStride);
         }
@@ -718,12 +736,17 @@ int encodeJpegYU12(const Size& inSz, const YCbCrLayout& inLayout, int jpegQualit
         if (done != batchSize) {
             ALOGE("%s: compressed %u lines, expected %u (total %u/%u)", __FUNCTION__, done,
                   batchSize, cinfo.next_scanline, cinfo.image_height);
+            jpeg_destroy_compress(&cinfo);
             return -1;
         }
     }
 
     /* This will flush everything */
     jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+    if (!dmgr.mSuccess) {
+        return -1;
+    }
 
     /* Grab the actual code size and set it */
     actualCodeSize = dmgr.mEncodedSize;
@@ -731,6 +754,332 @@ int encodeJpegYU12(const Size& inSz, const YCbCrLayout& inLayout, int jpegQualit
     return 0;
 }
 
+/* Returns the offset of the marker segment 'code' in 'jpeg', walking the
+ * segments that follow SOI up to SOS, or 0 if it is not found */
+size_t findJpegMarker(const uint8_t* jpeg, size_t size, uint8_t code) {
+    size_t pos = 2;
+    while (pos + 4 <= size && jpeg[pos] == 0xFF) {
+        if (jpeg[pos + 1] == code) {
+            return pos;
+        }
+        if (jpeg[pos + 1] == kJpegSos) {
+            break;
+        }
+        pos += 2 + ((jpeg[pos + 2] << 8) | jpeg[pos + 3]);
+    }
+    return 0;
+}
+
+/* Offset of the entropy coded data of the scan in 'jpeg', or 0 */
+size_t findJpegScanData(const uint8_t* jpeg, size_t size) {
+    size_t pos = findJpegMarker(jpeg, size, kJpegSos);
+    if (pos == 0) {
+        return 0;
+    }
+    pos += 2 + ((jpeg[pos + 2] << 8) | jpeg[pos + 3]);
+    return pos < size ? pos : 0;
+}
+
+}  // namespace
+
+size_t getJpegStripCount(const Size& inSz) {
+    /* YU12 is coded with 16 lines high MCUs */
+    const int32_t mcuRows = (inSz.height + 2 * DCTSIZE - 1) / (2 * DCTSIZE);
+    size_t strips = std::max(1u, std::thread::hardware_concurrency());
+    strips = std::min(strips, kMaxJpegStrips);
+    return std::max<size_t>(1, std::min<size_t>(strips, mcuRows / kMinJpegStripMcuRows));
+}
+
+int encodeJpegYU12(const Size& inSz, const YCbCrLayout& inLayout, int jpegQuality,
+                   const void* app1Buffer, size_t app1Size, void* out, size_t maxOutSize,
+                   size_t& actualCodeSize) {
+    return encodeJpegYU12Strips(inSz, inLayout, jpegQuality, app1Buffer, app1Size, out,
+                                maxOutSize, actualCodeSize, getJpegStripCount(inSz));
+}
+
+int encodeJpegYU12Strips(const Size& inSz, const YCbCrLayout& inLayout, int jpegQuality,
+                         const void* app1Buffer, size_t app1Size, void* out, size_t maxOutSize,
+                         size_t& actualCodeSize, size_t stripCount) {
+    const int32_t mcuHeight = 2 * DCTSIZE;
+    const int32_t mcuRows = (inSz.height + mcuHeight - 1) / mcuHeight;
+    stripCount = std::min<size_t>(stripCount, mcuRows);
+    if (stripCount <= 1) {
+        return encodeJpegYU12Rows(inSz, inLayout, 0, inSz.height, jpegQuality, app1Buffer,
+                                  app1Size, /*restartRows*/ false, out, maxOutSize,
+                                  actualCodeSize);
+    }
+
+    /* Each strip is a whole number of MCU rows, ending with a restart
+     * marker but for the last one. With the same quality and the standard
+     * Huffman tables, the scans of all strips share their tables and can
+     * be chained into the scan of the first strip. The first strip carries
+     * the headers and APP1, and is encoded in place in 'out' */
+    struct Strip {
+        int32_t firstMcuRow;
+        int32_t mcuRowCount;
+        std::unique_ptr<uint8_t[]> code;
+        size_t maxCodeSize;
+        size_t codeSize = 0;
+        int ret = -1;
+    };
+    std::vector<Strip> strips(stripCount);
+    for (size_t i = 0; i < stripCount; i++) {
+        strips[i].firstMcuRow = mcuRows * i / stripCount;
+        strips[i].mcuRowCount = mcuRows * (i + 1) / stripCount - strips[i].firstMcuRow;
+        if (i > 0) {
+            /* The size limit of the whole image, split by rows, plus room
+             * for the headers */
+            strips[i].maxCodeSize = maxOutSize * strips[i].mcuRowCount / mcuRows + (64 << 10);
+            strips[i].code.reset(new uint8_t[strips[i].maxCodeSize]);
+        }
+    }
+    auto encodeStrip = [&](Strip& strip, bool first) {
+        const int32_t firstRow = strip.firstMcuRow * mcuHeight;
+        const int32_t rowCount =
+                std::min(strip.mcuRowCount * mcuHeight, inSz.height - firstRow);
+        strip.ret = encodeJpegYU12Rows(inSz, inLayout, firstRow, rowCount, jpegQuality,
+                                       first ? app1Buffer : nullptr, first ? app1Size : 0,
+                                       /*restartRows*/ true, first ? out : strip.code.get(),
+                                       first ? maxOutSize : strip.maxCodeSize, strip.codeSize);
+    };
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < stripCount; i++) {
+        workers.emplace_back(encodeStrip, std::ref(strips[i]), false);
+    }
+    encodeStrip(strips[0], true);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    /* Join: the first strip without its EOI, then for each next strip the
+     * restart marker ending the previous one and its scan data, with the
+     * restart markers renumbered from their position in the image */
+    auto fallback = [&](const char* reason) {
+        ALOGW("%s: %s, encoding in one strip", __FUNCTION__, reason);
+        return encodeJpegYU12Strips(inSz, inLayout, jpegQuality, app1Buffer, app1Size, out,
+                                    maxOutSize, actualCodeSize, 1);
+    };
+    for (const auto& strip : strips) {
+        if (strip.ret != 0 || strip.codeSize < 4) {
+            return fallback("strip encoding failed");
+        }
+    }
+    uint8_t* dst = static_cast<uint8_t*>(out);
+    size_t dstSize = strips[0].codeSize - 2;
+    const size_t sofPos = findJpegMarker(dst, dstSize, kJpegSof0);
+    if (sofPos == 0 || sofPos + 7 > dstSize) {
+        return fallback("no frame header");
+    }
+    dst[sofPos + 5] = static_cast<uint8_t>(inSz.height >> 8);
+    dst[sofPos + 6] = static_cast<uint8_t>(inSz.height & 0xFF);
+
+    for (size_t i = 1; i < stripCount; i++) {
+        const Strip& strip = strips[i];
+        const uint8_t* code = strip.code.get();
+        const uint8_t* end = code + strip.codeSize - 2;
+        const size_t begin = findJpegScanData(code, strip.codeSize);
+        if (begin == 0 || code + begin > end) {
+            return fallback("no scan data");
+        }
+        /* Renumbering keeps the size, plus the restart marker ahead */
+        if (dstSize + 2 + (end - code - begin) + 2 > maxOutSize) {
+            return fallback("output buffer too small");
+        }
+        int32_t mcuRow = strip.firstMcuRow - 1;
+        dst[dstSize++] = 0xFF;
+        dst[dstSize++] = JPEG_RST0 + mcuRow % 8;
+        const uint8_t* src = code + begin;
+        while (src < end) {
+            /* 0xFF in the entropy coded data is stuffed with 0x00, so 0xFF
+             * followed by RSTn can only be a marker */
+            const uint8_t* ff = static_cast<const uint8_t*>(memchr(src, 0xFF, end - src));
+            const uint8_t* chunkEnd = ff == nullptr ? end : std::min(ff + 2, end);
+            memcpy(dst + dstSize, src, chunkEnd - src);
+            dstSize += chunkEnd - src;
+            if (ff != nullptr && ff + 1 < end && ff[1] >= JPEG_RST0 && ff[1] <= JPEG_RST0 + 7) {
+                mcuRow++;
+                dst[dstSize - 1] = JPEG_RST0 + mcuRow % 8;
+            }
+            src = chunkEnd;
+        }
+    }
+    dst[dstSize++] = 0xFF;
+    dst[dstSize++] = JPEG_EOI;
+    actualCodeSize = dstSize;
+    return 0;
+}
+
+int getJpegScaleDenom(const Size& inSz, const Size& outSz) {
+    if (outSz.width <= 0 || outSz.height <= 0 || outSz.width % 2 != 0 || outSz.height % 2 != 0) {
+        return 0;
+    }
+    for (int denom : {1, 2, 4, 8}) {
+        if (outSz.width * denom == inSz.width && outSz.height * denom == inSz.height) {
+            return denom;
+        }
+    }
+    return 0;
+}
+
+int decodeJpegYCbCr(const uint8_t* inData, size_t inDataSize, const Size& inSz,
+                    const Size& outSz, const YCbCrLayout& out) {
+    const int scaleDenom = getJpegScaleDenom(inSz, outSz);
+    if (scaleDenom == 0 || (out.chromaStep != 1 && out.chromaStep != 2)) {
+        ALOGE("%s: cannot decode %dx%d to %dx%d with chroma step %d", __FUNCTION__, inSz.width,
+              inSz.height, outSz.width, outSz.height, out.chromaStep);
+        return -1;
+    }
+
+    /* libjpeg reports fatal errors through error_exit, which must not
+     * return: jump back here instead */
+    struct JpegErrorMgr {
+        struct jpeg_error_mgr mgr;
+        jmp_buf jmp;
+    } jerr;
+
+    jpeg_decompress_struct cinfo = {};
+    cinfo.err = jpeg_std_error(&jerr.mgr);
+    jerr.mgr.output_message = [](j_common_ptr cinfo) {
+        char buffer[JMSG_LENGTH_MAX];
+        (*cinfo->err->format_message)(cinfo, buffer);
+        ALOGE("libjpeg error: %s", buffer);
+    };
+    jerr.mgr.error_exit = [](j_common_ptr cinfo) {
+        (*cinfo->err->output_message)(cinfo);
+        longjmp(reinterpret_cast<JpegErrorMgr*>(cinfo->err)->jmp, 1);
+    };
+
+    /* Declared before setjmp so that nothing is skipped by longjmp */
+    std::vector<uint8_t> scratch;
+    std::vector<JSAMPROW> yRows, cbRows, crRows;
+
+    if (setjmp(jerr.jmp)) {
+        jpeg_destroy_decompress(&cinfo);
+        return -1;
+    }
+
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, inData, inDataSize);
+    jpeg_read_header(&cinfo, TRUE);
+
+    /* Raw data output hands out the subsampled planes as they are coded,
+     * so only YCbCr with 2x1 (422) or 2x2 (420) luma sampling can be
+     * turned into YUV420 */
+    const jpeg_component_info* comp = cinfo.comp_info;
+    if (cinfo.num_components != 3 || cinfo.jpeg_color_space != JCS_YCbCr ||
+        comp[0].h_samp_factor != 2 || comp[0].v_samp_factor < 1 || comp[0].v_samp_factor > 2 ||
+        comp[1].h_samp_factor != 1 || comp[1].v_samp_factor != 1 || comp[2].h_samp_factor != 1 ||
+        comp[2].v_samp_factor != 1 || cinfo.image_width != static_cast<JDIMENSION>(inSz.width) ||
+        cinfo.image_height != static_cast<JDIMENSION>(inSz.height)) {
+        ALOGV("%s: unsupported JPEG %ux%u, %d components, sampling %dx%d", __FUNCTION__,
+              cinfo.image_width, cinfo.image_height, cinfo.num_components, comp[0].h_samp_factor,
+              comp[0].v_samp_factor);
+        jpeg_destroy_decompress(&cinfo);
+        return -1;
+    }
+
+    cinfo.raw_data_out = TRUE;
+    cinfo.do_fancy_upsampling = FALSE;
+    cinfo.dct_method = JDCT_IFAST;
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = scaleDenom;
+    jpeg_start_decompress(&cinfo);
+
+    /* With DCT scaling, each 8x8 luma block decodes to a dctSize x dctSize
+     * one. libjpeg may scale chroma blocks less, to save upsampling, so the
+     * chroma planes are 1 or 2 times the YUV420 chroma size each way */
+    const size_t yRowCount = cinfo.max_v_samp_factor * cinfo.min_DCT_scaled_size;
+    const size_t yPaddedWidth = comp[0].width_in_blocks * comp[0].DCT_scaled_size;
+    const size_t cRowCount = comp[1].v_samp_factor * comp[1].DCT_scaled_size;
+    const size_t cPaddedWidth = comp[1].width_in_blocks * comp[1].DCT_scaled_size;
+    const size_t cWidth = outSz.width / 2;
+    const size_t cHeight = outSz.height / 2;
+    const size_t cHStep = comp[1].downsampled_width / cWidth;
+    const size_t cVStep = comp[1].downsampled_height / cHeight;
+    if ((cHStep != 1 && cHStep != 2) || (cVStep != 1 && cVStep != 2) ||
+        comp[1].downsampled_width != cWidth * cHStep ||
+        comp[1].downsampled_height != cHeight * cVStep) {
+        ALOGE("%s: unexpected chroma plane %ux%u for output %dx%d", __FUNCTION__,
+              comp[1].downsampled_width, comp[1].downsampled_height, outSz.width, outSz.height);
+        jpeg_destroy_decompress(&cinfo);
+        return -1;
+    }
+
+    /* Luma rows are decoded in place when the output stride leaves room
+     * for the block padding, chroma goes through scratch rows to be
+     * subsampled and, for semi-planar outputs, interleaved */
+    const bool lumaInPlace = out.yStride >= yPaddedWidth;
+    scratch.resize(yRowCount * yPaddedWidth + 2 * cRowCount * cPaddedWidth);
+    uint8_t* yScratch = scratch.data();
+    uint8_t* cbScratch = yScratch + yRowCount * yPaddedWidth;
+    uint8_t* crScratch = cbScratch + cRowCount * cPaddedWidth;
+    yRows.resize(yRowCount);
+    cbRows.resize(cRowCount);
+    crRows.resize(cRowCount);
+    for (size_t i = 0; i < cRowCount; i++) {
+        cbRows[i] = cbScratch + i * cPaddedWidth;
+        crRows[i] = crScratch + i * cPaddedWidth;
+    }
+
+    uint8_t* py = static_cast<uint8_t*>(out.y);
+    uint8_t* pcb = static_cast<uint8_t*>(out.cb);
+    uint8_t* pcr = static_cast<uint8_t*>(out.cr);
+    for (size_t pass = 0; cinfo.output_scanline < cinfo.output_height; pass++) {
+        const size_t y0 = cinfo.output_scanline;
+        for (size_t i = 0; i < yRowCount; i++) {
+            const size_t row = y0 + i;
+            yRows[i] = lumaInPlace && row < static_cast<size_t>(outSz.height)
+                               ? py + row * out.yStride
+                               : yScratch + i * yPaddedWidth;
+        }
+        JSAMPARRAY planes[3]{yRows.data(), cbRows.data(), crRows.data()};
+        if (jpeg_read_raw_data(&cinfo, planes, yRowCount) != yRowCount) {
+            ALOGE("%s: decoded fewer than %zu lines at %zu", __FUNCTION__, yRowCount, y0);
+            jpeg_destroy_decompress(&cinfo);
+            return -1;
+        }
+
+        if (!lumaInPlace) {
+            for (size_t i = 0; i < yRowCount && y0 + i < static_cast<size_t>(outSz.height); i++) {
+                memcpy(py + (y0 + i) * out.yStride, yRows[i], outSz.width);
+            }
+        }
+
+        for (size_t i = 0; i < cRowCount; i += cVStep) {
+            const size_t cRow = (pass * cRowCount + i) / cVStep;
+            if (cRow >= cHeight) {
+                break;
+            }
+            uint8_t* dstCb = pcb + cRow * out.cStride;
+            uint8_t* dstCr = pcr + cRow * out.cStride;
+            if (out.chromaStep == 1 && cHStep == 1) {
+                memcpy(dstCb, cbRows[i], cWidth);
+                memcpy(dstCr, crRows[i], cWidth);
+            } else {
+                for (size_t x = 0; x < cWidth; x++) {
+                    dstCb[x * out.chromaStep] = cbRows[i][x * cHStep];
+                    dstCr[x * out.chromaStep] = crRows[i][x * cHStep];
+                }
+            }
+        }
+    }
+
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return 0;
+}
+
+bool canDecodeToOutput(const std::vector<HalStreamBuffer>& buffers, const Size& v4lSize) {
+    if (buffers.size() != 1) {
+        return false;
+    }
+    const HalStreamBuffer& halBuf = buffers[0];
+    if (halBuf.format != PixelFormat::YCBCR_420_888 && halBuf.format != PixelFormat::YV12) {
+        return false;
+    }
+    return getJpegScaleDenom(v4lSize, Size{halBuf.width, halBuf.height}) != 0;
+}
+
 Size getMaxThumbnailResolution(const common::V1_0::helper::CameraMetadata& chars) {
     Size thumbSize{0, 0};
     camera_metadata_ro_entry entry = chars.find(ANDROID_JPEG_AVAILABLE_THUMBNAIL_SIZES);
@@ -29,7 +29,10 @@
 #include <android/hardware/graphics/mapper/3.0/IMapper.h>
 #include <android/hardware/graphics/mapper/4.0/IMapper.h>
 #include <tinyxml2.h>
+#include <condition_variable>
+#include <deque>
 #include <map>
+#include <mutex>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -247,10 +250,36 @@ int getCropRect(CroppingType ct, const Size& inSize, const Size& outSize, IMappe
 
 int formatConvert(const YCbCrLayout& in, const YCbCrLayout& out, Size sz, uint32_t format);
 
+// Encodes with getJpegStripCount(inSz) strips.
 int encodeJpegYU12(const Size& inSz, const YCbCrLayout& inLayout, int jpegQuality,
                    const void* app1Buffer, size_t app1Size, void* out, size_t maxOutSize,
                    size_t& actualCodeSize);
 
+// Encodes horizontal strips of whole MCU rows concurrently, one per thread, and joins them into
+// one baseline JPEG whose scan has a restart marker after each MCU row. A 'stripCount' of 1
+// encodes serially without restart markers.
+int encodeJpegYU12Strips(const Size& inSz, const YCbCrLayout& inLayout, int jpegQuality,
+                         const void* app1Buffer, size_t app1Size, void* out, size_t maxOutSize,
+                         size_t& actualCodeSize, size_t stripCount);
+
+// Strip count for encodeJpegYU12: up to one per core, at most 4, with strips of 256 rows or more.
+size_t getJpegStripCount(const Size& inSz);
+
+// Returns the libjpeg DCT scaling denominator (1, 2, 4 or 8) that decodes a frame of 'inSz' to
+// exactly 'outSz', or 0 if there is none.
+int getJpegScaleDenom(const Size& inSz, const Size& outSz);
+
+// Decodes the MJPEG frame 'inData' of 'inSz' straight to the YUV420 'out' of 'outSz', planar or
+// semi-planar, scaling down during the decode when getJpegScaleDenom() allows it. Only 422 and 420
+// coded frames are supported. Returns 0 on success, -1 otherwise.
+int decodeJpegYCbCr(const uint8_t* inData, size_t inDataSize, const Size& inSz,
+                    const Size& outSz, const YCbCrLayout& out);
+
+// Returns true if the MJPEG frame of 'v4lSize' can be decoded by decodeJpegYCbCr() straight to
+// the output of a request: a single YCBCR_420_888 or YV12 buffer of the V4L2 frame size, or that
+// size divided by 2, 4 or 8.
+bool canDecodeToOutput(const std::vector<HalStreamBuffer>& buffers, const Size& v4lSize);
+
 Size getMaxThumbnailResolution(const common::V1_0::helper::CameraMetadata&);
 
 void freeReleaseFences(std::vector<CaptureResult>&);
@@ -286,6 +315,63 @@ struct OutputThreadInterface {
     virtual ssize_t getJpegBufferSize(int32_t width, int32_t height) const = 0;
 };
 
+// FIFO of at most 'capacity' items between two pipeline stages. push() blocks while the queue is
+// full and pop() while it is empty. Both return false once close() is called, items still queued
+// then are dropped.
+template <typename T>
+class BoundedQueue {
+  public:
+    explicit BoundedQueue(size_t capacity) : mCapacity(capacity) {}
+
+    bool push(T item) {
+        std::unique_lock<std::mutex> lk(mLock);
+        mNotFullCond.wait(lk, [this] { return mClosed || mItems.size() < mCapacity; });
+        if (mClosed) {
+            return false;
+        }
+        mItems.push_back(std::move(item));
+        lk.unlock();
+        mNotEmptyCond.notify_one();
+        return true;
+    }
+
+    bool pop(T* item) {
+        std::unique_lock<std::mutex> lk(mLock);
+        mNotEmptyCond.wait(lk, [this] { return mClosed || !mItems.empty(); });
+        if (mClosed) {
+            return false;
+        }
+        *item = std::move(mItems.front());
+        mItems.pop_front();
+        lk.unlock();
+        mNotFullCond.notify_one();
+        return true;
+    }
+
+    void clear() {
+        std::unique_lock<std::mutex> lk(mLock);
+        mItems.clear();
+        lk.unlock();
+        mNotFullCond.notify_all();
+    }
+
+    void close() {
+        std::unique_lock<std::mutex> lk(mLock);
+        mClosed = true;
+        lk.unlock();
+        mNotFullCond.notify_all();
+        mNotEmptyCond.notify_all();
+    }
+
+  private:
+    const size_t mCapacity;
+    std::mutex mLock;
+    std::condition_variable mNotFullCond;
+    std::condition_variable mNotEmptyCond;
+    std::deque<T> mItems;
+    bool mClosed = false;
+};
+
 // A CPU copy of a mapped V4L2Frame. Will map the input V4L2 frame.
 class AllocatedV4L2Frame : public Frame {
   public:
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "ExternalCameraUtils.h"
+
+using android::hardware::camera::device::implementation::AllocatedFrame;
+using android::hardware::camera::device::implementation::encodeJpegYU12Strips;
+using android::hardware::camera::device::implementation::getJpegStripCount;
+using android::hardware::camera::external::common::Size;
+
+namespace {
+
+constexpr int kJpegQuality = 95;
+
+// Smooth gradients with some noise, closer to the entropy of a camera frame than a flat or a
+// random image.
+void fillPlane(uint8_t* plane, uint32_t width, uint32_t height, uint32_t stride, uint32_t step,
+               std::minstd_rand* random) {
+    for (uint32_t y = 0; y < height; y++) {
+        uint8_t* row = plane + y * stride;
+        for (uint32_t x = 0; x < width; x++) {
+            row[x * step] = static_cast<uint8_t>((x * 255 / width + y * 255 / height) / 2 +
+                                                 (*random)() % 16);
+        }
+    }
+}
+
+}  // namespace
+
+// Encodes a 'range(0)' x 'range(1)' YU12 frame in 'range(2)' strips, 0 for getJpegStripCount().
+// The real time is the latency of one capture, the CPU time that of the whole process.
+static void BM_EncodeJpegYU12(benchmark::State& state) {
+    const Size size{static_cast<int32_t>(state.range(0)), static_cast<int32_t>(state.range(1))};
+    const size_t stripCount =
+            state.range(2) == 0 ? getJpegStripCount(size) : static_cast<size_t>(state.range(2));
+    AllocatedFrame frame(size.width, size.height);
+    YCbCrLayout layout;
+    if (frame.allocate(&layout) != 0) {
+        state.SkipWithError("allocate failed");
+        return;
+    }
+    std::minstd_rand random;
+    fillPlane(static_cast<uint8_t*>(layout.y), size.width, size.height, layout.yStride, 1,
+              &random);
+    fillPlane(static_cast<uint8_t*>(layout.cb), size.width / 2, size.height / 2, layout.cStride,
+              layout.chromaStep, &random);
+    fillPlane(static_cast<uint8_t*>(layout.cr), size.width / 2, size.height / 2, layout.cStride,
+              layout.chromaStep, &random);
+    // A typical EXIF block, with a thumbnail.
+    const std::vector<uint8_t> app1(32 << 10, 0);
+    std::vector<uint8_t> out(size.width * size.height * 3 / 2 + app1.size());
+
+    size_t codeSize = 0;
+    for (auto _ : state) {
+        if (encodeJpegYU12Strips(size, layout, kJpegQuality, app1.data(), app1.size(), out.data(),
+                                 out.size(), codeSize, stripCount) != 0) {
+            state.SkipWithError("encodeJpegYU12Strips failed");
+            break;
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.counters["strips"] = stripCount;
+    state.counters["code_bytes"] = codeSize;
+    state.SetItemsProcessed(state.iterations() * size.width * size.height);
+}
+// 5 and 12 megapixels, serial, in 2 and 4 strips, and with the default strip count.
+BENCHMARK(BM_EncodeJpegYU12)
+        ->ArgsProduct({{2592}, {1944}, {1, 2, 4, 0}})
+        ->ArgsProduct({{4000}, {3000}, {1, 2, 4, 0}})
+        ->MeasureProcessCPUTime()
+        ->UseRealTime()
+        ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ExternalCameraUtils.h"
+
+using android::hardware::camera::device::implementation::BoundedQueue;
+
+namespace {
+
+// Only bounds waits for something that should happen.
+constexpr std::chrono::seconds kTimeout{5};
+// How long to watch for something that should not happen.
+constexpr std::chrono::milliseconds kQuietTime{50};
+
+}  // namespace
+
+TEST(BoundedQueueTest, FirstInFirstOut) {
+    BoundedQueue<int> queue(3);
+    for (int i = 0; i < 3; i++) {
+        ASSERT_TRUE(queue.push(i));
+    }
+    for (int i = 0; i < 3; i++) {
+        int item = -1;
+        ASSERT_TRUE(queue.pop(&item));
+        EXPECT_EQ(i, item);
+    }
+}
+
+TEST(BoundedQueueTest, PushBlocksWhileFull) {
+    BoundedQueue<int> queue(1);
+    ASSERT_TRUE(queue.push(1));
+    auto pushed = std::async(std::launch::async, [&] { return queue.push(2); });
+    EXPECT_EQ(std::future_status::timeout, pushed.wait_for(kQuietTime));
+
+    int item = 0;
+    ASSERT_TRUE(queue.pop(&item));
+    EXPECT_EQ(1, item);
+    ASSERT_EQ(std::future_status::ready, pushed.wait_for(kTimeout));
+    EXPECT_TRUE(pushed.get());
+    ASSERT_TRUE(queue.pop(&item));
+    EXPECT_EQ(2, item);
+}
+
+TEST(BoundedQueueTest, ClearUnblocksPush) {
+    BoundedQueue<int> queue(1);
+    ASSERT_TRUE(queue.push(1));
+    auto pushed = std::async(std::launch::async, [&] { return queue.push(2); });
+    EXPECT_EQ(std::future_status::timeout, pushed.wait_for(kQuietTime));
+
+    queue.clear();
+    ASSERT_EQ(std::future_status::ready, pushed.wait_for(kTimeout));
+    EXPECT_TRUE(pushed.get());
+    int item = 0;
+    ASSERT_TRUE(queue.pop(&item));
+    EXPECT_EQ(2, item);
+}
+
+TEST(BoundedQueueTest, CloseUnblocksPop) {
+    BoundedQueue<int> queue(1);
+    auto popped = std::async(std::launch::async, [&] {
+        int item = 0;
+        return queue.pop(&item);
+    });
+    EXPECT_EQ(std::future_status::timeout, popped.wait_for(kQuietTime));
+
+    queue.close();
+    ASSERT_EQ(std::future_status::ready, popped.wait_for(kTimeout));
+    EXPECT_FALSE(popped.get());
+}
+
+TEST(BoundedQueueTest, CloseUnblocksPush) {
+    BoundedQueue<int> queue(1);
+    ASSERT_TRUE(queue.push(1));
+    auto pushed = std::async(std::launch::async, [&] { return queue.push(2); });
+    EXPECT_EQ(std::future_status::timeout, pushed.wait_for(kQuietTime));
+
+    queue.close();
+    ASSERT_EQ(std::future_status::ready, pushed.wait_for(kTimeout));
+    EXPECT_FALSE(pushed.get());
+}
+
+TEST(BoundedQueueTest, CloseDropsQueuedItems) {
+    BoundedQueue<std::shared_ptr<int>> queue(2);
+    auto item = std::make_shared<int>(1);
+    ASSERT_TRUE(queue.push(item));
+    queue.close();
+
+    std::shared_ptr<int> popped;
+    EXPECT_FALSE(queue.pop(&popped));
+    EXPECT_EQ(nullptr, popped);
+    EXPECT_FALSE(queue.push(item));
+}
+
+// Chains three stages the way the session output thread does: a decode stage taking frames from
+// a pool, a convert and a JPEG stage, with a queue of one between each, each stage taking a random
+// time. Requests must come out of the last stage in the order they went in.
+TEST(BoundedQueueTest, PipelineReturnsInOrder) {
+    constexpr int kRequestCount = 200;
+    constexpr size_t kPipelineDepth = 3;
+    BoundedQueue<int> freeFrames(kPipelineDepth);
+    BoundedQueue<std::pair<int, int>> convertQueue(1);
+    BoundedQueue<std::pair<int, int>> jpegQueue(1);
+    for (size_t i = 0; i < kPipelineDepth; i++) {
+        ASSERT_TRUE(freeFrames.push(i));
+    }
+    const auto work = [](std::minstd_rand& random) {
+        std::this_thread::sleep_for(std::chrono::microseconds(random() % 200));
+    };
+
+    std::thread decode([&] {
+        std::minstd_rand random(1);
+        for (int request = 0; request < kRequestCount; request++) {
+            int frame = 0;
+            if (!freeFrames.pop(&frame)) return;
+            work(random);
+            if (!convertQueue.push({request, frame})) return;
+        }
+    });
+    std::thread convert([&] {
+        std::minstd_rand random(2);
+        std::pair<int, int> item;
+        while (convertQueue.pop(&item)) {
+            work(random);
+            if (!jpegQueue.push(item)) return;
+        }
+    });
+    std::vector<int> returned;
+    std::pair<int, int> item;
+    std::minstd_rand random(3);
+    while (returned.size() < kRequestCount && jpegQueue.pop(&item)) {
+        work(random);
+        returned.push_back(item.first);
+        // Not ASSERT, returning with the stage threads still joinable would terminate.
+        EXPECT_TRUE(freeFrames.push(item.second));
+    }
+    decode.join();
+    convertQueue.close();
+    convert.join();
+
+    ASSERT_EQ(static_cast<size_t>(kRequestCount), returned.size());
+    for (int i = 0; i < kRequestCount; i++) {
+        EXPECT_EQ(i, returned[i]);
+    }
+}
+
+// Stopping the pipeline closes every queue, the stages blocked on any of them exit.
+TEST(BoundedQueueTest, CloseStopsPipeline) {
+    BoundedQueue<int> freeFrames(2);
+    BoundedQueue<int> convertQueue(1);
+    BoundedQueue<int> jpegQueue(1);
+    std::atomic<int> exited = 0;
+    ASSERT_TRUE(freeFrames.push(0));
+    ASSERT_TRUE(freeFrames.push(1));
+
+    // Nothing takes from the JPEG queue: convert blocks pushing the second frame to it, decode
+    // on the empty pool.
+    std::thread decode([&] {
+        int frame = 0;
+        while (freeFrames.pop(&frame) && convertQueue.push(frame)) {
+        }
+        exited++;
+    });
+    std::thread convert([&] {
+        int frame = 0;
+        while (convertQueue.pop(&frame) && jpegQueue.push(frame)) {
+        }
+        exited++;
+    });
+    std::this_thread::sleep_for(kQuietTime);
+    EXPECT_EQ(0, exited);
+
+    freeFrames.close();
+    convertQueue.close();
+    jpegQueue.close();
+    decode.join();
+    convert.join();
+    EXPECT_EQ(2, exited);
+}
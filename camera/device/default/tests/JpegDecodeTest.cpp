@@ -0,0 +1,293 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <jpeglib.h>
+
+#include "ExternalCameraUtils.h"
+
+using android::hardware::camera::device::implementation::canDecodeToOutput;
+using android::hardware::camera::device::implementation::decodeJpegYCbCr;
+using android::hardware::camera::device::implementation::HalStreamBuffer;
+using android::hardware::camera::external::common::Size;
+
+namespace {
+
+// Chroma subsampling of the encoded frame, as luma sampling factors
+enum class Sampling { k420, k422, k444 };
+
+// Quantization and the fast IDCT lose a few levels on the smooth test pattern
+constexpr int kMaxError = 6;
+
+// A linear pattern, so that the average of any block of pixels is the value at its center
+double patternY(double x, double y, const Size& sz) {
+    return 30 + 150 * x / sz.width + 50 * y / sz.height;
+}
+double patternCb(double x, double /* y */, const Size& sz) {
+    return 60 + 120 * x / sz.width;
+}
+double patternCr(double /* x */, double y, const Size& sz) {
+    return 60 + 120 * y / sz.height;
+}
+
+std::vector<uint8_t> encodeJpeg(const Size& sz, Sampling sampling) {
+    jpeg_compress_struct cinfo = {};
+    jpeg_error_mgr jerr;
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_compress(&cinfo);
+    unsigned char* outBuffer = nullptr;
+    unsigned long outSize = 0;
+    jpeg_mem_dest(&cinfo, &outBuffer, &outSize);
+
+    cinfo.image_width = sz.width;
+    cinfo.image_height = sz.height;
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_YCbCr;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, 95, TRUE);
+    cinfo.comp_info[0].h_samp_factor = sampling == Sampling::k444 ? 1 : 2;
+    cinfo.comp_info[0].v_samp_factor = sampling == Sampling::k420 ? 2 : 1;
+    jpeg_start_compress(&cinfo, TRUE);
+
+    std::vector<uint8_t> row(sz.width * 3);
+    while (cinfo.next_scanline < cinfo.image_height) {
+        const double y = cinfo.next_scanline + 0.5;
+        for (int x = 0; x < sz.width; x++) {
+            row[x * 3] = patternY(x + 0.5, y, sz);
+            row[x * 3 + 1] = patternCb(x + 0.5, y, sz);
+            row[x * 3 + 2] = patternCr(x + 0.5, y, sz);
+        }
+        JSAMPROW rowPtr = row.data();
+        jpeg_write_scanlines(&cinfo, &rowPtr, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+
+    std::vector<uint8_t> jpeg(outBuffer, outBuffer + outSize);
+    free(outBuffer);
+    return jpeg;
+}
+
+// An output buffer laid out like a locked gralloc YUV buffer, either planar (YV12, I420) or
+// semi-planar (NV21). The planes are exactly as large as the layout needs, so that ASan catches
+// writes past them.
+class OutputBuffer {
+  public:
+    OutputBuffer(const Size& sz, bool semiPlanar, uint32_t strideAlign) {
+        const uint32_t yStride = align(sz.width, strideAlign);
+        const uint32_t cWidth = sz.width / 2;
+        const uint32_t cHeight = sz.height / 2;
+        mY.assign(yStride * sz.height, 0);
+        if (semiPlanar) {
+            mCbCr.assign(yStride * (cHeight - 1) + cWidth * 2, 0);
+            mLayout = {.y = mY.data(),
+                       .cb = mCbCr.data() + 1,
+                       .cr = mCbCr.data(),
+                       .yStride = yStride,
+                       .cStride = yStride,
+                       .chromaStep = 2};
+        } else {
+            const uint32_t cStride = align(cWidth, strideAlign);
+            mCb.assign(cStride * (cHeight - 1) + cWidth, 0);
+            mCr.assign(cStride * (cHeight - 1) + cWidth, 0);
+            mLayout = {.y = mY.data(),
+                       .cb = mCb.data(),
+                       .cr = mCr.data(),
+                       .yStride = yStride,
+                       .cStride = cStride,
+                       .chromaStep = 1};
+        }
+    }
+
+    const YCbCrLayout& layout() const { return mLayout; }
+
+    int y(int x, int row) const { return mY[row * mLayout.yStride + x]; }
+    int cb(int x, int row) const { return chroma(mLayout.cb, x, row); }
+    int cr(int x, int row) const { return chroma(mLayout.cr, x, row); }
+
+  private:
+    static uint32_t align(uint32_t value, uint32_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    int chroma(const void* plane, int x, int row) const {
+        return static_cast<const uint8_t*>(plane)[row * mLayout.cStride + x * mLayout.chromaStep];
+    }
+
+    std::vector<uint8_t> mY, mCb, mCr, mCbCr;
+    YCbCrLayout mLayout;
+};
+
+// Checks that every output pixel matches the pattern averaged over the input pixels it covers
+void expectPattern(const OutputBuffer& out, const Size& inSz, const Size& outSz) {
+    const double scale = static_cast<double>(inSz.width) / outSz.width;
+    int yErrors = 0, cErrors = 0;
+    for (int row = 0; row < outSz.height; row++) {
+        for (int x = 0; x < outSz.width; x++) {
+            const double expected = patternY((x + 0.5) * scale, (row + 0.5) * scale, inSz);
+            if (std::abs(out.y(x, row) - expected) > kMaxError && yErrors++ < 10) {
+                ADD_FAILURE() << "Y at " << x << "," << row << ": " << out.y(x, row)
+                              << ", expected " << expected;
+            }
+        }
+    }
+    for (int row = 0; row < outSz.height / 2; row++) {
+        for (int x = 0; x < outSz.width / 2; x++) {
+            const double inX = (x + 0.5) * 2 * scale;
+            const double inY = (row + 0.5) * 2 * scale;
+            const double expectedCb = patternCb(inX, inY, inSz);
+            const double expectedCr = patternCr(inX, inY, inSz);
+            if ((std::abs(out.cb(x, row) - expectedCb) > kMaxError ||
+                 std::abs(out.cr(x, row) - expectedCr) > kMaxError) &&
+                cErrors++ < 10) {
+                ADD_FAILURE() << "CbCr at " << x << "," << row << ": " << out.cb(x, row) << ","
+                              << out.cr(x, row) << ", expected " << expectedCb << ","
+                              << expectedCr;
+            }
+        }
+    }
+}
+
+HalStreamBuffer makeBuffer(int32_t width, int32_t height, PixelFormat format) {
+    return HalStreamBuffer{.streamId = 0,
+                           .bufferId = 1,
+                           .width = width,
+                           .height = height,
+                           .format = format,
+                           .usage = BufferUsage::CPU_WRITE_OFTEN,
+                           .bufPtr = nullptr,
+                           .acquireFence = -1,
+                           .fenceTimeout = false};
+}
+
+}  // namespace
+
+// Sampling of the input, scale denominator, semi-planar output, stride alignment
+class JpegDecodeTest
+    : public testing::TestWithParam<std::tuple<Sampling, int, bool, uint32_t>> {};
+
+TEST_P(JpegDecodeTest, DecodesPattern) {
+    const auto [sampling, scaleDenom, semiPlanar, strideAlign] = GetParam();
+    const Size inSz{640, 480};
+    const Size outSz{inSz.width / scaleDenom, inSz.height / scaleDenom};
+    const std::vector<uint8_t> jpeg = encodeJpeg(inSz, sampling);
+    OutputBuffer out(outSz, semiPlanar, strideAlign);
+
+    ASSERT_EQ(0, decodeJpegYCbCr(jpeg.data(), jpeg.size(), inSz, outSz, out.layout()));
+    expectPattern(out, inSz, outSz);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+        Layouts, JpegDecodeTest,
+        testing::Combine(testing::Values(Sampling::k420, Sampling::k422),
+                         testing::Values(1, 2, 4, 8), testing::Bool(), testing::Values(1u, 64u)),
+        [](const testing::TestParamInfo<JpegDecodeTest::ParamType>& info) {
+            return std::string(std::get<0>(info.param) == Sampling::k420 ? "Yuv420" : "Yuv422") +
+                   "_Scale1_" + std::to_string(std::get<1>(info.param)) +
+                   (std::get<2>(info.param) ? "_SemiPlanar" : "_Planar") + "_Align" +
+                   std::to_string(std::get<3>(info.param));
+        });
+
+// Sizes that are not a whole number of MCUs leave the last blocks partly outside the output.
+TEST(JpegDecodeEdgeTest, UnalignedSize) {
+    const Size inSz{648, 488};
+    const std::vector<uint8_t> jpeg = encodeJpeg(inSz, Sampling::k420);
+    for (int scaleDenom : {1, 2, 4}) {
+        for (bool semiPlanar : {false, true}) {
+            SCOPED_TRACE(testing::Message() << "1/" << scaleDenom << " semi-planar " << semiPlanar);
+            const Size outSz{inSz.width / scaleDenom, inSz.height / scaleDenom};
+            OutputBuffer out(outSz, semiPlanar, 1);
+            ASSERT_EQ(0, decodeJpegYCbCr(jpeg.data(), jpeg.size(), inSz, outSz, out.layout()));
+            expectPattern(out, inSz, outSz);
+        }
+    }
+}
+
+TEST(JpegDecodeEdgeTest, RejectsUnsupportedInput) {
+    const Size inSz{640, 480};
+    const Size outSz{320, 240};
+    OutputBuffer out(outSz, false, 1);
+
+    // No 420 layout can be made of the raw planes of a 444 frame
+    const std::vector<uint8_t> yuv444 = encodeJpeg(inSz, Sampling::k444);
+    EXPECT_EQ(-1, decodeJpegYCbCr(yuv444.data(), yuv444.size(), inSz, outSz, out.layout()));
+
+    // Size not matching the frame header
+    const std::vector<uint8_t> jpeg = encodeJpeg(inSz, Sampling::k420);
+    EXPECT_EQ(-1, decodeJpegYCbCr(jpeg.data(), jpeg.size(), Size{1280, 960}, Size{640, 480},
+                                  out.layout()));
+
+    // Not a supported scale, or odd sizes
+    EXPECT_EQ(-1, decodeJpegYCbCr(jpeg.data(), jpeg.size(), inSz, Size{480, 360}, out.layout()));
+    EXPECT_EQ(-1, decodeJpegYCbCr(jpeg.data(), jpeg.size(), Size{648, 488}, Size{81, 61},
+                                  out.layout()));
+
+    // Neither planar nor semi-planar
+    YCbCrLayout layout = out.layout();
+    layout.chromaStep = 3;
+    EXPECT_EQ(-1, decodeJpegYCbCr(jpeg.data(), jpeg.size(), inSz, outSz, layout));
+}
+
+TEST(JpegDecodeEdgeTest, RejectsCorruptInput) {
+    const Size inSz{640, 480};
+    const Size outSz{640, 480};
+    OutputBuffer out(outSz, true, 1);
+    const std::vector<uint8_t> jpeg = encodeJpeg(inSz, Sampling::k422);
+
+    // Truncated in the header. libjpeg pads a scan truncated further on, so that only needs not
+    // to read or write out of bounds.
+    EXPECT_EQ(-1, decodeJpegYCbCr(jpeg.data(), 100, inSz, outSz, out.layout()));
+    decodeJpegYCbCr(jpeg.data(), jpeg.size() / 2, inSz, outSz, out.layout());
+
+    std::vector<uint8_t> garbage(4096);
+    for (size_t i = 0; i < garbage.size(); i++) {
+        garbage[i] = i * 7919 % 251;
+    }
+    EXPECT_EQ(-1, decodeJpegYCbCr(garbage.data(), garbage.size(), inSz, outSz, out.layout()));
+}
+
+TEST(JpegDecodeEdgeTest, CanDecodeToOutput) {
+    const Size v4lSize{1280, 720};
+    for (PixelFormat format : {PixelFormat::YCBCR_420_888, PixelFormat::YV12}) {
+        SCOPED_TRACE(toString(format));
+        for (int scaleDenom : {1, 2, 4, 8}) {
+            EXPECT_TRUE(canDecodeToOutput(
+                    {makeBuffer(v4lSize.width / scaleDenom, v4lSize.height / scaleDenom, format)},
+                    v4lSize))
+                    << "1/" << scaleDenom;
+        }
+        // Needs a scale the IDCT cannot do, or a crop
+        EXPECT_FALSE(canDecodeToOutput({makeBuffer(960, 540, format)}, v4lSize));
+        EXPECT_FALSE(canDecodeToOutput({makeBuffer(1280, 960, format)}, v4lSize));
+        // Odd chroma plane size
+        EXPECT_FALSE(canDecodeToOutput({makeBuffer(1281, 721, format)}, Size{1281, 721}));
+    }
+    EXPECT_FALSE(canDecodeToOutput({makeBuffer(1280, 720, PixelFormat::BLOB)}, v4lSize));
+    EXPECT_FALSE(canDecodeToOutput({makeBuffer(1280, 720, PixelFormat::IMPLEMENTATION_DEFINED)},
+                                   v4lSize));
+    // Only a single output is decoded to
+    EXPECT_FALSE(canDecodeToOutput({makeBuffer(1280, 720, PixelFormat::YCBCR_420_888),
+                                    makeBuffer(640, 360, PixelFormat::YCBCR_420_888)},
+                                   v4lSize));
+    EXPECT_FALSE(canDecodeToOutput({}, v4lSize));
+}
@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <jpeglib.h>
+
+#include "ExternalCameraUtils.h"
+
+using android::hardware::camera::device::implementation::encodeJpegYU12Strips;
+using android::hardware::camera::external::common::Size;
+
+namespace {
+
+constexpr int kJpegQuality = 90;
+
+// A YU12 frame padded as AllocatedFrame pads it: the encoder reads whole 16x16 MCUs across.
+class Yu12Frame {
+  public:
+    explicit Yu12Frame(const Size& sz) {
+        const uint32_t yStride = (sz.width + 15) / 16 * 16;
+        const uint32_t cStride = yStride / 2;
+        const int32_t cHeight = (sz.height + 1) / 2;
+        mY.resize(yStride * sz.height);
+        mCb.resize(cStride * cHeight);
+        mCr.resize(cStride * cHeight);
+        // Detailed enough for the entropy coded data to hold stuffed 0xFF bytes
+        for (int32_t row = 0; row < sz.height; row++) {
+            for (uint32_t x = 0; x < yStride; x++) {
+                mY[row * yStride + x] = (x * 7 + row * 13 + (x * row) % 61) & 0xFF;
+            }
+        }
+        for (int32_t row = 0; row < cHeight; row++) {
+            for (uint32_t x = 0; x < cStride; x++) {
+                mCb[row * cStride + x] = 64 + (x * 3 + row) % 128;
+                mCr[row * cStride + x] = 64 + (x + row * 5) % 128;
+            }
+        }
+        mLayout = {.y = mY.data(),
+                   .cb = mCb.data(),
+                   .cr = mCr.data(),
+                   .yStride = yStride,
+                   .cStride = cStride,
+                   .chromaStep = 1};
+    }
+
+    const YCbCrLayout& layout() const { return mLayout; }
+
+  private:
+    std::vector<uint8_t> mY, mCb, mCr;
+    YCbCrLayout mLayout;
+};
+
+std::vector<uint8_t> encode(const Size& sz, const Yu12Frame& frame, size_t stripCount) {
+    std::vector<uint8_t> jpeg(sz.width * sz.height * 3);
+    size_t jpegSize = 0;
+    EXPECT_EQ(0, encodeJpegYU12Strips(sz, frame.layout(), kJpegQuality, nullptr, 0, jpeg.data(),
+                                      jpeg.size(), jpegSize, stripCount));
+    jpeg.resize(jpegSize);
+    return jpeg;
+}
+
+// Whether the headers set a restart interval, which only the strip encoder does
+bool hasRestartInterval(const std::vector<uint8_t>& jpeg) {
+    size_t pos = 2;
+    while (pos + 4 <= jpeg.size() && jpeg[pos] == 0xFF && jpeg[pos + 1] != 0xDA) {
+        if (jpeg[pos + 1] == 0xDD) {
+            return true;
+        }
+        pos += 2 + ((jpeg[pos + 2] << 8) | jpeg[pos + 3]);
+    }
+    return false;
+}
+
+// Decodes to interleaved YCbCr, or returns an empty vector if libjpeg fails
+std::vector<uint8_t> decode(const std::vector<uint8_t>& jpeg, const Size& sz) {
+    struct ErrorManager {
+        jpeg_error_mgr mgr;
+        bool failed = false;
+    } jerr;
+    jpeg_decompress_struct cinfo = {};
+    cinfo.err = jpeg_std_error(&jerr.mgr);
+    // Corrupt data warnings would otherwise only be printed
+    jerr.mgr.emit_message = [](j_common_ptr cinfo, int level) {
+        if (level < 0) {
+            reinterpret_cast<ErrorManager*>(cinfo->err)->failed = true;
+        }
+    };
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, jpeg.data(), jpeg.size());
+    std::vector<uint8_t> pixels;
+    if (jpeg_read_header(&cinfo, TRUE) == JPEG_HEADER_OK &&
+        static_cast<int32_t>(cinfo.image_width) == sz.width &&
+        static_cast<int32_t>(cinfo.image_height) == sz.height) {
+        cinfo.out_color_space = JCS_YCbCr;
+        jpeg_start_decompress(&cinfo);
+        pixels.resize(sz.width * sz.height * 3);
+        while (cinfo.output_scanline < cinfo.output_height) {
+            JSAMPROW row = pixels.data() + cinfo.output_scanline * sz.width * 3;
+            jpeg_read_scanlines(&cinfo, &row, 1);
+        }
+        jpeg_finish_decompress(&cinfo);
+    }
+    jpeg_destroy_decompress(&cinfo);
+    if (jerr.failed) {
+        pixels.clear();
+    }
+    return pixels;
+}
+
+}  // namespace
+
+class JpegEncodeTest : public testing::TestWithParam<Size> {};
+
+// The strips are coded block for block as the serial encoder codes them, so any decoder must
+// output the same pixels.
+TEST_P(JpegEncodeTest, StripsDecodeLikeSerial) {
+    const Size sz = GetParam();
+    const Yu12Frame frame(sz);
+    const std::vector<uint8_t> serialJpeg = encode(sz, frame, 1);
+    EXPECT_FALSE(hasRestartInterval(serialJpeg));
+    const std::vector<uint8_t> serial = decode(serialJpeg, sz);
+    ASSERT_FALSE(serial.empty());
+
+    for (size_t stripCount : {2, 3, 4}) {
+        SCOPED_TRACE(testing::Message() << stripCount << " strips");
+        const std::vector<uint8_t> jpeg = encode(sz, frame, stripCount);
+        // Not silently encoded serially
+        EXPECT_TRUE(hasRestartInterval(jpeg));
+        const std::vector<uint8_t> pixels = decode(jpeg, sz);
+        ASSERT_FALSE(pixels.empty());
+        EXPECT_TRUE(pixels == serial);
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(Sizes, JpegEncodeTest,
+                         testing::Values(Size{640, 520}, Size{1000, 1001}, Size{1920, 1080},
+                                         Size{2592, 1944}, Size{4000, 3000}),
+                         [](const testing::TestParamInfo<Size>& info) {
+                             return std::to_string(info.param.width) + "x" +
+                                    std::to_string(info.param.height);
+                         });
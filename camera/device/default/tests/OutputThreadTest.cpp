@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ExternalCameraDeviceSession.h"
+
+using android::hardware::camera::device::implementation::CroppingType;
+using android::hardware::camera::device::implementation::ExternalCameraDeviceSession;
+using android::hardware::camera::device::implementation::HalRequest;
+using android::hardware::camera::device::implementation::OutputThreadInterface;
+
+namespace {
+
+// Records how each request comes back.
+class FakeParent : public OutputThreadInterface {
+  public:
+    Status importBuffer(int32_t, uint64_t, buffer_handle_t, buffer_handle_t**) override {
+        return Status::OK;
+    }
+
+    void notifyError(int32_t frameNumber, int32_t, ErrorCode ec) override {
+        if (ec == ErrorCode::ERROR_DEVICE) {
+            deviceErrors.push_back(frameNumber);
+        }
+    }
+
+    Status processCaptureRequestError(const std::shared_ptr<HalRequest>& req,
+                                      std::vector<NotifyMsg>*,
+                                      std::vector<CaptureResult>*) override {
+        requestErrors.push_back(req->frameNumber);
+        return Status::OK;
+    }
+
+    Status processCaptureResult(std::shared_ptr<HalRequest>& req) override {
+        results.push_back(req->frameNumber);
+        return Status::OK;
+    }
+
+    ssize_t getJpegBufferSize(int32_t, int32_t) const override { return 0; }
+
+    std::vector<int32_t> deviceErrors;
+    std::vector<int32_t> requestErrors;
+    std::vector<int32_t> results;
+};
+
+// Exposes the last pipeline stage, which returns the frames in order.
+class TestOutputThread : public ExternalCameraDeviceSession::OutputThread {
+  public:
+    explicit TestOutputThread(std::weak_ptr<OutputThreadInterface> parent)
+        : OutputThread(parent, CroppingType::VERTICAL,
+                       android::hardware::camera::common::V1_0::helper::CameraMetadata(),
+                       nullptr) {}
+
+    using OutputThread::PipelineFrame;
+    using OutputThread::returnFrame;
+};
+
+TestOutputThread::PipelineFrame makeFrame(int32_t frameNumber) {
+    TestOutputThread::PipelineFrame frame;
+    frame.req = std::make_shared<HalRequest>();
+    frame.req->frameNumber = frameNumber;
+    return frame;
+}
+
+}  // namespace
+
+TEST(OutputThreadTest, FramesAfterDeviceErrorAreReturnedAsRequestErrors) {
+    auto parent = std::make_shared<FakeParent>();
+    TestOutputThread thread(parent);
+
+    auto frame = makeFrame(1);
+    thread.returnFrame(parent, frame);
+    frame = makeFrame(2);
+    frame.deviceError = true;
+    thread.returnFrame(parent, frame);
+    // Frames already in the pipeline behind the failing one, successful or not, must still give
+    // their buffers back.
+    frame = makeFrame(3);
+    thread.returnFrame(parent, frame);
+    frame = makeFrame(4);
+    frame.requestError = true;
+    thread.returnFrame(parent, frame);
+    frame = makeFrame(5);
+    frame.deviceError = true;
+    thread.returnFrame(parent, frame);
+
+    EXPECT_EQ(std::vector<int32_t>({1}), parent->results);
+    EXPECT_EQ(std::vector<int32_t>({2}), parent->deviceErrors);
+    EXPECT_EQ(std::vector<int32_t>({3, 4, 5}), parent->requestErrors);
+}